@@ -22,9 +22,11 @@
 #include <cstring>
 #include <iostream>
 #include <math.h>
+#include <boost/algorithm/string/predicate.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/nowide/args.hpp>
 #include <boost/nowide/cenv.hpp>
+#include <boost/nowide/fstream.hpp>
 #include <boost/nowide/iostream.hpp>
 #include <boost/nowide/integration/filesystem.hpp>
 
@@ -36,6 +38,7 @@
 #include "libslic3r/Model.hpp"
 #include "libslic3r/Print.hpp"
 #include "libslic3r/SLAPrint.hpp"
+#include "libslic3r/Trace.hpp"
 #include "libslic3r/TriangleMesh.hpp"
 #include "libslic3r/Format/AMF.hpp"
 #include "libslic3r/Format/3mf.hpp"
@@ -87,11 +90,41 @@ int CLI::run(int argc, char **argv)
     m_extra_config.apply(m_config, true);
     m_extra_config.normalize();
 
+    // Record the trace of the slicing steps if asked for, it is written once this run finishes.
+    // A batch job does not restart the trace recorded for the complete batch.
+    struct TraceGuard {
+        bool active = false;
+        ~TraceGuard() {
+            if (active)
+                try {
+                    tracing::stop();
+                } catch (const std::exception &ex) {
+                    boost::nowide::cerr << ex.what() << std::endl;
+                }
+        }
+    } trace_guard;
+    if (const std::string &trace_path = m_config.opt_string("trace"); ! trace_path.empty() && ! tracing::enabled()) {
+        tracing::start(trace_path);
+        trace_guard.active = true;
+    }
+
+    if (! m_config.opt_string("batch").empty()) {
+        if (m_config_cache != nullptr) {
+            boost::nowide::cerr << "error: --batch cannot be used inside a batch" << std::endl;
+            return 1;
+        }
+        return (this->run_batch(argv[0]) == 0) ? 0 : 1;
+    }
+
     bool							start_gui			= m_actions.empty() &&
         // cutting transformations are setting an "export" action.
         std::find(m_transforms.begin(), m_transforms.end(), "cut") == m_transforms.end() &&
         std::find(m_transforms.begin(), m_transforms.end(), "cut_x") == m_transforms.end() &&
         std::find(m_transforms.begin(), m_transforms.end(), "cut_y") == m_transforms.end();
+    if (start_gui && m_config_cache != nullptr) {
+        boost::nowide::cerr << "error: no action specified for a batch job" << std::endl;
+        return 1;
+    }
     PrinterTechnology				printer_technology	= get_printer_technology(m_extra_config);
     const std::vector<std::string> &load_configs		= m_config.option<ConfigOptionStrings>("load", true)->values;
 
@@ -105,14 +138,29 @@ int CLI::run(int argc, char **argv)
                 return 1;
             }
         }
-        DynamicPrintConfig config;
-        try {
-            config.load(file);
-        } catch (std::exception &ex) {
-            boost::nowide::cerr << "Error while reading config file: " << ex.what() << std::endl;
-            return 1;
+        DynamicPrintConfig  config;
+        DynamicPrintConfig *cached = nullptr;
+        ConfigCache::key_type cache_key;
+        if (m_config_cache != nullptr) {
+            boost::system::error_code ec;
+            cache_key = std::make_pair(file, boost::filesystem::last_write_time(file, ec));
+            auto it = m_config_cache->find(cache_key);
+            if (it != m_config_cache->end())
+                cached = &it->second;
+        }
+        if (cached != nullptr)
+            config = *cached;
+        else {
+            try {
+                config.load(file);
+            } catch (std::exception &ex) {
+                boost::nowide::cerr << "Error while reading config file: " << ex.what() << std::endl;
+                return 1;
+            }
+            config.normalize();
+            if (m_config_cache != nullptr)
+                m_config_cache->emplace(cache_key, config);
         }
-        config.normalize();
         PrinterTechnology other_printer_technology = get_printer_technology(config);
         if (printer_technology == ptUnknown) {
             printer_technology = other_printer_technology;
@@ -124,15 +172,28 @@ int CLI::run(int argc, char **argv)
     }
 
     // Read input file(s) if any.
+    // The plain meshes (STL, OBJ) are loaded and repaired once per batch, or once per run if not running a batch.
+    ModelCache  model_cache_local;
+    ModelCache &model_cache = (m_model_cache != nullptr) ? *m_model_cache : model_cache_local;
     for (const std::string &file : m_input_files) {
         if (! boost::filesystem::exists(file)) {
             boost::nowide::cerr << "No such file: " << file << std::endl;
-            exit(1);
+            return 1;
         }
         Model model;
         try {
-            // When loading an AMF or 3MF, config is imported as well, including the printer technology.
-            model = Model::read_from_file(file, &m_print_config, true);
+            if (boost::algorithm::iends_with(file, ".stl") || boost::algorithm::iends_with(file, ".obj")) {
+                boost::system::error_code ec;
+                ModelCache::key_type cache_key = std::make_pair(file, boost::filesystem::last_write_time(file, ec));
+                auto it = model_cache.find(cache_key);
+                if (it == model_cache.end())
+                    // A plain mesh does not import any config.
+                    it = model_cache.emplace(cache_key, Model::read_from_file(file, nullptr, true)).first;
+                model = it->second;
+                update_custom_gcode_per_print_z_from_config(model.custom_gcode_per_print_z.gcodes, &m_print_config);
+            } else
+                // When loading an AMF or 3MF, config is imported as well, including the printer technology.
+                model = Model::read_from_file(file, &m_print_config, true);
             PrinterTechnology other_printer_technology = get_printer_technology(m_print_config);
             if (printer_technology == ptUnknown) {
                 printer_technology = other_printer_technology;
@@ -393,6 +454,8 @@ int CLI::run(int argc, char **argv)
                 std::string outfile = m_config.opt_string("output");
                 Print       fff_print;
                 SLAPrint    sla_print;
+                // The layers are sliced once and exported, release their data as soon as it is not needed.
+                fff_print.set_lean_mode(true);
 
                 sla_print.set_status_callback(
                             [](const PrintBase::SlicingStatus& s)
@@ -424,22 +487,44 @@ int CLI::run(int argc, char **argv)
                 else
                     try {
                         std::string outfile_final;
-                        print->process();
-                        if (printer_technology == ptFFF) {
-                            // The outfile is processed by a PlaceholderParser.
-                            outfile = fff_print.export_gcode(outfile, nullptr);
-                            outfile_final = fff_print.print_statistics().finalize_output_path(outfile);
-                        } else {
-                            outfile = sla_print.output_filepath(outfile);
-                            // We need to finalize the filename beforehand because the export function sets the filename inside the zip metadata
-                            outfile_final = sla_print.print_statistics().finalize_output_path(outfile);
-                            sla_print.export_raster(outfile_final);
-                        }
+                        // Write the SLA layers into the output file as they are rasterized instead of keeping them in memory.
+                        std::unique_ptr<Zipper> sla_zipper;
+                        if (printer_technology == ptSLA)
+                            sla_print.set_raster_output_callback([&sla_print, &outfile, &outfile_final, &sla_zipper]() {
+                                outfile = sla_print.output_filepath(outfile);
+                                // We need to finalize the filename beforehand because the export function sets the filename inside the zip metadata
+                                outfile_final = sla_print.print_statistics().finalize_output_path(outfile);
+                                sla_zipper = Slic3r::make_unique<Zipper>(outfile_final);
+                                return sla_zipper.get();
+                            });
+                        run_in_thread_arena([&]() {
+                            print->process();
+                            if (printer_technology == ptFFF) {
+                                // The outfile is processed by a PlaceholderParser.
+                                outfile = fff_print.export_gcode(outfile, nullptr);
+                                outfile_final = fff_print.print_statistics().finalize_output_path(outfile);
+                            } else if (sla_zipper) {
+                                sla_zipper->finalize();
+                            } else {
+                                outfile = sla_print.output_filepath(outfile);
+                                // We need to finalize the filename beforehand because the export function sets the filename inside the zip metadata
+                                outfile_final = sla_print.print_statistics().finalize_output_path(outfile);
+                                sla_print.export_raster(outfile_final);
+                            }
+                        });
                         if (outfile != outfile_final && Slic3r::rename_file(outfile, outfile_final)) {
                             boost::nowide::cerr << "Renaming file " << outfile << " to " << outfile_final << " failed" << std::endl;
                             return 1;
                         }
                         boost::nowide::cout << "Slicing result exported to " << outfile << std::endl;
+                        if (std::find(m_actions.begin(), m_actions.end(), "info") != m_actions.end()) {
+                            // Memory held by the results of the slicing steps, in bytes.
+                            PrintMemoryStats stats = print->memory_stats();
+                            boost::nowide::cout << "[memory]" << std::endl;
+                            for (const std::pair<std::string, size_t> &step : stats.steps)
+                                boost::nowide::cout << step.first << " = " << step.second << std::endl;
+                            boost::nowide::cout << "total = " << stats.total() << std::endl;
+                        }
                     } catch (const std::exception &ex) {
                         boost::nowide::cerr << ex.what() << std::endl;
                         return 1;
@@ -586,6 +671,9 @@ bool CLI::setup(int argc, char **argv)
         const ConfigOptionInt *opt_loglevel = m_config.opt<ConfigOptionInt>("loglevel");
         if (opt_loglevel != 0)
             set_logging_level(opt_loglevel->value);
+        const ConfigOptionInt *opt_threads = m_config.opt<ConfigOptionInt>("threads");
+        if (opt_threads != nullptr)
+            set_num_threads((unsigned int)std::max(0, opt_threads->value));
     }
 
     // Initialize with defaults.
@@ -598,6 +686,73 @@ bool CLI::setup(int argc, char **argv)
     return true;
 }
 
+// Splits a command line of a batch file into arguments. Arguments containing spaces may be enclosed in double quotes.
+static std::vector<std::string> split_batch_line(const std::string &line)
+{
+    std::vector<std::string> args;
+    std::string arg;
+    bool        in_arg   = false;
+    bool        in_quote = false;
+    for (char c : line) {
+        if (c == '"') {
+            in_quote = ! in_quote;
+            in_arg   = true;
+        } else if (! in_quote && (c == ' ' || c == '\t' || c == '\r')) {
+            if (in_arg)
+                args.emplace_back(std::move(arg));
+            arg.clear();
+            in_arg = false;
+        } else {
+            arg += c;
+            in_arg = true;
+        }
+    }
+    if (in_arg)
+        args.emplace_back(std::move(arg));
+    return args;
+}
+
+int CLI::run_batch(const char *argv0)
+{
+    const std::string         &batch_file = m_config.opt_string("batch");
+    boost::nowide::ifstream    ifs;
+    if (batch_file != "-") {
+        ifs.open(batch_file.c_str());
+        if (! ifs.good()) {
+            boost::nowide::cerr << "No such file: " << batch_file << std::endl;
+            return 1;
+        }
+    }
+    std::istream &is = (batch_file == "-") ? static_cast<std::istream&>(boost::nowide::cin) : ifs;
+
+    // The config files and the plain meshes are shared by all jobs, the print definitions and the TBB scheduler by the whole process.
+    ConfigCache config_cache;
+    ModelCache  model_cache;
+    int         num_jobs   = 0;
+    int         num_failed = 0;
+    std::string line;
+    while (std::getline(is, line)) {
+        std::vector<std::string> args = split_batch_line(line);
+        if (args.empty() || args.front()[0] == '#')
+            continue;
+        args.insert(args.begin(), argv0);
+        std::vector<char*> argv_ptrs;
+        for (std::string &arg : args)
+            argv_ptrs.emplace_back(&arg[0]);
+        argv_ptrs.emplace_back(nullptr);
+        ++ num_jobs;
+        CLI job;
+        job.m_config_cache = &config_cache;
+        job.m_model_cache  = &model_cache;
+        int result = job.run(int(args.size()), argv_ptrs.data());
+        if (result != 0)
+            ++ num_failed;
+        boost::nowide::cout << "Batch job " << num_jobs << (result == 0 ? " finished" : " failed") << std::endl;
+    }
+    boost::nowide::cout << "Batch finished, " << num_jobs << " jobs, " << num_failed << " failed" << std::endl;
+    return num_failed;
+}
+
 void CLI::print_help(bool include_print_options, PrinterTechnology printer_technology) const
 {
     boost::nowide::cout
@@ -4,6 +4,9 @@
 #include "libslic3r/Config.hpp"
 #include "libslic3r/Model.hpp"
 
+#include <ctime>
+#include <map>
+
 namespace Slic3r {
 
 namespace IO {
@@ -22,6 +25,11 @@ public:
     int run(int argc, char **argv);
 
 private:
+    // Config files loaded by the jobs of a batch, keyed by their path and modification time.
+    typedef std::map<std::pair<std::string, std::time_t>, DynamicPrintConfig> ConfigCache;
+    // Models loaded from plain mesh files (STL, OBJ), keyed by their path and modification time.
+    typedef std::map<std::pair<std::string, std::time_t>, Model> ModelCache;
+
     DynamicPrintAndCLIConfig    m_config;
     DynamicPrintConfig			m_print_config;
     DynamicPrintConfig          m_extra_config;
@@ -29,8 +37,14 @@ private:
     std::vector<std::string>    m_actions;
     std::vector<std::string>    m_transforms;
     std::vector<Model>          m_models;
+    // Set if this CLI runs a single job of a batch.
+    ConfigCache                *m_config_cache = nullptr;
+    ModelCache                 *m_model_cache  = nullptr;
 
     bool setup(int argc, char **argv);
+
+    /// Runs the command lines of the --batch file as separate jobs. Returns the number of failed jobs.
+    int run_batch(const char *argv0);
     
     /// Prints usage of the CLI.
     void print_help(bool include_print_options = false, PrinterTechnology printer_technology = ptAny) const;
@@ -34,6 +34,9 @@
 #define BOOST_POOL_NO_MT
 #include <boost/pool/object_pool.hpp>
 
+#include <tbb/parallel_reduce.h>
+#include <tbb/parallel_sort.h>
+
 #include "stl.h"
 
 struct HashEdge {
@@ -52,11 +55,15 @@ struct HashEdge {
 	HashEdge  *next;
 
 	void load_exact(stl_file *stl, const stl_vertex *a, const stl_vertex *b)
+		{ this->load_exact(stl->stats.shortest_edge, a, b); }
+
+	// Thread safe variant, the shortest edge is accumulated into the shortest_edge parameter.
+	void load_exact(float &shortest_edge, const stl_vertex *a, const stl_vertex *b)
 	{
 		{
 	    	stl_vertex diff = (*a - *b).cwiseAbs();
 	    	float max_diff = std::max(diff(0), std::max(diff(1), diff(2)));
-	    	stl->stats.shortest_edge = std::min(max_diff, stl->stats.shortest_edge);
+	    	shortest_edge = std::min(max_diff, shortest_edge);
 	  	}
 
 	  	// Ensure identical vertex ordering of equal edges.
@@ -120,6 +127,41 @@ private:
 	}
 };
 
+// Record edge_a and edge_b of two different facets as neighbors, update the connectivity statistics.
+static void record_neighbors(stl_file *stl, const HashEdge &edge_a, const HashEdge &edge_b)
+{
+	// Facet a's neighbor is facet b
+	stl->neighbors_start[edge_a.facet_number].neighbor[edge_a.which_edge % 3] = edge_b.facet_number;	/* sets the .neighbor part */
+	stl->neighbors_start[edge_a.facet_number].which_vertex_not[edge_a.which_edge % 3] = (edge_b.which_edge + 2) % 3; /* sets the .which_vertex_not part */
+
+	// Facet b's neighbor is facet a
+	stl->neighbors_start[edge_b.facet_number].neighbor[edge_b.which_edge % 3] = edge_a.facet_number;	/* sets the .neighbor part */
+	stl->neighbors_start[edge_b.facet_number].which_vertex_not[edge_b.which_edge % 3] = (edge_a.which_edge + 2) % 3; /* sets the .which_vertex_not part */
+
+	if (((edge_a.which_edge < 3) && (edge_b.which_edge < 3)) || ((edge_a.which_edge > 2) && (edge_b.which_edge > 2))) {
+		// These facets are oriented in opposite directions, their normals are probably messed up.
+		stl->neighbors_start[edge_a.facet_number].which_vertex_not[edge_a.which_edge % 3] += 3;
+		stl->neighbors_start[edge_b.facet_number].which_vertex_not[edge_b.which_edge % 3] += 3;
+	}
+
+	// Count successful connects:
+	// Total connects:
+	stl->stats.connected_edges += 2;
+	// Count individual connects:
+	switch (stl->neighbors_start[edge_a.facet_number].num_neighbors()) {
+	case 1:	++ stl->stats.connected_facets_1_edge; break;
+	case 2: ++ stl->stats.connected_facets_2_edge; break;
+	case 3: ++ stl->stats.connected_facets_3_edge; break;
+	default: assert(false);
+	}
+	switch (stl->neighbors_start[edge_b.facet_number].num_neighbors()) {
+	case 1:	++ stl->stats.connected_facets_1_edge; break;
+	case 2: ++ stl->stats.connected_facets_2_edge; break;
+	case 3: ++ stl->stats.connected_facets_3_edge; break;
+	default: assert(false);
+	}
+}
+
 struct HashTableEdges {
 	HashTableEdges(size_t number_of_faces) {
 		this->M = (int)hash_size_from_nr_faces(number_of_faces);
@@ -239,40 +281,6 @@ private:
 	    return edge_a.facet_number != edge_b.facet_number && edge_a == edge_b;
 	}
 
-	static void record_neighbors(stl_file *stl, const HashEdge &edge_a, const HashEdge &edge_b)
-	{
-		// Facet a's neighbor is facet b
-		stl->neighbors_start[edge_a.facet_number].neighbor[edge_a.which_edge % 3] = edge_b.facet_number;	/* sets the .neighbor part */
-		stl->neighbors_start[edge_a.facet_number].which_vertex_not[edge_a.which_edge % 3] = (edge_b.which_edge + 2) % 3; /* sets the .which_vertex_not part */
-
-		// Facet b's neighbor is facet a
-		stl->neighbors_start[edge_b.facet_number].neighbor[edge_b.which_edge % 3] = edge_a.facet_number;	/* sets the .neighbor part */
-		stl->neighbors_start[edge_b.facet_number].which_vertex_not[edge_b.which_edge % 3] = (edge_a.which_edge + 2) % 3; /* sets the .which_vertex_not part */
-
-		if (((edge_a.which_edge < 3) && (edge_b.which_edge < 3)) || ((edge_a.which_edge > 2) && (edge_b.which_edge > 2))) {
-			// These facets are oriented in opposite directions, their normals are probably messed up.
-			stl->neighbors_start[edge_a.facet_number].which_vertex_not[edge_a.which_edge % 3] += 3;
-			stl->neighbors_start[edge_b.facet_number].which_vertex_not[edge_b.which_edge % 3] += 3;
-		}
-
-		// Count successful connects:
-		// Total connects:
-		stl->stats.connected_edges += 2;
-		// Count individual connects:
-		switch (stl->neighbors_start[edge_a.facet_number].num_neighbors()) {
-		case 1:	++ stl->stats.connected_facets_1_edge; break;
-		case 2: ++ stl->stats.connected_facets_2_edge; break;
-		case 3: ++ stl->stats.connected_facets_3_edge; break;
-		default: assert(false);
-		}
-		switch (stl->neighbors_start[edge_b.facet_number].num_neighbors()) {
-		case 1:	++ stl->stats.connected_facets_1_edge; break;
-		case 2: ++ stl->stats.connected_facets_2_edge; break;
-		case 3: ++ stl->stats.connected_facets_3_edge; break;
-		default: assert(false);
-		}
-	}
-
 	static void match_neighbors_nearby(stl_file *stl, const HashEdge &edge_a, const HashEdge &edge_b)
 	{
 		record_neighbors(stl, edge_a, edge_b);
@@ -453,21 +461,59 @@ void stl_check_facets_exact(stl_file *stl)
 		  	++ i;
   	}
 
-  	// Initialize hash table.
-  	HashTableEdges hash_table(stl->stats.number_of_facets);
 	for (auto &neighbor : stl->neighbors_start)
 		neighbor.reset();
 
-  	// Connect neighbor edges.
-	for (uint32_t i = 0; i < stl->stats.number_of_facets; ++ i) {
-		const stl_facet &facet = stl->facet_start[i];
-		for (int j = 0; j < 3; ++ j) {
-			HashEdge edge;
-			edge.facet_number = i;
-			edge.which_edge = j;
-			edge.load_exact(stl, &facet.vertex[j], &facet.vertex[(j + 1) % 3]);
-			hash_table.insert_edge_exact(stl, edge);
+	// Connect neighbor edges. Instead of inserting the edges into HashTableEdges one by one, the edge keys are calculated
+	// and sorted in parallel, so that the equal edges end up next to each other.
+	// The edges are sorted by their keys and then by their order in the mesh. Equal edges are paired in that order
+	// exactly as HashTableEdges pairs them: an edge is connected to the first not yet connected preceding equal edge
+	// of another facet, otherwise it is left open for the following equal edges. The result is thus the same.
+	std::vector<HashEdge> edges(size_t(stl->stats.number_of_facets) * 3);
+	stl->stats.shortest_edge = tbb::parallel_reduce(
+		tbb::blocked_range<uint32_t>(0, stl->stats.number_of_facets, 4096),
+		stl->stats.shortest_edge,
+		[stl, &edges](const tbb::blocked_range<uint32_t> &range, float shortest_edge) {
+			for (uint32_t i = range.begin(); i < range.end(); ++ i) {
+				const stl_facet &facet = stl->facet_start[i];
+				for (int j = 0; j < 3; ++ j) {
+					HashEdge &edge = edges[i * 3 + j];
+					edge.facet_number = i;
+					edge.which_edge = j;
+					edge.next = nullptr;
+					edge.load_exact(shortest_edge, &facet.vertex[j], &facet.vertex[(j + 1) % 3]);
+				}
+			}
+			return shortest_edge;
+		},
+		[](float a, float b) { return std::min(a, b); });
+	tbb::parallel_sort(edges.begin(), edges.end(), [](const HashEdge &lhs, const HashEdge &rhs) {
+		int cmp = memcmp(lhs.key, rhs.key, sizeof(lhs.key));
+		return cmp < 0 || (cmp == 0 && (lhs.facet_number < rhs.facet_number || (lhs.facet_number == rhs.facet_number && lhs.which_edge % 3 < rhs.which_edge % 3)));
+	});
+	std::vector<const HashEdge*> open_edges;
+	for (size_t i = 0; i < edges.size();) {
+		size_t j = i + 1;
+		for (; j < edges.size() && edges[j] == edges[i]; ++ j) ;
+		if (j == i + 2) {
+			// The most common case, a manifold edge.
+			if (edges[i].facet_number != edges[i + 1].facet_number)
+				record_neighbors(stl, edges[i + 1], edges[i]);
+		} else if (j > i + 2) {
+			// Non-manifold edge.
+			open_edges.clear();
+			for (size_t k = i; k < j; ++ k) {
+				const HashEdge &edge = edges[k];
+				auto it = std::find_if(open_edges.begin(), open_edges.end(), [&edge](const HashEdge *e) { return e->facet_number != edge.facet_number; });
+				if (it == open_edges.end())
+					open_edges.emplace_back(&edge);
+				else {
+					record_neighbors(stl, edge, **it);
+					open_edges.erase(it);
+				}
+			}
 		}
+		i = j;
 	}
 
 #if 0
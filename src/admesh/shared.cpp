@@ -125,6 +125,20 @@ void stl_generate_shared_vertices(stl_file *stl, indexed_triangle_set &its)
 	}
 }
 
+void stl_generate_facets(stl_file *stl, const indexed_triangle_set &its)
+{
+	stl->facet_start.assign(its.indices.size(), stl_facet());
+	for (size_t i = 0; i < its.indices.size(); ++ i) {
+		stl_facet &facet = stl->facet_start[i];
+		for (int j = 0; j < 3; ++ j)
+			facet.vertex[j] = its.vertices[its.indices[i](j)];
+		facet.extra[0] = 0;
+		facet.extra[1] = 0;
+		stl_calculate_normal(facet.normal, &facet);
+		stl_normalize_vector(facet.normal);
+	}
+}
+
 bool its_write_off(const indexed_triangle_set &its, const char *file)
 {
 	/* Open the file */
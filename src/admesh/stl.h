@@ -274,6 +274,8 @@ extern void its_rotate_y(indexed_triangle_set &its, float angle);
 extern void its_rotate_z(indexed_triangle_set &its, float angle);
 
 extern void stl_generate_shared_vertices(stl_file *stl, indexed_triangle_set &its);
+// Inverse of stl_generate_shared_vertices(): Fill in stl->facet_start from the indexed triangle set, recalculating the normals.
+extern void stl_generate_facets(stl_file *stl, const indexed_triangle_set &its);
 extern bool its_write_obj(const indexed_triangle_set &its, const char *file);
 extern bool its_write_off(const indexed_triangle_set &its, const char *file);
 extern bool its_write_vrml(const indexed_triangle_set &its, const char *file);
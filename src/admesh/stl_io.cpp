@@ -22,6 +22,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
 
 #include <boost/log/trivial.hpp>
 #include <boost/nowide/cstdio.hpp>
@@ -141,23 +142,28 @@ bool stl_write_binary(stl_file *stl, const char *file, const char *label)
 	#define SEEK_SET 0
 #endif
 	fseek(fp, LABEL_SIZE, SEEK_SET);
-#if BOOST_ENDIAN_LITTLE_BYTE
-	fwrite(&stl->stats.number_of_facets, 4, 1, fp);
-	for (const stl_facet &facet : stl->facet_start)
-	  	fwrite(&facet, SIZEOF_STL_FACET, 1, fp);
-#else /* BOOST_ENDIAN_LITTLE_BYTE */
-	char buffer[50];
-	// Convert the number of facets to little endian.
+	char buffer[4];
 	memcpy(buffer, &stl->stats.number_of_facets, 4);
+#if BOOST_ENDIAN_BIG_BYTE
+	// Convert the number of facets to little endian.
 	stl_internal_reverse_quads(buffer, 4);
+#endif /* BOOST_ENDIAN_BIG_BYTE */
 	fwrite(buffer, 4, 1, fp);
-	for (const stl_facet &facet : stl->facet_start) {
-		memcpy(buffer, &facet, 50);
-		// Convert to little endian.
-		stl_internal_reverse_quads(buffer, 48);
-		fwrite(buffer, SIZEOF_STL_FACET, 1, fp);
+	// The facets are padded in memory beyond their SIZEOF_STL_FACET bytes stored, write them through a buffer of many facets.
+	const size_t max_facets_in_buffer = 65536;
+	std::vector<char> facets_buffer(SIZEOF_STL_FACET * std::min(stl->facet_start.size(), max_facets_in_buffer));
+	for (size_t begin = 0; begin < stl->facet_start.size(); begin += max_facets_in_buffer) {
+		size_t end = std::min(stl->facet_start.size(), begin + max_facets_in_buffer);
+		char  *ptr = facets_buffer.data();
+		for (size_t i = begin; i < end; ++ i, ptr += SIZEOF_STL_FACET) {
+			memcpy(ptr, &stl->facet_start[i], SIZEOF_STL_FACET);
+#if BOOST_ENDIAN_BIG_BYTE
+			// Convert to little endian.
+			stl_internal_reverse_quads(ptr, 48);
+#endif /* BOOST_ENDIAN_BIG_BYTE */
+		}
+		fwrite(facets_buffer.data(), SIZEOF_STL_FACET, end - begin, fp);
 	}
-#endif /* BOOST_ENDIAN_LITTLE_BYTE */
 	fclose(fp);
 	return true;
 }
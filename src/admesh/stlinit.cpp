@@ -30,6 +30,9 @@
 #include <boost/nowide/cstdio.hpp>
 #include <boost/detail/endian.hpp>
 
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
+
 #include "stl.h"
 
 #ifndef SEEK_SET
@@ -140,29 +143,70 @@ static FILE* stl_open_count_facets(stl_file *stl, const char *file)
   	return fp;
 }
 
-/* Reads the contents of the file pointed to by fp into the stl structure,
-   starting at facet first_facet.  The second argument says if it's our first
-   time running this for the stl and therefore we should reset our max and min stats. */
-static bool stl_read(stl_file *stl, FILE *fp, int first_facet, bool first)
+// Reads the facets of a binary .STL file starting at facet first_facet.
+// The file is read in large blocks, which are then unpacked in parallel, as the packed 50 byte
+// facets of the file don't match the memory layout of stl_facet.
+static bool stl_read_binary(stl_file *stl, FILE *fp, uint32_t first_facet)
 {
-	if (stl->stats.type == binary)
-    	fseek(fp, HEADER_SIZE, SEEK_SET);
-  	else
-    	rewind(fp);
-
-  	char normal_buf[3][32];
-  	for (uint32_t i = first_facet; i < stl->stats.number_of_facets; ++ i) {
-  	  	stl_facet facet;
-
-    	if (stl->stats.type == binary) {
-      		// Read a single facet from a binary .STL file. We assume little-endian architecture!
-      		if (fread(&facet, 1, SIZEOF_STL_FACET, fp) != SIZEOF_STL_FACET)
-      			return false;
+	fseek(fp, HEADER_SIZE + long(first_facet) * SIZEOF_STL_FACET, SEEK_SET);
+	const uint32_t    facets_per_block = 65536;
+	std::vector<char> buffer(std::min(facets_per_block, stl->stats.number_of_facets - first_facet) * SIZEOF_STL_FACET);
+	for (uint32_t i = first_facet; i < stl->stats.number_of_facets;) {
+		uint32_t num_facets = std::min(facets_per_block, stl->stats.number_of_facets - i);
+		if (fread(buffer.data(), SIZEOF_STL_FACET, num_facets, fp) != num_facets)
+			return false;
+		tbb::parallel_for(tbb::blocked_range<uint32_t>(0, num_facets),
+			[stl, i, &buffer](const tbb::blocked_range<uint32_t> &range) {
+				for (uint32_t j = range.begin(); j < range.end(); ++ j) {
+					stl_facet &facet = stl->facet_start[i + j];
+					memcpy(&facet, buffer.data() + size_t(j) * SIZEOF_STL_FACET, SIZEOF_STL_FACET);
 #ifndef BOOST_LITTLE_ENDIAN
-      		// Convert the loaded little endian data to big endian.
-      		stl_internal_reverse_quads((char*)&facet, 48);
+					// Convert the loaded little endian data to big endian.
+					stl_internal_reverse_quads((char*)&facet, 48);
 #endif /* BOOST_LITTLE_ENDIAN */
-    	} else {
+				}
+			});
+		i += num_facets;
+	}
+	return true;
+}
+
+// Update the bounding box and the initial shortest edge estimate from all the facets in parallel.
+static void stl_facets_stats(stl_file *stl)
+{
+	if (stl->facet_start.empty())
+		return;
+	bool first = true;
+	stl_facet_stats(stl, stl->facet_start.front(), first);
+	typedef std::pair<stl_vertex, stl_vertex> BoundingBox;
+	BoundingBox bbox = tbb::parallel_reduce(tbb::blocked_range<size_t>(0, stl->facet_start.size()), BoundingBox(stl->stats.min, stl->stats.max),
+		[stl](const tbb::blocked_range<size_t> &range, BoundingBox bbox) {
+			for (size_t i = range.begin(); i < range.end(); ++ i)
+				for (const stl_vertex &v : stl->facet_start[i].vertex) {
+					bbox.first  = bbox.first.cwiseMin(v);
+					bbox.second = bbox.second.cwiseMax(v);
+				}
+			return bbox;
+		},
+		[](const BoundingBox &bbox1, const BoundingBox &bbox2) {
+			return BoundingBox(bbox1.first.cwiseMin(bbox2.first), bbox1.second.cwiseMax(bbox2.second));
+		});
+	stl->stats.min = bbox.first;
+	stl->stats.max = bbox.second;
+}
+
+/* Reads the contents of the file pointed to by fp into the stl structure,
+   starting at facet first_facet. */
+static bool stl_read(stl_file *stl, FILE *fp, int first_facet)
+{
+	if (stl->stats.type == binary) {
+		if (! stl_read_binary(stl, fp, first_facet))
+			return false;
+	} else {
+		rewind(fp);
+	  	char normal_buf[3][32];
+	  	for (uint32_t i = first_facet; i < stl->stats.number_of_facets; ++ i) {
+	  	  	stl_facet facet;
 			// Read a single facet from an ASCII .STL file
 			// skip solid/endsolid
 			// (in this order, otherwise it won't work when they are paired in the middle of a file)
@@ -203,7 +247,6 @@ static bool stl_read(stl_file *stl, FILE *fp, int first_facet, bool first)
 			  	// Just reset the normal and silently ignore it.
 			  	memset(&facet.normal, 0, sizeof(facet.normal));
 			}
-		}
 
 #if 0
 		// Report close to zero vertex coordinates. Due to the nature of the floating point numbers,
@@ -220,11 +263,12 @@ static bool stl_read(stl_file *stl, FILE *fp, int first_facet, bool first)
 		}
 #endif
 
-		// Write the facet into memory.
-		stl->facet_start[i] = facet;
-		stl_facet_stats(stl, facet, first);
-  	}
-  
+			// Write the facet into memory.
+			stl->facet_start[i] = facet;
+	  	}
+	}
+
+	stl_facets_stats(stl);
   	stl->stats.size = stl->stats.max - stl->stats.min;
   	stl->stats.bounding_diameter = stl->stats.size.norm();
   	return true;
@@ -237,7 +281,7 @@ bool stl_open(stl_file *stl, const char *file)
 	if (fp == nullptr)
 		return false;
 	stl_allocate(stl);
-	bool result = stl_read(stl, fp, 0, true);
+	bool result = stl_read(stl, fp, 0);
   	fclose(fp);
   	return result;
 }
@@ -291,8 +291,15 @@ class ClipperBase
 public:
   ClipperBase() : m_UseFullRange(false), m_HasOpenPaths(false) {}
   ~ClipperBase() { Clear(); }
-  bool AddPath(const Path &pg, PolyType PolyTyp, bool Closed);
-  bool AddPaths(const Paths &ppg, PolyType PolyTyp, bool Closed);
+  bool AddPath(const Path &pg, PolyType PolyTyp, bool Closed) { return this->AddPath<Path>(pg, PolyTyp, Closed); }
+  bool AddPaths(const Paths &ppg, PolyType PolyTyp, bool Closed) { return this->AddPaths<Paths>(ppg, PolyTyp, Closed); }
+  // PathInput is any random access container of points convertible to IntPoint,
+  // PathsInput is any iterable container of such paths. This allows the caller to pass its own
+  // polygons through a thin adapter instead of copying them into Path / Paths first.
+  template<typename PathInput>
+  bool AddPath(const PathInput &pg, PolyType PolyTyp, bool Closed);
+  template<typename PathsInput>
+  bool AddPaths(const PathsInput &ppg, PolyType PolyTyp, bool Closed);
   void Clear();
   IntRect GetBounds();
   // By default, when three or more vertices are collinear in input polygons (subject or clip), the Clipper object removes the 'inner' vertices before clipping.
@@ -300,7 +307,19 @@ public:
   bool PreserveCollinear() const {return m_PreserveCollinear;};
   void PreserveCollinear(bool value) {m_PreserveCollinear = value;};
 protected:
-  bool AddPathInternal(const Path &pg, int highI, PolyType PolyTyp, bool Closed, TEdge* edges);
+  // Index of the last point of the input path to be converted into an edge, -1 if the path is degenerate.
+  template<typename PathInput>
+  static int PathHighIndex(const PathInput &pg, bool Closed);
+  // Fill in edges[0..highI] from the input path.
+  template<typename PathInput>
+  bool AddPathInternal(const PathInput &pg, int highI, PolyType PolyTyp, bool Closed, TEdge* edges)
+  {
+    for (int i = 0; i <= highI; ++ i)
+      edges[i].Curr = pg[i];
+    return AddPathInternal(highI, PolyTyp, Closed, edges);
+  }
+  // Fill in edges[0..highI], their Curr points were already initialized from the input path.
+  bool AddPathInternal(int highI, PolyType PolyTyp, bool Closed, TEdge* edges);
   TEdge* AddBoundsToLML(TEdge *e, bool IsClosed);
   void Reset();
   TEdge* ProcessBound(TEdge* E, bool IsClockwise);
@@ -320,6 +339,74 @@ protected:
   // Is any of the paths inserted by AddPath() or AddPaths() open?
   bool             m_HasOpenPaths;
 };
+
+template<typename PathInput>
+int ClipperBase::PathHighIndex(const PathInput &pg, bool Closed)
+{
+  // Remove duplicate end point from a closed input path.
+  // Remove duplicate points from the end of the input path.
+  int highI = (int)pg.size() -1;
+  if (Closed) 
+    while (highI > 0 && (pg[highI] == pg[0])) 
+      --highI;
+  while (highI > 0 && (pg[highI] == pg[highI -1])) 
+    --highI;
+  if ((Closed && highI < 2) || (!Closed && highI < 1))
+    highI = -1;
+  return highI;
+}
+
+template<typename PathInput>
+bool ClipperBase::AddPath(const PathInput &pg, PolyType PolyTyp, bool Closed)
+{
+  int highI = PathHighIndex(pg, Closed);
+  if (highI < 0)
+    return false;
+
+  // Allocate a new edge array.
+  std::vector<TEdge> edges(highI + 1);
+  // Fill in the edge array.
+  bool result = AddPathInternal(pg, highI, PolyTyp, Closed, edges.data());
+  if (result)
+    // Success, remember the edge array.
+    m_edges.emplace_back(std::move(edges));
+  return result;
+}
+
+template<typename PathsInput>
+bool ClipperBase::AddPaths(const PathsInput &ppg, PolyType PolyTyp, bool Closed)
+{
+  std::vector<int> num_edges;
+  int num_edges_total = 0;
+  for (const auto &pg : ppg) {
+    int highI = PathHighIndex(pg, Closed);
+    num_edges.emplace_back(highI + 1);
+    num_edges_total += highI + 1;
+  }
+  if (num_edges_total == 0)
+    return false;
+
+  // Allocate a new edge array.
+  std::vector<TEdge> edges(num_edges_total);
+  // Fill in the edge array.
+  bool result = false;
+  TEdge *p_edge = edges.data();
+  size_t i = 0;
+  for (const auto &pg : ppg) {
+    if (num_edges[i]) {
+      bool res = AddPathInternal(pg, num_edges[i] - 1, PolyTyp, Closed, p_edge);
+      if (res) {
+        p_edge += num_edges[i];
+        result = true;
+      }
+    }
+    ++ i;
+  }
+  if (result)
+    // At least some edges were generated. Remember the edge array.
+    m_edges.emplace_back(std::move(edges));
+  return result;
+}
 //------------------------------------------------------------------------------
 
 class Clipper : public ClipperBase
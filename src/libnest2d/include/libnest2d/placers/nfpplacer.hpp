@@ -577,11 +577,95 @@ private:
 
     using Shapes = TMultiShape<RawShape>;
 
+    // A no-fit polygon computed earlier for a pair of shapes together with the
+    // translation its stationary item had at that time.
+    struct CachedNfp {
+        RawShape nfp;
+        Vertex   translation;
+    };
+
+    // Representatives of the distinct shapes (raw shape, rotation and
+    // inflation) seen so far. The index in this vector serves as a shape id.
+    std::vector<Item> shapes_;
+
+    // The convex no-fit polygons keyed by the shape ids of the stationary and
+    // the orbiting item. Arranging many copies of the same object would
+    // otherwise compute the very same polygons over and over again.
+    std::map<std::pair<size_t, size_t>, CachedNfp> nfpcache_;
+
+    // The merged pile of the packed items is kept between the trypack calls
+    // together with the items (and their placement) it was merged from.
+    // Items are mostly only appended to the pile, in that case just the new
+    // ones have to be merged into it.
+    struct PileEntry {
+        const Item *item;
+        Vertex      translation;
+        Radians     rotation;
+        Coord       inflation;
+    };
+
+    std::vector<PileEntry> pile_items_;
+    Shapes merged_pile_;
+
+    const Shapes& mergedPile()
+    {
+        auto unchanged = [this](size_t n) {
+            const PileEntry& e = pile_items_[n];
+            const Item& itm = items_[n];
+            return e.item == &itm && e.translation == itm.translation() &&
+                   double(e.rotation) == double(itm.rotation()) &&
+                   e.inflation == itm.inflation();
+        };
+
+        size_t n = 0;
+        while(n < pile_items_.size() && n < items_.size() && unchanged(n)) ++n;
+
+        if(n < pile_items_.size()) {
+            pile_items_.clear();
+            merged_pile_.clear();
+            n = 0;
+        }
+
+        if(n == items_.size()) return merged_pile_;
+
+        Shapes pile = merged_pile_;
+        pile.reserve(pile.size() + items_.size() - n);
+        for(; n < items_.size(); ++n) {
+            const Item& itm = items_[n];
+            pile.emplace_back(itm.transformedShape());
+            pile_items_.push_back({&itm, itm.translation(), itm.rotation(),
+                                   itm.inflation()});
+        }
+
+        merged_pile_ = nfp::merge(pile);
+
+        return merged_pile_;
+    }
+
+    static bool isSameShape(const Item& a, const Item& b)
+    {
+        return double(a.rotation()) == double(b.rotation()) &&
+               a.inflation() == b.inflation() &&
+               a.vertexCount() == b.vertexCount() &&
+               std::equal(a.begin(), a.end(), b.begin());
+    }
+
+    size_t shapeId(const Item& item)
+    {
+        for(size_t id = 0; id < shapes_.size(); ++id)
+            if(isSameShape(shapes_[id], item)) return id;
+
+        shapes_.emplace_back(item);
+        return shapes_.size() - 1;
+    }
+
     Shapes calcnfp(const Item &trsh, Lvl<nfp::NfpLevel::CONVEX_ONLY>)
     {
         using namespace nfp;
 
         Shapes nfps(items_.size());
+        std::vector<std::pair<size_t, size_t>> keys(items_.size());
+        std::vector<size_t> missing;
 
         // /////////////////////////////////////////////////////////////////////
         // TODO: this is a workaround and should be solved in Item with mutexes
@@ -600,16 +684,36 @@ private:
         }
         // /////////////////////////////////////////////////////////////////////
 
-        __parallel::enumerate(items_.begin(), items_.end(),
-                              [&nfps, &trsh](const Item& sh, size_t n)
+        // The corrected nfp depends only on the two shapes and the position of
+        // the stationary item, so a cached one just has to be moved in place.
+        size_t orbid = shapeId(trsh);
+        for(size_t n = 0; n < items_.size(); ++n) {
+            const Item& sh = items_[n];
+            keys[n] = {shapeId(sh), orbid};
+
+            auto it = nfpcache_.find(keys[n]);
+            if(it == nfpcache_.end()) { missing.emplace_back(n); continue; }
+
+            nfps[n] = it->second.nfp;
+            sl::translate(nfps[n], sh.translation() - it->second.translation);
+        }
+
+        __parallel::enumerate(missing.begin(), missing.end(),
+                              [this, &nfps, &trsh](size_t idx, size_t)
         {
+            const Item& sh = items_[idx];
             auto& fixedp = sh.transformedShape();
             auto& orbp = trsh.transformedShape();
             auto subnfp_r = noFitPolygon<NfpLevel::CONVEX_ONLY>(fixedp, orbp);
             correctNfpPosition(subnfp_r, sh, trsh);
-            nfps[n] = subnfp_r.first;
+            nfps[idx] = subnfp_r.first;
         });
 
+        for(size_t idx : missing) {
+            const Item& sh = items_[idx];
+            nfpcache_.emplace(keys[idx], CachedNfp{nfps[idx], sh.translation()});
+        }
+
         return nfp::merge(nfps);
     }
 
@@ -799,6 +903,11 @@ private:
             Radians final_rot = initial_rot;
             Shapes nfps;
 
+            // The pile of the already packed items does not depend on the
+            // rotation of the new item, take it only once.
+            auto merged_pile = mergedPile();
+            auto pbb = sl::boundingBox(merged_pile);
+
             for(auto rot : config_.rotations) {
 
                 item.translation(initial_tr);
@@ -823,18 +932,8 @@ private:
                     ecache.back().accuracy(config_.accuracy);
                 }
 
-                Shapes pile;
-                pile.reserve(items_.size()+1);
-                // double pile_area = 0;
-                for(Item& mitem : items_) {
-                    pile.emplace_back(mitem.transformedShape());
-                    // pile_area += mitem.area();
-                }
-
-                auto merged_pile = nfp::merge(pile);
                 auto& bin = bin_;
                 double norm = norm_;
-                auto pbb = sl::boundingBox(merged_pile);
                 auto binbb = sl::boundingBox(bin);
 
                 // This is the kernel part of the object function that is
@@ -2,6 +2,7 @@
 #include "Geometry.hpp"
 #include "SVG.hpp"
 #include "MTUtils.hpp"
+#include "Utils.hpp"
 
 #include <libnest2d/backends/clipper/geometries.hpp>
 #include <libnest2d/optimizers/nlopt/subplex.hpp>
@@ -567,6 +568,76 @@ template<class Bin> void remove_large_items(std::vector<Item> &items, Bin &&bin)
             ++it : it = items.erase(it);
 }
 
+// The bin enlarged by the part of the min distance which the inflated items
+// are allowed to overlap the bed perimeters with.
+template<class BinT> BinT corrected_bin(const BinT &bin, coord_t minobjd)
+{
+    // Integer ceiling the min distance from the bed perimeters
+    coord_t md = minobjd - 2 * scaled(0.1 + EPSILON);
+    md = (md % 2) ? md / 2 + 1 : md / 2;
+    
+    auto ret = bin;
+    sl::offset(ret, md);
+    return ret;
+}
+
+// Put the items into a lattice of their bounding boxes (including the min
+// distance) on the bin, if all of them are instances of the same object with
+// the same rotation. The lattice cells closest to the bin center are filled
+// first. The nfp placer would end up with nearly the same result for such a
+// scene, only much slower. Returns false if the items are not identical or
+// if the lattice cannot take all of them, the denser packing of the nfp
+// placer may still fit them into fewer beds.
+template<class BinT>
+bool arrange_identical(std::vector<Item> &items, const BinT &bin, coord_t minobjd)
+{
+    if (items.size() < 2) return false;
+    
+    const Item &first = items.front();
+    for (const Item &itm : items)
+        if (double(itm.rotation()) != double(first.rotation()) ||
+            sl::contour(itm.rawShape()) != sl::contour(first.rawShape()))
+            return false;
+    
+    BinT cbin = corrected_bin(bin, minobjd);
+    
+    Item cellitem = first;
+    cellitem.translation({0, 0});
+    cellitem.inflate(coord_t(std::ceil(minobjd / 2.0)));
+    Box ibb = cellitem.boundingBox();
+    
+    clppr::cInt w = ibb.width(), h = ibb.height();
+    if (w <= 0 || h <= 0) return false;
+    
+    Box binbb = sl::boundingBox(cbin);
+    clppr::cInt cols = binbb.width() / w, rows = binbb.height() / h;
+    clppr::IntPoint c = binbb.center();
+    clppr::IntPoint origin{c.X - cols * w / 2, c.Y - rows * h / 2};
+    
+    struct Cell { Box box; double dist; };
+    std::vector<Cell> cells;
+    cells.reserve(size_t(std::max(cols * rows, clppr::cInt(0))));
+    for (clppr::cInt r = 0; r < rows; ++r)
+        for (clppr::cInt cl = 0; cl < cols; ++cl) {
+            clppr::IntPoint minc{origin.X + cl * w, origin.Y + r * h};
+            Box cellbb{minc, {minc.X + w, minc.Y + h}};
+            if (sl::isInside(cellbb, cbin))
+                cells.push_back({cellbb, pl::distance(cellbb.center(), c)});
+        }
+    
+    if (cells.size() < items.size()) return false;
+    
+    std::stable_sort(cells.begin(), cells.end(),
+                     [](const Cell &a, const Cell &b) { return a.dist < b.dist; });
+    
+    for (size_t i = 0; i < items.size(); ++i) {
+        items[i].translation(cells[i].box.minCorner() - ibb.minCorner());
+        items[i].binId(0);
+    }
+    
+    return true;
+}
+
 template<class BinT> // Arrange for arbitrary bin type
 void _arrange(
         std::vector<Item> &           shapes,
@@ -576,12 +647,7 @@ void _arrange(
         std::function<void(unsigned)> progressfn,
         std::function<bool()>         stopfn)
 {
-    // Integer ceiling the min distance from the bed perimeters
-    coord_t md = minobjd - 2 * scaled(0.1 + EPSILON);
-    md = (md % 2) ? md / 2 + 1 : md / 2;
-    
-    auto corrected_bin = bin;
-    sl::offset(corrected_bin, md);
+    auto corrected_bin = arrangement::corrected_bin(bin, minobjd);
     
     AutoArranger<BinT> arranger{corrected_bin, progressfn, stopfn};
     
@@ -599,7 +665,7 @@ void _arrange(
     for (auto &itm : shapes  ) inp.emplace_back(itm);
     for (auto &itm : excludes) inp.emplace_back(itm);
     
-    arranger(inp.begin(), inp.end());
+    run_in_thread_arena([&arranger, &inp]() { arranger(inp.begin(), inp.end()); });
     for (Item &itm : inp) itm.inflate(-infl);
 }
 
@@ -658,12 +724,18 @@ void arrange(ArrangePolygons &             arrangables,
         BoundingBox bbb = bedhint.get_box();
         Box binbb{{bbb.min(X), bbb.min(Y)}, {bbb.max(X), bbb.max(Y)}};
         
+        if (fixeditems.empty() && arrange_identical(items, binbb, min_obj_dist))
+            break;
+        
         _arrange(items, fixeditems, binbb, min_obj_dist, pri, cfn);
         break;
     }
     case bsCircle: {
         auto cc = to_lnCircle(bedhint.get_circle());
         
+        if (fixeditems.empty() && arrange_identical(items, cc, min_obj_dist))
+            break;
+        
         _arrange(items, fixeditems, cc, min_obj_dist, pri, cfn);
         break;
     }
@@ -3,6 +3,8 @@
 #include "Geometry.hpp"
 #include <algorithm>
 
+#include <tbb/parallel_for.h>
+
 namespace Slic3r {
 
 BridgeDetector::BridgeDetector(
@@ -41,16 +43,23 @@ void BridgeDetector::initialize()
 
     // Outset our bridge by an arbitrary amout; we'll use this outer margin for detecting anchors.
     Polygons grown = offset(to_polygons(this->expolygons), float(this->spacing));
+
+    // Only the lower slices overlapping the grown bridge may anchor it. A layer may contain a lot of small bridges,
+    // don't clip each of them with all the lower slices.
+    BoundingBox bbox_grown = get_extents(grown);
+    Polygons    lower_contours;
+    Polygons    lower_polygons;
+    for (const ExPolygon &expoly : this->lower_slices)
+        if (get_extents(expoly.contour).overlap(bbox_grown)) {
+            lower_contours.push_back(expoly.contour);
+            polygons_append(lower_polygons, to_polygons(expoly));
+        }
     
     // Detect possible anchoring edges of this bridging region.
     // Detect what edges lie on lower slices by turning bridge contour and holes
     // into polylines and then clipping them with each lower slice's contour.
     // Currently _edges are only used to set a candidate direction of the bridge (see bridge_direction_candidates()).
-	Polygons contours;
-	contours.reserve(this->lower_slices.size());
-	for (const ExPolygon &expoly : this->lower_slices)
-		contours.push_back(expoly.contour);
-    this->_edges = intersection_pl(to_polylines(grown), contours);
+    this->_edges = intersection_pl(to_polylines(grown), lower_contours);
     
     #ifdef SLIC3R_DEBUG
     printf("  bridge has " PRINTF_ZU " support(s)\n", this->_edges.size());
@@ -58,7 +67,7 @@ void BridgeDetector::initialize()
     
     // detect anchors as intersection between our bridge expolygon and the lower slices
     // safety offset required to avoid Clipper from detecting empty intersection while Boost actually found some edges
-    this->_anchor_regions = intersection_ex(grown, to_polygons(this->lower_slices), true);
+    this->_anchor_regions = intersection_ex(grown, lower_polygons, true);
     
     /*
     if (0) {
@@ -72,6 +81,76 @@ void BridgeDetector::initialize()
     */
 }
 
+// Cover the bounding box (rotated by -angle) of the anchors with test lines spaced by spacing, clip them by the clip area (given by its edges)
+// and sum the lengths of the clipped lines with both end points inside the anchors.
+// The test lines are clipped in the rotated coordinate system, where the test lines are horizontal: The edges are rotated,
+// their intersections with the test lines are sorted by the test line and along the test line, and the clipped lines
+// are the intervals between the odd and even intersections.
+static void bridge_coverage(const Lines &clip_edges, const ExPolygons &anchors, double angle, const BoundingBox &bbox, coord_t spacing, double &total_length, double &max_length)
+{
+    total_length = 0.;
+    max_length   = 0.;
+    if (bbox.max.y() < bbox.min.y())
+        return;
+
+    const double s       = sin(angle);
+    const double c       = cos(angle);
+    const size_t n_lines = size_t((bbox.max.y() - bbox.min.y()) / spacing) + 1;
+
+    struct Intersection {
+        size_t line;
+        double x;
+        bool operator<(const Intersection &rhs) const { return this->line < rhs.line || (this->line == rhs.line && this->x < rhs.x); }
+    };
+    std::vector<Intersection> intersections;
+    for (const Line &edge : clip_edges) {
+        // Rotate the edge by -angle.
+        Vec2d a(c * double(edge.a.x()) + s * double(edge.a.y()), - s * double(edge.a.x()) + c * double(edge.a.y()));
+        Vec2d b(c * double(edge.b.x()) + s * double(edge.b.y()), - s * double(edge.b.x()) + c * double(edge.b.y()));
+        if (a.y() == b.y())
+            continue;
+        if (a.y() > b.y())
+            std::swap(a, b);
+        // The edge intersects the test lines with a.y() <= y < b.y().
+        double k_min = std::ceil((a.y() - double(bbox.min.y())) / double(spacing));
+        double k_max = std::ceil((b.y() - double(bbox.min.y())) / double(spacing)) - 1.;
+        if (k_max < 0. || k_min >= double(n_lines))
+            continue;
+        for (size_t k = size_t(std::max(0., k_min)); k <= size_t(std::min(double(n_lines - 1), k_max)); ++ k) {
+            double y = double(bbox.min.y() + coord_t(k) * spacing);
+            intersections.push_back({ k, a.x() + (y - a.y()) * (b.x() - a.x()) / (b.y() - a.y()) });
+        }
+    }
+    std::sort(intersections.begin(), intersections.end());
+
+    for (size_t i = 0; i + 1 < intersections.size();) {
+        const Intersection &i1 = intersections[i];
+        const Intersection &i2 = intersections[i + 1];
+        if (i1.line != i2.line) {
+            // Odd number of intersections due to a numerical issue, skip the test line.
+            for (size_t line = i1.line; i < intersections.size() && intersections[i].line == line; ++ i) ;
+            continue;
+        }
+        i += 2;
+        // The test line spans the bounding box of the anchors only.
+        double x1 = std::max(i1.x, double(bbox.min.x()));
+        double x2 = std::min(i2.x, double(bbox.max.x()));
+        if (x1 >= x2)
+            continue;
+        // Rotate the end points back. The anchors are tested in the unrotated coordinate system to classify the end points
+        // touching the anchor contours the same way for all the directions.
+        double y = double(bbox.min.y() + coord_t(i1.line) * spacing);
+        Point  p1((coord_t)round(c * x1 - s * y), (coord_t)round(c * y + s * x1));
+        Point  p2((coord_t)round(c * x2 - s * y), (coord_t)round(c * y + s * x2));
+        if (expolygons_contain(anchors, p1) && expolygons_contain(anchors, p2)) {
+            // This line could be anchored.
+            double len = x2 - x1;
+            total_length += len;
+            max_length = std::max(max_length, len);
+        }
+    }
+}
+
 bool BridgeDetector::detect_angle(double bridge_direction_override)
 {
     if (this->_edges.empty() || this->_anchor_regions.empty()) 
@@ -95,55 +174,28 @@ bool BridgeDetector::detect_angle(double bridge_direction_override)
     /*  we'll now try several directions using a rudimentary visibility check:
         bridge in several directions and then sum the length of lines having both
         endpoints within anchors */
-        
-    bool have_coverage = false;
-    for (size_t i_angle = 0; i_angle < candidates.size(); ++ i_angle)
-    {
-        const double angle = candidates[i_angle].angle;
-
-        Lines lines;
-        {
-            // Get an oriented bounding box around _anchor_regions.
-            BoundingBox bbox = get_extents_rotated(this->_anchor_regions, - angle);
-            // Cover the region with line segments.
-            lines.reserve((bbox.max(1) - bbox.min(1) + this->spacing) / this->spacing);
-            double s = sin(angle);
-            double c = cos(angle);
-            //FIXME Vojtech: The lines shall be spaced half the line width from the edge, but then 
-            // some of the test cases fail. Need to adjust the test cases then?
-//            for (coord_t y = bbox.min(1) + this->spacing / 2; y <= bbox.max(1); y += this->spacing)
-            for (coord_t y = bbox.min(1); y <= bbox.max(1); y += this->spacing)
-                lines.push_back(Line(
-                    Point((coord_t)round(c * bbox.min(0) - s * y), (coord_t)round(c * y + s * bbox.min(0))),
-                    Point((coord_t)round(c * bbox.max(0) - s * y), (coord_t)round(c * y + s * bbox.max(0)))));
-        }
+    // The edges of the clipping area are collected once, they are only rotated for each direction.
+    // The test lines are then clipped by sorting the intersections of the edges with the test lines, see bridge_coverage().
+    Lines clip_edges = to_lines(clip_area);
+    auto  evaluate   = [this, &candidates, &clip_edges](size_t i_angle) {
+        BridgeDirection &candidate = candidates[i_angle];
+        // Get an oriented bounding box around _anchor_regions.
+        BoundingBox bbox = get_extents_rotated(this->_anchor_regions, - candidate.angle);
+        bridge_coverage(clip_edges, this->_anchor_regions, candidate.angle, bbox, this->spacing, candidate.coverage, candidate.max_length);
+    };
+    if (candidates.size() > 1 && clip_edges.size() > 256)
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, candidates.size()), [&evaluate](const tbb::blocked_range<size_t> &range) {
+            for (size_t i_angle = range.begin(); i_angle < range.end(); ++ i_angle)
+                evaluate(i_angle);
+        });
+    else
+        for (size_t i_angle = 0; i_angle < candidates.size(); ++ i_angle)
+            evaluate(i_angle);
 
-        double total_length = 0;
-        double max_length = 0;
-        {
-            Lines clipped_lines = intersection_ln(lines, clip_area);
-            for (size_t i = 0; i < clipped_lines.size(); ++i) {
-                const Line &line = clipped_lines[i];
-                if (expolygons_contain(this->_anchor_regions, line.a) && expolygons_contain(this->_anchor_regions, line.b)) {
-                    // This line could be anchored.
-                    double len = line.length();
-                    total_length += len;
-                    max_length = std::max(max_length, len);
-                }
-            }        
-        }
-        if (total_length == 0.)
-            continue;
-
-        have_coverage = true;
-        // Sum length of bridged lines.
-        candidates[i_angle].coverage = total_length;
-        /*  The following produces more correct results in some cases and more broken in others.
-            TODO: investigate, as it looks more reliable than line clipping. */
-        // $directions_coverage{$angle} = sum(map $_->area, @{$self->coverage($angle)}) // 0;
-        // max length of bridged lines
-        candidates[i_angle].max_length = max_length;
-    }
+    /*  The following produces more correct results in some cases and more broken in others.
+        TODO: investigate, as it looks more reliable than line clipping. */
+    // $directions_coverage{$angle} = sum(map $_->area, @{$self->coverage($angle)}) // 0;
+    bool have_coverage = std::any_of(candidates.begin(), candidates.end(), [](const BridgeDirection &candidate) { return candidate.coverage > 0.; });
 
     // if no direction produced coverage, then there's no bridge direction
     if (! have_coverage)
@@ -119,6 +119,7 @@ ExPolygons PolyTreeToExPolygons(ClipperLib::PolyTree& polytree)
 Slic3r::Polygon ClipperPath_to_Slic3rPolygon(const ClipperLib::Path &input)
 {
     Polygon retval;
+    retval.points.reserve(input.size());
     for (ClipperLib::Path::const_iterator pit = input.begin(); pit != input.end(); ++pit)
         retval.points.emplace_back(pit->X, pit->Y);
     return retval;
@@ -127,6 +128,7 @@ Slic3r::Polygon ClipperPath_to_Slic3rPolygon(const ClipperLib::Path &input)
 Slic3r::Polyline ClipperPath_to_Slic3rPolyline(const ClipperLib::Path &input)
 {
     Polyline retval;
+    retval.points.reserve(input.size());
     for (ClipperLib::Path::const_iterator pit = input.begin(); pit != input.end(); ++pit)
         retval.points.emplace_back(pit->X, pit->Y);
     return retval;
@@ -165,9 +167,46 @@ ExPolygons ClipperPaths_to_Slic3rExPolygons(const ClipperLib::Paths &input)
     return PolyTreeToExPolygons(polytree);
 }
 
+// Adds the outer polygons nested in the holes after the holes, thus the expolygons are ordered as by AddOuterPolyNodeToExPolygons().
+// The scratch buffer is reused for converting the 64bit Clipper points.
+static void AddOuterPolyNodeToExPolygonSet(const ClipperLib::PolyNode &polynode, ExPolygonSet &expolygons, Points &scratch)
+{
+    auto convert = [&scratch](const ClipperLib::Path &path) -> const Points& {
+        scratch.clear();
+        for (const ClipperLib::IntPoint &pt : path)
+            scratch.emplace_back(pt.X, pt.Y);
+        return scratch;
+    };
+    expolygons.add_contour(convert(polynode.Contour));
+    for (const ClipperLib::PolyNode *hole : polynode.Childs)
+        expolygons.add_hole(convert(hole->Contour));
+    for (const ClipperLib::PolyNode *hole : polynode.Childs)
+        for (const ClipperLib::PolyNode *outer : hole->Childs)
+            AddOuterPolyNodeToExPolygonSet(*outer, expolygons, scratch);
+}
+
+ExPolygonSet PolyTreeToExPolygonSet(const ClipperLib::PolyTree &polytree)
+{
+    ExPolygonSet retval;
+    Points       scratch;
+    for (const ClipperLib::PolyNode *outer : polytree.Childs)
+        AddOuterPolyNodeToExPolygonSet(*outer, retval, scratch);
+    return retval;
+}
+
+ExPolygonSet ClipperPaths_to_ExPolygonSet(const ClipperLib::Paths &input)
+{
+    ClipperLib::Clipper clipper;
+    clipper.AddPaths(input, ClipperLib::ptSubject, true);
+    ClipperLib::PolyTree polytree;
+    clipper.Execute(ClipperLib::ctUnion, polytree, ClipperLib::pftEvenOdd, ClipperLib::pftEvenOdd);  // offset results work with both EvenOdd and NonZero
+    return PolyTreeToExPolygonSet(polytree);
+}
+
 ClipperLib::Path Slic3rMultiPoint_to_ClipperPath(const MultiPoint &input)
 {
     ClipperLib::Path retval;
+    retval.reserve(input.points.size());
     for (Points::const_iterator pit = input.points.begin(); pit != input.points.end(); ++pit)
         retval.emplace_back((*pit)(0), (*pit)(1));
     return retval;
@@ -185,6 +224,7 @@ ClipperLib::Path Slic3rMultiPoint_to_ClipperPath_reversed(const Slic3r::MultiPoi
 ClipperLib::Paths Slic3rMultiPoints_to_ClipperPaths(const Polygons &input)
 {
     ClipperLib::Paths retval;
+    retval.reserve(input.size());
     for (Polygons::const_iterator it = input.begin(); it != input.end(); ++it)
         retval.emplace_back(Slic3rMultiPoint_to_ClipperPath(*it));
     return retval;
@@ -193,6 +233,10 @@ ClipperLib::Paths Slic3rMultiPoints_to_ClipperPaths(const Polygons &input)
 ClipperLib::Paths  Slic3rMultiPoints_to_ClipperPaths(const ExPolygons &input)
 {
     ClipperLib::Paths retval;
+    size_t num_paths = 0;
+    for (auto &ep : input)
+        num_paths += 1 + ep.holes.size();
+    retval.reserve(num_paths);
     for (auto &ep : input) {
         retval.emplace_back(Slic3rMultiPoint_to_ClipperPath(ep.contour));
         
@@ -203,9 +247,24 @@ ClipperLib::Paths  Slic3rMultiPoints_to_ClipperPaths(const ExPolygons &input)
     return retval;
 }
 
+ClipperLib::Paths Slic3rMultiPoints_to_ClipperPaths(const ExPolygonSet &input)
+{
+    ClipperLib::Paths retval;
+    retval.reserve(input.num_polygons());
+    for (size_t i = 0; i < input.num_polygons(); ++ i) {
+        ExPolygonSet::PolygonView polygon = input.polygon(i);
+        retval.emplace_back();
+        retval.back().reserve(polygon.size());
+        for (const Point &pt : polygon)
+            retval.back().emplace_back(pt.x(), pt.y());
+    }
+    return retval;
+}
+
 ClipperLib::Paths Slic3rMultiPoints_to_ClipperPaths(const Polylines &input)
 {
     ClipperLib::Paths retval;
+    retval.reserve(input.size());
     for (Polylines::const_iterator it = input.begin(); it != input.end(); ++it)
         retval.emplace_back(Slic3rMultiPoint_to_ClipperPath(*it));
     return retval;
@@ -481,6 +540,70 @@ ExPolygons offset2_ex(const ExPolygons &expolygons, const float delta1,
     return union_ex(polys);
 }
 
+// Bounding box of the subject of a Clipper operation, robust against empty polygons.
+static inline void merge_extents(BoundingBox &bbox, const Points &points)
+{
+    for (const Point &pt : points)
+        bbox.merge(pt);
+}
+template<typename MultiPointType>
+static BoundingBox clipper_subject_extents(const std::vector<MultiPointType> &subject)
+{
+    BoundingBox bbox;
+    for (const MultiPointType &mp : subject)
+        merge_extents(bbox, mp.points);
+    return bbox;
+}
+static BoundingBox clipper_subject_extents(const ExPolygons &subject)
+{
+    BoundingBox bbox;
+    // The holes are inside the contours.
+    for (const ExPolygon &expoly : subject)
+        merge_extents(bbox, expoly.contour.points);
+    return bbox;
+}
+
+// Add the clip polygons to Clipper, apply the safety offset to them for any other operation than union.
+// Clip polygons, whose bounding box does not overlap the bounding box of the subject, have no influence
+// on the result of an intersection or a difference. The clip sets of these operations are often
+// much larger than the subject (for example in PrintObject::clip_fill_surfaces() or when trimming the supports),
+// therefore such clip polygons are culled before they are converted and added to Clipper.
+template<typename TSubj>
+static void clipper_add_clip_polygons(ClipperLib::Clipper &clipper, const ClipperLib::ClipType clipType, const TSubj &subject, const Polygons &clip, const bool safety_offset_)
+{
+    const bool do_safety_offset = safety_offset_ && clipType != ClipperLib::ctUnion;
+    if (clipType == ClipperLib::ctIntersection || clipType == ClipperLib::ctDifference) {
+        std::vector<const Polygon*> clip_culled;
+        BoundingBox bbox = clipper_subject_extents(subject);
+        if (bbox.defined) {
+            if (do_safety_offset)
+                // The safety offset grows the clip polygons by 10 units, twice that at the mitered corners.
+                bbox.offset(50.);
+            clip_culled.reserve(clip.size());
+            for (const Polygon &poly : clip) {
+                BoundingBox bbox_clip;
+                merge_extents(bbox_clip, poly.points);
+                if (bbox_clip.defined && bbox_clip.overlap(bbox))
+                    clip_culled.emplace_back(&poly);
+            }
+        }
+        if (do_safety_offset) {
+            ClipperLib::Paths input_clip;
+            input_clip.reserve(clip_culled.size());
+            for (const Polygon *poly : clip_culled)
+                input_clip.emplace_back(Slic3rMultiPoint_to_ClipperPath(*poly));
+            safety_offset(&input_clip);
+            clipper.AddPaths(input_clip, ClipperLib::ptClip, true);
+        } else
+            clipper.AddPaths(ClipperUtils::MultiPointPtrsProvider<Polygon>(clip_culled), ClipperLib::ptClip, true);
+    } else if (do_safety_offset) {
+        ClipperLib::Paths input_clip = Slic3rMultiPoints_to_ClipperPaths(clip);
+        safety_offset(&input_clip);
+        clipper.AddPaths(input_clip, ClipperLib::ptClip, true);
+    } else
+        clipper.AddPaths(ClipperUtils::paths_provider(clip), ClipperLib::ptClip, true);
+}
+
 template<class T, class TSubj, class TClip>
 T _clipper_do(const ClipperLib::ClipType     clipType,
               TSubj &&                        subject,
@@ -488,26 +611,18 @@ T _clipper_do(const ClipperLib::ClipType     clipType,
               const ClipperLib::PolyFillType fillType,
               const bool                     safety_offset_)
 {
-    // read input
-    ClipperLib::Paths input_subject = Slic3rMultiPoints_to_ClipperPaths(std::forward<TSubj>(subject));
-    ClipperLib::Paths input_clip    = Slic3rMultiPoints_to_ClipperPaths(std::forward<TClip>(clip));
-    
-    // perform safety offset
-    if (safety_offset_) {
-        if (clipType == ClipperLib::ctUnion) {
-            safety_offset(&input_subject);
-        } else {
-            safety_offset(&input_clip);
-        }
-    }
-    
     // init Clipper
     ClipperLib::Clipper clipper;
     clipper.Clear();
     
-    // add polygons
-    clipper.AddPaths(input_subject, ClipperLib::ptSubject, true);
-    clipper.AddPaths(input_clip,    ClipperLib::ptClip,    true);
+    // add polygons, only the input to be safety offsetted is copied into ClipperLib::Paths
+    if (safety_offset_ && clipType == ClipperLib::ctUnion) {
+        ClipperLib::Paths input_subject = Slic3rMultiPoints_to_ClipperPaths(std::forward<TSubj>(subject));
+        safety_offset(&input_subject);
+        clipper.AddPaths(input_subject, ClipperLib::ptSubject, true);
+    } else
+        clipper.AddPaths(ClipperUtils::paths_provider(subject), ClipperLib::ptSubject, true);
+    clipper_add_clip_polygons(clipper, clipType, subject, clip, safety_offset_);
     
     // perform operation
     T retval;
@@ -525,17 +640,16 @@ T _clipper_do(const ClipperLib::ClipType     clipType,
 inline ClipperLib::PolyTree _clipper_do_polytree2(const ClipperLib::ClipType clipType, const Polygons &subject, 
     const Polygons &clip, const ClipperLib::PolyFillType fillType, const bool safety_offset_)
 {
-    // read input
-    ClipperLib::Paths input_subject = Slic3rMultiPoints_to_ClipperPaths(subject);
-    ClipperLib::Paths input_clip    = Slic3rMultiPoints_to_ClipperPaths(clip);
-    
-    // perform safety offset
-    if (safety_offset_)
-        safety_offset((clipType == ClipperLib::ctUnion) ? &input_subject : &input_clip);
-    
     ClipperLib::Clipper clipper;
-    clipper.AddPaths(input_subject, ClipperLib::ptSubject, true);
-    clipper.AddPaths(input_clip,    ClipperLib::ptClip,    true);
+    // Only the input to be safety offsetted is copied into ClipperLib::Paths.
+    if (safety_offset_ && clipType == ClipperLib::ctUnion) {
+        ClipperLib::Paths input_subject = Slic3rMultiPoints_to_ClipperPaths(subject);
+        safety_offset(&input_subject);
+        clipper.AddPaths(input_subject, ClipperLib::ptSubject, true);
+    } else
+        clipper.AddPaths(ClipperUtils::paths_provider(subject), ClipperLib::ptSubject, true);
+    clipper_add_clip_polygons(clipper, clipType, subject, clip, safety_offset_);
+    ClipperLib::Paths input_subject;
     // Perform the operation with the output to input_subject.
     // This pass does not generate a PolyTree, which is a very expensive operation with the current Clipper library
     // if there are overapping edges.
@@ -552,20 +666,13 @@ ClipperLib::PolyTree _clipper_do_pl(const ClipperLib::ClipType clipType, const P
     const Polygons &clip, const ClipperLib::PolyFillType fillType,
     const bool safety_offset_)
 {
-    // read input
-    ClipperLib::Paths input_subject = Slic3rMultiPoints_to_ClipperPaths(subject);
-    ClipperLib::Paths input_clip    = Slic3rMultiPoints_to_ClipperPaths(clip);
-    
-    // perform safety offset
-    if (safety_offset_) safety_offset(&input_clip);
-    
     // init Clipper
     ClipperLib::Clipper clipper;
     clipper.Clear();
     
-    // add polygons
-    clipper.AddPaths(input_subject, ClipperLib::ptSubject, false);
-    clipper.AddPaths(input_clip,    ClipperLib::ptClip,    true);
+    // add polygons, only the clip polygons to be safety offsetted are copied into ClipperLib::Paths
+    clipper.AddPaths(ClipperUtils::paths_provider(subject), ClipperLib::ptSubject, false);
+    clipper_add_clip_polygons(clipper, clipType, subject, clip, safety_offset_);
     
     // perform operation
     ClipperLib::PolyTree retval;
@@ -773,15 +880,12 @@ ExPolygons simplify_polygons_ex(const Polygons &subject, bool preserve_collinear
     if (! preserve_collinear)
         return union_ex(simplify_polygons(subject, false));
 
-    // convert into Clipper polygons
-    ClipperLib::Paths input_subject = Slic3rMultiPoints_to_ClipperPaths(subject);
-    
     ClipperLib::PolyTree polytree;
     
     ClipperLib::Clipper c;
     c.PreserveCollinear(true);
     c.StrictlySimple(true);
-    c.AddPaths(input_subject, ClipperLib::ptSubject, true);
+    c.AddPaths(ClipperUtils::paths_provider(subject), ClipperLib::ptSubject, true);
     c.Execute(ClipperLib::ctUnion, polytree, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
     
     // convert into ExPolygons
@@ -843,7 +947,7 @@ Polygons top_level_islands(const Slic3r::Polygons &polygons)
     ClipperLib::Clipper clipper;
     clipper.Clear();
     // perform union
-    clipper.AddPaths(Slic3rMultiPoints_to_ClipperPaths(polygons), ClipperLib::ptSubject, true);
+    clipper.AddPaths(ClipperUtils::paths_provider(polygons), ClipperLib::ptSubject, true);
     ClipperLib::PolyTree polytree;
     clipper.Execute(ClipperLib::ctUnion, polytree, ClipperLib::pftEvenOdd, ClipperLib::pftEvenOdd); 
     // Convert only the top level islands to the output.
@@ -4,6 +4,7 @@
 #include "libslic3r.h"
 #include "clipper.hpp"
 #include "ExPolygon.hpp"
+#include "ExPolygonSet.hpp"
 #include "Polygon.hpp"
 #include "Surface.hpp"
 
@@ -31,16 +32,129 @@ namespace Slic3r {
 void AddOuterPolyNodeToExPolygons(ClipperLib::PolyNode& polynode, Slic3r::ExPolygons *expolygons);
 Slic3r::ExPolygons PolyTreeToExPolygons(ClipperLib::PolyTree& polytree);
 //-----------------------------------------------------------
+ExPolygonSet       PolyTreeToExPolygonSet(const ClipperLib::PolyTree &polytree);
 
 ClipperLib::Path   Slic3rMultiPoint_to_ClipperPath(const Slic3r::MultiPoint &input);
 ClipperLib::Paths  Slic3rMultiPoints_to_ClipperPaths(const Polygons &input);
 ClipperLib::Paths  Slic3rMultiPoints_to_ClipperPaths(const ExPolygons &input);
 ClipperLib::Paths  Slic3rMultiPoints_to_ClipperPaths(const Polylines &input);
+ClipperLib::Paths  Slic3rMultiPoints_to_ClipperPaths(const ExPolygonSet &input);
 Slic3r::Polygon    ClipperPath_to_Slic3rPolygon(const ClipperLib::Path &input);
 Slic3r::Polyline   ClipperPath_to_Slic3rPolyline(const ClipperLib::Path &input);
 Slic3r::Polygons   ClipperPaths_to_Slic3rPolygons(const ClipperLib::Paths &input);
 Slic3r::Polylines  ClipperPaths_to_Slic3rPolylines(const ClipperLib::Paths &input);
 Slic3r::ExPolygons ClipperPaths_to_Slic3rExPolygons(const ClipperLib::Paths &input);
+// Union of the paths into expolygons, as ClipperPaths_to_Slic3rExPolygons(), stored in an ExPolygonSet.
+ExPolygonSet       ClipperPaths_to_ExPolygonSet(const ClipperLib::Paths &input);
+
+namespace ClipperUtils {
+    // Adapters presenting Slic3r polygons and polylines to ClipperLib::ClipperBase::AddPath() / AddPaths()
+    // in place of ClipperLib::Path / ClipperLib::Paths. coord_t is 32bit while ClipperLib::cInt is 64bit,
+    // therefore the points are converted one by one while Clipper fills in its edges, saving a copy of the input.
+    class PointsProvider {
+    public:
+        PointsProvider(const Points &points) : m_points(points.data()), m_size(points.size()) {}
+        PointsProvider(const Point *begin, const Point *end) : m_points(begin), m_size(size_t(end - begin)) {}
+        size_t               size() const { return m_size; }
+        ClipperLib::IntPoint operator[](size_t idx) const { const Point &pt = m_points[idx]; return ClipperLib::IntPoint(pt.x(), pt.y()); }
+    private:
+        const Point *m_points;
+        size_t       m_size;
+    };
+
+    template<typename MultiPointType>
+    class MultiPointsProvider {
+    public:
+        MultiPointsProvider(const std::vector<MultiPointType> &multipoints) : m_multipoints(multipoints) {}
+
+        class iterator {
+        public:
+            explicit iterator(typename std::vector<MultiPointType>::const_iterator it) : m_it(it) {}
+            PointsProvider operator*() const { return PointsProvider(m_it->points); }
+            iterator&      operator++() { ++ m_it; return *this; }
+            bool           operator!=(const iterator &rhs) const { return m_it != rhs.m_it; }
+        private:
+            typename std::vector<MultiPointType>::const_iterator m_it;
+        };
+        iterator begin() const { return iterator(m_multipoints.begin()); }
+        iterator end()   const { return iterator(m_multipoints.end()); }
+
+    private:
+        const std::vector<MultiPointType> &m_multipoints;
+    };
+
+    // Subset of polygons or polylines referenced by pointers, for example after culling by a bounding box.
+    template<typename MultiPointType>
+    class MultiPointPtrsProvider {
+    public:
+        MultiPointPtrsProvider(const std::vector<const MultiPointType*> &multipoints) : m_multipoints(multipoints) {}
+
+        class iterator {
+        public:
+            explicit iterator(typename std::vector<const MultiPointType*>::const_iterator it) : m_it(it) {}
+            PointsProvider operator*() const { return PointsProvider((*m_it)->points); }
+            iterator&      operator++() { ++ m_it; return *this; }
+            bool           operator!=(const iterator &rhs) const { return m_it != rhs.m_it; }
+        private:
+            typename std::vector<const MultiPointType*>::const_iterator m_it;
+        };
+        iterator begin() const { return iterator(m_multipoints.begin()); }
+        iterator end()   const { return iterator(m_multipoints.end()); }
+
+    private:
+        const std::vector<const MultiPointType*> &m_multipoints;
+    };
+
+    // Contours and holes of ExPolygons in the same order as produced by Slic3rMultiPoints_to_ClipperPaths(const ExPolygons&).
+    class ExPolygonsProvider {
+    public:
+        ExPolygonsProvider(const ExPolygons &expolygons) : m_expolygons(expolygons) {}
+
+        class iterator {
+        public:
+            explicit iterator(ExPolygons::const_iterator it) : m_it(it), m_idx(0) {}
+            PointsProvider operator*() const { return PointsProvider(m_idx == 0 ? m_it->contour.points : m_it->holes[m_idx - 1].points); }
+            iterator&      operator++() { if (++ m_idx > m_it->holes.size()) { ++ m_it; m_idx = 0; } return *this; }
+            bool           operator!=(const iterator &rhs) const { return m_it != rhs.m_it || m_idx != rhs.m_idx; }
+        private:
+            ExPolygons::const_iterator m_it;
+            // 0 for the contour, 1 + hole index for a hole.
+            size_t                     m_idx;
+        };
+        iterator begin() const { return iterator(m_expolygons.begin()); }
+        iterator end()   const { return iterator(m_expolygons.end()); }
+
+    private:
+        const ExPolygons &m_expolygons;
+    };
+
+    // Contours and holes of an ExPolygonSet, in the same order as of the ExPolygonsProvider.
+    class ExPolygonSetProvider {
+    public:
+        ExPolygonSetProvider(const ExPolygonSet &expolygons) : m_expolygons(expolygons) {}
+
+        class iterator {
+        public:
+            explicit iterator(const ExPolygonSet &expolygons, size_t idx) : m_expolygons(expolygons), m_idx(idx) {}
+            PointsProvider operator*() const { ExPolygonSet::PolygonView polygon = m_expolygons.polygon(m_idx); return PointsProvider(polygon.begin(), polygon.end()); }
+            iterator&      operator++() { ++ m_idx; return *this; }
+            bool           operator!=(const iterator &rhs) const { return m_idx != rhs.m_idx; }
+        private:
+            const ExPolygonSet &m_expolygons;
+            size_t              m_idx;
+        };
+        iterator begin() const { return iterator(m_expolygons, 0); }
+        iterator end()   const { return iterator(m_expolygons, m_expolygons.num_polygons()); }
+
+    private:
+        const ExPolygonSet &m_expolygons;
+    };
+
+    inline MultiPointsProvider<Polygon>  paths_provider(const Polygons &polygons)     { return MultiPointsProvider<Polygon>(polygons); }
+    inline MultiPointsProvider<Polyline> paths_provider(const Polylines &polylines)   { return MultiPointsProvider<Polyline>(polylines); }
+    inline ExPolygonsProvider            paths_provider(const ExPolygons &expolygons) { return ExPolygonsProvider(expolygons); }
+    inline ExPolygonSetProvider          paths_provider(const ExPolygonSet &expolygons) { return ExPolygonSetProvider(expolygons); }
+}
 
 // offset Polygons
 ClipperLib::Paths _offset(ClipperLib::Path &&input, ClipperLib::EndType endType, const float delta, ClipperLib::JoinType joinType, double miterLimit);
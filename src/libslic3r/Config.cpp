@@ -1,5 +1,6 @@
 #include "Config.hpp"
 #include "Utils.hpp"
+#include "GCode/BinaryGCode.hpp"
 #include <assert.h>
 #include <fstream>
 #include <iostream>
@@ -393,6 +394,16 @@ void ConfigBase::apply_only(const ConfigBase &other, const t_config_option_keys
     }
 }
 
+size_t ConfigBase::hash() const
+{
+    size_t seed = 0;
+    for (const t_config_option_key &opt_key : this->keys()) {
+        boost::hash_combine(seed, opt_key);
+        boost::hash_combine(seed, this->option(opt_key)->hash());
+    }
+    return seed;
+}
+
 // this will *ignore* options not present in both configs
 t_config_option_keys ConfigBase::diff(const ConfigBase &other) const
 {
@@ -570,7 +581,7 @@ void ConfigBase::setenv_() const
 
 void ConfigBase::load(const std::string &file)
 {
-    if (boost::iends_with(file, ".gcode") || boost::iends_with(file, ".g"))
+    if (boost::iends_with(file, ".gcode") || boost::iends_with(file, ".g") || boost::iends_with(file, ".bgcode"))
         this->load_from_gcode_file(file);
     else
         this->load_from_ini(file);
@@ -599,6 +610,15 @@ void ConfigBase::load(const boost::property_tree::ptree &tree)
 // Load the config keys from the tail of a G-code file.
 void ConfigBase::load_from_gcode_file(const std::string &file)
 {
+    if (BinaryGCode::is_binary_gcode(file)) {
+        // The binary G-code stores the config keys in its config block. The leading end of line marks the start of the first line.
+        std::string config = "\n" + BinaryGCode::read_config(file);
+        size_t key_value_pairs = load_from_gcode_string(config.c_str());
+        if (key_value_pairs < 80)
+            throw std::runtime_error((boost::format("Suspiciously low number of configuration values extracted from %1%: %2%") % file % key_value_pairs).str());
+        return;
+    }
+
     // Read a 64k block from the end of the G-code.
 	boost::nowide::ifstream ifs(file);
 	{
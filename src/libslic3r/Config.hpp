@@ -8,8 +8,10 @@
 #include <cstdlib>
 #include <functional>
 #include <iostream>
+#include <memory>
 #include <stdexcept>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include "libslic3r.h"
 #include "clonable_ptr.hpp"
@@ -17,6 +19,7 @@
 
 #include <boost/algorithm/string/trim.hpp>
 #include <boost/format.hpp>
+#include <boost/functional/hash.hpp>
 #include <boost/property_tree/ptree.hpp>
 
 #include <cereal/access.hpp>
@@ -133,6 +136,8 @@ public:
     virtual void                setInt(int /* val */) { throw BadOptionTypeException("Calling ConfigOption::setInt on a non-int ConfigOption"); }
     virtual bool                operator==(const ConfigOption &rhs) const = 0;
     bool                        operator!=(const ConfigOption &rhs) const { return ! (*this == rhs); }
+    // Hash of the value. Equal options have equal hashes.
+    virtual size_t              hash()          const = 0;
     bool                        is_scalar()     const { return (int(this->type()) & int(coVectorType)) == 0; }
     bool                        is_vector()     const { return ! this->is_scalar(); }
     // If this option is nullable, then it may have its value or values set to nil.
@@ -157,6 +162,14 @@ public:
 typedef ConfigOption*       ConfigOptionPtr;
 typedef const ConfigOption* ConfigOptionConstPtr;
 
+// Hash of a single value of a ConfigOption.
+template<typename T>
+inline size_t config_value_hash(const T &value) { return std::hash<T>()(value); }
+inline size_t config_value_hash(const Vec2d &value)
+    { size_t seed = 0; boost::hash_combine(seed, value.x()); boost::hash_combine(seed, value.y()); return seed; }
+inline size_t config_value_hash(const Vec3d &value)
+    { size_t seed = 0; boost::hash_combine(seed, value.x()); boost::hash_combine(seed, value.y()); boost::hash_combine(seed, value.z()); return seed; }
+
 // Value of a single valued option (bool, int, float, string, point, enum)
 template <class T>
 class ConfigOptionSingle : public ConfigOption {
@@ -184,6 +197,8 @@ public:
     bool operator==(const T &rhs) const { return this->value == rhs; }
     bool operator!=(const T &rhs) const { return this->value != rhs; }
 
+    size_t hash() const override { return config_value_hash(this->value); }
+
 private:
 	friend class cereal::access;
 	template<class Archive> void serialize(Archive & ar) { ar(this->value); }
@@ -338,6 +353,14 @@ public:
     bool operator==(const std::vector<T> &rhs) const { return this->values == rhs; }
     bool operator!=(const std::vector<T> &rhs) const { return this->values != rhs; }
 
+    size_t hash() const override
+    {
+        size_t seed = 0;
+        for (const T &value : this->values)
+            boost::hash_combine(seed, config_value_hash(value));
+        return seed;
+    }
+
     // Is this option overridden by another option?
     // An option overrides another option if it is not nil and not equal.
     bool overriden_by(const ConfigOption *rhs) const override {
@@ -853,6 +876,8 @@ public:
     }
     bool                        operator==(const ConfigOptionFloatOrPercent &rhs) const 
         { return this->value == rhs.value && this->percent == rhs.percent; }
+    size_t                      hash() const override 
+        { size_t seed = config_value_hash(this->value); boost::hash_combine(seed, this->percent); return seed; }
     double                      get_abs_value(double ratio_over) const 
         { return this->percent ? (ratio_over * this->value / 100) : this->value; }
 
@@ -1574,6 +1599,8 @@ public:
     // or this ConfigBase is of a StaticConfig type and it does not support some of the keys, and ignore_nonexistent is not set.
     void apply_only(const ConfigBase &other, const t_config_option_keys &keys, bool ignore_nonexistent = false);
     bool equals(const ConfigBase &other) const { return this->diff(other).empty(); }
+    // Hash of the option keys and values. Equal configs have equal hashes.
+    size_t hash() const;
     t_config_option_keys diff(const ConfigBase &other) const;
     t_config_option_keys equal(const ConfigBase &other) const;
     std::string opt_serialize(const t_config_option_key &opt_key) const;
@@ -1795,6 +1822,51 @@ private:
 /// Configuration store with a static definition of configuration values.
 /// In Slic3r, the static configuration stores are during the slicing / g-code generation for efficiency reasons,
 /// because the configuration values could be accessed directly.
+// Pool of immutable, reference counted configs. Equal configs pushed into the pool share
+// a single instance, so the owners of the shared instances may compare them by pointer.
+// The configs are hashed by ConfigType::hash() and compared by ConfigType::equals().
+// The pool holds weak references only, a config is released once its last owner releases it.
+// Not thread safe.
+template<class ConfigType>
+class SharedConfigPool
+{
+public:
+    typedef std::shared_ptr<const ConfigType> ConfigPtr;
+
+    // Return the instance equal to config, add config to the pool if there is no such instance.
+    ConfigPtr get(ConfigType &&config)
+    {
+        size_t hash  = config.hash();
+        auto   range = m_configs.equal_range(hash);
+        for (auto it = range.first; it != range.second;)
+            if (ConfigPtr shared = it->second.lock()) {
+                if (shared->equals(config))
+                    return shared;
+                ++ it;
+            } else
+                it = m_configs.erase(it);
+        ConfigPtr shared = std::make_shared<const ConfigType>(std::move(config));
+        m_configs.emplace(hash, shared);
+        return shared;
+    }
+    ConfigPtr get(const ConfigType &config) { return this->get(ConfigType(config)); }
+
+    // Remove the entries of the configs released by all their owners.
+    void release_unused()
+    {
+        for (auto it = m_configs.begin(); it != m_configs.end();)
+            if (it->second.expired())
+                it = m_configs.erase(it);
+            else
+                ++ it;
+    }
+    size_t size() const { return m_configs.size(); }
+    void   clear() { m_configs.clear(); }
+
+private:
+    std::unordered_multimap<size_t, std::weak_ptr<const ConfigType>> m_configs;
+};
+
 class StaticConfig : public virtual ConfigBase
 {
 public:
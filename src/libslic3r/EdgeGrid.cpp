@@ -34,6 +34,7 @@ EdgeGrid::Grid::~Grid()
 {
 	m_contours.clear();
 	m_cell_data.clear();
+	m_cell_segments.clear();
 	m_cells.clear();
 }
 
@@ -319,6 +320,14 @@ void EdgeGrid::Grid::create_from_m_contours(coord_t resolution)
 		for (visitor.j = 0; visitor.j < pts.size(); ++ visitor.j)
 			this->visit_cells_intersecting_line(pts[visitor.j], pts[(visitor.j + 1 == pts.size()) ? 0 : visitor.j + 1], visitor);
 	}
+
+	// 7) Pack the end points of the segments in the order of m_cell_data.
+	m_cell_segments.clear();
+	m_cell_segments.reserve(m_cell_data.size());
+	for (const std::pair<size_t, size_t> &contour_and_segment_idx : m_cell_data) {
+		std::pair<const Slic3r::Point&, const Slic3r::Point&> segment = this->segment(contour_and_segment_idx);
+		m_cell_segments.push_back({ segment.first, segment.second });
+	}
 }
 
 #if 0
@@ -678,11 +687,9 @@ void EdgeGrid::Grid::calculate_sdf()
 			const Cell &cell = m_cells[r * m_cols + c];
 			// For each segment in the cell:
 			for (size_t i = cell.begin; i != cell.end; ++ i) {
-				const Slic3r::Points &pts = *m_contours[m_cell_data[i].first];
-				size_t ipt = m_cell_data[i].second;
 				// End points of the line segment.
-				const Slic3r::Point &p1 = pts[ipt];
-				const Slic3r::Point &p2 = pts[(ipt + 1 == pts.size()) ? 0 : ipt + 1];
+				const Slic3r::Point &p1 = m_cell_segments[i].a;
+				const Slic3r::Point &p2 = m_cell_segments[i].b;
 				// Segment vector
 				const Slic3r::Point v_seg = p2 - p1;
 				// l2 of v_seg
@@ -703,9 +710,12 @@ void EdgeGrid::Grid::calculate_sdf()
 						int64_t t_pt = int64_t(v_seg(0)) * int64_t(v_pt(0)) + int64_t(v_seg(1)) * int64_t(v_pt(1));
 						if (t_pt < 0) {
 							// Closest to p1.
-							double dabs = sqrt(int64_t(v_pt(0)) * int64_t(v_pt(0)) + int64_t(v_pt(1)) * int64_t(v_pt(1)));
-							if (dabs < d_min) {
+							double d2 = double(int64_t(v_pt(0)) * int64_t(v_pt(0)) + int64_t(v_pt(1)) * int64_t(v_pt(1)));
+							if (d2 < double(d_min) * double(d_min)) {
+								double dabs = sqrt(d2);
 								// Previous point.
+								const Slic3r::Points &pts = *m_contours[m_cell_data[i].first];
+								size_t ipt = m_cell_data[i].second;
 								const Slic3r::Point &p0 = pts[(ipt == 0) ? (pts.size() - 1) : ipt - 1];
 								Slic3r::Point v_seg_prev = p1 - p0;
 								int64_t t2_pt = int64_t(v_seg_prev(0)) * int64_t(v_pt(0)) + int64_t(v_seg_prev(1)) * int64_t(v_pt(1));
@@ -1081,11 +1091,10 @@ EdgeGrid::Grid::ClosestPointResult EdgeGrid::Grid::closest_point(const Point &pt
 			const Cell &cell = m_cells[r * m_cols + c];
 			for (size_t i = cell.begin; i < cell.end; ++ i) {
 				const size_t          contour_idx = m_cell_data[i].first;
-				const Slic3r::Points &pts         = *m_contours[contour_idx];
 				size_t ipt = m_cell_data[i].second;
 				// End points of the line segment.
-				const Slic3r::Point &p1 = pts[ipt];
-				const Slic3r::Point &p2 = pts[(ipt + 1 == pts.size()) ? 0 : ipt + 1];
+				const Slic3r::Point &p1 = m_cell_segments[i].a;
+				const Slic3r::Point &p2 = m_cell_segments[i].b;
 				const Slic3r::Point v_seg = p2 - p1;
 				const Slic3r::Point v_pt  = pt - p1;
 				// dot(p2-p1, pt-p1)
@@ -1094,10 +1103,12 @@ EdgeGrid::Grid::ClosestPointResult EdgeGrid::Grid::closest_point(const Point &pt
 				int64_t l2_seg = int64_t(v_seg(0)) * int64_t(v_seg(0)) + int64_t(v_seg(1)) * int64_t(v_seg(1));
 				if (t_pt < 0) {
 					// Closest to p1.
-					double dabs = sqrt(int64_t(v_pt(0)) * int64_t(v_pt(0)) + int64_t(v_pt(1)) * int64_t(v_pt(1)));
-					if (dabs < d_min) {
+					double d2 = double(int64_t(v_pt(0)) * int64_t(v_pt(0)) + int64_t(v_pt(1)) * int64_t(v_pt(1)));
+					if (d2 < d_min * d_min) {
+						double dabs = sqrt(d2);
 						// Previous point.
-						const Slic3r::Point &p0 = pts[(ipt == 0) ? (pts.size() - 1) : ipt - 1];
+						const Slic3r::Points &pts = *m_contours[contour_idx];
+						const Slic3r::Point  &p0  = pts[(ipt == 0) ? (pts.size() - 1) : ipt - 1];
 						Slic3r::Point v_seg_prev = p1 - p0;
 						int64_t t2_pt = int64_t(v_seg_prev(0)) * int64_t(v_pt(0)) + int64_t(v_seg_prev(1)) * int64_t(v_pt(1));
 						if (t2_pt > 0) {
@@ -1209,11 +1220,9 @@ bool EdgeGrid::Grid::signed_distance_edges(const Point &pt, coord_t search_radiu
 		for (int c = bbox.min(0); c <= bbox.max(0); ++ c) {
 			const Cell &cell = m_cells[r * m_cols + c];
 			for (size_t i = cell.begin; i < cell.end; ++ i) {
-				const Slic3r::Points &pts = *m_contours[m_cell_data[i].first];
-				size_t ipt = m_cell_data[i].second;
 				// End points of the line segment.
-				const Slic3r::Point &p1 = pts[ipt];
-				const Slic3r::Point &p2 = pts[(ipt + 1 == pts.size()) ? 0 : ipt + 1];
+				const Slic3r::Point &p1 = m_cell_segments[i].a;
+				const Slic3r::Point &p2 = m_cell_segments[i].b;
 				Slic3r::Point v_seg = p2 - p1;
 				Slic3r::Point v_pt  = pt - p1;
 				// dot(p2-p1, pt-p1)
@@ -1222,9 +1231,12 @@ bool EdgeGrid::Grid::signed_distance_edges(const Point &pt, coord_t search_radiu
 				int64_t l2_seg = int64_t(v_seg(0)) * int64_t(v_seg(0)) + int64_t(v_seg(1)) * int64_t(v_seg(1));
 				if (t_pt < 0) {
 					// Closest to p1.
-					double dabs = sqrt(int64_t(v_pt(0)) * int64_t(v_pt(0)) + int64_t(v_pt(1)) * int64_t(v_pt(1)));
-					if (dabs < d_min) {
+					double d2 = double(int64_t(v_pt(0)) * int64_t(v_pt(0)) + int64_t(v_pt(1)) * int64_t(v_pt(1)));
+					if (d2 < d_min * d_min) {
+						double dabs = sqrt(d2);
 						// Previous point.
+						const Slic3r::Points &pts = *m_contours[m_cell_data[i].first];
+						size_t ipt = m_cell_data[i].second;
 						const Slic3r::Point &p0 = pts[(ipt == 0) ? (pts.size() - 1) : ipt - 1];
 						Slic3r::Point v_seg_prev = p1 - p0;
 						int64_t t2_pt = int64_t(v_seg_prev(0)) * int64_t(v_pt(0)) + int64_t(v_seg_prev(1)) * int64_t(v_pt(1));
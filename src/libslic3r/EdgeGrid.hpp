@@ -234,6 +234,20 @@ public:
 		return std::make_pair(m_cell_data.begin() + cell.begin, m_cell_data.begin() + cell.end);
 	}
 
+	// End points of a segment referenced by the cell data, packed next to the other segments of the same cell,
+	// so that the distance queries read the segments of a cell sequentially instead of through m_contours.
+	struct CellSegment {
+		Slic3r::Point a;
+		Slic3r::Point b;
+	};
+
+	// The same range as cell_data_range(row, col), pointing to the packed end points of the segments.
+	std::pair<const CellSegment*, const CellSegment*> cell_segments_range(coord_t row, coord_t col) const
+	{
+		const EdgeGrid::Grid::Cell &cell = m_cells[row * m_cols + col];
+		return std::make_pair(m_cell_segments.data() + cell.begin, m_cell_segments.data() + cell.end);
+	}
+
 	std::pair<const Slic3r::Point&, const Slic3r::Point&> segment(const std::pair<size_t, size_t> &contour_and_segment_idx) const
 	{
 		const Slic3r::Points &ipts = *m_contours[contour_and_segment_idx.first];
@@ -279,6 +293,8 @@ protected:
 
 	// Referencing a contour and a line segment of m_contours.
 	std::vector<std::pair<size_t, size_t> >		m_cell_data;
+	// End points of the segments referenced by m_cell_data.
+	std::vector<CellSegment>					m_cell_segments;
 
 	// Full grid of cells.
 	std::vector<Cell> 							m_cells;
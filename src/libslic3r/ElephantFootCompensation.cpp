@@ -12,6 +12,9 @@
 
 #include <cmath>
 #include <cassert>
+#include <unordered_map>
+
+#include <tbb/parallel_for.h>
 
 // #define CONTOUR_DISTANCE_DEBUG_SVG
 
@@ -263,15 +266,15 @@ std::vector<float> contour_distance2(const EdgeGrid::Grid &grid, const size_t id
 			bool operator()(coord_t iy, coord_t ix) {
 				// Called with a row and colum of the grid cell, which is intersected by a line.
 				auto cell_data_range = this->grid.cell_data_range(iy, ix);
-				for (auto it_contour_and_segment = cell_data_range.first; it_contour_and_segment != cell_data_range.second; ++ it_contour_and_segment) {
+				const EdgeGrid::Grid::CellSegment *segment = this->grid.cell_segments_range(iy, ix).first;
+				for (auto it_contour_and_segment = cell_data_range.first; it_contour_and_segment != cell_data_range.second; ++ it_contour_and_segment, ++ segment) {
 					// End points of the line segment and their vector.
-					std::pair<const Point&, const Point&> segment = this->grid.segment(*it_contour_and_segment);
-				    const Vec2d   v  = (segment.second - segment.first).cast<double>();
-				    const Vec2d   va = (this->point - segment.first).cast<double>();
+				    const Vec2d   v  = (segment->b - segment->a).cast<double>();
+				    const Vec2d   va = (this->point - segment->a).cast<double>();
 				    const double  l2 = v.squaredNorm();  // avoid a sqrt
 				    const double  t  = (l2 == 0.0) ? 0. : clamp(0., 1., va.dot(v) / l2);
 				    // Closest point from this->point to the segment.
-				    const Vec2d   foot = segment.first.cast<double>() + t * v;
+				    const Vec2d   foot = segment->a.cast<double>() + t * v;
 					const Vec2d   bisector = foot - this->point.cast<double>();
 					const double  dist = bisector.norm();
 				    if ((! this->found || dist < this->distance) && this->dir_inside.dot(bisector) > 0) {
@@ -597,12 +600,89 @@ ExPolygon elephant_foot_compensation(const ExPolygon &input_expoly, const Flow &
 	return out;
 }
 
+// Hash of an island invariant to its translation.
+static size_t expolygon_shape_hash(const ExPolygon &expoly)
+{
+	const Point origin = expoly.contour.points.front();
+	size_t hash = expoly.holes.size();
+	auto hash_polygon = [&hash, &origin](const Polygon &poly) {
+		hash = hash * 31 + poly.points.size();
+		for (const Point &pt : poly.points)
+			hash = (hash * 31 + size_t(pt.x() - origin.x())) * 31 + size_t(pt.y() - origin.y());
+	};
+	hash_polygon(expoly.contour);
+	for (const Polygon &hole : expoly.holes)
+		hash_polygon(hole);
+	return hash;
+}
+
+// Is the island b a translated copy of the island a, with the same order of holes and of their points?
+static bool expolygon_shape_equal(const ExPolygon &a, const ExPolygon &b)
+{
+	if (a.holes.size() != b.holes.size())
+		return false;
+	const Point shift = b.contour.points.front() - a.contour.points.front();
+	auto polygon_equal = [&shift](const Polygon &pa, const Polygon &pb) {
+		if (pa.points.size() != pb.points.size())
+			return false;
+		for (size_t i = 0; i < pa.points.size(); ++ i)
+			if (pa.points[i] + shift != pb.points[i])
+				return false;
+		return true;
+	};
+	if (! polygon_equal(a.contour, b.contour))
+		return false;
+	for (size_t i = 0; i < a.holes.size(); ++ i)
+		if (! polygon_equal(a.holes[i], b.holes[i]))
+			return false;
+	return true;
+}
+
 ExPolygons elephant_foot_compensation(const ExPolygons &input, const Flow &external_perimeter_flow, const double compensation)
 {
-	ExPolygons out;
-	out.reserve(input.size());
-	for (const ExPolygon &expoly : input)
-		out.emplace_back(elephant_foot_compensation(expoly, external_perimeter_flow, compensation));
+	// The compensation is invariant to translation. The first layers of multiple instances or of many identical parts
+	// contain a lot of islands of the same shape, compensate just one of each set of the identical islands
+	// and translate the result to the other islands.
+	// idx_source[i] is the index of the first island of the same shape as the i-th island.
+	std::vector<size_t> idx_source(input.size());
+	std::vector<size_t> unique_islands;
+	{
+		std::unordered_multimap<size_t, size_t> map_hash_to_island;
+		map_hash_to_island.reserve(input.size());
+		for (size_t i = 0; i < input.size(); ++ i) {
+			const ExPolygon &expoly = input[i];
+			idx_source[i] = i;
+			if (expoly.contour.points.empty()) {
+				unique_islands.emplace_back(i);
+				continue;
+			}
+			size_t hash = expolygon_shape_hash(expoly);
+			auto   range = map_hash_to_island.equal_range(hash);
+			for (auto it = range.first; it != range.second; ++ it)
+				if (expolygon_shape_equal(input[it->second], expoly)) {
+					idx_source[i] = it->second;
+					break;
+				}
+			if (idx_source[i] == i) {
+				map_hash_to_island.emplace(hash, i);
+				unique_islands.emplace_back(i);
+			}
+		}
+	}
+
+	ExPolygons out(input.size());
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, unique_islands.size()),
+		[&input, &unique_islands, &out, &external_perimeter_flow, compensation](const tbb::blocked_range<size_t> &range) {
+		for (size_t i = range.begin(); i < range.end(); ++ i) {
+			size_t idx = unique_islands[i];
+			out[idx] = elephant_foot_compensation(input[idx], external_perimeter_flow, compensation);
+		}
+	});
+	for (size_t i = 0; i < input.size(); ++ i)
+		if (size_t src = idx_source[i]; src != i) {
+			out[i] = out[src];
+			out[i].translate(input[i].contour.points.front() - input[src].contour.points.front());
+		}
 	return out;
 }
 
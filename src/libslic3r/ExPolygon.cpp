@@ -48,6 +48,13 @@ void ExPolygon::translate(double x, double y)
         hole.translate(x, y);
 }
 
+void ExPolygon::translate(const Point &vector)
+{
+    contour.translate(vector);
+    for (Polygon &hole : holes)
+        hole.translate(vector);
+}
+
 void ExPolygon::rotate(double angle)
 {
     contour.rotate(angle);
@@ -79,6 +86,19 @@ bool ExPolygon::is_valid() const
     return true;
 }
 
+// Are all the points inside the bounding box of the contour? If not, the polylines of the points leave the contour,
+// which is much cheaper to find out than by clipping the polylines.
+static bool contour_bbox_contains(const Polygon &contour, const Points &points)
+{
+    if (contour.points.empty())
+        return points.empty();
+    BoundingBox bbox(contour.points);
+    for (const Point &pt : points)
+        if (! bbox.contains(pt))
+            return false;
+    return true;
+}
+
 bool ExPolygon::contains(const Line &line) const
 {
     return this->contains(Polyline(line.a, line.b));
@@ -86,7 +106,7 @@ bool ExPolygon::contains(const Line &line) const
 
 bool ExPolygon::contains(const Polyline &polyline) const
 {
-    return diff_pl((Polylines)polyline, *this).empty();
+    return contour_bbox_contains(this->contour, polyline.points) && diff_pl((Polylines)polyline, *this).empty();
 }
 
 bool ExPolygon::contains(const Polylines &polylines) const
@@ -99,6 +119,9 @@ bool ExPolygon::contains(const Polylines &polylines) const
     svg.draw_outline(*this);
     svg.draw(polylines, "blue");
     #endif
+    for (const Polyline &polyline : polylines)
+        if (! contour_bbox_contains(this->contour, polyline.points))
+            return false;
     Polylines pl_out = diff_pl(polylines, *this);
     #if 0
     svg.draw(pl_out, "red");
@@ -143,6 +166,9 @@ ExPolygon::overlaps(const ExPolygon &other) const
     svg.draw_outline(*this);
     svg.draw_outline(other, "blue");
     #endif
+    // Disjoint bounding boxes, thus disjoint expolygons.
+    if (this->contour.points.empty() || other.contour.points.empty() || ! BoundingBox(this->contour.points).overlap(BoundingBox(other.contour.points)))
+        return false;
     Polylines pl_out = intersection_pl((Polylines)other, *this);
     #if 0
     svg.draw(pl_out, "red");
@@ -162,21 +188,20 @@ Polygons ExPolygon::simplify_p(double tolerance) const
 {
     Polygons pp;
     pp.reserve(this->holes.size() + 1);
+    auto simplify = [&pp, tolerance](const Polygon &polygon) {
+        pp.emplace_back();
+        Points &points = pp.back().points;
+        points.reserve(polygon.points.size() + 1);
+        points = polygon.points;
+        points.push_back(points.front());
+        MultiPoint::douglas_peucker(points, tolerance);
+        points.pop_back();
+    };
     // contour
-    {
-        Polygon p = this->contour;
-        p.points.push_back(p.points.front());
-        p.points = MultiPoint::_douglas_peucker(p.points, tolerance);
-        p.points.pop_back();
-        pp.emplace_back(std::move(p));
-    }
+    simplify(this->contour);
     // holes
-    for (Polygon p : this->holes) {
-        p.points.push_back(p.points.front());
-        p.points = MultiPoint::_douglas_peucker(p.points, tolerance);
-        p.points.pop_back();
-        pp.emplace_back(std::move(p));
-    }
+    for (const Polygon &hole : this->holes)
+        simplify(hole);
     return simplify_polygons(pp);
 }
 
@@ -43,11 +43,14 @@ public:
     void clear() { contour.points.clear(); holes.clear(); }
     void scale(double factor);
     void translate(double x, double y);
+    void translate(const Point &vector);
     void rotate(double angle);
     void rotate(double angle, const Point &center);
     double area() const;
     bool empty() const { return contour.points.empty(); }
     bool is_valid() const;
+    // Heap memory allocated by the contour and the holes in bytes, including the unused capacity.
+    size_t memsize() const { return this->contour.memsize() + Slic3r::memsize(this->holes); }
 
     // Contains the line / polyline / polylines etc COMPLETELY.
     bool contains(const Line &line) const;
@@ -89,6 +92,15 @@ inline bool operator!=(const ExPolygon &lhs, const ExPolygon &rhs) { return lhs.
 
 // Count a nuber of polygons stored inside the vector of expolygons.
 // Useful for allocating space for polygons when converting expolygons to polygons.
+// Heap memory allocated by the expolygons in bytes, including the unused capacity.
+inline size_t memsize(const ExPolygons &expolys)
+{
+    size_t n = expolys.capacity() * sizeof(ExPolygon);
+    for (const ExPolygon &expoly : expolys)
+        n += expoly.memsize();
+    return n;
+}
+
 inline size_t number_polygons(const ExPolygons &expolys)
 {
     size_t n_polygons = 0;
@@ -303,9 +315,9 @@ inline void expolygons_rotate(ExPolygons &expolys, double angle)
         p->rotate(angle);
 }
 
-inline bool expolygons_contain(ExPolygons &expolys, const Point &pt)
+inline bool expolygons_contain(const ExPolygons &expolys, const Point &pt)
 {
-    for (ExPolygons::iterator p = expolys.begin(); p != expolys.end(); ++p)
+    for (ExPolygons::const_iterator p = expolys.begin(); p != expolys.end(); ++p)
         if (p->contains(pt))
             return true;
     return false;
@@ -0,0 +1,118 @@
+#include "ExPolygonSet.hpp"
+
+namespace Slic3r {
+
+double ExPolygonSet::PolygonView::area() const
+{
+    size_t n = this->size();
+    if (n < 3)
+        return 0.;
+    double a = 0.;
+    for (size_t i = 0, j = n - 1; i < n; j = i ++)
+        a += (double(m_begin[j].x()) + double(m_begin[i].x())) * (double(m_begin[i].y()) - double(m_begin[j].y()));
+    return 0.5 * a;
+}
+
+double ExPolygonSet::ExPolygonView::area() const
+{
+    double a = this->contour().area();
+    for (size_t i = 0; i < this->num_holes(); ++ i)
+        a -= - this->hole(i).area();  // holes have negative area
+    return a;
+}
+
+ExPolygon ExPolygonSet::ExPolygonView::to_expolygon() const
+{
+    ExPolygon out;
+    PolygonView contour = this->contour();
+    out.contour.points.assign(contour.begin(), contour.end());
+    out.holes.reserve(this->num_holes());
+    for (size_t i = 0; i < this->num_holes(); ++ i) {
+        PolygonView hole = this->hole(i);
+        out.holes.emplace_back(Points(hole.begin(), hole.end()));
+    }
+    return out;
+}
+
+void ExPolygonSet::clear()
+{
+    m_points.clear();
+    m_polygon_offsets.assign(1, 0);
+    m_expolygon_offsets.assign(1, 0);
+}
+
+void ExPolygonSet::reserve(size_t num_expolygons, size_t num_polygons, size_t num_points)
+{
+    m_points.reserve(num_points);
+    m_polygon_offsets.reserve(num_polygons + 1);
+    m_expolygon_offsets.reserve(num_expolygons + 1);
+}
+
+void ExPolygonSet::add_contour(const Point *begin, const Point *end)
+{
+    m_points.insert(m_points.end(), begin, end);
+    m_polygon_offsets.emplace_back(m_points.size());
+    m_expolygon_offsets.emplace_back(this->num_polygons());
+}
+
+void ExPolygonSet::add_hole(const Point *begin, const Point *end)
+{
+    assert(! this->empty());
+    m_points.insert(m_points.end(), begin, end);
+    m_polygon_offsets.emplace_back(m_points.size());
+    ++ m_expolygon_offsets.back();
+}
+
+void ExPolygonSet::append(const ExPolygon &expolygon)
+{
+    this->add_contour(expolygon.contour.points);
+    for (const Polygon &hole : expolygon.holes)
+        this->add_hole(hole.points);
+}
+
+void ExPolygonSet::append(const ExPolygons &expolygons)
+{
+    size_t num_polygons = 0;
+    size_t num_points   = 0;
+    for (const ExPolygon &expolygon : expolygons) {
+        num_polygons += 1 + expolygon.holes.size();
+        num_points   += expolygon.contour.points.size();
+        for (const Polygon &hole : expolygon.holes)
+            num_points += hole.points.size();
+    }
+    this->reserve(this->size() + expolygons.size(), this->num_polygons() + num_polygons, m_points.size() + num_points);
+    for (const ExPolygon &expolygon : expolygons)
+        this->append(expolygon);
+}
+
+void ExPolygonSet::append(const ExPolygonView &expolygon)
+{
+    PolygonView contour = expolygon.contour();
+    this->add_contour(contour.begin(), contour.end());
+    for (size_t i = 0; i < expolygon.num_holes(); ++ i) {
+        PolygonView hole = expolygon.hole(i);
+        this->add_hole(hole.begin(), hole.end());
+    }
+}
+
+ExPolygons ExPolygonSet::to_expolygons() const
+{
+    ExPolygons out;
+    out.reserve(this->size());
+    for (ExPolygonView expolygon : *this)
+        out.emplace_back(expolygon.to_expolygon());
+    return out;
+}
+
+Polygons ExPolygonSet::to_polygons() const
+{
+    Polygons out;
+    out.reserve(this->num_polygons());
+    for (size_t i = 0; i < this->num_polygons(); ++ i) {
+        PolygonView polygon = this->polygon(i);
+        out.emplace_back(Points(polygon.begin(), polygon.end()));
+    }
+    return out;
+}
+
+} // namespace Slic3r
@@ -0,0 +1,122 @@
+#ifndef slic3r_ExPolygonSet_hpp_
+#define slic3r_ExPolygonSet_hpp_
+
+#include "libslic3r.h"
+#include "ExPolygon.hpp"
+
+#include <vector>
+
+namespace Slic3r {
+
+// ExPolygons stored in flat arrays: The points of all the contours and holes are stored in a single buffer,
+// a polygon is a range of the points, an expolygon is a range of the polygons starting with its contour.
+// ExPolygons allocate a vector of points for each polygon and a vector of holes for each expolygon,
+// while an ExPolygonSet is built with a few allocations and it is traversed without chasing pointers.
+// Its polygons are fed to Clipper directly, see ClipperUtils::paths_provider(const ExPolygonSet&).
+class ExPolygonSet
+{
+public:
+    // View of a polygon of an ExPolygonSet, valid until the set is modified.
+    class PolygonView
+    {
+    public:
+        PolygonView(const Point *begin, const Point *end) : m_begin(begin), m_end(end) {}
+
+        const Point*    begin() const { return m_begin; }
+        const Point*    end()   const { return m_end; }
+        size_t          size()  const { return size_t(m_end - m_begin); }
+        bool            empty() const { return m_begin == m_end; }
+        const Point&    operator[](size_t idx) const { return m_begin[idx]; }
+        // Signed area, positive for a counter-clockwise polygon.
+        double          area() const;
+        Polygon         to_polygon() const { return Polygon(Points(m_begin, m_end)); }
+
+    private:
+        const Point    *m_begin;
+        const Point    *m_end;
+    };
+
+    // View of an expolygon of an ExPolygonSet, valid until the set is modified.
+    class ExPolygonView
+    {
+    public:
+        ExPolygonView(const ExPolygonSet &set, size_t idx) : m_set(&set), m_idx(idx) {}
+
+        PolygonView     contour()   const { return m_set->polygon(m_set->m_expolygon_offsets[m_idx]); }
+        size_t          num_holes() const { return m_set->m_expolygon_offsets[m_idx + 1] - m_set->m_expolygon_offsets[m_idx] - 1; }
+        PolygonView     hole(size_t idx) const { return m_set->polygon(m_set->m_expolygon_offsets[m_idx] + 1 + idx); }
+        // Area of the contour minus the area of the holes.
+        double          area() const;
+        ExPolygon       to_expolygon() const;
+
+    private:
+        const ExPolygonSet *m_set;
+        size_t              m_idx;
+    };
+
+    class const_iterator
+    {
+    public:
+        const_iterator(const ExPolygonSet &set, size_t idx) : m_set(&set), m_idx(idx) {}
+        ExPolygonView   operator*() const { return ExPolygonView(*m_set, m_idx); }
+        const_iterator& operator++() { ++ m_idx; return *this; }
+        bool            operator==(const const_iterator &rhs) const { return m_idx == rhs.m_idx; }
+        bool            operator!=(const const_iterator &rhs) const { return m_idx != rhs.m_idx; }
+    private:
+        const ExPolygonSet *m_set;
+        size_t              m_idx;
+    };
+
+    ExPolygonSet() : m_polygon_offsets(1, 0), m_expolygon_offsets(1, 0) {}
+    explicit ExPolygonSet(const ExPolygons &expolygons) : ExPolygonSet() { this->append(expolygons); }
+
+    // Number of expolygons.
+    size_t          size()         const { return m_expolygon_offsets.size() - 1; }
+    bool            empty()        const { return m_expolygon_offsets.size() == 1; }
+    // Number of contours and holes.
+    size_t          num_polygons() const { return m_polygon_offsets.size() - 1; }
+    const Points&   points()       const { return m_points; }
+
+    ExPolygonView   operator[](size_t idx) const { return ExPolygonView(*this, idx); }
+    const_iterator  begin() const { return const_iterator(*this, 0); }
+    const_iterator  end()   const { return const_iterator(*this, this->size()); }
+    // Contours and holes in the order of the expolygons, each contour followed by its holes.
+    PolygonView     polygon(size_t idx) const
+        { return PolygonView(m_points.data() + m_polygon_offsets[idx], m_points.data() + m_polygon_offsets[idx + 1]); }
+
+    void            clear();
+    void            reserve(size_t num_expolygons, size_t num_polygons, size_t num_points);
+
+    // Start a new expolygon with its contour.
+    void            add_contour(const Point *begin, const Point *end);
+    void            add_contour(const Points &contour) { this->add_contour(contour.data(), contour.data() + contour.size()); }
+    // Add a hole to the last expolygon.
+    void            add_hole(const Point *begin, const Point *end);
+    void            add_hole(const Points &hole) { this->add_hole(hole.data(), hole.data() + hole.size()); }
+
+    void            append(const ExPolygon &expolygon);
+    void            append(const ExPolygons &expolygons);
+    void            append(const ExPolygonView &expolygon);
+
+    ExPolygons      to_expolygons() const;
+    // Contours and holes of all the expolygons.
+    Polygons        to_polygons() const;
+
+    // Heap memory allocated by the set in bytes, including the unused capacity.
+    size_t          memsize() const
+        { return m_points.capacity() * sizeof(Point) + (m_polygon_offsets.capacity() + m_expolygon_offsets.capacity()) * sizeof(size_t); }
+
+private:
+    Points              m_points;
+    // Index of the first point of each polygon, terminated by the number of points.
+    std::vector<size_t> m_polygon_offsets;
+    // Index of the contour of each expolygon into m_polygon_offsets, terminated by the number of polygons.
+    std::vector<size_t> m_expolygon_offsets;
+};
+
+inline ExPolygons to_expolygons(const ExPolygonSet &src) { return src.to_expolygons(); }
+inline Polygons   to_polygons(const ExPolygonSet &src)   { return src.to_polygons(); }
+
+} // namespace Slic3r
+
+#endif /* slic3r_ExPolygonSet_hpp_ */
@@ -48,6 +48,25 @@ public:
     double retract_length_toolchange() const;
     double retract_restart_extra_toolchange() const;
 
+    // State of the extruder axis and of the retraction, see GCodeWriter::State.
+    struct State {
+        unsigned int id;
+        double       E;
+        double       absolute_E;
+        double       retracted;
+        double       restart_extra;
+        bool operator==(const State &rhs) const
+            { return id == rhs.id && E == rhs.E && absolute_E == rhs.absolute_E && retracted == rhs.retracted && restart_extra == rhs.restart_extra; }
+    };
+    State  state() const { return { m_id, m_E, m_absolute_E, m_retracted, m_restart_extra }; }
+    void   set_state(const State &state) {
+        assert(state.id == m_id);
+        m_E             = state.E;
+        m_absolute_E    = state.absolute_E;
+        m_retracted     = state.retracted;
+        m_restart_extra = state.restart_extra;
+    }
+
 private:
     // Private constructor to create a key for a search in std::set.
     Extruder(unsigned int id) : m_id(id) {}
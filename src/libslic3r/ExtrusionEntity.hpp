@@ -101,6 +101,12 @@ public:
     virtual Polylines as_polylines() const { Polylines dst; this->collect_polylines(dst); return dst; }
     virtual double length() const = 0;
     virtual double total_volume() const = 0;
+    // Release the unused capacity of the containers. Called once the extrusions are final
+    // to reduce the memory footprint of a large print held in memory until the G-code export.
+    virtual void shrink_to_fit() = 0;
+    // Memory footprint in bytes: the entity itself and the heap memory it owns, including the unused capacity.
+    // Entities are mostly heap allocated and held by pointers in an ExtrusionEntityCollection.
+    virtual size_t memsize() const = 0;
 
     static std::string role_to_string(ExtrusionRole role);
 };
@@ -163,6 +169,8 @@ public:
     Polyline as_polyline() const override { return this->polyline; }
     void   collect_polylines(Polylines &dst) const override { if (! this->polyline.empty()) dst.emplace_back(this->polyline); }
     double total_volume() const override { return mm3_per_mm * unscale<double>(length()); }
+    void shrink_to_fit() override { this->polyline.points.shrink_to_fit(); }
+    size_t memsize() const override { return sizeof(*this) + this->polyline.memsize(); }
 
 private:
     void _inflate_collection(const Polylines &polylines, ExtrusionEntityCollection* collection) const;
@@ -172,6 +180,15 @@ private:
 
 typedef std::vector<ExtrusionPath> ExtrusionPaths;
 
+// Heap memory allocated by the paths in bytes, including the unused capacity.
+inline size_t extrusion_paths_memsize(const ExtrusionPaths &paths)
+{
+    size_t n = sizeof(ExtrusionPath) * (paths.capacity() - paths.size());
+    for (const ExtrusionPath &path : paths)
+        n += path.memsize();
+    return n;
+}
+
 // Single continuous extrusion path, possibly with varying extrusion thickness, extrusion height or bridging / non bridging.
 class ExtrusionMultiPath : public ExtrusionEntity
 {
@@ -213,6 +230,8 @@ public:
     Polyline as_polyline() const override;
     void   collect_polylines(Polylines &dst) const override { Polyline pl = this->as_polyline(); if (! pl.empty()) dst.emplace_back(std::move(pl)); }
     double total_volume() const override { double volume =0.; for (const auto& path : paths) volume += path.total_volume(); return volume; }
+    void shrink_to_fit() override { for (ExtrusionPath &path : this->paths) path.shrink_to_fit(); this->paths.shrink_to_fit(); }
+    size_t memsize() const override { return sizeof(*this) + extrusion_paths_memsize(this->paths); }
 };
 
 // Single continuous extrusion loop, possibly with varying extrusion thickness, extrusion height or bridging / non bridging.
@@ -264,6 +283,8 @@ public:
     Polyline as_polyline() const override { return this->polygon().split_at_first_point(); }
     void   collect_polylines(Polylines &dst) const override { Polyline pl = this->as_polyline(); if (! pl.empty()) dst.emplace_back(std::move(pl)); }
     double total_volume() const override { double volume =0.; for (const auto& path : paths) volume += path.total_volume(); return volume; }
+    void shrink_to_fit() override { for (ExtrusionPath &path : this->paths) path.shrink_to_fit(); this->paths.shrink_to_fit(); }
+    size_t memsize() const override { return sizeof(*this) + extrusion_paths_memsize(this->paths); }
 
     //static inline std::string role_to_string(ExtrusionLoopRole role);
 
@@ -15,14 +15,15 @@ void filter_by_extrusion_role_in_place(ExtrusionEntitiesPtr &extrusion_entities,
 		while (first != last) {
 		    // The caller wants only paths with a specific extrusion role.
 		    auto role2 = (*first)->role();
-		    if (role != role2) {
-		        // This extrusion entity does not match the role asked.
+		    if (role == role2) {
+		        // This extrusion entity matches the role asked.
 		        assert(role2 != erMixed);
 		        *result = *first;
 	  			++ result;
 		    }
 			++ first;
 		}
+		extrusion_entities.erase(result, last);
 	}
 }
 
@@ -106,6 +107,37 @@ ExtrusionEntityCollection ExtrusionEntityCollection::chained_path_from(const Ext
     return out;
 }
 
+std::vector<std::pair<size_t, bool>> ExtrusionEntityCollection::chained_path_order(const ExtrusionEntitiesPtr &extrusion_entities, const Point &start_near, ExtrusionRole role)
+{
+	if (role == erMixed)
+		return chain_extrusion_entities(extrusion_entities, &start_near);
+	// Chain the entities matching the role, map the chain back to the indices of extrusion_entities.
+	std::vector<size_t>  indices;
+	ExtrusionEntitiesPtr filtered;
+	for (size_t i = 0; i < extrusion_entities.size(); ++ i)
+		if (extrusion_entities[i]->role() == role) {
+			indices.emplace_back(i);
+			filtered.emplace_back(extrusion_entities[i]);
+		}
+	std::vector<std::pair<size_t, bool>> out = chain_extrusion_entities(filtered, &start_near);
+	for (std::pair<size_t, bool> &idx : out)
+		idx.first = indices[idx.first];
+	return out;
+}
+
+std::vector<std::pair<size_t, bool>> ExtrusionEntityCollection::chained_path_order(const Point &start_near, ExtrusionRole role) const
+{
+	if (! this->no_sort)
+		return chained_path_order(this->entities, start_near, role);
+	// Keep the order, do not reverse.
+	std::vector<std::pair<size_t, bool>> out;
+	out.reserve(this->entities.size());
+	for (size_t i = 0; i < this->entities.size(); ++ i)
+		if (role == erMixed || this->entities[i]->role() == role)
+			out.emplace_back(i, false);
+	return out;
+}
+
 void ExtrusionEntityCollection::polygons_covered_by_width(Polygons &out, const float scaled_epsilon) const
 {
     for (const ExtrusionEntity *entity : this->entities)
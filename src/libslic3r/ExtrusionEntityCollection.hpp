@@ -83,6 +83,12 @@ public:
     static ExtrusionEntityCollection chained_path_from(const ExtrusionEntitiesPtr &extrusion_entities, const Point &start_near, ExtrusionRole role = erMixed);
     ExtrusionEntityCollection chained_path_from(const Point &start_near, ExtrusionRole role = erMixed) const 
     	{ return this->no_sort ? *this : chained_path_from(this->entities, start_near, role); }
+    // Same ordering as chained_path_from(), but neither cloning nor modifying the extrusion entities:
+    // Returns indices into extrusion_entities of the entities matching role in the order to be extruded,
+    // paired with a flag whether the entity shall be extruded reversed.
+    static std::vector<std::pair<size_t, bool>> chained_path_order(const ExtrusionEntitiesPtr &extrusion_entities, const Point &start_near, ExtrusionRole role = erMixed);
+    // Entities of a no_sort collection are returned in their original order, none of them reversed.
+    std::vector<std::pair<size_t, bool>> chained_path_order(const Point &start_near, ExtrusionRole role = erMixed) const;
     void reverse();
     const Point& first_point() const { return this->entities.front()->first_point(); }
     const Point& last_point() const { return this->entities.back()->last_point(); }
@@ -104,6 +110,13 @@ public:
     ExtrusionEntityCollection flatten(bool preserve_ordering = false) const;
     double min_mm3_per_mm() const;
     double total_volume() const override { double volume=0.; for (const auto& ent : entities) volume+=ent->total_volume(); return volume; }
+    void shrink_to_fit() override { for (ExtrusionEntity *ent : entities) ent->shrink_to_fit(); this->entities.shrink_to_fit(); }
+    size_t memsize() const override {
+        size_t n = sizeof(*this) + this->entities.capacity() * sizeof(ExtrusionEntity*);
+        for (const ExtrusionEntity *ent : this->entities)
+            n += ent->memsize();
+        return n;
+    }
 
     // Following methods shall never be called on an ExtrusionEntityCollection.
     Polyline as_polyline() const {
@@ -11,6 +11,8 @@
 
 #include "FillBase.hpp"
 
+#include <tbb/parallel_for.h>
+
 namespace Slic3r {
 
 struct SurfaceFillParams
@@ -337,68 +339,81 @@ void Layer::make_fills()
 	}
 #endif /* SLIC3R_DEBUG_SLICE_PROCESSING */
 
-    for (SurfaceFill &surface_fill : surface_fills) {
-        // Create the filler object.
-        std::unique_ptr<Fill> f = std::unique_ptr<Fill>(Fill::new_from_type(surface_fill.params.pattern));
-        f->set_bounding_box(bbox);
-        f->layer_id = this->id();
-        f->z 		= this->print_z;
-        f->angle 	= surface_fill.params.angle;
-
-        // calculate flow spacing for infill pattern generation
-        bool using_internal_flow = ! surface_fill.surface.is_solid() && ! surface_fill.params.flow.bridge;
-        double link_max_length = 0.;
-        if (! surface_fill.params.flow.bridge) {
+    // Infill extrusions of each SurfaceFill, one collection per ExPolygon.
+    std::vector<ExtrusionEntitiesPtr> fills(surface_fills.size());
+    // The SurfaceFills are independent, each of them gets its own filler object. This nests into
+    // the parallel loop over layers in PrintObject::infill().
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, surface_fills.size()),
+        [this, &surface_fills, &bbox, &fills](const tbb::blocked_range<size_t> &range) {
+        for (size_t surface_fill_id = range.begin(); surface_fill_id < range.end(); ++ surface_fill_id) {
+            SurfaceFill          &surface_fill = surface_fills[surface_fill_id];
+            ExtrusionEntitiesPtr &out          = fills[surface_fill_id];
+            // Create the filler object.
+            std::unique_ptr<Fill> f = std::unique_ptr<Fill>(Fill::new_from_type(surface_fill.params.pattern));
+            f->set_bounding_box(bbox);
+            f->layer_id = this->id();
+            f->z 		= this->print_z;
+            f->angle 	= surface_fill.params.angle;
+
+            // calculate flow spacing for infill pattern generation
+            bool using_internal_flow = ! surface_fill.surface.is_solid() && ! surface_fill.params.flow.bridge;
+            double link_max_length = 0.;
+            if (! surface_fill.params.flow.bridge) {
 #if 0
-            link_max_length = layerm.region()->config().get_abs_value(surface.is_external() ? "external_fill_link_max_length" : "fill_link_max_length", flow.spacing());
+                link_max_length = layerm.region()->config().get_abs_value(surface.is_external() ? "external_fill_link_max_length" : "fill_link_max_length", flow.spacing());
 //            printf("flow spacing: %f,  is_external: %d, link_max_length: %lf\n", flow.spacing(), int(surface.is_external()), link_max_length);
 #else
-            if (surface_fill.params.density > 80.) // 80%
-                link_max_length = 3. * f->spacing;
+                if (surface_fill.params.density > 80.) // 80%
+                    link_max_length = 3. * f->spacing;
 #endif
+            }
+
+            // Maximum length of the perimeter segment linking two infill lines.
+            f->link_max_length = (coord_t)scale_(link_max_length);
+            // Used by the concentric infill pattern to clip the loops to create extrusion paths.
+            f->loop_clipping = coord_t(scale_(surface_fill.params.flow.nozzle_diameter) * LOOP_CLIPPING_LENGTH_OVER_NOZZLE_DIAMETER);
+
+            // apply half spacing using this flow's own spacing and generate infill
+            FillParams params;
+            params.density 		= float(0.01 * surface_fill.params.density);
+            params.dont_adjust 	= surface_fill.params.dont_adjust; // false
+
+            for (ExPolygon &expoly : surface_fill.expolygons) {
+				// Spacing is modified by the filler to indicate adjustments. Reset it for each expolygon.
+				f->spacing = surface_fill.params.spacing;
+				surface_fill.surface.expolygon = std::move(expoly);
+				Polylines polylines = f->fill_surface(&surface_fill.surface, params);
+		        if (! polylines.empty()) {
+			        // calculate actual flow from spacing (which might have been adjusted by the infill
+			        // pattern generator)
+			        double flow_mm3_per_mm = surface_fill.params.flow.mm3_per_mm();
+			        double flow_width      = surface_fill.params.flow.width;
+			        if (using_internal_flow) {
+			            // if we used the internal flow we're not doing a solid infill
+			            // so we can safely ignore the slight variation that might have
+			            // been applied to f->spacing
+			        } else {
+			            Flow new_flow = Flow::new_from_spacing(float(f->spacing), surface_fill.params.flow.nozzle_diameter, surface_fill.params.flow.height, surface_fill.params.flow.bridge);
+			        	flow_mm3_per_mm = new_flow.mm3_per_mm();
+			        	flow_width      = new_flow.width;
+			        }
+			        // Save into layer.
+			        auto *eec = new ExtrusionEntityCollection();
+			        out.push_back(eec);
+			        // Only concentric fills are not sorted.
+			        eec->no_sort = f->no_sort();
+			        extrusion_entities_append_paths(
+			            eec->entities, std::move(polylines),
+			            surface_fill.params.extrusion_role,
+			            flow_mm3_per_mm, float(flow_width), surface_fill.params.flow.height);
+			    }
+			}
         }
+    });
 
-        // Maximum length of the perimeter segment linking two infill lines.
-        f->link_max_length = (coord_t)scale_(link_max_length);
-        // Used by the concentric infill pattern to clip the loops to create extrusion paths.
-        f->loop_clipping = coord_t(scale_(surface_fill.params.flow.nozzle_diameter) * LOOP_CLIPPING_LENGTH_OVER_NOZZLE_DIAMETER);
-
-        // apply half spacing using this flow's own spacing and generate infill
-        FillParams params;
-        params.density 		= float(0.01 * surface_fill.params.density);
-        params.dont_adjust 	= surface_fill.params.dont_adjust; // false
-
-        for (ExPolygon &expoly : surface_fill.expolygons) {
-			// Spacing is modified by the filler to indicate adjustments. Reset it for each expolygon.
-			f->spacing = surface_fill.params.spacing;
-			surface_fill.surface.expolygon = std::move(expoly);
-			Polylines polylines = f->fill_surface(&surface_fill.surface, params);
-	        if (! polylines.empty()) {
-		        // calculate actual flow from spacing (which might have been adjusted by the infill
-		        // pattern generator)
-		        double flow_mm3_per_mm = surface_fill.params.flow.mm3_per_mm();
-		        double flow_width      = surface_fill.params.flow.width;
-		        if (using_internal_flow) {
-		            // if we used the internal flow we're not doing a solid infill
-		            // so we can safely ignore the slight variation that might have
-		            // been applied to f->spacing
-		        } else {
-		            Flow new_flow = Flow::new_from_spacing(float(f->spacing), surface_fill.params.flow.nozzle_diameter, surface_fill.params.flow.height, surface_fill.params.flow.bridge);
-		        	flow_mm3_per_mm = new_flow.mm3_per_mm();
-		        	flow_width      = new_flow.width;
-		        }
-		        // Save into layer.
-		        auto *eec = new ExtrusionEntityCollection();
-		        m_regions[surface_fill.region_id]->fills.entities.push_back(eec);
-		        // Only concentric fills are not sorted.
-		        eec->no_sort = f->no_sort();
-		        extrusion_entities_append_paths(
-		            eec->entities, std::move(polylines),
-		            surface_fill.params.extrusion_role,
-		            flow_mm3_per_mm, float(flow_width), surface_fill.params.flow.height);
-		    }
-		}
-    }
+    // Save into layer in the order of the SurfaceFills.
+    for (size_t surface_fill_id = 0; surface_fill_id < surface_fills.size(); ++ surface_fill_id)
+        append(m_regions[surface_fills[surface_fill_id].region_id]->fills.entities, std::move(fills[surface_fill_id]));
 
     // add thin fill regions
     // Unpacks the collection, creates multiple collections per path.
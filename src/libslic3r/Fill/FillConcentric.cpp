@@ -1,9 +1,12 @@
 #include "../ClipperUtils.hpp"
 #include "../ExPolygon.hpp"
+#include "../ShortestPath.hpp"
 #include "../Surface.hpp"
 
 #include "FillConcentric.hpp"
 
+#include <functional>
+
 namespace Slic3r {
 
 void FillConcentric::_fill_surface_single(
@@ -24,16 +27,93 @@ void FillConcentric::_fill_surface_single(
         this->spacing = unscale<double>(distance);
     }
 
-    Polygons loops = (Polygons)expolygon;
-    Polygons last  = loops;
-    while (! last.empty()) {
-        last = offset2(last, -(distance + min_spacing/2), +min_spacing/2);
-        loops.insert(loops.end(), last.begin(), last.end());
+    // Offset the expolygon level by level. The ExPolygons of each level are nested inside the ExPolygons of the previous level,
+    // which tells the nesting of the loops without a union of all the loops, which was slow for many levels.
+    std::vector<ExPolygons> levels { { expolygon } };
+    while (! levels.back().empty())
+        levels.emplace_back(offset2_ex(to_polygons(levels.back()), -float(distance + min_spacing/2), +float(min_spacing/2)));
+    levels.pop_back();
+
+    // Tree of the loops, a parent loop encloses its children.
+    struct Loop {
+        Polygon             polygon;
+        std::vector<size_t> children;
+    };
+    std::vector<Loop> tree;
+    const size_t      root = 0;
+    tree.push_back({ levels.front().front().contour, {} });
+    // Indices of the contour and of the first hole of the ExPolygons of the current level in the tree.
+    std::vector<size_t> contours { root };
+    std::vector<size_t> first_holes { tree.size() };
+    for (const Polygon &hole : levels.front().front().holes)
+        tree.push_back({ hole, {} });
+    for (size_t idx_level = 0; idx_level < levels.size(); ++ idx_level) {
+        const ExPolygons &level = levels[idx_level];
+        ExPolygons        empty;
+        const ExPolygons &next  = (idx_level + 1 < levels.size()) ? levels[idx_level + 1] : empty;
+        std::vector<size_t> next_contours, next_first_holes;
+        // Parent ExPolygon of each ExPolygon of the next level, the next level is a subset of this one.
+        std::vector<size_t> parents(next.size(), 0);
+        if (level.size() > 1) {
+            std::vector<BoundingBox> bboxes;
+            bboxes.reserve(level.size());
+            for (const ExPolygon &expoly : level)
+                bboxes.emplace_back(get_extents(expoly.contour));
+            for (size_t i = 0; i < next.size(); ++ i) {
+                const Point &pt = next[i].contour.points.front();
+                for (size_t j = 0; j < level.size(); ++ j)
+                    if (bboxes[j].contains(pt) && level[j].contains(pt)) {
+                        parents[i] = j;
+                        break;
+                    }
+            }
+        }
+        for (size_t i = 0; i < next.size(); ++ i) {
+            size_t contour = tree.size();
+            tree.push_back({ next[i].contour, {} });
+            tree[contours[parents[i]]].children.emplace_back(contour);
+            next_contours.emplace_back(contour);
+            next_first_holes.emplace_back(tree.size());
+            // The holes are assigned to their parents when processing the next level.
+            for (const Polygon &hole : next[i].holes)
+                tree.push_back({ hole, {} });
+        }
+        // A hole of this level is enclosed by a grown hole of the next level or by the contour, if the hole reached the contour.
+        for (size_t j = 0; j < level.size(); ++ j)
+            for (size_t k = 0; k < level[j].holes.size(); ++ k) {
+                const Point &pt     = level[j].holes[k].points.front();
+                size_t       parent = contours[j];
+                for (size_t i = 0; i < next.size() && parent == contours[j]; ++ i)
+                    if (parents[i] == j)
+                        for (size_t l = 0; l < next[i].holes.size(); ++ l)
+                            if (next[i].holes[l].contains(pt)) {
+                                parent = next_first_holes[i] + l;
+                                break;
+                            }
+                tree[parent].children.emplace_back(first_holes[j] + k);
+            }
+        contours    = std::move(next_contours);
+        first_holes = std::move(next_first_holes);
     }
 
-    // generate paths from the outermost to the innermost, to avoid
-    // adhesion problems of the first central tiny loops
-    loops = union_pt_chained(loops, false);
+    // Emit the loops depth first, the children before their parent, the siblings chained by a nearest neighbor search.
+    // All the loops are oriented counter-clockwise.
+    Polygons loops;
+    loops.reserve(tree.size());
+    std::function<void(const std::vector<size_t>&)> emit_loops = [&tree, &loops, &emit_loops](const std::vector<size_t> &nodes) {
+        Points ordering_points;
+        ordering_points.reserve(nodes.size());
+        for (size_t node : nodes)
+            ordering_points.emplace_back(tree[node].polygon.points.front());
+        for (size_t idx : chain_points(ordering_points)) {
+            Loop &loop = tree[nodes[idx]];
+            emit_loops(loop.children);
+            loops.emplace_back(std::move(loop.polygon));
+            if (loops.back().is_clockwise())
+                loops.back().reverse();
+        }
+    };
+    emit_loops({ root });
     
     // split paths using a nearest neighbor search
     size_t iPathFirst = polylines_out.size();
@@ -93,8 +93,8 @@ static std::vector<Vec2d> make_one_period(double width, double scaleFactor, doub
             break;
         else
         {
-            // insert new points in order
-            std::sort(points.begin(), points.end(),
+            // insert new points in order, the new points were generated sorted
+            std::inplace_merge(points.begin(), points.begin() + size, points.end(),
                       [](const Vec2d &lhs, const Vec2d &rhs) { return lhs(0) < rhs(0); });
         }
     }
@@ -102,7 +102,7 @@ static std::vector<Vec2d> make_one_period(double width, double scaleFactor, doub
     return points;
 }
 
-static Polylines make_gyroid_waves(double gridZ, double density_adjusted, double line_spacing, double width, double height)
+static Polylines make_gyroid_waves(double gridZ, double density_adjusted, double line_spacing, double width, double height, FillGyroid::PeriodCache &cache)
 {
     const double scaleFactor = scale_(line_spacing) / density_adjusted;
 
@@ -127,9 +127,20 @@ static Polylines make_gyroid_waves(double gridZ, double density_adjusted, double
         std::swap(width,height);
     }
 
-    std::vector<Vec2d> one_period_odd = make_one_period(width, scaleFactor, z_cos, z_sin, vertical, flip, tolerance); // creates one period of the waves, so it doesn't have to be recalculated all the time
-    flip = !flip;                                                                   // even polylines are a bit shifted
-    std::vector<Vec2d> one_period_even = make_one_period(width, scaleFactor, z_cos, z_sin, vertical, flip, tolerance);
+    // One period of the waves depends on the width only up to a single period.
+    // It is cached between the surfaces of a layer, so it doesn't have to be recalculated all the time.
+    const double period_width = std::min(2*M_PI, width);
+    if (cache.one_period_odd.empty() || cache.z != z || cache.width != period_width || cache.tolerance != tolerance) {
+        cache.z               = z;
+        cache.width           = period_width;
+        cache.tolerance       = tolerance;
+        cache.one_period_odd  = make_one_period(width, scaleFactor, z_cos, z_sin, vertical, flip, tolerance);
+        // even polylines are a bit shifted
+        cache.one_period_even = make_one_period(width, scaleFactor, z_cos, z_sin, vertical, ! flip, tolerance);
+    }
+    const std::vector<Vec2d> &one_period_odd  = cache.one_period_odd;
+    const std::vector<Vec2d> &one_period_even = cache.one_period_even;
+    flip = !flip;
     Polylines result;
 
     for (double y0 = lower_bound; y0 < upper_bound + EPSILON; y0 += M_PI) {
@@ -174,7 +185,8 @@ void FillGyroid::_fill_surface_single(
         density_adjusted,
         this->spacing,
         ceil(bb.size()(0) / distance) + 1.,
-        ceil(bb.size()(1) / distance) + 1.);
+        ceil(bb.size()(1) / distance) + 1.,
+        m_period_cache);
 
 	// shift the polyline to the grid origin
 	for (Polyline &pl : polylines)
@@ -26,6 +26,14 @@ public:
     // Gyroid upper resolution tolerance (mm^-2)
     static constexpr double PatternTolerance = 0.2;
 
+    // Single period of the odd and even waves for the last z, shared by the islands of a layer.
+    struct PeriodCache {
+        double              z         = 0.;
+        double              width     = 0.;
+        double              tolerance = 0.;
+        std::vector<Vec2d>  one_period_odd;
+        std::vector<Vec2d>  one_period_even;
+    };
 
 protected:
     virtual void _fill_surface_single(
@@ -34,6 +42,9 @@ protected:
         const std::pair<float, Point>   &direction, 
         ExPolygon                       &expolygon, 
         Polylines                       &polylines_out);
+
+private:
+    PeriodCache m_period_cache;
 };
 
 } // namespace Slic3r
@@ -26,22 +26,22 @@ void FillPlanePath::_fill_surface_single(
     expolygon.translate(-shift(0), -shift(1));
     bounding_box.translate(-shift(0), -shift(1));
 
-    Pointfs pts = _generate(
+    // Only the parts of the curve close to the expolygon are generated, the clip box is in the units of the line spacing.
+    BoundingBox expolygon_bbox = get_extents(expolygon);
+    expolygon_bbox.offset(SCALED_EPSILON);
+    BoundingBoxf clip_box(
+        Vec2d(coordf_t(expolygon_bbox.min(0)) / distance_between_lines, coordf_t(expolygon_bbox.min(1)) / distance_between_lines),
+        Vec2d(coordf_t(expolygon_bbox.max(0)) / distance_between_lines, coordf_t(expolygon_bbox.max(1)) / distance_between_lines));
+    InfillPolylineOutput output(clip_box, coordf_t(distance_between_lines));
+    _generate(
         coord_t(ceil(coordf_t(bounding_box.min(0)) / distance_between_lines)),
         coord_t(ceil(coordf_t(bounding_box.min(1)) / distance_between_lines)),
         coord_t(ceil(coordf_t(bounding_box.max(0)) / distance_between_lines)),
-        coord_t(ceil(coordf_t(bounding_box.max(1)) / distance_between_lines)));
-
-    Polylines polylines;
-    if (pts.size() >= 2) {
-        // Convert points to a polyline, upscale.
-        polylines.push_back(Polyline());
-        Polyline &polyline = polylines.back();
-        polyline.points.reserve(pts.size());
-        for (Pointfs::iterator it = pts.begin(); it != pts.end(); ++ it)
-            polyline.points.push_back(Point(
-                coord_t(floor((*it)(0) * distance_between_lines + 0.5)), 
-                coord_t(floor((*it)(1) * distance_between_lines + 0.5))));
+        coord_t(ceil(coordf_t(bounding_box.max(1)) / distance_between_lines)),
+        clip_box, output);
+
+    Polylines polylines = output.result();
+    if (! polylines.empty()) {
 //      intersection(polylines_src, offset((Polygons)expolygon, scale_(0.02)), &polylines);
         polylines = intersection_pl(polylines, to_polygons(expolygon));
 
@@ -73,27 +73,68 @@ void FillPlanePath::_fill_surface_single(
         std::swap(polylines_out[j ++], polylines[i]);
 }
 
+void FillPlanePath::InfillPolylineOutput::add_point(const Vec2d &pt)
+{
+    if (m_has_prev) {
+        // Keep the segment if its bounding box overlaps the clip box.
+        if (std::max(m_prev.x(), pt.x()) >= m_clip_box.min.x() && std::min(m_prev.x(), pt.x()) <= m_clip_box.max.x() &&
+            std::max(m_prev.y(), pt.y()) >= m_clip_box.min.y() && std::min(m_prev.y(), pt.y()) <= m_clip_box.max.y()) {
+            if (m_polyline.points.empty())
+                m_polyline.points.emplace_back(this->scaled(m_prev));
+            m_polyline.points.emplace_back(this->scaled(pt));
+        } else
+            this->flush();
+    }
+    m_prev     = pt;
+    m_has_prev = true;
+}
+
+void FillPlanePath::InfillPolylineOutput::flush()
+{
+    if (m_polyline.points.size() >= 2)
+        m_out.emplace_back(std::move(m_polyline));
+    m_polyline.points.clear();
+}
+
+// Minimum and maximum distance of the points of a box from the origin.
+static inline std::pair<coordf_t, coordf_t> box_distance_range(const BoundingBoxf &box)
+{
+    coordf_t dx_min = (box.min.x() > 0.) ? box.min.x() : (box.max.x() < 0.) ? - box.max.x() : 0.;
+    coordf_t dy_min = (box.min.y() > 0.) ? box.min.y() : (box.max.y() < 0.) ? - box.max.y() : 0.;
+    coordf_t dx_max = std::max(std::abs(box.min.x()), std::abs(box.max.x()));
+    coordf_t dy_max = std::max(std::abs(box.min.y()), std::abs(box.max.y()));
+    return std::make_pair(std::sqrt(dx_min * dx_min + dy_min * dy_min), std::sqrt(dx_max * dx_max + dy_max * dy_max));
+}
+
 // Follow an Archimedean spiral, in polar coordinates: r=a+b\theta
-Pointfs FillArchimedeanChords::_generate(coord_t min_x, coord_t min_y, coord_t max_x, coord_t max_y)
+void FillArchimedeanChords::_generate(coord_t min_x, coord_t min_y, coord_t max_x, coord_t max_y, const BoundingBoxf &clip_box, InfillPolylineOutput &output)
 {
     // Radius to achieve.
     coordf_t rmax = std::sqrt(coordf_t(max_x)*coordf_t(max_x)+coordf_t(max_y)*coordf_t(max_y)) * std::sqrt(2.) + 1.5;
+    // The chords stay between two neighbor turns, thus the turns far from the clip box are not generated.
+    std::pair<coordf_t, coordf_t> clip_range = box_distance_range(clip_box);
+    rmax = std::min(rmax, clip_range.second + 1.5);
     // Now unwind the spiral.
     coordf_t a = 1.;
     coordf_t b = 1./(2.*M_PI);
     coordf_t theta = 0.;
     coordf_t r = 1;
-    Pointfs out;
-    //FIXME Vojtech: If used as a solid infill, there is a gap left at the center.
-    out.push_back(Vec2d(0, 0));
-    out.push_back(Vec2d(1, 0));
+    if (clip_range.first < 2.5) {
+        //FIXME Vojtech: If used as a solid infill, there is a gap left at the center.
+        output.add_point(Vec2d(0, 0));
+        output.add_point(Vec2d(1, 0));
+    } else {
+        // Start a turn inside the clip box.
+        r     = clip_range.first - 1.5;
+        theta = (r - a) / b;
+        output.add_point(Vec2d(r * cos(theta), r * sin(theta)));
+    }
     while (r < rmax) {
         // Discretization angle to achieve a discretization error lower than RESOLUTION.
         theta += 2. * acos(1. - RESOLUTION / r);
         r = a + b * theta;
-        out.push_back(Vec2d(r * cos(theta), r * sin(theta)));
+        output.add_point(Vec2d(r * cos(theta), r * sin(theta)));
     }
-    return out;
 }
 
 // Adapted from 
@@ -144,7 +185,30 @@ static inline Point hilbert_n_to_xy(const size_t n)
     return Point(x, y);
 }
 
-Pointfs FillHilbertCurve::_generate(coord_t min_x, coord_t min_y, coord_t max_x, coord_t max_y)
+// Emit the 4^level points of the curve starting with n0, which fill an aligned square of 2^level x 2^level.
+// The squares outside of the clip box are skipped completely.
+static void hilbert_generate(size_t n0, size_t level, coord_t min_x, coord_t min_y, const BoundingBoxf &clip_box, FillPlanePath::InfillPolylineOutput &output)
+{
+    Point p = hilbert_n_to_xy(n0);
+    if (level == 0) {
+        output.add_point(Vec2d(p(0) + min_x, p(1) + min_y));
+        return;
+    }
+    coord_t sz = coord_t(1) << level;
+    coord_t x0 = ((p(0) >> level) << level) + min_x;
+    coord_t y0 = ((p(1) >> level) << level) + min_y;
+    // The segments of the curve have a unit length, the square is enlarged by one to keep the segments leaving the clip box.
+    if (coordf_t(x0 + sz) < clip_box.min.x() || coordf_t(x0 - 1) > clip_box.max.x() ||
+        coordf_t(y0 + sz) < clip_box.min.y() || coordf_t(y0 - 1) > clip_box.max.y()) {
+        output.break_polyline();
+        return;
+    }
+    size_t step = size_t(1) << ((level - 1) * 2);
+    for (size_t i = 0; i < 4; ++ i)
+        hilbert_generate(n0 + i * step, level - 1, min_x, min_y, clip_box, output);
+}
+
+void FillHilbertCurve::_generate(coord_t min_x, coord_t min_y, coord_t max_x, coord_t max_y, const BoundingBoxf &clip_box, InfillPolylineOutput &output)
 {
     // Minimum power of two square to fit the domain.
     size_t sz = 2;
@@ -157,47 +221,45 @@ Pointfs FillHilbertCurve::_generate(coord_t min_x, coord_t min_y, coord_t max_x,
         }
     }
 
-    size_t sz2 = sz * sz;
-    Pointfs line;
-    line.reserve(sz2);
-    for (size_t i = 0; i < sz2; ++ i) {
-        Point p = hilbert_n_to_xy(i);
-        line.push_back(Vec2d(p(0) + min_x, p(1) + min_y));
-    }
-    return line;
+    hilbert_generate(0, pw, min_x, min_y, clip_box, output);
 }
 
-Pointfs FillOctagramSpiral::_generate(coord_t min_x, coord_t min_y, coord_t max_x, coord_t max_y)
+void FillOctagramSpiral::_generate(coord_t min_x, coord_t min_y, coord_t max_x, coord_t max_y, const BoundingBoxf &clip_box, InfillPolylineOutput &output)
 {
     // Radius to achieve.
     coordf_t rmax = std::sqrt(coordf_t(max_x)*coordf_t(max_x)+coordf_t(max_y)*coordf_t(max_y)) * std::sqrt(2.) + 1.5;
     // Now unwind the spiral.
     coordf_t r = 0;
     coordf_t r_inc = sqrt(2.);
-    Pointfs out;
-    out.push_back(Vec2d(0, 0));
+    // A loop of radius r lies between r / sqrt(2) and 2 * r + 2 from the center, including the link to the next loop.
+    // The loops not reaching the clip box are not generated.
+    std::pair<coordf_t, coordf_t> clip_range = box_distance_range(clip_box);
+    rmax = std::min(rmax, (clip_range.second + 1.) * sqrt(2.));
+    if (clip_range.first > 2. * r_inc + 2.)
+        r = floor((0.5 * clip_range.first - 1.) / r_inc - 1.) * r_inc;
+    else
+        output.add_point(Vec2d(0, 0));
     while (r < rmax) {
         r += r_inc;
         coordf_t rx = r / sqrt(2.);
         coordf_t r2 = r + rx;
-        out.push_back(Vec2d( r,  0.));
-        out.push_back(Vec2d( r2, rx));
-        out.push_back(Vec2d( rx, rx));
-        out.push_back(Vec2d( rx, r2));
-        out.push_back(Vec2d(0.,  r));
-        out.push_back(Vec2d(-rx, r2));
-        out.push_back(Vec2d(-rx, rx));
-        out.push_back(Vec2d(-r2, rx));
-        out.push_back(Vec2d(-r,  0.));
-        out.push_back(Vec2d(-r2, -rx));
-        out.push_back(Vec2d(-rx, -rx));
-        out.push_back(Vec2d(-rx, -r2));
-        out.push_back(Vec2d(0., -r));
-        out.push_back(Vec2d( rx, -r2));
-        out.push_back(Vec2d( rx, -rx));
-        out.push_back(Vec2d( r2+r_inc, -rx));
+        output.add_point(Vec2d( r,  0.));
+        output.add_point(Vec2d( r2, rx));
+        output.add_point(Vec2d( rx, rx));
+        output.add_point(Vec2d( rx, r2));
+        output.add_point(Vec2d(0.,  r));
+        output.add_point(Vec2d(-rx, r2));
+        output.add_point(Vec2d(-rx, rx));
+        output.add_point(Vec2d(-r2, rx));
+        output.add_point(Vec2d(-r,  0.));
+        output.add_point(Vec2d(-r2, -rx));
+        output.add_point(Vec2d(-rx, -rx));
+        output.add_point(Vec2d(-rx, -r2));
+        output.add_point(Vec2d(0., -r));
+        output.add_point(Vec2d( rx, -r2));
+        output.add_point(Vec2d( rx, -rx));
+        output.add_point(Vec2d( r2+r_inc, -rx));
     }
-    return out;
 }
 
 } // namespace Slic3r
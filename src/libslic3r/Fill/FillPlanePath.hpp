@@ -4,6 +4,8 @@
 #include <map>
 
 #include "../libslic3r.h"
+#include "../BoundingBox.hpp"
+#include "../Polyline.hpp"
 
 #include "FillBase.hpp"
 
@@ -18,6 +20,31 @@ class FillPlanePath : public Fill
 public:
     virtual ~FillPlanePath() {}
 
+    // Receives the points of a curve in the units of the line spacing. Only the segments touching the clip box are kept,
+    // they are scaled and chained into polylines, thus the curve is never stored over the whole bounding box of the object.
+    class InfillPolylineOutput
+    {
+    public:
+        InfillPolylineOutput(const BoundingBoxf &clip_box, coordf_t scale) : m_clip_box(clip_box), m_scale(scale) {}
+
+        void add_point(const Vec2d &pt);
+        // The curve leaves the clip box, the next point will not be connected to the last one.
+        void break_polyline() { this->flush(); m_has_prev = false; }
+        Polylines&& result() { this->flush(); return std::move(m_out); }
+
+    private:
+        Point scaled(const Vec2d &pt) const
+            { return Point(coord_t(floor(pt.x() * m_scale + 0.5)), coord_t(floor(pt.y() * m_scale + 0.5))); }
+        void  flush();
+
+        const BoundingBoxf  m_clip_box;
+        const coordf_t      m_scale;
+        Vec2d               m_prev;
+        bool                m_has_prev { false };
+        Polyline            m_polyline;
+        Polylines           m_out;
+    };
+
 protected:
     virtual void _fill_surface_single(
         const FillParams                &params, 
@@ -28,7 +55,9 @@ protected:
 
     virtual float _layer_angle(size_t idx) const { return 0.f; }
     virtual bool  _centered() const = 0;
-    virtual Pointfs _generate(coord_t min_x, coord_t min_y, coord_t max_x, coord_t max_y) = 0;
+    // Generate the curve over the bounding box of the object (min_x .. max_y in the units of the line spacing)
+    // to align the infill across layers, emitting only the parts close to clip_box of the expolygon to be filled.
+    virtual void  _generate(coord_t min_x, coord_t min_y, coord_t max_x, coord_t max_y, const BoundingBoxf &clip_box, InfillPolylineOutput &output) = 0;
 };
 
 class FillArchimedeanChords : public FillPlanePath
@@ -39,7 +68,7 @@ public:
 
 protected:
     virtual bool  _centered() const { return true; }
-    virtual Pointfs _generate(coord_t min_x, coord_t min_y, coord_t max_x, coord_t max_y);
+    virtual void  _generate(coord_t min_x, coord_t min_y, coord_t max_x, coord_t max_y, const BoundingBoxf &clip_box, InfillPolylineOutput &output);
 };
 
 class FillHilbertCurve : public FillPlanePath
@@ -50,7 +79,7 @@ public:
 
 protected:
     virtual bool  _centered() const { return false; }
-    virtual Pointfs _generate(coord_t min_x, coord_t min_y, coord_t max_x, coord_t max_y);
+    virtual void  _generate(coord_t min_x, coord_t min_y, coord_t max_x, coord_t max_y, const BoundingBoxf &clip_box, InfillPolylineOutput &output);
 };
 
 class FillOctagramSpiral : public FillPlanePath
@@ -61,7 +90,7 @@ public:
 
 protected:
     virtual bool  _centered() const { return true; }
-    virtual Pointfs _generate(coord_t min_x, coord_t min_y, coord_t max_x, coord_t max_y);
+    virtual void  _generate(coord_t min_x, coord_t min_y, coord_t max_x, coord_t max_y, const BoundingBoxf &clip_box, InfillPolylineOutput &output);
 };
 
 } // namespace Slic3r
@@ -759,6 +759,32 @@ enum DirectionMask
     DIR_BACKWARD = 2
 };
 
+// Left / right indices of the vertical lines x0 + i * line_spacing, 0 <= i < n_vlines, intersecting a segment.
+// The range is empty (first > second) if no vertical line intersects the segment.
+static inline std::pair<int, int> vertical_lines_intersected(const Point &p1, const Point &p2, coord_t x0, coord_t line_spacing, int n_vlines)
+{
+    coord_t l = p1(0);
+    coord_t r = p2(0);
+    if (l > r)
+        std::swap(l, r);
+    int il = (l - x0) / line_spacing;
+    while (il * line_spacing + x0 < l)
+        ++ il;
+    il = std::max(int(0), il);
+    int ir = (r - x0 + line_spacing) / line_spacing;
+    while (ir * line_spacing + x0 > r)
+        -- ir;
+    ir = std::min(n_vlines - 1, ir);
+    return std::make_pair(il, ir);
+}
+
+// Scratch buffer of the intersection counters, reused by the consecutive calls of a thread.
+static inline std::vector<size_t>& intersections_count_cache()
+{
+    static thread_local std::vector<size_t> cache;
+    return cache;
+}
+
 bool FillRectilinear2::fill_surface_by_lines(const Surface *surface, const FillParams &params, float angleBase, float pattern_shift, Polylines &polylines_out)
 {
     // At the end, only the new polylines will be rotated back.
@@ -827,11 +853,37 @@ bool FillRectilinear2::fill_surface_by_lines(const Surface *surface, const FillP
 #endif /* SLIC3R_DEBUG */
 
     // For each contour
-    // Allocate storage for the segments.
-    std::vector<SegmentedIntersectionLine> segs(n_vlines, SegmentedIntersectionLine());
+    // Allocate storage for the segments. The storage is reused by the consecutive calls of a thread,
+    // so that the intersection vectors of the vertical lines are not reallocated for each surface.
+    static thread_local std::vector<SegmentedIntersectionLine> segs_cache;
+    std::vector<SegmentedIntersectionLine> &segs = segs_cache;
+    segs.resize(n_vlines);
     for (size_t i = 0; i < n_vlines; ++ i) {
         segs[i].idx = i;
         segs[i].pos = x0 + i * line_spacing;
+        segs[i].intersections.clear();
+    }
+    {
+        // Count the intersections of the vertical lines with the contour segments first to allocate the intersection vectors at once.
+        std::vector<size_t> &num_intersections = intersections_count_cache();
+        num_intersections.assign(n_vlines + 1, 0);
+        for (size_t iContour = 0; iContour < poly_with_offset.n_contours; ++ iContour) {
+            const Points &contour = poly_with_offset.contour(iContour).points;
+            if (contour.size() < 2)
+                continue;
+            for (size_t iSegment = 0; iSegment < contour.size(); ++ iSegment) {
+                std::pair<int, int> range = vertical_lines_intersected(contour[((iSegment == 0) ? contour.size() : iSegment) - 1], contour[iSegment], x0, line_spacing, int(n_vlines));
+                if (range.first <= range.second) {
+                    ++ num_intersections[range.first];
+                    -- num_intersections[range.second + 1];
+                }
+            }
+        }
+        size_t cnt = 0;
+        for (size_t i = 0; i < n_vlines; ++ i) {
+            cnt += num_intersections[i];
+            segs[i].intersections.reserve(cnt);
+        }
     }
     for (size_t iContour = 0; iContour < poly_with_offset.n_contours; ++ iContour) {
         const Points &contour = poly_with_offset.contour(iContour).points;
@@ -843,19 +895,9 @@ bool FillRectilinear2::fill_surface_by_lines(const Surface *surface, const FillP
             const Point &p1 = contour[iPrev];
             const Point &p2 = contour[iSegment];
             // Which of the equally spaced vertical lines is intersected by this segment?
-            coord_t l = p1(0);
-            coord_t r = p2(0);
-            if (l > r)
-                std::swap(l, r);
             // il, ir are the left / right indices of vertical lines intersecting a segment
-            int il = (l - x0) / line_spacing;
-            while (il * line_spacing + x0 < l)
-                ++ il;
-            il = std::max(int(0), il);
-            int ir = (r - x0 + line_spacing) / line_spacing;
-            while (ir * line_spacing + x0 > r)
-                -- ir;
-            ir = std::min(int(segs.size()) - 1, ir);
+            int il, ir;
+            std::tie(il, ir) = vertical_lines_intersected(p1, p2, x0, line_spacing, int(segs.size()));
             if (il > ir)
                 // No vertical line intersects this segment.
                 continue;
@@ -867,8 +909,8 @@ bool FillRectilinear2::fill_surface_by_lines(const Surface *surface, const FillP
                 SegmentIntersection is;
                 is.iContour = iContour;
                 is.iSegment = iSegment;
-                assert(l <= this_x);
-                assert(r >= this_x);
+                assert(std::min(p1(0), p2(0)) <= this_x);
+                assert(std::max(p1(0), p2(0)) >= this_x);
                 // Calculate the intersection position in y axis. x is known.
                 if (p1(0) == this_x) {
                     if (p2(0) == this_x) {
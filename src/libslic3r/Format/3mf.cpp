@@ -29,6 +29,7 @@ namespace pt = boost::property_tree;
 
 #include <expat.h>
 #include <Eigen/Dense>
+#include <tbb/parallel_for.h>
 #include "miniz_extension.hpp"
 
 // VERSION NUMBERS
@@ -376,6 +377,21 @@ namespace Slic3r {
             VolumeMetadataList volumes;
         };
 
+        // Volumes to be generated for a ModelObject from its geometry.
+        struct ObjectVolumes
+        {
+            ModelObject* object;
+            const Geometry* geometry;
+            ObjectMetadata::VolumeMetadataList volumes;
+
+            ObjectVolumes(ModelObject* object, const Geometry* geometry, const ObjectMetadata::VolumeMetadataList& volumes)
+                : object(object)
+                , geometry(geometry)
+                , volumes(volumes)
+            {
+            }
+        };
+
         // Map from a 1 based 3MF object ID to a 0 based ModelObject index inside m_model->objects.
         typedef std::map<int, int> IdToModelObjectMap;
         typedef std::map<int, ComponentsList> IdToAliasesMap;
@@ -492,7 +508,7 @@ namespace Slic3r {
         bool _handle_start_config_metadata(const char** attributes, unsigned int num_attributes);
         bool _handle_end_config_metadata();
 
-        bool _generate_volumes(ModelObject& object, const Geometry& geometry, const ObjectMetadata::VolumeMetadataList& volumes);
+        bool _generate_volumes(const std::vector<ObjectVolumes>& objects_volumes);
 
         // callbacks to parse the .model file
         static void XMLCALL _handle_start_model_xml_element(void* userData, const char* name, const char** attributes);
@@ -654,6 +670,8 @@ namespace Slic3r {
 
         close_zip_reader(&archive);
 
+        std::vector<ObjectVolumes> objects_volumes;
+        objects_volumes.reserve(m_objects.size());
         for (const IdToModelObjectMap::value_type& object : m_objects)
         {
             ModelObject *model_object = m_model->objects[object.second];
@@ -712,10 +730,12 @@ namespace Slic3r {
                 volumes_ptr = &volumes;
             }
 
-            if (!_generate_volumes(*model_object, obj_geometry->second, *volumes_ptr))
-                return false;
+            objects_volumes.emplace_back(model_object, &obj_geometry->second, *volumes_ptr);
         }
 
+        if (!_generate_volumes(objects_volumes))
+            return false;
+
 //        // fixes the min z of the model if negative
 //        model.adjust_min_z();
 
@@ -1687,91 +1707,119 @@ namespace Slic3r {
         return true;
     }
 
-    bool _3MF_Importer::_generate_volumes(ModelObject& object, const Geometry& geometry, const ObjectMetadata::VolumeMetadataList& volumes)
+    bool _3MF_Importer::_generate_volumes(const std::vector<ObjectVolumes>& objects_volumes)
     {
-        if (!object.volumes.empty())
+        struct VolumeToGenerate
         {
-            add_error("Found invalid volumes count");
-            return false;
-        }
-
-        unsigned int geo_tri_count = (unsigned int)geometry.triangles.size() / 3;
+            const Geometry* geometry;
+            const ObjectMetadata::VolumeMetadata* volume_data;
+            TriangleMesh mesh;
+            TriangleMesh convex_hull;
+        };
+        std::vector<VolumeToGenerate> volumes_to_generate;
 
-        for (const ObjectMetadata::VolumeMetadata& volume_data : volumes)
+        for (const ObjectVolumes& object_volumes : objects_volumes)
         {
-            if ((geo_tri_count <= volume_data.first_triangle_id) || (geo_tri_count <= volume_data.last_triangle_id) || (volume_data.last_triangle_id < volume_data.first_triangle_id))
+            if (!object_volumes.object->volumes.empty())
             {
-                add_error("Found invalid triangle id");
+                add_error("Found invalid volumes count");
                 return false;
             }
 
-            Transform3d volume_matrix_to_object = Transform3d::Identity();
-            bool        has_transform 		    = false;
-            // extract the volume transformation from the volume's metadata, if present
-            for (const Metadata& metadata : volume_data.metadata)
+            unsigned int geo_tri_count = (unsigned int)object_volumes.geometry->triangles.size() / 3;
+
+            for (const ObjectMetadata::VolumeMetadata& volume_data : object_volumes.volumes)
             {
-                if (metadata.key == MATRIX_KEY)
+                if ((geo_tri_count <= volume_data.first_triangle_id) || (geo_tri_count <= volume_data.last_triangle_id) || (volume_data.last_triangle_id < volume_data.first_triangle_id))
                 {
-                    volume_matrix_to_object = Slic3r::Geometry::transform3d_from_string(metadata.value);
-                    has_transform 			= ! volume_matrix_to_object.isApprox(Transform3d::Identity(), 1e-10);
-                    break;
+                    add_error("Found invalid triangle id");
+                    return false;
                 }
+                volumes_to_generate.push_back({ object_volumes.geometry, &volume_data, TriangleMesh(), TriangleMesh() });
             }
+        }
 
-            // splits volume out of imported geometry
-			TriangleMesh triangle_mesh;
-            stl_file    &stl             = triangle_mesh.stl;
-			unsigned int triangles_count = volume_data.last_triangle_id - volume_data.first_triangle_id + 1;
-			stl.stats.type = inmemory;
-            stl.stats.number_of_facets = (uint32_t)triangles_count;
-            stl.stats.original_num_facets = (int)stl.stats.number_of_facets;
-            stl_allocate(&stl);
-
-            unsigned int src_start_id = volume_data.first_triangle_id * 3;
-
-            for (unsigned int i = 0; i < triangles_count; ++i)
+        // splits volumes out of imported geometries, repairs them and calculates their convex hulls in parallel
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, volumes_to_generate.size()), [&volumes_to_generate](const tbb::blocked_range<size_t>& range) {
+            for (size_t volume_idx = range.begin(); volume_idx < range.end(); ++volume_idx)
             {
-                unsigned int ii = i * 3;
-                stl_facet& facet = stl.facet_start[i];
-                for (unsigned int v = 0; v < 3; ++v)
+                VolumeToGenerate& volume = volumes_to_generate[volume_idx];
+                const Geometry& geometry = *volume.geometry;
+                stl_file &stl = volume.mesh.stl;
+                unsigned int triangles_count = volume.volume_data->last_triangle_id - volume.volume_data->first_triangle_id + 1;
+                stl.stats.type = inmemory;
+                stl.stats.number_of_facets = (uint32_t)triangles_count;
+                stl.stats.original_num_facets = (int)stl.stats.number_of_facets;
+                stl_allocate(&stl);
+
+                unsigned int src_start_id = volume.volume_data->first_triangle_id * 3;
+
+                for (unsigned int i = 0; i < triangles_count; ++i)
                 {
-                    unsigned int tri_id = geometry.triangles[src_start_id + ii + v] * 3;
-                    facet.vertex[v] = Vec3f(geometry.vertices[tri_id + 0], geometry.vertices[tri_id + 1], geometry.vertices[tri_id + 2]);
+                    unsigned int ii = i * 3;
+                    stl_facet& facet = stl.facet_start[i];
+                    for (unsigned int v = 0; v < 3; ++v)
+                    {
+                        unsigned int tri_id = geometry.triangles[src_start_id + ii + v] * 3;
+                        facet.vertex[v] = Vec3f(geometry.vertices[tri_id + 0], geometry.vertices[tri_id + 1], geometry.vertices[tri_id + 2]);
+                    }
                 }
+
+                stl_get_size(&stl);
+                volume.mesh.repair();
+                volume.convex_hull = volume.mesh.convex_hull_3d();
             }
+        });
+
+        size_t volume_idx = 0;
+        for (const ObjectVolumes& object_volumes : objects_volumes)
+        {
+            for (const ObjectMetadata::VolumeMetadata& volume_data : object_volumes.volumes)
+            {
+                VolumeToGenerate& volume_to_generate = volumes_to_generate[volume_idx++];
 
-			stl_get_size(&stl);
-			triangle_mesh.repair();
+                Transform3d volume_matrix_to_object = Transform3d::Identity();
+                bool        has_transform 		    = false;
+                // extract the volume transformation from the volume's metadata, if present
+                for (const Metadata& metadata : volume_data.metadata)
+                {
+                    if (metadata.key == MATRIX_KEY)
+                    {
+                        volume_matrix_to_object = Slic3r::Geometry::transform3d_from_string(metadata.value);
+                        has_transform 			= ! volume_matrix_to_object.isApprox(Transform3d::Identity(), 1e-10);
+                        break;
+                    }
+                }
 
-			ModelVolume* volume = object.add_volume(std::move(triangle_mesh));
-            // stores the volume matrix taken from the metadata, if present
-            if (has_transform)
-                volume->source.transform = Slic3r::Geometry::Transformation(volume_matrix_to_object);
-            volume->calculate_convex_hull();
+                ModelVolume* volume = object_volumes.object->add_volume(std::move(volume_to_generate.mesh), std::move(volume_to_generate.convex_hull));
+                // stores the volume matrix taken from the metadata, if present
+                if (has_transform)
+                    volume->source.transform = Slic3r::Geometry::Transformation(volume_matrix_to_object);
 
-            // apply the remaining volume's metadata
-            for (const Metadata& metadata : volume_data.metadata)
-            {
-                if (metadata.key == NAME_KEY)
-                    volume->name = metadata.value;
-                else if ((metadata.key == MODIFIER_KEY) && (metadata.value == "1"))
-					volume->set_type(ModelVolumeType::PARAMETER_MODIFIER);
-                else if (metadata.key == VOLUME_TYPE_KEY)
-                    volume->set_type(ModelVolume::type_from_string(metadata.value));
-                else if (metadata.key == SOURCE_FILE_KEY)
-                    volume->source.input_file = metadata.value;
-                else if (metadata.key == SOURCE_OBJECT_ID_KEY)
-                    volume->source.object_idx = ::atoi(metadata.value.c_str());
-                else if (metadata.key == SOURCE_VOLUME_ID_KEY)
-                    volume->source.volume_idx = ::atoi(metadata.value.c_str());
-                else if (metadata.key == SOURCE_OFFSET_X_KEY)
-                    volume->source.mesh_offset(0) = ::atof(metadata.value.c_str());
-                else if (metadata.key == SOURCE_OFFSET_Y_KEY)
-                    volume->source.mesh_offset(1) = ::atof(metadata.value.c_str());
-                else if (metadata.key == SOURCE_OFFSET_Z_KEY)
-                    volume->source.mesh_offset(2) = ::atof(metadata.value.c_str());
-                else
-                    volume->config.set_deserialize(metadata.key, metadata.value);
+                // apply the remaining volume's metadata
+                for (const Metadata& metadata : volume_data.metadata)
+                {
+                    if (metadata.key == NAME_KEY)
+                        volume->name = metadata.value;
+                    else if ((metadata.key == MODIFIER_KEY) && (metadata.value == "1"))
+                        volume->set_type(ModelVolumeType::PARAMETER_MODIFIER);
+                    else if (metadata.key == VOLUME_TYPE_KEY)
+                        volume->set_type(ModelVolume::type_from_string(metadata.value));
+                    else if (metadata.key == SOURCE_FILE_KEY)
+                        volume->source.input_file = metadata.value;
+                    else if (metadata.key == SOURCE_OBJECT_ID_KEY)
+                        volume->source.object_idx = ::atoi(metadata.value.c_str());
+                    else if (metadata.key == SOURCE_VOLUME_ID_KEY)
+                        volume->source.volume_idx = ::atoi(metadata.value.c_str());
+                    else if (metadata.key == SOURCE_OFFSET_X_KEY)
+                        volume->source.mesh_offset(0) = ::atof(metadata.value.c_str());
+                    else if (metadata.key == SOURCE_OFFSET_Y_KEY)
+                        volume->source.mesh_offset(1) = ::atof(metadata.value.c_str());
+                    else if (metadata.key == SOURCE_OFFSET_Z_KEY)
+                        volume->source.mesh_offset(2) = ::atof(metadata.value.c_str());
+                    else
+                        volume->config.set_deserialize(metadata.key, metadata.value);
+                }
             }
         }
 
@@ -1813,6 +1861,38 @@ namespace Slic3r {
             importer->_handle_end_config_xml_element(name);
     }
 
+    // Adds a file assembled from the pieces to the archive. The pieces are compressed one after the other, saving the memory and time
+    // of concatenating them into a single buffer.
+    static bool add_pieces_to_archive(mz_zip_archive& archive, const std::string& name, const std::vector<std::string>& pieces)
+    {
+        struct Source
+        {
+            const std::vector<std::string>& pieces;
+            // Offsets of the pieces in the file, terminated by the file size.
+            std::vector<mz_uint64> offsets;
+        };
+        Source source{ pieces, { 0 } };
+        for (const std::string& piece : pieces)
+            source.offsets.emplace_back(source.offsets.back() + piece.size());
+
+        auto read = [](void* pOpaque, mz_uint64 file_ofs, void* pBuf, size_t n)->size_t {
+            const Source& source = *static_cast<const Source*>(pOpaque);
+            size_t idx = std::upper_bound(source.offsets.begin(), source.offsets.end(), file_ofs) - source.offsets.begin() - 1;
+            size_t read = 0;
+            for (; read < n && idx < source.pieces.size(); ++ idx)
+            {
+                size_t ofs = size_t(file_ofs + read - source.offsets[idx]);
+                size_t len = std::min(n - read, source.pieces[idx].size() - ofs);
+                memcpy((char*)pBuf + read, source.pieces[idx].data() + ofs, len);
+                read += len;
+            }
+            return read;
+        };
+
+        MZ_TIME_T now = ::time(nullptr);
+        return mz_zip_writer_add_read_buf_callback(&archive, name.c_str(), read, &source, source.offsets.back(), &now, nullptr, 0, MZ_DEFAULT_COMPRESSION, nullptr, 0, nullptr, 0) != 0;
+    }
+
     class _3MF_Exporter : public _3MF_Base
     {
         struct BuildItem
@@ -1890,7 +1970,7 @@ namespace Slic3r {
 #endif // ENABLE_THUMBNAIL_GENERATOR
         bool _add_relationships_file_to_archive(mz_zip_archive& archive);
         bool _add_model_file_to_archive(mz_zip_archive& archive, const Model& model, IdToObjectDataMap &objects_data);
-        bool _add_object_to_model_stream(std::stringstream& stream, unsigned int& object_id, ModelObject& object, BuildItemsList& build_items, VolumeToOffsetsMap& volumes_offsets);
+        bool _add_object_to_model_stream(std::stringstream& stream, unsigned int object_id, ModelObject& object, VolumeToOffsetsMap& volumes_offsets);
         bool _add_mesh_to_object_stream(std::stringstream& stream, ModelObject& object, VolumeToOffsetsMap& volumes_offsets);
         bool _add_build_to_model_stream(std::stringstream& stream, const BuildItemsList& build_items);
         bool _add_layer_height_profile_file_to_archive(mz_zip_archive& archive, Model& model);
@@ -2130,6 +2210,10 @@ namespace Slic3r {
 
 	bool _3MF_Exporter::_add_model_file_to_archive(mz_zip_archive& archive, const Model& model, IdToObjectDataMap &objects_data)
     {
+        // The model file is assembled from pieces: the header, one piece per ModelObject and the build items.
+        // The ModelObjects are exported in parallel and the pieces are compressed into the archive without concatenating them.
+        std::vector<std::string> pieces;
+
         std::stringstream stream;
         // https://en.cppreference.com/w/cpp/types/numeric_limits/max_digits10
         // Conversion of a floating-point value to text and back is exact as long as at least max_digits10 were used (9 for float, 17 for double).
@@ -2140,13 +2224,15 @@ namespace Slic3r {
         stream << "<" << MODEL_TAG << " unit=\"millimeter\" xml:lang=\"en-US\" xmlns=\"http://schemas.microsoft.com/3dmanufacturing/core/2015/02\" xmlns:slic3rpe=\"http://schemas.slic3r.org/3mf/2017/06\">\n";
         stream << " <" << METADATA_TAG << " name=\"" << SLIC3RPE_3MF_VERSION << "\">" << VERSION_3MF << "</" << METADATA_TAG << ">\n";
         stream << " <" << RESOURCES_TAG << ">\n";
+        pieces.emplace_back(stream.str());
 
         // Instance transformations, indexed by the 3MF object ID (which is a linear serialization of all instances of all ModelObjects).
         BuildItemsList build_items;
 
         // The object_id here is a one based identifier of the first instance of a ModelObject in the 3MF file, where
-        // all the object instances of all ModelObjects are stored and indexed in a 1 based linear fashion.
+        // all the object instances of all ModelObjects are stored and indexed in a linear fashion.
         // Therefore the list of object_ids here may not be continuous.
+        std::vector<std::pair<unsigned int, ModelObject*>> objects;
         unsigned int object_id = 1;
         for (ModelObject* obj : model.objects)
         {
@@ -2154,18 +2240,52 @@ namespace Slic3r {
                 continue;
 
             // Index of an object in the 3MF file corresponding to the 1st instance of a ModelObject.
-            unsigned int curr_id = object_id;
-            IdToObjectDataMap::iterator object_it = objects_data.insert(IdToObjectDataMap::value_type(curr_id, ObjectData(obj))).first;
-            // Store geometry of all ModelVolumes contained in a single ModelObject into a single 3MF indexed triangle set object.
-            // object_it->second.volumes_offsets will contain the offsets of the ModelVolumes in that single indexed triangle set.
-            // object_id will be increased to point to the 1st instance of the next ModelObject.
-            if (!_add_object_to_model_stream(stream, object_id, *obj, build_items, object_it->second.volumes_offsets))
+            objects.emplace_back(object_id, obj);
+            for (const ModelInstance* instance : obj->instances)
             {
+                assert(instance != nullptr);
+                if (instance == nullptr)
+                    continue;
+
+                // object_id is just a 1 indexed index in build_items.
+                assert(object_id == build_items.size() + 1);
+                build_items.emplace_back(object_id ++, instance->get_matrix(), instance->printable);
+            }
+        }
+
+        // Store geometry of all ModelVolumes contained in a single ModelObject into a single 3MF indexed triangle set object.
+        // volumes_offsets will contain the offsets of the ModelVolumes in that single indexed triangle set.
+        std::vector<VolumeToOffsetsMap> volumes_offsets(objects.size());
+        std::vector<unsigned char>      objects_valid(objects.size(), false);
+        size_t                          first_object_piece = pieces.size();
+        pieces.resize(first_object_piece + objects.size());
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, objects.size()),
+            [this, &objects, &volumes_offsets, &objects_valid, &pieces, first_object_piece](const tbb::blocked_range<size_t>& range) {
+            for (size_t i = range.begin(); i < range.end(); ++ i)
+            {
+                std::stringstream object_stream;
+                object_stream << std::setprecision(std::numeric_limits<float>::max_digits10);
+                if (_add_object_to_model_stream(object_stream, objects[i].first, *objects[i].second, volumes_offsets[i]))
+                {
+                    pieces[first_object_piece + i] = object_stream.str();
+                    objects_valid[i] = true;
+                }
+            }
+        });
+
+        for (size_t i = 0; i < objects.size(); ++ i)
+        {
+            if (!objects_valid[i])
+            {
+                add_error("Found invalid mesh");
                 add_error("Unable to add object to archive");
                 return false;
             }
+            IdToObjectDataMap::iterator object_it = objects_data.insert(IdToObjectDataMap::value_type(objects[i].first, ObjectData(objects[i].second))).first;
+            object_it->second.volumes_offsets = std::move(volumes_offsets[i]);
         }
 
+        stream.str("");
         stream << " </" << RESOURCES_TAG << ">\n";
 
         // Store the transformations of all the ModelInstances of all ModelObjects, indexed in a linear fashion.
@@ -2176,10 +2296,9 @@ namespace Slic3r {
         }
 
         stream << "</" << MODEL_TAG << ">\n";
+        pieces.emplace_back(stream.str());
 
-        std::string out = stream.str();
-
-        if (!mz_zip_writer_add_mem(&archive, MODEL_FILE.c_str(), (const void*)out.data(), out.length(), MZ_DEFAULT_COMPRESSION))
+        if (!add_pieces_to_archive(archive, MODEL_FILE, pieces))
         {
             add_error("Unable to add model file to archive");
             return false;
@@ -2188,12 +2307,12 @@ namespace Slic3r {
         return true;
     }
 
-    bool _3MF_Exporter::_add_object_to_model_stream(std::stringstream& stream, unsigned int& object_id, ModelObject& object, BuildItemsList& build_items, VolumeToOffsetsMap& volumes_offsets)
+    bool _3MF_Exporter::_add_object_to_model_stream(std::stringstream& stream, unsigned int object_id, ModelObject& object, VolumeToOffsetsMap& volumes_offsets)
     {
+        // Called from multiple threads in parallel, therefore errors are not reported here.
         unsigned int id = 0;
         for (const ModelInstance* instance : object.instances)
         {
-			assert(instance != nullptr);
             if (instance == nullptr)
                 continue;
 
@@ -2203,10 +2322,7 @@ namespace Slic3r {
             if (id == 0)
             {
                 if (!_add_mesh_to_object_stream(stream, object, volumes_offsets))
-                {
-                    add_error("Unable to add mesh to archive");
                     return false;
-                }
             }
             else
             {
@@ -2215,22 +2331,20 @@ namespace Slic3r {
                 stream << "   </" << COMPONENTS_TAG << ">\n";
             }
 
-            Transform3d t = instance->get_matrix();
-            // instance_id is just a 1 indexed index in build_items.
-            assert(instance_id == build_items.size() + 1);
-            build_items.emplace_back(instance_id, t, instance->printable);
-
             stream << "  </" << OBJECT_TAG << ">\n";
 
             ++id;
         }
 
-        object_id += id;
         return true;
     }
 
     bool _3MF_Exporter::_add_mesh_to_object_stream(std::stringstream& stream, ModelObject& object, VolumeToOffsetsMap& volumes_offsets)
     {
+        // The vertices and triangles are formatted with snprintf(), which is considerably faster than the formatted output of std::stream.
+        // "%.9g" produces the same output as the std::stream with std::setprecision(std::numeric_limits<float>::max_digits10).
+        char buf[256];
+
         stream << "   <" << MESH_TAG << ">\n";
         stream << "    <" << VERTICES_TAG << ">\n";
 
@@ -2249,10 +2363,7 @@ namespace Slic3r {
 
             const indexed_triangle_set &its = volume->mesh().its;
             if (its.vertices.empty())
-            {
-                add_error("Found invalid mesh");
                 return false;
-            }
 
             vertices_count += (int)its.vertices.size();
 
@@ -2260,11 +2371,9 @@ namespace Slic3r {
 
             for (size_t i = 0; i < its.vertices.size(); ++i)
             {
-                stream << "     <" << VERTEX_TAG << " ";
                 Vec3f v = (matrix * its.vertices[i].cast<double>()).cast<float>();
-                stream << "x=\"" << v(0) << "\" ";
-                stream << "y=\"" << v(1) << "\" ";
-                stream << "z=\"" << v(2) << "\" />\n";
+                int len = ::snprintf(buf, sizeof(buf), "     <%s x=\"%.9g\" y=\"%.9g\" z=\"%.9g\" />\n", VERTEX_TAG, v(0), v(1), v(2));
+                stream.write(buf, len);
             }
         }
 
@@ -2287,14 +2396,12 @@ namespace Slic3r {
             triangles_count += (int)its.indices.size();
             volume_it->second.last_triangle_id = triangles_count - 1;
 
+            unsigned int first_vertex_id = volume_it->second.first_vertex_id;
             for (size_t i = 0; i < its.indices.size(); ++ i)
             {
-                stream << "     <" << TRIANGLE_TAG << " ";
-                for (int j = 0; j < 3; ++j)
-                {
-                    stream << "v" << j + 1 << "=\"" << its.indices[i][j] + volume_it->second.first_vertex_id << "\" ";
-                }
-                stream << "/>\n";
+                int len = ::snprintf(buf, sizeof(buf), "     <%s v1=\"%u\" v2=\"%u\" v3=\"%u\" />\n", TRIANGLE_TAG,
+                    its.indices[i][0] + first_vertex_id, its.indices[i][1] + first_vertex_id, its.indices[i][2] + first_vertex_id);
+                stream.write(buf, len);
             }
         }
 
@@ -25,6 +25,8 @@ namespace pt = boost::property_tree;
 #include <boost/nowide/fstream.hpp>
 #include "miniz_extension.hpp"
 
+#include <tbb/parallel_for.h>
+
 #if 0
 // Enable debugging and assert in this file.
 #define DEBUG
@@ -227,10 +229,22 @@ struct AMFParserContext
     std::map<std::string, Object> m_object_instances_map;
     // Vertices parsed for the current m_object.
     std::vector<float>       m_object_vertices;
+    // Vertices of the closed objects, referenced by m_volumes_to_build.
+    std::vector<std::vector<float>> m_objects_vertices;
     // Current volume allocated for an amf/object/mesh/volume subtree.
     ModelVolume             *m_volume;
     // Faces collected for the current m_volume.
     std::vector<int>         m_volume_facets;
+    // Closed volume, its mesh is built by endDocument() together with the meshes of the other volumes.
+    struct VolumeToBuild
+    {
+        ModelVolume         *volume;
+        // Index of the vertices of the volume's object in m_objects_vertices.
+        size_t               object_vertices_idx;
+        std::vector<int>     facets;
+        bool                 update_source_offset;
+    };
+    std::vector<VolumeToBuild> m_volumes_to_build;
     // Transformation matrix of a volume mesh from its coordinate system to Object's coordinate system.
     Transform3d 			 m_volume_transform;
     // Current material allocated for an amf/metadata subtree.
@@ -573,43 +587,20 @@ void AMFParserContext::endElement(const char * /* name */)
         m_value[2].clear();
         break;
 
-    // Closing the current volume. Create an STL from m_volume_facets pointing to m_object_vertices.
+    // Closing the current volume. The STL from m_volume_facets pointing to m_object_vertices is created by endDocument().
     case NODE_TYPE_VOLUME:
     {
 		assert(m_object && m_volume);
-		TriangleMesh  mesh;
-        stl_file	 &stl = mesh.stl;
-        stl.stats.type = inmemory;
-        stl.stats.number_of_facets = int(m_volume_facets.size() / 3);
-        stl.stats.original_num_facets = stl.stats.number_of_facets;
-        stl_allocate(&stl);
-
-        bool has_transform = ! m_volume_transform.isApprox(Transform3d::Identity(), 1e-10);
-        for (size_t i = 0; i < m_volume_facets.size();) {
-            stl_facet &facet = stl.facet_start[i/3];
-            for (unsigned int v = 0; v < 3; ++v)
-            {
-                unsigned int tri_id = m_volume_facets[i++] * 3;
-                facet.vertex[v] = Vec3f(m_object_vertices[tri_id + 0], m_object_vertices[tri_id + 1], m_object_vertices[tri_id + 2]);
-            }
-        }        
-        stl_get_size(&stl);
-        mesh.repair();
-		m_volume->set_mesh(std::move(mesh));
         // stores the volume matrix taken from the metadata, if present
-        if (has_transform)
+        if (! m_volume_transform.isApprox(Transform3d::Identity(), 1e-10))
             m_volume->source.transform = Slic3r::Geometry::Transformation(m_volume_transform);
         if (m_volume->source.input_file.empty() && (m_volume->type() == ModelVolumeType::MODEL_PART))
         {
             m_volume->source.object_idx = (int)m_model.objects.size() - 1;
             m_volume->source.volume_idx = (int)m_model.objects.back()->volumes.size() - 1;
-            m_volume->center_geometry_after_creation();
         }
-        else
-            // pass false if the mesh offset has been already taken from the data 
-            m_volume->center_geometry_after_creation(m_volume->source.input_file.empty());
-
-        m_volume->calculate_convex_hull();
+        // pass false if the mesh offset has been already taken from the data 
+        m_volumes_to_build.push_back({ m_volume, m_objects_vertices.size(), std::move(m_volume_facets), m_volume->source.input_file.empty() });
         m_volume_facets.clear();
         m_volume = nullptr;
         break;
@@ -617,6 +608,7 @@ void AMFParserContext::endElement(const char * /* name */)
 
     case NODE_TYPE_OBJECT:
         assert(m_object);
+        m_objects_vertices.emplace_back(std::move(m_object_vertices));
         m_object_vertices.clear();
         m_object = nullptr;
         break;
@@ -766,6 +758,37 @@ void AMFParserContext::endElement(const char * /* name */)
 
 void AMFParserContext::endDocument()
 {
+    // Creates the STLs of the volumes, repairs them and calculates their convex hulls in parallel.
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, m_volumes_to_build.size()), [this](const tbb::blocked_range<size_t>& range) {
+        for (size_t volume_idx = range.begin(); volume_idx < range.end(); ++ volume_idx)
+        {
+            VolumeToBuild &volume = m_volumes_to_build[volume_idx];
+            const std::vector<float> &vertices = m_objects_vertices[volume.object_vertices_idx];
+            TriangleMesh  mesh;
+            stl_file     &stl = mesh.stl;
+            stl.stats.type = inmemory;
+            stl.stats.number_of_facets = int(volume.facets.size() / 3);
+            stl.stats.original_num_facets = stl.stats.number_of_facets;
+            stl_allocate(&stl);
+            for (size_t i = 0; i < volume.facets.size();) {
+                stl_facet &facet = stl.facet_start[i/3];
+                for (unsigned int v = 0; v < 3; ++v)
+                {
+                    unsigned int tri_id = volume.facets[i++] * 3;
+                    facet.vertex[v] = Vec3f(vertices[tri_id + 0], vertices[tri_id + 1], vertices[tri_id + 2]);
+                }
+            }
+            stl_get_size(&stl);
+            mesh.repair();
+            volume.volume->set_mesh(std::move(mesh));
+            volume.volume->center_geometry_after_creation(volume.update_source_offset);
+            volume.volume->calculate_convex_hull();
+            volume.facets = std::vector<int>();
+        }
+    });
+    m_volumes_to_build.clear();
+    m_objects_vertices.clear();
+
     for (const auto &object : m_object_instances_map) {
         if (object.second.idx == -1) {
             printf("Undefined object %s referenced in constellation\n", object.first.c_str());
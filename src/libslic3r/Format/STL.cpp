@@ -6,6 +6,12 @@
 
 #include <string>
 
+#include <boost/log/trivial.hpp>
+#include <boost/nowide/cstdio.hpp>
+#include <boost/predef/other/endian.h>
+
+#include <tbb/parallel_for.h>
+
 #ifdef _WIN32
 #define DIR_SEPARATOR '\\'
 #else
@@ -48,14 +54,100 @@ bool store_stl(const char *path, TriangleMesh *mesh, bool binary)
     return true;
 }
 
+// Mesh of a model part of an object instance to be stored, with its transformation to world coordinates.
+struct MeshToStore
+{
+    const TriangleMesh *mesh;
+    Transform3d         trafo;
+};
+
+// The meshes merged by ModelObject::mesh(), in the same order.
+static void append_meshes_to_store(const ModelObject &model_object, std::vector<MeshToStore> &out)
+{
+    for (const ModelInstance *instance : model_object.instances)
+        for (const ModelVolume *volume : model_object.volumes)
+            if (volume->is_model_part())
+                out.push_back({ &volume->mesh(), instance->get_matrix() * volume->get_matrix() });
+}
+
+// Store the transformed facets of the meshes into a binary STL without merging the meshes first.
+// The facets are transformed into a large output buffer in parallel, the buffer is written at once.
+static bool store_stl_binary(const char *path, const std::vector<MeshToStore> &meshes)
+{
+    size_t num_facets = 0;
+    for (const MeshToStore &mesh : meshes)
+        num_facets += mesh.mesh->stl.facet_start.size();
+
+    FILE *fp = boost::nowide::fopen(path, "wb");
+    if (fp == nullptr) {
+        BOOST_LOG_TRIVIAL(error) << "store_stl: Couldn't open " << path << " for writing";
+        return false;
+    }
+
+    auto to_little_endian = [](char *buf, size_t cnt) {
+#if BOOST_ENDIAN_BIG_BYTE
+        for (size_t i = 0; i < cnt; i += 4) {
+            std::swap(buf[i], buf[i + 3]);
+            std::swap(buf[i + 1], buf[i + 2]);
+        }
+#endif /* BOOST_ENDIAN_BIG_BYTE */
+    };
+
+    char header[HEADER_SIZE] = { 0 };
+    uint32_t num_facets_stored = uint32_t(num_facets);
+    memcpy(header + LABEL_SIZE, &num_facets_stored, 4);
+    to_little_endian(header + LABEL_SIZE, 4);
+    bool ok = fwrite(header, HEADER_SIZE, 1, fp) == 1;
+
+    const size_t max_facets_in_buffer = 65536;
+    std::vector<char> buffer(SIZEOF_STL_FACET * std::min(num_facets, max_facets_in_buffer));
+    for (const MeshToStore &mesh : meshes) {
+        const std::vector<stl_facet> &facets = mesh.mesh->stl.facet_start;
+        const Matrix3d normal_trafo = mesh.trafo.matrix().block<3, 3>(0, 0).inverse().transpose();
+        for (size_t begin = 0; ok && begin < facets.size(); begin += max_facets_in_buffer) {
+            size_t end = std::min(facets.size(), begin + max_facets_in_buffer);
+            tbb::parallel_for(tbb::blocked_range<size_t>(begin, end), [&facets, &mesh, &normal_trafo, &buffer, begin, &to_little_endian](const tbb::blocked_range<size_t> &range) {
+                for (size_t i = range.begin(); i < range.end(); ++ i) {
+                    // Transformed the same way as by TriangleMesh::transform().
+                    stl_facet facet = facets[i];
+                    for (size_t j = 0; j < 3; ++ j)
+                        facet.vertex[j] = (mesh.trafo * facet.vertex[j].cast<double>()).cast<float>();
+                    facet.normal = (normal_trafo * facet.normal.cast<double>()).cast<float>();
+                    char *dst = buffer.data() + (i - begin) * SIZEOF_STL_FACET;
+                    memcpy(dst, &facet, SIZEOF_STL_FACET);
+                    to_little_endian(dst, 48);
+                }
+            });
+            ok = fwrite(buffer.data(), SIZEOF_STL_FACET, end - begin, fp) == end - begin;
+        }
+    }
+
+    if (fclose(fp) != 0)
+        ok = false;
+    if (! ok)
+        BOOST_LOG_TRIVIAL(error) << "store_stl: Failed writing " << path;
+    return ok;
+}
+
 bool store_stl(const char *path, ModelObject *model_object, bool binary)
 {
+    if (binary) {
+        std::vector<MeshToStore> meshes;
+        append_meshes_to_store(*model_object, meshes);
+        return store_stl_binary(path, meshes);
+    }
     TriangleMesh mesh = model_object->mesh();
     return store_stl(path, &mesh, binary);
 }
 
 bool store_stl(const char *path, Model *model, bool binary)
 {
+    if (binary) {
+        std::vector<MeshToStore> meshes;
+        for (const ModelObject *model_object : model->objects)
+            append_meshes_to_store(*model_object, meshes);
+        return store_stl_binary(path, meshes);
+    }
     TriangleMesh mesh = model->mesh();
     return store_stl(path, &mesh, binary);
 }
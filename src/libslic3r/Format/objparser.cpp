@@ -3,12 +3,32 @@
 
 #include <boost/nowide/cstdio.hpp>
 
+#include <tbb/parallel_for.h>
+
 #include "objparser.hpp"
 
 namespace ObjParser {
 
-static bool obj_parseline(const char *line, ObjData &data)
+enum ObjRelativeIdx {
+	RelativeCoordIdx		= 1,
+	RelativeTextureCoordIdx	= 2,
+	RelativeNormalIdx		= 4
+};
+
+// Part of an OBJ file parsed independently of the preceding parts.
+struct ObjChunk
 {
+	ObjData 							data;
+	// Indices of data.vertices, which reference the coordinates, texture coordinates or normals relative to the end of the chunk
+	// (negative indices in the OBJ file), together with a mask of ObjRelativeIdx. These are shifted by obj_append() once
+	// the number of coordinates, texture coordinates and normals of the preceding chunks is known.
+	std::vector<std::pair<size_t, int>> relative;
+};
+
+static bool obj_parseline(const char *line, ObjChunk &chunk)
+{
+	ObjData &data = chunk.data;
+
 #define EATWS() while (*line == ' ' || *line == '\t') ++ line
 
 	if (*line == 0)
@@ -212,18 +232,24 @@ static bool obj_parseline(const char *line, ObjData &data)
 					line = endptr;
 				}
 			}
-			if (vertex.coordIdx < 0)
+			int relative = 0;
+			if (vertex.coordIdx < 0) {
                 vertex.coordIdx += (int)data.coordinates.size() / 4;
-            else
+				relative |= RelativeCoordIdx;
+			} else
 				-- vertex.coordIdx;
-			if (vertex.normalIdx < 0)
+			if (vertex.normalIdx < 0) {
                 vertex.normalIdx += (int)data.normals.size() / 3;
-            else
+				relative |= RelativeNormalIdx;
+			} else
 				-- vertex.normalIdx;
-			if (vertex.textureCoordIdx < 0)
+			if (vertex.textureCoordIdx < 0) {
                 vertex.textureCoordIdx += (int)data.textureCoordinates.size() / 3;
-            else
+				relative |= RelativeTextureCoordIdx;
+			} else
 				-- vertex.textureCoordIdx;
+			if (relative)
+				chunk.relative.emplace_back(data.vertices.size(), relative);
 			data.vertices.push_back(vertex);
 			EATWS();
 		}
@@ -319,6 +345,58 @@ static bool obj_parseline(const char *line, ObjData &data)
 	return true;
 }
 
+// Parse the lines of buf[0, len) terminated by '\r' or '\n', the line ends are overwritten with zeros.
+static void obj_parselines(char *buf, size_t len, ObjChunk &chunk)
+{
+	size_t lastLine = 0;
+	for (size_t i = 0; i < len; ++ i)
+		if (buf[i] == '\r' || buf[i] == '\n') {
+			buf[i] = 0;
+			char *c = buf + lastLine;
+			while (*c == ' ' || *c == '\t')
+				++ c;
+			obj_parseline(c, chunk);
+			lastLine = i + 1;
+		}
+}
+
+template<typename T> static void obj_append_named(std::vector<T> &dst, std::vector<T> &src, int vertex_idx_offset)
+{
+	for (T &item : src) {
+		item.vertexIdxFirst += vertex_idx_offset;
+		dst.emplace_back(std::move(item));
+	}
+}
+
+// Append a chunk parsed by obj_parselines() to data, shift the indices of the chunk by the sizes of data.
+static void obj_append(ObjData &data, ObjChunk &chunk)
+{
+	const int coord_offset			= (int)data.coordinates.size() / 4;
+	const int texture_coord_offset	= (int)data.textureCoordinates.size() / 3;
+	const int normal_offset			= (int)data.normals.size() / 3;
+	const int vertex_idx_offset		= (int)data.vertices.size();
+	for (const std::pair<size_t, int> &relative : chunk.relative) {
+		ObjVertex &vertex = chunk.data.vertices[relative.first];
+		if (relative.second & RelativeCoordIdx)
+			vertex.coordIdx += coord_offset;
+		if (relative.second & RelativeTextureCoordIdx)
+			vertex.textureCoordIdx += texture_coord_offset;
+		if (relative.second & RelativeNormalIdx)
+			vertex.normalIdx += normal_offset;
+	}
+	data.coordinates.insert(data.coordinates.end(), chunk.data.coordinates.begin(), chunk.data.coordinates.end());
+	data.textureCoordinates.insert(data.textureCoordinates.end(), chunk.data.textureCoordinates.begin(), chunk.data.textureCoordinates.end());
+	data.normals.insert(data.normals.end(), chunk.data.normals.begin(), chunk.data.normals.end());
+	data.parameters.insert(data.parameters.end(), chunk.data.parameters.begin(), chunk.data.parameters.end());
+	data.vertices.insert(data.vertices.end(), chunk.data.vertices.begin(), chunk.data.vertices.end());
+	for (std::string &mtllib : chunk.data.mtllibs)
+		data.mtllibs.emplace_back(std::move(mtllib));
+	obj_append_named(data.usemtls, chunk.data.usemtls, vertex_idx_offset);
+	obj_append_named(data.objects, chunk.data.objects, vertex_idx_offset);
+	obj_append_named(data.groups, chunk.data.groups, vertex_idx_offset);
+	obj_append_named(data.smoothingGroups, chunk.data.smoothingGroups, vertex_idx_offset);
+}
+
 bool objparse(const char *path, ObjData &data)
 {
 	FILE *pFile = boost::nowide::fopen(path, "rt");
@@ -326,23 +404,51 @@ bool objparse(const char *path, ObjData &data)
 		return false;
 
 	try {
-		char buf[65536 * 2];
+		// The file is read in large blocks. Each block is split at line ends into chunks, which are parsed in parallel
+		// and then appended to data in their original order.
+		const size_t 		block_size = 16 * 1024 * 1024;
+		const size_t 		chunk_size = 256 * 1024;
+		std::vector<char> 	buf(block_size * 2 + 1);
+		std::vector<size_t> chunk_starts;
+		std::vector<ObjChunk> chunks;
 		size_t len = 0;
 		size_t lenPrev = 0;
-		while ((len = ::fread(buf + lenPrev, 1, 65536, pFile)) != 0) {
+		for (;;) {
+			len = ::fread(buf.data() + lenPrev, 1, block_size, pFile);
+			bool eof = len == 0;
 			len += lenPrev;
-			size_t lastLine = 0;
-			for (size_t i = 0; i < len; ++ i)
-				if (buf[i] == '\r' || buf[i] == '\n') {
-					buf[i] = 0;
-					char *c = buf + lastLine;
-					while (*c == ' ' || *c == '\t')
-						++ c;
-					obj_parseline(c, data);
-					lastLine = i + 1;
-				}
+			if (eof) {
+				if (len == 0)
+					break;
+				// Terminate the last line of a file not ending with a new line.
+				buf[len ++] = '\n';
+			}
+			// Split the complete lines of the block into chunks.
+			size_t lastLine = len;
+			while (lastLine > 0 && buf[lastLine - 1] != '\r' && buf[lastLine - 1] != '\n')
+				-- lastLine;
+			chunk_starts.clear();
+			for (size_t i = 0; i < lastLine;) {
+				chunk_starts.emplace_back(i);
+				i = std::min(i + chunk_size, lastLine);
+				while (i < lastLine && buf[i - 1] != '\r' && buf[i - 1] != '\n')
+					++ i;
+			}
+			chunk_starts.emplace_back(lastLine);
+			chunks.assign(chunk_starts.size() - 1, ObjChunk());
+			tbb::parallel_for(tbb::blocked_range<size_t>(0, chunks.size()), [&buf, &chunk_starts, &chunks](const tbb::blocked_range<size_t> &range) {
+				for (size_t i = range.begin(); i < range.end(); ++ i)
+					obj_parselines(buf.data() + chunk_starts[i], chunk_starts[i + 1] - chunk_starts[i], chunks[i]);
+			});
+			for (ObjChunk &chunk : chunks)
+				obj_append(data, chunk);
+			if (eof)
+				break;
 			lenPrev = len - lastLine;
-			memmove(buf, buf + lastLine, lenPrev);
+			if (lenPrev > block_size)
+				// A line longer than the block size is not a valid OBJ line, drop its beginning.
+				lenPrev = 0;
+			memmove(buf.data(), buf.data() + lastLine, lenPrev);
 		}
     }
     catch (std::bad_alloc&) {
@@ -4,6 +4,7 @@
 #include "ExtrusionEntity.hpp"
 #include "EdgeGrid.hpp"
 #include "Geometry.hpp"
+#include "GCode/ArcFitter.hpp"
 #include "GCode/PrintExtents.hpp"
 #include "GCode/WipeTower.hpp"
 #include "ShortestPath.hpp"
@@ -17,6 +18,7 @@
 #include <boost/algorithm/string/find.hpp>
 #include <boost/foreach.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/functional/hash.hpp>
 #include <boost/log/trivial.hpp>
 #if ENABLE_THUMBNAIL_GENERATOR
 #include <boost/beast/core/detail/base64.hpp>
@@ -29,6 +31,8 @@
 #include "SVG.hpp"
 
 #include <tbb/parallel_for.h>
+#include <tbb/pipeline.h>
+#include <tbb/task_group.h>
 
 #include <Shiny/Shiny.h>
 
@@ -50,6 +54,9 @@ namespace Slic3r {
 #define L(s) (s)
 #define _(s) Slic3r::I18N::translate(s)
 
+// Lines M73 are reserved after each this number of extruding G1 lines, the remaining times are updated at most that often.
+static const unsigned int Reserved_M73_Lines_Interval = 128;
+
 // Only add a newline in case the current G-code does not end with a newline.
 static inline void check_add_eol(std::string &gcode)
 {
@@ -421,56 +428,71 @@ std::string WipeTowerIntegration::post_process_wipe_tower_moves(const WipeTower:
 {
     Vec2f extruder_offset = m_extruder_offsets[tcr.initial_tool].cast<float>();
 
-    std::istringstream gcode_str(tcr.gcode);
     std::string gcode_out;
+    gcode_out.reserve(tcr.gcode.size() + tcr.gcode.size() / 4);
     std::string line;
+    std::string line_out;
     Vec2f pos = tcr.start_pos;
     Vec2f transformed_pos = pos;
     Vec2f old_pos(-1000.1f, -1000.1f);
-    std::string never_skip_tag = WipeTower::never_skip_tag();
+    const std::string never_skip_tag = WipeTower::never_skip_tag();
+    const Eigen::Rotation2Df rotation(angle);
+    char buf[64];
 
-    while (gcode_str) {
-        std::getline(gcode_str, line);  // we read the gcode line by line
+    // The source G-code is scanned in place line by line, the lines are split at '\n' including the empty tail.
+    for (const char *line_start = tcr.gcode.c_str(), *gcode_end = line_start + tcr.gcode.size();;) {
+        const char *line_end = std::find(line_start, gcode_end, '\n');
+        line.assign(line_start, line_end);
 
         // All G1 commands should be translated and rotated. X and Y coords are
         // only pushed to the output when they differ from last time.
         // WT generator can override this by appending the never_skip_tag
-        if (line.find("G1 ") == 0) {
+        if (boost::starts_with(line, "G1 ")) {
             bool never_skip = false;
             auto it = line.find(never_skip_tag);
             if (it != std::string::npos) {
                 // remove the tag and remember we saw it
                 never_skip = true;
-                line.erase(it, it+never_skip_tag.size());
+                line.erase(it, never_skip_tag.size());
             }
-            std::ostringstream line_out;
-            std::istringstream line_str(line);
-            line_str >> std::noskipws;  // don't skip whitespace
-            char ch = 0;
-            while (line_str >> ch) {
-                if (ch == 'X' || ch =='Y')
-                    line_str >> (ch == 'X' ? pos.x() : pos.y());
-                else
-                    line_out << ch;
+            // Extract the X and Y coordinates, keep the rest of the line.
+            line_out.clear();
+            for (const char *c = line.c_str(); *c != 0;) {
+                if (*c == 'X' || *c == 'Y') {
+                    float &coord = (*c == 'X') ? pos.x() : pos.y();
+                    ++ c;
+                    char *num_end = nullptr;
+                    coord = (*c == ' ' || *c == '\t') ? 0.f : strtof(c, &num_end);
+                    if (num_end == nullptr || num_end == c) {
+                        // Failed to parse the coordinate, ignore the rest of the line.
+                        coord = 0.f;
+                        break;
+                    }
+                    c = num_end;
+                } else
+                    line_out += *c ++;
             }
 
-            transformed_pos = Eigen::Rotation2Df(angle) * pos + translation;
+            transformed_pos = rotation * pos + translation;
 
             if (transformed_pos != old_pos || never_skip) {
-                line = line_out.str();
-                std::ostringstream oss;
-                oss << std::fixed << std::setprecision(3) << "G1 ";
-                if (transformed_pos.x() != old_pos.x() || never_skip)
-                    oss << " X" << transformed_pos.x() - extruder_offset.x();
-                if (transformed_pos.y() != old_pos.y() || never_skip)
-                    oss << " Y" << transformed_pos.y() - extruder_offset.y();
-                oss << " ";
-                line.replace(line.find("G1 "), 3, oss.str());
+                line.assign("G1 ", 3);
+                if (transformed_pos.x() != old_pos.x() || never_skip) {
+                    sprintf(buf, " X%.3f", transformed_pos.x() - extruder_offset.x());
+                    line += buf;
+                }
+                if (transformed_pos.y() != old_pos.y() || never_skip) {
+                    sprintf(buf, " Y%.3f", transformed_pos.y() - extruder_offset.y());
+                    line += buf;
+                }
+                line += ' ';
+                line.append(line_out, 3, std::string::npos);
                 old_pos = transformed_pos;
             }
         }
 
-        gcode_out += line + "\n";
+        gcode_out += line;
+        gcode_out += '\n';
 
         // If this was a toolchange command, we should change current extruder offset
         if (line == "[toolchange_gcode]") {
@@ -478,14 +500,14 @@ std::string WipeTowerIntegration::post_process_wipe_tower_moves(const WipeTower:
 
             // If the extruder offset changed, add an extra move so everything is continuous
             if (extruder_offset != m_extruder_offsets[tcr.initial_tool].cast<float>()) {
-                std::ostringstream oss;
-                oss << std::fixed << std::setprecision(3)
-                    << "G1 X" << transformed_pos.x() - extruder_offset.x()
-                    << " Y"   << transformed_pos.y() - extruder_offset.y()
-                    << "\n";
-                gcode_out += oss.str();
+                sprintf(buf, "G1 X%.3f Y%.3f\n", transformed_pos.x() - extruder_offset.x(), transformed_pos.y() - extruder_offset.y());
+                gcode_out += buf;
             }
         }
+
+        if (line_end == gcode_end)
+            break;
+        line_start = line_end + 1;
     }
     return gcode_out;
 }
@@ -724,17 +746,16 @@ void GCode::do_export(Print *print, const char *path, GCodePreviewData *preview_
 
     try {
         m_placeholder_parser_failed_templates.clear();
+        GCodeOutputStream stream(file);
 #if ENABLE_THUMBNAIL_GENERATOR
-        this->_do_export(*print, file, thumbnail_cb);
+        this->_do_export(*print, stream, thumbnail_cb);
 #else
-        this->_do_export(*print, file);
+        this->_do_export(*print, stream);
 #endif // ENABLE_THUMBNAIL_GENERATOR
+        bool flushed = stream.flush();
         fflush(file);
-        if (ferror(file)) {
-            fclose(file);
-            boost::nowide::remove(path_tmp.c_str());
+        if (! flushed || ferror(file))
             throw std::runtime_error(std::string("G-code export to ") + path + " failed\nIs the disk full?\n");
-        }
     } catch (std::exception & /* ex */) {
         // Rethrow on any exception. std::runtime_exception and CanceledException are expected to be thrown.
         // Close and remove the file.
@@ -760,11 +781,32 @@ void GCode::do_export(Print *print, const char *path, GCodePreviewData *preview_
     GCodeTimeEstimator::PostProcessData normal_data = m_normal_time_estimator.get_post_process_data();
     GCodeTimeEstimator::PostProcessData silent_data = m_silent_time_estimator.get_post_process_data();
 
-    bool remaining_times_enabled = print->config().remaining_times.value;
+    bool remaining_times_enabled = m_remaining_times;
 
-    BOOST_LOG_TRIVIAL(debug) << "Time estimator post processing" << log_memory_info();
-    GCodeTimeEstimator::post_process(path_tmp, 60.0f, remaining_times_enabled ? &normal_data : nullptr, (remaining_times_enabled && m_silent_time_estimator_enabled) ? &silent_data : nullptr);
+    // The analyzer only works on the G-code lines it collected during the export, not on the file,
+    // therefore the preview data is calculated while the time estimator post-processes the file.
+    tbb::task_group task_group;
+    if (m_enable_analyzer)
+        task_group.run([this, print, preview_data]() {
+            BOOST_LOG_TRIVIAL(debug) << "Preparing G-code preview data" << log_memory_info();
+            m_analyzer.calc_gcode_preview_data(*preview_data, [print]() { print->throw_if_canceled(); });
+            m_analyzer.reset();
+        });
 
+    try {
+        BOOST_LOG_TRIVIAL(debug) << "Time estimator post processing" << log_memory_info();
+        // Fills in the lines M73 reserved during the export, the file is not rewritten.
+        if (remaining_times_enabled)
+            GCodeTimeEstimator::post_process(path_tmp, 60.0f, m_reserved_M73_lines, &normal_data, m_silent_time_estimator_enabled ? &silent_data : nullptr);
+    } catch (...) {
+        // Don't leave the analyzer running on this GCode instance.
+        try { task_group.wait(); } catch (...) {}
+        throw;
+    }
+    // Rethrows the exception of the analyzer, for example the CanceledException.
+    task_group.wait();
+
+    m_reserved_M73_lines.clear();
     if (remaining_times_enabled)
     {
         m_normal_time_estimator.reset();
@@ -772,11 +814,20 @@ void GCode::do_export(Print *print, const char *path, GCodePreviewData *preview_
             m_silent_time_estimator.reset();
     }
 
-    // starts analyzer calculations
-    if (m_enable_analyzer) {
-        BOOST_LOG_TRIVIAL(debug) << "Preparing G-code preview data" << log_memory_info();
-        m_analyzer.calc_gcode_preview_data(*preview_data, [print]() { print->throw_if_canceled(); });
-        m_analyzer.reset();
+    if (m_binary_gcode) {
+        BOOST_LOG_TRIVIAL(debug) << "Converting to binary G-code" << log_memory_info();
+        std::string path_ascii = path_tmp + ".ascii";
+        if (rename_file(path_tmp, path_ascii))
+            throw std::runtime_error(std::string("Failed to rename the output G-code file from ") + path_tmp + " to " + path_ascii + '\n');
+        try {
+            BinaryGCode::convert_ascii_to_binary(path_ascii, path_tmp, m_binary_thumbnails, m_binary_config);
+        } catch (...) {
+            boost::nowide::remove(path_ascii.c_str());
+            throw;
+        }
+        boost::nowide::remove(path_ascii.c_str());
+        m_binary_thumbnails.clear();
+        m_binary_config.clear();
     }
 
     if (rename_file(path_tmp, path))
@@ -792,6 +843,70 @@ void GCode::do_export(Print *print, const char *path, GCodePreviewData *preview_
     PROFILE_OUTPUT(debug_out_path("gcode-export-profile.txt").c_str());
 }
 
+GCodeOutputStream::GCodeOutputStream(FILE *file, size_t block_size) : m_file(file), m_block_size(block_size), m_size(0), m_error(false)
+{
+    assert(m_file != nullptr);
+    // The G-code is passed to the file in large blocks, the stdio buffering would only add another copy.
+    ::setvbuf(m_file, nullptr, _IONBF, 0);
+    m_buffer.reserve(m_block_size);
+}
+
+void GCodeOutputStream::write(const char *data, size_t len)
+{
+    m_size += len;
+    if (m_file != nullptr && m_buffer.size() + len > m_block_size) {
+        this->flush();
+        if (len >= m_block_size) {
+            // Don't copy huge chunks (for example the thumbnails) into the buffer, write them directly.
+            if (! m_error && ::fwrite(data, 1, len, m_file) != len)
+                m_error = true;
+            return;
+        }
+    }
+    m_buffer.append(data, len);
+}
+
+void GCodeOutputStream::write_format(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    // Format directly into the tail of the buffer. Most of the formatted lines are short, so a single attempt is usually sufficient.
+    size_t old_size = m_buffer.size();
+    size_t reserved = 256;
+    for (;;) {
+        m_buffer.resize(old_size + reserved);
+        va_list args2;
+        va_copy(args2, args);
+        int len = ::vsnprintf(&m_buffer[old_size], reserved, format, args2);
+        va_end(args2);
+        if (len < 0) {
+            // Formatting error.
+            m_buffer.resize(old_size);
+            break;
+        }
+        if (size_t(len) < reserved) {
+            m_buffer.resize(old_size + size_t(len));
+            break;
+        }
+        reserved = size_t(len) + 1;
+    }
+    va_end(args);
+    m_size += m_buffer.size() - old_size;
+    if (m_file != nullptr && m_buffer.size() > m_block_size)
+        this->flush();
+}
+
+bool GCodeOutputStream::flush()
+{
+    if (m_file != nullptr && ! m_buffer.empty()) {
+        if (! m_error && ::fwrite(m_buffer.data(), 1, m_buffer.size(), m_file) != m_buffer.size())
+            m_error = true;
+        // Keep the capacity of the buffer for the next block.
+        m_buffer.clear();
+    }
+    return ! m_error;
+}
+
 // free functions called by GCode::_do_export()
 namespace DoExport {
 	static void init_time_estimators(const PrintConfig &config, GCodeTimeEstimator &normal_time_estimator, GCodeTimeEstimator &silent_time_estimator, bool &silent_time_estimator_enabled)
@@ -970,7 +1085,9 @@ namespace DoExport {
 
 	#if ENABLE_THUMBNAIL_GENERATOR
 	template<typename WriteToOutput, typename ThrowIfCanceledCallback>
-	static void export_thumbnails_to_file(ThumbnailsGeneratorCallback &thumbnail_cb, const std::vector<Vec2d> &sizes, WriteToOutput output, ThrowIfCanceledCallback throw_if_canceled)
+	static void export_thumbnails_to_file(ThumbnailsGeneratorCallback &thumbnail_cb, const std::vector<Vec2d> &sizes, WriteToOutput output, ThrowIfCanceledCallback throw_if_canceled,
+	    // If not null, the PNG images are collected for the metadata blocks of the binary G-code instead of being written to the output.
+	    std::vector<BinaryGCode::Thumbnail> *binary_thumbnails = nullptr)
 	{
 	    // Write thumbnails using base64 encoding
 	    if (thumbnail_cb != nullptr)
@@ -978,35 +1095,55 @@ namespace DoExport {
 	        const size_t max_row_length = 78;
 	        ThumbnailsList thumbnails;
 	        thumbnail_cb(thumbnails, sizes, true, true, true, true);
-	        for (const ThumbnailData& data : thumbnails)
-	        {
-	            if (data.is_valid())
-	            {
-	                size_t png_size = 0;
-	                void* png_data = tdefl_write_image_to_png_file_in_memory_ex((const void*)data.pixels.data(), data.width, data.height, 4, &png_size, MZ_DEFAULT_LEVEL, 1);
-	                if (png_data != nullptr)
-	                {
-	                    std::string encoded;
-	                    encoded.resize(boost::beast::detail::base64::encoded_size(png_size));
-	                    encoded.resize(boost::beast::detail::base64::encode((void*)&encoded[0], (const void*)png_data, png_size));
-
-	                    output((boost::format("\n;\n; thumbnail begin %dx%d %d\n") % data.width % data.height % encoded.size()).str().c_str());
 
-	                    unsigned int row_count = 0;
-	                    while (encoded.size() > max_row_length)
+	        // Compress and encode the thumbnails in parallel, then write them in their order.
+	        std::vector<std::string> encoded(thumbnails.size());
+	        tbb::parallel_for(tbb::blocked_range<size_t>(0, thumbnails.size(), 1), [&thumbnails, &encoded, binary_thumbnails](const tbb::blocked_range<size_t> &range) {
+	            for (size_t i = range.begin(); i < range.end(); ++ i) {
+	                const ThumbnailData &data = thumbnails[i];
+	                if (data.is_valid())
+	                {
+	                    size_t png_size = 0;
+	                    void* png_data = tdefl_write_image_to_png_file_in_memory_ex((const void*)data.pixels.data(), data.width, data.height, 4, &png_size, MZ_DEFAULT_LEVEL, 1);
+	                    if (png_data != nullptr)
 	                    {
-	                        output((boost::format("; %s\n") % encoded.substr(0, max_row_length)).str().c_str());
-	                        encoded = encoded.substr(max_row_length);
-	                        ++row_count;
+	                        if (binary_thumbnails != nullptr)
+	                            encoded[i].assign((const char*)png_data, png_size);
+	                        else {
+	                            encoded[i].resize(boost::beast::detail::base64::encoded_size(png_size));
+	                            encoded[i].resize(boost::beast::detail::base64::encode((void*)&encoded[i][0], (const void*)png_data, png_size));
+	                        }
+	                        mz_free(png_data);
 	                    }
+	                }
+	            }
+	        });
+
+	        if (binary_thumbnails != nullptr) {
+	            for (size_t i = 0; i < thumbnails.size(); ++ i)
+	                if (! encoded[i].empty()) {
+	                    BinaryGCode::Thumbnail thumbnail;
+	                    thumbnail.width  = uint16_t(thumbnails[i].width);
+	                    thumbnail.height = uint16_t(thumbnails[i].height);
+	                    thumbnail.png    = std::move(encoded[i]);
+	                    binary_thumbnails->emplace_back(std::move(thumbnail));
+	                }
+	            throw_if_canceled();
+	            return;
+	        }
 
-	                    if (encoded.size() > 0)
-	                    	output((boost::format("; %s\n") % encoded).str().c_str());
+	        for (size_t i = 0; i < thumbnails.size(); ++ i)
+	        {
+	            const ThumbnailData &data = thumbnails[i];
+	            if (! encoded[i].empty())
+	            {
+	                output((boost::format("\n;\n; thumbnail begin %dx%d %d\n") % data.width % data.height % encoded[i].size()).str().c_str());
 
-	                    output("; thumbnail end\n;\n");
+	                // Split into rows without copying the tail of the encoded string for each row.
+	                for (size_t offset = 0; offset < encoded[i].size(); offset += max_row_length)
+	                    output((boost::format("; %s\n") % encoded[i].substr(offset, max_row_length)).str().c_str());
 
-	                    mz_free(png_data);
-	                }
+	                output("; thumbnail end\n;\n");
 	            }
 	            throw_if_canceled();
 	        }
@@ -1084,9 +1221,9 @@ namespace DoExport {
 }
 
 #if ENABLE_THUMBNAIL_GENERATOR
-void GCode::_do_export(Print& print, FILE* file, ThumbnailsGeneratorCallback thumbnail_cb)
+void GCode::_do_export(Print& print, GCodeOutputStream &file, ThumbnailsGeneratorCallback thumbnail_cb)
 #else
-void GCode::_do_export(Print& print, FILE* file)
+void GCode::_do_export(Print& print, GCodeOutputStream &file)
 #endif // ENABLE_THUMBNAIL_GENERATOR
 {
     PROFILE_FUNC();
@@ -1095,6 +1232,22 @@ void GCode::_do_export(Print& print, FILE* file)
     	// modifies the following:
     	m_normal_time_estimator, m_silent_time_estimator, m_silent_time_estimator_enabled);
     DoExport::init_gcode_analyzer(print.config(), m_analyzer);
+    m_gcode_reader = GCodeReader();
+    m_gcode_reader.set_extrusion_axis(print.config().get_extrusion_axis()[0]);
+
+    // The time estimators process the exported gcode on their own threads.
+    {
+        std::vector<GCodeTimeEstimator*> estimators { &m_normal_time_estimator };
+        if (m_silent_time_estimator_enabled)
+            estimators.emplace_back(&m_silent_time_estimator);
+        m_time_estimator_threads.reset(new GCodeTimeEstimatorThreads(estimators));
+    }
+    // Stops the time estimator threads if the export is canceled.
+    ScopeGuard time_estimator_threads_guard([this]() { m_time_estimator_threads.reset(); });
+    m_remaining_times = print.config().remaining_times.value;
+    m_reserved_M73_lines.clear();
+    m_g1_lines_count = 0;
+    m_g1_extrusions_since_reserved_M73 = 0;
 
     // resets analyzer's tracking data
     m_last_mm3_per_mm = GCodeAnalyzer::Default_mm3_per_mm;
@@ -1137,7 +1290,6 @@ void GCode::_do_export(Print& print, FILE* file)
     m_volumetric_speed = DoExport::autospeed_volumetric_limit(print);
     print.throw_if_canceled();
 
-    m_cooling_buffer = make_unique<CoolingBuffer>(*this);
     if (print.config().spiral_vase.value)
         m_spiral_vase = make_unique<SpiralVase>(print.config());
 #ifdef HAS_PRESSURE_EQUALIZER
@@ -1148,13 +1300,21 @@ void GCode::_do_export(Print& print, FILE* file)
 #else /* HAS_PRESSURE_EQUALIZER */
     m_enable_extrusion_role_markers = false;
 #endif /* HAS_PRESSURE_EQUALIZER */
+    // The spiral vase and the pressure equalizer post-process the G1 lines only, MakerWare and Sailfish do not know G2 / G3.
+    m_arc_fitting = print.config().arc_fitting.value && ! m_spiral_vase && ! m_enable_extrusion_role_markers &&
+        print.config().gcode_flavor.value != gcfMakerWare && print.config().gcode_flavor.value != gcfSailfish;
+
+    m_binary_gcode = print.config().binary_gcode.value;
+    m_binary_thumbnails.clear();
+    m_binary_config.clear();
 
     // Write information on the generator.
     _write_format(file, "; %s\n\n", Slic3r::header_slic3r_generated().c_str());
 
     DoExport::export_thumbnails_to_file(thumbnail_cb, print.full_print_config().option<ConfigOptionPoints>("thumbnails")->values, 
-        [this, file](const char* sz) { this->_write(file, sz); }, 
-        [&print]() { print.throw_if_canceled(); });
+        [this, &file](const char* sz) { this->_write(file, sz); }, 
+        [&print]() { print.throw_if_canceled(); },
+        m_binary_gcode ? &m_binary_thumbnails : nullptr);
 
     // Write notes (content of the Print Settings tab -> Notes)
     {
@@ -1189,13 +1349,9 @@ void GCode::_do_export(Print& print, FILE* file)
     }
     print.throw_if_canceled();
     
-    // adds tags for time estimators
-    if (print.config().remaining_times.value)
-    {
-        _writeln(file, GCodeTimeEstimator::Normal_First_M73_Output_Placeholder_Tag);
-        if (m_silent_time_estimator_enabled)
-            _writeln(file, GCodeTimeEstimator::Silent_First_M73_Output_Placeholder_Tag);
-    }
+    // reserves the initial lines M73
+    if (m_remaining_times)
+        _reserve_M73_lines(file, 0);
 
     // Prepare the helper object for replacing placeholders in custom G-code and output filename.
     m_placeholder_parser = print.placeholder_parser();
@@ -1244,6 +1400,8 @@ void GCode::_do_export(Print& print, FILE* file)
     }
     print.throw_if_canceled();
 
+    // The CoolingBuffer caches the extruders, therefore it is created after the extruders have been set.
+    m_cooling_buffer = make_unique<CoolingBuffer>(*this);
     m_cooling_buffer->set_current_extruder(initial_extruder_id);
 
     // Emit machine envelope limits for the Marlin firmware.
@@ -1311,8 +1469,24 @@ void GCode::_do_export(Print& print, FILE* file)
         _write(file, this->set_extruder(initial_extruder_id, 0.));
     }
 
+    // Distance fields of the lower layers for the seam placement.
+    this->build_lower_layer_edge_grids(print);
+    print.throw_if_canceled();
+    // Search structures over the internal slices for the retraction decisions of the travels.
+    this->build_internal_slices_indices(print);
+    print.throw_if_canceled();
+    // Seam penalties of the perimeters, which do not depend on the position of the extruder.
+    this->build_seam_penalties(print);
+    print.throw_if_canceled();
+    // Islands of the perimeters and infills.
+    this->build_layer_extrusion_islands(print);
+    print.throw_if_canceled();
+
     // Do all objects for each layer.
     if (print.config().complete_objects.value) {
+        // The layers of the sequential prints are not cached.
+        if (print.gcode_layer_cache() != nullptr)
+            print.gcode_layer_cache()->clear();
         // Print objects from the smallest to the tallest to avoid collisions
         // when moving onto next object starting point.
         std::vector<PrintObject*> objects(print.objects());
@@ -1320,6 +1494,14 @@ void GCode::_do_export(Print& print, FILE* file)
         size_t finished_objects = 0;
         for (size_t object_id = initial_print_object_id; object_id < objects.size(); ++ object_id) {
             const PrintObject &object = *objects[object_id];
+            // Pair the object layers with the support layers by z. The layers and their motion planners are shared by the copies of the object.
+            std::vector<std::pair<coordf_t, std::vector<LayerToPrint>>> layers_to_print;
+            for (const LayerToPrint &ltp : collect_layers_to_print(object))
+                layers_to_print.emplace_back(ltp.print_z(), std::vector<LayerToPrint>{ ltp });
+            // Only cache the motion planners of all the layers if there is another copy to reuse them.
+            std::vector<std::vector<std::shared_ptr<MotionPlanner>>> motion_planners_cache;
+            if (object.copies().size() > 1)
+                motion_planners_cache.assign(layers_to_print.size(), std::vector<std::shared_ptr<MotionPlanner>>());
             for (const Point &copy : object.copies()) {
                 // Get optimal tool ordering to minimize tool switches of a multi-exruder print.
                 if (object_id != initial_print_object_id || &copy != object.copies().data()) {
@@ -1358,14 +1540,10 @@ void GCode::_do_export(Print& print, FILE* file)
                 // Reset the cooling buffer internal state (the current position, feed rate, accelerations).
                 m_cooling_buffer->reset();
                 m_cooling_buffer->set_current_extruder(initial_extruder_id);
-                // Pair the object layers with the support layers by z, extrude them.
-                std::vector<LayerToPrint> layers_to_print = collect_layers_to_print(object);
-                for (const LayerToPrint &ltp : layers_to_print) {
-                    std::vector<LayerToPrint> lrs;
-                    lrs.emplace_back(std::move(ltp));
-                    this->process_layer(file, print, lrs, tool_ordering.tools_for_layer(ltp.print_z()), nullptr, &copy - object.copies().data());
-                    print.throw_if_canceled();
-                }
+                // Extrude the object layers paired with the support layers.
+                this->process_layers(file, print, tool_ordering, layers_to_print, nullptr, &copy - object.copies().data(),
+                    motion_planners_cache.empty() ? nullptr : &motion_planners_cache);
+                print.throw_if_canceled();
 #ifdef HAS_PRESSURE_EQUALIZER
                 if (m_pressure_equalizer)
                     _write(file, m_pressure_equalizer->process("", true));
@@ -1412,14 +1590,20 @@ void GCode::_do_export(Print& print, FILE* file)
             }
             print.throw_if_canceled();
         }
-        // Extrude the layers.
-        for (auto &layer : layers_to_print) {
-            const LayerTools &layer_tools = tool_ordering.tools_for_layer(layer.first);
-            if (m_wipe_tower && layer_tools.has_wipe_tower)
-                m_wipe_tower->next_layer();
-            this->process_layer(file, print, layer.second, layer_tools, &print_object_instances_ordering, size_t(-1));
-            print.throw_if_canceled();
+        // Extrude the layers, reusing the layers of the previous export if possible.
+        // The wipe tower, the spiral vase, the pressure equalizer and the motion planners of the avoid crossing perimeters
+        // carry state between the layers, which is not captured by GCode::LayerState.
+        GCodeLayerCache *layer_cache = print.gcode_layer_cache();
+        if (layer_cache != nullptr && (m_wipe_tower || m_spiral_vase || print.config().avoid_crossing_perimeters.value
+#ifdef HAS_PRESSURE_EQUALIZER
+            || m_pressure_equalizer
+#endif /* HAS_PRESSURE_EQUALIZER */
+            )) {
+            layer_cache->clear();
+            layer_cache = nullptr;
         }
+        this->process_layers(file, print, tool_ordering, layers_to_print, &print_object_instances_ordering, size_t(-1), nullptr, layer_cache);
+        print.throw_if_canceled();
 #ifdef HAS_PRESSURE_EQUALIZER
         if (m_pressure_equalizer)
             _write(file, m_pressure_equalizer->process("", true));
@@ -1429,6 +1613,11 @@ void GCode::_do_export(Print& print, FILE* file)
             _write(file, m_wipe_tower->finalize(*this));
     }
 
+    m_lower_layer_edge_grids.clear();
+    m_internal_slices_indices.clear();
+    m_seam_penalties.clear();
+    m_layer_extrusion_islands.clear();
+
     // Write end commands to file.
     _write(file, this->retract());
     _write(file, m_writer.set_fan(false));
@@ -1459,20 +1648,24 @@ void GCode::_do_export(Print& print, FILE* file)
     _write(file, m_writer.update_progress(m_layer_count, m_layer_count, true)); // 100%
     _write(file, m_writer.postamble());
 
-    // adds tags for time estimators
-    if (print.config().remaining_times.value)
+    // adds the final lines M73
+    if (m_remaining_times)
     {
-        _writeln(file, GCodeTimeEstimator::Normal_Last_M73_Output_Placeholder_Tag);
+        file.write("M73 P100 R0\n");
         if (m_silent_time_estimator_enabled)
-            _writeln(file, GCodeTimeEstimator::Silent_Last_M73_Output_Placeholder_Tag);
+            file.write("M73 Q100 S0\n");
     }
 
     print.throw_if_canceled();
 
+    // waits for the time estimators to process the whole gcode
+    m_time_estimator_threads->finish();
+    m_time_estimator_threads.reset();
+
     // calculates estimated printing time
-    m_normal_time_estimator.calculate_time(false);
+    m_normal_time_estimator.calculate_time();
     if (m_silent_time_estimator_enabled)
-        m_silent_time_estimator.calculate_time(false);
+        m_silent_time_estimator.calculate_time();
 
     // Get filament stats.
     _write(file, DoExport::update_print_stats_and_format_filament_stats(
@@ -1490,9 +1683,11 @@ void GCode::_do_export(Print& print, FILE* file)
     if (m_silent_time_estimator_enabled)
         _write_format(file, "; estimated printing time (silent mode) = %s\n", m_silent_time_estimator.get_time_dhms().c_str());
 
-    // Append full config.
-    _write(file, "\n");
-    {
+    // Append full config, the binary G-code stores it into its config block.
+    if (m_binary_gcode)
+        append_full_config(print, m_binary_config);
+    else {
+        _write(file, "\n");
         std::string full_config = "";
         append_full_config(print, full_config);
         if (!full_config.empty())
@@ -1503,8 +1698,17 @@ void GCode::_do_export(Print& print, FILE* file)
 
 std::string GCode::placeholder_parser_process(const std::string &name, const std::string &templ, unsigned int current_extruder_id, const DynamicConfig *config_override)
 {
+    bool constant = templ.find_first_of("[{") == std::string::npos;
+    if (constant) {
+        auto it = m_placeholder_parser_constant_templates.find(templ);
+        if (it != m_placeholder_parser_constant_templates.end())
+            return it->second;
+    }
     try {
-        return m_placeholder_parser.process(templ, current_extruder_id, config_override);
+        std::string out = m_placeholder_parser.process(templ, current_extruder_id, config_override);
+        if (constant)
+            m_placeholder_parser_constant_templates.emplace(templ, out);
+        return out;
     } catch (std::runtime_error &err) {
         // Collect the names of failed template substitutions for error reporting.
         m_placeholder_parser_failed_templates.insert(name);
@@ -1572,29 +1776,29 @@ static bool custom_gcode_sets_temperature(const std::string &gcode, const int mc
 
 // Print the machine envelope G-code for the Marlin firmware based on the "machine_max_xxx" parameters.
 // Do not process this piece of G-code by the time estimator, it already knows the values through another sources.
-void GCode::print_machine_envelope(FILE *file, Print &print)
+void GCode::print_machine_envelope(GCodeOutputStream &file, Print &print)
 {
     if (print.config().gcode_flavor.value == gcfMarlin) {
-        fprintf(file, "M201 X%d Y%d Z%d E%d ; sets maximum accelerations, mm/sec^2\n",
+        file.write_format("M201 X%d Y%d Z%d E%d ; sets maximum accelerations, mm/sec^2\n",
             int(print.config().machine_max_acceleration_x.values.front() + 0.5),
             int(print.config().machine_max_acceleration_y.values.front() + 0.5),
             int(print.config().machine_max_acceleration_z.values.front() + 0.5),
             int(print.config().machine_max_acceleration_e.values.front() + 0.5));
-        fprintf(file, "M203 X%d Y%d Z%d E%d ; sets maximum feedrates, mm/sec\n",
+        file.write_format("M203 X%d Y%d Z%d E%d ; sets maximum feedrates, mm/sec\n",
             int(print.config().machine_max_feedrate_x.values.front() + 0.5),
             int(print.config().machine_max_feedrate_y.values.front() + 0.5),
             int(print.config().machine_max_feedrate_z.values.front() + 0.5),
             int(print.config().machine_max_feedrate_e.values.front() + 0.5));
-        fprintf(file, "M204 P%d R%d T%d ; sets acceleration (P, T) and retract acceleration (R), mm/sec^2\n",
+        file.write_format("M204 P%d R%d T%d ; sets acceleration (P, T) and retract acceleration (R), mm/sec^2\n",
             int(print.config().machine_max_acceleration_extruding.values.front() + 0.5),
             int(print.config().machine_max_acceleration_retracting.values.front() + 0.5),
             int(print.config().machine_max_acceleration_extruding.values.front() + 0.5));
-        fprintf(file, "M205 X%.2lf Y%.2lf Z%.2lf E%.2lf ; sets the jerk limits, mm/sec\n",
+        file.write_format("M205 X%.2lf Y%.2lf Z%.2lf E%.2lf ; sets the jerk limits, mm/sec\n",
             print.config().machine_max_jerk_x.values.front(),
             print.config().machine_max_jerk_y.values.front(),
             print.config().machine_max_jerk_z.values.front(),
             print.config().machine_max_jerk_e.values.front());
-        fprintf(file, "M205 S%d T%d ; sets the minimum extruding and travel feed rate, mm/sec\n",
+        file.write_format("M205 S%d T%d ; sets the minimum extruding and travel feed rate, mm/sec\n",
             int(print.config().machine_min_extruding_rate.values.front() + 0.5),
             int(print.config().machine_min_travel_rate.values.front() + 0.5));
     }
@@ -1604,7 +1808,7 @@ void GCode::print_machine_envelope(FILE *file, Print &print)
 // Only do that if the start G-code does not already contain any M-code controlling an extruder temperature.
 // M140 - Set Extruder Temperature
 // M190 - Set Extruder Temperature and Wait
-void GCode::_print_first_layer_bed_temperature(FILE *file, Print &print, const std::string &gcode, unsigned int first_printing_extruder_id, bool wait)
+void GCode::_print_first_layer_bed_temperature(GCodeOutputStream &file, Print &print, const std::string &gcode, unsigned int first_printing_extruder_id, bool wait)
 {
     // Initial bed temperature based on the first extruder.
     int  temp = print.config().first_layer_bed_temperature.get_at(first_printing_extruder_id);
@@ -1624,7 +1828,7 @@ void GCode::_print_first_layer_bed_temperature(FILE *file, Print &print, const s
 // Only do that if the start G-code does not already contain any M-code controlling an extruder temperature.
 // M104 - Set Extruder Temperature
 // M109 - Set Extruder Temperature and Wait
-void GCode::_print_first_layer_extruder_temperatures(FILE *file, Print &print, const std::string &gcode, unsigned int first_printing_extruder_id, bool wait)
+void GCode::_print_first_layer_extruder_temperatures(GCodeOutputStream &file, Print &print, const std::string &gcode, unsigned int first_printing_extruder_id, bool wait)
 {
     // Is the bed temperature set by the provided custom G-code?
     int  temp_by_gcode     = -1;
@@ -1855,14 +2059,457 @@ namespace Skirt {
 
 } // namespace Skirt
 
+// Export the layers through a pipeline. The G-code generator process_layer() is stateful (current position, retraction, wipe,
+// extruder), therefore it runs as a serial stage the same way the SpiralVase, CoolingBuffer and PressureEqualizer
+// post-processors do, and so does the final _write() feeding the G-code analyzer and the time estimators.
+// While the stages are serial, they run in parallel on consecutive layers: Layer N+1 is being generated while layer N
+// is being cooled down and layer N-1 is being written.
+// With avoid_crossing_perimeters enabled, the motion planners of the layers are built by a parallel stage ahead of process_layer().
+// The window of the layers with their motion planners held in memory is limited by the number of layers in flight.
+void GCode::process_layers(
+    GCodeOutputStream                                                  &file,
+    const Print                                                        &print,
+    const ToolOrdering                                                 &tool_ordering,
+    const std::vector<std::pair<coordf_t, std::vector<LayerToPrint>>> &layers_to_print,
+    const std::vector<std::pair<size_t, size_t>>                       *ordering,
+    const size_t                                                        single_object_idx,
+    std::vector<std::vector<std::shared_ptr<MotionPlanner>>>           *motion_planners_cache,
+    GCodeLayerCache                                                    *layer_cache)
+{
+    // Maximum number of layers in flight, thus the maximum number of layer G-code strings held in memory at the same time.
+    static constexpr size_t max_layers_in_flight = 12;
+
+    // Apply the cooling logic and add the tags for the analyzer.
+    auto cool_down = [cooling_buffer = m_cooling_buffer.get()](LayerResult &in) -> std::string {
+        if (in.gcode.empty())
+            return std::string();
+        // Apply cooling logic; this may alter speeds.
+        std::string gcode = cooling_buffer ? cooling_buffer->process_layer(in.gcode, in.layer_id) : std::move(in.gcode);
+        // add tag for analyzer
+        if (gcode.find(GCodeAnalyzer::Pause_Print_Tag) != gcode.npos)
+            gcode += "\n; " + GCodeAnalyzer::End_Pause_Print_Or_Custom_Code_Tag + "\n";
+        else if (gcode.find(GCodeAnalyzer::Custom_Code_Tag) != gcode.npos)
+            gcode += "\n; " + GCodeAnalyzer::End_Pause_Print_Or_Custom_Code_Tag + "\n";
+        return gcode;
+    };
+
+    // The layers of the previous export, which may be reused, if the inputs common to all layers did not change.
+    GCodeLayerCache     old_cache;
+    std::vector<size_t> layer_keys;
+    // The placeholder parser variables are modified by the layers, thus the key is calculated before exporting them.
+    size_t              key_before = 0;
+    if (layer_cache != nullptr) {
+        size_t key = this->layer_cache_key(print);
+        if (layer_cache->m_key == key)
+            old_cache = std::move(*layer_cache);
+        layer_cache->clear();
+        layer_cache->m_state_before = this->layer_state();
+        layer_cache->m_layers.assign(layers_to_print.size(), GCodeLayerCache::Layer());
+        // Hash the inputs of each layer.
+        layer_keys.assign(layers_to_print.size(), 0);
+        for (size_t i = 0; i < layers_to_print.size(); ++ i) {
+            size_t &seed = layer_keys[i];
+            boost::hash_combine(seed, layers_to_print[i].first);
+            for (const LayerToPrint &ltp : layers_to_print[i].second) {
+                boost::hash_combine(seed, ltp.object_layer);
+                boost::hash_combine(seed, ltp.support_layer);
+            }
+            const LayerTools &layer_tools = tool_ordering.tools_for_layer(layers_to_print[i].first);
+            for (unsigned int extruder_id : layer_tools.extruders)
+                boost::hash_combine(seed, extruder_id);
+            if (layer_tools.custom_gcode != nullptr) {
+                boost::hash_combine(seed, layer_tools.custom_gcode->print_z);
+                boost::hash_combine(seed, layer_tools.custom_gcode->gcode);
+                boost::hash_combine(seed, layer_tools.custom_gcode->extruder);
+                boost::hash_combine(seed, layer_tools.custom_gcode->color);
+            }
+        }
+        layer_cache->m_key = 0;
+        key_before = key;
+    }
+
+    struct LayerToProcess {
+        // Index into layers_to_print.
+        size_t                                      idx;
+        // Motion planners over the object layers of layers_to_print[idx].second, indexed the same.
+        std::vector<std::shared_ptr<MotionPlanner>> motion_planners;
+    };
+
+    size_t layer_to_print_idx = 0;
+    const auto input = tbb::make_filter<void, LayerToProcess>(tbb::filter::serial_in_order,
+        [&layers_to_print, &layer_to_print_idx](tbb::flow_control &fc) -> LayerToProcess {
+            if (layer_to_print_idx == layers_to_print.size()) {
+                fc.stop();
+                return {};
+            }
+            return { layer_to_print_idx ++, {} };
+        });
+    const auto motion_planners = tbb::make_filter<LayerToProcess, LayerToProcess>(tbb::filter::parallel,
+        [&print, &layers_to_print, motion_planners_cache](LayerToProcess in) -> LayerToProcess {
+            if (print.config().avoid_crossing_perimeters.value) {
+                if (motion_planners_cache != nullptr && ! (*motion_planners_cache)[in.idx].empty()) {
+                    // Built for a preceding copy of the same object.
+                    in.motion_planners = (*motion_planners_cache)[in.idx];
+                    return in;
+                }
+                const std::vector<LayerToPrint> &layers = layers_to_print[in.idx].second;
+                in.motion_planners.assign(layers.size(), nullptr);
+                for (size_t i = 0; i < layers.size(); ++ i)
+                    if (layers[i].object_layer != nullptr) {
+                        print.throw_if_canceled();
+                        in.motion_planners[i] = std::make_shared<MotionPlanner>(union_ex(layers[i].object_layer->lslices, true));
+                        in.motion_planners[i]->initialize();
+                    }
+                if (motion_planners_cache != nullptr)
+                    // Each layer is processed by a single task, thus the items of the cache are written concurrently, but never the same item.
+                    (*motion_planners_cache)[in.idx] = in.motion_planners;
+            }
+            return in;
+        });
+    const auto generator = tbb::make_filter<LayerToProcess, LayerResult>(tbb::filter::serial_in_order,
+        [this, &print, &tool_ordering, &layers_to_print, ordering, single_object_idx, layer_cache, &old_cache, &layer_keys, &cool_down]
+        (LayerToProcess in) -> LayerResult {
+            const std::pair<coordf_t, std::vector<LayerToPrint>> &layer = layers_to_print[in.idx];
+            const LayerTools &layer_tools = tool_ordering.tools_for_layer(layer.first);
+            if (m_wipe_tower && layer_tools.has_wipe_tower)
+                m_wipe_tower->next_layer();
+            print.throw_if_canceled();
+            if (layer_cache == nullptr)
+                return this->process_layer(print, layer.second, layer_tools, ordering, single_object_idx,
+                    in.motion_planners.empty() ? nullptr : &in.motion_planners);
+            GCodeLayerCache::Layer &cached = layer_cache->m_layers[in.idx];
+            cached.key = layer_keys[in.idx];
+            if (in.idx < old_cache.m_layers.size() && old_cache.m_layers[in.idx].key == cached.key &&
+                this->layer_state() == (in.idx == 0 ? old_cache.m_state_before : old_cache.m_layers[in.idx - 1].state_after)) {
+                // The layer and the state of the generator entering the layer did not change, reuse the G-code of the previous export.
+                // The state after the layer is copied, not moved, as it is compared against when entering the next layer.
+                GCodeLayerCache::Layer &old = old_cache.m_layers[in.idx];
+                cached.gcode       = std::move(old.gcode);
+                cached.state_after = old.state_after;
+                this->set_layer_state(cached.state_after);
+            } else {
+                LayerResult result = this->process_layer(print, layer.second, layer_tools, ordering, single_object_idx,
+                    in.motion_planners.empty() ? nullptr : &in.motion_planners);
+                // The CoolingBuffer carries state from layer to layer, thus it has to process the layer before taking the snapshot.
+                cached.gcode       = cool_down(result);
+                cached.state_after = this->layer_state();
+            }
+            return { cached.gcode, size_t(-1), m_spiral_vase_enabled, true };
+        });
+    const auto spiral_vase = tbb::make_filter<LayerResult, LayerResult>(tbb::filter::serial_in_order,
+        [spiral_vase = m_spiral_vase.get()](LayerResult in) -> LayerResult {
+            if (spiral_vase != nullptr && ! in.gcode.empty()) {
+                // Apply spiral vase post-processing if this layer contains suitable geometry
+                // (we must feed all the G-code into the post-processor, including the first 
+                // bottom non-spiral layers otherwise it will mess with positions)
+                // we apply spiral vase at this stage because it requires a full layer.
+                // Just a reminder: A spiral vase mode is allowed for a single object per layer, single material print only.
+                spiral_vase->enable = in.spiral_vase_enable;
+                in.gcode = spiral_vase->process_layer(in.gcode);
+            }
+            return in;
+        });
+    const auto cooling = tbb::make_filter<LayerResult, std::string>(tbb::filter::serial_in_order,
+        [&cool_down](LayerResult in) -> std::string {
+            return in.cooled ? std::move(in.gcode) : cool_down(in);
+        });
+#ifdef HAS_PRESSURE_EQUALIZER
+    const auto pressure_equalizer = tbb::make_filter<std::string, std::string>(tbb::filter::serial_in_order,
+        [pressure_equalizer = m_pressure_equalizer.get()](std::string in) -> std::string {
+            // Apply pressure equalization if enabled;
+            return (pressure_equalizer == nullptr || in.empty()) ? in : pressure_equalizer->process_to_string(in.c_str(), false);
+        });
+#endif /* HAS_PRESSURE_EQUALIZER */
+    const auto output = tbb::make_filter<std::string, void>(tbb::filter::serial_in_order,
+        [this, &file](std::string in) {
+            if (in.empty())
+                return;
+            _write(file, in);
+            // The time estimators are running on their own threads, their memory is not reported here.
+            BOOST_LOG_TRIVIAL(trace) << "Exported layer, analyzer memory: " <<
+                    format_memsize_MB(m_analyzer.memory_used()) <<
+                log_memory_info();
+        });
+
+    // The filters are serial, therefore the G-code is written in the order of layers_to_print.
+#ifdef HAS_PRESSURE_EQUALIZER
+    tbb::parallel_pipeline(max_layers_in_flight, input & motion_planners & generator & spiral_vase & cooling & pressure_equalizer & output);
+#else /* HAS_PRESSURE_EQUALIZER */
+    tbb::parallel_pipeline(max_layers_in_flight, input & motion_planners & generator & spiral_vase & cooling & output);
+#endif /* HAS_PRESSURE_EQUALIZER */
+
+    if (layer_cache != nullptr)
+        // All layers were exported, the cache is valid for the next export.
+        layer_cache->m_key = key_before;
+}
+
+// Build the distance fields over the slices of the layers below the object layers for the seam placement.
+// The fields used to be built lazily by extrude_loop() inside the serial G-code generator stage of the export pipeline,
+// now they are built for all layers in parallel before the export.
+void GCode::build_lower_layer_edge_grids(const Print &print)
+{
+    m_lower_layer_edge_grids.clear();
+    if (print.config().spiral_vase)
+        return;
+    std::vector<const Layer*> lower_layers;
+    for (const PrintObject *object : print.objects())
+        // The distance field is only used by the seam placement, see extrude_loop().
+        if (object->config().seam_position.value != spRandom)
+            for (const Layer *layer : object->layers())
+                if (layer->lower_layer != nullptr)
+                    lower_layers.emplace_back(layer->lower_layer);
+    std::vector<std::unique_ptr<EdgeGrid::Grid>> grids(lower_layers.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, lower_layers.size()),
+        [&print, &lower_layers, &grids](const tbb::blocked_range<size_t> &range) {
+            for (size_t i = range.begin(); i < range.end(); ++ i) {
+                print.throw_if_canceled();
+                // Create the distance field for a layer below.
+                const coord_t distance_field_resolution = coord_t(scale_(1.) + 0.5);
+                grids[i] = make_unique<EdgeGrid::Grid>();
+                grids[i]->create(lower_layers[i]->lslices, distance_field_resolution);
+                grids[i]->calculate_sdf();
+                #if 0
+                {
+                    static int iRun = 0;
+                    BoundingBox bbox = grids[i]->bbox();
+                    bbox.min(0) -= scale_(5.f);
+                    bbox.min(1) -= scale_(5.f);
+                    bbox.max(0) += scale_(5.f);
+                    bbox.max(1) += scale_(5.f);
+                    EdgeGrid::save_png(*grids[i], bbox, scale_(0.1f), debug_out_path("GCode_extrude_loop_edge_grid-%d.png", iRun++));
+                }
+                #endif
+            }
+        });
+    for (size_t i = 0; i < lower_layers.size(); ++ i)
+        m_lower_layer_edge_grids.emplace(lower_layers[i], std::move(grids[i]));
+}
+
+const EdgeGrid::Grid* GCode::lower_layer_edge_grid(const Layer *layer) const
+{
+    if (layer == nullptr || layer->lower_layer == nullptr)
+        return nullptr;
+    auto it = m_lower_layer_edge_grids.find(layer->lower_layer);
+    return (it == m_lower_layer_edge_grids.end()) ? nullptr : it->second.get();
+}
+
+void GCode::build_internal_slices_indices(const Print &print)
+{
+    m_internal_slices_indices.clear();
+    // The index is only used by needs_retraction() if only_retract_when_crossing_perimeters is enabled.
+    if (! print.config().only_retract_when_crossing_perimeters)
+        return;
+    std::vector<const Layer*> layers;
+    for (const PrintObject *object : print.objects())
+        for (const Layer *layer : object->layers())
+            layers.emplace_back(layer);
+    std::vector<std::unique_ptr<InternalSlicesIndex>> indices(layers.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, layers.size()),
+        [&print, &layers, &indices](const tbb::blocked_range<size_t> &range) {
+            for (size_t i = range.begin(); i < range.end(); ++ i) {
+                print.throw_if_canceled();
+                indices[i] = make_unique<InternalSlicesIndex>(*layers[i]);
+            }
+        });
+    for (size_t i = 0; i < layers.size(); ++ i)
+        m_internal_slices_indices.emplace(layers[i], std::move(indices[i]));
+}
+
+// Assign the infill and perimeter collections of the layer regions to the islands of layer.lslices by their first points.
+// The island indices are stored in the order process_layer() traverses the collections: For each region its infill collections,
+// then its perimeter collections. A collection, which does not fall into any island, is assigned the index lslices.size().
+static std::vector<uint32_t> assign_extrusions_to_islands(const Layer &layer)
+{
+    size_t n_slices = layer.lslices.size();
+    const std::vector<BoundingBox> &layer_surface_bboxes = layer.lslices_bboxes;
+    // Traverse the slices in an increasing order of bounding box size, so that the islands inside another islands are tested first,
+    // so we can just test a point inside ExPolygon::contour and we may skip testing the holes.
+    std::vector<size_t> slices_test_order;
+    slices_test_order.reserve(n_slices);
+    for (size_t i = 0; i < n_slices; ++ i)
+        slices_test_order.emplace_back(i);
+    std::sort(slices_test_order.begin(), slices_test_order.end(), [&layer_surface_bboxes](size_t i, size_t j) {
+        const Vec2d s1 = layer_surface_bboxes[i].size().cast<double>();
+        const Vec2d s2 = layer_surface_bboxes[j].size().cast<double>();
+        return s1.x() * s1.y() < s2.x() * s2.y();
+    });
+    auto point_inside_surface = [&layer, &layer_surface_bboxes](const size_t i, const Point &point) { 
+        const BoundingBox &bbox = layer_surface_bboxes[i];
+        return point(0) >= bbox.min(0) && point(0) < bbox.max(0) &&
+               point(1) >= bbox.min(1) && point(1) < bbox.max(1) &&
+               layer.lslices[i].contour.contains(point);
+    };
+
+    std::vector<uint32_t> out;
+    for (const LayerRegion *layerm : layer.regions())
+        if (layerm != nullptr)
+            for (const ExtrusionEntitiesPtr *entities : { &layerm->fills.entities, &layerm->perimeters.entities })
+                for (const ExtrusionEntity *ee : *entities) {
+                    const auto *extrusions = static_cast<const ExtrusionEntityCollection*>(ee);
+                    // extrusions->first_point does not fit inside any slice
+                    size_t island_idx = n_slices;
+                    if (! extrusions->entities.empty())
+                        for (size_t i : slices_test_order)
+                            if (point_inside_surface(i, extrusions->first_point())) {
+                                island_idx = i;
+                                break;
+                            }
+                    out.emplace_back(uint32_t(island_idx));
+                }
+    return out;
+}
+
+// Assign the extrusions of all object layers to the islands in parallel, so that the islands are not searched for by the serial
+// process_layer(), and in the sequential printing mode not for each copy of an object again.
+void GCode::build_layer_extrusion_islands(const Print &print)
+{
+    m_layer_extrusion_islands.clear();
+    std::vector<const Layer*> layers;
+    for (const PrintObject *object : print.objects())
+        for (const Layer *layer : object->layers())
+            layers.emplace_back(layer);
+    std::vector<std::vector<uint32_t>> islands(layers.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, layers.size()),
+        [&print, &layers, &islands](const tbb::blocked_range<size_t> &range) {
+            for (size_t i = range.begin(); i < range.end(); ++ i) {
+                print.throw_if_canceled();
+                islands[i] = assign_extrusions_to_islands(*layers[i]);
+            }
+        });
+    m_layer_extrusion_islands.reserve(layers.size());
+    for (size_t i = 0; i < layers.size(); ++ i)
+        m_layer_extrusion_islands.emplace(layers[i], std::move(islands[i]));
+}
+
+const std::vector<uint32_t>* GCode::layer_extrusion_islands(const Layer *layer) const
+{
+    auto it = m_layer_extrusion_islands.find(layer);
+    return (it == m_layer_extrusion_islands.end()) ? nullptr : &it->second;
+}
+
+bool GCode::LayerState::operator==(const LayerState &rhs) const
+{
+    return writer == rhs.writer && cooling_buffer == rhs.cooling_buffer && origin == rhs.origin &&
+        last_pos == rhs.last_pos && last_pos_defined == rhs.last_pos_defined && wipe_path == rhs.wipe_path &&
+        use_external_mp == rhs.use_external_mp && use_external_mp_once == rhs.use_external_mp_once && disable_once == rhs.disable_once &&
+        layer_index == rhs.layer_index && layer == rhs.layer && last_region == rhs.last_region &&
+        seam_position == rhs.seam_position && skirt_done == rhs.skirt_done && brim_done == rhs.brim_done &&
+        second_layer_things_done == rhs.second_layer_things_done && last_obj_copy == rhs.last_obj_copy &&
+        last_extrusion_role == rhs.last_extrusion_role && last_analyzer_extrusion_role == rhs.last_analyzer_extrusion_role &&
+        last_mm3_per_mm == rhs.last_mm3_per_mm && last_width == rhs.last_width && last_height == rhs.last_height &&
+        placeholder_parser_failed_templates == rhs.placeholder_parser_failed_templates;
+}
+
+GCode::LayerState GCode::layer_state() const
+{
+    LayerState out;
+    out.writer                              = m_writer.state();
+    out.cooling_buffer                      = m_cooling_buffer->state();
+    out.origin                              = m_origin;
+    out.last_pos                            = m_last_pos;
+    out.last_pos_defined                    = m_last_pos_defined;
+    out.wipe_path                           = m_wipe.path.points;
+    out.use_external_mp                     = m_avoid_crossing_perimeters.use_external_mp;
+    out.use_external_mp_once                = m_avoid_crossing_perimeters.use_external_mp_once;
+    out.disable_once                        = m_avoid_crossing_perimeters.disable_once;
+    out.layer_index                         = m_layer_index;
+    out.layer                               = m_layer;
+    out.last_region                         = m_last_region;
+    out.seam_position                       = m_seam_position;
+    out.skirt_done                          = m_skirt_done;
+    out.brim_done                           = m_brim_done;
+    out.second_layer_things_done            = m_second_layer_things_done;
+    out.last_obj_copy                       = m_last_obj_copy;
+    out.last_extrusion_role                 = m_last_extrusion_role;
+    out.last_analyzer_extrusion_role        = m_last_analyzer_extrusion_role;
+    out.last_mm3_per_mm                     = m_last_mm3_per_mm;
+    out.last_width                          = m_last_width;
+    out.last_height                         = m_last_height;
+    out.placeholder_parser_failed_templates = m_placeholder_parser_failed_templates;
+    return out;
+}
+
+void GCode::set_layer_state(const LayerState &state)
+{
+    m_writer.set_state(state.writer);
+    m_cooling_buffer->set_state(state.cooling_buffer);
+    m_origin                                       = state.origin;
+    m_last_pos                                     = state.last_pos;
+    m_last_pos_defined                             = state.last_pos_defined;
+    m_wipe.path.points                             = state.wipe_path;
+    m_avoid_crossing_perimeters.use_external_mp      = state.use_external_mp;
+    m_avoid_crossing_perimeters.use_external_mp_once = state.use_external_mp_once;
+    m_avoid_crossing_perimeters.disable_once         = state.disable_once;
+    m_layer_index                                  = state.layer_index;
+    m_layer                                        = state.layer;
+    m_last_region                                  = state.last_region;
+    m_seam_position                                = state.seam_position;
+    m_skirt_done                                   = state.skirt_done;
+    m_brim_done                                    = state.brim_done;
+    m_second_layer_things_done                     = state.second_layer_things_done;
+    m_last_obj_copy                                = state.last_obj_copy;
+    m_last_extrusion_role                          = state.last_extrusion_role;
+    m_last_analyzer_extrusion_role                 = state.last_analyzer_extrusion_role;
+    m_last_mm3_per_mm                              = state.last_mm3_per_mm;
+    m_last_width                                   = state.last_width;
+    m_last_height                                  = state.last_height;
+    m_placeholder_parser_failed_templates          = state.placeholder_parser_failed_templates;
+    // The object configuration is applied by process_layer() at the start of each layer, the last region configuration is not.
+    if (m_last_region != nullptr)
+        m_config.apply(m_last_region->config());
+    if (m_writer.extruder() != nullptr)
+        m_placeholder_parser.set("current_extruder", m_writer.extruder()->id());
+}
+
+static void hash_config(size_t &seed, const ConfigBase &config, const std::set<std::string> &keys_ignored)
+{
+    for (const std::string &key : config.keys())
+        if (keys_ignored.find(key) == keys_ignored.end()) {
+            boost::hash_combine(seed, key);
+            boost::hash_combine(seed, config.opt_serialize(key));
+        }
+}
+
+size_t GCode::layer_cache_key(const Print &print) const
+{
+    // Templates processed while exporting the layers.
+    std::string layer_templates = m_config.before_layer_gcode.value + m_config.layer_gcode.value + m_config.toolchange_gcode.value;
+    for (const std::string &templ : m_config.start_filament_gcode.values)
+        layer_templates += templ;
+    for (const std::string &templ : m_config.end_filament_gcode.values)
+        layer_templates += templ;
+    // Options and placeholders not influencing the layers, unless they are referenced by the templates above.
+    std::set<std::string> keys_ignored;
+    for (const char *key : { "end_gcode", "post_process", "output_filename_format", "notes", "printer_notes", "filament_notes",
+                             "timestamp", "year", "month", "day", "hour", "minute", "second" })
+        if (layer_templates.find(key) == std::string::npos)
+            keys_ignored.emplace(key);
+
+    size_t seed = 0;
+    hash_config(seed, m_config, keys_ignored);
+    hash_config(seed, m_placeholder_parser.config(), keys_ignored);
+    if (m_placeholder_parser.external_config() != nullptr)
+        hash_config(seed, *m_placeholder_parser.external_config(), keys_ignored);
+    for (const PrintObject *object : print.objects()) {
+        boost::hash_combine(seed, object);
+        boost::hash_combine(seed, object->model_object()->name);
+        hash_config(seed, object->config(), keys_ignored);
+        for (const Point &copy : object->copies()) {
+            boost::hash_combine(seed, copy.x());
+            boost::hash_combine(seed, copy.y());
+        }
+    }
+    for (const PrintRegion *region : print.regions())
+        hash_config(seed, region->config(), keys_ignored);
+    return seed;
+}
+
 // In sequential mode, process_layer is called once per each object and its copy, 
 // therefore layers will contain a single entry and single_object_instance_idx will point to the copy of the object.
 // In non-sequential mode, process_layer is called per each print_z height with all object and support layers accumulated.
 // For multi-material prints, this routine minimizes extruder switches by gathering extruder specific extrusion paths
 // and performing the extruder specific extrusions together.
-void GCode::process_layer(
-    // Write into the output file.
-    FILE                            *file,
+GCode::LayerResult GCode::process_layer(
     const Print                     &print,
     // Set of object & print layers of the same PrintObject and with the same print_z.
     const std::vector<LayerToPrint> &layers,
@@ -1871,16 +2518,19 @@ void GCode::process_layer(
 	const std::vector<std::pair<size_t, size_t>> *ordering,
     // If set to size_t(-1), then print all copies of all objects.
     // Otherwise print a single copy of a single object.
-    const size_t                     single_object_instance_idx)
+    const size_t                     single_object_instance_idx,
+    // Motion planners over the object layers, built ahead by process_layers().
+    const std::vector<std::shared_ptr<MotionPlanner>> *motion_planners)
 {
     assert(! layers.empty());
+    assert(motion_planners == nullptr || motion_planners->size() == layers.size());
 //    assert(! layer_tools.extruders.empty());
     // Either printing all copies of all objects, or just a single copy of a single object.
     assert(single_object_instance_idx == size_t(-1) || layers.size() == 1);
 
     if (layer_tools.extruders.empty())
         // Nothing to extrude.
-        return;
+        return { std::string(), size_t(-1), m_spiral_vase_enabled };
 
     // Extract 1st object_layer and support_layer of this set of layers with an equal print_z.
     const Layer         *object_layer  = nullptr;
@@ -1912,10 +2562,10 @@ void GCode::process_layer(
                     break;
                 }
         }
-        m_spiral_vase->enable = enable;
+        m_spiral_vase_enabled = enable;
     }
     // If we're going to apply spiralvase to this layer, disable loop clipping
-    m_enable_loop_clipping = ! m_spiral_vase || ! m_spiral_vase->enable;
+    m_enable_loop_clipping = ! m_spiral_vase || ! m_spiral_vase_enabled;
     
     std::string gcode;
 
@@ -2031,24 +2681,14 @@ void GCode::process_layer(
             //   option
             // (Still, we have to keep track of regions because we need to apply their config)
             size_t n_slices = layer.lslices.size();
-            const std::vector<BoundingBox> &layer_surface_bboxes = layer.lslices_bboxes;
-            // Traverse the slices in an increasing order of bounding box size, so that the islands inside another islands are tested first,
-            // so we can just test a point inside ExPolygon::contour and we may skip testing the holes.
-            std::vector<size_t> slices_test_order;
-            slices_test_order.reserve(n_slices);
-            for (size_t i = 0; i < n_slices; ++ i)
-            	slices_test_order.emplace_back(i);
-            std::sort(slices_test_order.begin(), slices_test_order.end(), [&layer_surface_bboxes](size_t i, size_t j) {
-            	const Vec2d s1 = layer_surface_bboxes[i].size().cast<double>();
-            	const Vec2d s2 = layer_surface_bboxes[j].size().cast<double>();
-            	return s1.x() * s1.y() < s2.x() * s2.y();
-            });
-            auto point_inside_surface = [&layer, &layer_surface_bboxes](const size_t i, const Point &point) { 
-                const BoundingBox &bbox = layer_surface_bboxes[i];
-                return point(0) >= bbox.min(0) && point(0) < bbox.max(0) &&
-                       point(1) >= bbox.min(1) && point(1) < bbox.max(1) &&
-                       layer.lslices[i].contour.contains(point);
-            };
+            // Islands of the perimeter and infill collections, usually precalculated by build_layer_extrusion_islands().
+            std::vector<uint32_t> extrusion_islands_local;
+            const std::vector<uint32_t> *extrusion_islands = this->layer_extrusion_islands(&layer);
+            if (extrusion_islands == nullptr) {
+                extrusion_islands_local = assign_extrusions_to_islands(layer);
+                extrusion_islands = &extrusion_islands_local;
+            }
+            size_t extrusion_idx = 0;
 
             for (size_t region_id = 0; region_id < layer.regions().size(); ++ region_id) {
                 const LayerRegion *layerm = layer.regions()[region_id];
@@ -2065,6 +2705,7 @@ void GCode::process_layer(
                         // extrusions represents infill or perimeter extrusions of a single island.
                         assert(dynamic_cast<const ExtrusionEntityCollection*>(ee) != nullptr);
                         const auto *extrusions = static_cast<const ExtrusionEntityCollection*>(ee);
+                        size_t island_idx = (*extrusion_islands)[extrusion_idx ++];
                         if (extrusions->entities.empty()) // This shouldn't happen but first_point() would fail.
                             continue;
 
@@ -2104,19 +2745,9 @@ void GCode::process_layer(
                                 extruder,
                                 &layer_to_print - layers.data(),
                                 layers.size(), n_slices+1);
-                            for (size_t i = 0; i <= n_slices; ++ i) {
-								bool   last = i == n_slices;
-                            	size_t island_idx = last ? n_slices : slices_test_order[i];
-                                if (// extrusions->first_point does not fit inside any slice
-									last ||
-                                    // extrusions->first_point fits inside ith slice
-                                    point_inside_surface(island_idx, extrusions->first_point())) {
-                                    if (islands[island_idx].by_region.empty())
-                                        islands[island_idx].by_region.assign(print.regions().size(), ObjectByExtruder::Island::Region());
-                                    islands[island_idx].by_region[region_id].append(entity_type, extrusions, entity_overrides);
-                                    break;
-                                }
-                            }
+                            if (islands[island_idx].by_region.empty())
+                                islands[island_idx].by_region.assign(print.regions().size(), ObjectByExtruder::Island::Region());
+                            islands[island_idx].by_region[region_id].append(entity_type, extrusions, entity_overrides);
                         }
                     }
                 }
@@ -2125,7 +2756,6 @@ void GCode::process_layer(
     } // for objects
 
     // Extrude the skirt, brim, support, perimeters, infill ordered by the extruders.
-    std::vector<std::unique_ptr<EdgeGrid::Grid>> lower_layer_edge_grids(layers.size());
     for (unsigned int extruder_id : layer_tools.extruders)
     {
         gcode += (layer_tools.has_wipe_tower && m_wipe_tower) ?
@@ -2188,8 +2818,12 @@ void GCode::process_layer(
             for (InstanceToPrint &instance_to_print : instances_to_print) {
                 m_config.apply(instance_to_print.print_object.config(), true);
                 m_layer = layers[instance_to_print.layer_id].layer();
-                if (m_config.avoid_crossing_perimeters)
-                    m_avoid_crossing_perimeters.init_layer_mp(union_ex(m_layer->lslices, true));
+                if (m_config.avoid_crossing_perimeters) {
+                    if (motion_planners != nullptr && (*motion_planners)[instance_to_print.layer_id])
+                        m_avoid_crossing_perimeters.init_layer_mp((*motion_planners)[instance_to_print.layer_id]);
+                    else
+                        m_avoid_crossing_perimeters.init_layer_mp(union_ex(m_layer->lslices, true));
+                }
 
                 if (this->config().gcode_label_objects)
                     gcode += std::string("; printing object ") + instance_to_print.print_object.model_object()->name + " id:" + std::to_string(instance_to_print.layer_id) + " copy " + std::to_string(instance_to_print.instance_id) + "\n";
@@ -2202,19 +2836,20 @@ void GCode::process_layer(
                 this->set_origin(unscale(offset));
                 if (instance_to_print.object_by_extruder.support != nullptr && !print_wipe_extrusions) {
                     m_layer = layers[instance_to_print.layer_id].support_layer;
-                    gcode += this->extrude_support(
+                    gcode += this->extrude_support(*instance_to_print.object_by_extruder.support,
                         // support_extrusion_role is erSupportMaterial, erSupportMaterialInterface or erMixed for all extrusion paths.
-                        instance_to_print.object_by_extruder.support->chained_path_from(m_last_pos, instance_to_print.object_by_extruder.support_extrusion_role));
+                        instance_to_print.object_by_extruder.support_extrusion_role);
                     m_layer = layers[instance_to_print.layer_id].layer();
                 }
+                const EdgeGrid::Grid *lower_layer_edge_grid = this->lower_layer_edge_grid(layers[instance_to_print.layer_id].layer());
                 for (ObjectByExtruder::Island &island : instance_to_print.object_by_extruder.islands) {
                     const auto& by_region_specific = is_anything_overridden ? island.by_region_per_copy(by_region_per_copy_cache, static_cast<unsigned int>(instance_to_print.instance_id), extruder_id, print_wipe_extrusions != 0) : island.by_region;
                 	//FIXME the following code prints regions in the order they are defined, the path is not optimized in any way.
                     if (print.config().infill_first) {
                         gcode += this->extrude_infill(print, by_region_specific);
-                        gcode += this->extrude_perimeters(print, by_region_specific, lower_layer_edge_grids[instance_to_print.layer_id]);
+                        gcode += this->extrude_perimeters(print, by_region_specific, lower_layer_edge_grid);
                     } else {
-                        gcode += this->extrude_perimeters(print, by_region_specific, lower_layer_edge_grids[instance_to_print.layer_id]);
+                        gcode += this->extrude_perimeters(print, by_region_specific, lower_layer_edge_grid);
                         gcode += this->extrude_infill(print,by_region_specific);
                     }
                 }
@@ -2224,39 +2859,9 @@ void GCode::process_layer(
         }
     }
 
-    // Apply spiral vase post-processing if this layer contains suitable geometry
-    // (we must feed all the G-code into the post-processor, including the first 
-    // bottom non-spiral layers otherwise it will mess with positions)
-    // we apply spiral vase at this stage because it requires a full layer.
-    // Just a reminder: A spiral vase mode is allowed for a single object per layer, single material print only.
-    if (m_spiral_vase)
-        gcode = m_spiral_vase->process_layer(gcode);
-
-    // Apply cooling logic; this may alter speeds.
-    if (m_cooling_buffer)
-        gcode = m_cooling_buffer->process_layer(gcode, layer.id());
-
-    // add tag for analyzer
-    if (gcode.find(GCodeAnalyzer::Pause_Print_Tag) != gcode.npos)
-        gcode += "\n; " + GCodeAnalyzer::End_Pause_Print_Or_Custom_Code_Tag + "\n";
-    else if (gcode.find(GCodeAnalyzer::Custom_Code_Tag) != gcode.npos)
-        gcode += "\n; " + GCodeAnalyzer::End_Pause_Print_Or_Custom_Code_Tag + "\n";
-
-#ifdef HAS_PRESSURE_EQUALIZER
-    // Apply pressure equalization if enabled;
-    // printf("G-code before filter:\n%s\n", gcode.c_str());
-    if (m_pressure_equalizer)
-        gcode = m_pressure_equalizer->process(gcode.c_str(), false);
-    // printf("G-code after filter:\n%s\n", out.c_str());
-#endif /* HAS_PRESSURE_EQUALIZER */
-    
-    _write(file, gcode);
-    BOOST_LOG_TRIVIAL(trace) << "Exported layer " << layer.id() << " print_z " << print_z << 
-        ", time estimator memory: " <<
-            format_memsize_MB(m_normal_time_estimator.memory_used() + (m_silent_time_estimator_enabled ? m_silent_time_estimator.memory_used() : 0)) <<
-        ", analyzer memory: " <<
-            format_memsize_MB(m_analyzer.memory_used()) <<
-        log_memory_info();
+    // The spiral vase, cooling and pressure equalization post-processing is performed
+    // by the following stages of the export pipeline, see GCode::process_layers().
+    return { std::move(gcode), layer.id(), m_spiral_vase_enabled };
 }
 
 void GCode::apply_print_config(const PrintConfig &print_config)
@@ -2500,32 +3105,131 @@ std::vector<float> polygon_angles_at_vertices(const Polygon &polygon, const std:
     return angles;
 }
 
-std::string GCode::extrude_loop(ExtrusionLoop loop, std::string description, double speed, std::unique_ptr<EdgeGrid::Grid> *lower_layer_edge_grid)
+// Penalties of the vertices of a counter clockwise polygon for the visibility of a seam,
+// before the seam is attracted to the last position by extrude_loop().
+static std::vector<float> seam_visibility_penalties(const Polygon &polygon, const std::vector<float> &lengths, float nozzle_r, bool was_clockwise)
 {
-    // get a copy; don't modify the orientation of the original loop object otherwise
-    // next copies (if any) would not detect the correct orientation
+    // First calculate the angles, store them as penalties. The angles are caluculated over a minimum arm length of nozzle_r.
+    std::vector<float> penalties = polygon_angles_at_vertices(polygon, lengths, nozzle_r);
+    // No penalty for reflex points, slight penalty for convex points, high penalty for flat surfaces.
+    const float penaltyConvexVertex = 1.f;
+    const float penaltyFlatSurface  = 5.f;
+    // Penalty for visible seams.
+    for (size_t i = 0; i < polygon.points.size(); ++ i) {
+        float ccwAngle = penalties[i];
+        if (was_clockwise)
+            ccwAngle = - ccwAngle;
+        float penalty = 0;
+//        if (ccwAngle <- float(PI/3.))
+        if (ccwAngle <- float(0.6 * PI))
+            // Sharp reflex vertex. We love that, it hides the seam perfectly.
+            penalty = 0.f;
+//        else if (ccwAngle > float(PI/3.))
+        else if (ccwAngle > float(0.6 * PI))
+            // Seams on sharp convex vertices are more visible than on reflex vertices.
+            penalty = penaltyConvexVertex;
+        else if (ccwAngle < 0.f) {
+            // Interpolate penalty between maximum and zero.
+            penalty = penaltyFlatSurface * bspline_kernel(ccwAngle * float(PI * 2. / 3.));
+        } else {
+            assert(ccwAngle >= 0.f);
+            // Interpolate penalty between maximum and the penalty for a convex vertex.
+            penalty = penaltyConvexVertex + (penaltyFlatSurface - penaltyConvexVertex) * bspline_kernel(ccwAngle * float(PI * 2. / 3.));
+        }
+        penalties[i] = penalty;
+    }
+    return penalties;
+}
 
-    if (m_layer->lower_layer != nullptr && lower_layer_edge_grid != nullptr) {
-        if (! *lower_layer_edge_grid) {
-            // Create the distance field for a layer below.
-            const coord_t distance_field_resolution = coord_t(scale_(1.) + 0.5);
-            *lower_layer_edge_grid = make_unique<EdgeGrid::Grid>();
-            (*lower_layer_edge_grid)->create(m_layer->lower_layer->lslices, distance_field_resolution);
-            (*lower_layer_edge_grid)->calculate_sdf();
-            #if 0
-            {
-                static int iRun = 0;
-                BoundingBox bbox = (*lower_layer_edge_grid)->bbox();
-                bbox.min(0) -= scale_(5.f);
-                bbox.min(1) -= scale_(5.f);
-                bbox.max(0) += scale_(5.f);
-                bbox.max(1) += scale_(5.f);
-                EdgeGrid::save_png(*(*lower_layer_edge_grid), bbox, scale_(0.1f), debug_out_path("GCode_extrude_loop_edge_grid-%d.png", iRun++));
+// Penalty of a seam at an overhang.
+static float seam_overhang_penalty(const Point &p, const EdgeGrid::Grid &lower_layer_edge_grid, coordf_t nozzle_dmr)
+{
+    const float penaltyOverhangHalf = 10.f;
+    // Use the edge grid distance field structure over the lower layer to calculate overhangs.
+    coord_t nozzle_r = coord_t(floor(scale_(0.5 * nozzle_dmr) + 0.5));
+    coord_t search_r = coord_t(floor(scale_(0.8 * nozzle_dmr) + 0.5));
+    coordf_t dist;
+    // Signed distance is positive outside the object, negative inside the object.
+    // The point is considered at an overhang, if it is more than nozzle radius
+    // outside of the lower layer contour.
+    #ifdef NDEBUG // to suppress unused variable warning in release mode
+        lower_layer_edge_grid.signed_distance(p, search_r, dist);
+    #else
+        bool found = lower_layer_edge_grid.signed_distance(p, search_r, dist);
+    #endif
+    // If the approximate Signed Distance Field was initialized over lower_layer_edge_grid,
+    // then the signed distnace shall always be known.
+    assert(found); 
+    return extrudate_overlap_penalty(float(nozzle_r), penaltyOverhangHalf, float(dist));
+}
+
+// Build the seam penalties of the perimeter loops of the object layers, which do not depend on the position of the extruder.
+// The penalties used to be calculated by extrude_loop() inside the serial G-code generator stage of the export pipeline,
+// now they are calculated for all loops in parallel before the export. The seam itself is still chosen by extrude_loop(),
+// as it depends on the position of the extruder and on the seam placed at the preceding layer.
+void GCode::build_seam_penalties(const Print &print)
+{
+    m_seam_penalties.clear();
+    if (print.config().spiral_vase)
+        return;
+    struct Task {
+        const ExtrusionLoop   *loop;
+        double                 nozzle_diameter;
+        const EdgeGrid::Grid  *lower_layer_edge_grid;
+    };
+    std::vector<Task> tasks;
+    for (const PrintObject *object : print.objects()) {
+        SeamPosition seam_position = object->config().seam_position.value;
+        if (seam_position != spNearest && seam_position != spAligned && seam_position != spRear)
+            continue;
+        for (const Layer *layer : object->layers()) {
+            const EdgeGrid::Grid *lower_layer_edge_grid = this->lower_layer_edge_grid(layer);
+            for (const LayerRegion *layerm : layer->regions()) {
+                // The penalties are calculated for the nozzle of the perimeter extruder. If the perimeters are printed with another extruder
+                // due to the wipe into object feature, extrude_loop() calculates the penalties itself.
+                double nozzle_diameter = print.config().nozzle_diameter.get_at(std::max(1, layerm->region()->config().perimeter_extruder.value) - 1);
+                for (const ExtrusionEntity *island : layerm->perimeters.entities)
+                    if (const ExtrusionEntityCollection *extrusions = dynamic_cast<const ExtrusionEntityCollection*>(island))
+                        for (const ExtrusionEntity *ee : extrusions->entities)
+                            if (const ExtrusionLoop *loop = dynamic_cast<const ExtrusionLoop*>(ee))
+                                if (loop->loop_role() != elrSkirt && ! loop->paths.empty())
+                                    tasks.push_back({ loop, nozzle_diameter, lower_layer_edge_grid });
             }
-            #endif
         }
     }
-  
+    std::vector<SeamPenalties> penalties(tasks.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, tasks.size()),
+        [&print, &tasks, &penalties](const tbb::blocked_range<size_t> &range) {
+            for (size_t i = range.begin(); i < range.end(); ++ i) {
+                print.throw_if_canceled();
+                const Task &task = tasks[i];
+                // The same polygon as extrude_loop() gets after ExtrusionLoop::make_counter_clockwise(): Reversing the loop keeps its first point.
+                Polygon polygon       = task.loop->polygon();
+                bool    was_clockwise = polygon.is_clockwise();
+                if (was_clockwise)
+                    std::reverse(polygon.points.begin() + 1, polygon.points.end());
+                const coord_t nozzle_r = coord_t(scale_(0.5 * task.nozzle_diameter) + 0.5);
+                SeamPenalties &out = penalties[i];
+                out.nozzle_diameter       = task.nozzle_diameter;
+                out.lower_layer_edge_grid = task.lower_layer_edge_grid;
+                out.visibility            = seam_visibility_penalties(polygon, polygon_parameter_by_length(polygon), float(nozzle_r), was_clockwise);
+                if (task.lower_layer_edge_grid != nullptr) {
+                    out.overhang.reserve(polygon.points.size());
+                    for (const Point &p : polygon.points)
+                        out.overhang.emplace_back(seam_overhang_penalty(p, *task.lower_layer_edge_grid, task.nozzle_diameter));
+                }
+            }
+        });
+    m_seam_penalties.reserve(tasks.size());
+    for (size_t i = 0; i < tasks.size(); ++ i)
+        m_seam_penalties.emplace(tasks[i].loop, std::move(penalties[i]));
+}
+
+std::string GCode::extrude_loop(ExtrusionLoop loop, std::string description, double speed, const EdgeGrid::Grid *lower_layer_edge_grid, const SeamPenalties *seam_penalties)
+{
+    // get a copy; don't modify the orientation of the original loop object otherwise
+    // next copies (if any) would not detect the correct orientation
+
     // extrude all loops ccw
     bool was_clockwise = loop.make_counter_clockwise();
     
@@ -2561,43 +3265,29 @@ std::string GCode::extrude_loop(ExtrusionLoop loop, std::string description, dou
 
         // Insert a projection of last_pos into the polygon.
         size_t last_pos_proj_idx;
+        bool   last_pos_proj_inserted;
         {
+            size_t num_points = polygon.points.size();
             Points::iterator it = project_point_to_polygon_and_insert(polygon, last_pos, 0.1 * nozzle_r);
             last_pos_proj_idx = it - polygon.points.begin();
+            last_pos_proj_inserted = polygon.points.size() > num_points;
         }
 
         // Parametrize the polygon by its length.
         std::vector<float> lengths = polygon_parameter_by_length(polygon);
 
+        // The precalculated penalties are only valid for the same nozzle and the same lower layer.
+        if (seam_penalties != nullptr && (seam_penalties->nozzle_diameter != nozzle_dmr || seam_penalties->lower_layer_edge_grid != lower_layer_edge_grid ||
+            seam_penalties->visibility.size() + (last_pos_proj_inserted ? 1 : 0) != polygon.points.size()))
+            seam_penalties = nullptr;
+
         // For each polygon point, store a penalty.
-        // First calculate the angles, store them as penalties. The angles are caluculated over a minimum arm length of nozzle_r.
-        std::vector<float> penalties = polygon_angles_at_vertices(polygon, lengths, float(nozzle_r));
-        // No penalty for reflex points, slight penalty for convex points, high penalty for flat surfaces.
-        const float penaltyConvexVertex = 1.f;
-        const float penaltyFlatSurface  = 5.f;
-        const float penaltyOverhangHalf = 10.f;
-        // Penalty for visible seams.
+        // The angles at the vertices next to the inserted projection of last_pos change, therefore the precalculated visibility penalties
+        // are only used if no point was inserted.
+        std::vector<float> penalties = (seam_penalties != nullptr && ! last_pos_proj_inserted) ?
+            seam_penalties->visibility : seam_visibility_penalties(polygon, lengths, float(nozzle_r), was_clockwise);
         for (size_t i = 0; i < polygon.points.size(); ++ i) {
-            float ccwAngle = penalties[i];
-            if (was_clockwise)
-                ccwAngle = - ccwAngle;
-            float penalty = 0;
-//            if (ccwAngle <- float(PI/3.))
-            if (ccwAngle <- float(0.6 * PI))
-                // Sharp reflex vertex. We love that, it hides the seam perfectly.
-                penalty = 0.f;
-//            else if (ccwAngle > float(PI/3.))
-            else if (ccwAngle > float(0.6 * PI))
-                // Seams on sharp convex vertices are more visible than on reflex vertices.
-                penalty = penaltyConvexVertex;
-            else if (ccwAngle < 0.f) {
-                // Interpolate penalty between maximum and zero.
-                penalty = penaltyFlatSurface * bspline_kernel(ccwAngle * float(PI * 2. / 3.));
-            } else {
-                assert(ccwAngle >= 0.f);
-                // Interpolate penalty between maximum and the penalty for a convex vertex.
-                penalty = penaltyConvexVertex + (penaltyFlatSurface - penaltyConvexVertex) * bspline_kernel(ccwAngle * float(PI * 2. / 3.));
-            }
+            float penalty = penalties[i];
             // Give a negative penalty for points close to the last point or the prefered seam location.
             //float dist_to_last_pos_proj = last_pos_proj.distance_to(polygon.points[i]);
             float dist_to_last_pos_proj = (i < last_pos_proj_idx) ? 
@@ -2609,26 +3299,12 @@ std::string GCode::extrude_loop(ExtrusionLoop loop, std::string description, dou
         }
 
         // Penalty for overhangs.
-        if (lower_layer_edge_grid && (*lower_layer_edge_grid)) {
-            // Use the edge grid distance field structure over the lower layer to calculate overhangs.
-            coord_t nozzle_r = coord_t(floor(scale_(0.5 * nozzle_dmr) + 0.5));
-            coord_t search_r = coord_t(floor(scale_(0.8 * nozzle_dmr) + 0.5));
-            for (size_t i = 0; i < polygon.points.size(); ++ i) {
-                const Point &p = polygon.points[i];
-                coordf_t dist;
-                // Signed distance is positive outside the object, negative inside the object.
-                // The point is considered at an overhang, if it is more than nozzle radius
-                // outside of the lower layer contour.
-                #ifdef NDEBUG // to suppress unused variable warning in release mode
-                    (*lower_layer_edge_grid)->signed_distance(p, search_r, dist);
-                #else
-                    bool found = (*lower_layer_edge_grid)->signed_distance(p, search_r, dist);
-                #endif
-                // If the approximate Signed Distance Field was initialized over lower_layer_edge_grid,
-                // then the signed distnace shall always be known.
-                assert(found); 
-                penalties[i] += extrudate_overlap_penalty(float(nozzle_r), penaltyOverhangHalf, float(dist));
-            }
+        if (lower_layer_edge_grid != nullptr) {
+            for (size_t i = 0; i < polygon.points.size(); ++ i)
+                penalties[i] += (seam_penalties == nullptr || (last_pos_proj_inserted && i == last_pos_proj_idx)) ?
+                    seam_overhang_penalty(polygon.points[i], *lower_layer_edge_grid, nozzle_dmr) :
+                    // Skip the inserted projection of last_pos, which is not in the precalculated penalties.
+                    seam_penalties->overhang[(last_pos_proj_inserted && i > last_pos_proj_idx) ? i - 1 : i];
         }
 
         // Find a point with a minimum penalty.
@@ -2765,18 +3441,24 @@ std::string GCode::extrude_loop(ExtrusionLoop loop, std::string description, dou
     return gcode;
 }
 
-std::string GCode::extrude_multi_path(ExtrusionMultiPath multipath, std::string description, double speed)
+// Copy of the path simplified for the G-code export. The simplification produces a new point vector,
+// therefore the points of the source path are not copied first.
+static inline ExtrusionPath simplified_path(const ExtrusionPath &path)
+{
+    return ExtrusionPath(Polyline(MultiPoint::_douglas_peucker(path.polyline.points, SCALED_RESOLUTION)), path);
+}
+
+std::string GCode::extrude_multi_path(const ExtrusionMultiPath &multipath, std::string description, double speed)
 {
     // extrude along the path
     std::string gcode;
-    for (ExtrusionPath path : multipath.paths) {
+    for (const ExtrusionPath &path : multipath.paths) {
 //    description += ExtrusionLoop::role_to_string(loop.loop_role());
 //    description += ExtrusionEntity::role_to_string(path->role);
-        path.simplify(SCALED_RESOLUTION);
-        gcode += this->_extrude(path, description, speed);
+        gcode += this->_extrude(simplified_path(path), description, speed);
     }
     if (m_wipe.enable) {
-        m_wipe.path = std::move(multipath.paths.back().polyline);  // TODO: don't limit wipe to last path
+        m_wipe.path = multipath.paths.back().polyline;  // TODO: don't limit wipe to last path
         m_wipe.path.reverse();
     }
     // reset acceleration
@@ -2784,23 +3466,24 @@ std::string GCode::extrude_multi_path(ExtrusionMultiPath multipath, std::string
     return gcode;
 }
 
-std::string GCode::extrude_entity(const ExtrusionEntity &entity, std::string description, double speed, std::unique_ptr<EdgeGrid::Grid> *lower_layer_edge_grid)
+std::string GCode::extrude_entity(const ExtrusionEntity &entity, std::string description, double speed, const EdgeGrid::Grid *lower_layer_edge_grid)
 {
     if (const ExtrusionPath* path = dynamic_cast<const ExtrusionPath*>(&entity))
         return this->extrude_path(*path, description, speed);
     else if (const ExtrusionMultiPath* multipath = dynamic_cast<const ExtrusionMultiPath*>(&entity))
         return this->extrude_multi_path(*multipath, description, speed);
-    else if (const ExtrusionLoop* loop = dynamic_cast<const ExtrusionLoop*>(&entity))
-        return this->extrude_loop(*loop, description, speed, lower_layer_edge_grid);
-    else
+    else if (const ExtrusionLoop* loop = dynamic_cast<const ExtrusionLoop*>(&entity)) {
+        auto it_seam_penalties = m_seam_penalties.find(loop);
+        return this->extrude_loop(*loop, description, speed, lower_layer_edge_grid, (it_seam_penalties == m_seam_penalties.end()) ? nullptr : &it_seam_penalties->second);
+    } else
         throw std::invalid_argument("Invalid argument supplied to extrude()");
     return "";
 }
 
-std::string GCode::extrude_path(ExtrusionPath path, std::string description, double speed)
+std::string GCode::extrude_path(const ExtrusionPath &path_src, std::string description, double speed)
 {
 //    description += ExtrusionEntity::role_to_string(path.role());
-    path.simplify(SCALED_RESOLUTION);
+    ExtrusionPath path = simplified_path(path_src);
     std::string gcode = this->_extrude(path, description, speed);
     if (m_wipe.enable) {
         m_wipe.path = std::move(path.polyline);
@@ -2812,13 +3495,14 @@ std::string GCode::extrude_path(ExtrusionPath path, std::string description, dou
 }
 
 // Extrude perimeters: Decide where to put seams (hide or align seams).
-std::string GCode::extrude_perimeters(const Print &print, const std::vector<ObjectByExtruder::Island::Region> &by_region, std::unique_ptr<EdgeGrid::Grid> &lower_layer_edge_grid)
+std::string GCode::extrude_perimeters(const Print &print, const std::vector<ObjectByExtruder::Island::Region> &by_region, const EdgeGrid::Grid *lower_layer_edge_grid)
 {
     std::string gcode;
     for (const ObjectByExtruder::Island::Region &region : by_region) {
-        m_config.apply(print.regions()[&region - &by_region.front()]->config());
+        m_last_region = print.regions()[&region - &by_region.front()];
+        m_config.apply(m_last_region->config());
         for (const ExtrusionEntity *ee : region.perimeters)
-            gcode += this->extrude_entity(*ee, "perimeter", -1., &lower_layer_edge_grid);
+            gcode += this->extrude_entity(*ee, "perimeter", -1., lower_layer_edge_grid);
     }
     return gcode;
 }
@@ -2828,14 +3512,32 @@ std::string GCode::extrude_infill(const Print &print, const std::vector<ObjectBy
 {
     std::string gcode;
     for (const ObjectByExtruder::Island::Region &region : by_region) {
-        m_config.apply(print.regions()[&region - &by_region.front()]->config());
-		ExtrusionEntitiesPtr extrusions { region.infills };
-		chain_and_reorder_extrusion_entities(extrusions, &m_last_pos);
-        for (const ExtrusionEntity *fill : extrusions) {
+        m_last_region = print.regions()[&region - &by_region.front()];
+        m_config.apply(m_last_region->config());
+        // Order the infills without modifying the extrusion entities of the layer, only the entities to be extruded reversed are copied.
+        for (const std::pair<size_t, bool> &idx_fill : chain_extrusion_entities(region.infills, &m_last_pos)) {
+            const ExtrusionEntity *fill = region.infills[idx_fill.first];
             auto *eec = dynamic_cast<const ExtrusionEntityCollection*>(fill);
             if (eec) {
-				for (ExtrusionEntity *ee : eec->chained_path_from(m_last_pos).entities)
-                    gcode += this->extrude_entity(*ee, "infill");
+                // A reversal of a sortable collection is not needed, its entities are chained again from the last position.
+                if (eec->no_sort) {
+                    for (const ExtrusionEntity *ee : eec->entities)
+                        gcode += this->extrude_entity(*ee, "infill");
+                } else {
+                    for (const std::pair<size_t, bool> &idx : chain_extrusion_entities(eec->entities, &m_last_pos)) {
+                        const ExtrusionEntity *ee = eec->entities[idx.first];
+                        if (idx.second) {
+                            std::unique_ptr<ExtrusionEntity> reversed(ee->clone());
+                            reversed->reverse();
+                            gcode += this->extrude_entity(*reversed, "infill");
+                        } else
+                            gcode += this->extrude_entity(*ee, "infill");
+                    }
+                }
+            } else if (idx_fill.second) {
+                std::unique_ptr<ExtrusionEntity> reversed(fill->clone());
+                reversed->reverse();
+                gcode += this->extrude_entity(*reversed, "infill");
             } else
                 gcode += this->extrude_entity(*fill, "infill");
         }
@@ -2843,7 +3545,8 @@ std::string GCode::extrude_infill(const Print &print, const std::vector<ObjectBy
     return gcode;
 }
 
-std::string GCode::extrude_support(const ExtrusionEntityCollection &support_fills)
+// Chain the support extrusions of the given role by a greedy algorithm to minimize a travel distance.
+std::string GCode::extrude_support(const ExtrusionEntityCollection &support_fills, ExtrusionRole support_extrusion_role)
 {
     std::string gcode;
     if (! support_fills.entities.empty()) {
@@ -2851,7 +3554,15 @@ std::string GCode::extrude_support(const ExtrusionEntityCollection &support_fill
         const char   *support_interface_label  = "support material interface";
         const double  support_speed            = m_config.support_material_speed.value;
         const double  support_interface_speed  = m_config.support_material_interface_speed.get_abs_value(support_speed);
-        for (const ExtrusionEntity *ee : support_fills.entities) {
+        // Order the support extrusions without cloning them, only the entities to be extruded reversed are copied.
+        for (const std::pair<size_t, bool> &idx : support_fills.chained_path_order(m_last_pos, support_extrusion_role)) {
+            const ExtrusionEntity           *ee = support_fills.entities[idx.first];
+            std::unique_ptr<ExtrusionEntity> reversed;
+            if (idx.second) {
+                reversed.reset(ee->clone());
+                reversed->reverse();
+                ee = reversed.get();
+            }
             ExtrusionRole role = ee->role();
             assert(role == erSupportMaterial || role == erSupportMaterialInterface);
             const char  *label = (role == erSupportMaterial) ? support_label : support_interface_label;
@@ -2870,28 +3581,75 @@ std::string GCode::extrude_support(const ExtrusionEntityCollection &support_fill
     return gcode;
 }
 
-void GCode::_write(FILE* file, const char *what)
+void GCode::_write(GCodeOutputStream &file, const char *what)
 {
     if (what != nullptr) {
-        // apply analyzer, if enabled
-        const char* gcode = m_enable_analyzer ? m_analyzer.process_gcode(what).c_str() : what;
+        // The gcode is parsed just once, the parsed lines are shared by the analyzer and by both time estimators.
+        GCodeReader::GCodeLine gline;
+        // The color change tag is only meant for the time estimators, it is not exported.
+        bool skip_line = false;
+        // Lines M73 are reserved after the current line.
+        bool reserve_M73 = false;
+        auto action = [this, &file, &skip_line, &reserve_M73](GCodeReader&, const GCodeReader::GCodeLine &line) {
+            // apply analyzer, if enabled, it removes its own workcodes from the output
+            if (m_enable_analyzer && ! m_analyzer.process_gcode_line(line)) {
+                skip_line = true;
+                return;
+            }
+            // updates time estimators
+            if (m_time_estimator_threads != nullptr)
+                m_time_estimator_threads->add_gcode_line(line);
+            else {
+                m_normal_time_estimator.add_gcode_line(line);
+                if (m_silent_time_estimator_enabled)
+                    m_silent_time_estimator.add_gcode_line(line);
+            }
+            skip_line = line.raw() == "; " + GCodeTimeEstimator::Color_Change_Tag;
+            if (GCodeTimeEstimator::is_g1_line(line)) {
+                ++ m_g1_lines_count;
+                if (m_remaining_times && line.has_e() && ++ m_g1_extrusions_since_reserved_M73 == Reserved_M73_Lines_Interval)
+                    reserve_M73 = true;
+            }
+        };
+        for (const char *ptr = what; *ptr != 0;) {
+            gline.reset();
+            skip_line   = false;
+            reserve_M73 = false;
+            const char *end = m_gcode_reader.parse_line(ptr, gline, action);
+            if (! skip_line) {
+                if (m_enable_analyzer) {
+                    file.write(gline.raw());
+                    file.write("\n", 1);
+                } else
+                    // writes the line to file as is
+                    file.write(ptr, end - ptr);
+            }
+            if (reserve_M73) {
+                _reserve_M73_lines(file, m_g1_lines_count);
+                m_g1_extrusions_since_reserved_M73 = 0;
+            }
+            ptr = end;
+        }
+    }
+}
 
-        // writes string to file
-        fwrite(gcode, 1, ::strlen(gcode), file);
-        // updates time estimator and gcode lines vector
-        m_normal_time_estimator.add_gcode_block(gcode);
-        if (m_silent_time_estimator_enabled)
-            m_silent_time_estimator.add_gcode_block(gcode);
+void GCode::_reserve_M73_lines(GCodeOutputStream &file, unsigned int g1_line_id)
+{
+    m_reserved_M73_lines.push_back({ file.size(), g1_line_id, GCodeTimeEstimator::Normal });
+    file.write(GCodeTimeEstimator::Reserved_M73_Line);
+    if (m_silent_time_estimator_enabled) {
+        m_reserved_M73_lines.push_back({ file.size(), g1_line_id, GCodeTimeEstimator::Silent });
+        file.write(GCodeTimeEstimator::Reserved_M73_Line);
     }
 }
 
-void GCode::_writeln(FILE* file, const std::string &what)
+void GCode::_writeln(GCodeOutputStream &file, const std::string &what)
 {
     if (! what.empty())
         _write(file, (what.back() == '\n') ? what : (what + '\n'));
 }
 
-void GCode::_write_format(FILE* file, const char* format, ...)
+void GCode::_write_format(GCodeOutputStream &file, const char* format, ...)
 {
     va_list args;
     va_start(args, format);
@@ -3070,13 +3828,38 @@ std::string GCode::_extrude(const ExtrusionPath &path, std::string description,
     double path_length = 0.;
     {
         std::string comment = m_config.gcode_comments ? description : "";
-        for (const Line &line : path.polyline.lines()) {
-            const double line_length = line.length() * SCALING_FACTOR;
-            path_length += line_length;
-            gcode += m_writer.extrude_to_xy(
-                this->point_to_gcode(line.b),
-                e_per_mm * line_length,
-                comment);
+        // Reserve the room for the extrusion lines, which are formatted directly into gcode.
+        gcode.reserve(gcode.size() + path.polyline.points.size() * (32 + comment.size()));
+        if (m_arc_fitting && path.polyline.points.size() > 3) {
+            // The extrusion is distributed along the length of the arcs, which is close to the length of the line segments they replace.
+            const Points &points = path.polyline.points;
+            size_t        idx_start = 0;
+            for (const ArcFitter::Segment &segment : ArcFitter::fit(points, scale_(m_config.arc_fitting_tolerance.value))) {
+                const double segment_length = segment.length * SCALING_FACTOR;
+                path_length += segment_length;
+                if (segment.arc)
+                    m_writer.extrude_arc_to_xy(gcode,
+                        this->point_to_gcode(points[segment.end]),
+                        (segment.center - points[idx_start].cast<double>()) * SCALING_FACTOR,
+                        segment.ccw,
+                        e_per_mm * segment_length,
+                        comment);
+                else
+                    m_writer.extrude_to_xy(gcode,
+                        this->point_to_gcode(points[segment.end]),
+                        e_per_mm * segment_length,
+                        comment);
+                idx_start = segment.end;
+            }
+        } else {
+            for (const Line &line : path.polyline.lines()) {
+                const double line_length = line.length() * SCALING_FACTOR;
+                path_length += line_length;
+                m_writer.extrude_to_xy(gcode,
+                    this->point_to_gcode(line.b),
+                    e_per_mm * line_length,
+                    comment);
+            }
         }
     }
     if (m_enable_cooling_markers)
@@ -3150,12 +3933,13 @@ bool GCode::needs_retraction(const Polyline &travel, ExtrusionRole role)
             return false;
     }
 
-    if (m_config.only_retract_when_crossing_perimeters && m_layer != nullptr &&
-        m_config.fill_density.value > 0 && m_layer->any_internal_region_slice_contains(travel))
-        // Skip retraction if travel is contained in an internal slice *and*
-        // internal infill is enabled (so that stringing is entirely not visible).
-        //FIXME any_internal_region_slice_contains() is potentionally very slow, it shall test for the bounding boxes first.
-        return false;
+    if (m_config.only_retract_when_crossing_perimeters && m_layer != nullptr && m_config.fill_density.value > 0) {
+        auto it_index = m_internal_slices_indices.find(m_layer);
+        if (it_index == m_internal_slices_indices.end() ? m_layer->any_internal_region_slice_contains(travel) : it_index->second->contains(travel))
+            // Skip retraction if travel is contained in an internal slice *and*
+            // internal infill is enabled (so that stringing is entirely not visible).
+            return false;
+    }
     
     // retract if only_retract_when_crossing_perimeters is disabled or doesn't apply
     return true;
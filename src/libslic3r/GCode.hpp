@@ -11,18 +11,23 @@
 #include "Print.hpp"
 #include "PrintConfig.hpp"
 #include "GCode/CoolingBuffer.hpp"
+#include "GCode/InternalSlicesIndex.hpp"
 #include "GCode/SpiralVase.hpp"
 #include "GCode/ToolOrdering.hpp"
 #include "GCode/WipeTower.hpp"
 #include "GCodeTimeEstimator.hpp"
 #include "EdgeGrid.hpp"
 #include "GCode/Analyzer.hpp"
+#include "GCode/BinaryGCode.hpp"
 #if ENABLE_THUMBNAIL_GENERATOR
 #include "GCode/ThumbnailData.hpp"
 #endif // ENABLE_THUMBNAIL_GENERATOR
 
+#include <cstdio>
+#include <cstring>
 #include <memory>
 #include <string>
+#include <unordered_map>
 
 #ifdef HAS_PRESSURE_EQUALIZER
 #include "GCode/PressureEqualizer.hpp"
@@ -32,6 +37,7 @@ namespace Slic3r {
 
 // Forward declarations.
 class GCode;
+class GCodeLayerCache;
 class GCodePreviewData;
 
 class AvoidCrossingPerimeters {
@@ -50,7 +56,9 @@ public:
 
     void reset() { m_external_mp.reset(); m_layer_mp.reset(); }
 	void init_external_mp(const Print &print);
-    void init_layer_mp(const ExPolygons &islands) { m_layer_mp = Slic3r::make_unique<MotionPlanner>(islands); }
+    void init_layer_mp(const ExPolygons &islands) { m_layer_mp = std::make_shared<MotionPlanner>(islands); }
+    // Use a motion planner built ahead by GCode::process_layers(), possibly shared by multiple instances of an object.
+    void init_layer_mp(std::shared_ptr<MotionPlanner> mp) { m_layer_mp = std::move(mp); }
 
     Polyline travel_to(const GCode &gcodegen, const Point &point);
 
@@ -59,7 +67,7 @@ private:
 	static Polygons collect_contours_all_layers(const PrintObjectPtrs& objects);
 
     std::unique_ptr<MotionPlanner> m_external_mp;
-    std::unique_ptr<MotionPlanner> m_layer_mp;
+    std::shared_ptr<MotionPlanner> m_layer_mp;
 };
 
 class OozePrevention {
@@ -137,11 +145,56 @@ private:
     double                                                       m_last_wipe_tower_print_z = 0.f;
 };
 
+// Output sink of the G-code export.
+// The G-code is collected into a large buffer, which is passed to the output file in big blocks,
+// so that the many short G-code snippets do not go through the stdio layer one by one.
+// The output file may be a regular file or a pipe. If no output file is provided, the complete G-code
+// is accumulated in memory and it may be retrieved with data().
+class GCodeOutputStream {
+public:
+    // Size of the blocks written into the output file.
+    static constexpr size_t default_block_size = 4 * 1024 * 1024;
+
+    // Write into an already opened file or a pipe. The stream does not take ownership of the FILE.
+    explicit GCodeOutputStream(FILE *file, size_t block_size = default_block_size);
+    // Accumulate the G-code in memory.
+    GCodeOutputStream() : m_file(nullptr), m_block_size(0), m_size(0), m_error(false) {}
+    // The buffered G-code is not flushed on destruction, so that a canceled export does not write a partial block.
+    // Call flush() to finalize the output.
+
+    // Append the G-code verbatim, it is not passed through the G-code analyzer and the time estimators.
+    void                write(const char *data, size_t len);
+    void                write(const char *data) { this->write(data, ::strlen(data)); }
+    void                write(const std::string &data) { this->write(data.data(), data.size()); }
+    // Format directly into the output buffer.
+    void                write_format(const char *format, ...);
+    // Pass the buffered G-code to the output file. Returns false on an output error, for example if the disk is full.
+    bool                flush();
+    bool                is_error() const { return m_error; }
+    // Number of bytes written so far, including the buffered ones. It is the offset of the next byte written into the file.
+    size_t              size() const { return m_size; }
+    // G-code accumulated in memory, if no output file was provided.
+    const std::string&  data() const { return m_buffer; }
+
+private:
+    GCodeOutputStream(const GCodeOutputStream&) = delete;
+    GCodeOutputStream& operator=(const GCodeOutputStream&) = delete;
+
+    FILE               *m_file;
+    size_t              m_block_size;
+    // The buffer is reused between the blocks, it is allocated just once.
+    std::string         m_buffer;
+    size_t              m_size;
+    bool                m_error;
+};
+
 class GCode {
 public:        
     GCode() : 
     	m_origin(Vec2d::Zero()),
         m_enable_loop_clipping(true), 
+        m_arc_fitting(false), 
+        m_binary_gcode(false), 
         m_enable_cooling_markers(false), 
         m_enable_extrusion_role_markers(false), 
         m_enable_analyzer(false),
@@ -149,17 +202,22 @@ public:
         m_layer_count(0),
         m_layer_index(-1), 
         m_layer(nullptr), 
+        m_last_region(nullptr),
         m_volumetric_speed(0),
         m_last_pos_defined(false),
         m_last_extrusion_role(erNone),
         m_last_mm3_per_mm(GCodeAnalyzer::Default_mm3_per_mm),
         m_last_width(GCodeAnalyzer::Default_Width),
         m_last_height(GCodeAnalyzer::Default_Height),
+        m_spiral_vase_enabled(false),
         m_brim_done(false),
         m_second_layer_things_done(false),
         m_normal_time_estimator(GCodeTimeEstimator::Normal),
         m_silent_time_estimator(GCodeTimeEstimator::Silent),
         m_silent_time_estimator_enabled(false),
+        m_remaining_times(false),
+        m_g1_lines_count(0),
+        m_g1_extrusions_since_reserved_M73(0),
         m_last_obj_copy(nullptr, Point(std::numeric_limits<coord_t>::max(), std::numeric_limits<coord_t>::max()))
         {}
     ~GCode() {}
@@ -211,16 +269,42 @@ public:
 
 private:
 #if ENABLE_THUMBNAIL_GENERATOR
-    void            _do_export(Print &print, FILE *file, ThumbnailsGeneratorCallback thumbnail_cb);
+    void            _do_export(Print &print, GCodeOutputStream &file, ThumbnailsGeneratorCallback thumbnail_cb);
 #else
-    void            _do_export(Print &print, FILE *file);
+    void            _do_export(Print &print, GCodeOutputStream &file);
 #endif //ENABLE_THUMBNAIL_GENERATOR
 
     static std::vector<LayerToPrint>        		                   collect_layers_to_print(const PrintObject &object);
     static std::vector<std::pair<coordf_t, std::vector<LayerToPrint>>> collect_layers_to_print(const Print &print);
-    void            process_layer(
+
+    // G-code of a single layer produced by process_layer(), passed through the stages of the export pipeline.
+    struct LayerResult {
+        std::string gcode;
+        size_t      layer_id;
+        // Shall the spiral vase post-processor modify this layer?
+        bool        spiral_vase_enable;
+        // Has the G-code already been processed by the CoolingBuffer? Set if the layer cache is active, see process_layers().
+        bool        cooled { false };
+    };
+    // Export a sequence of layers through a pipeline of process_layer() -> SpiralVase -> CoolingBuffer -> PressureEqualizer -> _write().
+    // The stages run concurrently on consecutive layers, each stage is serial and processes the layers in order.
+    void            process_layers(
         // Write into the output file.
-        FILE                            *file,
+        GCodeOutputStream                                                  &file,
+        const Print                                                        &print,
+        const ToolOrdering                                                 &tool_ordering,
+        const std::vector<std::pair<coordf_t, std::vector<LayerToPrint>>> &layers_to_print,
+        // Pairs of PrintObject index and its instance index.
+        const std::vector<std::pair<size_t, size_t>>                       *ordering,
+        // If set to size_t(-1), then print all copies of all objects.
+        // Otherwise print a single copy of a single object.
+        const size_t                                                        single_object_idx = size_t(-1),
+        // If set, the motion planners are taken from / stored into the cache indexed the same as layers_to_print,
+        // so that they are shared by the copies of an object printed one after another in the sequential printing mode.
+        std::vector<std::vector<std::shared_ptr<MotionPlanner>>>           *motion_planners_cache = nullptr,
+        // If set, the layers are reused from / stored into the G-code of the previous export.
+        GCodeLayerCache                                                    *layer_cache = nullptr);
+    LayerResult     process_layer(
         const Print                     &print,
         // Set of object & print layers of the same PrintObject and with the same print_z.
         const std::vector<LayerToPrint> &layers,
@@ -229,17 +313,78 @@ private:
 		const std::vector<std::pair<size_t, size_t>> *ordering,
         // If set to size_t(-1), then print all copies of all objects.
         // Otherwise print a single copy of a single object.
-        const size_t                     single_object_idx = size_t(-1));
+        const size_t                     single_object_idx = size_t(-1),
+        // Motion planners over the object layers of "layers", indexed the same as "layers", built ahead by process_layers().
+        // If not set or if an item is null, the motion planner is built by process_layer().
+        const std::vector<std::shared_ptr<MotionPlanner>> *motion_planners = nullptr);
+    // Build m_lower_layer_edge_grids for the seam placement of all object layers.
+    void            build_lower_layer_edge_grids(const Print &print);
+    // Distance field over the slices of the layer below the given layer, if it was built.
+    const EdgeGrid::Grid* lower_layer_edge_grid(const Layer *layer) const;
+    // Build m_internal_slices_indices for the retraction decisions of the travels of all object layers.
+    void            build_internal_slices_indices(const Print &print);
+
+    // Penalties of the vertices of a perimeter loop for the seam placement, which do not depend on the position of the extruder
+    // or on the seams placed before. Used by extrude_loop() if the loop is extruded with the nozzle and over the lower layer
+    // the penalties were calculated for, otherwise extrude_loop() calculates the penalties itself.
+    struct SeamPenalties {
+        double                 nozzle_diameter { 0. };
+        const EdgeGrid::Grid  *lower_layer_edge_grid { nullptr };
+        // Penalties for the visibility of a seam at the vertices of the counter clockwise polygon of the loop.
+        std::vector<float>     visibility;
+        // Penalties for the overhangs at the same vertices, empty if there is no lower_layer_edge_grid.
+        std::vector<float>     overhang;
+    };
+    // Build m_seam_penalties for the perimeter loops of all object layers.
+    void            build_seam_penalties(const Print &print);
+    // Build m_layer_extrusion_islands for all object layers.
+    void            build_layer_extrusion_islands(const Print &print);
+    // Islands of the infill and perimeter collections of the layer regions in the order traversed by process_layer(), if they were assigned.
+    const std::vector<uint32_t>* layer_extrusion_islands(const Layer *layer) const;
+
+    // State of the G-code generator and of the CoolingBuffer carried over from layer to layer, see GCodeLayerCache.
+    // The configuration, the placeholder parser variables and the data built for all layers before the export are not part
+    // of the state, they are constant while exporting the layers.
+    struct LayerState {
+        GCodeWriter::State                   writer;
+        CoolingBuffer::State                 cooling_buffer;
+        Vec2d                                origin;
+        Point                                last_pos;
+        bool                                 last_pos_defined;
+        Points                               wipe_path;
+        bool                                 use_external_mp;
+        bool                                 use_external_mp_once;
+        bool                                 disable_once;
+        int                                  layer_index;
+        const Layer                         *layer;
+        const PrintRegion                   *last_region;
+        std::map<const PrintObject*, Point>  seam_position;
+        std::vector<coordf_t>                skirt_done;
+        bool                                 brim_done;
+        bool                                 second_layer_things_done;
+        std::pair<const PrintObject*, Point> last_obj_copy;
+        ExtrusionRole                        last_extrusion_role;
+        ExtrusionRole                        last_analyzer_extrusion_role;
+        double                               last_mm3_per_mm;
+        float                                last_width;
+        float                                last_height;
+        std::set<std::string>                placeholder_parser_failed_templates;
+        bool operator==(const LayerState &rhs) const;
+    };
+    LayerState      layer_state() const;
+    void            set_layer_state(const LayerState &state);
+    // Hash of the inputs of the export of the layers, which are not specific to a single layer, see GCodeLayerCache.
+    size_t          layer_cache_key(const Print &print) const;
 
     void            set_last_pos(const Point &pos) { m_last_pos = pos; m_last_pos_defined = true; }
     bool            last_pos_defined() const { return m_last_pos_defined; }
     void            set_extruders(const std::vector<unsigned int> &extruder_ids);
     std::string     preamble();
     std::string     change_layer(coordf_t print_z);
-    std::string     extrude_entity(const ExtrusionEntity &entity, std::string description = "", double speed = -1., std::unique_ptr<EdgeGrid::Grid> *lower_layer_edge_grid = nullptr);
-    std::string     extrude_loop(ExtrusionLoop loop, std::string description, double speed = -1., std::unique_ptr<EdgeGrid::Grid> *lower_layer_edge_grid = nullptr);
-    std::string     extrude_multi_path(ExtrusionMultiPath multipath, std::string description = "", double speed = -1.);
-    std::string     extrude_path(ExtrusionPath path, std::string description = "", double speed = -1.);
+    std::string     extrude_entity(const ExtrusionEntity &entity, std::string description = "", double speed = -1., const EdgeGrid::Grid *lower_layer_edge_grid = nullptr);
+    std::string     extrude_loop(ExtrusionLoop loop, std::string description, double speed = -1., const EdgeGrid::Grid *lower_layer_edge_grid = nullptr, const SeamPenalties *seam_penalties = nullptr);
+    std::string     extrude_multi_path(const ExtrusionMultiPath &multipath, std::string description = "", double speed = -1.);
+    std::string     extrude_path(const ExtrusionPath &path, std::string description = "", double speed = -1.);
 
     // Extruding multiple objects with soluble / non-soluble / combined supports
     // on a multi-material printer, trying to minimize tool switches.
@@ -304,9 +449,9 @@ private:
 		// For sequential print, the instance of the object to be printing has to be defined.
 		const size_t                     				 single_object_instance_idx);
 
-    std::string     extrude_perimeters(const Print &print, const std::vector<ObjectByExtruder::Island::Region> &by_region, std::unique_ptr<EdgeGrid::Grid> &lower_layer_edge_grid);
+    std::string     extrude_perimeters(const Print &print, const std::vector<ObjectByExtruder::Island::Region> &by_region, const EdgeGrid::Grid *lower_layer_edge_grid);
     std::string     extrude_infill(const Print &print, const std::vector<ObjectByExtruder::Island::Region> &by_region);
-    std::string     extrude_support(const ExtrusionEntityCollection &support_fills);
+    std::string     extrude_support(const ExtrusionEntityCollection &support_fills, ExtrusionRole support_extrusion_role);
 
     std::string     travel_to(const Point &point, ExtrusionRole role, std::string comment);
     bool            needs_retraction(const Polyline &travel, ExtrusionRole role = erNone);
@@ -323,10 +468,20 @@ private:
     PlaceholderParser                   m_placeholder_parser;
     // Collection of templates, on which the placeholder substitution failed.
     std::set<std::string>               m_placeholder_parser_failed_templates;
+    // Processed templates not containing any macro or variable expansion, keyed by the template.
+    // The placeholder parser returns the same text for these every time, there is no need to run it again.
+    std::map<std::string, std::string>  m_placeholder_parser_constant_templates;
     OozePrevention                      m_ooze_prevention;
     Wipe                                m_wipe;
     AvoidCrossingPerimeters             m_avoid_crossing_perimeters;
     bool                                m_enable_loop_clipping;
+    // Replace runs of the line segments of the extrusions by G2 / G3 arcs.
+    bool                                m_arc_fitting;
+    // Export the binary G-code. The thumbnails and the full config are collected by _do_export() into their metadata blocks
+    // instead of being written into the ASCII G-code, which is converted into the binary G-code after the time estimator post-processing.
+    bool                                m_binary_gcode;
+    std::vector<BinaryGCode::Thumbnail> m_binary_thumbnails;
+    std::string                         m_binary_config;
     // If enabled, the G-code generator will put following comments at the ends
     // of the G-code lines: _EXTRUDE_SET_SPEED, _WIPE, _BRIDGE_FAN_START, _BRIDGE_FAN_END
     // Those comments are received and consumed (removed from the G-code) by the CoolingBuffer.pm Perl module.
@@ -347,7 +502,21 @@ private:
     // Current layer processed. Insequential printing mode, only a single copy will be printed.
     // In non-sequential mode, all its copies will be printed.
     const Layer*                        m_layer;
+    // Region, whose configuration was applied last to m_config by extrude_perimeters() / extrude_infill().
+    const PrintRegion*                  m_last_region;
     std::map<const PrintObject*,Point>  m_seam_position;
+    // Distance fields over the slices of the layers below the printed object layers, keyed by the lower layer.
+    // Used by the seam placement in extrude_loop(), built for all layers in parallel before the layers are exported.
+    std::map<const Layer*, std::unique_ptr<EdgeGrid::Grid>> m_lower_layer_edge_grids;
+    // Search structures over the internal region slices of the object layers, keyed by the layer.
+    // Used by needs_retraction() for only_retract_when_crossing_perimeters, built for all layers in parallel before the layers are exported.
+    std::map<const Layer*, std::unique_ptr<InternalSlicesIndex>> m_internal_slices_indices;
+    // Seam penalties of the perimeter loops of the object layers, keyed by the loops of LayerRegion::perimeters.
+    // Used by the seam placement in extrude_loop(), built for all layers in parallel before the layers are exported.
+    std::unordered_map<const ExtrusionLoop*, SeamPenalties> m_seam_penalties;
+    // Indices of the islands of Layer::lslices, into which the infill and perimeter collections of the object layers fall, keyed by the layer.
+    // Used by process_layer() to group the extrusions by the islands, built for all layers in parallel before the layers are exported.
+    std::unordered_map<const Layer*, std::vector<uint32_t>> m_layer_extrusion_islands;
     double                              m_volumetric_speed;
     // Support for the extrusion role markers. Which marker is active?
     ExtrusionRole                       m_last_extrusion_role;
@@ -361,6 +530,8 @@ private:
 
     std::unique_ptr<CoolingBuffer>      m_cooling_buffer;
     std::unique_ptr<SpiralVase>         m_spiral_vase;
+    // Spiral vase state of the last layer generated by process_layer(). SpiralVase::enable is owned by the export pipeline stage.
+    bool                                m_spiral_vase_enabled;
 #ifdef HAS_PRESSURE_EQUALIZER
     std::unique_ptr<PressureEqualizer>  m_pressure_equalizer;
 #endif /* HAS_PRESSURE_EQUALIZER */
@@ -379,26 +550,41 @@ private:
     GCodeTimeEstimator m_normal_time_estimator;
     GCodeTimeEstimator m_silent_time_estimator;
     bool m_silent_time_estimator_enabled;
+    // Feeds both time estimators from their own threads while exporting the gcode.
+    std::unique_ptr<GCodeTimeEstimatorThreads> m_time_estimator_threads;
+    // Lines reserved in the exported gcode for the lines M73, they are overwritten by GCodeTimeEstimator::post_process().
+    GCodeTimeEstimator::ReservedM73Lines m_reserved_M73_lines;
+    bool m_remaining_times;
+    // Number of G1 lines passed to the time estimators.
+    unsigned int m_g1_lines_count;
+    // Number of extruding G1 lines written since the last reserved lines M73.
+    unsigned int m_g1_extrusions_since_reserved_M73;
 
     // Analyzer
     GCodeAnalyzer m_analyzer;
 
+    // Parses the exported gcode once for the analyzer and both time estimators.
+    GCodeReader m_gcode_reader;
+
     // Write a string into a file.
-    void _write(FILE* file, const std::string& what) { this->_write(file, what.c_str()); }
-    void _write(FILE* file, const char *what);
+    void _write(GCodeOutputStream &file, const std::string& what) { this->_write(file, what.c_str()); }
+    void _write(GCodeOutputStream &file, const char *what);
 
     // Write a string into a file. 
     // Add a newline, if the string does not end with a newline already.
     // Used to export a custom G-code section processed by the PlaceholderParser.
-    void _writeln(FILE* file, const std::string& what);
+    void _writeln(GCodeOutputStream &file, const std::string& what);
 
     // Formats and write into a file the given data. 
-    void _write_format(FILE* file, const char* format, ...);
+    void _write_format(GCodeOutputStream &file, const char* format, ...);
+
+    // Reserves the lines for the lines M73 of both time estimators, filled in once the print time is known.
+    void _reserve_M73_lines(GCodeOutputStream &file, unsigned int g1_line_id);
 
     std::string _extrude(const ExtrusionPath &path, std::string description = "", double speed = -1);
-    void print_machine_envelope(FILE *file, Print &print);
-    void _print_first_layer_bed_temperature(FILE *file, Print &print, const std::string &gcode, unsigned int first_printing_extruder_id, bool wait);
-    void _print_first_layer_extruder_temperatures(FILE *file, Print &print, const std::string &gcode, unsigned int first_printing_extruder_id, bool wait);
+    void print_machine_envelope(GCodeOutputStream &file, Print &print);
+    void _print_first_layer_bed_temperature(GCodeOutputStream &file, Print &print, const std::string &gcode, unsigned int first_printing_extruder_id, bool wait);
+    void _print_first_layer_extruder_temperatures(GCodeOutputStream &file, Print &print, const std::string &gcode, unsigned int first_printing_extruder_id, bool wait);
     // this flag triggers first layer speeds
     bool                                on_first_layer() const { return m_layer != nullptr && m_layer->id() == 0; }
 
@@ -416,6 +602,34 @@ private:
 
     friend class Wipe;
     friend class WipeTowerIntegration;
+    friend class GCodeLayerCache;
+};
+
+// G-code of the layers generated by the last G-code export of a Print together with the state of the G-code generator
+// after each layer, kept by the Print between the exports. The next export reuses a layer if its inputs did not change
+// and if the generator enters the layer in the same state, thus after inserting a color change or a pause into a single
+// layer, or after editing the end G-code, only the changed layers are generated again.
+// Only used for the non-sequential prints without the wipe tower, spiral vase and avoid crossing perimeters,
+// which carry more state between the layers. The Print clears the cache if any of the steps before the G-code export is restarted.
+class GCodeLayerCache
+{
+public:
+    void clear() { m_key = 0; m_layers.clear(); }
+
+private:
+    struct Layer {
+        // Hash of the inputs of the layer, see process_layers().
+        size_t             key;
+        // G-code of the layer after the cooling.
+        std::string        gcode;
+        GCode::LayerState  state_after;
+    };
+    // Hash of the inputs common to all layers, see GCode::layer_cache_key().
+    size_t                 m_key { 0 };
+    GCode::LayerState      m_state_before;
+    std::vector<Layer>     m_layers;
+
+    friend class GCode;
 };
 
 }
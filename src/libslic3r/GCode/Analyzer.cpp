@@ -7,9 +7,20 @@
 #include "../Utils.hpp"
 #include "Print.hpp"
 
+#include <boost/functional/hash.hpp>
 #include <boost/log/trivial.hpp>
+#include <boost/nowide/cstdio.hpp>
+#include <boost/nowide/fstream.hpp>
+
+#include <tbb/parallel_for.h>
+#include <tbb/task_group.h>
+#include <tbb/task_scheduler_init.h>
+
+#include <map>
 
 #include "Analyzer.hpp"
+#include "ArcFitter.hpp"
+#include "BinaryGCode.hpp"
 #include "PreviewData.hpp"
 
 static const std::string AXIS_STR = "XYZE";
@@ -21,6 +32,15 @@ static const unsigned int DEFAULT_COLOR_PRINT_ID = 0;
 static const Slic3r::Vec3d DEFAULT_START_POSITION = Slic3r::Vec3d(0.0f, 0.0f, 0.0f);
 static const float DEFAULT_START_EXTRUSION = 0.0f;
 static const float DEFAULT_FAN_SPEED = 0.0f;
+// Maximum length and deviation of the line segments, into which the G2 / G3 arcs are split for the preview.
+static const double ARC_SEGMENT_LENGTH = 1.0;
+static const double ARC_SEGMENT_DEVIATION = 0.005;
+// Minimum size of the chunks of the gcode analyzed in parallel by GCodeAnalyzer::process_gcode_parallel().
+static const size_t PARALLEL_MIN_CHUNK_SIZE = 1024 * 1024;
+// Maximum size of the gcode preceding a chunk, which is analyzed to guess the state at the start of the chunk.
+static const size_t PARALLEL_MAX_WARM_UP_SIZE = 256 * 1024;
+// Minimum number of the extrusion moves processed by a single task of GCodeAnalyzer::_calc_gcode_preview_extrusion_layers().
+static const size_t PARALLEL_MIN_EXTRUSION_MOVES = 64 * 1024;
 
 namespace Slic3r {
 
@@ -90,18 +110,45 @@ bool GCodeAnalyzer::Metadata::operator != (const GCodeAnalyzer::Metadata& other)
     return false;
 }
 
-GCodeAnalyzer::GCodeMove::GCodeMove(GCodeMove::EType type, ExtrusionRole extrusion_role, unsigned int extruder_id, double mm3_per_mm, float width, float height, float feedrate, const Vec3d& start_position, const Vec3d& end_position, float delta_extruder, float fan_speed, unsigned int cp_color_id/* = 0*/)
-    : type(type)
-    , data(extrusion_role, extruder_id, mm3_per_mm, width, height, feedrate, fan_speed, cp_color_id)
-    , start_position(start_position)
-    , end_position(end_position)
-    , delta_extruder(delta_extruder)
+size_t GCodeAnalyzer::Metadata::Hash::operator()(const GCodeAnalyzer::Metadata& data) const
 {
+    size_t seed = 0;
+    boost::hash_combine(seed, (int)data.extrusion_role);
+    boost::hash_combine(seed, data.extruder_id);
+    boost::hash_combine(seed, data.mm3_per_mm);
+    boost::hash_combine(seed, data.width);
+    boost::hash_combine(seed, data.height);
+    boost::hash_combine(seed, data.feedrate);
+    boost::hash_combine(seed, data.fan_speed);
+    boost::hash_combine(seed, data.cp_color_id);
+    return seed;
 }
 
-GCodeAnalyzer::GCodeMove::GCodeMove(GCodeMove::EType type, const GCodeAnalyzer::Metadata& data, const Vec3d& start_position, const Vec3d& end_position, float delta_extruder)
+bool GCodeAnalyzer::State::operator == (const GCodeAnalyzer::State& other) const
+{
+    if (units != other.units || global_positioning_type != other.global_positioning_type || e_local_positioning_type != other.e_local_positioning_type)
+        return false;
+
+    if (data != other.data)
+        return false;
+
+    if (start_position != other.start_position || start_extrusion != other.start_extrusion || cp_color_counter != other.cp_color_counter)
+        return false;
+
+    for (unsigned char a = X; a < Num_Axis; ++ a)
+        if (position[a] != other.position[a] || origin[a] != other.origin[a])
+            return false;
+
+    for (unsigned char a = 0; a < 5; ++ a)
+        if (cached_position[a] != other.cached_position[a])
+            return false;
+
+    return true;
+}
+
+GCodeAnalyzer::GCodeMove::GCodeMove(GCodeMove::EType type, unsigned int data_id, const Vec3f& start_position, const Vec3f& end_position, float delta_extruder)
     : type(type)
-    , data(data)
+    , data_id(data_id)
     , start_position(start_position)
     , end_position(end_position)
     , delta_extruder(delta_extruder)
@@ -116,6 +163,19 @@ void GCodeAnalyzer::set_extruders_count(unsigned int count)
 }
 
 void GCodeAnalyzer::reset()
+{
+    _reset_state();
+
+    m_moves_map.clear();
+    m_metadata.clear();
+    m_metadata_ids.clear();
+    m_last_metadata_id = (unsigned int)-1;
+    m_extruder_offsets.clear();
+    m_extruders_count = 1;
+    m_extruder_color.clear();
+}
+
+void GCodeAnalyzer::_reset_state()
 {
     _set_units(Millimeters);
     _set_global_positioning_type(Absolute);
@@ -133,11 +193,6 @@ void GCodeAnalyzer::reset()
     _reset_axes_position();
     _reset_axes_origin();
     _reset_cached_position();
-
-    m_moves_map.clear();
-    m_extruder_offsets.clear();
-    m_extruders_count = 1;
-    m_extruder_color.clear();
 }
 
 const std::string& GCodeAnalyzer::process_gcode(const std::string& gcode)
@@ -151,22 +206,345 @@ const std::string& GCodeAnalyzer::process_gcode(const std::string& gcode)
     return m_process_output;
 }
 
+void GCodeAnalyzer::process_file(const std::string& path, std::function<void()> cancel_callback)
+{
+    std::string gcode;
+    if (BinaryGCode::is_binary_gcode(path))
+    {
+        FILE* file = boost::nowide::fopen(path.c_str(), "rb");
+        if (file == nullptr)
+            throw std::runtime_error(std::string("GCodeAnalyzer: Cannot open the file ") + path);
+        try
+        {
+            BinaryGCode::Decoder decoder(file);
+            BinaryGCode::BlockType type;
+            std::string data;
+            // The G-code blocks contain complete lines.
+            while (decoder.read_block(type, data))
+                if (type == BinaryGCode::BlockType::GCode)
+                    gcode += data;
+        }
+        catch (...)
+        {
+            fclose(file);
+            throw;
+        }
+        fclose(file);
+    }
+    else
+    {
+        boost::nowide::ifstream file(path, std::ios::in | std::ios::binary);
+        if (!file.good())
+            throw std::runtime_error(std::string("GCodeAnalyzer: Cannot open the file ") + path);
+        file.seekg(0, std::ios::end);
+        gcode.resize(size_t(file.tellg()));
+        file.seekg(0, std::ios::beg);
+        file.read(&gcode[0], gcode.size());
+        if (!file.good())
+            throw std::runtime_error(std::string("GCodeAnalyzer: Failed reading the file ") + path);
+    }
+
+    process_gcode_parallel(gcode, cancel_callback);
+}
+
+namespace {
+    const char* skip_whitespaces(const char* ptr)
+    {
+        while (*ptr == ' ' || *ptr == '\t')
+            ++ ptr;
+        return ptr;
+    }
+
+    // Start of the line following the line containing ptr, or end.
+    const char* next_line(const char* ptr, const char* end)
+    {
+        const char* eol = (const char*)memchr(ptr, '\n', end - ptr);
+        return (eol == nullptr) ? end : eol + 1;
+    }
+
+    // Start of the line preceding the line starting at ptr, not before begin, which is a start of a line.
+    const char* previous_line(const char* begin, const char* ptr)
+    {
+        if (ptr > begin)
+            for (-- ptr; ptr > begin && ptr[-1] != '\n'; -- ptr)
+                ;
+        return ptr;
+    }
+
+    // Does the command of the line starting at ptr match cmd?
+    bool is_command(const char* ptr, const char* cmd)
+    {
+        size_t len = strlen(cmd);
+        if (strncmp(ptr, cmd, len) != 0)
+            return false;
+        char c = ptr[len];
+        return c == ' ' || c == '\t' || c == ';' || c == '\r' || c == '\n' || c == 0;
+    }
+
+    // Is the line starting at ptr a layer change? Layer changes are marked in the G-code of PrusaSlicer and Cura by comments,
+    // Slic3r and most other generators move the Z axis by a G1 (or G0) move of its own.
+    bool is_layer_change(const char* ptr)
+    {
+        ptr = skip_whitespaces(ptr);
+        if (*ptr == ';')
+            return strncmp(ptr, ";LAYER_CHANGE", 13) == 0 || strncmp(ptr, ";LAYER:", 7) == 0;
+        return (ptr[0] == 'G') && (ptr[1] == '0' || ptr[1] == '1') && (ptr[2] == ' ') && (*skip_whitespaces(ptr + 2) == 'Z');
+    }
+
+    // Lines setting a part of the state regardless of the preceding state, as the positioning types, the tool, the fan speed and the tags
+    // of the extrusion parameters. They are typically emitted by the start gcode or when the values change, the last ones preceding a chunk
+    // are analyzed before its warm up gcode.
+    enum class ModalLine { Positioning, ExtruderPositioning, Tool, FanSpeed, ExtrusionRole, Mm3PerMm, Width, Height, Count, None = Count };
+    ModalLine modal_line_type(const char* ptr)
+    {
+        ptr = skip_whitespaces(ptr);
+        switch (*ptr)
+        {
+        case 'G':
+            if (is_command(ptr, "G90") || is_command(ptr, "G91"))
+                return ModalLine::Positioning;
+            break;
+        case 'M':
+            if (is_command(ptr, "M82") || is_command(ptr, "M83"))
+                return ModalLine::ExtruderPositioning;
+            if (is_command(ptr, "M106") || is_command(ptr, "M107"))
+                return ModalLine::FanSpeed;
+            break;
+        case 'T':
+            if (ptr[1] >= '0' && ptr[1] <= '9')
+                return ModalLine::Tool;
+            break;
+        case ';':
+            {
+                const std::string* tags[] = { &GCodeAnalyzer::Extrusion_Role_Tag, &GCodeAnalyzer::Mm3_Per_Mm_Tag, &GCodeAnalyzer::Width_Tag, &GCodeAnalyzer::Height_Tag };
+                for (size_t i = 0; i < 4; ++ i)
+                    if (strncmp(ptr + 1, tags[i]->c_str(), tags[i]->size()) == 0)
+                        return ModalLine(int(ModalLine::ExtrusionRole) + int(i));
+                break;
+            }
+        }
+        return ModalLine::None;
+    }
+}
+
+void GCodeAnalyzer::process_gcode_parallel(const std::string& gcode, std::function<void()> cancel_callback)
+{
+    if (!cancel_callback)
+        cancel_callback = []() {};
+
+    const char* const gcode_begin = gcode.c_str();
+    const char* const gcode_end = gcode_begin + gcode.size();
+
+    struct Chunk
+    {
+        // Lines of the chunk.
+        const char* begin;
+        const char* end;
+        // Start of the lines preceding the chunk, analyzed to guess the state at the start of the chunk.
+        const char* warm_up;
+        // The last modal lines preceding warm_up, in the order of the gcode.
+        std::vector<const char*> modal_lines;
+        // State guessed for the start of the chunk and the state at the end of the chunk.
+        State start_state;
+        ExtruderToColorMap start_extruder_color;
+        GCodeAnalyzer* analyzer;
+    };
+
+    // Split the gcode at the layer changes following the nominal chunk boundaries.
+    size_t num_threads = (size_t)std::max(1, tbb::task_scheduler_init::default_num_threads());
+    size_t chunk_size = std::max(PARALLEL_MIN_CHUNK_SIZE, gcode.size() / (4 * num_threads) + 1);
+    std::vector<Chunk> chunks;
+    for (const char* begin = gcode_begin; begin < gcode_end;)
+    {
+        const char* end = gcode_end;
+        if (size_t(gcode_end - begin) > 2 * chunk_size)
+        {
+            end = next_line(begin + chunk_size, gcode_end);
+            while (end < gcode_end && !is_layer_change(end))
+                end = next_line(end, gcode_end);
+        }
+        Chunk chunk;
+        chunk.begin = begin;
+        chunk.end = end;
+        chunk.warm_up = begin;
+        chunk.analyzer = nullptr;
+        chunks.emplace_back(std::move(chunk));
+        begin = end;
+    }
+
+    if (chunks.size() == 1)
+    {
+        _process_gcode_lines(gcode_begin, gcode_end, cancel_callback);
+        return;
+    }
+
+    // The warm up of each chunk starts at the last layer change preceding the chunk, unless it is too far away.
+    for (size_t i = 1; i < chunks.size(); ++ i)
+    {
+        Chunk& chunk = chunks[i];
+        const char* ptr = chunk.begin;
+        while (ptr > chunks[i - 1].begin && size_t(chunk.begin - ptr) < PARALLEL_MAX_WARM_UP_SIZE)
+        {
+            ptr = previous_line(chunks[i - 1].begin, ptr);
+            if (is_layer_change(ptr))
+                break;
+        }
+        chunk.warm_up = ptr;
+    }
+
+    // Collect the modal lines preceding the warm up of each chunk in a single pass over the gcode.
+    {
+        const char* modal_lines[int(ModalLine::Count)] = { nullptr };
+        const char* ptr = gcode_begin;
+        for (size_t i = 1; i < chunks.size(); ++ i)
+        {
+            for (; ptr < chunks[i].warm_up; ptr = next_line(ptr, gcode_end))
+            {
+                ModalLine type = modal_line_type(ptr);
+                if (type != ModalLine::None)
+                    modal_lines[int(type)] = ptr;
+            }
+            for (const char* line : modal_lines)
+                if (line != nullptr)
+                    chunks[i].modal_lines.emplace_back(line);
+            std::sort(chunks[i].modal_lines.begin(), chunks[i].modal_lines.end());
+        }
+    }
+
+    // Analyze the chunks in parallel by copies of this analyzer, the first chunk starts from the current state.
+    TypeToMovesMap moves_map = std::move(m_moves_map);
+    m_moves_map.clear();
+    std::vector<GCodeAnalyzer> analyzers(chunks.size(), *this);
+    m_moves_map = std::move(moves_map);
+    for (size_t i = 0; i < chunks.size(); ++ i)
+        chunks[i].analyzer = &analyzers[i];
+    chunks.front().start_state = m_state;
+    chunks.front().start_extruder_color = m_extruder_color;
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, chunks.size(), 1),
+        [&chunks, &cancel_callback](const tbb::blocked_range<size_t>& range) {
+        for (size_t i = range.begin(); i < range.end(); ++ i)
+        {
+            Chunk& chunk = chunks[i];
+            GCodeAnalyzer& analyzer = *chunk.analyzer;
+            if (i > 0)
+            {
+                analyzer._reset_state();
+                for (const char* line : chunk.modal_lines)
+                    analyzer._process_gcode_lines(line, next_line(line, chunk.begin), cancel_callback);
+                analyzer._process_gcode_lines(chunk.warm_up, chunk.begin, cancel_callback);
+                analyzer.m_moves_map.clear();
+                chunk.start_state = analyzer.m_state;
+                chunk.start_extruder_color = analyzer.m_extruder_color;
+            }
+            analyzer._process_gcode_lines(chunk.begin, chunk.end, cancel_callback);
+        }
+    });
+
+    // Was the chunk analyzed from the actual state at its start?
+    auto is_valid_start = [](const State& guess, const State& actual) {
+        if (guess == actual)
+            return true;
+        // With the relative extrusion, the accumulated extruder position preceding the chunk is not known from its warm up.
+        // Only the differences of the extruder positions are stored with the moves, they are exact up to the rounding of the accumulated position.
+        if (actual.global_positioning_type == Relative || actual.e_local_positioning_type == Relative)
+        {
+            State adjusted = guess;
+            adjusted.position[E] = actual.position[E];
+            adjusted.start_extrusion = actual.start_extrusion;
+            return adjusted == actual;
+        }
+        return false;
+    };
+
+    // Reconcile the states at the boundaries of the chunks, analyze again the chunks started from a wrong state.
+    size_t num_reanalyzed = 0;
+    for (size_t i = 1; i < chunks.size(); ++ i)
+    {
+        const GCodeAnalyzer& previous = *chunks[i - 1].analyzer;
+        Chunk& chunk = chunks[i];
+        if (!is_valid_start(chunk.start_state, previous.m_state) || chunk.start_extruder_color != previous.m_extruder_color)
+        {
+            GCodeAnalyzer& analyzer = *chunk.analyzer;
+            analyzer.m_state = previous.m_state;
+            analyzer.m_extruder_color = previous.m_extruder_color;
+            analyzer.m_moves_map.clear();
+            analyzer._process_gcode_lines(chunk.begin, chunk.end, cancel_callback);
+            ++ num_reanalyzed;
+        }
+    }
+    BOOST_LOG_TRIVIAL(debug) << "GCodeAnalyzer analyzed " << chunks.size() << " chunks in parallel, " << num_reanalyzed << " of them were analyzed again";
+
+    // Merge the metadata palettes of the chunks into the palette of this analyzer, the moves of the chunks index their own palettes.
+    std::vector<std::vector<unsigned int>> metadata_ids(analyzers.size());
+    for (size_t i = 0; i < analyzers.size(); ++ i)
+    {
+        metadata_ids[i].reserve(analyzers[i].m_metadata.size());
+        for (const Metadata& data : analyzers[i].m_metadata)
+            metadata_ids[i].emplace_back(_get_metadata_id(data));
+    }
+
+    // Concatenate the moves of the chunks.
+    for (unsigned char t = GCodeMove::Noop; t < GCodeMove::Num_Types; ++ t)
+    {
+        GCodeMove::EType type = GCodeMove::EType(t);
+        size_t num_moves = 0;
+        for (const GCodeAnalyzer& analyzer : analyzers)
+        {
+            auto it = analyzer.m_moves_map.find(type);
+            if (it != analyzer.m_moves_map.end())
+                num_moves += it->second.size();
+        }
+        if (num_moves == 0)
+            continue;
+        GCodeMovesList& moves = m_moves_map[type];
+        moves.reserve(moves.size() + num_moves);
+        for (size_t i = 0; i < analyzers.size(); ++ i)
+        {
+            auto it = analyzers[i].m_moves_map.find(type);
+            if (it != analyzers[i].m_moves_map.end())
+                for (const GCodeMove& move : it->second)
+                {
+                    moves.emplace_back(move);
+                    moves.back().data_id = metadata_ids[i][move.data_id];
+                }
+        }
+    }
+    m_state = analyzers.back().m_state;
+    m_extruder_color = analyzers.back().m_extruder_color;
+}
+
 void GCodeAnalyzer::calc_gcode_preview_data(GCodePreviewData& preview_data, std::function<void()> cancel_callback)
 {
     // resets preview data
     preview_data.reset();
 
-    // calculates extrusion layers
-    _calc_gcode_preview_extrusion_layers(preview_data, cancel_callback);
-
-    // calculates travel
-    _calc_gcode_preview_travel(preview_data, cancel_callback);
+    // calculates travel, retractions and unretractions concurrently with the extrusion layers,
+    // travel into a separate preview data, as both the travel and the extrusion layers update the ranges
+    GCodePreviewData travel_data;
+    tbb::task_group tasks;
+    tasks.run([this, &travel_data, &cancel_callback]() { _calc_gcode_preview_travel(travel_data, cancel_callback); });
+    tasks.run([this, &preview_data, &cancel_callback]() {
+        _calc_gcode_preview_retractions(preview_data, cancel_callback);
+        _calc_gcode_preview_unretractions(preview_data, cancel_callback);
+    });
 
-    // calculates retractions
-    _calc_gcode_preview_retractions(preview_data, cancel_callback);
+    // calculates extrusion layers
+    try
+    {
+        _calc_gcode_preview_extrusion_layers(preview_data, cancel_callback);
+    }
+    catch (...)
+    {
+        // the tasks shall not outlive the preview data
+        tasks.wait();
+        throw;
+    }
+    tasks.wait();
 
-    // calculates unretractions
-    _calc_gcode_preview_unretractions(preview_data, cancel_callback);
+    preview_data.travel.polylines = std::move(travel_data.travel.polylines);
+    preview_data.ranges.height.update_from(travel_data.ranges.height);
+    preview_data.ranges.width.update_from(travel_data.ranges.width);
+    preview_data.ranges.feedrate.update_from(travel_data.ranges.feedrate);
 }
 
 bool GCodeAnalyzer::is_valid_extrusion_role(ExtrusionRole role)
@@ -175,15 +553,42 @@ bool GCodeAnalyzer::is_valid_extrusion_role(ExtrusionRole role)
 }
 
 void GCodeAnalyzer::_process_gcode_line(GCodeReader&, const GCodeReader::GCodeLine& line)
+{
+    if (this->process_gcode_line(line))
+        // puts the line back into the gcode
+        m_process_output += line.raw() + "\n";
+}
+
+void GCodeAnalyzer::_process_gcode_lines(const char* begin, const char* end, std::function<void()>& cancel_callback)
+{
+    // to avoid to call the callback too often
+    static const unsigned int cancel_callback_threshold = 65536;
+    unsigned int cancel_callback_curr = 0;
+
+    GCodeReader::GCodeLine line;
+    auto callback = [this, &cancel_callback, &cancel_callback_curr](GCodeReader&, const GCodeReader::GCodeLine& line) {
+        cancel_callback_curr = (cancel_callback_curr + 1) % cancel_callback_threshold;
+        if (cancel_callback_curr == 0)
+            cancel_callback();
+        this->process_gcode_line(line);
+    };
+    for (const char* ptr = begin; ptr < end;)
+    {
+        line.reset();
+        ptr = m_parser.parse_line(ptr, line, callback);
+    }
+}
+
+bool GCodeAnalyzer::process_gcode_line(const GCodeReader::GCodeLine& line)
 {
     // processes 'special' comments contained in line
     if (_process_tags(line))
     {
 #if 0
         // DEBUG ONLY: puts the line back into the gcode
-        m_process_output += line.raw() + "\n";
+        return true;
 #endif
-        return;
+        return false;
     }
 
     // sets new start position/extrusion
@@ -205,6 +610,12 @@ void GCodeAnalyzer::_process_gcode_line(GCodeReader&, const GCodeReader::GCodeLi
                         _processG1(line);
                         break;
                     }
+                case 2: // Clockwise Arc
+                case 3: // Counter-clockwise Arc
+                    {
+                        _processG2_G3(line, ::atoi(&cmd[1]) == 3);
+                        break;
+                    }
                 case 10: // Retract
                     {
                         _processG10(line);
@@ -303,40 +714,90 @@ void GCodeAnalyzer::_process_gcode_line(GCodeReader&, const GCodeReader::GCodeLi
         }
     }
 
-    // puts the line back into the gcode
-    m_process_output += line.raw() + "\n";
+    return true;
 }
 
-void GCodeAnalyzer::_processG1(const GCodeReader::GCodeLine& line)
+float GCodeAnalyzer::_axis_absolute_position(EAxis axis, const GCodeReader::GCodeLine& line) const
 {
-    auto axis_absolute_position = [this](GCodeAnalyzer::EAxis axis, const GCodeReader::GCodeLine& lineG1) -> float
-    {
-        bool is_relative = (_get_global_positioning_type() == Relative);
-        if (axis == E)
-            is_relative |= (_get_e_local_positioning_type() == Relative);
+    bool is_relative = (_get_global_positioning_type() == Relative);
+    if (axis == E)
+        is_relative |= (_get_e_local_positioning_type() == Relative);
 
-        if (lineG1.has(Slic3r::Axis(axis)))
-        {
-            float lengthsScaleFactor = (_get_units() == GCodeAnalyzer::Inches) ? INCHES_TO_MM : 1.0f;
-            float ret = lineG1.value(Slic3r::Axis(axis)) * lengthsScaleFactor;
-            return is_relative ? _get_axis_position(axis) + ret : _get_axis_origin(axis) + ret;
-        }
-        else
-            return _get_axis_position(axis);
-    };
+    if (line.has(Slic3r::Axis(axis)))
+    {
+        float lengthsScaleFactor = (_get_units() == GCodeAnalyzer::Inches) ? INCHES_TO_MM : 1.0f;
+        float ret = line.value(Slic3r::Axis(axis)) * lengthsScaleFactor;
+        return is_relative ? _get_axis_position(axis) + ret : _get_axis_origin(axis) + ret;
+    }
+    else
+        return _get_axis_position(axis);
+}
 
+void GCodeAnalyzer::_processG1(const GCodeReader::GCodeLine& line)
+{
     // updates axes positions from line
 
     float new_pos[Num_Axis];
     for (unsigned char a = X; a < Num_Axis; ++a)
     {
-        new_pos[a] = axis_absolute_position((EAxis)a, line);
+        new_pos[a] = _axis_absolute_position((EAxis)a, line);
     }
 
     // updates feedrate from line, if present
     if (line.has_f())
         _set_feedrate(line.f() * MMMIN_TO_MMSEC);
 
+    _process_move(new_pos);
+}
+
+void GCodeAnalyzer::_processG2_G3(const GCodeReader::GCodeLine& line, bool ccw)
+{
+    // updates axes positions from line
+    float start_pos[Num_Axis];
+    float end_pos[Num_Axis];
+    for (unsigned char a = X; a < Num_Axis; ++a)
+    {
+        start_pos[a] = _get_axis_position((EAxis)a);
+        end_pos[a] = _axis_absolute_position((EAxis)a, line);
+    }
+
+    // updates feedrate from line, if present
+    if (line.has_f())
+        _set_feedrate(line.f() * MMMIN_TO_MMSEC);
+
+    // the center of the arc is relative to the start position in both the absolute and the relative positioning
+    float lengthsScaleFactor = (_get_units() == GCodeAnalyzer::Inches) ? INCHES_TO_MM : 1.0f;
+    float i = 0.0f;
+    float j = 0.0f;
+    line.has_value('I', i);
+    line.has_value('J', j);
+    Vec2d start(start_pos[X], start_pos[Y]);
+    Vec2d center = start + Vec2d(i, j) * lengthsScaleFactor;
+
+    // stores the arc as a sequence of line segments, Z and E are interpolated linearly along the arc
+    std::vector<Vec2d> points = ArcFitter::discretize(start, Vec2d(end_pos[X], end_pos[Y]), center, ccw, ARC_SEGMENT_LENGTH, ARC_SEGMENT_DEVIATION);
+    for (size_t k = 0; k < points.size(); ++k)
+    {
+        if (k > 0)
+        {
+            // sets new start position/extrusion of the next line segment
+            _set_start_position(_get_end_position());
+            _set_start_extrusion(_get_axis_position(E));
+        }
+        float t = float(k + 1) / float(points.size());
+        float new_pos[Num_Axis];
+        for (unsigned char a = X; a < Num_Axis; ++a)
+        {
+            new_pos[a] = start_pos[a] + t * (end_pos[a] - start_pos[a]);
+        }
+        new_pos[X] = (k + 1 == points.size()) ? end_pos[X] : float(points[k](0));
+        new_pos[Y] = (k + 1 == points.size()) ? end_pos[Y] : float(points[k](1));
+        _process_move(new_pos);
+    }
+}
+
+void GCodeAnalyzer::_process_move(const float new_pos[Num_Axis])
+{
     // calculates movement deltas
     float delta_pos[Num_Axis];
     for (unsigned char a = X; a < Num_Axis; ++a)
@@ -917,9 +1378,24 @@ void GCodeAnalyzer::_store_move(GCodeAnalyzer::GCodeMove::EType type)
     if (extr_it != m_extruder_offsets.end())
         extruder_offset = Vec3d(extr_it->second(0), extr_it->second(1), 0.0);
 
-    Vec3d start_position = _get_start_position() + extruder_offset;
-    Vec3d end_position = _get_end_position() + extruder_offset;
-    it->second.emplace_back(type, _get_extrusion_role(), extruder_id, _get_mm3_per_mm(), _get_width(), _get_height(), _get_feedrate(), start_position, end_position, _get_delta_extrusion(), _get_fan_speed(), _get_cp_color_id());
+    Vec3f start_position = (_get_start_position() + extruder_offset).cast<float>();
+    Vec3f end_position = (_get_end_position() + extruder_offset).cast<float>();
+    Metadata data(_get_extrusion_role(), extruder_id, _get_mm3_per_mm(), _get_width(), _get_height(), _get_feedrate(), _get_fan_speed(), _get_cp_color_id());
+    if (m_last_metadata_id == (unsigned int)-1 || m_metadata[m_last_metadata_id] != data)
+        m_last_metadata_id = _get_metadata_id(data);
+    it->second.emplace_back(type, m_last_metadata_id, start_position, end_position, _get_delta_extrusion());
+}
+
+unsigned int GCodeAnalyzer::_get_metadata_id(const Metadata& data)
+{
+    auto it = m_metadata_ids.find(data);
+    if (it != m_metadata_ids.end())
+        return it->second;
+
+    unsigned int id = (unsigned int)m_metadata.size();
+    m_metadata.emplace_back(data);
+    m_metadata_ids.emplace(data, id);
+    return id;
 }
 
 bool GCodeAnalyzer::_is_valid_extrusion_role(int value) const
@@ -929,29 +1405,30 @@ bool GCodeAnalyzer::_is_valid_extrusion_role(int value) const
 
 void GCodeAnalyzer::_calc_gcode_preview_extrusion_layers(GCodePreviewData& preview_data, std::function<void()> cancel_callback)
 {
+    // layers_map maps z of the layers to their index in the layers list.
+    typedef std::map<float, size_t> LayersMap;
+
     struct Helper
     {
-        static GCodePreviewData::Extrusion::Layer& get_layer_at_z(GCodePreviewData::Extrusion::LayersList& layers, float z)
+        static GCodePreviewData::Extrusion::Layer& get_layer_at_z(GCodePreviewData::Extrusion::LayersList& layers, LayersMap& layers_map, float z)
         {
-            //FIXME this has a terrible time complexity
-            for (GCodePreviewData::Extrusion::Layer& layer : layers)
-            {
-                // if layer found, return it
-                if (layer.z == z)
-                    return layer;
-            }
+            // if layer found, return it
+            auto it = layers_map.find(z);
+            if (it != layers_map.end())
+                return layers[it->second];
 
             // if layer not found, create and return it
+            layers_map.emplace(z, layers.size());
             layers.emplace_back(z, GCodePreviewData::Extrusion::Paths());
             return layers.back();
         }
 
-        static void store_polyline(const Polyline& polyline, const Metadata& data, float z, GCodePreviewData& preview_data)
+        static void store_polyline(const Polyline& polyline, const Metadata& data, float z, LayersMap& layers_map, GCodePreviewData::Extrusion::LayersList& layers)
         {
             // if the polyline is valid, create the extrusion path from it and store it
             if (polyline.is_valid())
             {
-				auto& paths = get_layer_at_z(preview_data.extrusion.layers, z).paths;
+				auto& paths = get_layer_at_z(layers, layers_map, z).paths;
 				paths.emplace_back(GCodePreviewData::Extrusion::Path());
 				GCodePreviewData::Extrusion::Path &path = paths.back();
                 path.polyline = polyline;
@@ -967,77 +1444,149 @@ void GCodeAnalyzer::_calc_gcode_preview_extrusion_layers(GCodePreviewData& previ
         }
     };
 
+    // The layers and the ranges collected from a range of the moves.
+    struct Part
+    {
+        size_t begin;
+        size_t end;
+        GCodePreviewData::Extrusion::LayersList layers;
+        LayersMap layers_map;
+        GCodePreviewData::Range height_range;
+        GCodePreviewData::Range width_range;
+        GCodePreviewData::MultiRange<GCodePreviewData::FeedrateKind> feedrate_range;
+        GCodePreviewData::Range volumetric_rate_range;
+        GCodePreviewData::Range fan_speed_range;
+    };
+
     TypeToMovesMap::iterator extrude_moves = m_moves_map.find(GCodeMove::Extrude);
     if (extrude_moves == m_moves_map.end())
         return;
 
-    Metadata data;
-    float z = FLT_MAX;
-    Polyline polyline;
-    Vec3d position(FLT_MAX, FLT_MAX, FLT_MAX);
-    float volumetric_rate = FLT_MAX;
-    GCodePreviewData::Range height_range;
-    GCodePreviewData::Range width_range;
-    GCodePreviewData::MultiRange<GCodePreviewData::FeedrateKind> feedrate_range;
-    GCodePreviewData::Range volumetric_rate_range;
-    GCodePreviewData::Range fan_speed_range;
+    const GCodeMovesList& moves = extrude_moves->second;
 
-    // to avoid to call the callback too often
-    unsigned int cancel_callback_threshold = (unsigned int)std::max((int)extrude_moves->second.size() / 25, 1);
-    unsigned int cancel_callback_curr = 0;
+    const MetadataList& metadata = m_metadata;
 
-    // constructs the polylines while traversing the moves
-    for (const GCodeMove& move : extrude_moves->second)
+    // Does the move start a new polyline? It depends on the previous move only, as all the moves of a polyline share the same data and z.
+    // The palette of the metadata holds distinct metadata, thus the moves share the same metadata if and only if they share the same index.
+    auto starts_polyline = [&moves](size_t i) -> bool {
+        if (i == 0)
+            return true;
+        const GCodeMove& prev = moves[i - 1];
+        const GCodeMove& move = moves[i];
+        return (prev.data_id != move.data_id) || (prev.start_position.z() != move.start_position.z()) || (prev.end_position != move.start_position);
+    };
+
+    // Split the moves at the starts of polylines into parts processed in parallel, the polylines are the same as if the moves were processed at once.
+    size_t num_threads = (size_t)std::max(1, tbb::task_scheduler_init::default_num_threads());
+    size_t num_parts = std::max<size_t>(1, std::min(moves.size() / PARALLEL_MIN_EXTRUSION_MOVES, 4 * num_threads));
+    std::vector<Part> parts;
+    for (size_t i = 0; i < num_parts; ++ i)
     {
-        // to avoid to call the callback too often
-        cancel_callback_curr = (cancel_callback_curr + 1) % cancel_callback_threshold;
-        if (cancel_callback_curr == 0)
-            cancel_callback();
+        size_t begin = (i == 0) ? 0 : parts.back().end;
+        size_t end = (i + 1 == num_parts) ? moves.size() : std::max(begin, moves.size() * (i + 1) / num_parts);
+        while (end < moves.size() && !starts_polyline(end))
+            ++ end;
+        if (end == begin)
+            continue;
+        parts.emplace_back();
+        parts.back().begin = begin;
+        parts.back().end = end;
+    }
 
-        if ((data != move.data) || (z != move.start_position.z()) || (position != move.start_position) || (volumetric_rate != move.data.feedrate * (float)move.data.mm3_per_mm))
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, parts.size(), 1),
+        [&parts, &moves, &metadata, &cancel_callback](const tbb::blocked_range<size_t>& range) {
+        for (size_t part_id = range.begin(); part_id < range.end(); ++ part_id)
         {
-            // store current polyline
-            polyline.remove_duplicate_points();
-            Helper::store_polyline(polyline, data, z, preview_data);
+            Part& part = parts[part_id];
 
-            // reset current polyline
-            polyline = Polyline();
+            Metadata data;
+            unsigned int data_id = (unsigned int)-1;
+            float z = FLT_MAX;
+            Polyline polyline;
+            Vec3f position(FLT_MAX, FLT_MAX, FLT_MAX);
 
-            // add both vertices of the move
-            polyline.append(Point(scale_(move.start_position.x()), scale_(move.start_position.y())));
-            polyline.append(Point(scale_(move.end_position.x()), scale_(move.end_position.y())));
-
-            // update current values
-            data = move.data;
-            z = (float)move.start_position.z();
-            volumetric_rate = move.data.feedrate * (float)move.data.mm3_per_mm;
-            height_range.update_from(move.data.height);
-            width_range.update_from(move.data.width);
-            feedrate_range.update_from(move.data.feedrate, GCodePreviewData::FeedrateKind::EXTRUSION);
-            volumetric_rate_range.update_from(volumetric_rate);
-            fan_speed_range.update_from(move.data.fan_speed);
+            // to avoid to call the callback too often
+            unsigned int cancel_callback_threshold = (unsigned int)std::max((int)(part.end - part.begin) / 25, 1);
+            unsigned int cancel_callback_curr = 0;
+
+            // constructs the polylines while traversing the moves
+            for (size_t i = part.begin; i < part.end; ++ i)
+            {
+                const GCodeMove& move = moves[i];
+
+                // to avoid to call the callback too often
+                cancel_callback_curr = (cancel_callback_curr + 1) % cancel_callback_threshold;
+                if (cancel_callback_curr == 0)
+                    cancel_callback();
+
+                if ((data_id != move.data_id) || (z != move.start_position.z()) || (position != move.start_position))
+                {
+                    // store current polyline
+                    polyline.remove_duplicate_points();
+                    Helper::store_polyline(polyline, data, z, part.layers_map, part.layers);
+
+                    // reset current polyline
+                    polyline = Polyline();
+
+                    // add both vertices of the move
+                    polyline.append(Point(scale_(move.start_position.x()), scale_(move.start_position.y())));
+                    polyline.append(Point(scale_(move.end_position.x()), scale_(move.end_position.y())));
+
+                    // update current values
+                    data_id = move.data_id;
+                    data = metadata[data_id];
+                    z = move.start_position.z();
+                    part.height_range.update_from(data.height);
+                    part.width_range.update_from(data.width);
+                    part.feedrate_range.update_from(data.feedrate, GCodePreviewData::FeedrateKind::EXTRUSION);
+                    part.volumetric_rate_range.update_from(data.feedrate * (float)data.mm3_per_mm);
+                    part.fan_speed_range.update_from(data.fan_speed);
+                }
+                else
+                    // append end vertex of the move to current polyline
+                    polyline.append(Point(scale_(move.end_position.x()), scale_(move.end_position.y())));
+
+                // update current values
+                position = move.end_position;
+            }
+
+            // store last polyline
+            polyline.remove_duplicate_points();
+            Helper::store_polyline(polyline, data, z, part.layers_map, part.layers);
         }
-        else
-            // append end vertex of the move to current polyline
-            polyline.append(Point(scale_(move.end_position.x()), scale_(move.end_position.y())));
+    });
 
-        // update current values
-        position = move.end_position;
-    }
+    // Index of the layers by their z, the moves of sequential prints revisit the layers.
+    LayersMap layers_map;
+    for (size_t i = 0; i < preview_data.extrusion.layers.size(); ++ i)
+        layers_map.emplace(preview_data.extrusion.layers[i].z, i);
 
-    // store last polyline
-    polyline.remove_duplicate_points();
-    Helper::store_polyline(polyline, data, z, preview_data);
+    // merges the layers of the parts in the order of the moves
+    for (Part& part : parts)
+    {
+        for (GCodePreviewData::Extrusion::Layer& part_layer : part.layers)
+        {
+            GCodePreviewData::Extrusion::Paths& paths = Helper::get_layer_at_z(preview_data.extrusion.layers, layers_map, part_layer.z).paths;
+            if (paths.empty())
+                paths = std::move(part_layer.paths);
+            else
+                paths.insert(paths.end(), std::make_move_iterator(part_layer.paths.begin()), std::make_move_iterator(part_layer.paths.end()));
+        }
 
-    // updates preview ranges data
-    preview_data.ranges.height.update_from(height_range);
-    preview_data.ranges.width.update_from(width_range);
-    preview_data.ranges.feedrate.update_from(feedrate_range);
-    preview_data.ranges.volumetric_rate.update_from(volumetric_rate_range);
-    preview_data.ranges.fan_speed.update_from(fan_speed_range);
+        // updates preview ranges data
+        preview_data.ranges.height.update_from(part.height_range);
+        preview_data.ranges.width.update_from(part.width_range);
+        preview_data.ranges.feedrate.update_from(part.feedrate_range);
+        preview_data.ranges.volumetric_rate.update_from(part.volumetric_rate_range);
+        preview_data.ranges.fan_speed.update_from(part.fan_speed_range);
+    }
 
     // we need to sort the layers by their z as they can be shuffled in case of sequential prints
     std::sort(preview_data.extrusion.layers.begin(), preview_data.extrusion.layers.end(), [](const GCodePreviewData::Extrusion::Layer& l1, const GCodePreviewData::Extrusion::Layer& l2)->bool { return l1.z < l2.z; });
+
+    // release the memory reserved in excess while the paths were collected
+    for (GCodePreviewData::Extrusion::Layer& layer : preview_data.extrusion.layers)
+        layer.paths.shrink_to_fit();
 }
 
 void GCodeAnalyzer::_calc_gcode_preview_travel(GCodePreviewData& preview_data, std::function<void()> cancel_callback)
@@ -1058,7 +1607,7 @@ void GCodeAnalyzer::_calc_gcode_preview_travel(GCodePreviewData& preview_data, s
         return;
 
     Polyline3 polyline;
-    Vec3d position(FLT_MAX, FLT_MAX, FLT_MAX);
+    Vec3f position(FLT_MAX, FLT_MAX, FLT_MAX);
     GCodePreviewData::Travel::EType type = GCodePreviewData::Travel::Num_Types;
     GCodePreviewData::Travel::Polyline::EDirection direction = GCodePreviewData::Travel::Polyline::Num_Directions;
     float feedrate = FLT_MAX;
@@ -1079,10 +1628,11 @@ void GCodeAnalyzer::_calc_gcode_preview_travel(GCodePreviewData& preview_data, s
         if (cancel_callback_curr == 0)
             cancel_callback();
 
+        const Metadata& data = m_metadata[move.data_id];
         GCodePreviewData::Travel::EType move_type = (move.delta_extruder < 0.0f) ? GCodePreviewData::Travel::Retract : ((move.delta_extruder > 0.0f) ? GCodePreviewData::Travel::Extrude : GCodePreviewData::Travel::Move);
         GCodePreviewData::Travel::Polyline::EDirection move_direction = ((move.start_position.x() != move.end_position.x()) || (move.start_position.y() != move.end_position.y())) ? GCodePreviewData::Travel::Polyline::Generic : GCodePreviewData::Travel::Polyline::Vertical;
 
-        if ((type != move_type) || (direction != move_direction) || (feedrate != move.data.feedrate) || (position != move.start_position) || (extruder_id != move.data.extruder_id))
+        if ((type != move_type) || (direction != move_direction) || (feedrate != data.feedrate) || (position != move.start_position) || (extruder_id != data.extruder_id))
         {
             // store current polyline
             polyline.remove_duplicate_points();
@@ -1102,11 +1652,11 @@ void GCodeAnalyzer::_calc_gcode_preview_travel(GCodePreviewData& preview_data, s
         // update current values
         position = move.end_position;
         type = move_type;
-        feedrate = move.data.feedrate;
-        extruder_id = move.data.extruder_id;
-        height_range.update_from(move.data.height);
-        width_range.update_from(move.data.width);
-        feedrate_range.update_from(move.data.feedrate, GCodePreviewData::FeedrateKind::TRAVEL);
+        feedrate = data.feedrate;
+        extruder_id = data.extruder_id;
+        height_range.update_from(data.height);
+        width_range.update_from(data.width);
+        feedrate_range.update_from(data.feedrate, GCodePreviewData::FeedrateKind::TRAVEL);
     }
 
     // store last polyline
@@ -1119,9 +1669,18 @@ void GCodeAnalyzer::_calc_gcode_preview_travel(GCodePreviewData& preview_data, s
     preview_data.ranges.feedrate.update_from(feedrate_range);
 
     // we need to sort the polylines by their min z as they can be shuffled in case of sequential prints
-    std::sort(preview_data.travel.polylines.begin(), preview_data.travel.polylines.end(),
-        [](const GCodePreviewData::Travel::Polyline& p1, const GCodePreviewData::Travel::Polyline& p2)->bool
-    { return unscale<double>(p1.polyline.bounding_box().min(2)) < unscale<double>(p2.polyline.bounding_box().min(2)); });
+    // the min z is calculated once per polyline, not at each comparison
+    GCodePreviewData::Travel::PolylinesList& polylines = preview_data.travel.polylines;
+    std::vector<std::pair<coord_t, size_t>> min_z;
+    min_z.reserve(polylines.size());
+    for (size_t i = 0; i < polylines.size(); ++ i)
+        min_z.emplace_back(polylines[i].polyline.bounding_box().min(2), i);
+    std::sort(min_z.begin(), min_z.end());
+    GCodePreviewData::Travel::PolylinesList sorted;
+    sorted.reserve(polylines.size());
+    for (const std::pair<coord_t, size_t>& z_idx : min_z)
+        sorted.emplace_back(std::move(polylines[z_idx.second]));
+    polylines = std::move(sorted);
 }
 
 void GCodeAnalyzer::_calc_gcode_preview_retractions(GCodePreviewData& preview_data, std::function<void()> cancel_callback)
@@ -1142,7 +1701,7 @@ void GCodeAnalyzer::_calc_gcode_preview_retractions(GCodePreviewData& preview_da
 
         // store position
         Vec3crd position((int)scale_(move.start_position.x()), (int)scale_(move.start_position.y()), (int)scale_(move.start_position.z()));
-        preview_data.retraction.positions.emplace_back(position, move.data.width, move.data.height);
+        preview_data.retraction.positions.emplace_back(position, m_metadata[move.data_id].width, m_metadata[move.data_id].height);
     }
 
     // we need to sort the positions by their z as they can be shuffled in case of sequential prints
@@ -1169,7 +1728,7 @@ void GCodeAnalyzer::_calc_gcode_preview_unretractions(GCodePreviewData& preview_
 
         // store position
         Vec3crd position((int)scale_(move.start_position.x()), (int)scale_(move.start_position.y()), (int)scale_(move.start_position.z()));
-        preview_data.unretraction.positions.emplace_back(position, move.data.width, move.data.height);
+        preview_data.unretraction.positions.emplace_back(position, m_metadata[move.data_id].width, m_metadata[move.data_id].height);
     }
 
     // we need to sort the positions by their z as they can be shuffled in case of sequential prints
@@ -1184,6 +1743,7 @@ size_t GCodeAnalyzer::memory_used() const
     size_t out = sizeof(*this);
     for (const std::pair<GCodeMove::EType, GCodeMovesList> &kvp : m_moves_map)
         out += sizeof(kvp) + SLIC3R_STDVEC_MEMSIZE(kvp.second, GCodeMove);
+    out += SLIC3R_STDVEC_MEMSIZE(m_metadata, Metadata) + m_metadata_ids.size() * (sizeof(Metadata) + sizeof(unsigned int) + 2 * sizeof(void*));
     out += m_process_output.size();
     return out;
 }
@@ -8,6 +8,8 @@
 #include "../Point.hpp"
 #include "../GCodeReader.hpp"
 
+#include <unordered_map>
+
 namespace Slic3r {
 
 class GCodePreviewData;
@@ -64,6 +66,9 @@ public:
         Metadata(ExtrusionRole extrusion_role, unsigned int extruder_id, double mm3_per_mm, float width, float height, float feedrate, float fan_speed, unsigned int cp_color_id = 0);
 
         bool operator != (const Metadata& other) const;
+        bool operator == (const Metadata& other) const { return !(*this != other); }
+
+        struct Hash { size_t operator()(const Metadata& data) const; };
     };
 
     struct GCodeMove
@@ -80,17 +85,19 @@ public:
         };
 
         EType type;
-        Metadata data;
-        Vec3d start_position;
-        Vec3d end_position;
+        // Index of the metadata of the move into the analyzer's palette of the distinct metadata,
+        // the moves sharing the same metadata share the same index.
+        unsigned int data_id;
+        Vec3f start_position;
+        Vec3f end_position;
         float delta_extruder;
 
-        GCodeMove(EType type, ExtrusionRole extrusion_role, unsigned int extruder_id, double mm3_per_mm, float width, float height, float feedrate, const Vec3d& start_position, const Vec3d& end_position, float delta_extruder, float fan_speed, unsigned int cp_color_id = 0);
-        GCodeMove(EType type, const Metadata& data, const Vec3d& start_position, const Vec3d& end_position, float delta_extruder);
+        GCodeMove(EType type, unsigned int data_id, const Vec3f& start_position, const Vec3f& end_position, float delta_extruder);
     };
 
     typedef std::vector<GCodeMove> GCodeMovesList;
     typedef std::map<GCodeMove::EType, GCodeMovesList> TypeToMovesMap;
+    typedef std::vector<Metadata> MetadataList;
     typedef std::map<unsigned int, Vec2d> ExtruderOffsetsMap;
     typedef std::map<unsigned int, unsigned int> ExtruderToColorMap;
 
@@ -107,12 +114,19 @@ private:
         float position[Num_Axis];
         float origin[Num_Axis];
         unsigned int cp_color_counter = 0;
+
+        bool operator == (const State& other) const;
     };
 
 private:
     State m_state;
     GCodeReader m_parser;
     TypeToMovesMap m_moves_map;
+    // The distinct metadata of the stored moves, indexed by GCodeMove::data_id.
+    MetadataList m_metadata;
+    std::unordered_map<Metadata, unsigned int, Metadata::Hash> m_metadata_ids;
+    // Index of the metadata of the last stored move, most of the moves share the metadata of their predecessor.
+    unsigned int m_last_metadata_id;
     ExtruderOffsetsMap m_extruder_offsets;
     unsigned int m_extruders_count;
     GCodeFlavor m_gcode_flavor;
@@ -138,6 +152,21 @@ public:
     // Adds the gcode contained in the given string to the analysis and returns it after removing the workcodes
     const std::string& process_gcode(const std::string& gcode);
 
+    // Adds the given already parsed gcode line to the analysis.
+    // Returns false if the line is one of the workcodes of the analyzer, which shall be removed from the output gcode.
+    // Lets the caller share a single parsing pass of the gcode with the other consumers (time estimators).
+    bool process_gcode_line(const GCodeReader::GCodeLine& line);
+
+    // Adds the gcode of the given ASCII or binary G-code file to the analysis, to visualize an externally loaded G-code.
+    // throws std::runtime_error if the file cannot be read, CanceledException through the cancel callback.
+    void process_file(const std::string& path, std::function<void()> cancel_callback = std::function<void()>());
+
+    // Adds the given gcode to the analysis with the same result as process_gcode(), without returning the gcode.
+    // The gcode is split at the layer changes into chunks, which are analyzed in parallel. The state at the start of each chunk
+    // is guessed by analyzing the preceding layer, the chunks started from a state differing from the end state of the previous chunk are analyzed again.
+    // throws CanceledException through the cancel callback.
+    void process_gcode_parallel(const std::string& gcode, std::function<void()> cancel_callback = std::function<void()>());
+
     // Calculates all data needed for gcode visualization
     // throws CanceledException through print->throw_if_canceled() (sent by the caller as callback).
     void calc_gcode_preview_data(GCodePreviewData& preview_data, std::function<void()> cancel_callback = std::function<void()>());
@@ -148,12 +177,27 @@ public:
     static bool is_valid_extrusion_role(ExtrusionRole role);
 
 private:
+    // Resets the state of the analysis to the state at the start of the gcode, keeps the settings and the moves
+    void _reset_state();
+
     // Processes the given gcode line
     void _process_gcode_line(GCodeReader& reader, const GCodeReader::GCodeLine& line);
 
+    // Processes the gcode lines from begin to end, end shall point to the start of a line or to the terminating zero
+    void _process_gcode_lines(const char* begin, const char* end, std::function<void()>& cancel_callback);
+
+    // Absolute position of the axis after the move of the given line
+    float _axis_absolute_position(EAxis axis, const GCodeReader::GCodeLine& line) const;
+
     // Move
     void _processG1(const GCodeReader::GCodeLine& line);
 
+    // Clockwise (G2) or counter-clockwise (G3) arc, stored as a sequence of line segments
+    void _processG2_G3(const GCodeReader::GCodeLine& line, bool ccw);
+
+    // Linear move to the given axes positions
+    void _process_move(const float new_pos[Num_Axis]);
+
     // Retract
     void _processG10(const GCodeReader::GCodeLine& line);
 
@@ -289,6 +333,8 @@ private:
 
     // Adds a new move with the given data
     void _store_move(GCodeMove::EType type);
+    // Returns the index of the given metadata into the palette, adds the metadata to the palette if not there yet
+    unsigned int _get_metadata_id(const Metadata& data);
 
     // Checks if the given int is a valid extrusion role (contained into enum ExtrusionRole)
     bool _is_valid_extrusion_role(int value) const;
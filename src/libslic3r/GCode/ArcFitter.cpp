@@ -0,0 +1,143 @@
+#include "ArcFitter.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace Slic3r {
+namespace ArcFitter {
+
+// An arc shall replace at least this number of line segments, otherwise the G-code is not shortened.
+static const size_t MIN_ARC_SEGMENTS = 3;
+// Maximum number of line segments replaced by a single arc, as each extension of the arc tests all its points again.
+static const size_t MAX_ARC_SEGMENTS = 256;
+// Arcs of a larger radius are hardly distinguishable from lines, while their I / J offsets lose precision.
+static const double MAX_RADIUS       = scale_(1000.);
+// Keep a safe distance from a full circle, which is what G2 / G3 with coinciding start and end points mean to the firmware.
+static const double MAX_SWEEP        = 1.5 * M_PI;
+// Upper limit of the number of the line segments of a discretized arc.
+static const size_t MAX_DISCRETIZED_SEGMENTS = 1000;
+
+// Center of the circle passing through a, b and c. Returns false for collinear points.
+static bool circle_center(const Vec2d &a, const Vec2d &b, const Vec2d &c, Vec2d &center)
+{
+    Vec2d  ab = b - a;
+    Vec2d  ac = c - a;
+    double d  = 2. * cross2(ab, ac);
+    if (d == 0.)
+        return false;
+    double ab2 = ab.squaredNorm();
+    double ac2 = ac.squaredNorm();
+    center = a + Vec2d(ac.y() * ab2 - ab.y() * ac2, ab.x() * ac2 - ac.x() * ab2) / d;
+    return true;
+}
+
+// Fit an arc starting at points[begin] and ending at points[end], passing through points[(begin + end) / 2].
+static bool fit_arc(const Points &points, size_t begin, size_t end, double tolerance, Segment &out)
+{
+    const Vec2d a = points[begin].cast<double>();
+    const Vec2d b = points[(begin + end) / 2].cast<double>();
+    const Vec2d c = points[end].cast<double>();
+    Vec2d center;
+    if (! circle_center(a, b, c, center))
+        return false;
+    const double radius = (a - center).norm();
+    if (radius > MAX_RADIUS || radius < tolerance)
+        return false;
+    const bool ccw   = cross2(Vec2d(b - a), Vec2d(c - b)) > 0.;
+    double     sweep = 0.;
+    Vec2d      v1    = a - center;
+    for (size_t i = begin + 1; i <= end; ++ i) {
+        Vec2d v2 = points[i].cast<double>() - center;
+        // Deviation of the point from the arc.
+        if (std::abs(v2.norm() - radius) > tolerance)
+            return false;
+        // The points shall progress around the center in the direction of the arc.
+        double angle = atan2(cross2(v1, v2), v1.dot(v2));
+        if (ccw ? angle <= 0. : angle >= 0.)
+            return false;
+        // Deviation of the line segment from the arc, the sagitta of the arc between the end points of the line segment.
+        if (radius * (1. - cos(0.5 * angle)) > tolerance)
+            return false;
+        sweep += std::abs(angle);
+        v1 = v2;
+    }
+    if (sweep > MAX_SWEEP)
+        return false;
+    out.end    = end;
+    out.arc    = true;
+    out.ccw    = ccw;
+    out.center = center;
+    out.length = radius * sweep;
+    return true;
+}
+
+std::vector<Segment> fit(const Points &points, double tolerance)
+{
+    std::vector<Segment> out;
+    size_t begin = 0;
+    while (begin + 1 < points.size()) {
+        // Extend the arc greedily as long as it fits.
+        Segment best;
+        best.arc = false;
+        Segment arc;
+        for (size_t end = begin + MIN_ARC_SEGMENTS; end < points.size() && end <= begin + MAX_ARC_SEGMENTS && fit_arc(points, begin, end, tolerance, arc); ++ end)
+            best = arc;
+        if (best.arc) {
+            out.emplace_back(best);
+            begin = best.end;
+        } else {
+            Segment line;
+            line.end    = begin + 1;
+            line.arc    = false;
+            line.ccw    = false;
+            line.center = Vec2d::Zero();
+            line.length = (points[begin + 1] - points[begin]).cast<double>().norm();
+            out.emplace_back(line);
+            ++ begin;
+        }
+    }
+    return out;
+}
+
+double sweep(const Vec2d &start, const Vec2d &end, const Vec2d &center, bool ccw)
+{
+    const Vec2d v1    = start - center;
+    const Vec2d v2    = end - center;
+    double      angle = atan2(cross2(v1, v2), v1.dot(v2));
+    if (! ccw)
+        angle = - angle;
+    if (angle <= 0.)
+        angle += 2. * M_PI;
+    return angle;
+}
+
+std::vector<Vec2d> discretize(const Vec2d &start, const Vec2d &end, const Vec2d &center, bool ccw, double max_segment_length, double max_deviation)
+{
+    const Vec2d  v1     = start - center;
+    const double radius = v1.norm();
+    const double sweep  = ArcFitter::sweep(start, end, center, ccw);
+
+    size_t num_segments = 1;
+    if (radius > 0.) {
+        if (max_segment_length > 0.)
+            num_segments = std::max(num_segments, size_t(ceil(radius * sweep / max_segment_length)));
+        if (max_deviation > 0. && max_deviation < radius)
+            num_segments = std::max(num_segments, size_t(ceil(sweep / (2. * acos(1. - max_deviation / radius)))));
+        num_segments = std::min(num_segments, MAX_DISCRETIZED_SEGMENTS);
+    }
+
+    std::vector<Vec2d> out;
+    out.reserve(num_segments);
+    const double angle_start = atan2(v1.y(), v1.x());
+    const double angle_step  = (ccw ? sweep : - sweep) / double(num_segments);
+    for (size_t i = 1; i < num_segments; ++ i) {
+        double angle = angle_start + angle_step * double(i);
+        out.emplace_back(center + radius * Vec2d(cos(angle), sin(angle)));
+    }
+    out.emplace_back(end);
+    return out;
+}
+
+} // namespace ArcFitter
+} // namespace Slic3r
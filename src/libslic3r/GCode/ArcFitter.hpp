@@ -0,0 +1,45 @@
+#ifndef slic3r_GCode_ArcFitter_hpp_
+#define slic3r_GCode_ArcFitter_hpp_
+
+#include "../libslic3r.h"
+#include "../Point.hpp"
+
+#include <vector>
+
+namespace Slic3r {
+
+// Replacement of the runs of short line segments of the extrusion paths by circular arcs (G2 / G3),
+// and the discretization of the G2 / G3 arcs back into line segments for the G-code processors.
+namespace ArcFitter {
+
+struct Segment
+{
+    // Index of the end point of the segment in the fitted points, the segment starts at the end point of the previous segment.
+    size_t  end;
+    // Circular arc if true, line segment otherwise.
+    bool    arc;
+    // Counter-clockwise arc (G3) if true, clockwise arc (G2) otherwise.
+    bool    ccw;
+    // Center of the arc in the coordinates of the fitted points.
+    Vec2d   center;
+    // Length of the arc or of the line segment in the coordinates of the fitted points.
+    double  length;
+};
+
+// Split the polyline into arcs and line segments. An arc replaces at least three line segments, it passes through
+// its start and end points and it does not deviate from any of the points and line segments it replaces by more than tolerance.
+// As the arc is parametrized by its length, an extrusion rate constant along the polyline remains constant along the arc.
+std::vector<Segment> fit(const Points &points, double tolerance);
+
+// Angle swept by the arc from start to end around center in (0, 2 PI], coinciding start and end points make a full circle.
+double sweep(const Vec2d &start, const Vec2d &end, const Vec2d &center, bool ccw);
+
+// Discretize an arc from start to end around center into line segments not longer than max_segment_length,
+// and not deviating from the arc by more than max_deviation. Returns the end points of the line segments of equal length, the last one is end.
+std::vector<Vec2d> discretize(const Vec2d &start, const Vec2d &end, const Vec2d &center, bool ccw, double max_segment_length, double max_deviation);
+
+} // namespace ArcFitter
+
+} // namespace Slic3r
+
+#endif // slic3r_GCode_ArcFitter_hpp_
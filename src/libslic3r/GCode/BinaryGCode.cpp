@@ -0,0 +1,320 @@
+#include "BinaryGCode.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+#include <boost/beast/core/detail/base64.hpp>
+#include <boost/format.hpp>
+#include <boost/nowide/cstdio.hpp>
+
+#include <miniz.h>
+
+namespace Slic3r {
+namespace BinaryGCode {
+
+static const char     MAGIC[4]        = { 'P', 'S', 'B', 'G' };
+static const uint32_t VERSION         = 1;
+// Type, compression, uncompressed size, stored size.
+static const size_t   BLOCK_HEADER_SIZE = 12;
+// Limit of the payload of a single block to catch corrupted sizes before allocating the memory.
+static const uint32_t MAX_BLOCK_SIZE  = 256 * 1024 * 1024;
+// Buffer size for reading the ASCII G-code during the conversion.
+static const size_t   READ_BUFFER_SIZE = 1024 * 1024;
+
+static inline void put_u16(unsigned char *p, uint16_t v) { p[0] = (unsigned char)(v & 0x0ff); p[1] = (unsigned char)(v >> 8); }
+static inline void put_u32(unsigned char *p, uint32_t v) { for (int i = 0; i < 4; ++ i) p[i] = (unsigned char)((v >> (8 * i)) & 0x0ff); }
+static inline uint16_t get_u16(const unsigned char *p) { return uint16_t(p[0] | (p[1] << 8)); }
+static inline uint32_t get_u32(const unsigned char *p) { return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24); }
+
+Encoder::Encoder(FILE *file, Compression compression, size_t block_size) :
+    m_file(file), m_compression(compression), m_block_size(std::max<size_t>(block_size, 1))
+{
+    assert(m_file != nullptr);
+    unsigned char header[12];
+    memcpy(header, MAGIC, 4);
+    put_u32(header + 4, VERSION);
+    put_u32(header + 8, 0);
+    if (::fwrite(header, 1, sizeof(header), m_file) != sizeof(header))
+        throw std::runtime_error("Binary G-code: Failed writing the file header.");
+    m_gcode.reserve(m_block_size);
+}
+
+void Encoder::write_block(BlockType type, Compression compression, const char *data, size_t len)
+{
+    if (len > MAX_BLOCK_SIZE)
+        throw std::runtime_error("Binary G-code: Block too large.");
+    const char *stored      = data;
+    size_t      stored_size = len;
+    if (compression == Compression::Deflate && len > 0) {
+        mz_ulong compressed_size = mz_compressBound(mz_ulong(len));
+        m_compressed.resize(size_t(compressed_size));
+        if (mz_compress2((unsigned char*)&m_compressed[0], &compressed_size, (const unsigned char*)data, mz_ulong(len), MZ_DEFAULT_LEVEL) != MZ_OK)
+            throw std::runtime_error("Binary G-code: Compression failed.");
+        if (size_t(compressed_size) < len) {
+            stored      = m_compressed.data();
+            stored_size = size_t(compressed_size);
+        } else
+            // Incompressible data is stored as is.
+            compression = Compression::None;
+    } else
+        compression = Compression::None;
+
+    unsigned char header[BLOCK_HEADER_SIZE];
+    put_u16(header, uint16_t(type));
+    put_u16(header + 2, uint16_t(compression));
+    put_u32(header + 4, uint32_t(len));
+    put_u32(header + 8, uint32_t(stored_size));
+    unsigned char crc[4];
+    put_u32(crc, uint32_t(mz_crc32(MZ_CRC32_INIT, (const unsigned char*)stored, stored_size)));
+    if (::fwrite(header, 1, sizeof(header), m_file) != sizeof(header) ||
+        (stored_size > 0 && ::fwrite(stored, 1, stored_size, m_file) != stored_size) ||
+        ::fwrite(crc, 1, sizeof(crc), m_file) != sizeof(crc))
+        throw std::runtime_error("Binary G-code: Failed writing a block. Is the disk full?");
+}
+
+void Encoder::write_thumbnail(const Thumbnail &thumbnail)
+{
+    std::string data(4, 0);
+    put_u16((unsigned char*)&data[0], thumbnail.width);
+    put_u16((unsigned char*)&data[2], thumbnail.height);
+    data += thumbnail.png;
+    // PNG is compressed already.
+    this->write_block(BlockType::Thumbnail, Compression::None, data.data(), data.size());
+}
+
+void Encoder::write_config(const std::string &config)
+{
+    this->write_block(BlockType::Config, m_compression, config.data(), config.size());
+}
+
+void Encoder::write_gcode(const char *data, size_t len)
+{
+    m_gcode.append(data, len);
+    while (m_gcode.size() >= m_block_size) {
+        // Split the block after the last complete line, or after the first line if a single line is longer than the block.
+        size_t end = m_gcode.rfind('\n', m_block_size - 1);
+        if (end == std::string::npos) {
+            end = m_gcode.find('\n', m_block_size);
+            if (end == std::string::npos)
+                // Wait for the end of the line.
+                return;
+        }
+        ++ end;
+        this->write_block(BlockType::GCode, m_compression, m_gcode.data(), end);
+        m_gcode.erase(0, end);
+    }
+}
+
+void Encoder::finalize()
+{
+    if (! m_gcode.empty()) {
+        this->write_block(BlockType::GCode, m_compression, m_gcode.data(), m_gcode.size());
+        m_gcode.clear();
+    }
+    if (::fflush(m_file) != 0 || ::ferror(m_file))
+        throw std::runtime_error("Binary G-code: Failed writing the file. Is the disk full?");
+}
+
+Decoder::Decoder(FILE *file) : m_file(file)
+{
+    assert(m_file != nullptr);
+    unsigned char header[12];
+    if (::fread(header, 1, sizeof(header), m_file) != sizeof(header) || memcmp(header, MAGIC, 4) != 0)
+        throw std::runtime_error("Binary G-code: Not a binary G-code file.");
+    uint32_t version = get_u32(header + 4);
+    if (version != VERSION)
+        throw std::runtime_error((boost::format("Binary G-code: Unsupported version %1%.") % version).str());
+}
+
+bool Decoder::read_block(BlockType &type, std::string &data)
+{
+    unsigned char header[BLOCK_HEADER_SIZE];
+    size_t        read = ::fread(header, 1, sizeof(header), m_file);
+    if (read == 0 && ::feof(m_file))
+        return false;
+    if (read != sizeof(header))
+        throw std::runtime_error("Binary G-code: Truncated block header.");
+    type = BlockType(get_u16(header));
+    Compression compression = Compression(get_u16(header + 2));
+    uint32_t    size        = get_u32(header + 4);
+    uint32_t    stored_size = get_u32(header + 8);
+    if (size > MAX_BLOCK_SIZE || stored_size > MAX_BLOCK_SIZE)
+        throw std::runtime_error("Binary G-code: Invalid block size.");
+    m_stored.resize(stored_size);
+    unsigned char crc[4];
+    if ((stored_size > 0 && ::fread(&m_stored[0], 1, stored_size, m_file) != stored_size) || ::fread(crc, 1, sizeof(crc), m_file) != sizeof(crc))
+        throw std::runtime_error("Binary G-code: Truncated block.");
+    if (get_u32(crc) != uint32_t(mz_crc32(MZ_CRC32_INIT, (const unsigned char*)m_stored.data(), stored_size)))
+        throw std::runtime_error("Binary G-code: Block checksum mismatch.");
+    switch (compression) {
+    case Compression::None:
+        if (stored_size != size)
+            throw std::runtime_error("Binary G-code: Invalid block size.");
+        data.swap(m_stored);
+        break;
+    case Compression::Deflate:
+    {
+        data.resize(size);
+        mz_ulong uncompressed_size = mz_ulong(size);
+        if (size > 0 && (mz_uncompress((unsigned char*)&data[0], &uncompressed_size, (const unsigned char*)m_stored.data(), mz_ulong(stored_size)) != MZ_OK ||
+                         uncompressed_size != mz_ulong(size)))
+            throw std::runtime_error("Binary G-code: Decompression failed.");
+        break;
+    }
+    default:
+        throw std::runtime_error((boost::format("Binary G-code: Unknown compression %1%.") % uint16_t(compression)).str());
+    }
+    return true;
+}
+
+Thumbnail Decoder::parse_thumbnail(const std::string &data)
+{
+    if (data.size() < 4)
+        throw std::runtime_error("Binary G-code: Invalid thumbnail block.");
+    Thumbnail out;
+    out.width  = get_u16((const unsigned char*)data.data());
+    out.height = get_u16((const unsigned char*)data.data() + 2);
+    out.png    = data.substr(4);
+    return out;
+}
+
+bool is_binary_gcode(const std::string &path)
+{
+    FILE *file = boost::nowide::fopen(path.c_str(), "rb");
+    if (file == nullptr)
+        return false;
+    char magic[4];
+    bool binary = ::fread(magic, 1, 4, file) == 4 && memcmp(magic, MAGIC, 4) == 0;
+    fclose(file);
+    return binary;
+}
+
+std::string read_config(const std::string &path)
+{
+    FILE *file = boost::nowide::fopen(path.c_str(), "rb");
+    if (file == nullptr)
+        throw std::runtime_error(std::string("Binary G-code: Cannot open ") + path + " for reading.");
+    std::string config;
+    try {
+        Decoder     decoder(file);
+        BlockType   type;
+        std::string data;
+        // The metadata blocks precede the G-code blocks.
+        while (decoder.read_block(type, data) && type != BlockType::GCode)
+            if (type == BlockType::Config) {
+                config.swap(data);
+                break;
+            }
+    } catch (...) {
+        fclose(file);
+        throw;
+    }
+    fclose(file);
+    return config;
+}
+
+void convert_ascii_to_binary(const std::string &src, const std::string &dst, const std::vector<Thumbnail> &thumbnails, const std::string &config)
+{
+    FILE *in = boost::nowide::fopen(src.c_str(), "rb");
+    if (in == nullptr)
+        throw std::runtime_error(std::string("Binary G-code: Cannot open ") + src + " for reading.");
+    FILE *out = boost::nowide::fopen(dst.c_str(), "wb");
+    if (out == nullptr) {
+        fclose(in);
+        throw std::runtime_error(std::string("Binary G-code: Cannot open ") + dst + " for writing.");
+    }
+    try {
+        Encoder encoder(out);
+        for (const Thumbnail &thumbnail : thumbnails)
+            encoder.write_thumbnail(thumbnail);
+        if (! config.empty())
+            encoder.write_config(config);
+        std::vector<char> buffer(READ_BUFFER_SIZE);
+        for (;;) {
+            size_t len = ::fread(buffer.data(), 1, buffer.size(), in);
+            if (len == 0)
+                break;
+            encoder.write_gcode(buffer.data(), len);
+        }
+        if (::ferror(in))
+            throw std::runtime_error(std::string("Binary G-code: Failed reading ") + src);
+        encoder.finalize();
+    } catch (...) {
+        fclose(in);
+        fclose(out);
+        boost::nowide::remove(dst.c_str());
+        throw;
+    }
+    fclose(in);
+    fclose(out);
+}
+
+void convert_binary_to_ascii(const std::string &src, const std::string &dst)
+{
+    FILE *in = boost::nowide::fopen(src.c_str(), "rb");
+    if (in == nullptr)
+        throw std::runtime_error(std::string("Binary G-code: Cannot open ") + src + " for reading.");
+    FILE *out = boost::nowide::fopen(dst.c_str(), "wb");
+    if (out == nullptr) {
+        fclose(in);
+        throw std::runtime_error(std::string("Binary G-code: Cannot open ") + dst + " for writing.");
+    }
+    try {
+        Decoder     decoder(in);
+        BlockType   type;
+        std::string data;
+        std::string thumbnails;
+        std::string config;
+        bool        first_block = true;
+        bool        ok          = true;
+        auto        write       = [out, &ok](const char *data, size_t len) { ok &= len == 0 || ::fwrite(data, 1, len, out) == len; };
+        while (decoder.read_block(type, data)) {
+            if (type == BlockType::Thumbnail) {
+                // Same layout as the thumbnails of the ASCII G-code.
+                const size_t max_row_length = 78;
+                Thumbnail    thumbnail = Decoder::parse_thumbnail(data);
+                std::string  encoded;
+                encoded.resize(boost::beast::detail::base64::encoded_size(thumbnail.png.size()));
+                encoded.resize(boost::beast::detail::base64::encode((void*)&encoded[0], (const void*)thumbnail.png.data(), thumbnail.png.size()));
+                thumbnails += (boost::format("\n;\n; thumbnail begin %dx%d %d\n") % thumbnail.width % thumbnail.height % encoded.size()).str();
+                for (size_t offset = 0; offset < encoded.size(); offset += max_row_length)
+                    thumbnails += "; " + encoded.substr(offset, max_row_length) + "\n";
+                thumbnails += "; thumbnail end\n;\n";
+            } else if (type == BlockType::Config) {
+                config = data;
+            } else if (type == BlockType::GCode) {
+                if (first_block && ! thumbnails.empty()) {
+                    // Insert the thumbnails after the first line ("; generated by ...") and the empty line following it.
+                    size_t end = data.find('\n');
+                    end = (end == std::string::npos) ? data.size() : end + 1;
+                    if (end < data.size() && data[end] == '\n')
+                        ++ end;
+                    write(data.data(), end);
+                    write(thumbnails.data(), thumbnails.size());
+                    write(data.data() + end, data.size() - end);
+                } else
+                    write(data.data(), data.size());
+                first_block = false;
+            }
+            // Skip blocks of unknown types.
+        }
+        if (! config.empty()) {
+            write("\n", 1);
+            write(config.data(), config.size());
+        }
+        if (! ok || ::fflush(out) != 0 || ::ferror(out))
+            throw std::runtime_error(std::string("Binary G-code: Failed writing ") + dst + ". Is the disk full?");
+    } catch (...) {
+        fclose(in);
+        fclose(out);
+        boost::nowide::remove(dst.c_str());
+        throw;
+    }
+    fclose(in);
+    fclose(out);
+}
+
+} // namespace BinaryGCode
+} // namespace Slic3r
@@ -0,0 +1,117 @@
+#ifndef slic3r_GCode_BinaryGCode_hpp_
+#define slic3r_GCode_BinaryGCode_hpp_
+
+#include "../libslic3r.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace Slic3r {
+
+// Compact binary container of the G-code, exported instead of the ASCII G-code if PrintConfig::binary_gcode is enabled.
+//
+// All the integers are stored little endian. The file starts with the file header:
+//     char[4]  magic "PSBG"
+//     uint32   version, currently 1
+//     uint32   flags, currently 0
+// followed by a sequence of blocks up to the end of the file. Each block consists of
+//     uint16   block type
+//     uint16   compression of the payload
+//     uint32   size of the uncompressed payload
+//     uint32   size of the payload as stored
+//     byte[]   payload as stored
+//     uint32   CRC-32 (zlib polynomial) of the payload as stored
+// Block types:
+//     0 G-code     Text of complete ASCII G-code lines, the G-code is the concatenation of the G-code blocks in their order.
+//     1 Config     The "; key = value" lines of the print configuration, otherwise stored at the end of the ASCII G-code.
+//     2 Thumbnail  uint16 width, uint16 height in pixels, followed by the PNG image.
+// Compression:
+//     0 None       The payload is stored as is.
+//     1 Deflate    The payload is stored as a zlib stream.
+// The metadata blocks (thumbnails, config) precede the G-code blocks, so that a printer or a host may show them
+// without reading the whole file. Blocks of unknown types shall be skipped by the readers.
+namespace BinaryGCode {
+
+enum class BlockType : uint16_t {
+    GCode       = 0,
+    Config      = 1,
+    Thumbnail   = 2,
+};
+
+enum class Compression : uint16_t {
+    None        = 0,
+    Deflate     = 1,
+};
+
+struct Thumbnail
+{
+    uint16_t    width  { 0 };
+    uint16_t    height { 0 };
+    std::string png;
+};
+
+// Streaming encoder of the binary G-code into an opened file. Throws std::runtime_error on output errors.
+class Encoder
+{
+public:
+    // Size of the uncompressed G-code blocks.
+    static constexpr size_t default_block_size = 64 * 1024;
+
+    // Writes the file header. The encoder does not take ownership of the FILE.
+    explicit Encoder(FILE *file, Compression compression = Compression::Deflate, size_t block_size = default_block_size);
+
+    void write_thumbnail(const Thumbnail &thumbnail);
+    void write_config(const std::string &config);
+    // Append the G-code, it is packed into blocks of complete lines.
+    void write_gcode(const char *data, size_t len);
+    void write_gcode(const std::string &data) { this->write_gcode(data.data(), data.size()); }
+    // Write the buffered rest of the G-code.
+    void finalize();
+
+private:
+    void write_block(BlockType type, Compression compression, const char *data, size_t len);
+
+    FILE           *m_file;
+    Compression     m_compression;
+    size_t          m_block_size;
+    std::string     m_gcode;
+    // Reused between the blocks.
+    std::string     m_compressed;
+};
+
+// Streaming decoder of the binary G-code from an opened file. Throws std::runtime_error on a corrupted file.
+class Decoder
+{
+public:
+    // Reads and validates the file header. The decoder does not take ownership of the FILE.
+    explicit Decoder(FILE *file);
+
+    // Reads the next block into data, returns false at the end of the file.
+    bool read_block(BlockType &type, std::string &data);
+    // Parse the payload of a thumbnail block.
+    static Thumbnail parse_thumbnail(const std::string &data);
+
+private:
+    FILE           *m_file;
+    // Reused between the blocks.
+    std::string     m_stored;
+};
+
+// Does the file start with the magic of the binary G-code?
+bool        is_binary_gcode(const std::string &path);
+// Config block of a binary G-code file, empty if there is none.
+std::string read_config(const std::string &path);
+// Convert the ASCII G-code file src to the binary G-code file dst. The thumbnails and the config are stored into the metadata blocks,
+// they are expected not to be contained in the ASCII G-code.
+void        convert_ascii_to_binary(const std::string &src, const std::string &dst, const std::vector<Thumbnail> &thumbnails, const std::string &config);
+// Convert the binary G-code file src to the ASCII G-code file dst, in the layout of the ASCII G-code exported by PrusaSlicer:
+// The thumbnails are inserted after the first line, the config is appended at the end.
+void        convert_binary_to_ascii(const std::string &src, const std::string &dst);
+
+} // namespace BinaryGCode
+
+} // namespace Slic3r
+
+#endif // slic3r_GCode_BinaryGCode_hpp_
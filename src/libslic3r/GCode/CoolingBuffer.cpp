@@ -1,8 +1,9 @@
 #include "../GCode.hpp"
+#include "ArcFitter.hpp"
 #include "CoolingBuffer.hpp"
-#include <boost/algorithm/string/predicate.hpp>
-#include <boost/algorithm/string/replace.hpp>
 #include <boost/log/trivial.hpp>
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <float.h>
 
@@ -16,8 +17,11 @@
 
 namespace Slic3r {
 
-CoolingBuffer::CoolingBuffer(GCode &gcodegen) : m_gcodegen(gcodegen), m_current_extruder(0)
+CoolingBuffer::CoolingBuffer(GCode &gcodegen) : 
+    m_gcodegen(gcodegen), m_config(gcodegen.config()), m_toolchange_prefix(gcodegen.writer().toolchange_prefix()), m_current_extruder(0)
 {
+    for (const Extruder &extruder : gcodegen.writer().extruders())
+        m_extruder_ids.emplace_back(extruder.id());
     this->reset();
 }
 
@@ -28,7 +32,7 @@ void CoolingBuffer::reset()
     m_current_pos[0] = float(pos(0));
     m_current_pos[1] = float(pos(1));
     m_current_pos[2] = float(pos(2));
-    m_current_pos[4] = float(m_gcodegen.config().travel_speed.value);
+    m_current_pos[4] = float(m_config.travel_speed.value);
 }
 
 struct CoolingLine
@@ -288,19 +292,44 @@ std::string CoolingBuffer::process_layer(const std::string &gcode, size_t layer_
 
 // Parse the layer G-code for the moves, which could be adjusted.
 // Return the list of parsed lines, bucketed by an extruder.
+// Does the G-code line [line_start, line_end) start with the given prefix?
+static inline bool line_starts_with(const char *line_start, const char *line_end, const char *prefix, size_t prefix_len)
+{
+    return size_t(line_end - line_start) >= prefix_len && memcmp(line_start, prefix, prefix_len) == 0;
+}
+
+template<size_t N>
+static inline bool line_starts_with(const char *line_start, const char *line_end, const char (&prefix)[N])
+{
+    return line_starts_with(line_start, line_end, prefix, N - 1);
+}
+
+// Does the G-code line [line_start, line_end) contain the given tag?
+template<size_t N>
+static inline bool line_contains(const char *line_start, const char *line_end, const char (&tag)[N])
+{
+    return std::search(line_start, line_end, tag, tag + N - 1) != line_end;
+}
+
+// Find the first occurence of a character in the G-code line [line_start, line_end), return nullptr if not found.
+static inline const char* line_find(const char *line_start, const char *line_end, char c)
+{
+    const char *it = std::find(line_start, line_end, c);
+    return it == line_end ? nullptr : it;
+}
+
 std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::string &gcode, std::vector<float> &current_pos) const
 {
-    const FullPrintConfig       &config        = m_gcodegen.config();
-    const std::vector<Extruder> &extruders     = m_gcodegen.writer().extruders();
+    const PrintConfig           &config        = m_config;
     unsigned int                 num_extruders = 0;
-    for (const Extruder &ex : extruders)
-        num_extruders = std::max(ex.id() + 1, num_extruders);
+    for (unsigned int extruder_id : m_extruder_ids)
+        num_extruders = std::max(extruder_id + 1, num_extruders);
     
-    std::vector<PerExtruderAdjustments> per_extruder_adjustments(extruders.size());
+    std::vector<PerExtruderAdjustments> per_extruder_adjustments(m_extruder_ids.size());
     std::vector<size_t>                 map_extruder_to_per_extruder_adjustment(num_extruders, 0);
-    for (size_t i = 0; i < extruders.size(); ++ i) {
+    for (size_t i = 0; i < m_extruder_ids.size(); ++ i) {
         PerExtruderAdjustments &adj         = per_extruder_adjustments[i];
-        unsigned int            extruder_id = extruders[i].id();
+        unsigned int            extruder_id = m_extruder_ids[i];
         adj.extruder_id               = extruder_id;
         adj.cooling_slow_down_enabled = config.cooling.get_at(extruder_id);
         adj.slowdown_below_layer_time = float(config.slowdown_below_layer_time.get_at(extruder_id));
@@ -308,7 +337,7 @@ std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::
         map_extruder_to_per_extruder_adjustment[extruder_id] = i;
     }
 
-    const std::string toolchange_prefix = m_gcodegen.writer().toolchange_prefix();
+    const std::string &toolchange_prefix = m_toolchange_prefix;
     unsigned int      current_extruder  = m_current_extruder;
     PerExtruderAdjustments *adjustment  = &per_extruder_adjustments[map_extruder_to_per_extruder_adjustment[current_extruder]];
     const char       *line_start = gcode.c_str();
@@ -322,28 +351,44 @@ std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::
     {
         while (*line_end != '\n' && *line_end != 0)
             ++ line_end;
-        // sline will not contain the trailing '\n'.
-        std::string sline(line_start, line_end);
+        // The line is parsed in place, [line_start, sline_end) will not contain the trailing '\n'.
+        const char *sline_end = line_end;
         // CoolingLine will contain the trailing '\n'.
         if (*line_end == '\n')
             ++ line_end;
         CoolingLine line(0, line_start - gcode.c_str(), line_end - gcode.c_str());
-        if (boost::starts_with(sline, "G0 "))
+        // G2 / G3 arcs are adjusted the same way as the G1 lines, only their length is calculated differently.
+        bool arc = false;
+        bool arc_ccw = false;
+        if (line_starts_with(line_start, sline_end, "G0 "))
             line.type = CoolingLine::TYPE_G0;
-        else if (boost::starts_with(sline, "G1 "))
+        else if (line_starts_with(line_start, sline_end, "G1 "))
+            line.type = CoolingLine::TYPE_G1;
+        else if (line_starts_with(line_start, sline_end, "G2 ") || line_starts_with(line_start, sline_end, "G3 ")) {
             line.type = CoolingLine::TYPE_G1;
-        else if (boost::starts_with(sline, "G92 "))
+            arc       = true;
+            arc_ccw   = line_start[1] == '3';
+        } else if (line_starts_with(line_start, sline_end, "G92 "))
             line.type = CoolingLine::TYPE_G92;
         if (line.type) {
-            // G0, G1 or G92
+            // G0, G1, G2, G3 or G92
             // Parse the G-code line.
-            std::vector<float> new_pos(current_pos);
-            const char *c = sline.data() + 3;
+            assert(current_pos.size() == 5);
+            float new_pos[5];
+            std::copy(current_pos.begin(), current_pos.end(), new_pos);
+            // Center of the arc relative to the current position.
+            Vec2d arc_center_offset = Vec2d::Zero();
+            const char *c = line_start + 3;
             for (;;) {
                 // Skip whitespaces.
-                for (; *c == ' ' || *c == '\t'; ++ c);
-                if (*c == 0 || *c == ';')
+                for (; c != sline_end && (*c == ' ' || *c == '\t'); ++ c);
+                if (c == sline_end || *c == ';')
                     break;
+                if (arc && (*c == 'I' || *c == 'J')) {
+                    arc_center_offset(*c - 'I') = atof(c + 1);
+                    for (; c != sline_end && *c != ' ' && *c != '\t'; ++ c);
+                    continue;
+                }
                 // Parse the axis.
                 size_t axis = (*c >= 'X' && *c <= 'Z') ? (*c - 'X') :
                               (*c == extrusion_axis) ? 3 : (*c == 'F') ? 4 : size_t(-1);
@@ -358,15 +403,15 @@ std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::
                     }
                 }
                 // Skip this word.
-                for (; *c != ' ' && *c != '\t' && *c != 0; ++ c);
+                for (; c != sline_end && *c != ' ' && *c != '\t'; ++ c);
             }
-            bool external_perimeter = boost::contains(sline, ";_EXTERNAL_PERIMETER");
-            bool wipe               = boost::contains(sline, ";_WIPE");
+            bool external_perimeter = line_contains(line_start, sline_end, ";_EXTERNAL_PERIMETER");
+            bool wipe               = line_contains(line_start, sline_end, ";_WIPE");
             if (external_perimeter)
                 line.type |= CoolingLine::TYPE_EXTERNAL_PERIMETER;
             if (wipe)
                 line.type |= CoolingLine::TYPE_WIPE;
-            if (boost::contains(sline, ";_EXTRUDE_SET_SPEED") && ! wipe) {
+            if (line_contains(line_start, sline_end, ";_EXTRUDE_SET_SPEED") && ! wipe) {
                 line.type |= CoolingLine::TYPE_ADJUSTABLE;
                 active_speed_modifier = adjustment->lines.size();
             }
@@ -379,6 +424,12 @@ std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::
                 for (size_t i = 0; i < 4; ++ i)
                     dif[i] = new_pos[i] - current_pos[i];
                 float dxy2 = dif[0] * dif[0] + dif[1] * dif[1];
+                if (arc) {
+                    // Replace the chord of the arc by the length of the arc.
+                    const Vec2d start(current_pos[0], current_pos[1]);
+                    float arc_length = float(arc_center_offset.norm() * ArcFitter::sweep(start, Vec2d(new_pos[0], new_pos[1]), start + arc_center_offset, arc_ccw));
+                    dxy2 = arc_length * arc_length;
+                }
                 float dxyz2 = dxy2 + dif[2] * dif[2];
                 if (dxyz2 > 0.f) {
                     // Movement in xyz, calculate time from the xyz Euclidian distance.
@@ -411,12 +462,12 @@ std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::
                     line.type = 0;
                 }
             }
-            current_pos = std::move(new_pos);
-        } else if (boost::starts_with(sline, ";_EXTRUDE_END")) {
+            std::copy(new_pos, new_pos + 5, current_pos.begin());
+        } else if (line_starts_with(line_start, sline_end, ";_EXTRUDE_END")) {
             line.type = CoolingLine::TYPE_EXTRUDE_END;
             active_speed_modifier = size_t(-1);
-        } else if (boost::starts_with(sline, toolchange_prefix)) {
-            unsigned int new_extruder = (unsigned int)atoi(sline.c_str() + toolchange_prefix.size());
+        } else if (line_starts_with(line_start, sline_end, toolchange_prefix.c_str(), toolchange_prefix.size())) {
+            unsigned int new_extruder = (unsigned int)atoi(line_start + toolchange_prefix.size());
             // Only change extruder in case the number is meaningful. User could provide an out-of-range index through custom gcodes - those shall be ignored.
             if (new_extruder < map_extruder_to_per_extruder_adjustment.size()) {
                 if (new_extruder != current_extruder) {
@@ -429,21 +480,21 @@ std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::
             else {
                 // Only log the error in case of MM printer. Single extruder printers likely ignore any T anyway.
                 if (map_extruder_to_per_extruder_adjustment.size() > 1)
-                    BOOST_LOG_TRIVIAL(error) << "CoolingBuffer encountered an invalid toolchange, maybe from a custom gcode: " << sline;
+                    BOOST_LOG_TRIVIAL(error) << "CoolingBuffer encountered an invalid toolchange, maybe from a custom gcode: " << std::string(line_start, sline_end);
             }
 
-        } else if (boost::starts_with(sline, ";_BRIDGE_FAN_START")) {
+        } else if (line_starts_with(line_start, sline_end, ";_BRIDGE_FAN_START")) {
             line.type = CoolingLine::TYPE_BRIDGE_FAN_START;
-        } else if (boost::starts_with(sline, ";_BRIDGE_FAN_END")) {
+        } else if (line_starts_with(line_start, sline_end, ";_BRIDGE_FAN_END")) {
             line.type = CoolingLine::TYPE_BRIDGE_FAN_END;
-        } else if (boost::starts_with(sline, "G4 ")) {
+        } else if (line_starts_with(line_start, sline_end, "G4 ")) {
             // Parse the wait time.
             line.type = CoolingLine::TYPE_G4;
-            size_t pos_S = sline.find('S', 3);
-            size_t pos_P = sline.find('P', 3);
+            const char *pos_S = line_find(line_start + 3, sline_end, 'S');
+            const char *pos_P = line_find(line_start + 3, sline_end, 'P');
             line.time = line.time_max = float(
-                (pos_S > 0) ? atof(sline.c_str() + pos_S + 1) :
-                (pos_P > 0) ? atof(sline.c_str() + pos_P + 1) * 0.001 : 0.);
+                pos_S ? atof(pos_S + 1) :
+                pos_P ? atof(pos_P + 1) * 0.001 : 0.);
         }
         if (line.type != 0)
             adjustment->lines.emplace_back(std::move(line));
@@ -673,12 +724,13 @@ std::string CoolingBuffer::apply_layer_cooldown(
     }
     // Second generate the adjusted G-code.
     std::string new_gcode;
-    new_gcode.reserve(gcode.size() * 2);
+    // The cooling buffer mostly removes or shortens lines, only the fan commands are added.
+    new_gcode.reserve(gcode.size() + 256);
     int  fan_speed          = -1;
     bool bridge_fan_control = false;
     int  bridge_fan_speed   = 0;
     auto change_extruder_set_fan = [ this, layer_id, layer_time, &new_gcode, &fan_speed, &bridge_fan_control, &bridge_fan_speed ]() {
-        const FullPrintConfig &config = m_gcodegen.config();
+        const PrintConfig &config = m_config;
 #define EXTRUDER_CONFIG(OPT) config.OPT.get_at(m_current_extruder)
         int min_fan_speed = EXTRUDER_CONFIG(min_fan_speed);
         int fan_speed_new = EXTRUDER_CONFIG(fan_always_on) ? min_fan_speed : 0;
@@ -713,7 +765,7 @@ std::string CoolingBuffer::apply_layer_cooldown(
 
     const char         *pos               = gcode.c_str();
     int                 current_feedrate  = 0;
-    const std::string   toolchange_prefix = m_gcodegen.writer().toolchange_prefix();
+    const std::string  &toolchange_prefix = m_toolchange_prefix;
     change_extruder_set_fan();
     for (const CoolingLine *line : lines) {
         const char *line_start  = gcode.c_str() + line->line_start;
@@ -789,13 +841,24 @@ std::string CoolingBuffer::apply_layer_cooldown(
             if (end < line_end) {
                 if (line->type & (CoolingLine::TYPE_ADJUSTABLE | CoolingLine::TYPE_EXTERNAL_PERIMETER | CoolingLine::TYPE_WIPE)) {
                     // Process comments, remove ";_EXTRUDE_SET_SPEED", ";_EXTERNAL_PERIMETER", ";_WIPE"
-                    std::string comment(end, line_end);
-                    boost::replace_all(comment, ";_EXTRUDE_SET_SPEED", "");
-                    if (line->type & CoolingLine::TYPE_EXTERNAL_PERIMETER)
-                        boost::replace_all(comment, ";_EXTERNAL_PERIMETER", "");
-                    if (line->type & CoolingLine::TYPE_WIPE)
-                        boost::replace_all(comment, ";_WIPE", "");
-                    new_gcode += comment;
+                    // The comment is copied in place, skipping the tags, without creating a temporary string.
+                    static const char *tags[] = { ";_EXTRUDE_SET_SPEED", ";_EXTERNAL_PERIMETER", ";_WIPE" };
+                    const bool strip[] = { true, (line->type & CoolingLine::TYPE_EXTERNAL_PERIMETER) != 0, (line->type & CoolingLine::TYPE_WIPE) != 0 };
+                    for (const char *c = end; c < line_end;) {
+                        size_t tag_len = 0;
+                        if (*c == ';')
+                            for (size_t i = 0; i < 3 && tag_len == 0; ++ i)
+                                if (strip[i] && line_starts_with(c, line_end, tags[i], strlen(tags[i])))
+                                    tag_len = strlen(tags[i]);
+                        if (tag_len > 0) {
+                            c += tag_len;
+                        } else {
+                            // Copy up to the next potential tag.
+                            const char *next = std::find(c + 1, line_end, ';');
+                            new_gcode.append(c, next - c);
+                            c = next;
+                        }
+                    }
                 } else {
                     // Just attach the rest of the source line.
                     new_gcode.append(end, line_end - end);
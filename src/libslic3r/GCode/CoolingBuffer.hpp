@@ -2,8 +2,10 @@
 #define slic3r_CoolingBuffer_hpp_
 
 #include "../libslic3r.h"
+#include "../PrintConfig.hpp"
 #include <map>
 #include <string>
+#include <vector>
 
 namespace Slic3r {
 
@@ -28,6 +30,15 @@ public:
     std::string process_layer(const std::string &gcode, size_t layer_id);
     GCode* 	    gcodegen() { return &m_gcodegen; }
 
+    // State carried over from layer to layer, see GCodeLayerCache.
+    struct State {
+        std::vector<float> current_pos;
+        unsigned int       current_extruder;
+        bool operator==(const State &rhs) const { return current_pos == rhs.current_pos && current_extruder == rhs.current_extruder; }
+    };
+    State       state() const { return { m_current_pos, m_current_extruder }; }
+    void        set_state(const State &state) { m_current_pos = state.current_pos; m_current_extruder = state.current_extruder; }
+
 private:
 	CoolingBuffer& operator=(const CoolingBuffer&) = delete;
     std::vector<PerExtruderAdjustments> parse_layer_gcode(const std::string &gcode, std::vector<float> &current_pos) const;
@@ -37,6 +48,11 @@ private:
     std::string apply_layer_cooldown(const std::string &gcode, size_t layer_id, float layer_time, std::vector<PerExtruderAdjustments> &per_extruder_adjustments);
 
     GCode&              m_gcodegen;
+    // Configuration and extruders of the G-code generator cached at the CoolingBuffer construction,
+    // as the G-code generator state is modified by the export pipeline while the previous layer is being cooled down.
+    const PrintConfig   m_config;
+    std::vector<unsigned int> m_extruder_ids;
+    std::string         m_toolchange_prefix;
     std::string         m_gcode;
     // Internal data.
     // X,Y,Z,E,F
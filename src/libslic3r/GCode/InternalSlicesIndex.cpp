@@ -0,0 +1,163 @@
+#include "InternalSlicesIndex.hpp"
+
+#include "../Geometry.hpp"
+#include "../Layer.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace Slic3r {
+
+InternalSlicesIndex::InternalSlicesIndex(const Layer &layer)
+{
+    ExPolygons slices;
+    for (const LayerRegion *layerm : layer.regions())
+        for (const Surface &surface : layerm->slices.surfaces)
+            if (surface.is_internal())
+                slices.emplace_back(surface.expolygon);
+    this->create(std::move(slices));
+}
+
+void InternalSlicesIndex::create(ExPolygons &&slices)
+{
+    m_slices = std::move(slices);
+    if (m_slices.empty())
+        return;
+
+    m_bboxes.reserve(m_slices.size());
+    for (const ExPolygon &expoly : m_slices)
+        m_bboxes.emplace_back(get_extents(expoly.contour));
+
+    // Contours of the edge grid are collected by EdgeGrid::Grid::create() in the same order: The non-empty contour, then the non-empty holes.
+    for (size_t i = 0; i < m_slices.size(); ++ i) {
+        const ExPolygon &expoly = m_slices[i];
+        if (! expoly.contour.points.empty())
+            m_contour_slice.emplace_back(i);
+        for (const Polygon &hole : expoly.holes)
+            if (! hole.points.empty())
+                m_contour_slice.emplace_back(i);
+    }
+    const coord_t grid_resolution = coord_t(scale_(1.) + 0.5);
+    m_grid.create(m_slices, grid_resolution);
+    assert(m_grid.contours().size() == m_contour_slice.size());
+    m_grid_cols = size_t((m_grid.bbox().max(0) - m_grid.bbox().min(0) + grid_resolution - 1) / grid_resolution);
+    m_grid_rows = size_t((m_grid.bbox().max(1) - m_grid.bbox().min(1) + grid_resolution - 1) / grid_resolution);
+
+    // Build the bounding box hierarchy by splitting the slices in halves along the longer side of the bounding box of their centers.
+    m_slices_sorted.reserve(m_slices.size());
+    for (size_t i = 0; i < m_slices.size(); ++ i)
+        m_slices_sorted.emplace_back(i);
+    m_nodes.reserve(2 * m_slices.size());
+    const size_t leaf_size = 4;
+    auto build = [this, leaf_size](size_t begin, size_t end, auto &build) -> void {
+        size_t idx = m_nodes.size();
+        m_nodes.push_back({ BoundingBox(), begin, end, size_t(-1) });
+        BoundingBox bbox_centers;
+        for (size_t i = begin; i < end; ++ i) {
+            const BoundingBox &bbox = m_bboxes[m_slices_sorted[i]];
+            m_nodes[idx].bbox.merge(bbox);
+            bbox_centers.merge(bbox.center());
+        }
+        if (end - begin <= leaf_size)
+            return;
+        int    axis = (bbox_centers.size()(0) >= bbox_centers.size()(1)) ? 0 : 1;
+        size_t mid  = (begin + end) / 2;
+        std::nth_element(m_slices_sorted.begin() + begin, m_slices_sorted.begin() + mid, m_slices_sorted.begin() + end,
+            [this, axis](size_t i1, size_t i2) { return m_bboxes[i1].center()(axis) < m_bboxes[i2].center()(axis); });
+        build(begin, mid, build);
+        m_nodes[idx].right = m_nodes.size();
+        build(mid, end, build);
+    };
+    build(0, m_slices.size(), build);
+}
+
+void InternalSlicesIndex::candidates(const BoundingBox &bbox, std::vector<size_t> &out) const
+{
+    // A slice may only contain the travel if its bounding box contains the bounding box of the travel,
+    // and the bounding box of a node contains the bounding boxes of all its slices.
+    auto contains_bbox = [&bbox](const BoundingBox &other) { return other.contains(bbox.min) && other.contains(bbox.max); };
+    size_t stack[64];
+    size_t stack_size = 0;
+    stack[stack_size ++] = 0;
+    while (stack_size > 0) {
+        const Node &node = m_nodes[stack[-- stack_size]];
+        if (! contains_bbox(node.bbox))
+            continue;
+        if (node.right == size_t(-1)) {
+            for (size_t i = node.begin; i < node.end; ++ i)
+                if (contains_bbox(m_bboxes[m_slices_sorted[i]]))
+                    out.emplace_back(m_slices_sorted[i]);
+        } else {
+            assert(stack_size + 2 <= 64);
+            stack[stack_size ++] = node.right;
+            stack[stack_size ++] = size_t(&node - m_nodes.data()) + 1;
+        }
+    }
+}
+
+bool InternalSlicesIndex::contains(const Polyline &travel) const
+{
+    if (m_slices.empty())
+        return false;
+    if (! travel.is_valid() || travel.length() == 0.)
+        // A degenerate travel is clipped away by ExPolygon::contains(), thus it is contained in any slice.
+        return true;
+
+    std::vector<size_t> slices;
+    this->candidates(get_extents(travel), slices);
+    if (slices.empty())
+        return false;
+    std::sort(slices.begin(), slices.end());
+
+    enum State : unsigned char {
+        // The travel does not touch the boundary of the slice, thus it is either completely inside or completely outside.
+        Untouched,
+        // The travel touches the boundary of the slice without crossing it, the slice is tested exactly.
+        Touched,
+        // The travel crosses the boundary of the slice, thus a part of the travel is outside the slice.
+        Crossed,
+    };
+    std::vector<State> state(slices.size(), Untouched);
+    const Point *p1 = nullptr;
+    const Point *p2 = nullptr;
+    auto visit_cell = [this, &slices, &state, &p1, &p2](coord_t row, coord_t col) {
+        auto cell_data     = m_grid.cell_data_range(row, col);
+        auto cell_segments = m_grid.cell_segments_range(row, col);
+        auto it_segment    = cell_segments.first;
+        for (auto it = cell_data.first; it != cell_data.second; ++ it, ++ it_segment) {
+            auto it_slice = std::lower_bound(slices.begin(), slices.end(), m_contour_slice[it->first]);
+            if (it_slice == slices.end() || *it_slice != m_contour_slice[it->first])
+                continue;
+            State &s = state[it_slice - slices.begin()];
+            if (s == Crossed)
+                continue;
+            int side1 = Geometry::segments_could_intersect(it_segment->a, it_segment->b, *p1, *p2);
+            int side2 = Geometry::segments_could_intersect(*p1, *p2, it_segment->a, it_segment->b);
+            if (side1 < 0 && side2 < 0)
+                s = Crossed;
+            else if (side1 <= 0 && side2 <= 0)
+                s = Touched;
+        }
+    };
+    // The line rasterization of the EdgeGrid may skip a cell, which a line touches at its corner only,
+    // therefore the cells around the rasterized cells are tested as well.
+    auto visitor = [this, &visit_cell](coord_t row, coord_t col) {
+        for (coord_t r = std::max<coord_t>(0, row - 1); r <= std::min<coord_t>(coord_t(m_grid_rows) - 1, row + 1); ++ r)
+            for (coord_t c = std::max<coord_t>(0, col - 1); c <= std::min<coord_t>(coord_t(m_grid_cols) - 1, col + 1); ++ c)
+                visit_cell(r, c);
+        return true;
+    };
+    for (size_t i = 1; i < travel.points.size(); ++ i) {
+        p1 = &travel.points[i - 1];
+        p2 = &travel.points[i];
+        m_grid.visit_cells_intersecting_line(*p1, *p2, visitor);
+    }
+
+    for (size_t i = 0; i < slices.size(); ++ i)
+        if (state[i] == Untouched ? m_slices[slices[i]].contains(travel.first_point()) :
+            state[i] == Touched   ? m_slices[slices[i]].contains(travel) : false)
+            return true;
+    return false;
+}
+
+} // namespace Slic3r
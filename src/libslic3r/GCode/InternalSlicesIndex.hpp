@@ -0,0 +1,59 @@
+#ifndef slic3r_GCode_InternalSlicesIndex_hpp_
+#define slic3r_GCode_InternalSlicesIndex_hpp_
+
+#include "../libslic3r.h"
+#include "../BoundingBox.hpp"
+#include "../EdgeGrid.hpp"
+#include "../ExPolygon.hpp"
+#include "../Polyline.hpp"
+
+namespace Slic3r {
+
+class Layer;
+
+// Search structure over the internal region slices of a layer, answering Layer::any_internal_region_slice_contains()
+// for the travel moves of GCode::needs_retraction() without clipping each travel with all the slices of the layer.
+// The slices are indexed by a bounding box hierarchy, their edges by an EdgeGrid. The travel is clipped exactly
+// only by the slices, whose boundary it touches without crossing.
+class InternalSlicesIndex
+{
+public:
+    // Index the internal slices of all the regions of a layer.
+    explicit InternalSlicesIndex(const Layer &layer);
+    explicit InternalSlicesIndex(ExPolygons slices) { this->create(std::move(slices)); }
+    // The edge grid references the contours of m_slices.
+    InternalSlicesIndex(const InternalSlicesIndex &) = delete;
+    InternalSlicesIndex& operator=(const InternalSlicesIndex &) = delete;
+
+    bool empty() const { return m_slices.empty(); }
+    // Same result as ExPolygon::contains(travel) for any of the indexed slices.
+    bool contains(const Polyline &travel) const;
+
+private:
+    void create(ExPolygons &&slices);
+    // Indices of the slices, whose bounding box contains the bounding box of a travel.
+    void candidates(const BoundingBox &bbox, std::vector<size_t> &out) const;
+
+    struct Node {
+        BoundingBox bbox;
+        // Range of m_slices_sorted for a leaf, otherwise children at idx + 1 and at right.
+        size_t      begin;
+        size_t      end;
+        size_t      right;
+    };
+
+    ExPolygons                m_slices;
+    std::vector<BoundingBox>  m_bboxes;
+    // Slice owning a contour of m_grid.
+    std::vector<size_t>       m_contour_slice;
+    // Bounding box hierarchy over the slices, the root is at index 0.
+    std::vector<size_t>       m_slices_sorted;
+    std::vector<Node>         m_nodes;
+    EdgeGrid::Grid            m_grid;
+    size_t                    m_grid_cols { 0 };
+    size_t                    m_grid_rows { 0 };
+};
+
+} // namespace Slic3r
+
+#endif // slic3r_GCode_InternalSlicesIndex_hpp_
@@ -66,6 +66,15 @@ void PressureEqualizer::reset()
     m_max_volumetric_extrusion_rate_slopes[erGapFill].negative = 0;
     m_max_volumetric_extrusion_rate_slopes[erGapFill].positive = 0;
 
+    m_roles_limited_negative.clear();
+    m_roles_limited_positive.clear();
+    for (size_t iRole = 1; iRole < numExtrusionRoles; ++ iRole) {
+        if (m_max_volumetric_extrusion_rate_slopes[iRole].negative != 0)
+            m_roles_limited_negative.emplace_back(iRole);
+        if (m_max_volumetric_extrusion_rate_slopes[iRole].positive != 0)
+            m_roles_limited_positive.emplace_back(iRole);
+    }
+
     m_stat.reset();
     line_idx = 0;
 }
@@ -456,7 +465,7 @@ void PressureEqualizer::output_gcode_line(GCodeLine &line)
 
 void PressureEqualizer::adjust_volumetric_rate()
 {
-    if (circular_buffer_items < 2)
+    if (circular_buffer_items < 2 || (m_roles_limited_negative.empty() && m_roles_limited_positive.empty()))
         return;
 
     // Go back from the current circular_buffer_pos and lower the feedtrate to decrease the slope of the extrusion rate changes.
@@ -483,11 +492,9 @@ void PressureEqualizer::adjust_volumetric_rate()
         // What is the gradient of the extrusion rate between idx_prev and idx?
         idx = idx_prev;
         GCodeLine &line = circular_buffer[idx];
-        for (size_t iRole = 1; iRole < numExtrusionRoles; ++ iRole) {
+        // Only the roles with a limited negative rate are considered.
+        for (size_t iRole : m_roles_limited_negative) {
             float rate_slope = m_max_volumetric_extrusion_rate_slopes[iRole].negative;
-            if (rate_slope == 0)
-                // The negative rate is unlimited.
-                continue;
             float rate_end = feedrate_per_extrusion_role[iRole];
             if (iRole == line.extrusion_role && rate_succ < rate_end)
                 // Limit by the succeeding volumetric flow rate.
@@ -532,11 +539,9 @@ void PressureEqualizer::adjust_volumetric_rate()
         // What is the gradient of the extrusion rate between idx_prev and idx?
         idx = idx_next;
         GCodeLine &line = circular_buffer[idx];
-        for (size_t iRole = 1; iRole < numExtrusionRoles; ++ iRole) {
+        // Only the roles with a limited positive rate are considered.
+        for (size_t iRole : m_roles_limited_positive) {
             float rate_slope = m_max_volumetric_extrusion_rate_slopes[iRole].positive;
-            if (rate_slope == 0)
-                // The positive rate is unlimited.
-                continue;
             float rate_start = feedrate_per_extrusion_role[iRole];
             if (iRole == line.extrusion_role && rate_prec < rate_start)
                 rate_start = rate_prec;
@@ -583,7 +588,7 @@ void PressureEqualizer::push_to_output(const char *text, const size_t len, bool
     // Resize the output buffer to a power of 2 higher than the required memory.
     if (output_buffer.size() < len_new) {
         size_t v = len_new;
-        // Compute the next highest power of 2 of 32-bit v
+        // Compute the next highest power of 2 of v
         // http://graphics.stanford.edu/~seander/bithacks.html
         v--;
         v |= v >> 1;
@@ -591,6 +596,8 @@ void PressureEqualizer::push_to_output(const char *text, const size_t len, bool
         v |= v >> 4;
         v |= v >> 8;
         v |= v >> 16;
+        if (sizeof(size_t) > 4)
+            v |= uint64_t(v) >> 32;
         v++;
         output_buffer.resize(v);
     }
@@ -22,6 +22,10 @@ public:
 
     size_t get_output_buffer_length() const { return output_buffer_length; }
 
+    // Process a next batch of G-code lines, return the processed G-code without measuring its length again.
+    std::string process_to_string(const char *szGCode, bool flush)
+        { const char *out = this->process(szGCode, flush); return std::string(out, output_buffer_length); }
+
 private:
     struct Statistics
     {
@@ -58,6 +62,10 @@ private:
     ExtrusionRateSlope              m_max_volumetric_extrusion_rate_slopes[numExtrusionRoles];
     float                           m_max_volumetric_extrusion_rate_slope_positive;
     float                           m_max_volumetric_extrusion_rate_slope_negative;
+    // Extrusion roles with a limited negative / positive slope, so that adjust_volumetric_rate() does not
+    // iterate over the roles with an unlimited slope for each line of the circular buffer.
+    std::vector<size_t>             m_roles_limited_negative;
+    std::vector<size_t>             m_roles_limited_positive;
     // Maximum segment length to split a long segment, if the initial and the final flow rate differ.
     float                           m_max_segment_length;
 
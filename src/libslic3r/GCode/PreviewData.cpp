@@ -3,7 +3,13 @@
 #include <I18N.hpp>
 #include "Utils.hpp"
 
+#include <cstring>
+#include <stdexcept>
+
 #include <boost/format.hpp>
+#include <boost/nowide/cstdio.hpp>
+
+#include <miniz.h>
 
 //! macro used to mark string used at localization, 
 #define L(s) (s)
@@ -485,6 +491,285 @@ size_t GCodePreviewData::memory_used() const
         sizeof(shell) + sizeof(ranges);
 }
 
+namespace PreviewSnapshot {
+    static const char     Magic[4] = { 'P', 'S', 'P', 'V' };
+    // To be increased with any change of the layout or of the types of the stored data.
+    static const uint32_t Version  = 1;
+
+    // Appends the plain values and arrays of plain values to a buffer, which is written to the file at once.
+    class Writer
+    {
+    public:
+        template<typename T> void value(const T &v) { m_data.append((const char*)&v, sizeof(T)); }
+        template<typename T> void array(const std::vector<T> &v)
+        {
+            this->value<uint64_t>(v.size());
+            if (! v.empty())
+                m_data.append((const char*)v.data(), v.size() * sizeof(T));
+        }
+        void range(float min, float max) { this->value(min); this->value(max); }
+        const std::string& data() const { return m_data; }
+    private:
+        std::string m_data;
+    };
+
+    // Reads the plain values and arrays of a snapshot loaded into memory, any read past the end of the data marks the snapshot as invalid.
+    class Reader
+    {
+    public:
+        Reader(const char *begin, const char *end) : m_ptr(begin), m_end(end) {}
+        template<typename T> T value()
+        {
+            T v{};
+            if (size_t(m_end - m_ptr) < sizeof(T))
+                m_valid = false;
+            else {
+                ::memcpy((void*)&v, m_ptr, sizeof(T));
+                m_ptr += sizeof(T);
+            }
+            return v;
+        }
+        template<typename T> void array(std::vector<T> &v)
+        {
+            uint64_t n = this->value<uint64_t>();
+            if (! m_valid || n > uint64_t(m_end - m_ptr) / sizeof(T)) {
+                m_valid = false;
+                return;
+            }
+            v.resize(size_t(n));
+            if (n > 0)
+                ::memcpy((void*)v.data(), m_ptr, size_t(n) * sizeof(T));
+            m_ptr += size_t(n) * sizeof(T);
+        }
+        // Number of elements of a container, which are at least min_size bytes each.
+        size_t count(size_t min_size)
+        {
+            uint64_t n = this->value<uint64_t>();
+            if (! m_valid || n > uint64_t(m_end - m_ptr) / min_size) {
+                m_valid = false;
+                return 0;
+            }
+            return size_t(n);
+        }
+        void range(GCodePreviewData::Range &range)
+        {
+            float min = this->value<float>();
+            float max = this->value<float>();
+            range.reset();
+            if (min <= max) {
+                range.update_from(min);
+                range.update_from(max);
+            }
+        }
+        bool valid() const { return m_valid && m_ptr == m_end; }
+        bool ok()    const { return m_valid; }
+    private:
+        const char *m_ptr;
+        const char *m_end;
+        bool        m_valid { true };
+    };
+}
+
+void GCodePreviewData::save_snapshot(const std::string &path, uint64_t inputs_hash) const
+{
+    PreviewSnapshot::Writer out;
+    out.value(PreviewSnapshot::Magic);
+    out.value(PreviewSnapshot::Version);
+    out.value(uint32_t(sizeof(coord_t)));
+    out.value(inputs_hash);
+
+    out.value(uint32_t(this->extrusion.role_flags));
+    for (const Color &color : this->extrusion.role_colors)
+        out.value(color.rgba);
+    out.range(this->ranges.height.min(), this->ranges.height.max());
+    out.range(this->ranges.width.min(), this->ranges.width.max());
+    out.range(this->ranges.feedrate.min(FeedrateKind::EXTRUSION), this->ranges.feedrate.max(FeedrateKind::EXTRUSION));
+    out.range(this->ranges.feedrate.min(FeedrateKind::TRAVEL), this->ranges.feedrate.max(FeedrateKind::TRAVEL));
+    out.range(this->ranges.fan_speed.min(), this->ranges.fan_speed.max());
+    out.range(this->ranges.volumetric_rate.min(), this->ranges.volumetric_rate.max());
+
+    out.value<uint64_t>(this->extrusion.layers.size());
+    for (const Extrusion::Layer &layer : this->extrusion.layers) {
+        out.value(layer.z);
+        out.value<uint64_t>(layer.paths.size());
+        for (const Extrusion::Path &path : layer.paths) {
+            out.value(uint8_t(path.extrusion_role));
+            out.value(path.mm3_per_mm);
+            out.value(path.width);
+            out.value(path.height);
+            out.value(path.feedrate);
+            out.value(path.extruder_id);
+            out.value(path.cp_color_id);
+            out.value(path.fan_speed);
+            out.array(path.polyline.points);
+        }
+    }
+    out.value<uint64_t>(this->travel.polylines.size());
+    for (const Travel::Polyline &polyline : this->travel.polylines) {
+        out.value(uint8_t(polyline.type));
+        out.value(uint8_t(polyline.direction));
+        out.value(polyline.feedrate);
+        out.value(uint32_t(polyline.extruder_id));
+        out.array(polyline.polyline.points);
+    }
+    for (const Retraction *retraction : { &this->retraction, &this->unretraction }) {
+        out.value<uint64_t>(retraction->positions.size());
+        for (const Retraction::Position &position : retraction->positions) {
+            out.value(position.position);
+            out.value(position.width);
+            out.value(position.height);
+        }
+    }
+    // The CRC of the payload detects a truncated or damaged snapshot.
+    out.value(uint32_t(mz_crc32(MZ_CRC32_INIT, (const unsigned char*)out.data().data(), out.data().size())));
+
+    FILE *file = boost::nowide::fopen(path.c_str(), "wb");
+    if (file == nullptr)
+        throw std::runtime_error(std::string("Failed to save the preview snapshot to ") + path + ".\nCannot open the file for writing.\n");
+    bool ok = ::fwrite(out.data().data(), 1, out.data().size(), file) == out.data().size();
+    ok &= ::fclose(file) == 0;
+    if (! ok) {
+        boost::nowide::remove(path.c_str());
+        throw std::runtime_error(std::string("Failed to save the preview snapshot to ") + path + ".\nIs the disk full?\n");
+    }
+}
+
+bool GCodePreviewData::load_snapshot(const std::string &path, uint64_t inputs_hash)
+{
+    // The snapshot is read at once and parsed in memory, the arrays of points are copied as they are.
+    std::string data;
+    {
+        FILE *file = boost::nowide::fopen(path.c_str(), "rb");
+        if (file == nullptr)
+            return false;
+        bool ok = ::fseek(file, 0, SEEK_END) == 0;
+        long size = ok ? ::ftell(file) : -1;
+        ok = size > 0 && ::fseek(file, 0, SEEK_SET) == 0;
+        if (ok) {
+            data.resize(size_t(size));
+            ok = ::fread(&data[0], 1, data.size(), file) == data.size();
+        }
+        ::fclose(file);
+        if (! ok || data.size() < sizeof(uint32_t))
+            return false;
+    }
+    size_t payload_size = data.size() - sizeof(uint32_t);
+    uint32_t crc;
+    ::memcpy(&crc, data.data() + payload_size, sizeof(uint32_t));
+    if (crc != uint32_t(mz_crc32(MZ_CRC32_INIT, (const unsigned char*)data.data(), payload_size)))
+        return false;
+
+    PreviewSnapshot::Reader in(data.data(), data.data() + payload_size);
+    auto magic = in.value<std::array<char, 4>>();
+    if (! in.ok() || ::memcmp(magic.data(), PreviewSnapshot::Magic, 4) != 0 ||
+        in.value<uint32_t>() != PreviewSnapshot::Version || in.value<uint32_t>() != sizeof(coord_t) || in.value<uint64_t>() != inputs_hash)
+        return false;
+
+    // Load into temporaries, so that this preview data is left unchanged if the snapshot is invalid.
+    // The visibility modes of the ranges and the other display settings are kept.
+    unsigned int            role_flags = in.value<uint32_t>();
+    Color                   role_colors[erCount];
+    for (Color &color : role_colors)
+        color.rgba = in.value<std::array<float, 4>>();
+    Ranges                  ranges = this->ranges;
+    in.range(ranges.height);
+    in.range(ranges.width);
+    ranges.feedrate.reset();
+    for (FeedrateKind kind : { FeedrateKind::EXTRUSION, FeedrateKind::TRAVEL }) {
+        float min = in.value<float>();
+        float max = in.value<float>();
+        if (min <= max) {
+            ranges.feedrate.update_from(min, kind);
+            ranges.feedrate.update_from(max, kind);
+        }
+    }
+    in.range(ranges.fan_speed);
+    in.range(ranges.volumetric_rate);
+
+    Extrusion::LayersList   layers;
+    size_t                  num_layers = in.count(sizeof(float) + sizeof(uint64_t));
+    layers.reserve(num_layers);
+    for (size_t i = 0; i < num_layers && in.ok(); ++ i) {
+        float z = in.value<float>();
+        layers.emplace_back(z, Extrusion::Paths());
+        Extrusion::Paths &paths = layers.back().paths;
+        paths.resize(in.count(1 + 5 * sizeof(float) + 2 * sizeof(uint32_t) + sizeof(uint64_t)));
+        for (Extrusion::Path &path : paths) {
+            uint8_t role = in.value<uint8_t>();
+            path.extrusion_role = role < erCount ? ExtrusionRole(role) : erNone;
+            path.mm3_per_mm     = in.value<float>();
+            path.width          = in.value<float>();
+            path.height         = in.value<float>();
+            path.feedrate       = in.value<float>();
+            path.extruder_id    = in.value<uint32_t>();
+            path.cp_color_id    = in.value<uint32_t>();
+            path.fan_speed      = in.value<float>();
+            in.array(path.polyline.points);
+            if (! in.ok())
+                return false;
+        }
+    }
+    Travel::PolylinesList   travels;
+    size_t                  num_travels = in.count(2 + sizeof(float) + sizeof(uint32_t) + sizeof(uint64_t));
+    travels.reserve(num_travels);
+    for (size_t i = 0; i < num_travels && in.ok(); ++ i) {
+        uint8_t      type        = in.value<uint8_t>();
+        uint8_t      direction   = in.value<uint8_t>();
+        float        feedrate    = in.value<float>();
+        unsigned int extruder_id = in.value<uint32_t>();
+        Polyline3    polyline;
+        in.array(polyline.points);
+        // GCodeAnalyzer stores the travel polylines with the direction Num_Directions.
+        if (type >= Travel::Num_Types || direction > Travel::Polyline::Num_Directions)
+            return false;
+        travels.emplace_back(Travel::EType(type), Travel::Polyline::EDirection(direction), feedrate, extruder_id, polyline);
+    }
+    Retraction::PositionsList retractions[2];
+    for (Retraction::PositionsList &positions : retractions) {
+        size_t num_positions = in.count(sizeof(Vec3crd) + 2 * sizeof(float));
+        positions.reserve(num_positions);
+        for (size_t i = 0; i < num_positions && in.ok(); ++ i) {
+            Vec3crd position = in.value<Vec3crd>();
+            float   width    = in.value<float>();
+            float   height   = in.value<float>();
+            positions.emplace_back(position, width, height);
+        }
+    }
+    if (! in.valid())
+        return false;
+
+    this->extrusion.role_flags = role_flags;
+    ::memcpy((void*)this->extrusion.role_colors, (const void*)role_colors, erCount * sizeof(Color));
+    this->ranges = ranges;
+    this->extrusion.layers       = std::move(layers);
+    this->travel.polylines       = std::move(travels);
+    this->retraction.positions   = std::move(retractions[0]);
+    this->unretraction.positions = std::move(retractions[1]);
+    return true;
+}
+
+uint64_t GCodePreviewData::gcode_file_hash(const std::string &gcode_path)
+{
+    FILE *file = boost::nowide::fopen(gcode_path.c_str(), "rb");
+    if (file == nullptr)
+        throw std::runtime_error(std::string("Cannot open ") + gcode_path + " for reading.");
+    std::vector<unsigned char> buffer(1024 * 1024);
+    mz_ulong crc  = MZ_CRC32_INIT;
+    uint64_t size = 0;
+    for (;;) {
+        size_t len = ::fread(buffer.data(), 1, buffer.size(), file);
+        if (len == 0)
+            break;
+        crc   = mz_crc32(crc, buffer.data(), len);
+        size += len;
+    }
+    bool error = ::ferror(file) != 0;
+    ::fclose(file);
+    if (error)
+        throw std::runtime_error(std::string("Failed reading ") + gcode_path);
+    return (uint64_t(uint32_t(crc)) << 32) | uint64_t(uint32_t(size));
+}
+
 const std::vector<std::string>& GCodePreviewData::ColorPrintColors()
 {
     static std::vector<std::string> color_print = {"#C0392B", "#E67E22", "#F1C40F", "#27AE60", "#1ABC9C", "#2980B9", "#9B59B6"};
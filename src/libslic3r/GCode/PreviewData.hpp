@@ -160,6 +160,10 @@ public:
             mode.set(static_cast<std::size_t>(range_type_value), enable);
         }
 
+        // Interval of a single range type independent of the mode, FLT_MAX / -FLT_MAX if empty.
+        float min(EnumRangeType range_type_value) const { return bounds[static_cast<std::size_t>(range_type_value)].min; }
+        float max(EnumRangeType range_type_value) const { return bounds[static_cast<std::size_t>(range_type_value)].max; }
+
         private:
 
         // Interval bounds
@@ -389,6 +393,17 @@ public:
     // Return an estimate of the memory consumed by the time estimator.
     size_t memory_used() const;
 
+    // Snapshot of the extrusion paths, travels, retractions, role colors and ranges for re-opening the preview of an exported G-code
+    // without slicing and exporting it again. The snapshot is a local cache in the native byte order, it is only loaded if inputs_hash matches
+    // the hash it was saved with. save_snapshot() throws std::runtime_error on failure, load_snapshot() returns false if the snapshot
+    // is missing, outdated or corrupted and leaves this preview data unchanged.
+    void save_snapshot(const std::string &path, uint64_t inputs_hash) const;
+    bool load_snapshot(const std::string &path, uint64_t inputs_hash);
+    // Path of the snapshot stored next to the exported G-code.
+    static std::string snapshot_path(const std::string &gcode_path) { return gcode_path + ".preview"; }
+    // Hash of the content of the exported G-code, which is the sole input of GCodeAnalyzer::calc_gcode_preview_data().
+    static uint64_t gcode_file_hash(const std::string &gcode_path);
+
     static const std::vector<std::string>& ColorPrintColors();
 };
 
@@ -437,10 +437,9 @@ void ToolOrdering::collect_extruder_statistics(bool prime_multi_material)
         }
 
     m_all_printing_extruders.clear();
-    for (const auto &lt : m_layer_tools) {
+    for (const auto &lt : m_layer_tools)
         append(m_all_printing_extruders, lt.extruders);
-        sort_remove_duplicates(m_all_printing_extruders);
-    }
+    sort_remove_duplicates(m_all_printing_extruders);
 
     if (prime_multi_material && ! m_all_printing_extruders.empty()) {
         // Reorder m_all_printing_extruders in the sequence they will be primed, the last one will be m_first_printing_extruder.
@@ -579,8 +578,10 @@ float WipingExtrusions::mark_wiping_extrusions(const Print& print, unsigned int
         return std::max(0.f, volume_to_wipe); // Soluble filament cannot be wiped in a random infill, neither the filament after it
 
     // we will sort objects so that dedicated for wiping are at the beginning:
+    // (a stable partition keeps the order of the objects otherwise, a comparator returning a->config().wipe_into_objects
+    // does not impose a strict weak ordering as required by std::sort)
     PrintObjectPtrs object_list = print.objects();
-    std::sort(object_list.begin(), object_list.end(), [](const PrintObject* a, const PrintObject* b) { return a->config().wipe_into_objects; });
+    std::stable_partition(object_list.begin(), object_list.end(), [](const PrintObject* object) { return object->config().wipe_into_objects; });
 
     // We will now iterate through
     //  - first the dedicated objects to mark perimeters or infills (depending on infill_first)
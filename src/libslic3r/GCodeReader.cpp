@@ -1,6 +1,11 @@
 #include "GCodeReader.hpp"
+#include "GCode/BinaryGCode.hpp"
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/split.hpp>
+#include <boost/nowide/cstdio.hpp>
+#include <boost/nowide/fstream.hpp>
+#include <cassert>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <iomanip>
@@ -54,7 +59,7 @@ const char* GCodeReader::parse_line_internal(const char *ptr, GCodeLine &gline,
             if (axis != NUM_AXES) {
                 // Try to parse the numeric value.
                 char   *pend = nullptr;
-                double  v = strtod(++ c, &pend);
+                double  v = parse_float(++ c, &pend);
                 if (pend != nullptr && is_end_of_word(*pend)) {
                     // The axis value has been parsed correctly.
                     gline.m_axis[int(axis)] = float(v);
@@ -98,7 +103,8 @@ void GCodeReader::update_coordinates(GCodeLine &gline, std::pair<const char*, co
     PROFILE_FUNC();
     if (*command.first == 'G') {
         int cmd_len = int(command.second - command.first);
-        if ((cmd_len == 2 && (command.first[1] == '0' || command.first[1] == '1')) ||
+        // G0, G1, the G2 / G3 arcs and G92.
+        if ((cmd_len == 2 && command.first[1] >= '0' && command.first[1] <= '3') ||
             (cmd_len == 3 &&  command.first[1] == '9' && command.first[2] == '2')) {
             for (size_t i = 0; i < NUM_AXES; ++ i)
                 if (gline.has(Axis(i)))
@@ -107,12 +113,107 @@ void GCodeReader::update_coordinates(GCodeLine &gline, std::pair<const char*, co
     }
 }
 
+double GCodeReader::parse_float(const char *c, char **pend)
+{
+    // Powers of ten exactly representable by a double.
+    static const double pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+    const char *p = c;
+    bool negative = *p == '-';
+    if (*p == '-' || *p == '+')
+        ++ p;
+    uint64_t mantissa   = 0;
+    int      num_digits = 0;
+    int      num_decimals = 0;
+    for (; *p >= '0' && *p <= '9'; ++ p, ++ num_digits)
+        mantissa = mantissa * 10 + uint64_t(*p - '0');
+    if (*p == '.')
+        for (++ p; *p >= '0' && *p <= '9'; ++ p, ++ num_digits, ++ num_decimals)
+            mantissa = mantissa * 10 + uint64_t(*p - '0');
+    // Both the mantissa and the power of ten are represented by a double exactly, therefore their quotient
+    // is correctly rounded and equal to the result of strtod(). Anything else (exponents, hexadecimal numbers,
+    // infinities, too many digits, invalid numbers) is left to strtod().
+    if (num_digits == 0 || num_digits > 15 || num_decimals > 22 || ! is_end_of_word(*p))
+        return strtod(c, pend);
+    double v = double(mantissa) / pow10[num_decimals];
+    *pend = const_cast<char*>(p);
+    return negative ? - v : v;
+}
+
+void GCodeReader::parse_lines(const char *ptr, const char *ptr_end, GCodeLine &gline, callback_t &callback)
+{
+    assert(*ptr_end == 0);
+    while (ptr < ptr_end) {
+        gline.reset();
+        const char *next = this->parse_line(ptr, gline, callback);
+        if (*next == 0 && next < ptr_end) {
+            // Zero byte inside a line, ignore the rest of the line as std::getline() + parse_line() did.
+            next = (const char*)memchr(next, '\n', ptr_end - next);
+            next = (next == nullptr) ? ptr_end : next + 1;
+        }
+        ptr = next;
+    }
+}
+
+void GCodeReader::parse_binary_file(const std::string &file, callback_t &callback)
+{
+    FILE *f = boost::nowide::fopen(file.c_str(), "rb");
+    if (f == nullptr)
+        return;
+    try {
+        BinaryGCode::Decoder   decoder(f);
+        BinaryGCode::BlockType type;
+        std::string            data;
+        GCodeLine              gline;
+        // The G-code blocks contain complete lines.
+        while (decoder.read_block(type, data))
+            if (type == BinaryGCode::BlockType::GCode)
+                this->parse_lines(data.c_str(), data.c_str() + data.size(), gline, callback);
+    } catch (...) {
+        fclose(f);
+        throw;
+    }
+    fclose(f);
+}
+
 void GCodeReader::parse_file(const std::string &file, callback_t callback)
 {
-    std::ifstream f(file);
-    std::string line;
-    while (std::getline(f, line))
-        this->parse_line(line, callback);
+    if (BinaryGCode::is_binary_gcode(file)) {
+        this->parse_binary_file(file, callback);
+        return;
+    }
+
+    // Read the file in large blocks and parse the complete lines in place, so that the file is not split
+    // into a temporary std::string line by line. A partial line at the end of a block is carried over to the next one.
+    static const size_t block_size = 4 * 1024 * 1024;
+    boost::nowide::ifstream f(file, std::ios::in | std::ios::binary);
+    if (! f.good())
+        return;
+    std::string buffer;
+    GCodeLine   gline;
+    for (;;) {
+        size_t carry = buffer.size();
+        buffer.resize(carry + block_size);
+        f.read(&buffer[carry], block_size);
+        buffer.resize(carry + size_t(f.gcount()));
+        bool eof = ! f.good();
+        // Parse up to the last end of line, or the rest of the file at the end of file.
+        size_t end = buffer.size();
+        if (! eof) {
+            size_t last_eol = buffer.rfind('\n');
+            if (last_eol == std::string::npos)
+                // No end of line in the whole block, read more.
+                continue;
+            end = last_eol + 1;
+        }
+        char  saved = buffer[end];
+        buffer[end] = 0;
+        this->parse_lines(buffer.c_str(), buffer.c_str() + end, gline, callback);
+        if (eof)
+            break;
+        buffer[end] = saved;
+        buffer.erase(0, end);
+    }
 }
 
 bool GCodeReader::GCodeLine::has(char axis) const
@@ -154,7 +255,7 @@ bool GCodeReader::GCodeLine::has_value(char axis, float &value) const
         if (*c == axis) {
             // Try to parse the numeric value.
             char   *pend = nullptr;
-            double  v = strtod(++ c, &pend);
+            double  v = GCodeReader::parse_float(++ c, &pend);
             if (pend != nullptr && is_end_of_word(*pend)) {
                 // The axis value has been parsed correctly.
                 value = float(v);
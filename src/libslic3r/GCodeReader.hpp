@@ -105,6 +105,7 @@ public:
     void parse_line(const std::string &line, Callback callback)
         { GCodeLine gline; this->parse_line(line.c_str(), gline, callback); }
 
+    // Parses both the ASCII G-code and the binary G-code (see GCode/BinaryGCode.hpp).
     void parse_file(const std::string &file, callback_t callback);
 
     float& x()       { return m_position[X]; }
@@ -124,6 +125,13 @@ public:
 private:
     const char* parse_line_internal(const char *ptr, GCodeLine &gline, std::pair<const char*, const char*> &command);
     void        update_coordinates(GCodeLine &gline, std::pair<const char*, const char*> &command);
+    // Parse the lines from ptr to ptr_end, *ptr_end shall be zero.
+    void        parse_lines(const char *ptr, const char *ptr_end, GCodeLine &gline, callback_t &callback);
+    void        parse_binary_file(const std::string &file, callback_t &callback);
+
+    // Parses a floating point number as strtod() does. The plain fixed point numbers produced by G-code generators
+    // are converted without calling strtod(), with exactly the same result.
+    static double       parse_float(const char *c, char **pend);
 
     static bool         is_whitespace(char c)           { return c == ' ' || c == '\t'; }
     static bool         is_end_of_line(char c)          { return c == '\r' || c == '\n' || c == 0; }
@@ -1,4 +1,5 @@
 #include "GCodeSender.hpp"
+#include <algorithm>
 #include <iostream>
 #include <istream>
 #include <string>
@@ -48,12 +49,15 @@ std::fstream fs;
 #endif
 
 #define KEEP_SENT 20
+// number of lines the queue is preallocated for
+#define QUEUE_CAPACITY 4096
 
 namespace Slic3r {
 
 GCodeSender::GCodeSender()
     : io(), serial(io), can_send(false), sent(0), open(false), error(false),
-      connected(false), queue_paused(false)
+      connected(false), queue_paused(false), queue(QUEUE_CAPACITY),
+      rx_buffer_size(0), in_flight_bytes(0), writing(false)
 {
 #ifdef DEBUG_SERIAL
     std::srand(std::time(nullptr));
@@ -94,8 +98,17 @@ GCodeSender::connect(std::string devname, unsigned int baud_rate)
     }
     
     // a reset firmware expect line numbers to start again from 1
-    this->sent = 0;
-    this->last_sent.clear();
+    {
+        boost::lock_guard<boost::mutex> l(this->queue_mutex);
+        this->can_send = false;
+        this->sent = 0;
+        this->last_sent.clear();
+        this->in_flight.clear();
+        this->in_flight_bytes = 0;
+        this->writing = false;
+        this->write_data.clear();
+        this->write_pending.clear();
+    }
 
     /* Initialize debugger */
 #ifdef DEBUG_SERIAL
@@ -232,8 +245,7 @@ GCodeSender::purge_queue(bool priority)
         std::swap(this->priqueue, empty);
     } else {
         // clear queue
-        std::queue<std::string> empty;
-        std::swap(this->queue, empty);
+        this->queue.clear();
         this->queue_paused = false;
     }
 }
@@ -252,6 +264,16 @@ GCodeSender::purge_log()
     return retval;
 }
 
+void
+GCodeSender::set_rx_buffer_size(size_t size)
+{
+    {
+        boost::lock_guard<boost::mutex> l(this->queue_mutex);
+        this->rx_buffer_size = size;
+    }
+    this->send();
+}
+
 std::string
 GCodeSender::getT() const
 {
@@ -351,14 +373,12 @@ GCodeSender::on_read(const boost::system::error_code& error,
             {
                 boost::lock_guard<boost::mutex> l(this->queue_mutex);
                 this->can_send = true;
+                this->in_flight.clear();
+                this->in_flight_bytes = 0;
             }
             this->send();
         } else if (boost::starts_with(line, "ok")) {
-            {
-                boost::lock_guard<boost::mutex> l(this->queue_mutex);
-                this->can_send = true;
-            }
-            this->send();
+            this->on_ack();
         } else if (boost::istarts_with(line, "resend")  // Marlin uses "Resend: "
                 || boost::istarts_with(line, "rs")) {
             // extract the first number from line
@@ -390,6 +410,12 @@ GCodeSender::on_read(const boost::system::error_code& error,
                     // start resending with the requested line number
                     this->sent = toresend - 1;
                     this->can_send = true;
+                    
+                    // the firmware dropped the lines following the requested one,
+                    // and the lines not written yet are going to be resent
+                    this->in_flight.clear();
+                    this->in_flight_bytes = 0;
+                    this->write_pending.clear();
                 }
                 this->send();
             } else {
@@ -465,75 +491,118 @@ GCodeSender::do_send()
 {
     boost::lock_guard<boost::mutex> l(this->queue_mutex);
     
-    // printer is not connected or we're still waiting for the previous ack
+    // printer is not connected
     if (!this->can_send) return;
     
-    std::string line;
-    while (!this->priqueue.empty() || (!this->queue.empty() && !this->queue_paused)) {
-        if (!this->priqueue.empty()) {
-            line = this->priqueue.front();
-            this->priqueue.pop_front();
-        } else {
-            line = this->queue.front();
-            this->queue.pop();
+    for (;;) {
+        // peek the next line, it is only removed from the queue once it fits into the receive buffer
+        std::string *line = nullptr;
+        bool from_priqueue = false;
+        while (!this->priqueue.empty() || (!this->queue.empty() && !this->queue_paused)) {
+            from_priqueue = !this->priqueue.empty();
+            line = from_priqueue ? &this->priqueue.front() : &this->queue.front();
+            
+            // strip comments
+            size_t comment_pos = line->find_first_of(';');
+            if (comment_pos != std::string::npos)
+                line->erase(comment_pos, std::string::npos);
+            boost::algorithm::trim(*line);
+            
+            // if line is not empty, send it
+            if (!line->empty()) break;
+            // if line is empty, process next item in queue
+            if (from_priqueue)
+                this->priqueue.pop_front();
+            else
+                this->queue.pop();
+            line = nullptr;
         }
+        if (line == nullptr) break;
         
-        // strip comments
-        size_t comment_pos = line.find_first_of(';');
-        if (comment_pos != std::string::npos)
-            line.erase(comment_pos, std::string::npos);
-        boost::algorithm::trim(line);
-        
-        // if line is not empty, send it
-        if (!line.empty()) break;
-        // if line is empty, process next item in queue
-    }
-    if (line.empty()) return;
-    
-    // compute full line
-    ++ this->sent;
+        // compute full line
 #ifndef DEBUG_SERIAL
-    const auto line_num = this->sent;
+        const auto line_num = this->sent + 1;
 #else
-    // In DEBUG_SERIAL mode, test line re-synchronization by sending bad line number 1/4 of the time
-    const auto line_num = std::rand() < RAND_MAX/4 ? 0 : this->sent;
+        // In DEBUG_SERIAL mode, test line re-synchronization by sending bad line number 1/4 of the time
+        const auto line_num = std::rand() < RAND_MAX/4 ? 0 : this->sent + 1;
 #endif
-    std::string full_line = "N" + boost::lexical_cast<std::string>(line_num) + " " + line;
-    
-    // calculate checksum
-    int cs = 0;
-    for (std::string::const_iterator it = full_line.begin(); it != full_line.end(); ++it)
-       cs = cs ^ *it;
-    
-    // write line to device
-    full_line += "*";
-    full_line += boost::lexical_cast<std::string>(cs);
-    full_line += "\n";
-    
+        std::string full_line = "N" + boost::lexical_cast<std::string>(line_num) + " " + *line;
+        
+        // calculate checksum
+        int cs = 0;
+        for (std::string::const_iterator it = full_line.begin(); it != full_line.end(); ++it)
+           cs = cs ^ *it;
+        
+        full_line += "*";
+        full_line += boost::lexical_cast<std::string>(cs);
+        full_line += "\n";
+        
+        // we're still waiting for the acknowledgement of the previous lines
+        if (!this->fits_in_flight(full_line.size())) break;
+        
 #ifdef DEBUG_SERIAL
-    fs << ">> " << full_line << std::flush;
+        fs << ">> " << full_line << std::flush;
 #endif
-    
-    this->last_sent.push_back(line);
-    this->can_send = false;
-    
-    while (this->last_sent.size() > KEEP_SENT) {
-        this->last_sent.pop_front();
+        
+        ++ this->sent;
+        this->last_sent.push_back(*line);
+        while (this->last_sent.size() > KEEP_SENT) {
+            this->last_sent.pop_front();
+        }
+        if (from_priqueue)
+            this->priqueue.pop_front();
+        else
+            this->queue.pop();
+        
+        this->in_flight.push_back(full_line.size());
+        this->in_flight_bytes += full_line.size();
+        this->write_pending += full_line;
     }
     
-    // we can't supply boost::asio::buffer(full_line) to async_write() because full_line is on the
-    // stack and the buffer would lose its underlying storage causing memory corruption
-    std::ostream os(&this->write_buffer);
-    os << full_line;
-    boost::asio::async_write(this->serial, this->write_buffer, boost::bind(&GCodeSender::on_write, this, boost::asio::placeholders::error,
+    // write the lines to device, unless the previous write is still in progress
+    if (this->writing || this->write_pending.empty()) return;
+    // write_data keeps the underlying storage of the buffer until the write completes
+    this->write_data.swap(this->write_pending);
+    this->write_pending.clear();
+    this->writing = true;
+    boost::asio::async_write(this->serial, boost::asio::buffer(this->write_data), boost::bind(&GCodeSender::on_write, this, boost::asio::placeholders::error,
                 boost::asio::placeholders::bytes_transferred));
 }
 
+bool
+GCodeSender::fits_in_flight(size_t length) const
+{
+    // a line is always sent once all the previous ones were acknowledged, even if it is longer than the buffer
+    if (this->in_flight.empty()) return true;
+    // keep all the lines in flight in last_sent, so that they may be resent
+    return this->rx_buffer_size > 0
+        && this->in_flight.size() < KEEP_SENT
+        && this->in_flight_bytes + length <= this->rx_buffer_size;
+}
+
+void
+GCodeSender::on_ack()
+{
+    {
+        boost::lock_guard<boost::mutex> l(this->queue_mutex);
+        // the oldest line in flight was processed and removed from the receive buffer of the firmware
+        if (!this->in_flight.empty()) {
+            this->in_flight_bytes -= this->in_flight.front();
+            this->in_flight.pop_front();
+        }
+    }
+    this->send();
+}
+
 void
 GCodeSender::on_write(const boost::system::error_code& error,
     size_t bytes_transferred)
 {
     this->set_error_status(false);
+    {
+        boost::lock_guard<boost::mutex> l(this->queue_mutex);
+        this->writing = false;
+    }
     if (error) {
         if (this->open) {
             this->do_close();
@@ -545,6 +614,27 @@ GCodeSender::on_write(const boost::system::error_code& error,
     this->do_send();
 }
 
+void
+GCodeSender::LineRing::push(const std::string &line)
+{
+    if (this->count == this->lines.size()) {
+        // grow the ring, moving the queued lines to the start of the storage
+        std::rotate(this->lines.begin(), this->lines.begin() + this->head, this->lines.end());
+        this->head = 0;
+        this->lines.resize(std::max<size_t>(2 * this->lines.size(), 16));
+    }
+    // assign() reuses the storage of the line sent from this slot before
+    this->lines[(this->head + this->count) % this->lines.size()].assign(line);
+    ++ this->count;
+}
+
+void
+GCodeSender::LineRing::pop()
+{
+    this->head = (this->head + 1) % this->lines.size();
+    -- this->count;
+}
+
 void
 GCodeSender::set_DTR(bool on)
 {
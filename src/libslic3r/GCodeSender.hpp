@@ -33,25 +33,56 @@ class GCodeSender : private boost::noncopyable {
     std::string getB() const;
     void set_DTR(bool on);
     void reset();
+    // Size of the receive buffer of the firmware (for example 128 for Marlin, 127 bytes usable).
+    // If non-zero, the lines are streamed as long as the unacknowledged ones fit into the buffer
+    // (character counting), otherwise each line waits for the "ok" of the previous one.
+    void set_rx_buffer_size(size_t size);
     
     private:
+    // FIFO of the lines to be sent. The slots are reused once sent, so that streaming a G-code
+    // does not allocate a string per line once the ring has grown to its working size.
+    class LineRing {
+        public:
+        explicit LineRing(size_t capacity) : lines(capacity), head(0), count(0) {}
+        bool empty() const { return this->count == 0; }
+        size_t size() const { return this->count; }
+        std::string& front() { return this->lines[this->head]; }
+        void push(const std::string &line);
+        void pop();
+        void clear() { this->head = 0; this->count = 0; }
+        
+        private:
+        std::vector<std::string> lines;
+        size_t head;
+        size_t count;
+    };
+    
+
     asio::io_service io;
     asio::serial_port serial;
     boost::thread background_thread;
-    boost::asio::streambuf read_buffer, write_buffer;
+    boost::asio::streambuf read_buffer;
     bool open;      // whether the serial socket is connected
     bool connected; // whether the printer is online
     bool error;
     mutable boost::mutex error_mutex;
     
-    // this mutex guards queue, priqueue, can_send, queue_paused, sent, last_sent
+    // this mutex guards queue, priqueue, can_send, queue_paused, sent, last_sent,
+    // rx_buffer_size, in_flight, in_flight_bytes, writing, write_data, write_pending
     mutable boost::mutex queue_mutex;
-    std::queue<std::string> queue;
+    LineRing queue;
     std::list<std::string> priqueue;
     bool can_send;
     bool queue_paused;
     size_t sent;
     std::deque<std::string> last_sent;
+    size_t rx_buffer_size;
+    // lengths of the lines sent but not acknowledged yet, the oldest first
+    std::deque<size_t> in_flight;
+    size_t in_flight_bytes;
+    // the lines are formatted into write_pending while write_data is being written
+    bool writing;
+    std::string write_data, write_pending;
     
     // this mutex guards log, T, B
     mutable boost::mutex log_mutex;
@@ -61,6 +92,8 @@ class GCodeSender : private boost::noncopyable {
     void set_baud_rate(unsigned int baud_rate);
     void set_error_status(bool e);
     void do_send();
+    bool fits_in_flight(size_t length) const;
+    void on_ack();
     void on_write(const boost::system::error_code& error, size_t bytes_transferred);
     void do_close();
     void do_read();
@@ -1,5 +1,6 @@
 #include "GCodeTimeEstimator.hpp"
 #include "Utils.hpp"
+#include "GCode/ArcFitter.hpp"
 #include <boost/bind.hpp>
 #include <cmath>
 
@@ -24,6 +25,13 @@ static const float DEFAULT_MINIMUM_TRAVEL_FEEDRATE = 0.0f; // from Prusa Firmwar
 static const float DEFAULT_EXTRUDE_FACTOR_OVERRIDE_PERCENTAGE = 1.0f; // 100 percent
 
 static const float PREVIOUS_FEEDRATE_THRESHOLD = 0.0001f;
+// Length of the line segments, into which the G2 / G3 arcs are split, from Marlin (Configuration_adv.h)
+static const float ARC_SEGMENT_LENGTH = 1.0f;
+// Number of blocks collected by the planner before the blocks not influenced by the blocks to come are finalized.
+static const size_t PLANNER_BATCH_BLOCKS = 256;
+// Maximum number of blocks of the planner window. Long sequences of short blocks (arcs, curves), which never reach their nominal speed,
+// are cut at this length as if the planner buffer was flushed, similarly to the firmware with its much shorter buffer.
+static const size_t PLANNER_MAX_BLOCKS = 4096;
 
 #if ENABLE_MOVE_STATS
 static const std::string MOVE_TYPE_STR[Slic3r::GCodeTimeEstimator::Block::Num_Types] =
@@ -78,7 +86,7 @@ namespace Slic3r {
         return ::sqrt(value);
     }
 
-    GCodeTimeEstimator::Block::Block()
+    GCodeTimeEstimator::Block::Block() : g1_line_id_idx(-1)
     {
     }
 
@@ -168,10 +176,9 @@ namespace Slic3r {
     }
 #endif // ENABLE_MOVE_STATS
 
-    const std::string GCodeTimeEstimator::Normal_First_M73_Output_Placeholder_Tag = "; _TE_NORMAL_FIRST_M73_OUTPUT_PLACEHOLDER";
-    const std::string GCodeTimeEstimator::Silent_First_M73_Output_Placeholder_Tag = "; _TE_SILENT_FIRST_M73_OUTPUT_PLACEHOLDER";
-    const std::string GCodeTimeEstimator::Normal_Last_M73_Output_Placeholder_Tag = "; _TE_NORMAL_LAST_M73_OUTPUT_PLACEHOLDER";
-    const std::string GCodeTimeEstimator::Silent_Last_M73_Output_Placeholder_Tag = "; _TE_SILENT_LAST_M73_OUTPUT_PLACEHOLDER";
+    // Long enough for "M73 Q100 S" followed by the remaining minutes.
+    const size_t GCodeTimeEstimator::M73_Line_Length = 24;
+    const std::string GCodeTimeEstimator::Reserved_M73_Line = ";" + std::string(GCodeTimeEstimator::M73_Line_Length - 2, ' ') + "\n";
 
     const std::string GCodeTimeEstimator::Color_Change_Tag = "PRINT_COLOR_CHANGE";
 
@@ -202,14 +209,9 @@ namespace Slic3r {
         }
     }
 
-    void GCodeTimeEstimator::calculate_time(bool start_from_beginning)
+    void GCodeTimeEstimator::calculate_time()
     {
         PROFILE_FUNC();
-        if (start_from_beginning)
-        {
-            _reset_time();
-            m_last_st_synchronized_block_id = -1;
-        }
         _calculate_time();
 
         if (m_needs_color_times && (m_color_time_cache != 0.0f))
@@ -271,143 +273,96 @@ namespace Slic3r {
 #endif // ENABLE_MOVE_STATS
     }
 
-    bool GCodeTimeEstimator::post_process(const std::string& filename, float interval_sec, const PostProcessData* const normal_mode, const PostProcessData* const silent_mode)
+    static int fseek_64(FILE* file, size_t offset)
     {
-        boost::nowide::ifstream in(filename);
-        if (!in.good())
-            throw std::runtime_error(std::string("Time estimator post process export failed.\nCannot open file for reading.\n"));
+#ifdef _WIN32
+        return ::_fseeki64(file, (__int64)offset, SEEK_SET);
+#else
+        return ::fseeko(file, (off_t)offset, SEEK_SET);
+#endif
+    }
 
-        std::string path_tmp = filename + ".postprocess";
+    bool GCodeTimeEstimator::post_process(const std::string& filename, float interval_sec, const ReservedM73Lines& reserved_lines, const PostProcessData* const normal_mode, const PostProcessData* const silent_mode)
+    {
+        if ((normal_mode == nullptr) && (silent_mode == nullptr))
+            return true;
 
-        FILE* out = boost::nowide::fopen(path_tmp.c_str(), "wb");
-        if (out == nullptr)
+        // the lines M73 are written in place of the lines reserved while exporting the gcode, the rest of the file is left untouched
+        FILE* file = boost::nowide::fopen(filename.c_str(), "r+b");
+        if (file == nullptr)
             throw std::runtime_error(std::string("Time estimator post process export failed.\nCannot open file for writing.\n"));
 
-        std::string normal_time_mask = "M73 P%s R%s\n";
-        std::string silent_time_mask = "M73 Q%s S%s\n";
+        std::string normal_time_mask = "M73 P%s R%s";
+        std::string silent_time_mask = "M73 Q%s S%s";
         char line_M73[64];
 
-        std::string gcode_line;
-        // buffer line to export only when greater than 64K to reduce writing calls
-        std::string export_line;
+        // indices into the g1 line ids and remaining times of the last exported lines M73, for both modes
+        size_t g1_line_id[2] = { 0, 0 };
+        float last_recorded_time[2] = { 0.0f, 0.0f };
 
-        // helper function to write to disk
-        auto write_string = [&](const std::string& str) {
-            fwrite((const void*)export_line.c_str(), 1, export_line.length(), out);
-            if (ferror(out))
-            {
-                in.close();
-                fclose(out);
-                boost::nowide::remove(path_tmp.c_str());
-                throw std::runtime_error(std::string("Time estimator post process export failed.\nIs the disk full?\n"));
-            }
-            export_line.clear();
-        };
-
-        GCodeReader parser;
-        unsigned int g1_lines_count = 0;
-        int normal_g1_line_id = 0;
-        float normal_last_recorded_time = 0.0f;
-        int silent_g1_line_id = 0;
-        float silent_last_recorded_time = 0.0f;
-
-        // helper function to process g1 lines
-        auto process_g1_line = [&](const PostProcessData* const data, const GCodeReader::GCodeLine& line, int& g1_line_id, float& last_recorded_time, const std::string& time_mask) {
+        for (const ReservedM73Line& reserved : reserved_lines)
+        {
+            const PostProcessData* const data = (reserved.mode == Normal) ? normal_mode : silent_mode;
             if (data == nullptr)
-                return;
+                continue;
 
-            assert((g1_line_id >= (int)data->g1_line_ids.size()) || (data->g1_line_ids[g1_line_id].first >= g1_lines_count));
-            const Block* block = nullptr;
-            if (g1_line_id < (int)data->g1_line_ids.size())
+            const std::string& time_mask = (reserved.mode == Normal) ? normal_time_mask : silent_time_mask;
+            line_M73[0] = 0;
+            if (reserved.g1_line_id == 0)
+                // initial line M73
+                sprintf(line_M73, time_mask.c_str(), "0", _get_time_minutes(data->time).c_str());
+            else
             {
-                const G1LineIdToBlockId& map_item = data->g1_line_ids[g1_line_id];
-                if (map_item.first == g1_lines_count)
-                {
-                    if (line.has_e() && (map_item.second < (unsigned int)data->blocks.size()))
-                        block = &data->blocks[map_item.second];
-                    ++g1_line_id;
-                }
-            }
+                // the reserved lines are sorted by their g1 line ids
+                size_t& id = g1_line_id[reserved.mode];
+                while ((id < data->g1_line_ids.size()) && (data->g1_line_ids[id].first < reserved.g1_line_id))
+                    ++id;
 
-            if ((block != nullptr) && (block->elapsed_time != -1.0f))
-            {
-                float block_remaining_time = data->time - block->elapsed_time;
-                if (std::abs(last_recorded_time - block_remaining_time) > interval_sec)
+                if ((id < data->g1_line_ids.size()) && (data->g1_line_ids[id].first == reserved.g1_line_id))
                 {
-                    sprintf(line_M73, time_mask.c_str(), std::to_string((int)(100.0f * block->elapsed_time / data->time)).c_str(), _get_time_minutes(block_remaining_time).c_str());
-                    gcode_line += line_M73;
-
-                    last_recorded_time = block_remaining_time;
+                    float elapsed_time = data->g1_line_ids[id].second;
+                    if (elapsed_time != -1.0f)
+                    {
+                        float block_remaining_time = data->time - elapsed_time;
+                        if (std::abs(last_recorded_time[reserved.mode] - block_remaining_time) > interval_sec)
+                        {
+                            sprintf(line_M73, time_mask.c_str(), std::to_string((int)(100.0f * elapsed_time / data->time)).c_str(), _get_time_minutes(block_remaining_time).c_str());
+                            last_recorded_time[reserved.mode] = block_remaining_time;
+                        }
+                    }
                 }
             }
-        };
-
-        while (std::getline(in, gcode_line))
-        {
-            if (!in.good())
-            {
-                fclose(out);
-                throw std::runtime_error(std::string("Time estimator post process export failed.\nError while reading from file.\n"));
-            }
 
-            // check tags
-            // remove color change tag
-            if (gcode_line == "; " + Color_Change_Tag)
+            // unused reserved lines are left as empty comments
+            if (line_M73[0] == 0)
                 continue;
 
-            // replaces placeholders for initial line M73 with the real lines
-            if ((normal_mode != nullptr) && (gcode_line == Normal_First_M73_Output_Placeholder_Tag))
+            std::string gcode_line = line_M73;
+            assert(gcode_line.length() < M73_Line_Length);
+            gcode_line.resize(M73_Line_Length - 1, ' ');
+            gcode_line += "\n";
+            if ((fseek_64(file, reserved.offset) != 0) || (::fwrite((const void*)gcode_line.c_str(), 1, gcode_line.length(), file) != gcode_line.length()))
             {
-                sprintf(line_M73, normal_time_mask.c_str(), "0", _get_time_minutes(normal_mode->time).c_str());
-                gcode_line = line_M73;
-            }
-            else if ((silent_mode != nullptr) && (gcode_line == Silent_First_M73_Output_Placeholder_Tag))
-            {
-                sprintf(line_M73, silent_time_mask.c_str(), "0", _get_time_minutes(silent_mode->time).c_str());
-                gcode_line = line_M73;
-            }
-            // replaces placeholders for final line M73 with the real lines
-            else if ((normal_mode != nullptr) && (gcode_line == Normal_Last_M73_Output_Placeholder_Tag))
-            {
-                sprintf(line_M73, normal_time_mask.c_str(), "100", "0");
-                gcode_line = line_M73;
-            }
-            else if ((silent_mode != nullptr) && (gcode_line == Silent_Last_M73_Output_Placeholder_Tag))
-            {
-                sprintf(line_M73, silent_time_mask.c_str(), "100", "0");
-                gcode_line = line_M73;
+                fclose(file);
+                throw std::runtime_error(std::string("Time estimator post process export failed.\nIs the disk full?\n"));
             }
-            else
-                gcode_line += "\n";
-
-            // add remaining time lines where needed
-            parser.parse_line(gcode_line,
-                [&](GCodeReader& reader, const GCodeReader::GCodeLine& line)
-                {
-                    if (line.cmd_is("G1"))
-                    {
-                        ++g1_lines_count;
-                        process_g1_line(silent_mode, line, silent_g1_line_id, silent_last_recorded_time, silent_time_mask);
-                        process_g1_line(normal_mode, line, normal_g1_line_id, normal_last_recorded_time, normal_time_mask);
-                    }
-                });
-
-            export_line += gcode_line;
-            if (export_line.length() > 65535)
-                write_string(export_line);
         }
 
-        if (!export_line.empty())
-            write_string(export_line);
+        if (fclose(file) != 0)
+            throw std::runtime_error(std::string("Time estimator post process export failed.\nIs the disk full?\n"));
 
-        fclose(out);
-        in.close();
+        return true;
+    }
 
-        if (rename_file(path_tmp, filename))
-            throw std::runtime_error(std::string("Failed to rename the output G-code file from ") + path_tmp + " to " + filename + '\n' +
-                "Is " + path_tmp + " locked?" + '\n');
+    bool GCodeTimeEstimator::is_g1_line(const GCodeReader::GCodeLine& line)
+    {
+        // the same test as in _process_gcode_line(), the G2 / G3 arcs are assigned a g1 line id as well
+        std::string cmd = line.cmd();
+        if ((cmd.length() < 2) || (::toupper(cmd[0]) != 'G'))
+            return false;
 
-        return true;
+        int code = ::atoi(&cmd[1]);
+        return (code == 1) || (code == 2) || (code == 3);
     }
 
     void GCodeTimeEstimator::set_axis_position(EAxis axis, float position)
@@ -759,7 +714,7 @@ namespace Slic3r {
     {
         size_t out = sizeof(*this);
 		out += SLIC3R_STDVEC_MEMSIZE(this->m_blocks, Block);
-		out += SLIC3R_STDVEC_MEMSIZE(this->m_g1_line_ids, G1LineIdToBlockId);
+		out += SLIC3R_STDVEC_MEMSIZE(this->m_g1_line_ids, G1LineIdToElapsedTime);
         return out;
     }
 
@@ -784,8 +739,6 @@ namespace Slic3r {
         reset_g1_line_id();
         m_g1_line_ids.clear();
 
-        m_last_st_synchronized_block_id = -1;
-
         m_needs_color_times = false;
         m_color_times.clear();
         m_color_time_cache = 0.0f;
@@ -799,27 +752,74 @@ namespace Slic3r {
     void GCodeTimeEstimator::_reset_blocks()
     {
         m_blocks.clear();
+        m_num_blocks = 0;
+        m_last_nominal_block = 0;
+        m_first_block_planned = false;
     }
 
     void GCodeTimeEstimator::_calculate_time()
     {
         PROFILE_FUNC();
-        _forward_pass();
-        _reverse_pass();
-        _recalculate_trapezoids();
+        if (!m_blocks.empty())
+        {
+            _forward_pass(m_blocks.size() - 1);
+            _reverse_pass(m_blocks.size() - 1);
+            _recalculate_trapezoids(m_blocks.size());
+            _finalize_blocks(m_blocks.size());
+        }
+        // The next block starts a new planner window.
+        m_first_block_planned = false;
 
+        // The additional time is spent after the blocks (dwell, tool change, waiting for the temperature).
         m_time += get_additional_time();
         m_color_time_cache += get_additional_time();
+        // The additional time has been consumed (added to the total time), reset it to zero.
+        set_additional_time(0.);
+    }
 
-        for (int i = m_last_st_synchronized_block_id + 1; i < (int)m_blocks.size(); ++i)
+    void GCodeTimeEstimator::_plan_lookahead()
+    {
+        if (m_blocks.size() < PLANNER_BATCH_BLOCKS)
+            return;
+
+        PROFILE_FUNC();
+        if (m_last_nominal_block > 0)
         {
-            Block& block = m_blocks[i];
+            // The reverse pass sets the entry speed of a block with a nominal length to its maximum entry speed whatever the blocks to come,
+            // and the forward pass does not propagate over it, thus the blocks before it are planned and finalized exactly the same way
+            // as if all the blocks were known. m_last_nominal_block is not the newest block, its next block is known.
+            size_t last_block = m_last_nominal_block;
+            _forward_pass(last_block);
+            _reverse_pass(last_block + 1);
+            _recalculate_trapezoids(last_block);
+            _finalize_blocks(last_block);
+            m_first_block_planned = false;
+        }
+        else if (m_blocks.size() >= PLANNER_MAX_BLOCKS)
+        {
+            // Flush the planner window as if the newest block was the last one.
+            size_t last_block = m_blocks.size() - 1;
+            _forward_pass(last_block);
+            _reverse_pass(last_block);
+            _recalculate_trapezoids(last_block);
+            _finalize_blocks(last_block);
+            // The entry speed of the newest block was planned as if it was the last block, it shall not be replanned by the next reverse pass.
+            m_first_block_planned = true;
+        }
+    }
+
+    void GCodeTimeEstimator::_finalize_blocks(size_t num_blocks)
+    {
+        for (size_t i = 0; i < num_blocks; ++i)
+        {
+            const Block& block = m_blocks[i];
             float block_time = 0.0f;
             block_time += block.acceleration_time();
             block_time += block.cruise_time();
             block_time += block.deceleration_time();
             m_time += block_time;
-            block.elapsed_time = m_time;
+            if (block.g1_line_id_idx != -1)
+                m_g1_line_ids[block.g1_line_id_idx].second = m_time;
 
 #if ENABLE_MOVE_STATS
             MovesStatsMap::iterator it = _moves_stats.find(block.move_type);
@@ -833,9 +833,9 @@ namespace Slic3r {
             m_color_time_cache += block_time;
         }
 
-        m_last_st_synchronized_block_id = (int)m_blocks.size() - 1;
-        // The additional time has been consumed (added to the total time), reset it to zero.
-        set_additional_time(0.);
+        m_blocks.erase(m_blocks.begin(), m_blocks.begin() + num_blocks);
+        // No block with a nominal length is left in the planner window, see _plan_lookahead().
+        m_last_nominal_block = 0;
     }
 
     void GCodeTimeEstimator::_process_gcode_line(GCodeReader&, const GCodeReader::GCodeLine& line)
@@ -860,6 +860,12 @@ namespace Slic3r {
                             _processG1(line);
                             break;
                         }
+                    case 2: // Clockwise Arc
+                    case 3: // Counter-clockwise Arc
+                        {
+                            _processG2_G3(line, ::atoi(&cmd[1]) == 3);
+                            break;
+                        }
                     case 4: // Dwell
                         {
                             _processG4(line);
@@ -971,41 +977,102 @@ namespace Slic3r {
         }
     }
 
+    float GCodeTimeEstimator::_axis_absolute_position(EAxis axis, const GCodeReader::GCodeLine& line) const
+    {
+        float current_absolute_position = get_axis_position(axis);
+        float current_origin = get_axis_origin(axis);
+        float lengthsScaleFactor = (get_units() == GCodeTimeEstimator::Inches) ? INCHES_TO_MM : 1.0f;
+
+        bool is_relative = (get_global_positioning_type() == Relative);
+        if (axis == E)
+            is_relative |= (get_e_local_positioning_type() == Relative);
+
+        if (line.has(Slic3r::Axis(axis)))
+        {
+            float ret = line.value(Slic3r::Axis(axis)) * lengthsScaleFactor;
+            return is_relative ? current_absolute_position + ret : ret + current_origin;
+        }
+        else
+            return current_absolute_position;
+    }
+
     void GCodeTimeEstimator::_processG1(const GCodeReader::GCodeLine& line)
     {
-        auto axis_absolute_position = [this](GCodeTimeEstimator::EAxis axis, const GCodeReader::GCodeLine& lineG1) -> float
+        PROFILE_FUNC();
+        increment_g1_line_id();
+
+        // updates axes positions from line
+        float new_pos[Num_Axis];
+        for (unsigned char a = X; a < Num_Axis; ++a)
         {
-            float current_absolute_position = get_axis_position(axis);
-            float current_origin = get_axis_origin(axis);
-            float lengthsScaleFactor = (get_units() == GCodeTimeEstimator::Inches) ? INCHES_TO_MM : 1.0f;
+            new_pos[a] = _axis_absolute_position((EAxis)a, line);
+        }
 
-            bool is_relative = (get_global_positioning_type() == Relative);
-            if (axis == E)
-                is_relative |= (get_e_local_positioning_type() == Relative);
+        // updates feedrate from line, if present
+        if (line.has_f())
+            set_feedrate(std::max(line.f() * MMMIN_TO_MMSEC, get_minimum_feedrate()));
 
-            if (lineG1.has(Slic3r::Axis(axis)))
-            {
-                float ret = lineG1.value(Slic3r::Axis(axis)) * lengthsScaleFactor;
-                return is_relative ? current_absolute_position + ret : ret + current_origin;
-            }
-            else
-                return current_absolute_position;
-        };
+        if (_simulate_move(new_pos))
+        {
+            m_blocks.back().g1_line_id_idx = (int)m_g1_line_ids.size();
+            m_g1_line_ids.emplace_back(G1LineIdToElapsedTimeMap::value_type(get_g1_line_id(), -1.0f));
+        }
+    }
 
+    void GCodeTimeEstimator::_processG2_G3(const GCodeReader::GCodeLine& line, bool ccw)
+    {
         PROFILE_FUNC();
         increment_g1_line_id();
 
         // updates axes positions from line
-        float new_pos[Num_Axis];
+        float start_pos[Num_Axis];
+        float end_pos[Num_Axis];
         for (unsigned char a = X; a < Num_Axis; ++a)
         {
-            new_pos[a] = axis_absolute_position((EAxis)a, line);
+            start_pos[a] = get_axis_position((EAxis)a);
+            end_pos[a] = _axis_absolute_position((EAxis)a, line);
         }
 
         // updates feedrate from line, if present
         if (line.has_f())
             set_feedrate(std::max(line.f() * MMMIN_TO_MMSEC, get_minimum_feedrate()));
 
+        // the center of the arc is relative to the start position in both the absolute and the relative positioning
+        float lengthsScaleFactor = (get_units() == GCodeTimeEstimator::Inches) ? INCHES_TO_MM : 1.0f;
+        float i = 0.0f;
+        float j = 0.0f;
+        line.has_value('I', i);
+        line.has_value('J', j);
+        Vec2d start(start_pos[X], start_pos[Y]);
+        Vec2d center = start + Vec2d(i, j) * lengthsScaleFactor;
+
+        // splits the arc into line segments the way the firmware does, Z and E are interpolated linearly along the arc
+        std::vector<Vec2d> points = ArcFitter::discretize(start, Vec2d(end_pos[X], end_pos[Y]), center, ccw, ARC_SEGMENT_LENGTH, 0.);
+        bool added = false;
+        for (size_t k = 0; k < points.size(); ++k)
+        {
+            float t = float(k + 1) / float(points.size());
+            float new_pos[Num_Axis];
+            for (unsigned char a = X; a < Num_Axis; ++a)
+            {
+                new_pos[a] = start_pos[a] + t * (end_pos[a] - start_pos[a]);
+            }
+            new_pos[X] = (k + 1 == points.size()) ? end_pos[X] : float(points[k](0));
+            new_pos[Y] = (k + 1 == points.size()) ? end_pos[Y] : float(points[k](1));
+            if (_simulate_move(new_pos))
+                added = true;
+        }
+
+        // the whole arc is mapped to its last block
+        if (added)
+        {
+            m_blocks.back().g1_line_id_idx = (int)m_g1_line_ids.size();
+            m_g1_line_ids.emplace_back(G1LineIdToElapsedTimeMap::value_type(get_g1_line_id(), -1.0f));
+        }
+    }
+
+    bool GCodeTimeEstimator::_simulate_move(const float new_pos[Num_Axis])
+    {
         // fills block data
         Block block;
 
@@ -1019,7 +1086,7 @@ namespace Slic3r {
 
         // is it a move ?
         if (max_abs_delta == 0.0f)
-            return;
+            return false;
 
         // calculates block feedrate
         m_curr.feedrate = std::max(get_feedrate(), block.is_travel_move() ? get_minimum_travel_feedrate() : get_minimum_feedrate());
@@ -1076,7 +1143,7 @@ namespace Slic3r {
 
         // calculates block entry feedrate
         float vmax_junction = m_curr.safe_feedrate;
-        if (!m_blocks.empty() && (m_prev.feedrate > PREVIOUS_FEEDRATE_THRESHOLD))
+        if ((m_num_blocks > 0) && (m_prev.feedrate > PREVIOUS_FEEDRATE_THRESHOLD))
         {
             bool prev_speed_larger = m_prev.feedrate > block.feedrate.cruise;
             float smaller_speed_factor = prev_speed_larger ? (block.feedrate.cruise / m_prev.feedrate) : (m_prev.feedrate / block.feedrate.cruise);
@@ -1180,7 +1247,12 @@ namespace Slic3r {
 
         // adds block to blocks list
         m_blocks.emplace_back(block);
-        m_g1_line_ids.emplace_back(G1LineIdToBlockIdMap::value_type(get_g1_line_id(), (unsigned int)m_blocks.size() - 1));
+        ++m_num_blocks;
+        // finalizes the blocks planned already to keep the list short
+        _plan_lookahead();
+        if (block.flags.nominal_length)
+            m_last_nominal_block = m_blocks.size() - 1;
+        return true;
     }
 
     void GCodeTimeEstimator::_processG4(const GCodeReader::GCodeLine& line)
@@ -1490,27 +1562,23 @@ namespace Slic3r {
         _calculate_time();
     }
 
-    void GCodeTimeEstimator::_forward_pass()
+    void GCodeTimeEstimator::_forward_pass(size_t last_block)
     {
         PROFILE_FUNC();
-        if (m_blocks.size() > 1)
+        for (size_t i = 0; i < last_block; ++i)
         {
-            for (int i = m_last_st_synchronized_block_id + 1; i < (int)m_blocks.size() - 1; ++i)
-            {
-                _planner_forward_pass_kernel(m_blocks[i], m_blocks[i + 1]);
-            }
+            _planner_forward_pass_kernel(m_blocks[i], m_blocks[i + 1]);
         }
     }
 
-    void GCodeTimeEstimator::_reverse_pass()
+    void GCodeTimeEstimator::_reverse_pass(size_t last_block)
     {
         PROFILE_FUNC();
-        if (m_blocks.size() > 1)
+        // The entry speed of the last block is not replanned, the next block is not known.
+        size_t first_block = m_first_block_planned ? 1 : 0;
+        for (size_t i = last_block; i > first_block; --i)
         {
-            for (int i = (int)m_blocks.size() - 1; i >= m_last_st_synchronized_block_id + 2; --i)
-            {
-                _planner_reverse_pass_kernel(m_blocks[i - 1], m_blocks[i]);
-            }
+            _planner_reverse_pass_kernel(m_blocks[i - 1], m_blocks[i]);
         }
     }
 
@@ -1555,21 +1623,15 @@ namespace Slic3r {
         }
     }
 
-    void GCodeTimeEstimator::_recalculate_trapezoids()
+    void GCodeTimeEstimator::_recalculate_trapezoids(size_t num_blocks)
     {
         PROFILE_FUNC();
-        Block* curr = nullptr;
-        Block* next = nullptr;
-
-        for (int i = m_last_st_synchronized_block_id + 1; i < (int)m_blocks.size(); ++i)
+        for (size_t i = 0; i < num_blocks; ++i)
         {
-            Block& b = m_blocks[i];
-
-            curr = next;
-            next = &b;
-
-            if (curr != nullptr)
+            Block* curr = &m_blocks[i];
+            if (i + 1 < m_blocks.size())
             {
+                const Block* next = &m_blocks[i + 1];
                 // Recalculate if current block entry or exit junction speed has changed.
                 if (curr->flags.recalculate || next->flags.recalculate)
                 {
@@ -1581,16 +1643,15 @@ namespace Slic3r {
                     curr->flags.recalculate = false; // Reset current only to ensure next trapezoid is computed
                 }
             }
-        }
-
-        // Last/newest block in buffer. Always recalculated.
-        if (next != nullptr)
-        {
-            Block block = *next;
-            block.feedrate.exit = next->safe_feedrate;
-            block.calculate_trapezoid();
-            next->trapezoid = block.trapezoid;
-            next->flags.recalculate = false;
+            else
+            {
+                // Last/newest block in buffer. Always recalculated.
+                Block block = *curr;
+                block.feedrate.exit = curr->safe_feedrate;
+                block.calculate_trapezoid();
+                curr->trapezoid = block.trapezoid;
+                curr->flags.recalculate = false;
+            }
         }
     }
 
@@ -1640,4 +1701,110 @@ namespace Slic3r {
         std::cout << std::endl;
     }
 #endif // ENABLE_MOVE_STATS
+
+    // Number of gcode lines passed to the time estimator threads at once.
+    static const size_t Time_Estimator_Batch_Size = 4096;
+    // Number of batches queued for each time estimator thread before the exporter waits for it.
+    static const int Time_Estimator_Queue_Capacity = 16;
+
+    GCodeTimeEstimatorThreads::GCodeTimeEstimatorThreads(const std::vector<GCodeTimeEstimator*>& estimators)
+        : m_estimators(estimators)
+        , m_exceptions(estimators.size())
+        , m_canceled(false)
+    {
+        for (size_t i = 0; i < m_estimators.size(); ++i)
+        {
+            m_queues.emplace_back(new BatchQueue());
+            m_queues.back()->set_capacity(Time_Estimator_Queue_Capacity);
+        }
+
+        m_batch = std::make_shared<Batch>();
+        m_batch->reserve(Time_Estimator_Batch_Size);
+
+        for (size_t i = 0; i < m_estimators.size(); ++i)
+        {
+            m_threads.emplace_back([this, i]() {
+                GCodeTimeEstimator& estimator = *m_estimators[i];
+                BatchQueue& queue = *m_queues[i];
+                std::shared_ptr<const Batch> batch;
+                // an empty pointer ends the gcode
+                for (queue.pop(batch); batch != nullptr; queue.pop(batch))
+                {
+                    // keeps emptying the queue after a failure, so that the exporter is not blocked
+                    if (m_canceled || (m_exceptions[i] != nullptr))
+                        continue;
+
+                    try
+                    {
+                        for (const GCodeReader::GCodeLine& line : *batch)
+                        {
+                            estimator.add_gcode_line(line);
+                        }
+                    }
+                    catch (...)
+                    {
+                        m_exceptions[i] = std::current_exception();
+                    }
+                }
+            });
+        }
+    }
+
+    GCodeTimeEstimatorThreads::~GCodeTimeEstimatorThreads()
+    {
+        m_canceled = true;
+        _stop();
+    }
+
+    void GCodeTimeEstimatorThreads::add_gcode_line(const GCodeReader::GCodeLine& line)
+    {
+        m_batch->emplace_back(line);
+        if (m_batch->size() == Time_Estimator_Batch_Size)
+            _push_batch();
+    }
+
+    void GCodeTimeEstimatorThreads::finish()
+    {
+        _push_batch();
+        _stop();
+
+        for (const std::exception_ptr& exception : m_exceptions)
+        {
+            if (exception != nullptr)
+                std::rethrow_exception(exception);
+        }
+    }
+
+    void GCodeTimeEstimatorThreads::_push_batch()
+    {
+        if (m_batch->empty())
+            return;
+
+        // the batch is shared by all the estimators
+        std::shared_ptr<const Batch> batch = m_batch;
+        for (std::unique_ptr<BatchQueue>& queue : m_queues)
+        {
+            queue->push(batch);
+        }
+
+        m_batch = std::make_shared<Batch>();
+        m_batch->reserve(Time_Estimator_Batch_Size);
+    }
+
+    void GCodeTimeEstimatorThreads::_stop()
+    {
+        if (m_threads.empty())
+            return;
+
+        for (std::unique_ptr<BatchQueue>& queue : m_queues)
+        {
+            queue->push(std::shared_ptr<const Batch>());
+        }
+
+        for (boost::thread& thread : m_threads)
+        {
+            thread.join();
+        }
+        m_threads.clear();
+    }
 }
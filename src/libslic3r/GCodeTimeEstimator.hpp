@@ -5,6 +5,13 @@
 #include "PrintConfig.hpp"
 #include "GCodeReader.hpp"
 
+#include <atomic>
+#include <exception>
+#include <memory>
+
+#include <boost/thread/thread.hpp>
+#include <tbb/concurrent_queue.h>
+
 #define ENABLE_MOVE_STATS 0
 
 namespace Slic3r {
@@ -17,13 +24,13 @@ namespace Slic3r {
     class GCodeTimeEstimator
     {
     public:
-        static const std::string Normal_First_M73_Output_Placeholder_Tag;
-        static const std::string Silent_First_M73_Output_Placeholder_Tag;
-        static const std::string Normal_Last_M73_Output_Placeholder_Tag;
-        static const std::string Silent_Last_M73_Output_Placeholder_Tag;
-
         static const std::string Color_Change_Tag;
 
+        // Length of the lines reserved in the exported G-code for the lines M73, including the new line.
+        static const size_t M73_Line_Length;
+        // Text of a reserved line, a comment padded by spaces. The firmware ignores the reserved lines left unused by post_process().
+        static const std::string Reserved_M73_Line;
+
         enum EMode : unsigned char
         {
             Normal,
@@ -158,7 +165,8 @@ namespace Slic3r {
 
             FeedrateProfile feedrate;
             Trapezoid trapezoid;
-            float elapsed_time;
+            // Index into m_g1_line_ids of the G1 line finished by this block, -1 if the G1 line continues with the next block.
+            int g1_line_id_idx;
 
             Block();
 
@@ -215,29 +223,46 @@ namespace Slic3r {
 #endif // ENABLE_MOVE_STATS
 
     public:
-        typedef std::pair<unsigned int, unsigned int> G1LineIdToBlockId;
-        typedef std::vector<G1LineIdToBlockId> G1LineIdToBlockIdMap;
+        // Elapsed time at the end of a G1 line, -1 if the blocks of the G1 line were not finalized yet.
+        typedef std::pair<unsigned int, float> G1LineIdToElapsedTime;
+        typedef std::vector<G1LineIdToElapsedTime> G1LineIdToElapsedTimeMap;
 
         struct PostProcessData
         {
-            const G1LineIdToBlockIdMap& g1_line_ids;
-            const BlocksList& blocks;
+            const G1LineIdToElapsedTimeMap& g1_line_ids;
             float time;
 
-            PostProcessData(const G1LineIdToBlockIdMap& g1_line_ids, const BlocksList& blocks, float time) : g1_line_ids(g1_line_ids), blocks(blocks), time(time) {}
+            PostProcessData(const G1LineIdToElapsedTimeMap& g1_line_ids, float time) : g1_line_ids(g1_line_ids), time(time) {}
         };
 
+        // Line reserved in the exported G-code for a line M73, patched in place by post_process().
+        struct ReservedM73Line
+        {
+            // Offset of the reserved line in the G-code file.
+            size_t offset;
+            // Id of the G1 line preceding the reserved line, 0 for the line M73 with the total time at the start of the G-code.
+            unsigned int g1_line_id;
+            EMode mode;
+        };
+        typedef std::vector<ReservedM73Line> ReservedM73Lines;
+
     private:
         EMode m_mode;
         GCodeReader m_parser;
         State m_state;
         Feedrates m_curr;
         Feedrates m_prev;
+        // Planner window: the blocks not finalized yet. The finalized blocks are accumulated into m_time and m_g1_line_ids and removed,
+        // so that the memory does not grow with the length of the print.
         BlocksList m_blocks;
-        // Map between g1 line id and blocks id, used to speed up export of remaining times
-        G1LineIdToBlockIdMap m_g1_line_ids;
-        // Index of the last block already st_synchronized
-        int m_last_st_synchronized_block_id;
+        // Number of blocks added since the last reset, including the blocks already finalized.
+        size_t m_num_blocks;
+        // Index of the last block of m_blocks with a nominal length, 0 if none. The planning of the blocks before it does not depend on the blocks to come.
+        size_t m_last_nominal_block;
+        // Whether the entry speed of m_blocks.front() was planned as if it was the last block of a flushed planner window, thus it shall not be replanned.
+        bool m_first_block_planned;
+        // Map between g1 line id and the elapsed time at its end, used to speed up export of remaining times
+        G1LineIdToElapsedTimeMap m_g1_line_ids;
         float m_time; // s
 
         // data to calculate color print times
@@ -257,12 +282,13 @@ namespace Slic3r {
 
         void add_gcode_block(const char *ptr);
         void add_gcode_block(const std::string &str) { this->add_gcode_block(str.c_str()); }
+        // Adds the given already parsed gcode line, so that a single parsing pass
+        // may be shared by several estimators and by the GCodeAnalyzer.
+        void add_gcode_line(const GCodeReader::GCodeLine& line) { this->_process_gcode_line(m_parser, line); }
 
-        // Calculates the time estimate from the gcode lines added using add_gcode_line() or add_gcode_block()
-        // start_from_beginning:
-        // if set to true all blocks will be used to calculate the time estimate,
-        // if set to false only the blocks not yet processed will be used and the calculated time will be added to the current calculated time
-        void calculate_time(bool start_from_beginning);
+        // Calculates the time estimate from the gcode lines added using add_gcode_line() or add_gcode_block():
+        // the blocks not yet finalized are planned and their time is added to the current calculated time
+        void calculate_time();
 
         // Calculates the time estimate from the given gcode in string format
         void calculate_time_from_text(const std::string& gcode);
@@ -273,13 +299,15 @@ namespace Slic3r {
         // Calculates the time estimate from the gcode contained in given list of gcode lines
         void calculate_time_from_lines(const std::vector<std::string>& gcode_lines);
 
-        // Process the gcode contained in the file with the given filename, 
-        // replacing placeholders with correspondent new lines M73
-        // placing new lines M73 (containing the remaining time) where needed (in dependence of the given interval in seconds)
-        // and removing working tags (as those used for color changes)
+        // Patches the lines reserved in the gcode file with the given filename in place, so that the file is not read and written again:
+        // the reserved lines at the start of the gcode are replaced with the lines M73 containing the total time,
+        // the reserved lines following the G1 lines with the lines M73 containing the remaining time, where it changed by more than the given interval in seconds.
         // if normal_mode == nullptr no M73 line will be added for normal mode
         // if silent_mode == nullptr no M73 line will be added for silent mode
-        static bool post_process(const std::string& filename, float interval_sec, const PostProcessData* const normal_mode, const PostProcessData* const silent_mode);
+        static bool post_process(const std::string& filename, float interval_sec, const ReservedM73Lines& reserved_lines, const PostProcessData* const normal_mode, const PostProcessData* const silent_mode);
+
+        // Is the line counted by the ids of the G1 lines (G1, G2 and G3 moves)? Lets the G-code exporter reserve the lines M73 after the G1 lines.
+        static bool is_g1_line(const GCodeReader::GCodeLine& line);
 
         // Set current position on the given axis with the given value
         void set_axis_position(EAxis axis, float position);
@@ -380,7 +408,7 @@ namespace Slic3r {
         // Return an estimate of the memory consumed by the time estimator.
         size_t memory_used() const;
 
-        PostProcessData get_post_process_data() const { return PostProcessData(m_g1_line_ids, m_blocks, m_time); }
+        PostProcessData get_post_process_data() const { return PostProcessData(m_g1_line_ids, m_time); }
 
     private:
         void _reset();
@@ -390,12 +418,28 @@ namespace Slic3r {
         // Calculates the time estimate
         void _calculate_time();
 
+        // Plans and finalizes the blocks of the planner window, whose planning is not influenced by the blocks to come.
+        // Called while adding the blocks to bound the planner window.
+        void _plan_lookahead();
+
+        // Adds the times of the first num_blocks planned blocks to the time estimate and removes them from the planner window.
+        void _finalize_blocks(size_t num_blocks);
+
         // Processes the given gcode line
         void _process_gcode_line(GCodeReader&, const GCodeReader::GCodeLine& line);
 
+        // Absolute position of the axis after the move of the given line
+        float _axis_absolute_position(EAxis axis, const GCodeReader::GCodeLine& line) const;
+
         // Move
         void _processG1(const GCodeReader::GCodeLine& line);
 
+        // Clockwise (G2) or counter-clockwise (G3) arc, simulated as a sequence of line segments
+        void _processG2_G3(const GCodeReader::GCodeLine& line, bool ccw);
+
+        // Adds the block of a linear move to the given axes positions, returns false if there is no movement
+        bool _simulate_move(const float new_pos[Num_Axis]);
+
         // Dwell
         void _processG4(const GCodeReader::GCodeLine& line);
 
@@ -463,13 +507,15 @@ namespace Slic3r {
         // Simulates firmware st_synchronize() call
         void _simulate_st_synchronize();
 
-        void _forward_pass();
-        void _reverse_pass();
+        // Passes over the blocks of the planner window up to the block with the given index.
+        void _forward_pass(size_t last_block);
+        void _reverse_pass(size_t last_block);
 
         void _planner_forward_pass_kernel(Block& prev, Block& curr);
         void _planner_reverse_pass_kernel(Block& curr, Block& next);
 
-        void _recalculate_trapezoids();
+        // Recalculates the trapezoids of the first num_blocks blocks of the planner window.
+        void _recalculate_trapezoids(size_t num_blocks);
 
         // Returns the given time is seconds in format DDd HHh MMm SSs
         static std::string _get_time_dhms(float time_in_secs);
@@ -482,6 +528,36 @@ namespace Slic3r {
 #endif // ENABLE_MOVE_STATS
     };
 
+    // Runs the time estimators on threads of their own while the gcode is being exported.
+    // The gcode lines parsed by the exporter are collected into batches, which are shared by the estimators through their queues.
+    class GCodeTimeEstimatorThreads
+    {
+    public:
+        explicit GCodeTimeEstimatorThreads(const std::vector<GCodeTimeEstimator*>& estimators);
+        // Stops the threads, the lines not processed yet are dropped if finish() has not been called.
+        ~GCodeTimeEstimatorThreads();
+
+        // Adds the given already parsed gcode line to all the estimators
+        void add_gcode_line(const GCodeReader::GCodeLine& line);
+
+        // Waits until the estimators have processed all the lines added, rethrows the exception thrown by an estimator
+        void finish();
+
+    private:
+        typedef std::vector<GCodeReader::GCodeLine> Batch;
+        typedef tbb::concurrent_bounded_queue<std::shared_ptr<const Batch>> BatchQueue;
+
+        void _push_batch();
+        void _stop();
+
+        std::vector<GCodeTimeEstimator*> m_estimators;
+        std::vector<std::unique_ptr<BatchQueue>> m_queues;
+        std::vector<std::exception_ptr> m_exceptions;
+        std::vector<boost::thread> m_threads;
+        std::shared_ptr<Batch> m_batch;
+        std::atomic<bool> m_canceled;
+    };
+
 } /* namespace Slic3r */
 
 #endif /* slic3r_GCodeTimeEstimator_hpp_ */
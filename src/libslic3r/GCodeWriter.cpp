@@ -1,5 +1,7 @@
 #include "GCodeWriter.hpp"
 #include <algorithm>
+#include <cmath>
+#include <cstdio>
 #include <iomanip>
 #include <iostream>
 #include <map>
@@ -7,13 +9,115 @@
 
 #define FLAVOR_IS(val) this->config.gcode_flavor == val
 #define FLAVOR_IS_NOT(val) this->config.gcode_flavor != val
-#define COMMENT(comment) if (this->config.gcode_comments && !comment.empty()) gcode << " ; " << comment;
-#define PRECISION(val, precision) std::fixed << std::setprecision(precision) << val
-#define XYZF_NUM(val) PRECISION(val, 3)
-#define E_NUM(val) PRECISION(val, 5)
 
 namespace Slic3r {
 
+char* GCodeFormatter::format_fixed(char *buf, double value, int precision)
+{
+    static constexpr double pow10[] = { 1., 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9 };
+    assert(precision >= 0 && precision < 10);
+    double scaled = std::abs(value) * pow10[precision];
+    // The fast path handles the values, which could be represented by a 53 bit integer after scaling.
+    bool   fast   = std::isfinite(value) && scaled < 4.5e15;
+    double whole  = 0.;
+    double frac   = 0.;
+    if (fast) {
+        whole = std::floor(scaled);
+        frac  = scaled - whole;
+        // The scaled value is off the exact decimal value by at most half an ULP. If the fraction is that close to one half,
+        // the rounding direction cannot be decided here. Let printf() decide, it rounds the exact binary value.
+        fast  = std::abs(frac - 0.5) > (scaled + 1.) * 1e-15;
+    }
+    if (! fast) {
+        int len = ::snprintf(buf, 32, "%.*f", precision, value);
+        return buf + std::max(0, std::min(len, 31));
+    }
+
+    uint64_t n       = uint64_t(whole) + (frac > 0.5 ? 1 : 0);
+    uint64_t divisor = uint64_t(pow10[precision]);
+    uint64_t ipart   = n / divisor;
+    uint64_t fpart   = n % divisor;
+    char    *ptr     = buf;
+    // printf() emits the sign of a negative number rounded to zero, and so do we.
+    if (std::signbit(value))
+        *ptr ++ = '-';
+    // Integer part, at least a single digit.
+    char  digits[24];
+    char *d = digits;
+    do {
+        *d ++ = char('0' + ipart % 10);
+        ipart /= 10;
+    } while (ipart > 0);
+    while (d != digits)
+        *ptr ++ = *(-- d);
+    if (precision > 0) {
+        *ptr ++ = '.';
+        for (int i = precision - 1; i >= 0; -- i) {
+            ptr[i] = char('0' + fpart % 10);
+            fpart /= 10;
+        }
+        ptr += precision;
+    }
+    return ptr;
+}
+
+void GCodeFormatter::reserve(size_t len)
+{
+    if (m_end + len > m_buf + sizeof(m_buf)) {
+        m_overflow.append(m_buf, m_end);
+        m_end = m_buf;
+    }
+}
+
+void GCodeFormatter::emit_string(const char *str, size_t len)
+{
+    if (len > sizeof(m_buf)) {
+        // Long comment, don't copy it into the stack buffer.
+        m_overflow.append(m_buf, m_end);
+        m_overflow.append(str, len);
+        m_end = m_buf;
+    } else {
+        this->reserve(len);
+        memcpy(m_end, str, len);
+        m_end += len;
+    }
+}
+
+void GCodeFormatter::emit_axis(const char *axis, size_t axis_len, double value, int precision)
+{
+    // " ", axis, number.
+    this->emit_string(" ", 1);
+    this->emit_string(axis, axis_len);
+    this->reserve(32);
+    m_end = format_fixed(m_end, value, precision);
+}
+
+void GCodeFormatter::emit_comment(bool allow_comments, const std::string &comment)
+{
+    if (allow_comments && ! comment.empty()) {
+        this->emit_string(" ; ", 3);
+        this->emit_string(comment);
+    }
+}
+
+std::string GCodeFormatter::line()
+{
+    std::string out;
+    this->append_line(out);
+    return out;
+}
+
+void GCodeFormatter::append_line(std::string &gcode)
+{
+    this->emit_string("\n", 1);
+    if (! m_overflow.empty()) {
+        gcode += m_overflow;
+        m_overflow.clear();
+    }
+    gcode.append(m_buf, m_end);
+    m_end = m_buf;
+}
+
 void GCodeWriter::apply_print_config(const PrintConfig &print_config)
 {
     this->config.apply(print_config, true);
@@ -37,6 +141,36 @@ void GCodeWriter::set_extruders(std::vector<unsigned int> extruder_ids)
     this->multiple_extruders = (*std::max_element(extruder_ids.begin(), extruder_ids.end())) > 0;
 }
 
+GCodeWriter::State GCodeWriter::state() const
+{
+    State out;
+    out.extruders.reserve(m_extruders.size());
+    for (const Extruder &extruder : m_extruders)
+        out.extruders.emplace_back(extruder.state());
+    out.extruder_idx                 = m_extruder == nullptr ? -1 : int(m_extruder - m_extruders.data());
+    out.last_acceleration            = m_last_acceleration;
+    out.last_fan_speed               = m_last_fan_speed;
+    out.last_bed_temperature         = m_last_bed_temperature;
+    out.last_bed_temperature_reached = m_last_bed_temperature_reached;
+    out.lifted                       = m_lifted;
+    out.pos                          = m_pos;
+    return out;
+}
+
+void GCodeWriter::set_state(const State &state)
+{
+    assert(state.extruders.size() == m_extruders.size());
+    for (size_t i = 0; i < m_extruders.size(); ++ i)
+        m_extruders[i].set_state(state.extruders[i]);
+    m_extruder                     = state.extruder_idx == -1 ? nullptr : &m_extruders[state.extruder_idx];
+    m_last_acceleration            = state.last_acceleration;
+    m_last_fan_speed               = state.last_fan_speed;
+    m_last_bed_temperature         = state.last_bed_temperature;
+    m_last_bed_temperature_reached = state.last_bed_temperature_reached;
+    m_lifted                       = state.lifted;
+    m_pos                          = state.pos;
+}
+
 std::string GCodeWriter::preamble()
 {
     std::ostringstream gcode;
@@ -269,12 +403,12 @@ std::string GCodeWriter::set_speed(double F, const std::string &comment, const s
 {
     assert(F > 0.);
     assert(F < 100000.);
-    std::ostringstream gcode;
-    gcode << "G1 F" << XYZF_NUM(F);
-    COMMENT(comment);
-    gcode << cooling_marker;
-    gcode << "\n";
-    return gcode.str();
+    GCodeFormatter w;
+    w.emit_string("G1", 2);
+    w.emit_f(F);
+    w.emit_comment(this->config.gcode_comments, comment);
+    w.emit_string(cooling_marker);
+    return w.line();
 }
 
 std::string GCodeWriter::travel_to_xy(const Vec2d &point, const std::string &comment)
@@ -282,13 +416,12 @@ std::string GCodeWriter::travel_to_xy(const Vec2d &point, const std::string &com
     m_pos(0) = point(0);
     m_pos(1) = point(1);
     
-    std::ostringstream gcode;
-    gcode << "G1 X" << XYZF_NUM(point(0))
-          <<   " Y" << XYZF_NUM(point(1))
-          <<   " F" << XYZF_NUM(this->config.travel_speed.value * 60.0);
-    COMMENT(comment);
-    gcode << "\n";
-    return gcode.str();
+    GCodeFormatter w;
+    w.emit_string("G1", 2);
+    w.emit_xy(point);
+    w.emit_f(this->config.travel_speed.value * 60.0);
+    w.emit_comment(this->config.gcode_comments, comment);
+    return w.line();
 }
 
 std::string GCodeWriter::travel_to_xyz(const Vec3d &point, const std::string &comment)
@@ -312,14 +445,12 @@ std::string GCodeWriter::travel_to_xyz(const Vec3d &point, const std::string &co
     m_lifted = 0;
     m_pos = point;
     
-    std::ostringstream gcode;
-    gcode << "G1 X" << XYZF_NUM(point(0))
-          <<   " Y" << XYZF_NUM(point(1))
-          <<   " Z" << XYZF_NUM(point(2))
-          <<   " F" << XYZF_NUM(this->config.travel_speed.value * 60.0);
-    COMMENT(comment);
-    gcode << "\n";
-    return gcode.str();
+    GCodeFormatter w;
+    w.emit_string("G1", 2);
+    w.emit_xyz(point);
+    w.emit_f(this->config.travel_speed.value * 60.0);
+    w.emit_comment(this->config.gcode_comments, comment);
+    return w.line();
 }
 
 std::string GCodeWriter::travel_to_z(double z, const std::string &comment)
@@ -345,12 +476,12 @@ std::string GCodeWriter::_travel_to_z(double z, const std::string &comment)
 {
     m_pos(2) = z;
     
-    std::ostringstream gcode;
-    gcode << "G1 Z" << XYZF_NUM(z)
-          <<   " F" << XYZF_NUM(this->config.travel_speed.value * 60.0);
-    COMMENT(comment);
-    gcode << "\n";
-    return gcode.str();
+    GCodeFormatter w;
+    w.emit_string("G1", 2);
+    w.emit_z(z);
+    w.emit_f(this->config.travel_speed.value * 60.0);
+    w.emit_comment(this->config.gcode_comments, comment);
+    return w.line();
 }
 
 bool GCodeWriter::will_move_z(double z) const
@@ -366,18 +497,40 @@ bool GCodeWriter::will_move_z(double z) const
 }
 
 std::string GCodeWriter::extrude_to_xy(const Vec2d &point, double dE, const std::string &comment)
+{
+    std::string gcode;
+    this->extrude_to_xy(gcode, point, dE, comment);
+    return gcode;
+}
+
+void GCodeWriter::extrude_to_xy(std::string &gcode, const Vec2d &point, double dE, const std::string &comment)
 {
     m_pos(0) = point(0);
     m_pos(1) = point(1);
     m_extruder->extrude(dE);
     
-    std::ostringstream gcode;
-    gcode << "G1 X" << XYZF_NUM(point(0))
-          <<   " Y" << XYZF_NUM(point(1))
-          <<    " " << m_extrusion_axis << E_NUM(m_extruder->E());
-    COMMENT(comment);
-    gcode << "\n";
-    return gcode.str();
+    GCodeFormatter w;
+    w.emit_string("G1", 2);
+    w.emit_xy(point);
+    w.emit_e(m_extrusion_axis, m_extruder->E());
+    w.emit_comment(this->config.gcode_comments, comment);
+    w.append_line(gcode);
+}
+
+void GCodeWriter::extrude_arc_to_xy(std::string &gcode, const Vec2d &point, const Vec2d &center_offset, bool ccw, double dE, const std::string &comment)
+{
+    m_pos(0) = point(0);
+    m_pos(1) = point(1);
+    m_extruder->extrude(dE);
+    
+    GCodeFormatter w;
+    w.emit_string(ccw ? "G3" : "G2", 2);
+    w.emit_xy(point);
+    w.emit_axis('I', center_offset(0), GCodeFormatter::XYZF_PRECISION);
+    w.emit_axis('J', center_offset(1), GCodeFormatter::XYZF_PRECISION);
+    w.emit_e(m_extrusion_axis, m_extruder->E());
+    w.emit_comment(this->config.gcode_comments, comment);
+    w.append_line(gcode);
 }
 
 std::string GCodeWriter::extrude_to_xyz(const Vec3d &point, double dE, const std::string &comment)
@@ -386,14 +539,12 @@ std::string GCodeWriter::extrude_to_xyz(const Vec3d &point, double dE, const std
     m_lifted = 0;
     m_extruder->extrude(dE);
     
-    std::ostringstream gcode;
-    gcode << "G1 X" << XYZF_NUM(point(0))
-          <<   " Y" << XYZF_NUM(point(1))
-          <<   " Z" << XYZF_NUM(point(2))
-          <<    " " << m_extrusion_axis << E_NUM(m_extruder->E());
-    COMMENT(comment);
-    gcode << "\n";
-    return gcode.str();
+    GCodeFormatter w;
+    w.emit_string("G1", 2);
+    w.emit_xyz(point);
+    w.emit_e(m_extrusion_axis, m_extruder->E());
+    w.emit_comment(this->config.gcode_comments, comment);
+    return w.line();
 }
 
 std::string GCodeWriter::retract(bool before_wipe)
@@ -443,10 +594,13 @@ std::string GCodeWriter::_retract(double length, double restart_extra, const std
             else
                 gcode << "G10 ; retract\n";
         } else {
-            gcode << "G1 " << m_extrusion_axis << E_NUM(m_extruder->E())
-                           << " F" << float(m_extruder->retract_speed() * 60.);
-            COMMENT(comment);
-            gcode << "\n";
+            // The F word inherits the precision of the E word.
+            GCodeFormatter w;
+            w.emit_string("G1", 2);
+            w.emit_e(m_extrusion_axis, m_extruder->E());
+            w.emit_axis('F', float(m_extruder->retract_speed() * 60.), GCodeFormatter::E_PRECISION);
+            w.emit_comment(this->config.gcode_comments, comment);
+            gcode << w.line();
         }
     }
     
@@ -473,10 +627,13 @@ std::string GCodeWriter::unretract()
             gcode << this->reset_e();
         } else {
             // use G1 instead of G0 because G0 will blend the restart with the previous travel move
-            gcode << "G1 " << m_extrusion_axis << E_NUM(m_extruder->E())
-                           << " F" << float(m_extruder->deretract_speed() * 60.);
-            if (this->config.gcode_comments) gcode << " ; unretract";
-            gcode << "\n";
+            // The F word inherits the precision of the E word.
+            GCodeFormatter w;
+            w.emit_string("G1", 2);
+            w.emit_e(m_extrusion_axis, m_extruder->E());
+            w.emit_axis('F', float(m_extruder->deretract_speed() * 60.), GCodeFormatter::E_PRECISION);
+            w.emit_comment(this->config.gcode_comments, "unretract");
+            gcode << w.line();
         }
     }
     
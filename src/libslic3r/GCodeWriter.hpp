@@ -2,6 +2,7 @@
 #define slic3r_GCodeWriter_hpp_
 
 #include "libslic3r.h"
+#include <cstring>
 #include <string>
 #include "Extruder.hpp"
 #include "Point.hpp"
@@ -15,6 +16,52 @@ static constexpr char ColorChangeCode[]     = "M600";
 static constexpr char PausePrintCode[]      = "M601";
 static constexpr char ToolChangeCode[]  = "tool_change";
 
+// Formatter of a single G-code line into a stack allocated buffer.
+// The numbers are formatted with a fixed precision, rounded exactly as printf("%.*f") and std::fixed << std::setprecision() do,
+// but without constructing a std::ostringstream and without the locale handling for every G-code line.
+class GCodeFormatter {
+public:
+    // Number of decimal places of the X, Y, Z and F words.
+    static constexpr int XYZF_PRECISION = 3;
+    // Number of decimal places of the E word.
+    static constexpr int E_PRECISION    = 5;
+
+    GCodeFormatter() : m_end(m_buf) {}
+
+    // Format value with a fixed number of decimal places into buf, which shall be at least 32 characters long.
+    // Returns the end of the formatted number, the string is not zero terminated.
+    // Absurdly large values, which do not fit into the 32 characters, are truncated.
+    static char*    format_fixed(char *buf, double value, int precision);
+
+    void            emit_string(const char *str, size_t len);
+    void            emit_string(const char *str) { this->emit_string(str, ::strlen(str)); }
+    void            emit_string(const std::string &str) { this->emit_string(str.data(), str.size()); }
+    // Emits " <axis><value>", for example " X10.000".
+    void            emit_axis(const char *axis, size_t axis_len, double value, int precision);
+    void            emit_axis(char axis, double value, int precision) { this->emit_axis(&axis, 1, value, precision); }
+    void            emit_xy(const Vec2d &point) { this->emit_axis('X', point(0), XYZF_PRECISION); this->emit_axis('Y', point(1), XYZF_PRECISION); }
+    void            emit_xyz(const Vec3d &point) { this->emit_xy(to_2d(point)); this->emit_axis('Z', point(2), XYZF_PRECISION); }
+    void            emit_z(double z) { this->emit_axis('Z', z, XYZF_PRECISION); }
+    void            emit_e(const std::string &axis, double e) { this->emit_axis(axis.data(), axis.size(), e, E_PRECISION); }
+    void            emit_f(double f) { this->emit_axis('F', f, XYZF_PRECISION); }
+    // Emits " ; comment" if comments are enabled and the comment is not empty.
+    void            emit_comment(bool allow_comments, const std::string &comment);
+
+    // Terminate the line with a newline and return it.
+    std::string     line();
+    // Terminate the line with a newline and append it to gcode.
+    void            append_line(std::string &gcode);
+
+private:
+    // Make room for len characters in the stack buffer, move the content of the stack buffer to m_overflow if needed.
+    void            reserve(size_t len);
+
+    char            m_buf[128];
+    char           *m_end;
+    // Holds the beginning of the line if the line does not fit into m_buf, for example due to a long comment.
+    std::string     m_overflow;
+};
+
 class GCodeWriter {
 public:
     GCodeConfig config;
@@ -65,6 +112,10 @@ public:
     std::string travel_to_z(double z, const std::string &comment = std::string());
     bool        will_move_z(double z) const;
     std::string extrude_to_xy(const Vec2d &point, double dE, const std::string &comment = std::string());
+    // Append the extrusion move to gcode, saving the allocation of a temporary string.
+    void        extrude_to_xy(std::string &gcode, const Vec2d &point, double dE, const std::string &comment = std::string());
+    // Append a circular arc extrusion move to gcode: G3 if ccw, G2 otherwise. center_offset is the center of the arc relative to the current position.
+    void        extrude_arc_to_xy(std::string &gcode, const Vec2d &point, const Vec2d &center_offset, bool ccw, double dE, const std::string &comment = std::string());
     std::string extrude_to_xyz(const Vec3d &point, double dE, const std::string &comment = std::string());
     std::string retract(bool before_wipe = false);
     std::string retract_for_toolchange(bool before_wipe = false);
@@ -73,6 +124,28 @@ public:
     std::string unlift();
     Vec3d       get_position() const { return m_pos; }
 
+    // State of the writer changing while the G-code is being generated, without the configuration.
+    // Used by GCode to continue the export from a state cached by a previous export, see GCodeLayerCache.
+    struct State {
+        std::vector<Extruder::State> extruders;
+        // Index of the active extruder into extruders, -1 if no extruder is active.
+        int                          extruder_idx;
+        unsigned int                 last_acceleration;
+        unsigned int                 last_fan_speed;
+        unsigned int                 last_bed_temperature;
+        bool                         last_bed_temperature_reached;
+        double                       lifted;
+        Vec3d                        pos;
+        bool operator==(const State &rhs) const {
+            return extruders == rhs.extruders && extruder_idx == rhs.extruder_idx && last_acceleration == rhs.last_acceleration &&
+                last_fan_speed == rhs.last_fan_speed && last_bed_temperature == rhs.last_bed_temperature &&
+                last_bed_temperature_reached == rhs.last_bed_temperature_reached && lifted == rhs.lifted && pos == rhs.pos;
+        }
+    };
+    State       state() const;
+    // The writer has to be initialized with the same extruders as the writer, from which the state was taken.
+    void        set_state(const State &state);
+
 private:
 	// Extruders are sorted by their ID, so that binary search is possible.
     std::vector<Extruder> m_extruders;
@@ -19,6 +19,8 @@
 #include <boost/algorithm/string/split.hpp>
 #include <boost/log/trivial.hpp>
 
+#include <tbb/parallel_for.h>
+
 #ifdef SLIC3R_DEBUG
 #include "SVG.hpp"
 #endif
@@ -210,10 +212,36 @@ static bool sort_pointfs(const Vec3d& a, const Vec3d& b)
     return (a(0) < b(0)) || (a(0) == b(0) && a(1) < b(1));
 }
 
+// Above this number of points, convex_hull() first reduces the input to the vertices of the convex hulls of its chunks,
+// which are calculated in parallel.
+static constexpr const size_t convex_hull_parallel_min_points = 65536;
+
 // This implementation is based on Andrew's monotone chain 2D convex hull algorithm
 Polygon convex_hull(Points points)
 {
     assert(points.size() >= 3);
+    if (points.size() >= convex_hull_parallel_min_points) {
+        // The convex hull of the input is the convex hull of the vertices of the convex hulls of its chunks.
+        // Each chunk has at least convex_hull_parallel_min_points / 2 points, thus it is processed sequentially.
+        size_t               num_chunks = points.size() / (convex_hull_parallel_min_points / 2);
+        std::vector<Polygon> chunk_hulls(num_chunks);
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, num_chunks), [&points, &chunk_hulls, num_chunks](const tbb::blocked_range<size_t> &range) {
+            for (size_t i = range.begin(); i < range.end(); ++ i)
+                chunk_hulls[i] = convex_hull(Points(points.begin() + i * points.size() / num_chunks, points.begin() + (i + 1) * points.size() / num_chunks));
+        });
+        size_t num_hull_points = 0;
+        for (const Polygon &hull : chunk_hulls)
+            num_hull_points += hull.points.size();
+        Points hull_points;
+        hull_points.reserve(num_hull_points);
+        for (const Polygon &hull : chunk_hulls)
+            append(hull_points, hull.points);
+        if (hull_points.size() < 3)
+            // All the input points are collinear.
+            return Polygon(std::move(hull_points));
+        points = std::move(hull_points);
+    }
+
     // sort input points
     std::sort(points.begin(), points.end(), sort_points);
 
@@ -430,9 +458,9 @@ void simplify_polygons(const Polygons &polygons, double tolerance, Polygons* ret
     for (Polygons::const_iterator it = polygons.begin(); it != polygons.end(); ++it) {
         Polygon p = *it;
         p.points.push_back(p.points.front());
-        p.points = MultiPoint::_douglas_peucker(p.points, tolerance);
+        MultiPoint::douglas_peucker(p.points, tolerance);
         p.points.pop_back();
-        pp.push_back(p);
+        pp.emplace_back(std::move(p));
     }
     *retval = Slic3r::simplify_polygons(pp);
 }
@@ -960,41 +988,47 @@ MedialAxis::build(ThickPolylines* polylines)
     typedef const VD::edge_type   edge_t;
     
     // collect valid edges (i.e. prune those not belonging to MAT)
-    // note: this keeps twins, so it inserts twice the number of the valid edges
-    this->valid_edges.clear();
+    // note: this keeps twins, so it marks twice the number of the valid edges
+    const size_t num_edges = this->vd.edges().size();
+    this->valid_edges.assign(num_edges, false);
+    this->thickness.assign(num_edges, std::pair<coordf_t, coordf_t>(0., 0.));
     {
-        std::set<const VD::edge_type*> seen_edges;
+        std::vector<unsigned char> seen_edges(num_edges, false);
         for (VD::const_edge_iterator edge = this->vd.edges().begin(); edge != this->vd.edges().end(); ++edge) {
             // if we only process segments representing closed loops, none if the
             // infinite edges (if any) would be part of our MAT anyway
             if (edge->is_secondary() || edge->is_infinite()) continue;
         
             // don't re-validate twins
-            if (seen_edges.find(&*edge) != seen_edges.end()) continue;  // TODO: is this needed?
-            seen_edges.insert(&*edge);
-            seen_edges.insert(edge->twin());
+            size_t idx = this->edge_idx(&*edge);
+            if (seen_edges[idx]) continue;  // TODO: is this needed?
+            size_t idx_twin = this->edge_idx(edge->twin());
+            seen_edges[idx] = true;
+            seen_edges[idx_twin] = true;
             
             if (!this->validate_edge(&*edge)) continue;
-            this->valid_edges.insert(&*edge);
-            this->valid_edges.insert(edge->twin());
+            this->valid_edges[idx] = true;
+            this->valid_edges[idx_twin] = true;
         }
     }
     this->edges = this->valid_edges;
     
-    // iterate through the valid edges to build polylines
-    while (!this->edges.empty()) {
-        const edge_t* edge = *this->edges.begin();
+    // iterate through the valid edges to build polylines, starting with the edge of the lowest index
+    for (size_t idx_start = 0; idx_start < num_edges; ++ idx_start) {
+        if (! this->edges[idx_start])
+            continue;
+        const edge_t* edge = &this->vd.edges()[idx_start];
         
         // start a polyline
         ThickPolyline polyline;
         polyline.points.push_back(Point( edge->vertex0()->x(), edge->vertex0()->y() ));
         polyline.points.push_back(Point( edge->vertex1()->x(), edge->vertex1()->y() ));
-        polyline.width.push_back(this->thickness[edge].first);
-        polyline.width.push_back(this->thickness[edge].second);
+        polyline.width.push_back(this->thickness[idx_start].first);
+        polyline.width.push_back(this->thickness[idx_start].second);
         
         // remove this edge and its twin from the available edges
-        (void)this->edges.erase(edge);
-        (void)this->edges.erase(edge->twin());
+        this->edges[idx_start] = false;
+        this->edges[this->edge_idx(edge->twin())] = false;
         
         // get next points
         this->process_edge_neighbors(edge, &polyline);
@@ -1057,7 +1091,7 @@ MedialAxis::process_edge_neighbors(const VD::edge_type* edge, ThickPolyline* pol
         std::vector<const VD::edge_type*> neighbors;
         for (const VD::edge_type* neighbor = twin->rot_next(); neighbor != twin;
             neighbor = neighbor->rot_next()) {
-            if (this->valid_edges.count(neighbor) > 0) neighbors.push_back(neighbor);
+            if (this->valid_edges[this->edge_idx(neighbor)]) neighbors.push_back(neighbor);
         }
     
         // if we have a single neighbor then we can continue recursively
@@ -1065,14 +1099,15 @@ MedialAxis::process_edge_neighbors(const VD::edge_type* edge, ThickPolyline* pol
             const VD::edge_type* neighbor = neighbors.front();
             
             // break if this is a closed loop
-            if (this->edges.count(neighbor) == 0) return;
+            size_t idx = this->edge_idx(neighbor);
+            if (! this->edges[idx]) return;
             
             Point new_point(neighbor->vertex1()->x(), neighbor->vertex1()->y());
             polyline->points.push_back(new_point);
-            polyline->width.push_back(this->thickness[neighbor].first);
-            polyline->width.push_back(this->thickness[neighbor].second);
-            (void)this->edges.erase(neighbor);
-            (void)this->edges.erase(neighbor->twin());
+            polyline->width.push_back(this->thickness[idx].first);
+            polyline->width.push_back(this->thickness[idx].second);
+            this->edges[idx] = false;
+            this->edges[this->edge_idx(neighbor->twin())] = false;
             edge = neighbor;
         } else if (neighbors.size() == 0) {
             polyline->endpoints.second = true;
@@ -1100,18 +1135,6 @@ MedialAxis::validate_edge(const VD::edge_type* edge)
         Point( edge->vertex1()->x(), edge->vertex1()->y() )
     );
     
-    // discard edge if it lies outside the supplied shape
-    // this could maybe be optimized (checking inclusion of the endpoints
-    // might give false positives as they might belong to the contour itself)
-    if (this->expolygon != NULL) {
-        if (line.a == line.b) {
-            // in this case, contains(line) returns a false positive
-            if (!this->expolygon->contains(line.a)) return false;
-        } else {
-            if (!this->expolygon->contains(line)) return false;
-        }
-    }
-    
     // retrieve the original line segments which generated the edge we're checking
     const VD::cell_type* cell_l = edge->cell();
     const VD::cell_type* cell_r = edge->twin()->cell();
@@ -1180,9 +1203,23 @@ MedialAxis::validate_edge(const VD::edge_type* edge)
     
     if (w0 > this->max_width && w1 > this->max_width)
         return false;
+
+    // discard edge if it lies outside the supplied shape
+    // this could maybe be optimized (checking inclusion of the endpoints
+    // might give false positives as they might belong to the contour itself)
+    // The containment test runs a Clipper operation over the whole shape, therefore it is only
+    // performed for the edges passing the cheap thickness filters above.
+    if (this->expolygon != NULL) {
+        if (line.a == line.b) {
+            // in this case, contains(line) returns a false positive
+            if (!this->expolygon->contains(line.a)) return false;
+        } else {
+            if (!this->expolygon->contains(line)) return false;
+        }
+    }
     
-    this->thickness[edge]         = std::make_pair(w0, w1);
-    this->thickness[edge->twin()] = std::make_pair(w1, w0);
+    this->thickness[this->edge_idx(edge)]         = std::make_pair(w0, w1);
+    this->thickness[this->edge_idx(edge->twin())] = std::make_pair(w1, w0);
     
     return true;
 }
@@ -271,8 +271,14 @@ class MedialAxis {
         typedef boost::polygon::rectangle_data<coordinate_type> rect_type;
     };
     VD vd;
-    std::set<const VD::edge_type*> edges, valid_edges;
-    std::map<const VD::edge_type*, std::pair<coordf_t,coordf_t> > thickness;
+    // Flags and thicknesses of the Voronoi edges indexed by edge_idx(). The vd edges are stored
+    // in a single vector, therefore vectors are used in place of sets / maps keyed by the edge pointers.
+    // Valid edges of the medial axis, including their twins.
+    std::vector<unsigned char> valid_edges;
+    // Valid edges not yet consumed into the output polylines.
+    std::vector<unsigned char> edges;
+    std::vector<std::pair<coordf_t,coordf_t>> thickness;
+    size_t edge_idx(const VD::edge_type* edge) const { return edge - &this->vd.edges().front(); }
     void process_edge_neighbors(const VD::edge_type* edge, ThickPolyline* polyline);
     bool validate_edge(const VD::edge_type* edge);
     const Line& retrieve_segment(const VD::cell_type* cell) const;
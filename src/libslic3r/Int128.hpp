@@ -256,10 +256,20 @@ private:
 
 public:
 
+	// Is the absolute value of the argument lower than 2^31?
+	static bool fits_int32(int64_t a) { return uint64_t(a) + 0x7FFFFFFFull < 0xFFFFFFFFull; }
+
 	// Evaluate signum of a 2x2 determinant, use a numeric filter to avoid 128 bit multiply if possible.
 	static int sign_determinant_2x2_filtered(int64_t a11, int64_t a12, int64_t a21, int64_t a22)
 	{
-		// First try to calculate the determinant over the upper 31 bits.
+		if (fits_int32(a11) && fits_int32(a12) && fits_int32(a21) && fits_int32(a22)) {
+			// The products are lower than 2^62, the determinant is calculated exactly with 64bit arithmetics.
+			// This is the common case for the differences of the coord_t coordinates and for the short edges
+			// of the polygons scaled up by ClipperLib, which enables the full 64bit range for the whole polygon set.
+			int64_t det = a11 * a22 - a12 * a21;
+			return (det > 0) - (det < 0);
+		}
+		// Otherwise try to calculate the determinant over the upper 31 bits.
 		// Round p1, p2, q1, q2 to 31 bits.
 		int64_t a11s = (a11 + (1 << 31)) >> 32;
 		int64_t a12s = (a12 + (1 << 31)) >> 32;
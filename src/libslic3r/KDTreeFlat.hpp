@@ -0,0 +1,233 @@
+// KD tree with the coordinates of the points copied into the nodes of the tree.
+
+#ifndef slic3r_KDTreeFlat_hpp_
+#define slic3r_KDTreeFlat_hpp_
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "Utils.hpp" // for next_highest_power_of_2()
+
+namespace Slic3r {
+
+// Variant of KDTreeIndirect for closest point searches: The coordinates are copied into the nodes when the tree is built,
+// interleaved with the point indices, and the nodes are stored in the breadth-first order
+// (children of node i at 2i+1 and 2i+2), thus the upper levels of the tree share a few cache lines and no query calls back
+// into a coordinate functor.
+// Points may be removed from the tree without rebuilding it: A removed node is still used to route the search,
+// and subtrees without any remaining point are skipped.
+template<size_t ANumDimensions, typename ACoordType>
+class KDTreeFlat
+{
+public:
+	static constexpr size_t NumDimensions = ANumDimensions;
+	using					CoordType     = ACoordType;
+    enum : size_t {
+        npos = size_t(-1)
+    };
+
+	KDTreeFlat() = default;
+	// CoordinateFn(idx, dimension) returns a coordinate of the idx'th point.
+	template<typename CoordinateFn>
+	KDTreeFlat(CoordinateFn coordinate, size_t num_points) { this->build(coordinate, num_points); }
+
+	template<typename CoordinateFn>
+	void build(CoordinateFn coordinate, size_t num_points)
+	{
+		this->clear();
+		if (num_points == 0)
+			return;
+		std::vector<Node> input;
+		input.reserve(num_points);
+		for (size_t i = 0; i < num_points; ++ i) {
+			Node node;
+			for (size_t d = 0; d < NumDimensions; ++ d)
+				node.coord[d] = coordinate(i, d);
+			node.idx = i;
+			input.emplace_back(node);
+		}
+		// Allocate enough memory for a full binary tree.
+		m_nodes.assign(next_highest_power_of_2(num_points + 1), Node());
+		m_node_of_point.assign(num_points, npos);
+		build_recursive(input, 0, 0, 0, num_points - 1);
+		m_size = num_points;
+	}
+
+	void   clear() { m_nodes.clear(); m_node_of_point.clear(); m_size = 0; }
+	// Number of points not removed.
+	size_t size()  const { return m_size; }
+	bool   empty() const { return m_size == 0; }
+
+	// Remove a point from the search. Returns false if the point has already been removed.
+	bool remove(size_t point_idx)
+	{
+		assert(point_idx < m_node_of_point.size());
+		size_t node = m_node_of_point[point_idx];
+		if (m_nodes[node].removed)
+			return false;
+		m_nodes[node].removed = true;
+		for (;;) {
+			assert(m_nodes[node].alive > 0);
+			-- m_nodes[node].alive;
+			if (node == 0)
+				break;
+			node = (node - 1) / 2;
+		}
+		-- m_size;
+		return true;
+	}
+
+	// Find a closest point using Euclidian metrics, which is accepted by the filter.
+	// Returns npos if not found.
+	template<typename PointType, typename FilterFn>
+	size_t closest_point(const PointType &point, FilterFn filter) const
+	{
+		std::pair<CoordType, size_t> best(std::numeric_limits<CoordType>::max(), npos);
+		if (m_size > 0)
+			this->closest_recursive(0, 0, point, filter, best);
+		return best.second;
+	}
+	template<typename PointType>
+	size_t closest_point(const PointType &point) const { return this->closest_point(point, [](size_t) { return true; }); }
+
+	// Find up to k closest points, sorted by increasing distance, into out. Returns the number of points found.
+	// The heap buffer is passed in by the caller, so that it may be reused between queries.
+	template<typename PointType>
+	size_t closest_points(const PointType &point, size_t k, std::vector<std::pair<CoordType, size_t>> &heap, std::vector<size_t> &out) const
+	{
+		heap.clear();
+		out.clear();
+		if (m_size > 0 && k > 0)
+			this->closest_k_recursive(0, 0, point, k, heap);
+		std::sort_heap(heap.begin(), heap.end());
+		for (const std::pair<CoordType, size_t> &item : heap)
+			out.emplace_back(item.second);
+		return out.size();
+	}
+
+	// Batched k closest points query: The k closest points of points[i] are stored at out[i * k, (i + 1) * k),
+	// padded with npos if the tree contains less than k points. Queries ordered in space reuse the cached upper levels of the tree.
+	template<typename PointType>
+	void closest_points(const std::vector<PointType> &points, size_t k, std::vector<size_t> &out) const
+	{
+		out.assign(points.size() * k, npos);
+		std::vector<std::pair<CoordType, size_t>> heap;
+		heap.reserve(k + 1);
+		std::vector<size_t> closest;
+		closest.reserve(k);
+		for (size_t i = 0; i < points.size(); ++ i) {
+			this->closest_points(points[i], k, heap, closest);
+			std::copy(closest.begin(), closest.end(), out.begin() + i * k);
+		}
+	}
+
+private:
+	struct Node {
+		std::array<CoordType, NumDimensions> coord;
+		// Index of the point, npos for an unused node.
+		size_t 		idx     = npos;
+		// Number of points not removed in the subtree of this node including this node.
+		uint32_t 	alive   = 0;
+		bool 		removed = false;
+	};
+
+	// Build a balanced tree by splitting the input sequence by an axis aligned plane at a dimension.
+	void build_recursive(std::vector<Node> &input, size_t node, const size_t dimension, const size_t left, const size_t right)
+	{
+		assert(node < m_nodes.size());
+		// Partition the input to left / right pieces of the same length to produce a balanced tree.
+		size_t center = (left + right) / 2;
+		if (left < right)
+			std::nth_element(input.begin() + left, input.begin() + center, input.begin() + right + 1,
+				[dimension](const Node &l, const Node &r) { return l.coord[dimension] < r.coord[dimension]; });
+		// Insert a node into the tree.
+		m_nodes[node] 		= input[center];
+		m_nodes[node].alive = uint32_t(right + 1 - left);
+		m_node_of_point[input[center].idx] = node;
+		// Build up the left / right subtrees.
+		size_t next_dimension = dimension;
+		if (++ next_dimension == NumDimensions)
+			next_dimension = 0;
+		if (center > left)
+			build_recursive(input, node * 2 + 1, next_dimension, left, center - 1);
+		if (center < right)
+			build_recursive(input, node * 2 + 2, next_dimension, center + 1, right);
+	}
+
+	template<typename PointType>
+	CoordType distance2(const Node &node, const PointType &point) const
+	{
+		auto dist = CoordType(0);
+		for (size_t i = 0; i < NumDimensions; ++ i) {
+			CoordType d = point[i] - node.coord[i];
+			dist += d * d;
+		}
+		return dist;
+	}
+
+	template<typename PointType, typename FilterFn>
+	void closest_recursive(size_t node_idx, size_t dimension, const PointType &point, FilterFn &filter, std::pair<CoordType, size_t> &best) const
+	{
+		if (node_idx >= m_nodes.size())
+			return;
+		const Node &node = m_nodes[node_idx];
+		if (node.alive == 0)
+			// Unused node or all points of the subtree removed.
+			return;
+		if (! node.removed && filter(node.idx)) {
+			CoordType dist = this->distance2(node, point);
+			if (dist < best.first)
+				best = std::make_pair(dist, node.idx);
+		}
+		// Descend into the half space containing the point first.
+		CoordType d 			 = point[dimension] - node.coord[dimension];
+		size_t    next_dimension = (dimension + 1 == NumDimensions) ? 0 : dimension + 1;
+		size_t 	  near_child     = node_idx * 2 + (d > CoordType(0) ? 2 : 1);
+		size_t 	  far_child      = (near_child & 1) ? near_child + 1 : near_child - 1;
+		closest_recursive(near_child, next_dimension, point, filter, best);
+		if (d * d < best.first)
+			closest_recursive(far_child, next_dimension, point, filter, best);
+	}
+
+	template<typename PointType>
+	void closest_k_recursive(size_t node_idx, size_t dimension, const PointType &point, size_t k, std::vector<std::pair<CoordType, size_t>> &heap) const
+	{
+		if (node_idx >= m_nodes.size())
+			return;
+		const Node &node = m_nodes[node_idx];
+		if (node.alive == 0)
+			return;
+		if (! node.removed) {
+			CoordType dist = this->distance2(node, point);
+			if (heap.size() < k) {
+				heap.emplace_back(dist, node.idx);
+				std::push_heap(heap.begin(), heap.end());
+			} else if (dist < heap.front().first) {
+				// Replace the farthest of the k points found so far.
+				std::pop_heap(heap.begin(), heap.end());
+				heap.back() = std::make_pair(dist, node.idx);
+				std::push_heap(heap.begin(), heap.end());
+			}
+		}
+		CoordType d 			 = point[dimension] - node.coord[dimension];
+		size_t    next_dimension = (dimension + 1 == NumDimensions) ? 0 : dimension + 1;
+		size_t 	  near_child     = node_idx * 2 + (d > CoordType(0) ? 2 : 1);
+		size_t 	  far_child      = (near_child & 1) ? near_child + 1 : near_child - 1;
+		closest_k_recursive(near_child, next_dimension, point, k, heap);
+		if (heap.size() < k || d * d < heap.front().first)
+			closest_k_recursive(far_child, next_dimension, point, k, heap);
+	}
+
+	std::vector<Node> 	m_nodes;
+	// Index of a node in m_nodes for each point.
+	std::vector<size_t> m_node_of_point;
+	size_t 				m_size = 0;
+};
+
+} // namespace Slic3r
+
+#endif /* slic3r_KDTreeFlat_hpp_ */
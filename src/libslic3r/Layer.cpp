@@ -65,6 +65,31 @@ void Layer::make_slices()
 }
 
 // Merge typed slices into untyped slices. This method is used to revert the effects of detect_surfaces_type() called for posPrepareInfill.
+void Layer::shrink_extrusions_to_fit()
+{
+    for (LayerRegion *layerm : m_regions) {
+        layerm->perimeters.shrink_to_fit();
+        layerm->thin_fills.shrink_to_fit();
+        layerm->fills.shrink_to_fit();
+    }
+}
+
+void Layer::memory_stats(PrintMemoryStats &stats) const
+{
+    stats.add("slice", sizeof(*this) + memsize(this->lslices) + this->lslices_bboxes.capacity() * sizeof(BoundingBox) +
+        m_regions.capacity() * sizeof(LayerRegion*));
+    for (const LayerRegion *layerm : m_regions)
+        layerm->memory_stats(stats);
+}
+
+void SupportLayer::memory_stats(PrintMemoryStats &stats) const
+{
+    Layer::memory_stats(stats);
+    // ExtrusionEntityCollection::memsize() counts the collection itself, which is a part of sizeof(*this) here.
+    stats.add("support_material", sizeof(*this) - sizeof(Layer) + memsize(this->support_islands.expolygons) +
+        this->support_fills.memsize() - sizeof(this->support_fills));
+}
+
 void Layer::merge_slices()
 {
     if (m_regions.size() == 1 && (this->id() > 0 || this->object()->config().elefant_foot_compensation.value == 0)) {
@@ -102,6 +127,33 @@ ExPolygons Layer::merged(float offset_scaled) const
     return out;
 }
 
+const Polygons& Layer::lslices_offset_cached(bool offset2, float delta1, float delta2, ClipperLib::JoinType joinType, double miterLimit) const
+{
+    std::lock_guard<std::mutex> lock(m_lslices_offsets_mutex);
+    for (const LSlicesOffset &cached : m_lslices_offsets)
+        if (cached.offset2 == offset2 && cached.delta1 == delta1 && cached.delta2 == delta2 && cached.join_type == joinType && cached.miter_limit == miterLimit)
+            return cached.polygons;
+    m_lslices_offsets.push_back({ offset2, delta1, delta2, joinType, miterLimit,
+        offset2 ? Slic3r::offset2(to_polygons(this->lslices), delta1, delta2, joinType, miterLimit) : Slic3r::offset(this->lslices, delta1, joinType, miterLimit) });
+    return m_lslices_offsets.back().polygons;
+}
+
+const Polygons& Layer::lslices_offset(float delta, ClipperLib::JoinType joinType, double miterLimit) const
+{
+    return this->lslices_offset_cached(false, delta, 0.f, joinType, miterLimit);
+}
+
+const Polygons& Layer::lslices_offset2(float delta1, float delta2, ClipperLib::JoinType joinType, double miterLimit) const
+{
+    return this->lslices_offset_cached(true, delta1, delta2, joinType, miterLimit);
+}
+
+void Layer::clear_lslices_offsets() const
+{
+    std::lock_guard<std::mutex> lock(m_lslices_offsets_mutex);
+    m_lslices_offsets.clear();
+}
+
 // Here the perimeters are created cummulatively for all layer regions sharing the same parameters influencing the perimeters.
 // The perimeter paths and the thin fills (ExtrusionEntityCollection) are assigned to the first compatible layer region.
 // The resulting fill surface is split back among the originating regions.
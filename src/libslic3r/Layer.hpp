@@ -2,16 +2,22 @@
 #define slic3r_Layer_hpp_
 
 #include "libslic3r.h"
+#include "BoundingBox.hpp"
 #include "Flow.hpp"
 #include "SurfaceCollection.hpp"
 #include "ExtrusionEntityCollection.hpp"
 #include "ExPolygonCollection.hpp"
+#include "clipper.hpp"
+
+#include <deque>
+#include <mutex>
 
 namespace Slic3r {
 
 class Layer;
 class PrintRegion;
 class PrintObject;
+struct PrintMemoryStats;
 
 class LayerRegion
 {
@@ -76,6 +82,8 @@ public:
 
     // Is there any valid extrusion assigned to this LayerRegion?
     bool    has_extrusions() const { return ! this->perimeters.entities.empty() || ! this->fills.entities.empty(); }
+    // Add the memory footprint of this LayerRegion to the PrintObjectSteps producing the data.
+    void    memory_stats(PrintMemoryStats &stats) const;
 
 protected:
     friend class Layer;
@@ -129,6 +137,12 @@ public:
     void                    merge_slices();
     // Slices merged into islands, to be used by the elephant foot compensation to trim the individual surfaces with the shrunk merged slices.
     ExPolygons              merged(float offset) const;
+    // Offsets of lslices, memoized for the layer above, which asks for the same offsets for each of its regions:
+    // offset(lslices) by the overhang detection of the perimeters, offset2(to_polygons(lslices)) by the top contacts of the supports.
+    // The returned references stay valid until clear_lslices_offsets() is called once the step asking for the offsets is finished.
+    const Polygons&         lslices_offset(float delta, ClipperLib::JoinType joinType = ClipperLib::jtMiter, double miterLimit = 3.) const;
+    const Polygons&         lslices_offset2(float delta1, float delta2, ClipperLib::JoinType joinType = ClipperLib::jtMiter, double miterLimit = 3.) const;
+    void                    clear_lslices_offsets() const;
     template <class T> bool any_internal_region_slice_contains(const T &item) const {
         for (const LayerRegion *layerm : m_regions) if (layerm->slices.any_internal_contains(item)) return true;
         return false;
@@ -139,6 +153,8 @@ public:
     }
     void                    make_perimeters();
     void                    make_fills();
+    // Release the unused capacity of the perimeter and infill extrusions once they are final.
+    void                    shrink_extrusions_to_fit();
 
     void                    export_region_slices_to_svg(const char *path) const;
     void                    export_region_fill_surfaces_to_svg(const char *path) const;
@@ -148,6 +164,8 @@ public:
 
     // Is there any valid extrusion assigned to this LayerRegion?
     virtual bool            has_extrusions() const { for (auto layerm : m_regions) if (layerm->has_extrusions()) return true; return false; }
+    // Add the memory footprint of this Layer and of its LayerRegions to the PrintObjectSteps producing the data.
+    virtual void            memory_stats(PrintMemoryStats &stats) const;
 
 protected:
     friend class PrintObject;
@@ -163,6 +181,20 @@ private:
     size_t              m_id;
     PrintObject        *m_object;
     LayerRegionPtrs     m_regions;
+
+    struct LSlicesOffset {
+        // Single offset of the ExPolygons if false, offset2 of the Polygons if true.
+        bool                    offset2;
+        float                   delta1;
+        float                   delta2;
+        ClipperLib::JoinType    join_type;
+        double                  miter_limit;
+        Polygons                polygons;
+    };
+    const Polygons&     lslices_offset_cached(bool offset2, float delta1, float delta2, ClipperLib::JoinType joinType, double miterLimit) const;
+    // Deque to keep the references returned by lslices_offset() valid while adding new offsets.
+    mutable std::deque<LSlicesOffset> m_lslices_offsets;
+    mutable std::mutex                m_lslices_offsets_mutex;
 };
 
 class SupportLayer : public Layer 
@@ -175,6 +207,7 @@ public:
 
     // Is there any valid extrusion assigned to this LayerRegion?
     virtual bool                has_extrusions() const { return ! support_fills.empty(); }
+    void                        memory_stats(PrintMemoryStats &stats) const override;
 
 protected:
     friend class PrintObject;
@@ -70,9 +70,11 @@ void LayerRegion::make_perimeters(const SurfaceCollection &slices, SurfaceCollec
         fill_surfaces
     );
     
-    if (this->layer()->lower_layer != nullptr)
+    if (this->layer()->lower_layer != nullptr) {
         // Cummulative sum of polygons over all the regions.
         g.lower_slices = &this->layer()->lower_layer->lslices;
+        g.lower_layer  = this->layer()->lower_layer;
+    }
     
     g.layer_id              = (int)this->layer()->id();
     g.ext_perimeter_flow    = this->flow(frExternalPerimeter);
@@ -417,6 +419,17 @@ void LayerRegion::elephant_foot_compensation_step(const float elephant_foot_comp
     this->slices.set(std::move(union_ex(tmp)), stInternal);
 }
 
+void LayerRegion::memory_stats(PrintMemoryStats &stats) const
+{
+    // ExtrusionEntityCollection::memsize() counts the collection itself, which is a part of sizeof(*this) here.
+    auto extrusions_memsize = [](const ExtrusionEntityCollection &eec) { return eec.memsize() - sizeof(eec); };
+    stats.add("slice",          sizeof(*this) + this->slices.memsize());
+    stats.add("perimeters",     extrusions_memsize(this->perimeters) + extrusions_memsize(this->thin_fills) +
+                                memsize(this->fill_expolygons) + this->fill_surfaces.memsize());
+    stats.add("prepare_infill", this->perimeter_surfaces.memsize() + memsize(this->bridged) + memsize(this->unsupported_bridge_edges));
+    stats.add("infill",         extrusions_memsize(this->fills));
+}
+
 void LayerRegion::export_region_slices_to_svg(const char *path) const
 {
     BoundingBox bbox;
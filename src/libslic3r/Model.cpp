@@ -716,6 +716,15 @@ ModelVolume* ModelObject::add_volume(TriangleMesh &&mesh)
     return v;
 }
 
+ModelVolume* ModelObject::add_volume(TriangleMesh &&mesh, TriangleMesh &&convex_hull)
+{
+    ModelVolume* v = new ModelVolume(this, std::move(mesh), std::move(convex_hull));
+    this->volumes.push_back(v);
+    v->center_geometry_after_creation();
+    this->invalidate_bounding_box();
+    return v;
+}
+
 ModelVolume* ModelObject::add_volume(const ModelVolume &other)
 {
     ModelVolume* v = new ModelVolume(this, other);
@@ -878,7 +887,7 @@ const BoundingBoxf3& ModelObject::raw_mesh_bounding_box() const
         m_raw_mesh_bounding_box.reset();
         for (const ModelVolume *v : this->volumes)
             if (v->is_model_part())
-                m_raw_mesh_bounding_box.merge(v->mesh().transformed_bounding_box(v->get_matrix()));
+                m_raw_mesh_bounding_box.merge(v->transformed_convex_hull_bounding_box(v->get_matrix()));
     }
     return m_raw_mesh_bounding_box;
 }
@@ -887,7 +896,7 @@ BoundingBoxf3 ModelObject::full_raw_mesh_bounding_box() const
 {
 	BoundingBoxf3 bb;
 	for (const ModelVolume *v : this->volumes)
-		bb.merge(v->mesh().transformed_bounding_box(v->get_matrix()));
+		bb.merge(v->transformed_convex_hull_bounding_box(v->get_matrix()));
 	return bb;
 }
 
@@ -905,13 +914,14 @@ const BoundingBoxf3& ModelObject::raw_bounding_box() const
         for (const ModelVolume *v : this->volumes)
         {
             if (v->is_model_part())
-                m_raw_bounding_box.merge(v->mesh().transformed_bounding_box(inst_matrix * v->get_matrix()));
+                m_raw_bounding_box.merge(v->transformed_convex_hull_bounding_box(inst_matrix * v->get_matrix()));
         }
     }
 	return m_raw_bounding_box;
 }
 
 // This returns an accurate snug bounding box of the transformed object instance, without the translation applied.
+// The bounding box is calculated from the cached convex hulls of the volumes, thus only their vertices are transformed.
 BoundingBoxf3 ModelObject::instance_bounding_box(size_t instance_idx, bool dont_translate) const
 {
     BoundingBoxf3 bb;
@@ -919,7 +929,7 @@ BoundingBoxf3 ModelObject::instance_bounding_box(size_t instance_idx, bool dont_
     for (ModelVolume *v : this->volumes)
     {
         if (v->is_model_part())
-            bb.merge(v->mesh().transformed_bounding_box(inst_matrix * v->get_matrix()));
+            bb.merge(v->transformed_convex_hull_bounding_box(inst_matrix * v->get_matrix()));
     }
     return bb;
 }
@@ -933,10 +943,15 @@ Polygon ModelObject::convex_hull_2d(const Transform3d &trafo_instance) const
     for (const ModelVolume *v : this->volumes)
         if (v->is_model_part()) {
             Transform3d trafo = trafo_instance * v->get_matrix();
-			const indexed_triangle_set &its = v->mesh().its;
+            // The projection of an affine image of the volume has the same convex hull as the projection of the image
+            // of the volume's 3D convex hull, which is cached by the volume and which has much less vertices than the mesh.
+            // Only the transformation is applied here whenever the instance or the volume is moved or rotated.
+            const std::shared_ptr<const TriangleMesh> &convex_hull = v->get_convex_hull_shared_ptr();
+            const TriangleMesh &mesh = (convex_hull && ! convex_hull->empty()) ? *convex_hull : v->mesh();
+			const indexed_triangle_set &its = mesh.its;
 			if (its.vertices.empty()) {
                 // Using the STL faces.
-				const stl_file& stl = v->mesh().stl;
+				const stl_file& stl = mesh.stl;
 				for (const stl_facet &facet : stl.facet_start)
                     for (size_t j = 0; j < 3; ++ j) {
                         Vec3d p = trafo * facet.vertex[j].cast<double>();
@@ -950,31 +965,7 @@ Polygon ModelObject::convex_hull_2d(const Transform3d &trafo_instance) const
                 }
             }
         }
-    std::sort(pts.begin(), pts.end(), [](const Point& a, const Point& b) { return a(0) < b(0) || (a(0) == b(0) && a(1) < b(1)); });
-    pts.erase(std::unique(pts.begin(), pts.end(), [](const Point& a, const Point& b) { return a(0) == b(0) && a(1) == b(1); }), pts.end());
-
-    Polygon hull;
-    int n = (int)pts.size();
-    if (n >= 3) {
-        int k = 0;
-        hull.points.resize(2 * n);
-        // Build lower hull
-        for (int i = 0; i < n; ++ i) {
-            while (k >= 2 && pts[i].ccw(hull[k-2], hull[k-1]) <= 0)
-                -- k;
-            hull[k ++] = pts[i];
-        }
-        // Build upper hull
-        for (int i = n-2, t = k+1; i >= 0; i--) {
-            while (k >= t && pts[i].ccw(hull[k-2], hull[k-1]) <= 0)
-                -- k;
-            hull[k ++] = pts[i];
-        }
-        hull.points.resize(k);
-        assert(hull.points.front() == hull.points.back());
-        hull.points.pop_back();
-    }
-    return hull;
+    return pts.size() < 3 ? Polygon() : Geometry::convex_hull(std::move(pts));
 }
 
 void ModelObject::center_around_origin(bool include_modifiers)
@@ -1586,6 +1577,14 @@ void ModelVolume::calculate_convex_hull()
     m_convex_hull = std::make_shared<TriangleMesh>(this->mesh().convex_hull_3d());
 }
 
+BoundingBoxf3 ModelVolume::transformed_convex_hull_bounding_box(const Transform3d &trafo) const
+{
+    // The extreme points of the mesh in any direction are vertices of its convex hull.
+    return (m_convex_hull && ! m_convex_hull->empty()) ?
+        m_convex_hull->transformed_bounding_box(trafo) :
+        this->mesh().transformed_bounding_box(trafo);
+}
+
 int ModelVolume::get_mesh_errors_count() const
 {
     const stl_stats& stats = this->mesh().stl.stats;
@@ -1768,10 +1767,8 @@ void ModelInstance::transform_mesh(TriangleMesh* mesh, bool dont_translate) cons
 
 BoundingBoxf3 ModelInstance::transform_mesh_bounding_box(const TriangleMesh& mesh, bool dont_translate) const
 {
-    // Rotate around mesh origin.
-    TriangleMesh copy(mesh);
-    copy.transform(get_matrix(true, false, true, true));
-    BoundingBoxf3 bbox = copy.bounding_box();
+    // Rotate around mesh origin, without copying the mesh.
+    BoundingBoxf3 bbox = mesh.transformed_bounding_box(get_matrix(true, false, true, true));
 
     if (!empty(bbox)) {
         // Scale the bounding box along the three axes.
@@ -214,6 +214,8 @@ public:
 
     ModelVolume*            add_volume(const TriangleMesh &mesh);
     ModelVolume*            add_volume(TriangleMesh &&mesh);
+    // Add a volume with a precalculated convex hull of its mesh.
+    ModelVolume*            add_volume(TriangleMesh &&mesh, TriangleMesh &&convex_hull);
     ModelVolume*            add_volume(const ModelVolume &volume);
     ModelVolume*            add_volume(const ModelVolume &volume, TriangleMesh &&mesh);
     void                    delete_volume(size_t idx);
@@ -240,6 +242,10 @@ public:
     TriangleMesh raw_mesh() const;
     // Non-transformed (non-rotated, non-scaled, non-translated) sum of all object volumes.
     TriangleMesh full_raw_mesh() const;
+    // Calls visitor(const TriangleMesh &mesh, const Transform3d &volume_matrix) for the non-modifier object volumes.
+    // A view of raw_mesh() for the callers reading the transformed facets only, the volume meshes are not copied.
+    template<typename Visitor>
+    void         visit_raw_meshes(Visitor visitor) const;
     // A transformed snug bounding box around the non-modifier object volumes, without the translation applied.
     // This bounding box is only used for the actual slicing.
     const BoundingBoxf3& raw_bounding_box() const;
@@ -407,6 +413,7 @@ public:
 
     // The triangular model.
     const TriangleMesh& mesh() const { return *m_mesh.get(); }
+    std::shared_ptr<const TriangleMesh> get_mesh_shared_ptr() const { return m_mesh; }
     void                set_mesh(const TriangleMesh &mesh) { m_mesh = std::make_shared<const TriangleMesh>(mesh); }
     void                set_mesh(TriangleMesh &&mesh) { m_mesh = std::make_shared<const TriangleMesh>(std::move(mesh)); }
     void                set_mesh(std::shared_ptr<const TriangleMesh> &mesh) { m_mesh = mesh; }
@@ -458,6 +465,9 @@ public:
     void                calculate_convex_hull();
     const TriangleMesh& get_convex_hull() const;
     std::shared_ptr<const TriangleMesh> get_convex_hull_shared_ptr() const { return m_convex_hull; }
+    // Bounding box of the volume mesh transformed by trafo, calculated from the vertices of the cached convex hull.
+    // Falls back to the mesh vertices if the convex hull is not available.
+    BoundingBoxf3       transformed_convex_hull_bounding_box(const Transform3d &trafo) const;
     // Get count of errors in the mesh
     int                 get_mesh_errors_count() const;
 
@@ -592,6 +602,14 @@ private:
 	}
 };
 
+template<typename Visitor>
+void ModelObject::visit_raw_meshes(Visitor visitor) const
+{
+    for (const ModelVolume *v : this->volumes)
+        if (v->is_model_part())
+            visitor(v->mesh(), v->get_matrix());
+}
+
 // A single instance of a ModelObject.
 // Knows the affine transformation of an object.
 class ModelInstance final : public ObjectBase
@@ -3,6 +3,7 @@
 #include "MutablePriorityQueue.hpp"
 #include "Utils.hpp"
 
+#include <algorithm>
 #include <limits> // for numeric_limits
 #include <assert.h>
 
@@ -73,7 +74,8 @@ Polyline MotionPlanner::shortest_path(const Point &from, const Point &to)
         if (island_idx_from == idx && island_idx_to == idx) {
             // Since both points are in the same island, is a direct move possible?
             // If so, we avoid generating the visibility environment.
-            if (island.m_island.contains(Line(from, to)))
+            // With both end points inside the island, the line is inside the island if it does not intersect its boundary.
+            if (! island.island_boundary_intersects(Line(from, to)))
                 return Polyline(from, to);
             // Both points are inside a single island, but the straight line crosses the island boundary.
             island_idx = idx;
@@ -81,6 +83,14 @@ Polyline MotionPlanner::shortest_path(const Point &from, const Point &to)
         }
     }
     
+    if (island_idx_from == -1 && island_idx_to == -1) {
+        // Both points are outside of all islands. This is the common case of a travel between objects or around an object.
+        // If the straight line does not cross any island, there is nothing to avoid.
+        Line line(from, to);
+        if (std::none_of(m_islands.begin(), m_islands.end(), [&line](const MotionPlannerEnv &island) { return island.island_boundary_intersects(line); }))
+            return Polyline(from, to);
+    }
+
     // lazy generation of configuration space.
     this->initialize();
 
@@ -227,11 +237,40 @@ const MotionPlannerGraph& MotionPlanner::init_graph(int island_idx)
                 graph->add_edge(v0_idx, v1_idx, (p1 - p0).cast<double>().norm());
             }
         }
+        graph->build_closest_node_lookup();
     }
 
     return *graph;
 }
 
+bool MotionPlannerEnv::island_boundary_intersects(const Line &line) const
+{
+    BoundingBox line_bbox(Point(std::min(line.a(0), line.b(0)), std::min(line.a(1), line.b(1))),
+                          Point(std::max(line.a(0), line.b(0)), std::max(line.a(1), line.b(1))));
+    if (! m_island_bbox.overlap(line_bbox))
+        return false;
+    auto polygon_intersects = [&line, &line_bbox](const Polygon &polygon) {
+        Point ip;
+        for (size_t i = 0; i < polygon.points.size(); ++ i) {
+            const Point &a = polygon.points[i];
+            const Point &b = polygon.points[(i + 1 == polygon.points.size()) ? 0 : i + 1];
+            // Cheap rejection of the segments outside of the bounding box of the line.
+            if ((a(0) < line_bbox.min(0) && b(0) < line_bbox.min(0)) || (a(0) > line_bbox.max(0) && b(0) > line_bbox.max(0)) ||
+                (a(1) < line_bbox.min(1) && b(1) < line_bbox.min(1)) || (a(1) > line_bbox.max(1) && b(1) > line_bbox.max(1)))
+                continue;
+            if (line.intersection(Line(a, b), &ip))
+                return true;
+        }
+        return false;
+    };
+    if (polygon_intersects(m_island.contour))
+        return true;
+    for (const Polygon &hole : m_island.holes)
+        if (polygon_intersects(hole))
+            return true;
+    return false;
+}
+
 // Find a middle point on the path from start_point to end_point with the shortest path.
 static inline size_t nearest_waypoint_index(const Point &start_point, const Points &middle_points, const Point &end_point)
 {
@@ -291,6 +330,15 @@ Point MotionPlannerEnv::nearest_env_point(const Point &from, const Point &to) co
     return pp.empty() ? from : pp.front();
 }
 
+size_t MotionPlannerGraph::find_closest_node(const Point &point) const
+{
+    if (m_nodes.empty())
+        return size_t(-1);
+    size_t idx = find_closest_point(m_closest_node_lookup, point.cast<double>());
+    // Fall back to the linear search if the lookup was not built.
+    return (idx == m_closest_node_lookup.npos) ? point.nearest_point_index(m_nodes) : idx;
+}
+
 // Add a new directed edge to the adjacency graph.
 void MotionPlannerGraph::add_edge(size_t from, size_t to, double weight)
 {
@@ -304,7 +352,9 @@ void MotionPlannerGraph::add_edge(size_t from, size_t to, double weight)
     m_adjacency_list[from].emplace_back(Neighbor(node_t(to), weight));
 }
 
-// Dijkstra's shortest path in a weighted graph from node_start to node_end.
+// A* shortest path in a weighted graph from node_start to node_end.
+// The edge weights are Euclidean lengths of the edges, therefore the Euclidean distance to node_end
+// is a consistent heuristic and the first time a node is popped from the queue, its distance is final.
 // The returned path contains the end points.
 // If no path exists from node_start to node_end, a straight segment is returned.
 Polyline MotionPlannerGraph::shortest_path(size_t node_start, size_t node_end) const
@@ -313,45 +363,56 @@ Polyline MotionPlannerGraph::shortest_path(size_t node_start, size_t node_end) c
     if (this->empty())
         return Polyline();
 
-    // Dijkstra algorithm, previous node of the current node 'u' in the shortest path towards node_start.
-    std::vector<node_t>   previous(m_adjacency_list.size(), -1);
-    std::vector<weight_t> distance(m_adjacency_list.size(), std::numeric_limits<weight_t>::infinity());
-    std::vector<size_t>   map_node_to_queue_id(m_adjacency_list.size(), size_t(-1));
-    distance[node_start] = 0.;
+    // Previous node of the current node 'u' in the shortest path towards node_start.
+    std::vector<node_t>   previous(m_nodes.size(), -1);
+    // Distance from node_start.
+    std::vector<weight_t> distance(m_nodes.size(), std::numeric_limits<weight_t>::infinity());
+    // Distance from node_start plus the estimate of the distance to node_end.
+    std::vector<weight_t> estimate(m_nodes.size(), std::numeric_limits<weight_t>::infinity());
+    std::vector<size_t>   map_node_to_queue_id(m_nodes.size(), size_t(-1));
+    const Vec2d           pt_end = m_nodes[node_end].cast<double>();
+    auto                  heuristic = [this, &pt_end](node_t node) { return (m_nodes[node].cast<double>() - pt_end).norm(); };
 
     auto queue = make_mutable_priority_queue<node_t, false>(
         [&map_node_to_queue_id](const node_t node, size_t idx) { map_node_to_queue_id[node] = idx; },
-        [&distance](const node_t node1, const node_t node2) { return distance[node1] < distance[node2]; });
-    queue.reserve(m_adjacency_list.size());
-    for (size_t i = 0; i < m_adjacency_list.size(); ++ i)
-        queue.push(node_t(i));
+        [&estimate](const node_t node1, const node_t node2) { return estimate[node1] < estimate[node2]; });
+    // Only the nodes reached so far are pushed into the queue.
+    distance[node_start] = 0.;
+    estimate[node_start] = heuristic(node_t(node_start));
+    queue.push(node_t(node_start));
 
     while (! queue.empty()) {
-        // Get the next node with the lowest distance to node_start.
+        // Get the next node with the lowest estimate of the path length from node_start to node_end.
         node_t u = node_t(queue.top());
         queue.pop();
         map_node_to_queue_id[u] = size_t(-1);
         // Stop searching if we reached our destination.
         if (size_t(u) == node_end)
             break;
+        if (size_t(u) >= m_adjacency_list.size())
+            continue;
         // Visit each edge starting at node u.
-        for (const Neighbor& neighbor : m_adjacency_list[u])
-            if (map_node_to_queue_id[neighbor.target] != size_t(-1)) {
-                weight_t alt = distance[u] + neighbor.weight;
-                // If total distance through u is shorter than the previous
-                // distance (if any) between node_start and neighbor.target, replace it.
-                if (alt < distance[neighbor.target]) {
-                    distance[neighbor.target] = alt;
-                    previous[neighbor.target] = u;
+        for (const Neighbor& neighbor : m_adjacency_list[u]) {
+            weight_t alt = distance[u] + neighbor.weight;
+            // If total distance through u is shorter than the previous
+            // distance (if any) between node_start and neighbor.target, replace it.
+            // A node already removed from the queue has its distance final and it will not pass this test.
+            if (alt < distance[neighbor.target]) {
+                distance[neighbor.target] = alt;
+                estimate[neighbor.target] = alt + heuristic(neighbor.target);
+                previous[neighbor.target] = u;
+                if (map_node_to_queue_id[neighbor.target] == size_t(-1))
+                    queue.push(neighbor.target);
+                else
                     queue.update(map_node_to_queue_id[neighbor.target]);
-                }
             }
+        }
     }
 
     // In case the end point was not reached, previous[node_end] contains -1
     // and a straight line from node_start to node_end is returned.
     Polyline polyline;
-    polyline.points.reserve(m_adjacency_list.size());
+    polyline.points.reserve(m_nodes.size());
     for (node_t vertex = node_t(node_end); vertex != -1; vertex = previous[vertex])
         polyline.points.emplace_back(m_nodes[vertex]);
     polyline.points.emplace_back(m_nodes[node_start]);
@@ -5,6 +5,7 @@
 #include "BoundingBox.hpp"
 #include "ClipperUtils.hpp"
 #include "ExPolygonCollection.hpp"
+#include "KDTreeIndirect.hpp"
 #include "Polyline.hpp"
 #include <map>
 #include <utility>
@@ -30,6 +31,8 @@ public:
         { return m_island_bbox.contains(pt) && m_island.contains(pt); }
     bool  island_contains_b(const Point &pt) const
         { return m_island_bbox.contains(pt) && m_island.contains_b(pt); }
+    // Does the line intersect the contour or the holes of the island?
+    bool  island_boundary_intersects(const Line &line) const;
 
 private:
     ExPolygon           m_island;
@@ -38,14 +41,18 @@ private:
     ExPolygonCollection m_env;
 };
 
-// A 2D directed graph for searching a shortest path using the famous Dijkstra algorithm.
+// A 2D directed graph for searching a shortest path using the A* algorithm with an Euclidean heuristic.
 class MotionPlannerGraph
 {    
 public:
+    MotionPlannerGraph() : m_closest_node_lookup(NodeCoordinate(m_nodes)) {}
+
     // Add a directed edge into the graph.
     size_t   add_node(const Point &p) { m_nodes.emplace_back(p); return m_nodes.size() - 1; }
     void     add_edge(size_t from, size_t to, double weight);
-    size_t   find_closest_node(const Point &point) const { return point.nearest_point_index(m_nodes); }
+    // Build the KD tree for find_closest_node() after all the nodes were added.
+    void     build_closest_node_lookup() { m_closest_node_lookup.build(m_nodes.size()); }
+    size_t   find_closest_node(const Point &point) const;
 
     bool     empty() const { return m_adjacency_list.empty(); }
     Polyline shortest_path(size_t from, size_t to) const;
@@ -60,8 +67,14 @@ private:
         node_t   target;
         weight_t weight;
     };
+    struct NodeCoordinate {
+        NodeCoordinate(const Points &nodes) : nodes(nodes) {}
+        double operator()(size_t idx, size_t dimension) const { return double(nodes[idx](dimension)); }
+        const Points &nodes;
+    };
     Points                              m_nodes;
     std::vector<std::vector<Neighbor>>  m_adjacency_list;
+    KDTreeIndirect<2, double, NodeCoordinate> m_closest_node_lookup;
 };
 
 class MotionPlanner
@@ -72,6 +85,9 @@ public:
 
     Polyline    shortest_path(const Point &from, const Point &to);
     size_t      islands_count() const { return m_islands.size(); }
+    // Generate the configuration space. Called lazily by shortest_path(), it may be called ahead
+    // to move the work out of the path search.
+    void        initialize();
 
 private:
     bool                                m_initialized;
@@ -80,7 +96,6 @@ private:
     // 0th graph is the graph for m_outer. Other graphs are 1 indexed.
     std::vector<std::unique_ptr<MotionPlannerGraph>> m_graphs;
     
-    void                      initialize();
     const MotionPlannerGraph& init_graph(int island_idx);
     const MotionPlannerEnv&   get_env(int island_idx) const
         { return (island_idx == -1) ? m_outer : m_islands[island_idx]; }
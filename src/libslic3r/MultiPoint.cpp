@@ -142,70 +142,76 @@ bool MultiPoint::first_intersection(const Line& line, Point* intersection) const
 
 std::vector<Point> MultiPoint::_douglas_peucker(const std::vector<Point>& pts, const double tolerance)
 {
-    std::vector<Point> result_pts;
-	double tolerance_sq = tolerance * tolerance;
-    if (! pts.empty()) {
-        const Point  *anchor      = &pts.front();
-        size_t        anchor_idx  = 0;
-        const Point  *floater     = &pts.back();
-        size_t        floater_idx = pts.size() - 1;
-        result_pts.reserve(pts.size());
-        result_pts.emplace_back(*anchor);
-        if (anchor_idx != floater_idx) {
-            assert(pts.size() > 1);
-            std::vector<size_t> dpStack;
-            dpStack.reserve(pts.size());
-            dpStack.emplace_back(floater_idx);
-            for (;;) {
-                double max_dist_sq  = 0.0;
-                size_t furthest_idx = anchor_idx;
-                // find point furthest from line seg created by (anchor, floater) and note it
-                for (size_t i = anchor_idx + 1; i < floater_idx; ++ i) {
-                    double dist_sq = Line::distance_to_squared(pts[i], *anchor, *floater);
-                    if (dist_sq > max_dist_sq) {
-                        max_dist_sq  = dist_sq;
-                        furthest_idx = i;
-                    }
-                }
-                // remove point if less than tolerance
-                if (max_dist_sq <= tolerance_sq) {
-                    result_pts.emplace_back(*floater);
-                    anchor_idx = floater_idx;
-                    anchor     = floater;
-                    assert(dpStack.back() == floater_idx);
-                    dpStack.pop_back();
-                    if (dpStack.empty())
-                        break;
-                    floater_idx = dpStack.back();
-                } else {
-                    floater_idx = furthest_idx;
-                    dpStack.emplace_back(floater_idx);
-                }
-                floater = &pts[floater_idx];
+    std::vector<Point> result_pts(pts);
+    douglas_peucker(result_pts, tolerance);
+    return result_pts;
+}
+
+void MultiPoint::douglas_peucker(Points &pts, const double tolerance)
+{
+    if (pts.size() < 3)
+        return;
+#if 0
+    const Points pts_orig = pts;
+#endif
+    // The stack of the floater indices is reused by the following calls from the same thread,
+    // so that simplifying the millions of polygons of the sliced layers does not allocate at each call.
+    static thread_local std::vector<size_t> dpStack;
+    double tolerance_sq = tolerance * tolerance;
+    // The points are simplified in place: The kept points are written in front of the anchor,
+    // while only the points behind the anchor are read.
+    size_t        num_kept    = 1;
+    size_t        anchor_idx  = 0;
+    size_t        floater_idx = pts.size() - 1;
+    dpStack.clear();
+    dpStack.emplace_back(floater_idx);
+    for (;;) {
+        const Point &anchor       = pts[anchor_idx];
+        const Point &floater      = pts[floater_idx];
+        double       max_dist_sq  = 0.0;
+        size_t       furthest_idx = anchor_idx;
+        // find point furthest from line seg created by (anchor, floater) and note it
+        for (size_t i = anchor_idx + 1; i < floater_idx; ++ i) {
+            double dist_sq = Line::distance_to_squared(pts[i], anchor, floater);
+            if (dist_sq > max_dist_sq) {
+                max_dist_sq  = dist_sq;
+                furthest_idx = i;
             }
         }
-        assert(result_pts.front() == pts.front());
-        assert(result_pts.back()  == pts.back());
+        // remove point if less than tolerance
+        if (max_dist_sq <= tolerance_sq) {
+            assert(num_kept <= floater_idx);
+            pts[num_kept ++] = floater;
+            anchor_idx = floater_idx;
+            assert(dpStack.back() == floater_idx);
+            dpStack.pop_back();
+            if (dpStack.empty())
+                break;
+            floater_idx = dpStack.back();
+        } else {
+            floater_idx = furthest_idx;
+            dpStack.emplace_back(floater_idx);
+        }
+    }
+    pts.erase(pts.begin() + num_kept, pts.end());
 
 #if 0
-        {
-            static int iRun = 0;
-			BoundingBox bbox(pts);
-			BoundingBox bbox2(result_pts);
+    {
+        static int iRun = 0;
+			BoundingBox bbox(pts_orig);
+			BoundingBox bbox2(pts);
 			bbox.merge(bbox2);
-            SVG svg(debug_out_path("douglas_peucker_%d.svg", iRun ++).c_str(), bbox);
-            if (pts.front() == pts.back())
-                svg.draw(Polygon(pts), "black");
-            else
-                svg.draw(Polyline(pts), "black");
-            if (result_pts.front() == result_pts.back())
-                svg.draw(Polygon(result_pts), "green", scale_(0.1));
-            else
-                svg.draw(Polyline(result_pts), "green", scale_(0.1));
-        }
-#endif
+        SVG svg(debug_out_path("douglas_peucker_%d.svg", iRun ++).c_str(), bbox);
+        if (pts_orig.front() == pts_orig.back())
+            svg.draw(Polygon(pts_orig), "black");
+        else
+            svg.draw(Polyline(pts_orig), "black");
+        if (pts.front() == pts.back())
+            svg.draw(Polygon(pts), "green", scale_(0.1));
+        else
+            svg.draw(Polyline(pts), "green", scale_(0.1));
     }
-    return result_pts;
+#endif
 }
 
 // Visivalingam simplification algorithm https://github.com/slic3r/Slic3r/pull/3825
@@ -42,6 +42,8 @@ public:
     bool   empty() const { return points.empty(); }
     double length() const;
     bool   is_valid() const { return this->points.size() >= 2; }
+    // Heap memory allocated for the points in bytes, including the unused capacity.
+    size_t memsize() const { return this->points.capacity() * sizeof(Point); }
 
     int  find_point(const Point &point) const;
     bool has_boundary_point(const Point &point) const;
@@ -83,6 +85,8 @@ public:
     bool first_intersection(const Line& line, Point* intersection) const;
     
     static Points _douglas_peucker(const Points &points, const double tolerance);
+    // Douglas-Peucker simplification in place, the first and the last point are always kept.
+    static void   douglas_peucker(Points &points, const double tolerance);
     static Points visivalingam(const Points& pts, const double& tolerance);
 };
 
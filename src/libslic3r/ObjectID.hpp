@@ -1,6 +1,9 @@
 #ifndef slic3r_ObjectID_hpp_
 #define slic3r_ObjectID_hpp_
 
+#include <atomic>
+#include <functional>
+
 #include <cereal/access.hpp>
 
 namespace Slic3r {
@@ -40,10 +43,15 @@ private:
 	template<class Archive> void serialize(Archive &ar) { ar(id); }
 };
 
+// To be used by std::unordered_map, std::unordered_set and friends.
+struct ObjectIDHash {
+    size_t operator()(const ObjectID &id) const { return std::hash<size_t>()(id.id); }
+};
+
 // Base for Model, ModelObject, ModelVolume, ModelInstance or ModelMaterial to provide a unique ID
 // to synchronize the front end (UI) with the back end (BackgroundSlicingProcess / Print / PrintObject).
-// Achtung! The s_last_id counter is not thread safe, so it is expected, that the ObjectBase derived instances
-// are only instantiated from the main thread.
+// The s_last_id counter is atomic, so that the ObjectBase derived instances may be created by the worker threads,
+// for example when loading several model files in parallel.
 class ObjectBase
 {
 public:
@@ -72,7 +80,7 @@ private:
     ObjectID                m_id;
 
 	static inline ObjectID  generate_new_id() { return ObjectID(++ s_last_id); }
-    static size_t           s_last_id;
+    static std::atomic<size_t> s_last_id;
 	
 	friend ObjectID wipe_tower_object_id();
 	friend ObjectID wipe_tower_instance_id();
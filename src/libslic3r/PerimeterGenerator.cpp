@@ -1,11 +1,14 @@
 #include "PerimeterGenerator.hpp"
 #include "ClipperUtils.hpp"
 #include "ExtrusionEntityCollection.hpp"
+#include "Layer.hpp"
 #include "ShortestPath.hpp"
 
 #include <cmath>
 #include <cassert>
 
+#include <tbb/parallel_for.h>
+
 namespace Slic3r {
 
 static ExtrusionPaths thick_polyline_to_extrusion_paths(const ThickPolyline &thick_polyline, ExtrusionRole role, Flow &flow, const float tolerance)
@@ -269,230 +272,255 @@ void PerimeterGenerator::process()
         // lower layer, so we take lower slices and offset them by half the nozzle diameter used 
         // in the current layer
         double nozzle_diameter = this->print_config->nozzle_diameter.get_at(this->config->perimeter_extruder-1);
-        m_lower_slices_polygons = offset(*this->lower_slices, float(scale_(+nozzle_diameter/2)));
+        float  delta           = float(scale_(+nozzle_diameter/2));
+        if (this->lower_layer != nullptr && this->lower_slices == &this->lower_layer->lslices)
+            m_lower_slices_polygons_cached = &this->lower_layer->lslices_offset(delta);
+        else
+            m_lower_slices_polygons = offset(*this->lower_slices, delta);
     }
     
+    // Perimeters, gap fill and infill areas of a single island.
+    struct IslandOutput {
+        ExtrusionEntityCollection loops;
+        ExtrusionEntityCollection gap_fill;
+        ExPolygons                fill_expolygons;
+    };
+    std::vector<IslandOutput> islands(this->slices->surfaces.size());
+
     // we need to process each island separately because we might have different
-    // extra perimeters for each one
-    for (const Surface &surface : this->slices->surfaces) {
-        // detect how many perimeters must be generated for this island
-        int        loop_number = this->config->perimeters + surface.extra_perimeters - 1;  // 0-indexed loops
-        ExPolygons last        = union_ex(surface.expolygon.simplify_p(SCALED_RESOLUTION));
-        ExPolygons gaps;
-        if (loop_number >= 0) {
-            // In case no perimeters are to be generated, loop_number will equal to -1.
-            std::vector<PerimeterGeneratorLoops> contours(loop_number+1);    // depth => loops
-            std::vector<PerimeterGeneratorLoops> holes(loop_number+1);       // depth => loops
-            ThickPolylines thin_walls;
-            // we loop one time more than needed in order to find gaps after the last perimeter was applied
-            for (int i = 0;; ++ i) {  // outer loop is 0
-                // Calculate next onion shell of perimeters.
-                ExPolygons offsets;
-                if (i == 0) {
-                    // the minimum thickness of a single loop is:
-                    // ext_width/2 + ext_spacing/2 + spacing/2 + width/2
-                    offsets = this->config->thin_walls ? 
-                        offset2_ex(
-                            last,
-                            - float(ext_perimeter_width / 2. + ext_min_spacing / 2. - 1),
-                            + float(ext_min_spacing / 2. - 1)) :
-                        offset_ex(last, - float(ext_perimeter_width / 2.));
-                    // look for thin walls
-                    if (this->config->thin_walls) {
-                        // the following offset2 ensures almost nothing in @thin_walls is narrower than $min_width
-                        // (actually, something larger than that still may exist due to mitering or other causes)
-                        coord_t min_width = coord_t(scale_(this->ext_perimeter_flow.nozzle_diameter / 3));
-                        ExPolygons expp = offset2_ex(
-                            // medial axis requires non-overlapping geometry
-                            diff_ex(to_polygons(last),
-                                    offset(offsets, float(ext_perimeter_width / 2.)),
-                                    true),
-                            - float(min_width / 2.), float(min_width / 2.));
-                        // the maximum thickness of our thin wall area is equal to the minimum thickness of a single loop
-                        for (ExPolygon &ex : expp)
-                            ex.medial_axis(ext_perimeter_width + ext_perimeter_spacing2, min_width, &thin_walls);
+    // extra perimeters for each one.
+    // The islands are independent, they are processed in parallel. This nests into the parallel loop
+    // over layers in PrintObject::make_perimeters(), which leaves cores idle on layers with many islands.
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, islands.size()),
+        [&](const tbb::blocked_range<size_t> &range) {
+        for (size_t island_idx = range.begin(); island_idx < range.end(); ++ island_idx) {
+            const Surface &surface = this->slices->surfaces[island_idx];
+            IslandOutput  &out     = islands[island_idx];
+            // detect how many perimeters must be generated for this island
+            int        loop_number = this->config->perimeters + surface.extra_perimeters - 1;  // 0-indexed loops
+            ExPolygons last        = union_ex(surface.expolygon.simplify_p(SCALED_RESOLUTION));
+            ExPolygons gaps;
+            if (loop_number >= 0) {
+                // In case no perimeters are to be generated, loop_number will equal to -1.
+                std::vector<PerimeterGeneratorLoops> contours(loop_number+1);    // depth => loops
+                std::vector<PerimeterGeneratorLoops> holes(loop_number+1);       // depth => loops
+                ThickPolylines thin_walls;
+                // we loop one time more than needed in order to find gaps after the last perimeter was applied
+                for (int i = 0;; ++ i) {  // outer loop is 0
+                    // Calculate next onion shell of perimeters.
+                    ExPolygons offsets;
+                    if (i == 0) {
+                        // the minimum thickness of a single loop is:
+                        // ext_width/2 + ext_spacing/2 + spacing/2 + width/2
+                        offsets = this->config->thin_walls ? 
+                            offset2_ex(
+                                last,
+                                - float(ext_perimeter_width / 2. + ext_min_spacing / 2. - 1),
+                                + float(ext_min_spacing / 2. - 1)) :
+                            offset_ex(last, - float(ext_perimeter_width / 2.));
+                        // look for thin walls
+                        if (this->config->thin_walls) {
+                            // the following offset2 ensures almost nothing in @thin_walls is narrower than $min_width
+                            // (actually, something larger than that still may exist due to mitering or other causes)
+                            coord_t min_width = coord_t(scale_(this->ext_perimeter_flow.nozzle_diameter / 3));
+                            ExPolygons expp = offset2_ex(
+                                // medial axis requires non-overlapping geometry
+                                diff_ex(to_polygons(last),
+                                        offset(offsets, float(ext_perimeter_width / 2.)),
+                                        true),
+                                - float(min_width / 2.), float(min_width / 2.));
+                            // the maximum thickness of our thin wall area is equal to the minimum thickness of a single loop
+                            for (ExPolygon &ex : expp)
+                                ex.medial_axis(ext_perimeter_width + ext_perimeter_spacing2, min_width, &thin_walls);
+                        }
+                    } else {
+                        //FIXME Is this offset correct if the line width of the inner perimeters differs
+                        // from the line width of the infill?
+                        coord_t distance = (i == 1) ? ext_perimeter_spacing2 : perimeter_spacing;
+                        offsets = this->config->thin_walls ?
+                            // This path will ensure, that the perimeters do not overfill, as in 
+                            // prusa3d/Slic3r GH #32, but with the cost of rounding the perimeters
+                            // excessively, creating gaps, which then need to be filled in by the not very 
+                            // reliable gap fill algorithm.
+                            // Also the offset2(perimeter, -x, x) may sometimes lead to a perimeter, which is larger than
+                            // the original.
+                            offset2_ex(last,
+                                    - float(distance + min_spacing / 2. - 1.),
+                                    float(min_spacing / 2. - 1.)) :
+                            // If "detect thin walls" is not enabled, this paths will be entered, which 
+                            // leads to overflows, as in prusa3d/Slic3r GH #32
+                            offset_ex(last, - float(distance));
+                        // look for gaps
+                        if (has_gap_fill)
+                            // not using safety offset here would "detect" very narrow gaps
+                            // (but still long enough to escape the area threshold) that gap fill
+                            // won't be able to fill but we'd still remove from infill area
+                            append(gaps, diff_ex(
+                                offset(last,    - float(0.5 * distance)),
+                                offset(offsets,   float(0.5 * distance + 10))));  // safety offset
                     }
-                } else {
-                    //FIXME Is this offset correct if the line width of the inner perimeters differs
-                    // from the line width of the infill?
-                    coord_t distance = (i == 1) ? ext_perimeter_spacing2 : perimeter_spacing;
-                    offsets = this->config->thin_walls ?
-                        // This path will ensure, that the perimeters do not overfill, as in 
-                        // prusa3d/Slic3r GH #32, but with the cost of rounding the perimeters
-                        // excessively, creating gaps, which then need to be filled in by the not very 
-                        // reliable gap fill algorithm.
-                        // Also the offset2(perimeter, -x, x) may sometimes lead to a perimeter, which is larger than
-                        // the original.
-                        offset2_ex(last,
-                                - float(distance + min_spacing / 2. - 1.),
-                                float(min_spacing / 2. - 1.)) :
-                        // If "detect thin walls" is not enabled, this paths will be entered, which 
-                        // leads to overflows, as in prusa3d/Slic3r GH #32
-                        offset_ex(last, - float(distance));
-                    // look for gaps
-                    if (has_gap_fill)
-                        // not using safety offset here would "detect" very narrow gaps
-                        // (but still long enough to escape the area threshold) that gap fill
-                        // won't be able to fill but we'd still remove from infill area
-                        append(gaps, diff_ex(
-                            offset(last,    - float(0.5 * distance)),
-                            offset(offsets,   float(0.5 * distance + 10))));  // safety offset
-                }
-                if (offsets.empty()) {
-                    // Store the number of loops actually generated.
-                    loop_number = i - 1;
-                    // No region left to be filled in.
-                    last.clear();
-                    break;
-                } else if (i > loop_number) {
-                    // If i > loop_number, we were looking just for gaps.
-                    break;
-                }
-                for (const ExPolygon &expolygon : offsets) {
-	                // Outer contour may overlap with an inner contour,
-	                // inner contour may overlap with another inner contour,
-	                // outer contour may overlap with itself.
-	                //FIXME evaluate the overlaps, annotate each point with an overlap depth,
-	                // compensate for the depth of intersection.
-                    contours[i].emplace_back(PerimeterGeneratorLoop(expolygon.contour, i, true));
-                    if (! expolygon.holes.empty()) {
-                        holes[i].reserve(holes[i].size() + expolygon.holes.size());
-                        for (const Polygon &hole : expolygon.holes)
-                            holes[i].emplace_back(PerimeterGeneratorLoop(hole, i, false));
+                    if (offsets.empty()) {
+                        // Store the number of loops actually generated.
+                        loop_number = i - 1;
+                        // No region left to be filled in.
+                        last.clear();
+                        break;
+                    } else if (i > loop_number) {
+                        // If i > loop_number, we were looking just for gaps.
+                        break;
+                    }
+                    for (const ExPolygon &expolygon : offsets) {
+    	                // Outer contour may overlap with an inner contour,
+    	                // inner contour may overlap with another inner contour,
+    	                // outer contour may overlap with itself.
+    	                //FIXME evaluate the overlaps, annotate each point with an overlap depth,
+    	                // compensate for the depth of intersection.
+                        contours[i].emplace_back(PerimeterGeneratorLoop(expolygon.contour, i, true));
+                        if (! expolygon.holes.empty()) {
+                            holes[i].reserve(holes[i].size() + expolygon.holes.size());
+                            for (const Polygon &hole : expolygon.holes)
+                                holes[i].emplace_back(PerimeterGeneratorLoop(hole, i, false));
+                        }
+                    }
+                    last = std::move(offsets);
+                    if (i == loop_number && (! has_gap_fill || this->config->fill_density.value == 0)) {
+                    	// The last run of this loop is executed to collect gaps for gap fill.
+                    	// As the gap fill is either disabled or not 
+                    	break;
                     }
                 }
-                last = std::move(offsets);
-                if (i == loop_number && (! has_gap_fill || this->config->fill_density.value == 0)) {
-                	// The last run of this loop is executed to collect gaps for gap fill.
-                	// As the gap fill is either disabled or not 
-                	break;
-                }
-            }
 
-            // nest loops: holes first
-            for (int d = 0; d <= loop_number; ++ d) {
-                PerimeterGeneratorLoops &holes_d = holes[d];
-                // loop through all holes having depth == d
-                for (int i = 0; i < (int)holes_d.size(); ++ i) {
-                    const PerimeterGeneratorLoop &loop = holes_d[i];
-                    // find the hole loop that contains this one, if any
-                    for (int t = d + 1; t <= loop_number; ++ t) {
-                        for (int j = 0; j < (int)holes[t].size(); ++ j) {
-                            PerimeterGeneratorLoop &candidate_parent = holes[t][j];
-                            if (candidate_parent.polygon.contains(loop.polygon.first_point())) {
-                                candidate_parent.children.push_back(loop);
-                                holes_d.erase(holes_d.begin() + i);
-                                -- i;
-                                goto NEXT_LOOP;
+                // nest loops: holes first
+                for (int d = 0; d <= loop_number; ++ d) {
+                    PerimeterGeneratorLoops &holes_d = holes[d];
+                    // loop through all holes having depth == d
+                    for (int i = 0; i < (int)holes_d.size(); ++ i) {
+                        const PerimeterGeneratorLoop &loop = holes_d[i];
+                        // find the hole loop that contains this one, if any
+                        for (int t = d + 1; t <= loop_number; ++ t) {
+                            for (int j = 0; j < (int)holes[t].size(); ++ j) {
+                                PerimeterGeneratorLoop &candidate_parent = holes[t][j];
+                                if (candidate_parent.polygon.contains(loop.polygon.first_point())) {
+                                    candidate_parent.children.push_back(loop);
+                                    holes_d.erase(holes_d.begin() + i);
+                                    -- i;
+                                    goto NEXT_LOOP;
+                                }
                             }
                         }
-                    }
-                    // if no hole contains this hole, find the contour loop that contains it
-                    for (int t = loop_number; t >= 0; -- t) {
-                        for (int j = 0; j < (int)contours[t].size(); ++ j) {
-                            PerimeterGeneratorLoop &candidate_parent = contours[t][j];
-                            if (candidate_parent.polygon.contains(loop.polygon.first_point())) {
-                                candidate_parent.children.push_back(loop);
-                                holes_d.erase(holes_d.begin() + i);
-                                -- i;
-                                goto NEXT_LOOP;
+                        // if no hole contains this hole, find the contour loop that contains it
+                        for (int t = loop_number; t >= 0; -- t) {
+                            for (int j = 0; j < (int)contours[t].size(); ++ j) {
+                                PerimeterGeneratorLoop &candidate_parent = contours[t][j];
+                                if (candidate_parent.polygon.contains(loop.polygon.first_point())) {
+                                    candidate_parent.children.push_back(loop);
+                                    holes_d.erase(holes_d.begin() + i);
+                                    -- i;
+                                    goto NEXT_LOOP;
+                                }
                             }
                         }
+                        NEXT_LOOP: ;
                     }
-                    NEXT_LOOP: ;
                 }
-            }
-            // nest contour loops
-            for (int d = loop_number; d >= 1; -- d) {
-                PerimeterGeneratorLoops &contours_d = contours[d];
-                // loop through all contours having depth == d
-                for (int i = 0; i < (int)contours_d.size(); ++ i) {
-                    const PerimeterGeneratorLoop &loop = contours_d[i];
-                    // find the contour loop that contains it
-                    for (int t = d - 1; t >= 0; -- t) {
-                        for (size_t j = 0; j < contours[t].size(); ++ j) {
-                            PerimeterGeneratorLoop &candidate_parent = contours[t][j];
-                            if (candidate_parent.polygon.contains(loop.polygon.first_point())) {
-                                candidate_parent.children.push_back(loop);
-                                contours_d.erase(contours_d.begin() + i);
-                                -- i;
-                                goto NEXT_CONTOUR;
+                // nest contour loops
+                for (int d = loop_number; d >= 1; -- d) {
+                    PerimeterGeneratorLoops &contours_d = contours[d];
+                    // loop through all contours having depth == d
+                    for (int i = 0; i < (int)contours_d.size(); ++ i) {
+                        const PerimeterGeneratorLoop &loop = contours_d[i];
+                        // find the contour loop that contains it
+                        for (int t = d - 1; t >= 0; -- t) {
+                            for (size_t j = 0; j < contours[t].size(); ++ j) {
+                                PerimeterGeneratorLoop &candidate_parent = contours[t][j];
+                                if (candidate_parent.polygon.contains(loop.polygon.first_point())) {
+                                    candidate_parent.children.push_back(loop);
+                                    contours_d.erase(contours_d.begin() + i);
+                                    -- i;
+                                    goto NEXT_CONTOUR;
+                                }
                             }
                         }
+                        NEXT_CONTOUR: ;
                     }
-                    NEXT_CONTOUR: ;
                 }
-            }
-            // at this point, all loops should be in contours[0]
-            ExtrusionEntityCollection entities = traverse_loops(*this, contours.front(), thin_walls);
-            // if brim will be printed, reverse the order of perimeters so that
-            // we continue inwards after having finished the brim
-            // TODO: add test for perimeter order
-            if (this->config->external_perimeters_first || 
-                (this->layer_id == 0 && this->print_config->brim_width.value > 0))
-                entities.reverse();
-            // append perimeters for this slice as a collection
-            if (! entities.empty())
-                this->loops->append(entities);
-        } // for each loop of an island
+                // at this point, all loops should be in contours[0]
+                ExtrusionEntityCollection entities = traverse_loops(*this, contours.front(), thin_walls);
+                // if brim will be printed, reverse the order of perimeters so that
+                // we continue inwards after having finished the brim
+                // TODO: add test for perimeter order
+                if (this->config->external_perimeters_first || 
+                    (this->layer_id == 0 && this->print_config->brim_width.value > 0))
+                    entities.reverse();
+                // append perimeters for this slice as a collection
+                if (! entities.empty())
+                    out.loops = std::move(entities);
+            } // for each loop of an island
 
-        // fill gaps
-        if (! gaps.empty()) {
-            // collapse 
-            double min = 0.2 * perimeter_width * (1 - INSET_OVERLAP_TOLERANCE);
-            double max = 2. * perimeter_spacing;
-            ExPolygons gaps_ex = diff_ex(
-                //FIXME offset2 would be enough and cheaper.
-                offset2_ex(gaps, - float(min / 2.), float(min / 2.)),
-                offset2_ex(gaps, - float(max / 2.), float(max / 2.)),
-                true);
-            ThickPolylines polylines;
-            for (const ExPolygon &ex : gaps_ex)
-                ex.medial_axis(max, min, &polylines);
-            if (! polylines.empty()) {
-				ExtrusionEntityCollection gap_fill;
-				variable_width(polylines, erGapFill, this->solid_infill_flow, gap_fill.entities);
-                /*  Make sure we don't infill narrow parts that are already gap-filled
-                    (we only consider this surface's gaps to reduce the diff() complexity).
-                    Growing actual extrusions ensures that gaps not filled by medial axis
-                    are not subtracted from fill surfaces (they might be too short gaps
-                    that medial axis skips but infill might join with other infill regions
-                    and use zigzag).  */
-                //FIXME Vojtech: This grows by a rounded extrusion width, not by line spacing,
-                // therefore it may cover the area, but no the volume.
-                last = diff_ex(to_polygons(last), gap_fill.polygons_covered_by_width(10.f));
-				this->gap_fill->append(std::move(gap_fill.entities));
-			}
-        }
+            // fill gaps
+            if (! gaps.empty()) {
+                // collapse 
+                double min = 0.2 * perimeter_width * (1 - INSET_OVERLAP_TOLERANCE);
+                double max = 2. * perimeter_spacing;
+                ExPolygons gaps_ex = diff_ex(
+                    //FIXME offset2 would be enough and cheaper.
+                    offset2_ex(gaps, - float(min / 2.), float(min / 2.)),
+                    offset2_ex(gaps, - float(max / 2.), float(max / 2.)),
+                    true);
+                ThickPolylines polylines;
+                for (const ExPolygon &ex : gaps_ex)
+                    ex.medial_axis(max, min, &polylines);
+                if (! polylines.empty()) {
+    				ExtrusionEntityCollection gap_fill;
+    				variable_width(polylines, erGapFill, this->solid_infill_flow, gap_fill.entities);
+                    /*  Make sure we don't infill narrow parts that are already gap-filled
+                        (we only consider this surface's gaps to reduce the diff() complexity).
+                        Growing actual extrusions ensures that gaps not filled by medial axis
+                        are not subtracted from fill surfaces (they might be too short gaps
+                        that medial axis skips but infill might join with other infill regions
+                        and use zigzag).  */
+                    //FIXME Vojtech: This grows by a rounded extrusion width, not by line spacing,
+                    // therefore it may cover the area, but no the volume.
+                    last = diff_ex(to_polygons(last), gap_fill.polygons_covered_by_width(10.f));
+    				out.gap_fill = std::move(gap_fill);
+    			}
+            }
 
-        // create one more offset to be used as boundary for fill
-        // we offset by half the perimeter spacing (to get to the actual infill boundary)
-        // and then we offset back and forth by half the infill spacing to only consider the
-        // non-collapsing regions
-        coord_t inset = 
-            (loop_number < 0) ? 0 :
-            (loop_number == 0) ?
-                // one loop
-                ext_perimeter_spacing / 2 :
-                // two or more loops?
-                perimeter_spacing / 2;
-        // only apply infill overlap if we actually have one perimeter
-        if (inset > 0)
-            inset -= coord_t(scale_(this->config->get_abs_value("infill_overlap", unscale<double>(inset + solid_infill_spacing / 2))));
-        // simplify infill contours according to resolution
-        Polygons pp;
-        for (ExPolygon &ex : last)
-            ex.simplify_p(SCALED_RESOLUTION, &pp);
-        // collapse too narrow infill areas
-        coord_t min_perimeter_infill_spacing = coord_t(solid_infill_spacing * (1. - INSET_OVERLAP_TOLERANCE));
-        // append infill areas to fill_surfaces
-        this->fill_surfaces->append(
-            offset2_ex(
+            // create one more offset to be used as boundary for fill
+            // we offset by half the perimeter spacing (to get to the actual infill boundary)
+            // and then we offset back and forth by half the infill spacing to only consider the
+            // non-collapsing regions
+            coord_t inset = 
+                (loop_number < 0) ? 0 :
+                (loop_number == 0) ?
+                    // one loop
+                    ext_perimeter_spacing / 2 :
+                    // two or more loops?
+                    perimeter_spacing / 2;
+            // only apply infill overlap if we actually have one perimeter
+            if (inset > 0)
+                inset -= coord_t(scale_(this->config->get_abs_value("infill_overlap", unscale<double>(inset + solid_infill_spacing / 2))));
+            // simplify infill contours according to resolution
+            Polygons pp;
+            for (ExPolygon &ex : last)
+                ex.simplify_p(SCALED_RESOLUTION, &pp);
+            // collapse too narrow infill areas
+            coord_t min_perimeter_infill_spacing = coord_t(solid_infill_spacing * (1. - INSET_OVERLAP_TOLERANCE));
+            // append infill areas to fill_surfaces
+            out.fill_expolygons = offset2_ex(
                 union_ex(pp),
                 float(- inset - min_perimeter_infill_spacing / 2.),
-                float(min_perimeter_infill_spacing / 2.)),
-            stInternal);
-    } // for each island
+                float(min_perimeter_infill_spacing / 2.));
+        } // for each island
+    });
+
+    // Collect the results in the order of the islands.
+    for (IslandOutput &island : islands) {
+        if (! island.loops.empty())
+            this->loops->append(std::move(island.loops));
+        this->gap_fill->append(std::move(island.gap_fill.entities));
+        this->fill_surfaces->append(std::move(island.fill_expolygons), stInternal);
+    }
 }
 
 bool PerimeterGeneratorLoop::is_internal_contour() const
@@ -10,11 +10,16 @@
 
 namespace Slic3r {
 
+class Layer;
+
 class PerimeterGenerator {
 public:
     // Inputs:
     const SurfaceCollection     *slices;
     const ExPolygons            *lower_slices;
+    // If lower_slices are the lslices of this layer, the offset of lower_slices for the overhang detection is shared
+    // with the other regions of the layer above through Layer::lslices_offset().
+    const Layer                 *lower_layer;
     double                       layer_height;
     int                          layer_id;
     Flow                         perimeter_flow;
@@ -44,7 +49,7 @@ public:
         ExtrusionEntityCollection*  gap_fill,
         // Infills without the gap fills
         SurfaceCollection*          fill_surfaces)
-        : slices(slices), lower_slices(nullptr), layer_height(layer_height),
+        : slices(slices), lower_slices(nullptr), lower_layer(nullptr), layer_height(layer_height),
             layer_id(-1), perimeter_flow(flow), ext_perimeter_flow(flow),
             overhang_flow(flow), solid_infill_flow(flow),
             config(config), object_config(object_config), print_config(print_config),
@@ -57,13 +62,15 @@ public:
     double      ext_mm3_per_mm()        const { return m_ext_mm3_per_mm; }
     double      mm3_per_mm()            const { return m_mm3_per_mm; }
     double      mm3_per_mm_overhang()   const { return m_mm3_per_mm_overhang; }
-    Polygons    lower_slices_polygons() const { return m_lower_slices_polygons; }
+    const Polygons& lower_slices_polygons() const { return m_lower_slices_polygons_cached ? *m_lower_slices_polygons_cached : m_lower_slices_polygons; }
 
 private:
     double      m_ext_mm3_per_mm;
     double      m_mm3_per_mm;
     double      m_mm3_per_mm_overhang;
     Polygons    m_lower_slices_polygons;
+    // Offset of lower_slices cached by lower_layer, if set, m_lower_slices_polygons is left empty.
+    const Polygons *m_lower_slices_polygons_cached { nullptr };
 };
 
 }
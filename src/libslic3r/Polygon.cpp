@@ -122,13 +122,13 @@ Polygons Polygon::simplify(double tolerance) const
 {
     // repeat first point at the end in order to apply Douglas-Peucker
     // on the whole polygon
-    Points points = this->points;
+    Polygons pp(1);
+    Points &points = pp.front().points;
+    points.reserve(this->points.size() + 1);
+    points = this->points;
     points.push_back(points.front());
-    Polygon p(MultiPoint::_douglas_peucker(points, tolerance));
-    p.points.pop_back();
-    
-    Polygons pp;
-    pp.push_back(p);
+    MultiPoint::douglas_peucker(points, tolerance);
+    points.pop_back();
     return simplify_polygons(pp);
 }
 
@@ -95,6 +95,15 @@ extern void 	   remove_collinear(Polygon &poly);
 extern void 	   remove_collinear(Polygons &polys);
 
 // Append a vector of polygons at the end of another vector of polygons.
+// Heap memory allocated by the polygons in bytes, including the unused capacity.
+inline size_t memsize(const Polygons &polys)
+{
+    size_t n = polys.capacity() * sizeof(Polygon);
+    for (const Polygon &poly : polys)
+        n += poly.memsize();
+    return n;
+}
+
 inline void        polygons_append(Polygons &dst, const Polygons &src) { dst.insert(dst.end(), src.begin(), src.end()); }
 
 inline void        polygons_append(Polygons &dst, Polygons &&src) 
@@ -96,6 +96,15 @@ inline double total_length(const Polylines &polylines) {
     return total;
 }
 
+// Heap memory allocated by the polylines in bytes, including the unused capacity.
+inline size_t memsize(const Polylines &polylines)
+{
+    size_t n = polylines.capacity() * sizeof(Polyline);
+    for (const Polyline &polyline : polylines)
+        n += polyline.memsize();
+    return n;
+}
+
 inline Lines to_lines(const Polyline &poly) 
 {
     Lines lines;
@@ -11,6 +11,7 @@
 #include "SupportMaterial.hpp"
 #include "GCode.hpp"
 #include "GCode/WipeTower.hpp"
+#include "Trace.hpp"
 #include "Utils.hpp"
 
 //#include "PrintExport.hpp"
@@ -19,11 +20,17 @@
 
 #include <algorithm>
 #include <limits>
+#include <numeric>
+#include <unordered_map>
 #include <unordered_set>
+#include <boost/algorithm/string/predicate.hpp>
 #include <boost/filesystem/path.hpp>
 #include <boost/format.hpp>
 #include <boost/log/trivial.hpp>
 
+#include <tbb/atomic.h>
+#include <tbb/parallel_for.h>
+
 //! macro used to mark string used at localization,
 //! return same string
 #define L(s) Slic3r::I18N::translate(s)
@@ -47,15 +54,9 @@ void Print::clear()
     m_model.clear_objects();
 }
 
-PrintRegion* Print::add_region()
-{
-    m_regions.emplace_back(new PrintRegion(this));
-    return m_regions.back();
-}
-
-PrintRegion* Print::add_region(const PrintRegionConfig &config)
+PrintRegion* Print::add_region(std::shared_ptr<const PrintRegionConfig> config)
 {
-    m_regions.emplace_back(new PrintRegion(this, config));
+    m_regions.emplace_back(new PrintRegion(this, std::move(config)));
     return m_regions.back();
 }
 
@@ -69,11 +70,14 @@ bool Print::invalidate_state_by_config_options(const std::vector<t_config_option
     // Cache the plenty of parameters, which influence the G-code generator only,
     // or they are only notes not influencing the generated G-code.
     static std::unordered_set<std::string> steps_gcode = {
+        "arc_fitting",
+        "arc_fitting_tolerance",
         "avoid_crossing_perimeters",
         "bed_shape",
         "bed_temperature",
         "before_layer_gcode",
         "between_objects_gcode",
+        "binary_gcode",
         "bridge_acceleration",
         "bridge_fan_speed",
         "colorprint_heights",
@@ -422,6 +426,25 @@ static inline void layer_height_ranges_copy_configs(t_layer_config_ranges &lr_ds
     }
 }
 
+// Returns true if the two PrintObjects have the same volumes assigned to region_id.
+static inline bool region_volumes_equal(const std::vector<std::vector<std::pair<t_layer_height_range, int>>> &rv1, const std::vector<std::vector<std::pair<t_layer_height_range, int>>> &rv2, size_t region_id)
+{
+    bool empty1 = region_id >= rv1.size() || rv1[region_id].empty();
+    bool empty2 = region_id >= rv2.size() || rv2[region_id].empty();
+    return (empty1 && empty2) || (! empty1 && ! empty2 && rv1[region_id] == rv2[region_id]);
+}
+
+// Returns true if the two ModelObjects contain the same ModelInstances (by their IDs) in the same order.
+static inline bool model_instance_list_equal_ids(const ModelObject &model_object_old, const ModelObject &model_object_new)
+{
+    if (model_object_old.instances.size() != model_object_new.instances.size())
+        return false;
+    for (size_t i = 0; i < model_object_old.instances.size(); ++ i)
+        if (model_object_old.instances[i]->id() != model_object_new.instances[i]->id())
+            return false;
+    return true;
+}
+
 static inline bool transform3d_lower(const Transform3d &lhs, const Transform3d &rhs) 
 {
     typedef Transform3d::Scalar T;
@@ -454,26 +477,96 @@ struct PrintInstances
     bool operator<(const PrintInstances &rhs) const { return transform3d_lower(this->trafo, rhs.trafo); }
 };
 
-// Generate a list of trafos and XY offsets for instances of a ModelObject
-static std::vector<PrintInstances> print_objects_from_model_object(const ModelObject &model_object)
+// Generate a list of trafos and XY offsets for instances of ModelObjects sharing their PrintObjects.
+static std::vector<PrintInstances> print_objects_from_model_objects(const std::vector<const ModelObject*> &model_objects)
 {
     std::set<PrintInstances> trafos;
     PrintInstances           trafo;
     trafo.copies.assign(1, Point());
-    for (ModelInstance *model_instance : model_object.instances)
-        if (model_instance->is_printable()) {
-            trafo.trafo = model_instance->get_matrix();
-            // Set the Z axis of the transformation.
-            trafo.copies.front() = Point::new_scale(trafo.trafo.data()[12], trafo.trafo.data()[13]);
-            trafo.trafo.data()[12] = 0;
-            trafo.trafo.data()[13] = 0;
-            auto it = trafos.find(trafo);
-            if (it == trafos.end())
-                trafos.emplace(trafo);
-            else
-                const_cast<PrintInstances&>(*it).copies.emplace_back(trafo.copies.front());
-        }
-    return std::vector<PrintInstances>(trafos.begin(), trafos.end());
+    for (const ModelObject *model_object : model_objects)
+        for (ModelInstance *model_instance : model_object->instances)
+            if (model_instance->is_printable()) {
+                trafo.trafo = model_instance->get_matrix();
+                // Set the Z axis of the transformation.
+                trafo.copies.front() = Point::new_scale(trafo.trafo.data()[12], trafo.trafo.data()[13]);
+                trafo.trafo.data()[12] = 0;
+                trafo.trafo.data()[13] = 0;
+                auto it = trafos.find(trafo);
+                if (it == trafos.end())
+                    trafos.emplace(trafo);
+                else
+                    const_cast<PrintInstances&>(*it).copies.emplace_back(trafo.copies.front());
+            }
+    // Move the copies out of the set, with thousands of instances the copies dominate the memory traffic.
+    std::vector<PrintInstances> out;
+    out.reserve(trafos.size());
+    for (const PrintInstances &print_instances : trafos)
+        out.emplace_back(std::move(const_cast<PrintInstances&>(print_instances)));
+    return out;
+}
+
+static bool model_volume_meshes_equal(const ModelVolume &mv1, const ModelVolume &mv2)
+{
+    const TriangleMesh &m1 = mv1.mesh();
+    const TriangleMesh &m2 = mv2.mesh();
+    if (&m1 == &m2)
+        // Copy / pasted volumes share their meshes.
+        return true;
+    if (m1.stl.facet_start.size() != m2.stl.facet_start.size())
+        return false;
+    for (size_t i = 0; i < m1.stl.facet_start.size(); ++ i) {
+        const stl_facet &f1 = m1.stl.facet_start[i];
+        const stl_facet &f2 = m2.stl.facet_start[i];
+        if (f1.vertex[0] != f2.vertex[0] || f1.vertex[1] != f2.vertex[1] || f1.vertex[2] != f2.vertex[2])
+            return false;
+    }
+    return true;
+}
+
+// Returns true if the two ModelObjects differ just by their instances, thus their printable instances
+// may be printed as copies of the same PrintObjects. The volumes (their type, mesh, transformation and config),
+// the object config, the layer height profile and the layer ranges have to be the same.
+static bool model_objects_printed_equal(const ModelObject &mo1, const ModelObject &mo2)
+{
+    if (mo1.volumes.size() != mo2.volumes.size() ||
+        mo1.origin_translation != mo2.origin_translation ||
+        mo1.config != mo2.config ||
+        mo1.layer_height_profile != mo2.layer_height_profile ||
+        mo1.layer_config_ranges != mo2.layer_config_ranges)
+        return false;
+    for (size_t i = 0; i < mo1.volumes.size(); ++ i) {
+        const ModelVolume &mv1 = *mo1.volumes[i];
+        const ModelVolume &mv2 = *mo2.volumes[i];
+        if (mv1.type() != mv2.type() ||
+            mv1.get_matrix().matrix() != mv2.get_matrix().matrix() ||
+            mv1.config != mv2.config ||
+            ! model_volume_meshes_equal(mv1, mv2))
+            return false;
+    }
+    return true;
+}
+
+// For each ModelObject, find the first ModelObject, which is printed the same way, so that a single set of PrintObjects
+// is sliced for both of them. ModelObjects pasted or imported multiple times are then sliced just once.
+// With complete_objects, the objects are printed one by one in the order of the ModelObjects, thus they are not merged.
+static std::vector<size_t> model_objects_printed_by(const ModelObjectPtrs &model_objects, bool merge)
+{
+    std::vector<size_t> out(model_objects.size());
+    // Candidates for merging, bucketed by the number of their volumes and by the number of triangles of their first volume.
+    std::map<std::pair<size_t, size_t>, std::vector<size_t>> candidates;
+    for (size_t i = 0; i < model_objects.size(); ++ i) {
+        const ModelObject &model_object = *model_objects[i];
+        out[i] = i;
+        if (! merge || model_object.volumes.empty())
+            continue;
+        std::vector<size_t> &bucket = candidates[std::make_pair(model_object.volumes.size(), model_object.volumes.front()->mesh().stl.facet_start.size())];
+        auto it = std::find_if(bucket.begin(), bucket.end(), [&model_objects, &model_object](size_t j){ return model_objects_printed_equal(*model_objects[j], model_object); });
+        if (it == bucket.end())
+            bucket.emplace_back(i);
+        else
+            out[i] = *it;
+    }
+    return out;
 }
 
 // Compare just the layer ranges and their layer heights, not the associated configs.
@@ -699,9 +792,12 @@ Print::ApplyStatus Print::apply(const Model &model, DynamicPrintConfig new_full_
         Status       status;
         LayerRanges  layer_ranges;
         // Search by id.
-        bool operator<(const ModelObjectStatus &rhs) const { return id < rhs.id; }
+        bool operator==(const ModelObjectStatus &rhs) const { return id == rhs.id; }
+        struct Hash { size_t operator()(const ModelObjectStatus &s) const { return ObjectIDHash()(s.id); } };
     };
-    std::set<ModelObjectStatus> model_object_status;
+    // Hashed by the ModelObject ID, the status is looked up multiple times for each PrintObject.
+    std::unordered_set<ModelObjectStatus, ModelObjectStatus::Hash> model_object_status;
+    model_object_status.reserve(std::max(m_model.objects.size(), model.objects.size()) + m_objects.size());
 
     // 1) Synchronize model objects.
     if (model.id() != m_model.id()) {
@@ -819,9 +915,11 @@ Print::ApplyStatus Print::apply(const Model &model, DynamicPrintConfig new_full_
         Transform3d      trafo;
         Status           status;
         // Search by id.
-        bool operator<(const PrintObjectStatus &rhs) const { return id < rhs.id; }
+        bool operator==(const PrintObjectStatus &rhs) const { return id == rhs.id; }
+        struct Hash { size_t operator()(const PrintObjectStatus &s) const { return ObjectIDHash()(s.id); } };
     };
-    std::multiset<PrintObjectStatus> print_object_status;
+    std::unordered_multiset<PrintObjectStatus, PrintObjectStatus::Hash> print_object_status;
+    print_object_status.reserve(m_objects.size());
     for (PrintObject *print_object : m_objects)
         print_object_status.emplace(PrintObjectStatus(print_object));
 
@@ -891,11 +989,22 @@ Print::ApplyStatus Print::apply(const Model &model, DynamicPrintConfig new_full_
             // Copy the ModelObject name, input_file and instances. The instances will be compared against PrintObject instances in the next step.
             model_object.name       = model_object_new.name;
             model_object.input_file = model_object_new.input_file;
-            model_object.clear_instances();
-            model_object.instances.reserve(model_object_new.instances.size());
-            for (const ModelInstance *model_instance : model_object_new.instances) {
-                model_object.instances.emplace_back(new ModelInstance(*model_instance));
-                model_object.instances.back()->set_model_object(&model_object);
+            if (model_instance_list_equal_ids(model_object, model_object_new)) {
+                // The same instances, just possibly moved. Update them in place instead of reallocating thousands of them.
+                for (size_t i = 0; i < model_object.instances.size(); ++ i) {
+                    ModelInstance       &dst = *model_object.instances[i];
+                    const ModelInstance &src = *model_object_new.instances[i];
+                    dst.set_transformation(src.get_transformation());
+                    dst.print_volume_state = src.print_volume_state;
+                    dst.printable          = src.printable;
+                }
+            } else {
+                model_object.clear_instances();
+                model_object.instances.reserve(model_object_new.instances.size());
+                for (const ModelInstance *model_instance : model_object_new.instances) {
+                    model_object.instances.emplace_back(new ModelInstance(*model_instance));
+                    model_object.instances.back()->set_model_object(&model_object);
+                }
             }
         }
     }
@@ -905,8 +1014,17 @@ Print::ApplyStatus Print::apply(const Model &model, DynamicPrintConfig new_full_
         std::vector<PrintObject*> print_objects_new;
         print_objects_new.reserve(std::max(m_objects.size(), m_model.objects.size()));
         bool new_objects = false;
+        std::vector<size_t> printed_by = model_objects_printed_by(m_model.objects, ! m_config.complete_objects.value);
+        // For each ModelObject printing its own PrintObjects, list the ModelObjects printed by them.
+        std::vector<std::vector<const ModelObject*>> model_objects_printed(m_model.objects.size());
+        for (size_t i = 0; i < m_model.objects.size(); ++ i)
+            model_objects_printed[printed_by[i]].emplace_back(m_model.objects[i]);
         // Walk over all new model objects and check, whether there are matching PrintObjects.
-        for (ModelObject *model_object : m_model.objects) {
+        for (size_t idx_model_object = 0; idx_model_object < m_model.objects.size(); ++ idx_model_object) {
+            if (printed_by[idx_model_object] != idx_model_object)
+                // Printed by the PrintObjects of an identical ModelObject.
+                continue;
+            ModelObject *model_object = m_model.objects[idx_model_object];
             auto range = print_object_status.equal_range(PrintObjectStatus(model_object->id()));
             std::vector<const PrintObjectStatus*> old;
             if (range.first != range.second) {
@@ -917,7 +1035,7 @@ Print::ApplyStatus Print::apply(const Model &model, DynamicPrintConfig new_full_
             }
             // Generate a list of trafos and XY offsets for instances of a ModelObject
             PrintObjectConfig config = PrintObject::object_config_from_model_object(m_default_object_config, *model_object, num_extruders);
-            std::vector<PrintInstances> new_print_instances = print_objects_from_model_object(*model_object);
+            std::vector<PrintInstances> new_print_instances = print_objects_from_model_objects(model_objects_printed[idx_model_object]);
             if (old.empty()) {
                 // Simple case, just generate new instances.
                 for (const PrintInstances &print_instances : new_print_instances) {
@@ -996,10 +1114,16 @@ Print::ApplyStatus Print::apply(const Model &model, DynamicPrintConfig new_full_
     // All regions now have distinct settings.
     // Check whether applying the new region config defaults we'd get different regions.
     for (size_t region_id = 0; region_id < m_regions.size(); ++ region_id) {
-        PrintRegion       &region = *m_regions[region_id];
-        PrintRegionConfig  this_region_config;
-        bool               this_region_config_set = false;
+        PrintRegion                             &region = *m_regions[region_id];
+        // Configs taken from m_region_config_pool, equal configs are compared by their address.
+        std::shared_ptr<const PrintRegionConfig>  this_region_config;
+        // Last PrintObject, which passed the test below. PrintObjects of the same ModelObject differ just by their trafos,
+        // thus if they are assigned the same volumes, they resolve to the same region configs.
+        const PrintObject                        *print_object_passed = nullptr;
         for (PrintObject *print_object : m_objects) {
+            if (print_object_passed != nullptr && print_object_passed->model_object() == print_object->model_object() &&
+                region_volumes_equal(print_object_passed->region_volumes, print_object->region_volumes, region_id))
+                continue;
             const LayerRanges *layer_ranges;
             {
                 auto it_status = model_object_status.find(ModelObjectStatus(print_object->model_object()->id()));
@@ -1011,25 +1135,27 @@ Print::ApplyStatus Print::apply(const Model &model, DynamicPrintConfig new_full_
                 for (const std::pair<t_layer_height_range, int> &volume_and_range : print_object->region_volumes[region_id]) {
                     const ModelVolume        &volume             = *print_object->model_object()->volumes[volume_and_range.second];
                     const DynamicPrintConfig *layer_range_config = layer_ranges->config(volume_and_range.first);
-                    if (this_region_config_set) {
+                    std::shared_ptr<const PrintRegionConfig> config = m_region_config_pool.get(
+                        PrintObject::region_config_from_model_volume(m_default_region_config, layer_range_config, volume, num_extruders));
+                    if (this_region_config) {
                         // If the new config for this volume differs from the other
                         // volume configs currently associated to this region, it means
                         // the region subdivision does not make sense anymore.
-                        if (! this_region_config.equals(PrintObject::region_config_from_model_volume(m_default_region_config, layer_range_config, volume, num_extruders)))
+                        if (config != this_region_config)
                             // Regions were split. Reset this print_object.
                             goto print_object_end;
                     } else {
-                        this_region_config = PrintObject::region_config_from_model_volume(m_default_region_config, layer_range_config, volume, num_extruders);
 						for (size_t i = 0; i < region_id; ++ i) {
 							const PrintRegion &region_other = *m_regions[i];
-							if (region_other.m_refcnt != 0 && region_other.config().equals(this_region_config))
+							if (region_other.m_refcnt != 0 && region_other.config_ptr() == config)
 								// Regions were merged. Reset this print_object.
 								goto print_object_end;
 						}
-                        this_region_config_set = true;
+                        this_region_config = std::move(config);
                     }
                 }
             }
+            print_object_passed = print_object;
             continue;
         print_object_end:
             update_apply_status(print_object->invalidate_all_steps());
@@ -1042,10 +1168,10 @@ Print::ApplyStatus Print::apply(const Model &model, DynamicPrintConfig new_full_
             }
             print_object->region_volumes.clear();
         }
-        if (this_region_config_set) {
-            t_config_option_keys diff = region.config().diff(this_region_config);
+        if (this_region_config && this_region_config != region.config_ptr()) {
+            t_config_option_keys diff = region.config().diff(*this_region_config);
+            region.set_config(std::move(this_region_config));
             if (! diff.empty()) {
-                region.config_apply_only(this_region_config, diff, false);
                 for (PrintObject *print_object : m_objects)
                     if (region_id < print_object->region_volumes.size() && ! print_object->region_volumes[region_id].empty())
                         update_apply_status(print_object->invalidate_state_by_config_options(diff));
@@ -1082,14 +1208,15 @@ Print::ApplyStatus Print::apply(const Model &model, DynamicPrintConfig new_full_
                     int region_id = -1;
                     if (&print_object == &print_object0) {
                         // Get the config applied to this volume.
-                        PrintRegionConfig config = PrintObject::region_config_from_model_volume(m_default_region_config, it_range->second, *volume, num_extruders);
+                        std::shared_ptr<const PrintRegionConfig> config = m_region_config_pool.get(
+                            PrintObject::region_config_from_model_volume(m_default_region_config, it_range->second, *volume, num_extruders));
                         // Find an existing print region with the same config.
     					int idx_empty_slot = -1;
     					for (int i = 0; i < (int)m_regions.size(); ++ i) {
     						if (m_regions[i]->m_refcnt == 0) {
                                 if (idx_empty_slot == -1)
                                     idx_empty_slot = i;
-                            } else if (config.equals(m_regions[i]->config())) {
+                            } else if (config == m_regions[i]->config_ptr()) {
                                 region_id = i;
                                 break;
                             }
@@ -1098,7 +1225,7 @@ Print::ApplyStatus Print::apply(const Model &model, DynamicPrintConfig new_full_
     					if (region_id == -1) {
     						if (idx_empty_slot == -1) {
     							region_id = (int)m_regions.size();
-    							this->add_region(config);
+    							this->add_region(std::move(config));
     						} else {
     							region_id = idx_empty_slot;
                                 m_regions[region_id]->set_config(std::move(config));
@@ -1118,6 +1245,8 @@ Print::ApplyStatus Print::apply(const Model &model, DynamicPrintConfig new_full_
 			}
         }
     }
+    // Forget the configs no more referenced by any region.
+    m_region_config_pool.release_unused();
 
     // Update SlicingParameters for each object where the SlicingParameters is not valid.
     // If it is not valid, then it is ensured that PrintObject.m_slicing_params is not in use
@@ -1144,6 +1273,30 @@ bool Print::has_skirt() const
         || this->has_infinite_skirt();
 }
 
+PrintMemoryStats Print::memory_stats() const
+{
+    PrintMemoryStats stats;
+    for (const PrintObject *object : m_objects)
+        stats.add(object->memory_stats());
+    stats.add("skirt", m_skirt.memsize());
+    stats.add("brim",  m_brim.memsize());
+    // The G-code of the tool changes and their extrusions kept for the preview.
+    auto tool_change_memsize = [](const WipeTower::ToolChangeResult &tcr) {
+        return sizeof(tcr) + tcr.gcode.capacity() + tcr.extrusions.capacity() * sizeof(WipeTower::Extrusion);
+    };
+    size_t wipe_tower = 0;
+    if (m_wipe_tower_data.priming)
+        for (const WipeTower::ToolChangeResult &tcr : *m_wipe_tower_data.priming)
+            wipe_tower += tool_change_memsize(tcr);
+    for (const std::vector<WipeTower::ToolChangeResult> &layer : m_wipe_tower_data.tool_changes)
+        for (const WipeTower::ToolChangeResult &tcr : layer)
+            wipe_tower += tool_change_memsize(tcr);
+    if (m_wipe_tower_data.final_purge)
+        wipe_tower += tool_change_memsize(*m_wipe_tower_data.final_purge);
+    stats.add("wipe_tower", wipe_tower);
+    return stats;
+}
+
 // Precondition: Print::validate() requires the Print::apply() to be called its invocation.
 std::string Print::validate() const
 {
@@ -1156,7 +1309,10 @@ std::string Print::validate() const
     if (m_config.complete_objects) {
         // Check horizontal clearance.
         {
-            Polygons convex_hulls_other;
+            // Convex hulls of all the instances with their bounding boxes, the convex hull of an object is calculated once
+            // and translated to its instances.
+            Polygons                 convex_hulls;
+            std::vector<BoundingBox> convex_hulls_bboxes;
             for (const PrintObject *print_object : m_objects) {
                 assert(! print_object->model_object()->instances.empty());
                 assert(! print_object->copies().empty());
@@ -1173,15 +1329,28 @@ std::string Print::validate() const
                     print_object->model_object()->convex_hull_2d(
                         Geometry::assemble_transform(Vec3d::Zero(), rotation, model_instance0->get_scaling_factor(), model_instance0->get_mirror())),
                     float(scale_(0.5 * m_config.extruder_clearance_radius.value)), jtRound, float(scale_(0.1))).front();
-                // Now we check that no instance of convex_hull intersects any of the previously checked object instances.
+                BoundingBox    convex_hull0_bbox = convex_hull0.bounding_box();
                 for (const Point &copy : print_object->copies()) {
-                    Polygon convex_hull = convex_hull0;
-                    convex_hull.translate(copy);
-                    if (! intersection(convex_hulls_other, convex_hull).empty())
-                        return L("Some objects are too close; your extruder will collide with them.");
-                    polygons_append(convex_hulls_other, convex_hull);
+                    convex_hulls.emplace_back(convex_hull0);
+                    convex_hulls.back().translate(copy);
+                    convex_hulls_bboxes.emplace_back(convex_hull0_bbox);
+                    convex_hulls_bboxes.back().translate(copy(0), copy(1));
                 }
             }
+            // Now we check that no two instances collide. Sweep along X, only the convex hulls with overlapping
+            // bounding boxes are intersected, instead of intersecting each instance with the union of all the previous ones.
+            std::vector<size_t> order(convex_hulls.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::sort(order.begin(), order.end(), [&convex_hulls_bboxes](size_t i, size_t j) { return convex_hulls_bboxes[i].min(0) < convex_hulls_bboxes[j].min(0); });
+            std::vector<size_t> active;
+            for (size_t i : order) {
+                const BoundingBox &bbox = convex_hulls_bboxes[i];
+                active.erase(std::remove_if(active.begin(), active.end(), [&convex_hulls_bboxes, &bbox](size_t j) { return convex_hulls_bboxes[j].max(0) < bbox.min(0); }), active.end());
+                for (size_t j : active)
+                    if (bbox.overlap(convex_hulls_bboxes[j]) && ! intersection(convex_hulls[j], convex_hulls[i]).empty())
+                        return L("Some objects are too close; your extruder will collide with them.");
+                active.emplace_back(i);
+            }
         }
         // Check vertical clearance.
         {
@@ -1543,16 +1712,47 @@ void Print::auto_assign_extruders(ModelObject* model_object) const
 }
 
 // Slicing process, running at a background thread.
+void Print::enable_gcode_layer_cache(bool enable)
+{
+    if (! enable)
+        m_gcode_layer_cache.reset();
+    else if (! m_gcode_layer_cache)
+        m_gcode_layer_cache = std::make_shared<GCodeLayerCache>();
+}
+
 void Print::process()
 {
     BOOST_LOG_TRIVIAL(info) << "Staring the slicing process." << log_memory_info();
-    for (PrintObject *obj : m_objects)
-        obj->make_perimeters();
-    this->set_status(70, L("Infilling layers"));
-    for (PrintObject *obj : m_objects)
-        obj->infill();
-    for (PrintObject *obj : m_objects)
-        obj->generate_support_material();
+    SLIC3R_TRACE_ZONE("Print::process");
+    if (m_gcode_layer_cache &&
+        ! (this->is_step_done(posSlice) && this->is_step_done(posPerimeters) && this->is_step_done(posPrepareInfill) &&
+           this->is_step_done(posInfill) && this->is_step_done(posSupportMaterial) &&
+           this->is_step_done(psWipeTower) && this->is_step_done(psSkirt) && this->is_step_done(psBrim)))
+        // The layers, the skirt, the brim or the tool ordering will be regenerated, the cached G-code refers to them.
+        m_gcode_layer_cache->clear();
+    // The print objects do not depend on each other, therefore they are processed concurrently, while the steps
+    // of a single object are executed in their order (perimeters, infill, support material).
+    // With many small objects on the bed the parallel loops inside a single object have too little work
+    // to saturate the cores, now the support of one object may be generated while another object is being infilled.
+    // The parallel loops of the individual steps nest into this one.
+    // Executing the object steps out of process is not supported: the results (Layer, LayerRegion, SupportLayer
+    // with their ExtrusionEntities) are not serializable and they point back to the PrintObject and its regions.
+    tbb::atomic<bool> infill_status_reported;
+    infill_status_reported = false;
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, m_objects.size(), 1),
+        [this, &infill_status_reported](const tbb::blocked_range<size_t> &range) {
+            for (size_t idx_object = range.begin(); idx_object < range.end(); ++ idx_object) {
+                PrintObject *obj = m_objects[idx_object];
+                obj->make_perimeters();
+                if (! infill_status_reported.fetch_and_store(true))
+                    this->set_status(70, L("Infilling layers"));
+                obj->infill();
+                obj->generate_support_material();
+                if (m_lean_mode)
+                    obj->release_intermediate_data();
+            }
+        });
     if (this->set_started(psWipeTower)) {
         m_wipe_tower_data.clear();
         m_tool_ordering.clear();
@@ -1581,6 +1781,7 @@ void Print::process()
         }
        this->set_done(psBrim);
     }
+    log_memory_stats("of the print", [this]() { return this->memory_stats(); });
     BOOST_LOG_TRIVIAL(info) << "Slicing process finished." << log_memory_info();
 }
 
@@ -1594,6 +1795,7 @@ std::string Print::export_gcode(const std::string& path_template, GCodePreviewDa
 std::string Print::export_gcode(const std::string &path_template, GCodePreviewData *preview_data)
 #endif // ENABLE_THUMBNAIL_GENERATOR
 {
+    SLIC3R_TRACE_ZONE("Print::export_gcode", "export");
     // output everything to a G-code file
     // The following call may die if the output_filename_format template substitution fails.
     std::string path = this->output_filepath(path_template);
@@ -1619,6 +1821,7 @@ std::string Print::export_gcode(const std::string &path_template, GCodePreviewDa
 
 void Print::_make_skirt()
 {
+    SLIC3R_TRACE_ZONE("Print::make_skirt");
     // First off we need to decide how tall the skirt must be.
     // The skirt_height option from config is expressed in layers, but our
     // object might have different layer heights, so we need to find the print_z
@@ -1656,13 +1859,14 @@ void Print::_make_skirt()
             for (const ExtrusionEntity *extrusion_entity : layer->support_fills.entities)
                 append(object_points, extrusion_entity->as_polyline().points);
         }
+        if (object_points.size() >= 3)
+            // Only the convex hull of the object is needed to calculate the convex hull of all its copies.
+            object_points = Slic3r::Geometry::convex_hull(object_points).points;
         // Repeat points for each object copy.
-        for (const Point &shift : object->m_copies) {
-            Points copy_points = object_points;
-            for (Point &pt : copy_points)
-                pt += shift;
-            append(points, copy_points);
-        }
+        points.reserve(points.size() + object_points.size() * object->m_copies.size());
+        for (const Point &shift : object->m_copies)
+            for (const Point &pt : object_points)
+                points.emplace_back(pt + shift);
     }
 
     // Include the wipe tower.
@@ -1769,36 +1973,111 @@ void Print::_make_skirt()
 
 void Print::_make_brim()
 {
+    SLIC3R_TRACE_ZONE("Print::make_brim");
     // Brim is only printed on first layer and uses perimeter extruder.
     Flow        flow = this->brim_flow();
-    Polygons    islands;
-    for (PrintObject *object : m_objects) {
-        Polygons object_islands;
+    size_t      num_loops = size_t(floor(m_config.brim_width.value / flow.spacing()));
+    // Generate the brim loops around the islands by offsetting them repeatedly.
+    auto        make_loops = [this, &flow, num_loops](Polygons islands) {
+        Polygons loops;
+        for (size_t i = 0; i < num_loops; ++ i) {
+            this->throw_if_canceled();
+            islands = offset(islands, float(flow.scaled_spacing()), jtSquare);
+            for (Polygon &poly : islands) {
+                // poly.simplify(SCALED_RESOLUTION);
+                poly.points.push_back(poly.points.front());
+                MultiPoint::douglas_peucker(poly.points, SCALED_RESOLUTION);
+                poly.points.pop_back();
+            }
+            polygons_append(loops, offset(islands, -0.5f * float(flow.scaled_spacing())));
+        }
+        return loops;
+    };
+
+    std::vector<Polygons> object_islands(m_objects.size());
+    // Object index & copy index of the object copies, and bounding boxes of their brims.
+    std::vector<std::pair<size_t, size_t>> copies;
+    std::vector<BoundingBox>               copies_bbox;
+    // The brims may overlap even if the bounding boxes of the offset islands just touch.
+    const coord_t                          brim_extent = coord_t(num_loops + 1) * flow.scaled_spacing() + SCALED_EPSILON;
+    for (size_t idx_object = 0; idx_object < m_objects.size(); ++ idx_object) {
+        PrintObject *object  = m_objects[idx_object];
+        Polygons    &islands = object_islands[idx_object];
         for (ExPolygon &expoly : object->m_layers.front()->lslices)
-            object_islands.push_back(expoly.contour);
+            islands.push_back(expoly.contour);
         if (! object->support_layers().empty())
-            object->support_layers().front()->support_fills.polygons_covered_by_spacing(object_islands, float(SCALED_EPSILON));
-        islands.reserve(islands.size() + object_islands.size() * object->m_copies.size());
-        for (const Point &pt : object->m_copies)
-            for (Polygon &poly : object_islands) {
-                islands.push_back(poly);
-                islands.back().translate(pt);
-            }
-    }
-    Polygons loops;
-    size_t num_loops = size_t(floor(m_config.brim_width.value / flow.spacing()));
-    for (size_t i = 0; i < num_loops; ++ i) {
-        this->throw_if_canceled();
-        islands = offset(islands, float(flow.scaled_spacing()), jtSquare);
-        for (Polygon &poly : islands) {
-            // poly.simplify(SCALED_RESOLUTION);
-            poly.points.push_back(poly.points.front());
-            Points p = MultiPoint::_douglas_peucker(poly.points, SCALED_RESOLUTION);
-            p.pop_back();
-            poly.points = std::move(p);
+            object->support_layers().front()->support_fills.polygons_covered_by_spacing(islands, float(SCALED_EPSILON));
+        if (islands.empty())
+            continue;
+        BoundingBox bbox = get_extents(islands);
+        bbox.offset(brim_extent);
+        for (size_t idx_copy = 0; idx_copy < object->m_copies.size(); ++ idx_copy) {
+            copies.emplace_back(idx_object, idx_copy);
+            copies_bbox.emplace_back(bbox);
+            copies_bbox.back().translate(object->m_copies[idx_copy].x(), object->m_copies[idx_copy].y());
         }
-        polygons_append(loops, offset(islands, -0.5f * float(flow.scaled_spacing())));
     }
+
+    // Group the copies with overlapping brims. The brim is calculated once per object for all its isolated copies
+    // and translated, only the islands of the copies with overlapping brims are offset together.
+    std::vector<size_t> copy_group(copies.size());
+    for (size_t i = 0; i < copies.size(); ++ i)
+        copy_group[i] = i;
+    auto group_root = [&copy_group](size_t i) {
+        while (copy_group[i] != i)
+            i = copy_group[i] = copy_group[copy_group[i]];
+        return i;
+    };
+    for (size_t i = 0; i < copies.size(); ++ i)
+        for (size_t j = i + 1; j < copies.size(); ++ j)
+            if (copies_bbox[i].overlap(copies_bbox[j]))
+                copy_group[group_root(j)] = group_root(i);
+    std::vector<std::vector<size_t>> groups(copies.size());
+    for (size_t i = 0; i < copies.size(); ++ i)
+        groups[group_root(i)].emplace_back(i);
+    groups.erase(std::remove_if(groups.begin(), groups.end(), [](const std::vector<size_t> &group) { return group.empty(); }), groups.end());
+
+    // Objects with at least one isolated copy.
+    std::vector<Polygons> object_loops(m_objects.size());
+    std::vector<size_t>   objects_with_isolated_copies;
+    for (const std::vector<size_t> &group : groups)
+        if (group.size() == 1)
+            objects_with_isolated_copies.emplace_back(copies[group.front()].first);
+    sort_remove_duplicates(objects_with_isolated_copies);
+
+    std::vector<Polygons> group_loops(groups.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, objects_with_isolated_copies.size() + groups.size()),
+        [this, &make_loops, &object_islands, &object_loops, &objects_with_isolated_copies, &copies, &groups, &group_loops](const tbb::blocked_range<size_t> &range) {
+        for (size_t i = range.begin(); i < range.end(); ++ i)
+            if (i < objects_with_isolated_copies.size()) {
+                size_t idx_object = objects_with_isolated_copies[i];
+                object_loops[idx_object] = make_loops(object_islands[idx_object]);
+            } else if (const std::vector<size_t> &group = groups[i - objects_with_isolated_copies.size()]; group.size() > 1) {
+                Polygons islands;
+                for (size_t idx_copy : group) {
+                    const Polygons &src   = object_islands[copies[idx_copy].first];
+                    const Point     shift = m_objects[copies[idx_copy].first]->m_copies[copies[idx_copy].second];
+                    for (const Polygon &poly : src) {
+                        islands.emplace_back(poly);
+                        islands.back().translate(shift);
+                    }
+                }
+                group_loops[i - objects_with_isolated_copies.size()] = make_loops(std::move(islands));
+            }
+    });
+    this->throw_if_canceled();
+
+    Polygons loops;
+    for (size_t i = 0; i < groups.size(); ++ i)
+        if (groups[i].size() == 1) {
+            const std::pair<size_t, size_t> &copy  = copies[groups[i].front()];
+            const Point                       shift = m_objects[copy.first]->m_copies[copy.second];
+            for (const Polygon &poly : object_loops[copy.first]) {
+                loops.emplace_back(poly);
+                loops.back().translate(shift);
+            }
+        } else
+            polygons_append(loops, std::move(group_loops[i]));
     loops = union_pt_chained(loops, false);
     // The function above produces ordering well suited for concentric infill (from outside to inside).
     // For Brim, the ordering should be reversed (from inside to outside).
@@ -1963,6 +2242,7 @@ const WipeTowerData& Print::wipe_tower_data(size_t extruders_cnt, double first_l
 
 void Print::_make_wipe_tower()
 {
+    SLIC3R_TRACE_ZONE("Print::make_wipe_tower");
     m_wipe_tower_data.clear();
     if (! this->has_wipe_tower())
         return;
@@ -2103,7 +2383,13 @@ std::string Print::output_filename(const std::string &filename_base) const
     // Set the placeholders for the data know first after the G-code export is finished.
     // These values will be just propagated into the output file name.
     DynamicConfig config = this->finished() ? this->print_statistics().config() : this->print_statistics().placeholders();
-    return this->PrintBase::output_filename(m_config.output_filename_format.value, ".gcode", filename_base, &config);
+    if (! m_config.binary_gcode.value)
+        return this->PrintBase::output_filename(m_config.output_filename_format.value, ".gcode", filename_base, &config);
+    // The binary G-code replaces the .gcode extension of the output_filename_format template.
+    boost::filesystem::path filename = this->PrintBase::output_filename(m_config.output_filename_format.value, ".bgcode", filename_base, &config);
+    if (boost::iequals(filename.extension().string(), ".gcode"))
+        filename.replace_extension(".bgcode");
+    return filename.string();
 }
 
 DynamicConfig PrintStatistics::config() const
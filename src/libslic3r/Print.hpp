@@ -23,6 +23,7 @@ class Print;
 class PrintObject;
 class ModelObject;
 class GCode;
+class GCodeLayerCache;
 class GCodePreviewData;
 
 // Print step IDs for keeping track of the print state.
@@ -54,7 +55,9 @@ class PrintRegion
 // Methods NOT modifying the PrintRegion's state:
 public:
     const Print*                print() const { return m_print; }
-    const PrintRegionConfig&    config() const { return m_config; }
+    const PrintRegionConfig&    config() const { return *m_config; }
+    // Region configs are shared by Print::m_region_config_pool, equal configs have the same address.
+    const std::shared_ptr<const PrintRegionConfig>& config_ptr() const { return m_config; }
 	// 1-based extruder identifier for this region and role.
 	unsigned int 				extruder(FlowRole role) const;
     Flow                        flow(FlowRole role, double layer_height, bool bridge, bool first_layer, double width, const PrintObject &object) const;
@@ -70,20 +73,16 @@ public:
 // Methods modifying the PrintRegion's state:
 public:
     Print*                      print() { return m_print; }
-    void                        set_config(const PrintRegionConfig &config) { m_config = config; }
-    void                        set_config(PrintRegionConfig &&config) { m_config = std::move(config); }
-    void                        config_apply_only(const ConfigBase &other, const t_config_option_keys &keys, bool ignore_nonexistent = false) 
-                                        { this->m_config.apply_only(other, keys, ignore_nonexistent); }
+    void                        set_config(std::shared_ptr<const PrintRegionConfig> config) { assert(config); m_config = std::move(config); }
 
 protected:
     size_t             m_refcnt;
 
 private:
     Print             *m_print;
-    PrintRegionConfig  m_config;
+    std::shared_ptr<const PrintRegionConfig> m_config;
     
-    PrintRegion(Print* print) : m_refcnt(0), m_print(print) {}
-    PrintRegion(Print* print, const PrintRegionConfig &config) : m_refcnt(0), m_print(print), m_config(config) {}
+    PrintRegion(Print* print, std::shared_ptr<const PrintRegionConfig> config) : m_refcnt(0), m_print(print), m_config(std::move(config)) { assert(m_config); }
     ~PrintRegion() {}
 };
 
@@ -169,6 +168,9 @@ public:
     // returns 0-based indices of extruders used to print the object (without brim, support and other helper extrusions)
     std::vector<unsigned int>   object_extruders() const;
 
+    // Memory footprint of the layers, of the support layers and of the slice cache, aggregated by PrintObjectStep.
+    PrintMemoryStats            memory_stats() const;
+
     // Called when slicing to SVG (see Print.pm sub export_svg), and used by perimeters.t
     void slice();
 
@@ -205,6 +207,8 @@ private:
     void prepare_infill();
     void infill();
     void generate_support_material();
+    // Release the data of the layers consumed by the infill and by the support generator, see Print::set_lean_mode().
+    void release_intermediate_data();
 
     void _slice(const std::vector<coordf_t> &layer_height_profile);
     std::string _fix_slicing_errors();
@@ -232,6 +236,27 @@ private:
     SlicingParameters                       m_slicing_params;
     LayerPtrs                               m_layers;
     SupportLayerPtrs                        m_support_layers;
+    // Set by release_intermediate_data(), reset once the perimeters are generated again.
+    bool                                    m_intermediate_data_released { false };
+
+    // Slices of a model part or a modifier volume, cached by _slice() to be reused by the next _slice()
+    // for the layers of the volumes, whose mesh and transformation did not change.
+    struct VolumeSlices
+    {
+        // The mesh is held to make sure that its address is not reused by another mesh.
+        std::shared_ptr<const TriangleMesh>         mesh;
+        Transform3d                                 trafo;
+        float                                       closing_radius;
+        // Topology of the mesh built by the TriangleMeshSlicer, reused for any trafo and closing radius.
+        TriangleMeshSlicer::FacetsEdgesPtr          facets_edges;
+        // Slices sorted by their slice_z.
+        std::vector<std::pair<float, ExPolygons>>   layers;
+    };
+    // Volume slices of the last finished _slice(), indexed by the ModelVolume ID.
+    mutable std::map<ObjectID, VolumeSlices> m_volume_slices;
+    // Volume slices of the running _slice(), replacing m_volume_slices once _slice() finishes,
+    // so that only the volumes and layers sliced the last time are cached.
+    mutable std::map<ObjectID, VolumeSlices> m_volume_slices_next;
 
     std::vector<ExPolygons> slice_region(size_t region_id, const std::vector<float> &z) const;
     std::vector<ExPolygons> slice_modifiers(size_t region_id, const std::vector<float> &z) const;
@@ -361,6 +386,8 @@ public:
 
     // Returns an empty string if valid, otherwise returns an error message.
     std::string         validate() const override;
+    // Memory footprint of the print objects, of the skirt, brim and of the wipe tower, aggregated by step.
+    PrintMemoryStats    memory_stats() const override;
     BoundingBox         bounding_box() const;
     BoundingBox         total_bounding_box() const;
     double              skirt_first_layer_height() const;
@@ -397,6 +424,18 @@ public:
     const WipeTowerData&        wipe_tower_data(size_t extruders_cnt = 0, double first_layer_height = 0., double nozzle_diameter = 0.) const;
     const ToolOrdering& 		tool_ordering() const { return m_tool_ordering; }
 
+    // Keep the G-code of the layers in memory after the G-code export, so that the next export of this Print generates
+    // just the layers, which changed, for example by inserting a color change. Used by the GUI, which exports the same Print repeatedly.
+    void                        enable_gcode_layer_cache(bool enable);
+    GCodeLayerCache*            gcode_layer_cache() const { return m_gcode_layer_cache.get(); }
+
+    // Release the data of the layers not needed after slicing right after the steps consuming them are finished
+    // (the fill surfaces and the thin fills of the layer regions), to reduce the memory footprint.
+    // Invalidating the infill or the support material of a PrintObject then regenerates its perimeters as well.
+    // Enabled by the command line slicer, optional in the GUI.
+    void                        set_lean_mode(bool lean) { m_lean_mode = lean; }
+    bool                        lean_mode() const { return m_lean_mode; }
+
 	std::string                 output_filename(const std::string &filename_base = std::string()) const override;
 
     // Accessed by SupportMaterial
@@ -406,8 +445,7 @@ public:
 protected:
     // methods for handling regions
     PrintRegion*        get_region(size_t idx)        { return m_regions[idx]; }
-    PrintRegion*        add_region();
-    PrintRegion*        add_region(const PrintRegionConfig &config);
+    PrintRegion*        add_region(std::shared_ptr<const PrintRegionConfig> config);
 
     // Invalidates the step, and its depending steps in Print.
     bool                invalidate_step(PrintStep step);
@@ -434,6 +472,8 @@ private:
     PrintRegionConfig                       m_default_region_config;
     PrintObjectPtrs                         m_objects;
     PrintRegionPtrs                         m_regions;
+    // Configs of m_regions and of the model volumes being assigned to them.
+    SharedConfigPool<PrintRegionConfig>     m_region_config_pool;
 
     // Ordered collections of extrusion paths to build skirt loops and brim.
     ExtrusionEntityCollection               m_skirt;
@@ -446,6 +486,10 @@ private:
     // Estimated print time, filament consumed.
     PrintStatistics                         m_print_statistics;
 
+    // G-code of the layers of the last G-code export, if enabled.
+    std::shared_ptr<GCodeLayerCache>        m_gcode_layer_cache;
+    bool                                    m_lean_mode { false };
+
     // To allow GCode to set the Print's GCodeExport step status.
     friend class GCode;
     // Allow PrintObject to access m_mutex and m_cancel_callback.
@@ -2,8 +2,10 @@
 
 #include <boost/filesystem.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/log/trivial.hpp>
 
 #include "I18N.hpp"
+#include "Utils.hpp"
 
 //! macro used to mark string used at localization, 
 //! return same string
@@ -14,6 +16,38 @@ namespace Slic3r
 
 size_t PrintStateBase::g_last_timestamp = 0;
 
+void PrintMemoryStats::add(const std::string &step, size_t bytes)
+{
+    auto it = std::find_if(this->steps.begin(), this->steps.end(), [&step](const std::pair<std::string, size_t> &s) { return s.first == step; });
+    if (it == this->steps.end())
+        this->steps.emplace_back(step, bytes);
+    else
+        it->second += bytes;
+}
+
+size_t PrintMemoryStats::total() const
+{
+    size_t n = 0;
+    for (const std::pair<std::string, size_t> &step : this->steps)
+        n += step.second;
+    return n;
+}
+
+std::string PrintMemoryStats::to_string() const
+{
+    std::string out;
+    for (const std::pair<std::string, size_t> &step : this->steps)
+        out += step.first + ": " + format_memsize_MB(step.second) + "; ";
+    return out + "total: " + format_memsize_MB(this->total());
+}
+
+void log_memory_stats(const std::string &what, const std::function<PrintMemoryStats()> &stats)
+{
+    // Debug level and more verbose.
+    if (get_logging_level() >= 4)
+        BOOST_LOG_TRIVIAL(debug) << "Memory footprint " << what << ": " << stats().to_string();
+}
+
 // Update "scale", "input_filename", "input_filename_base" placeholders from the current m_objects.
 void PrintBase::update_object_placeholders(DynamicConfig &config, const std::string &default_ext) const
 {
@@ -185,6 +185,25 @@ private:
     StateWithTimeStamp m_state[COUNT];
 };
 
+// Memory footprint of the data held by a Print / SLAPrint or by one of their print objects,
+// in bytes, aggregated by the step producing the data. See PrintBase::memory_stats().
+struct PrintMemoryStats
+{
+    // Step name and the bytes held by the results of the step, in the order the steps were added.
+    std::vector<std::pair<std::string, size_t>> steps;
+
+    // Accumulate bytes to a step, appending the step if not present yet.
+    void        add(const std::string &step, size_t bytes);
+    void        add(const PrintMemoryStats &other) { for (const auto &step : other.steps) this->add(step.first, step.second); }
+    size_t      total() const;
+    // "step1: 10MB; step2: 2MB; total: 12MB", a format compatible with log_memory_info().
+    std::string to_string() const;
+};
+
+// Log the memory footprint of a print or a print object at the debug level, to be called after a step finished.
+// The stats are only collected if the debug level is enabled, as collecting them traverses all the layers.
+void log_memory_stats(const std::string &what, const std::function<PrintMemoryStats()> &stats);
+
 class PrintBase;
 
 class PrintObjectBase
@@ -317,6 +336,10 @@ public:
     const PlaceholderParser&   placeholder_parser() const { return m_placeholder_parser; }
     const DynamicPrintConfig&  full_print_config() const { return m_full_print_config; }
 
+    // Memory footprint of the data produced by the slicing steps, aggregated by step.
+    // Not to be called while process() is running, except from the worker thread between the steps.
+    virtual PrintMemoryStats   memory_stats() const = 0;
+
     virtual std::string        output_filename(const std::string &filename_base = std::string()) const = 0;
     // If the filename_base is set, it is used as the input for the template processing. In that case the path is expected to be the directory (may be empty).
     // If filename_set is empty, than the path may be a file or directory. If it is a file, then the macro will not be processed.
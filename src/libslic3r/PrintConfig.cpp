@@ -122,6 +122,22 @@ void PrintConfigDef::init_fff_params()
     // Maximum extruder temperature, bumped to 1500 to support printing of glass.
     const int max_temp = 1500;
 
+    def = this->add("arc_fitting", coBool);
+    def->label = L("Arc fitting");
+    def->tooltip = L("Replace runs of short line segments of the extrusions by circular arcs (G2 / G3), "
+                   "which makes the G-code shorter and the motion smoother. The firmware has to support G2 / G3. "
+                   "Arc fitting is not applied in the spiral vase mode and for the MakerWare / Sailfish flavors.");
+    def->mode = comExpert;
+    def->set_default_value(new ConfigOptionBool(false));
+
+    def = this->add("arc_fitting_tolerance", coFloat);
+    def->label = L("Arc fitting tolerance");
+    def->tooltip = L("Maximum deviation of an arc from the points and the line segments of the extrusion it replaces.");
+    def->sidetext = L("mm");
+    def->min = 0.001;
+    def->mode = comExpert;
+    def->set_default_value(new ConfigOptionFloat(0.01));
+
     def = this->add("avoid_crossing_perimeters", coBool);
     def->label = L("Avoid crossing perimeters");
     def->tooltip = L("Optimize travel moves in order to minimize the crossing of perimeters. "
@@ -159,6 +175,14 @@ void PrintConfigDef::init_fff_params()
     def->mode = comExpert;
     def->set_default_value(new ConfigOptionString(""));
 
+    def = this->add("binary_gcode", coBool);
+    def->label = L("Binary G-code");
+    def->tooltip = L("Export the G-code into a compact block-compressed binary container (.bgcode) instead of the ASCII G-code. "
+                   "The thumbnails and the configuration are stored in separate metadata blocks. "
+                   "The printer firmware or the print host has to support the binary G-code, post-processing scripts receive the binary file.");
+    def->mode = comExpert;
+    def->set_default_value(new ConfigOptionBool(false));
+
     def = this->add("bottom_solid_layers", coInt);
     //TRN To be shown in Print Settings "Bottom solid layers"
     def->label = L("Bottom");
@@ -3308,7 +3332,8 @@ CLIActionsConfigDef::CLIActionsConfigDef()
 
     def = this->add("info", coBool);
     def->label = L("Output Model Info");
-    def->tooltip = L("Write information about the model to the console.");
+    def->tooltip = L("Write information about the model to the console. If the model is sliced by the same command, "
+                     "the memory held by the results of the slicing steps is written as well.");
     def->set_default_value(new ConfigOptionBool(false));
 
     def = this->add("save", coString);
@@ -3410,6 +3435,12 @@ CLIMiscConfigDef::CLIMiscConfigDef()
 {
     ConfigOptionDef* def;
 
+    def = this->add("batch", coString);
+    def->label = L("Batch file");
+    def->tooltip = L("Run the command lines listed in the specified file one after another in a single process, "
+                     "one command line of actions, options and input files per line. Use - to read them from the standard input. "
+                     "Empty lines and lines starting with # are ignored. The config files and STL / OBJ input files used by the jobs are loaded just once.");
+
     def = this->add("ignore_nonexistent_config", coBool);
     def->label = L("Ignore non-existent config files");
     def->tooltip = L("Do not fail if a file supplied to --load does not exist.");
@@ -3439,6 +3470,19 @@ CLIMiscConfigDef::CLIMiscConfigDef()
                      "For example. loglevel=2 logs fatal, error and warning level messages.");
     def->min = 0;
 
+    def = this->add("threads", coInt);
+    def->label = L("Maximum number of threads");
+    def->tooltip = L("Limit the number of threads used for slicing, exporting and arranging. "
+                     "This is useful when running multiple jobs at the same time. 0 uses all the available threads.");
+    def->min = 0;
+    def->set_default_value(new ConfigOptionInt(0));
+
+    def = this->add("trace", coString);
+    def->label = L("Trace file");
+    def->tooltip = L("Record the wall time, CPU time and peak memory of the slicing steps and write them into the specified file "
+                     "in the Chrome trace format when the application exits. The file may be opened by chrome://tracing or ui.perfetto.dev, "
+                     "a summary per step is logged at the info level.");
+
 #if (defined(_MSC_VER) || defined(__MINGW32__)) && defined(SLIC3R_GUI)
     def = this->add("sw_renderer", coBool);
     def->label = L("Render with a software renderer");
@@ -3451,7 +3495,12 @@ const CLIActionsConfigDef    cli_actions_config_def;
 const CLITransformConfigDef  cli_transform_config_def;
 const CLIMiscConfigDef       cli_misc_config_def;
 
-DynamicPrintAndCLIConfig::PrintAndCLIConfigDef DynamicPrintAndCLIConfig::s_def;
+const ConfigDef* DynamicPrintAndCLIConfig::def() const
+{
+    // Only the command line interface uses DynamicPrintAndCLIConfig, don't merge the definitions at startup of the other applications.
+    static const PrintAndCLIConfigDef s_def;
+    return &s_def;
+}
 
 void DynamicPrintAndCLIConfig::handle_legacy(t_config_option_key &opt_key, std::string &value) const
 {
@@ -20,6 +20,8 @@
 #include "libslic3r.h"
 #include "Config.hpp"
 
+#include <unordered_map>
+
 // #define HAS_PRESSURE_EQUALIZER
 
 namespace Slic3r {
@@ -229,9 +231,13 @@ class DynamicPrintConfig : public DynamicConfig
 public:
     DynamicPrintConfig() {}
     DynamicPrintConfig(const DynamicPrintConfig &rhs) : DynamicConfig(rhs) {}
+    DynamicPrintConfig(DynamicPrintConfig &&rhs) noexcept : DynamicConfig(std::move(rhs)) {}
     explicit DynamicPrintConfig(const StaticPrintConfig &rhs);
     explicit DynamicPrintConfig(const ConfigBase &rhs) : DynamicConfig(rhs) {}
 
+    DynamicPrintConfig& operator=(const DynamicPrintConfig &rhs) { DynamicConfig::operator=(rhs); return *this; }
+    DynamicPrintConfig& operator=(DynamicPrintConfig &&rhs) noexcept { DynamicConfig::operator=(std::move(rhs)); return *this; }
+
     static DynamicPrintConfig  full_print_config();
     static DynamicPrintConfig* new_from_defaults_keys(const std::vector<std::string> &keys);
 
@@ -293,7 +299,7 @@ protected:
         }
 
     protected:
-        std::map<std::string, ptrdiff_t>    m_map_name_to_offset;
+        std::unordered_map<std::string, ptrdiff_t> m_map_name_to_offset;
     };
 
     // Parametrized by the type of the topmost class owning the options.
@@ -322,6 +328,47 @@ protected:
         const std::vector<std::string>& keys()      const { return m_keys; }
         const T&                        defaults()  const { return *m_defaults; }
 
+        // Keys of the options differing between two instances of T. The options are addressed
+        // by their offsets precomputed in the order of m_keys, no lookup by name is needed.
+        t_config_option_keys diff(const T *lhs, const T *rhs) const
+        {
+            t_config_option_keys diff;
+            for (size_t i = 0; i < m_keys.size(); ++ i)
+                if (*this->optptr(i, lhs) != *this->optptr(i, rhs))
+                    diff.emplace_back(m_keys[i]);
+            return diff;
+        }
+
+        // Keys of the options differing between an instance of T and any other config,
+        // options not present in the other config are ignored.
+        t_config_option_keys diff(const T *owner, const ConfigBase &other) const
+        {
+            t_config_option_keys diff;
+            for (size_t i = 0; i < m_keys.size(); ++ i) {
+                const ConfigOption *other_opt = other.option(m_keys[i]);
+                if (other_opt != nullptr && *this->optptr(i, owner) != *other_opt)
+                    diff.emplace_back(m_keys[i]);
+            }
+            return diff;
+        }
+
+        bool equals(const T *lhs, const T *rhs) const
+        {
+            for (size_t i = 0; i < m_keys.size(); ++ i)
+                if (*this->optptr(i, lhs) != *this->optptr(i, rhs))
+                    return false;
+            return true;
+        }
+
+        // All instances of T share the same keys, only the option values are hashed.
+        size_t hash(const T *owner) const
+        {
+            size_t seed = 0;
+            for (size_t i = 0; i < m_keys.size(); ++ i)
+                boost::hash_combine(seed, this->optptr(i, owner)->hash());
+            return seed;
+        }
+
         // To be called during the StaticCache setup.
         // Collect option keys from m_map_name_to_offset,
         // assign default values to m_defaults.
@@ -331,6 +378,8 @@ protected:
             m_defaults = defaults;
             m_keys.clear();
             m_keys.reserve(m_map_name_to_offset.size());
+            m_offsets.clear();
+            m_offsets.reserve(m_map_name_to_offset.size());
             for (const auto &kvp : defs->options) {
                 // Find the option given the option name kvp.first by an offset from (char*)m_defaults.
                 ConfigOption *opt = this->optptr(kvp.first, m_defaults);
@@ -338,6 +387,7 @@ protected:
                     // This option is not defined by the ConfigBase of type T.
                     continue;
                 m_keys.emplace_back(kvp.first);
+                m_offsets.emplace_back((const char*)opt - (const char*)m_defaults);
                 const ConfigOptionDef *def = defs->get(kvp.first);
                 assert(def != nullptr);
                 if (def->default_value)
@@ -346,8 +396,13 @@ protected:
         }
 
     private:
+        const ConfigOption* optptr(size_t idx, const T *owner) const
+            { return reinterpret_cast<const ConfigOption*>((const char*)owner + m_offsets[idx]); }
+
         T                                  *m_defaults;
         std::vector<std::string>            m_keys;
+        // Offsets of the options from the owner, in the order of m_keys.
+        std::vector<ptrdiff_t>              m_offsets;
     };
 };
 
@@ -359,6 +414,13 @@ public: \
     /* Overrides ConfigBase::keys(). Collect names of all configuration values maintained by this configuration store. */ \
     t_config_option_keys     keys() const override { return s_cache_##CLASS_NAME.keys(); } \
     const t_config_option_keys& keys_ref() const override { return s_cache_##CLASS_NAME.keys(); } \
+    /* Hides ConfigBase::diff() / equals(), the options are compared by their precomputed offsets. */ \
+    t_config_option_keys     diff(const CLASS_NAME &other) const { return s_cache_##CLASS_NAME.diff(this, &other); } \
+    t_config_option_keys     diff(const ConfigBase &other) const { return s_cache_##CLASS_NAME.diff(this, other); } \
+    bool                     equals(const CLASS_NAME &other) const { return s_cache_##CLASS_NAME.equals(this, &other); } \
+    bool                     equals(const ConfigBase &other) const { return this->diff(other).empty(); } \
+    /* Hides ConfigBase::hash(), the options are addressed by their precomputed offsets. */ \
+    size_t                   hash() const { return s_cache_##CLASS_NAME.hash(this); } \
     static const CLASS_NAME& defaults() { initialize_cache(); return s_cache_##CLASS_NAME.defaults(); } \
 private: \
     static void initialize_cache() \
@@ -622,8 +684,11 @@ class GCodeConfig : public StaticPrintConfig
 {
     STATIC_PRINT_CONFIG_CACHE(GCodeConfig)
 public:
+    ConfigOptionBool                arc_fitting;
+    ConfigOptionFloat               arc_fitting_tolerance;
     ConfigOptionString              before_layer_gcode;
     ConfigOptionString              between_objects_gcode;
+    ConfigOptionBool                binary_gcode;
     ConfigOptionFloats              deretract_speed;
     ConfigOptionString              end_gcode;
     ConfigOptionStrings             end_filament_gcode;
@@ -695,8 +760,11 @@ public:
 protected:
     void initialize(StaticCacheBase &cache, const char *base_ptr)
     {
+        OPT_PTR(arc_fitting);
+        OPT_PTR(arc_fitting_tolerance);
         OPT_PTR(before_layer_gcode);
         OPT_PTR(between_objects_gcode);
+        OPT_PTR(binary_gcode);
         OPT_PTR(deretract_speed);
         OPT_PTR(end_gcode);
         OPT_PTR(end_filament_gcode);
@@ -1260,7 +1328,8 @@ public:
     DynamicPrintAndCLIConfig(const DynamicPrintAndCLIConfig &other) : DynamicPrintConfig(other) {}
 
     // Overrides ConfigBase::def(). Static configuration definition. Any value stored into this ConfigBase shall have its definition here.
-    const ConfigDef*        def() const override { return &s_def; }
+    // The definition is created on the first call, it copies the definitions of all the print and CLI options.
+    const ConfigDef*        def() const override;
 
     // Verify whether the opt_key has not been obsoleted or renamed.
     // Both opt_key and value may be modified by handle_legacy().
@@ -1283,7 +1352,6 @@ private:
         // Do not release the default values, they are handled by print_config_def & cli_actions_config_def / cli_transform_config_def / cli_misc_config_def.
         ~PrintAndCLIConfigDef() { this->options.clear(); }
     };
-    static PrintAndCLIConfigDef s_def;
 };
 
 } // namespace Slic3r
@@ -7,6 +7,8 @@
 #include "SupportMaterial.hpp"
 #include "Surface.hpp"
 #include "Slicing.hpp"
+#include "SliceCache.hpp"
+#include "Trace.hpp"
 #include "Utils.hpp"
 
 #include <utility>
@@ -40,6 +42,13 @@
 
 namespace Slic3r {
 
+// Log the memory footprint of a PrintObject once its step finished. The objects are processed in parallel,
+// therefore only the data of this object is reported, not the data of the whole Print.
+static void log_object_memory_stats(const PrintObject &object, const char *step)
+{
+    log_memory_stats("of " + object.model_object()->name + " after " + step, [&object]() { return object.memory_stats(); });
+}
+
 PrintObject::PrintObject(Print* print, ModelObject* model_object, bool add_instances) :
     PrintObjectBaseWithState(print, model_object),
     typed_slices(false),
@@ -73,20 +82,20 @@ PrintObject::PrintObject(Print* print, ModelObject* model_object, bool add_insta
 
 PrintBase::ApplyStatus PrintObject::set_copies(const Points &points)
 {
-    // Order copies with a nearest-neighbor search.
-    std::vector<Point> copies;
-    copies.reserve(points.size());
-    for (const Point &pt : points)
-        copies.emplace_back(pt + m_copies_shift);
+    // Compare in place first, Print::apply() calls this method for every PrintObject, mostly with its copies unchanged.
+    bool changed = points.size() != m_copies.size();
+    for (size_t i = 0; ! changed && i < points.size(); ++ i)
+        changed = points[i] + m_copies_shift != m_copies[i];
+    if (! changed)
+        return PrintBase::APPLY_STATUS_UNCHANGED;
     // Invalidate and set copies.
-    PrintBase::ApplyStatus status = PrintBase::APPLY_STATUS_UNCHANGED;
-    if (copies != m_copies) {
-        status = PrintBase::APPLY_STATUS_CHANGED;
-        if (m_print->invalidate_steps({ psSkirt, psBrim, psGCodeExport }) ||
-            (copies.size() != m_copies.size() && m_print->invalidate_step(psWipeTower)))
-            status = PrintBase::APPLY_STATUS_INVALIDATED;
-        m_copies = copies;
-    }
+    PrintBase::ApplyStatus status = PrintBase::APPLY_STATUS_CHANGED;
+    if (m_print->invalidate_steps({ psSkirt, psBrim, psGCodeExport }) ||
+        (points.size() != m_copies.size() && m_print->invalidate_step(psWipeTower)))
+        status = PrintBase::APPLY_STATUS_INVALIDATED;
+    m_copies.resize(points.size());
+    for (size_t i = 0; i < points.size(); ++ i)
+        m_copies[i] = points[i] + m_copies_shift;
     return status;
 }
 
@@ -103,6 +112,7 @@ void PrintObject::slice()
 {
     if (! this->set_started(posSlice))
         return;
+    SLIC3R_TRACE_ZONE("PrintObject::slice");
     m_print->set_status(10, L("Processing triangulated mesh"));
     std::vector<coordf_t> layer_height_profile;
     this->update_layer_height_profile(*this->model_object(), m_slicing_params, layer_height_profile);
@@ -134,6 +144,7 @@ void PrintObject::slice()
     if (m_layers.empty())
         throw std::runtime_error("No layers were detected. You might want to repair your STL file(s) or check their size or thickness and retry.\n");    
     this->set_done(posSlice);
+    log_object_memory_stats(*this, "slice");
 }
 
 // 1) Merges typed region slices into stInternal type.
@@ -146,16 +157,22 @@ void PrintObject::make_perimeters()
 
     if (! this->set_started(posPerimeters))
         return;
+    SLIC3R_TRACE_ZONE("PrintObject::make_perimeters");
 
     m_print->set_status(20, L("Generating perimeters"));
     BOOST_LOG_TRIVIAL(info) << "Generating perimeters..." << log_memory_info();
     
     // merge slices if they were split into types
     if (this->typed_slices) {
-        for (Layer *layer : m_layers) {
-            layer->merge_slices();
-            m_print->throw_if_canceled();
-        }
+        tbb::parallel_for(
+            tbb::blocked_range<size_t>(0, m_layers.size()),
+            [this](const tbb::blocked_range<size_t>& range) {
+                for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
+                    m_print->throw_if_canceled();
+                    m_layers[layer_idx]->merge_slices();
+                }
+            });
+        m_print->throw_if_canceled();
         this->typed_slices = false;
     }
     
@@ -166,89 +183,95 @@ void PrintObject::make_perimeters()
     // but we don't generate any extra perimeter if fill density is zero, as they would be floating
     // inside the object - infill_only_where_needed should be the method of choice for printing
     // hollow objects
+    std::vector<size_t> extra_perimeters_regions;
     for (size_t region_id = 0; region_id < this->region_volumes.size(); ++ region_id) {
         const PrintRegion &region = *m_print->regions()[region_id];
-        if (! region.config().extra_perimeters || region.config().perimeters == 0 || region.config().fill_density == 0 || this->layer_count() < 2)
-            continue;
-
-        BOOST_LOG_TRIVIAL(debug) << "Generating extra perimeters for region " << region_id << " in parallel - start";
-        tbb::parallel_for(
-            tbb::blocked_range<size_t>(0, m_layers.size() - 1),
-            [this, &region, region_id](const tbb::blocked_range<size_t>& range) {
-                for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
-                    m_print->throw_if_canceled();
-                    LayerRegion &layerm                     = *m_layers[layer_idx]->m_regions[region_id];
-                    const LayerRegion &upper_layerm         = *m_layers[layer_idx+1]->m_regions[region_id];
-                    const Polygons upper_layerm_polygons    = upper_layerm.slices;
-                    // Filter upper layer polygons in intersection_ppl by their bounding boxes?
-                    // my $upper_layerm_poly_bboxes= [ map $_->bounding_box, @{$upper_layerm_polygons} ];
-                    const double total_loop_length      = total_length(upper_layerm_polygons);
-                    const coord_t perimeter_spacing     = layerm.flow(frPerimeter).scaled_spacing();
-                    const Flow ext_perimeter_flow       = layerm.flow(frExternalPerimeter);
-                    const coord_t ext_perimeter_width   = ext_perimeter_flow.scaled_width();
-                    const coord_t ext_perimeter_spacing = ext_perimeter_flow.scaled_spacing();
-
-                    for (Surface &slice : layerm.slices.surfaces) {
-                        for (;;) {
-                            // compute the total thickness of perimeters
-                            const coord_t perimeters_thickness = ext_perimeter_width/2 + ext_perimeter_spacing/2
-                                + (region.config().perimeters-1 + slice.extra_perimeters) * perimeter_spacing;
-                            // define a critical area where we don't want the upper slice to fall into
-                            // (it should either lay over our perimeters or outside this area)
-                            const coord_t critical_area_depth = coord_t(perimeter_spacing * 1.5);
-                            const Polygons critical_area = diff(
-                                offset(slice.expolygon, float(- perimeters_thickness)),
-                                offset(slice.expolygon, float(- perimeters_thickness - critical_area_depth))
-                            );
-                            // check whether a portion of the upper slices falls inside the critical area
-                            const Polylines intersection = intersection_pl(to_polylines(upper_layerm_polygons), critical_area);
-                            // only add an additional loop if at least 30% of the slice loop would benefit from it
-                            if (total_length(intersection) <=  total_loop_length*0.3)
-                                break;
-                            /*
-                            if (0) {
-                                require "Slic3r/SVG.pm";
-                                Slic3r::SVG::output(
-                                    "extra.svg",
-                                    no_arrows   => 1,
-                                    expolygons  => union_ex($critical_area),
-                                    polylines   => [ map $_->split_at_first_point, map $_->p, @{$upper_layerm->slices} ],
-                                );
-                            }
-                            */
-                            ++ slice.extra_perimeters;
-                        }
-                        #ifdef DEBUG
-                            if (slice.extra_perimeters > 0)
-                                printf("  adding %d more perimeter(s) at layer %zu\n", slice.extra_perimeters, layer_idx);
-                        #endif
-                    }
-                }
-            });
-        m_print->throw_if_canceled();
-        BOOST_LOG_TRIVIAL(debug) << "Generating extra perimeters for region " << region_id << " in parallel - end";
+        if (region.config().extra_perimeters && region.config().perimeters > 0 && region.config().fill_density > 0 && this->layer_count() >= 2)
+            extra_perimeters_regions.emplace_back(region_id);
     }
+    auto make_extra_perimeters = [this](size_t layer_idx, size_t region_id) {
+        const PrintRegion &region               = *m_print->regions()[region_id];
+        LayerRegion &layerm                     = *m_layers[layer_idx]->m_regions[region_id];
+        const LayerRegion &upper_layerm         = *m_layers[layer_idx+1]->m_regions[region_id];
+        const Polygons upper_layerm_polygons    = upper_layerm.slices;
+        // Filter upper layer polygons in intersection_ppl by their bounding boxes?
+        // my $upper_layerm_poly_bboxes= [ map $_->bounding_box, @{$upper_layerm_polygons} ];
+        const double total_loop_length      = total_length(upper_layerm_polygons);
+        const coord_t perimeter_spacing     = layerm.flow(frPerimeter).scaled_spacing();
+        const Flow ext_perimeter_flow       = layerm.flow(frExternalPerimeter);
+        const coord_t ext_perimeter_width   = ext_perimeter_flow.scaled_width();
+        const coord_t ext_perimeter_spacing = ext_perimeter_flow.scaled_spacing();
+
+        for (Surface &slice : layerm.slices.surfaces) {
+            for (;;) {
+                // compute the total thickness of perimeters
+                const coord_t perimeters_thickness = ext_perimeter_width/2 + ext_perimeter_spacing/2
+                    + (region.config().perimeters-1 + slice.extra_perimeters) * perimeter_spacing;
+                // define a critical area where we don't want the upper slice to fall into
+                // (it should either lay over our perimeters or outside this area)
+                const coord_t critical_area_depth = coord_t(perimeter_spacing * 1.5);
+                const Polygons critical_area = diff(
+                    offset(slice.expolygon, float(- perimeters_thickness)),
+                    offset(slice.expolygon, float(- perimeters_thickness - critical_area_depth))
+                );
+                // check whether a portion of the upper slices falls inside the critical area
+                const Polylines intersection = intersection_pl(to_polylines(upper_layerm_polygons), critical_area);
+                // only add an additional loop if at least 30% of the slice loop would benefit from it
+                if (total_length(intersection) <=  total_loop_length*0.3)
+                    break;
+                /*
+                if (0) {
+                    require "Slic3r/SVG.pm";
+                    Slic3r::SVG::output(
+                        "extra.svg",
+                        no_arrows   => 1,
+                        expolygons  => union_ex($critical_area),
+                        polylines   => [ map $_->split_at_first_point, map $_->p, @{$upper_layerm->slices} ],
+                    );
+                }
+                */
+                ++ slice.extra_perimeters;
+            }
+            #ifdef DEBUG
+                if (slice.extra_perimeters > 0)
+                    printf("  adding %d more perimeter(s) at layer %zu\n", slice.extra_perimeters, layer_idx);
+            #endif
+        }
+    };
 
+    // The extra perimeters of a layer only depend on the slices of the layer above, which are not modified anymore,
+    // therefore the extra perimeters and the perimeters of a layer are generated in a single pass over the layers,
+    // without waiting for all the layers of all the regions to have their extra perimeters calculated.
     BOOST_LOG_TRIVIAL(debug) << "Generating perimeters in parallel - start";
     tbb::parallel_for(
         tbb::blocked_range<size_t>(0, m_layers.size()),
-        [this](const tbb::blocked_range<size_t>& range) {
+        [this, &extra_perimeters_regions, &make_extra_perimeters](const tbb::blocked_range<size_t>& range) {
             for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
                 m_print->throw_if_canceled();
+                if (layer_idx + 1 < m_layers.size())
+                    for (size_t region_id : extra_perimeters_regions)
+                        make_extra_perimeters(layer_idx, region_id);
+                SLIC3R_TRACE_ZONE("Layer::make_perimeters", "layer", int64_t(layer_idx));
                 m_layers[layer_idx]->make_perimeters();
             }
         }
     );
     m_print->throw_if_canceled();
     BOOST_LOG_TRIVIAL(debug) << "Generating perimeters in parallel - end";
+    // Release the offsets of the lower slices cached for the overhang detection.
+    for (const Layer *layer : m_layers)
+        layer->clear_lslices_offsets();
+    m_intermediate_data_released = false;
 
     this->set_done(posPerimeters);
+    log_object_memory_stats(*this, "perimeters");
 }
 
 void PrintObject::prepare_infill()
 {
     if (! this->set_started(posPrepareInfill))
         return;
+    SLIC3R_TRACE_ZONE("PrintObject::prepare_infill");
 
     m_print->set_status(30, L("Preparing infill"));
 
@@ -358,6 +381,7 @@ void PrintObject::prepare_infill()
 #endif /* SLIC3R_DEBUG_SLICE_PROCESSING */
 
     this->set_done(posPrepareInfill);
+    log_object_memory_stats(*this, "prepare_infill");
 }
 
 void PrintObject::infill()
@@ -366,13 +390,17 @@ void PrintObject::infill()
     this->prepare_infill();
 
     if (this->set_started(posInfill)) {
+        SLIC3R_TRACE_ZONE("PrintObject::infill");
         BOOST_LOG_TRIVIAL(debug) << "Filling layers in parallel - start";
         tbb::parallel_for(
             tbb::blocked_range<size_t>(0, m_layers.size()),
             [this](const tbb::blocked_range<size_t>& range) {
                 for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
                     m_print->throw_if_canceled();
+                    SLIC3R_TRACE_ZONE("Layer::make_fills", "layer", int64_t(layer_idx));
                     m_layers[layer_idx]->make_fills();
+                    // Perimeters and fills of this layer are final now, they will be held in memory until the G-code export.
+                    m_layers[layer_idx]->shrink_extrusions_to_fit();
                 }
             }
         );
@@ -382,17 +410,21 @@ void PrintObject::infill()
         ### $_->fill_surfaces->clear for map @{$_->regions}, @{$object->layers};
         */
         this->set_done(posInfill);
+        log_object_memory_stats(*this, "infill");
     }
 }
 
 void PrintObject::generate_support_material()
 {
     if (this->set_started(posSupportMaterial)) {
+        SLIC3R_TRACE_ZONE("PrintObject::generate_support_material");
         this->clear_support_layers();
         if ((m_config.support_material || m_config.raft_layers > 0) && m_layers.size() > 1) {
             m_print->set_status(85, L("Generating support material"));    
             this->_generate_support_material();
             m_print->throw_if_canceled();
+            for (SupportLayer *layer : m_support_layers)
+                layer->support_fills.shrink_to_fit();
         } else {
 #if 0
             // Printing without supports. Empty layer means some objects or object parts are levitating,
@@ -403,9 +435,30 @@ void PrintObject::generate_support_material()
 #endif
         }
         this->set_done(posSupportMaterial);
+        log_object_memory_stats(*this, "support_material");
     }
 }
 
+void PrintObject::release_intermediate_data()
+{
+    if (m_intermediate_data_released || ! this->is_step_done(posInfill) || ! this->is_step_done(posSupportMaterial))
+        return;
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, m_layers.size()),
+        [this](const tbb::blocked_range<size_t>& range) {
+            for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx)
+                for (LayerRegion *layerm : m_layers[layer_idx]->regions()) {
+                    // The thin fills were copied into the fills by Layer::make_fills().
+                    layerm->thin_fills.clear();
+                    layerm->thin_fills.shrink_to_fit();
+                    ExPolygons().swap(layerm->fill_expolygons);
+                    Surfaces().swap(layerm->fill_surfaces.surfaces);
+                }
+        });
+    m_intermediate_data_released = true;
+    log_object_memory_stats(*this, "released intermediate data");
+}
+
 void PrintObject::clear_layers()
 {
     for (Layer *l : m_layers)
@@ -576,6 +629,12 @@ bool PrintObject::invalidate_state_by_config_options(const std::vector<t_config_
 bool PrintObject::invalidate_step(PrintObjectStep step)
 {
 	bool invalidated = Inherited::invalidate_step(step);
+
+    if (m_intermediate_data_released && (step == posPrepareInfill || step == posInfill || step == posSupportMaterial)) {
+        // The fill surfaces and thin fills produced by the perimeters step were released, regenerate them.
+        m_intermediate_data_released = false;
+        invalidated |= this->invalidate_step(posPerimeters);
+    }
     
     // propagate to dependent steps
     if (step == posPerimeters) {
@@ -899,6 +958,56 @@ void PrintObject::process_external_surfaces()
     }
 }
 
+// Aggregate (union, intersection) of the polygons of any window of up to window_size consecutive layers.
+// The layers are split into blocks of window_size layers, and the prefix and suffix aggregates of each block are precalculated,
+// so that a window spanning two blocks is aggregated from a suffix of the first block and a prefix of the second block.
+// Thus the number of the aggregations does not grow with the window size.
+class LayerWindowAggregate
+{
+public:
+    // fetch(idx_layer) returns the polygons of a layer, merge(polygons1, polygons2) returns their aggregate.
+    // Nothing is precalculated for a zero window size.
+    template<typename FetchFn, typename MergeFn>
+    LayerWindowAggregate(size_t num_layers, size_t window_size, FetchFn fetch, MergeFn merge) :
+        m_window_size(window_size), m_prefix(window_size > 0 ? num_layers : 0), m_suffix(window_size > 0 ? num_layers : 0)
+    {
+        if (m_window_size == 0)
+            return;
+        size_t num_blocks = (num_layers + m_window_size - 1) / m_window_size;
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, num_blocks), [this, num_layers, &fetch, &merge](const tbb::blocked_range<size_t> &range) {
+            for (size_t idx_block = range.begin(); idx_block < range.end(); ++ idx_block) {
+                size_t begin = idx_block * m_window_size;
+                size_t end   = std::min(begin + m_window_size, num_layers);
+                m_prefix[begin] = fetch(begin);
+                for (size_t i = begin + 1; i < end; ++ i)
+                    m_prefix[i] = merge(m_prefix[i - 1], fetch(i));
+                m_suffix[end - 1] = fetch(end - 1);
+                for (size_t i = end - 1; i > begin; -- i)
+                    m_suffix[i - 1] = merge(fetch(i - 1), m_suffix[i]);
+            }
+        });
+    }
+
+    // Aggregate of the layers <first, last>, last - first < window_size.
+    // A window inside a single block is either a prefix or a suffix of the block, as the windows are clipped by the first and the last layer only.
+    template<typename MergeFn>
+    Polygons operator()(size_t first, size_t last, MergeFn merge) const
+    {
+        assert(first <= last && last - first < m_window_size && last < m_prefix.size());
+        if (first / m_window_size != last / m_window_size)
+            return merge(m_suffix[first], m_prefix[last]);
+        if (first % m_window_size == 0)
+            return m_prefix[last];
+        assert(last + 1 == m_prefix.size() || (last + 1) % m_window_size == 0);
+        return m_suffix[first];
+    }
+
+private:
+    size_t                  m_window_size;
+    std::vector<Polygons>   m_prefix;
+    std::vector<Polygons>   m_suffix;
+};
+
 void PrintObject::discover_vertical_shells()
 {
     PROFILE_FUNC();
@@ -952,11 +1061,11 @@ void PrintObject::discover_vertical_shells()
                         LayerRegion &layerm                       = *layer.m_regions[idx_region];
                         float        min_perimeter_infill_spacing = float(layerm.flow(frSolidInfill).scaled_spacing()) * 1.05f;
                         // Top surfaces.
-                        append(cache.top_surfaces, offset(to_expolygons(layerm.slices.filter_by_type(stTop)), min_perimeter_infill_spacing));
-                        append(cache.top_surfaces, offset(to_expolygons(layerm.fill_surfaces.filter_by_type(stTop)), min_perimeter_infill_spacing));
+                        append(cache.top_surfaces, offset(layerm.slices.expolygons_by_type(stTop), min_perimeter_infill_spacing));
+                        append(cache.top_surfaces, offset(layerm.fill_surfaces.expolygons_by_type(stTop), min_perimeter_infill_spacing));
                         // Bottom surfaces.
-                        append(cache.bottom_surfaces, offset(to_expolygons(layerm.slices.filter_by_types(surfaces_bottom, 2)), min_perimeter_infill_spacing));
-                        append(cache.bottom_surfaces, offset(to_expolygons(layerm.fill_surfaces.filter_by_types(surfaces_bottom, 2)), min_perimeter_infill_spacing));
+                        append(cache.bottom_surfaces, offset(layerm.slices.expolygons_by_types(surfaces_bottom, 2), min_perimeter_infill_spacing));
+                        append(cache.bottom_surfaces, offset(layerm.fill_surfaces.expolygons_by_types(surfaces_bottom, 2), min_perimeter_infill_spacing));
                         // Calculate the maximum perimeter offset as if the slice was extruded with a single extruder only.
                         // First find the maxium number of perimeters per region slice.
                         unsigned int perimeters = 0;
@@ -1028,11 +1137,11 @@ void PrintObject::discover_vertical_shells()
                         float        min_perimeter_infill_spacing = float(layerm.flow(frSolidInfill).scaled_spacing()) * 1.05f;
                         // Top surfaces.
                         auto &cache = cache_top_botom_regions[idx_layer];
-                        cache.top_surfaces = offset(to_expolygons(layerm.slices.filter_by_type(stTop)), min_perimeter_infill_spacing);
-                        append(cache.top_surfaces, offset(to_expolygons(layerm.fill_surfaces.filter_by_type(stTop)), min_perimeter_infill_spacing));
+                        cache.top_surfaces = offset(layerm.slices.expolygons_by_type(stTop), min_perimeter_infill_spacing);
+                        append(cache.top_surfaces, offset(layerm.fill_surfaces.expolygons_by_type(stTop), min_perimeter_infill_spacing));
                         // Bottom surfaces.
-                        cache.bottom_surfaces = offset(to_expolygons(layerm.slices.filter_by_types(surfaces_bottom, 2)), min_perimeter_infill_spacing);
-                        append(cache.bottom_surfaces, offset(to_expolygons(layerm.fill_surfaces.filter_by_types(surfaces_bottom, 2)), min_perimeter_infill_spacing));
+                        cache.bottom_surfaces = offset(layerm.slices.expolygons_by_types(surfaces_bottom, 2), min_perimeter_infill_spacing);
+                        append(cache.bottom_surfaces, offset(layerm.fill_surfaces.expolygons_by_types(surfaces_bottom, 2), min_perimeter_infill_spacing));
                         // Holes over all regions. Only collect them once, they are valid for all idx_region iterations.
                         if (cache.holes.empty()) {
                             for (size_t idx_region = 0; idx_region < layer.regions().size(); ++ idx_region)
@@ -1044,10 +1153,35 @@ void PrintObject::discover_vertical_shells()
             BOOST_LOG_TRIVIAL(debug) << "Discovering vertical shells for region " << idx_region << " in parallel - end : cache top / bottom";
         }
 
+        // Unions of the top / bottom surfaces and intersections of the holes over the moving windows of layers.
+        BOOST_LOG_TRIVIAL(debug) << "Discovering vertical shells for region " << idx_region << " in parallel - start : aggregate top / bottom";
+        auto merge_union = [](const Polygons &polygons1, const Polygons &polygons2) {
+            // Running the union_ using the Clipper library piece by piece is cheaper 
+            // than running the union_ all at once.
+            if (polygons2.empty())
+                return polygons1;
+            if (polygons1.empty())
+                return polygons2;
+            Polygons out = polygons1;
+            polygons_append(out, polygons2);
+            return union_(out, false);
+        };
+        auto merge_intersection = [](const Polygons &polygons1, const Polygons &polygons2) {
+            return polygons1.empty() ? Polygons() : intersection(polygons1, polygons2);
+        };
+        LayerWindowAggregate top_surfaces(m_layers.size(), size_t(n_extra_top_layers),
+            [&cache_top_botom_regions](size_t idx_layer) -> const Polygons& { return cache_top_botom_regions[idx_layer].top_surfaces; }, merge_union);
+        LayerWindowAggregate bottom_surfaces(m_layers.size(), size_t(n_extra_bottom_layers),
+            [&cache_top_botom_regions](size_t idx_layer) -> const Polygons& { return cache_top_botom_regions[idx_layer].bottom_surfaces; }, merge_union);
+        LayerWindowAggregate holes_intersection(m_layers.size(), size_t(n_extra_bottom_layers + n_extra_top_layers + 1),
+            [&cache_top_botom_regions](size_t idx_layer) -> const Polygons& { return cache_top_botom_regions[idx_layer].holes; }, merge_intersection);
+        m_print->throw_if_canceled();
+        BOOST_LOG_TRIVIAL(debug) << "Discovering vertical shells for region " << idx_region << " in parallel - end : aggregate top / bottom";
+
         BOOST_LOG_TRIVIAL(debug) << "Discovering vertical shells for region " << idx_region << " in parallel - start : ensure vertical wall thickness";
         tbb::parallel_for(
             tbb::blocked_range<size_t>(0, m_layers.size(), grain_size),
-            [this, idx_region, n_extra_top_layers, n_extra_bottom_layers, &cache_top_botom_regions]
+            [this, idx_region, n_extra_top_layers, n_extra_bottom_layers, &top_surfaces, &bottom_surfaces, &holes_intersection, &merge_union, &merge_intersection]
             (const tbb::blocked_range<size_t>& range) {
                 // printf("discover_vertical_shells from %d to %d\n", range.begin(), range.end());
                 for (size_t idx_layer = range.begin(); idx_layer < range.end(); ++ idx_layer) {
@@ -1099,30 +1233,16 @@ void PrintObject::discover_vertical_shells()
                             }
                         }
 #endif /* SLIC3R_DEBUG_SLICE_PROCESSING */
-                        // Reset the top / bottom inflated regions caches of entries, which are out of the moving window.
-                        bool hole_first = true;
-                        for (int n = (int)idx_layer - n_extra_bottom_layers; n <= (int)idx_layer + n_extra_top_layers; ++ n)
-                            if (n >= 0 && n < (int)m_layers.size()) {
-                                const DiscoverVerticalShellsCacheEntry &cache = cache_top_botom_regions[n];
-                                if (hole_first) {
-                                    hole_first = false;
-                                    polygons_append(holes, cache.holes);
-                                }
-                                else if (! holes.empty()) {
-                                    holes = intersection(holes, cache.holes);
-                                }
-                                size_t n_shell_old = shell.size();
-                                if (n > int(idx_layer))
-                                    // Collect top surfaces.
-                                    polygons_append(shell, cache.top_surfaces);
-                                else if (n < int(idx_layer))
-                                    // Collect bottom and bottom bridge surfaces.
-                                    polygons_append(shell, cache.bottom_surfaces);
-                                // Running the union_ using the Clipper library piece by piece is cheaper 
-                                // than running the union_ all at once.
-                                if (n_shell_old < shell.size())
-                                   shell = union_(shell, false);
-                            }
+                        // Collect the top / bottom inflated regions of the moving window.
+                        size_t idx_first = size_t(std::max(0, int(idx_layer) - n_extra_bottom_layers));
+                        size_t idx_last  = std::min(m_layers.size() - 1, idx_layer + size_t(n_extra_top_layers));
+                        holes = holes_intersection(idx_first, idx_last, merge_intersection);
+                        if (idx_first < idx_layer)
+                            // Collect bottom and bottom bridge surfaces.
+                            shell = bottom_surfaces(idx_first, idx_layer - 1, merge_union);
+                        if (idx_layer < idx_last)
+                            // Collect top surfaces.
+                            shell = merge_union(shell, top_surfaces(idx_layer + 1, idx_last, merge_union));
 #ifdef SLIC3R_DEBUG_SLICE_PROCESSING
                         {
         					Slic3r::SVG svg(debug_out_path("discover_vertical_shells-perimeters-before-union-%d.svg", debug_idx), get_extents(shell));
@@ -1184,14 +1304,14 @@ void PrintObject::discover_vertical_shells()
 
                     // Trim the shells region by the internal & internal void surfaces.
                     const SurfaceType surfaceTypesInternal[] = { stInternal, stInternalVoid, stInternalSolid };
-                    const Polygons    polygonsInternal = to_polygons(layerm->fill_surfaces.filter_by_types(surfaceTypesInternal, 3));
+                    const Polygons    polygonsInternal = layerm->fill_surfaces.polygons_by_types(surfaceTypesInternal, 3);
                     shell = intersection(shell, polygonsInternal, true);
                     polygons_append(shell, diff(polygonsInternal, holes));
                     if (shell.empty())
                         continue;
 
                     // Append the internal solids, so they will be merged with the new ones.
-                    polygons_append(shell, to_polygons(layerm->fill_surfaces.filter_by_type(stInternalSolid)));
+                    polygons_append(shell, layerm->fill_surfaces.polygons_by_type(stInternalSolid));
 
                     // These regions will be filled by a rectilinear full infill. Currently this type of infill
                     // only fills regions, which fit at least a single line. To avoid gaps in the sparse infill,
@@ -1239,12 +1359,12 @@ void PrintObject::discover_vertical_shells()
 
                     // Trim the internal & internalvoid by the shell.
                     Slic3r::ExPolygons new_internal = diff_ex(
-                        to_polygons(layerm->fill_surfaces.filter_by_type(stInternal)),
+                        layerm->fill_surfaces.polygons_by_type(stInternal),
                         shell,
                         false
                     );
                     Slic3r::ExPolygons new_internal_void = diff_ex(
-                        to_polygons(layerm->fill_surfaces.filter_by_type(stInternalVoid)),
+                        layerm->fill_surfaces.polygons_by_type(stInternalVoid),
                         shell,
                         false
                     );
@@ -1497,6 +1617,32 @@ std::vector<unsigned int> PrintObject::object_extruders() const
     return extruders;
 }
 
+PrintMemoryStats PrintObject::memory_stats() const
+{
+    PrintMemoryStats stats;
+    stats.add("slice", m_layers.capacity() * sizeof(Layer*));
+    for (const Layer *layer : m_layers)
+        layer->memory_stats(stats);
+    // The cached volume slices are reused by the next slicing. Their meshes are shared with the Model, thus not counted.
+    size_t cache = 0;
+    for (const std::pair<const ObjectID, VolumeSlices> &volume : m_volume_slices) {
+        cache += sizeof(volume) + volume.second.layers.capacity() * sizeof(std::pair<float, ExPolygons>);
+        for (const std::pair<float, ExPolygons> &layer : volume.second.layers)
+            cache += memsize(layer.second);
+        if (volume.second.facets_edges)
+            cache += volume.second.facets_edges->capacity() * sizeof(int);
+    }
+    stats.add("slice", cache);
+    if (! m_support_layers.empty()) {
+        // The support layers are fully owned by the support generator, including their slices.
+        PrintMemoryStats support_stats;
+        for (const SupportLayer *layer : m_support_layers)
+            layer->memory_stats(support_stats);
+        stats.add("support_material", m_support_layers.capacity() * sizeof(SupportLayer*) + support_stats.total());
+    }
+    return stats;
+}
+
 bool PrintObject::update_layer_height_profile(const ModelObject &model_object, const SlicingParameters &slicing_parameters, std::vector<coordf_t> &layer_height_profile)
 {
     bool updated = false;
@@ -1536,6 +1682,8 @@ void PrintObject::_slice(const std::vector<coordf_t> &layer_height_profile)
     BOOST_LOG_TRIVIAL(info) << "Slicing objects..." << log_memory_info();
 
     this->typed_slices = false;
+    // Possibly left over from a canceled slicing.
+    m_volume_slices_next.clear();
 
 #ifdef SLIC3R_PROFILE
     // Disable parallelization so the Shiny profiler works
@@ -1752,7 +1900,9 @@ void PrintObject::_slice(const std::vector<coordf_t> &layer_height_profile)
     }
     m_print->throw_if_canceled();
 end:
-    ;
+    // Keep the slices of the volumes and layers sliced this time for the next slicing.
+    m_volume_slices = std::move(m_volume_slices_next);
+    m_volume_slices_next.clear();
 
     BOOST_LOG_TRIVIAL(debug) << "Slicing objects - make_slices in parallel - begin";
     {
@@ -1977,6 +2127,10 @@ std::vector<ExPolygons> PrintObject::slice_support_volumes(const ModelVolumeType
 
 std::vector<ExPolygons> PrintObject::slice_volumes(const std::vector<float> &z, const std::vector<const ModelVolume*> &volumes) const
 {
+    if (volumes.size() == 1)
+        // Sliced the same way by slice_volume(), which may reuse the slices of the previous slicing.
+        return this->slice_volume(z, *volumes.front());
+
     std::vector<ExPolygons> layers;
     if (! volumes.empty()) {
         // Compose mesh.
@@ -2016,28 +2170,112 @@ std::vector<ExPolygons> PrintObject::slice_volume(const std::vector<float> &z, c
 {
     std::vector<ExPolygons> layers;
     if (! z.empty()) {
-	    // Compose mesh.
-	    //FIXME better to split the mesh into separate shells, perform slicing over each shell separately and then to use a Boolean operation to merge them.
-	    TriangleMesh mesh(volume.mesh());
-	    mesh.transform(volume.get_matrix(), true);
-		if (mesh.repaired) {
-			//FIXME The admesh repair function may break the face connectivity, rather refresh it here as the slicing code relies on it.
-			stl_check_facets_exact(&mesh.stl);
+    	// Only the model parts and modifiers are sliced by _slice() and cached, support enforcers and blockers are not.
+    	bool 		  cache          = volume.is_model_part() || volume.is_modifier();
+    	Transform3d   trafo          = Geometry::assemble_transform(Vec3d(- unscale<double>(m_copies_shift(0)), - unscale<double>(m_copies_shift(1)), 0.)) * m_trafo * volume.get_matrix();
+    	float         closing_radius = float(m_config.slice_closing_radius.value);
+    	// Slices of this volume by the previous slicing, if its mesh, transformation and closing radius did not change.
+    	const VolumeSlices *cached   = nullptr;
+    	// Topology of the volume mesh built by the previous slicing, it does not depend on the transformation.
+    	TriangleMeshSlicer::FacetsEdgesPtr facets_edges;
+    	if (cache) {
+    		auto it = m_volume_slices.find(volume.id());
+    		if (it != m_volume_slices.end() && it->second.mesh.get() == &volume.mesh()) {
+    			facets_edges = it->second.facets_edges;
+    			if (it->second.trafo.matrix() == trafo.matrix() && it->second.closing_radius == closing_radius)
+    				cached = &it->second;
+    		}
+    	}
+    	// Slices of this volume stored on disk by a previous session, if the in-memory slices are not available.
+    	VolumeSlices  disk_cached;
+    	std::string   disk_key;
+    	if (cache && cached == nullptr && SliceCache::enabled()) {
+    		disk_key = SliceCache::key(volume.mesh(), trafo, closing_radius);
+    		if (SliceCache::load(disk_key, disk_cached.layers))
+    			cached = &disk_cached;
+    	}
+    	// Indices of z, which have to be sliced.
+    	std::vector<float>  z_missing;
+    	std::vector<size_t> idx_missing;
+		layers.assign(z.size(), ExPolygons());
+    	for (size_t i = 0, j = 0; i < z.size(); ++ i) {
+    		if (cached != nullptr) {
+    			for (; j < cached->layers.size() && cached->layers[j].first < z[i]; ++ j) ;
+    			if (j < cached->layers.size() && cached->layers[j].first == z[i]) {
+    				layers[i] = cached->layers[j].second;
+    				continue;
+    			}
+    		}
+    		z_missing.emplace_back(z[i]);
+    		idx_missing.emplace_back(i);
+    	}
+    	if (! z_missing.empty()) {
+		    //FIXME better to split the mesh into separate shells, perform slicing over each shell separately and then to use a Boolean operation to merge them.
+		    const TriangleMesh &volume_mesh = volume.mesh();
+		    if (volume_mesh.stl.stats.number_of_facets > 0) {
+		        TriangleMeshSlicer mslicer;
+		        const Print *print = this->print();
+		        auto callback = TriangleMeshSlicer::throw_on_cancel_callback_type([print](){print->throw_if_canceled();});
+		        // Only needed for the left handed transformations, which flip the facets.
+		        TriangleMesh mesh;
+		        if (volume_mesh.has_shared_vertices() && trafo.matrix().block(0, 0, 3, 3).determinant() >= 0.) {
+		            // Slice the mesh shared with the Model, its vertices are transformed on the fly.
+		            mslicer.init(&volume_mesh, trafo, std::move(facets_edges), callback);
+		            facets_edges = mslicer.facets_edges();
+		        } else {
+		            // Compose mesh.
+		            mesh = volume_mesh;
+		            mesh.transform(volume.get_matrix(), true);
+		            if (mesh.repaired) {
+		                //FIXME The admesh repair function may break the face connectivity, rather refresh it here as the slicing code relies on it.
+		                stl_check_facets_exact(&mesh.stl);
+		            }
+		            mesh.transform(m_trafo, true);
+		            // apply XY shift
+		            mesh.translate(- unscale<float>(m_copies_shift(0)), - unscale<float>(m_copies_shift(1)), 0);
+		            // TriangleMeshSlicer needs the shared vertices.
+		            mesh.require_shared_vertices();
+		            mslicer.init(&mesh, callback);
+		        }
+		        // perform actual slicing
+		        std::vector<ExPolygons> layers_missing;
+		        mslicer.slice(z_missing, closing_radius, &layers_missing, callback);
+		        m_print->throw_if_canceled();
+		        for (size_t i = 0; i < idx_missing.size(); ++ i)
+		        	layers[idx_missing[i]] = std::move(layers_missing[i]);
+		    } else if (idx_missing.size() == z.size())
+		    	// Nothing was sliced, return an empty vector as before.
+		    	layers.clear();
+		    if (! disk_key.empty() && ! layers.empty()) {
+		    	// Store the new slices together with the slices loaded from disk at the other z.
+		    	std::vector<std::pair<float, ExPolygons>> disk_layers;
+		    	disk_layers.reserve(z.size() + disk_cached.layers.size());
+		    	for (size_t i = 0; i < z.size(); ++ i)
+		    		disk_layers.emplace_back(z[i], layers[i]);
+		    	for (std::pair<float, ExPolygons> &layer : disk_cached.layers)
+		    		if (! std::binary_search(z.begin(), z.end(), layer.first))
+		    			disk_layers.emplace_back(layer.first, std::move(layer.second));
+	    		std::stable_sort(disk_layers.begin(), disk_layers.end(), [](const std::pair<float, ExPolygons> &l, const std::pair<float, ExPolygons> &r) { return l.first < r.first; });
+		    	SliceCache::save(disk_key, disk_layers);
+		    }
+		}
+		if (cache && ! layers.empty()) {
+			VolumeSlices &next = m_volume_slices_next[volume.id()];
+			if (next.mesh.get() != &volume.mesh()) {
+				next.mesh 			= volume.get_mesh_shared_ptr();
+				next.trafo 			= trafo;
+				next.closing_radius = closing_radius;
+				next.layers.clear();
+			}
+			if (facets_edges)
+				next.facets_edges = std::move(facets_edges);
+			// A volume split into multiple layer ranges may be sliced multiple times with different z.
+			size_t old_size = next.layers.size();
+			for (size_t i = 0; i < z.size(); ++ i)
+				next.layers.emplace_back(z[i], layers[i]);
+			if (old_size > 0)
+				std::stable_sort(next.layers.begin(), next.layers.end(), [](const std::pair<float, ExPolygons> &l, const std::pair<float, ExPolygons> &r) { return l.first < r.first; });
 		}
-	    if (mesh.stl.stats.number_of_facets > 0) {
-	        mesh.transform(m_trafo, true);
-	        // apply XY shift
-	        mesh.translate(- unscale<float>(m_copies_shift(0)), - unscale<float>(m_copies_shift(1)), 0);
-	        // perform actual slicing
-	        TriangleMeshSlicer mslicer;
-	        const Print *print = this->print();
-	        auto callback = TriangleMeshSlicer::throw_on_cancel_callback_type([print](){print->throw_if_canceled();});
-	        // TriangleMeshSlicer needs the shared vertices.
-	        mesh.require_shared_vertices();
-	        mslicer.init(&mesh, callback);
-	        mslicer.slice(z, float(m_config.slice_closing_radius.value), &layers, callback);
-	        m_print->throw_if_canceled();
-	    }
 	}
     return layers;
 }
@@ -2087,32 +2325,48 @@ std::string PrintObject::_fix_slicing_errors()
         if (m_layers[idx_layer]->slicing_errors)
             buggy_layers.push_back(idx_layer);
 
+    // Find the first valid layer below / above each buggy layer in a single pass over the layers,
+    // searching for them from each buggy layer is quadratic for long runs of buggy layers.
+    // size_t(-1) marks a missing valid layer.
+    std::vector<std::pair<size_t, size_t>> valid_layers_below_above(buggy_layers.size(), { size_t(-1), size_t(-1) });
+    {
+        size_t last_valid = size_t(-1);
+        for (size_t i = 0, j = 0; i < m_layers.size(); ++ i)
+            if (m_layers[i]->slicing_errors)
+                valid_layers_below_above[j ++].first = last_valid;
+            else
+                last_valid = i;
+        last_valid = size_t(-1);
+        for (size_t i = m_layers.size(), j = buggy_layers.size(); i > 0; -- i)
+            if (m_layers[i - 1]->slicing_errors)
+                valid_layers_below_above[-- j].second = last_valid;
+            else
+                last_valid = i - 1;
+    }
+
     BOOST_LOG_TRIVIAL(debug) << "Slicing objects - fixing slicing errors in parallel - begin";
     tbb::parallel_for(
         tbb::blocked_range<size_t>(0, buggy_layers.size()),
-        [this, &buggy_layers](const tbb::blocked_range<size_t>& range) {
+        [this, &buggy_layers, &valid_layers_below_above](const tbb::blocked_range<size_t>& range) {
             for (size_t buggy_layer_idx = range.begin(); buggy_layer_idx < range.end(); ++ buggy_layer_idx) {
                 m_print->throw_if_canceled();
                 size_t idx_layer = buggy_layers[buggy_layer_idx];
                 Layer *layer     = m_layers[idx_layer];
                 assert(layer->slicing_errors);
+                const Layer *lower_layer = valid_layers_below_above[buggy_layer_idx].first  == size_t(-1) ? nullptr : m_layers[valid_layers_below_above[buggy_layer_idx].first];
+                const Layer *upper_layer = valid_layers_below_above[buggy_layer_idx].second == size_t(-1) ? nullptr : m_layers[valid_layers_below_above[buggy_layer_idx].second];
                 // Try to repair the layer surfaces by merging all contours and all holes from neighbor layers.
                 // BOOST_LOG_TRIVIAL(trace) << "Attempting to repair layer" << idx_layer;
                 for (size_t region_id = 0; region_id < layer->m_regions.size(); ++ region_id) {
                     LayerRegion *layerm = layer->m_regions[region_id];
-                    // Find the first valid layer below / above the current layer.
-                    const Surfaces *upper_surfaces = nullptr;
-                    const Surfaces *lower_surfaces = nullptr;
-                    for (size_t j = idx_layer + 1; j < m_layers.size(); ++ j)
-                        if (! m_layers[j]->slicing_errors) {
-                            upper_surfaces = &m_layers[j]->regions()[region_id]->slices.surfaces;
-                            break;
-                        }
-                    for (int j = int(idx_layer) - 1; j >= 0; -- j)
-                        if (! m_layers[j]->slicing_errors) {
-                            lower_surfaces = &m_layers[j]->regions()[region_id]->slices.surfaces;
-                            break;
-                        }
+                    // The first valid layer below / above the current layer.
+                    const Surfaces *upper_surfaces = upper_layer ? &upper_layer->regions()[region_id]->slices.surfaces : nullptr;
+                    const Surfaces *lower_surfaces = lower_layer ? &lower_layer->regions()[region_id]->slices.surfaces : nullptr;
+                    if ((upper_surfaces == nullptr || upper_surfaces->empty()) && (lower_surfaces == nullptr || lower_surfaces->empty())) {
+                        // Nothing to merge, the region is empty both below and above.
+                        layerm->slices.clear();
+                        continue;
+                    }
                     // Collect outer contours and holes from the valid layers above & below.
                     Polygons outer;
                     outer.reserve(
@@ -2147,12 +2401,15 @@ std::string PrintObject::_fix_slicing_errors()
     BOOST_LOG_TRIVIAL(debug) << "Slicing objects - fixing slicing errors in parallel - end";
 
     // remove empty layers from bottom
-    while (! m_layers.empty() && (m_layers.front()->lslices.empty() || m_layers.front()->empty())) {
-        delete m_layers.front();
-        m_layers.erase(m_layers.begin());
-        m_layers.front()->lower_layer = nullptr;
-        for (size_t i = 0; i < m_layers.size(); ++ i)
-            m_layers[i]->set_id(m_layers[i]->id() - 1);
+    size_t num_empty = 0;
+    while (num_empty < m_layers.size() && (m_layers[num_empty]->lslices.empty() || m_layers[num_empty]->empty()))
+        delete m_layers[num_empty ++];
+    if (num_empty > 0) {
+        m_layers.erase(m_layers.begin(), m_layers.begin() + num_empty);
+        if (! m_layers.empty())
+            m_layers.front()->lower_layer = nullptr;
+        for (Layer *layer : m_layers)
+            layer->set_id(layer->id() - num_empty);
     }
 
     return buggy_layers.empty() ? "" :
@@ -2175,10 +2432,17 @@ void PrintObject::simplify_slices(double distance)
                 for (size_t region_idx = 0; region_idx < layer->m_regions.size(); ++ region_idx)
                     layer->m_regions[region_idx]->slices.simplify(distance);
 				{
-					ExPolygons simplified;
-					for (const ExPolygon &expoly : layer->lslices)
-						expoly.simplify(distance, &simplified);
-					layer->lslices = std::move(simplified);
+					// Simplify the islands in parallel as well, a layer of a high resolution mesh may hold millions of points.
+					std::vector<ExPolygons> simplified(layer->lslices.size());
+					tbb::parallel_for(tbb::blocked_range<size_t>(0, layer->lslices.size()),
+						[layer, distance, &simplified](const tbb::blocked_range<size_t> &range) {
+							for (size_t island_idx = range.begin(); island_idx < range.end(); ++ island_idx)
+								layer->lslices[island_idx].simplify(distance, &simplified[island_idx]);
+						});
+					ExPolygons lslices;
+					for (ExPolygons &island : simplified)
+						append(lslices, std::move(island));
+					layer->lslices = std::move(lslices);
 				}
             }
         });
@@ -2275,178 +2539,190 @@ void PrintObject::discover_horizontal_shells()
 {
     BOOST_LOG_TRIVIAL(trace) << "discover_horizontal_shells()";
     
-    for (size_t region_id = 0; region_id < this->region_volumes.size(); ++ region_id) {
-        for (size_t i = 0; i < m_layers.size(); ++ i) {
-            m_print->throw_if_canceled();
-            LayerRegion             *layerm = m_layers[i]->regions()[region_id];
-            const PrintRegionConfig &region_config = layerm->region()->config();
-            if (region_config.solid_infill_every_layers.value > 0 && region_config.fill_density.value > 0 &&
-                (i % region_config.solid_infill_every_layers) == 0) {
-                // Insert a solid internal layer. Mark stInternal surfaces as stInternalSolid or stInternalBridge.
-                SurfaceType type = (region_config.fill_density == 100) ? stInternalSolid : stInternalBridge;
-                for (Surface &surface : layerm->fill_surfaces.surfaces)
-                    if (surface.surface_type == stInternal)
-                        surface.surface_type = type;
-            }
+    // The regions are processed independently of each other, in parallel.
+    // The layers of a region have to be processed serially, as each layer modifies its neighbors, which are then processed
+    // with the modified surfaces.
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, this->region_volumes.size()),
+        [this](const tbb::blocked_range<size_t>& range) {
+            for (size_t region_id = range.begin(); region_id < range.end(); ++ region_id) {
+                const PrintRegionConfig &config = m_print->get_region(region_id)->config();
+                if (config.ensure_vertical_shell_thickness.value && (config.solid_infill_every_layers.value == 0 || config.fill_density.value == 0))
+                    // Neither solid infill layers are inserted, nor the shells are propagated, that has already been performed by discover_vertical_shells().
+                    continue;
+                for (size_t i = 0; i < m_layers.size(); ++ i) {
+                    m_print->throw_if_canceled();
+                    LayerRegion             *layerm = m_layers[i]->regions()[region_id];
+                    const PrintRegionConfig &region_config = layerm->region()->config();
+                    if (region_config.solid_infill_every_layers.value > 0 && region_config.fill_density.value > 0 &&
+                        (i % region_config.solid_infill_every_layers) == 0) {
+                        // Insert a solid internal layer. Mark stInternal surfaces as stInternalSolid or stInternalBridge.
+                        SurfaceType type = (region_config.fill_density == 100) ? stInternalSolid : stInternalBridge;
+                        for (Surface &surface : layerm->fill_surfaces.surfaces)
+                            if (surface.surface_type == stInternal)
+                                surface.surface_type = type;
+                    }
 
-            // If ensure_vertical_shell_thickness, then the rest has already been performed by discover_vertical_shells().
-            if (region_config.ensure_vertical_shell_thickness.value)
-                continue;
+                    // If ensure_vertical_shell_thickness, then the rest has already been performed by discover_vertical_shells().
+                    if (region_config.ensure_vertical_shell_thickness.value)
+                        continue;
             
-            for (size_t idx_surface_type = 0; idx_surface_type < 3; ++ idx_surface_type) {
-                m_print->throw_if_canceled();
-                SurfaceType type = (idx_surface_type == 0) ? stTop : (idx_surface_type == 1) ? stBottom : stBottomBridge;
-                // Find slices of current type for current layer.
-                // Use slices instead of fill_surfaces, because they also include the perimeter area,
-                // which needs to be propagated in shells; we need to grow slices like we did for
-                // fill_surfaces though. Using both ungrown slices and grown fill_surfaces will
-                // not work in some situations, as there won't be any grown region in the perimeter 
-                // area (this was seen in a model where the top layer had one extra perimeter, thus
-                // its fill_surfaces were thinner than the lower layer's infill), however it's the best
-                // solution so far. Growing the external slices by EXTERNAL_INFILL_MARGIN will put
-                // too much solid infill inside nearly-vertical slopes.
-
-                // Surfaces including the area of perimeters. Everything, that is visible from the top / bottom
-                // (not covered by a layer above / below).
-                // This does not contain the areas covered by perimeters!
-                Polygons solid;
-                for (const Surface &surface : layerm->slices.surfaces)
-                    if (surface.surface_type == type)
-                        polygons_append(solid, to_polygons(surface.expolygon));
-                // Infill areas (slices without the perimeters).
-                for (const Surface &surface : layerm->fill_surfaces.surfaces)
-                    if (surface.surface_type == type)
-                        polygons_append(solid, to_polygons(surface.expolygon));
-                if (solid.empty())
-                    continue;
-//                Slic3r::debugf "Layer %d has %s surfaces\n", $i, ($type == stTop) ? 'top' : 'bottom';
+                    for (size_t idx_surface_type = 0; idx_surface_type < 3; ++ idx_surface_type) {
+                        m_print->throw_if_canceled();
+                        SurfaceType type = (idx_surface_type == 0) ? stTop : (idx_surface_type == 1) ? stBottom : stBottomBridge;
+                        // Find slices of current type for current layer.
+                        // Use slices instead of fill_surfaces, because they also include the perimeter area,
+                        // which needs to be propagated in shells; we need to grow slices like we did for
+                        // fill_surfaces though. Using both ungrown slices and grown fill_surfaces will
+                        // not work in some situations, as there won't be any grown region in the perimeter 
+                        // area (this was seen in a model where the top layer had one extra perimeter, thus
+                        // its fill_surfaces were thinner than the lower layer's infill), however it's the best
+                        // solution so far. Growing the external slices by EXTERNAL_INFILL_MARGIN will put
+                        // too much solid infill inside nearly-vertical slopes.
+
+                        // Surfaces including the area of perimeters. Everything, that is visible from the top / bottom
+                        // (not covered by a layer above / below).
+                        // This does not contain the areas covered by perimeters!
+                        Polygons solid;
+                        for (const Surface &surface : layerm->slices.surfaces)
+                            if (surface.surface_type == type)
+                                polygons_append(solid, to_polygons(surface.expolygon));
+                        // Infill areas (slices without the perimeters).
+                        for (const Surface &surface : layerm->fill_surfaces.surfaces)
+                            if (surface.surface_type == type)
+                                polygons_append(solid, to_polygons(surface.expolygon));
+                        if (solid.empty())
+                            continue;
+        //                Slic3r::debugf "Layer %d has %s surfaces\n", $i, ($type == stTop) ? 'top' : 'bottom';
                 
-                size_t solid_layers = (type == stTop) ? region_config.top_solid_layers.value : region_config.bottom_solid_layers.value;                
-                for (int n = (type == stTop) ? i-1 : i+1; std::abs(n - (int)i) < solid_layers; (type == stTop) ? -- n : ++ n) {
-                    if (n < 0 || n >= int(m_layers.size()))
-                        continue;
-//                    Slic3r::debugf "  looking for neighbors on layer %d...\n", $n;                  
-                    // Reference to the lower layer of a TOP surface, or an upper layer of a BOTTOM surface.
-                    LayerRegion *neighbor_layerm = m_layers[n]->regions()[region_id];
+                        size_t solid_layers = (type == stTop) ? region_config.top_solid_layers.value : region_config.bottom_solid_layers.value;                
+                        for (int n = (type == stTop) ? i-1 : i+1; std::abs(n - (int)i) < solid_layers; (type == stTop) ? -- n : ++ n) {
+                            if (n < 0 || n >= int(m_layers.size()))
+                                continue;
+        //                    Slic3r::debugf "  looking for neighbors on layer %d...\n", $n;                  
+                            // Reference to the lower layer of a TOP surface, or an upper layer of a BOTTOM surface.
+                            LayerRegion *neighbor_layerm = m_layers[n]->regions()[region_id];
                     
-                    // find intersection between neighbor and current layer's surfaces
-                    // intersections have contours and holes
-                    // we update $solid so that we limit the next neighbor layer to the areas that were
-                    // found on this one - in other words, solid shells on one layer (for a given external surface)
-                    // are always a subset of the shells found on the previous shell layer
-                    // this approach allows for DWIM in hollow sloping vases, where we want bottom
-                    // shells to be generated in the base but not in the walls (where there are many
-                    // narrow bottom surfaces): reassigning $solid will consider the 'shadow' of the 
-                    // upper perimeter as an obstacle and shell will not be propagated to more upper layers
-                    //FIXME How does it work for stInternalBRIDGE? This is set for sparse infill. Likely this does not work.
-                    Polygons new_internal_solid;
-                    {
-                        Polygons internal;
-                        for (const Surface &surface : neighbor_layerm->fill_surfaces.surfaces)
-                            if (surface.surface_type == stInternal || surface.surface_type == stInternalSolid)
-                                polygons_append(internal, to_polygons(surface.expolygon));
-                        new_internal_solid = intersection(solid, internal, true);
-                    }
-                    if (new_internal_solid.empty()) {
-                        // No internal solid needed on this layer. In order to decide whether to continue
-                        // searching on the next neighbor (thus enforcing the configured number of solid
-                        // layers, use different strategies according to configured infill density:
-                        if (region_config.fill_density.value == 0) {
-                            // If user expects the object to be void (for example a hollow sloping vase),
-                            // don't continue the search. In this case, we only generate the external solid
-                            // shell if the object would otherwise show a hole (gap between perimeters of 
-                            // the two layers), and internal solid shells are a subset of the shells found 
-                            // on each previous layer.
-                            goto EXTERNAL;
-                        } else {
-                            // If we have internal infill, we can generate internal solid shells freely.
-                            continue;
-                        }
-                    }
+                            // find intersection between neighbor and current layer's surfaces
+                            // intersections have contours and holes
+                            // we update $solid so that we limit the next neighbor layer to the areas that were
+                            // found on this one - in other words, solid shells on one layer (for a given external surface)
+                            // are always a subset of the shells found on the previous shell layer
+                            // this approach allows for DWIM in hollow sloping vases, where we want bottom
+                            // shells to be generated in the base but not in the walls (where there are many
+                            // narrow bottom surfaces): reassigning $solid will consider the 'shadow' of the 
+                            // upper perimeter as an obstacle and shell will not be propagated to more upper layers
+                            //FIXME How does it work for stInternalBRIDGE? This is set for sparse infill. Likely this does not work.
+                            Polygons new_internal_solid;
+                            {
+                                Polygons internal;
+                                for (const Surface &surface : neighbor_layerm->fill_surfaces.surfaces)
+                                    if (surface.surface_type == stInternal || surface.surface_type == stInternalSolid)
+                                        polygons_append(internal, to_polygons(surface.expolygon));
+                                new_internal_solid = intersection(solid, internal, true);
+                            }
+                            if (new_internal_solid.empty()) {
+                                // No internal solid needed on this layer. In order to decide whether to continue
+                                // searching on the next neighbor (thus enforcing the configured number of solid
+                                // layers, use different strategies according to configured infill density:
+                                if (region_config.fill_density.value == 0) {
+                                    // If user expects the object to be void (for example a hollow sloping vase),
+                                    // don't continue the search. In this case, we only generate the external solid
+                                    // shell if the object would otherwise show a hole (gap between perimeters of 
+                                    // the two layers), and internal solid shells are a subset of the shells found 
+                                    // on each previous layer.
+                                    goto EXTERNAL;
+                                } else {
+                                    // If we have internal infill, we can generate internal solid shells freely.
+                                    continue;
+                                }
+                            }
                     
-                    if (region_config.fill_density.value == 0) {
-                        // if we're printing a hollow object we discard any solid shell thinner
-                        // than a perimeter width, since it's probably just crossing a sloping wall
-                        // and it's not wanted in a hollow print even if it would make sense when
-                        // obeying the solid shell count option strictly (DWIM!)
-                        float margin = float(neighbor_layerm->flow(frExternalPerimeter).scaled_width());
-                        Polygons too_narrow = diff(
-                            new_internal_solid, 
-                            offset2(new_internal_solid, -margin, +margin, jtMiter, 5), 
-                            true);
-                        // Trim the regularized region by the original region.
-                        if (! too_narrow.empty())
-                            new_internal_solid = solid = diff(new_internal_solid, too_narrow);
-                    }
+                            if (region_config.fill_density.value == 0) {
+                                // if we're printing a hollow object we discard any solid shell thinner
+                                // than a perimeter width, since it's probably just crossing a sloping wall
+                                // and it's not wanted in a hollow print even if it would make sense when
+                                // obeying the solid shell count option strictly (DWIM!)
+                                float margin = float(neighbor_layerm->flow(frExternalPerimeter).scaled_width());
+                                Polygons too_narrow = diff(
+                                    new_internal_solid, 
+                                    offset2(new_internal_solid, -margin, +margin, jtMiter, 5), 
+                                    true);
+                                // Trim the regularized region by the original region.
+                                if (! too_narrow.empty())
+                                    new_internal_solid = solid = diff(new_internal_solid, too_narrow);
+                            }
 
-                    // make sure the new internal solid is wide enough, as it might get collapsed
-                    // when spacing is added in Fill.pm
-                    {
-                        //FIXME Vojtech: Disable this and you will be sorry.
-                        // https://github.com/prusa3d/PrusaSlicer/issues/26 bottom
-                        float margin = 3.f * layerm->flow(frSolidInfill).scaled_width(); // require at least this size
-                        // we use a higher miterLimit here to handle areas with acute angles
-                        // in those cases, the default miterLimit would cut the corner and we'd
-                        // get a triangle in $too_narrow; if we grow it below then the shell
-                        // would have a different shape from the external surface and we'd still
-                        // have the same angle, so the next shell would be grown even more and so on.
-                        Polygons too_narrow = diff(
-                            new_internal_solid,
-                            offset2(new_internal_solid, -margin, +margin, ClipperLib::jtMiter, 5),
-                            true);
-                        if (! too_narrow.empty()) {
-                            // grow the collapsing parts and add the extra area to  the neighbor layer 
-                            // as well as to our original surfaces so that we support this 
-                            // additional area in the next shell too
-                            // make sure our grown surfaces don't exceed the fill area
-                            Polygons internal;
-                            for (const Surface &surface : neighbor_layerm->fill_surfaces.surfaces)
-                                if (surface.is_internal() && !surface.is_bridge())
-                                    polygons_append(internal, to_polygons(surface.expolygon));
-                            polygons_append(new_internal_solid, 
-                                intersection(
-                                    offset(too_narrow, +margin),
-                                    // Discard bridges as they are grown for anchoring and we can't
-                                    // remove such anchors. (This may happen when a bridge is being 
-                                    // anchored onto a wall where little space remains after the bridge
-                                    // is grown, and that little space is an internal solid shell so 
-                                    // it triggers this too_narrow logic.)
-                                    internal));
-                            solid = new_internal_solid;
-                        }
-                    }
+                            // make sure the new internal solid is wide enough, as it might get collapsed
+                            // when spacing is added in Fill.pm
+                            {
+                                //FIXME Vojtech: Disable this and you will be sorry.
+                                // https://github.com/prusa3d/PrusaSlicer/issues/26 bottom
+                                float margin = 3.f * layerm->flow(frSolidInfill).scaled_width(); // require at least this size
+                                // we use a higher miterLimit here to handle areas with acute angles
+                                // in those cases, the default miterLimit would cut the corner and we'd
+                                // get a triangle in $too_narrow; if we grow it below then the shell
+                                // would have a different shape from the external surface and we'd still
+                                // have the same angle, so the next shell would be grown even more and so on.
+                                Polygons too_narrow = diff(
+                                    new_internal_solid,
+                                    offset2(new_internal_solid, -margin, +margin, ClipperLib::jtMiter, 5),
+                                    true);
+                                if (! too_narrow.empty()) {
+                                    // grow the collapsing parts and add the extra area to  the neighbor layer 
+                                    // as well as to our original surfaces so that we support this 
+                                    // additional area in the next shell too
+                                    // make sure our grown surfaces don't exceed the fill area
+                                    Polygons internal;
+                                    for (const Surface &surface : neighbor_layerm->fill_surfaces.surfaces)
+                                        if (surface.is_internal() && !surface.is_bridge())
+                                            polygons_append(internal, to_polygons(surface.expolygon));
+                                    polygons_append(new_internal_solid, 
+                                        intersection(
+                                            offset(too_narrow, +margin),
+                                            // Discard bridges as they are grown for anchoring and we can't
+                                            // remove such anchors. (This may happen when a bridge is being 
+                                            // anchored onto a wall where little space remains after the bridge
+                                            // is grown, and that little space is an internal solid shell so 
+                                            // it triggers this too_narrow logic.)
+                                            internal));
+                                    solid = new_internal_solid;
+                                }
+                            }
                     
-                    // internal-solid are the union of the existing internal-solid surfaces
-                    // and new ones
-                    SurfaceCollection backup = std::move(neighbor_layerm->fill_surfaces);
-                    polygons_append(new_internal_solid, to_polygons(backup.filter_by_type(stInternalSolid)));
-                    ExPolygons internal_solid = union_ex(new_internal_solid, false);
-                    // assign new internal-solid surfaces to layer
-                    neighbor_layerm->fill_surfaces.set(internal_solid, stInternalSolid);
-                    // subtract intersections from layer surfaces to get resulting internal surfaces
-                    Polygons polygons_internal = to_polygons(std::move(internal_solid));
-                    ExPolygons internal = diff_ex(
-                        to_polygons(backup.filter_by_type(stInternal)),
-                        polygons_internal,
-                        true);
-                    // assign resulting internal surfaces to layer
-                    neighbor_layerm->fill_surfaces.append(internal, stInternal);
-                    polygons_append(polygons_internal, to_polygons(std::move(internal)));
-                    // assign top and bottom surfaces to layer
-                    SurfaceType surface_types_solid[] = { stTop, stBottom, stBottomBridge };
-                    backup.keep_types(surface_types_solid, 3);
-                    std::vector<SurfacesPtr> top_bottom_groups;
-                    backup.group(&top_bottom_groups);
-                    for (SurfacesPtr &group : top_bottom_groups)
-                        neighbor_layerm->fill_surfaces.append(
-                            diff_ex(to_polygons(group), polygons_internal),
-                            // Use an existing surface as a template, it carries the bridge angle etc.
-                            *group.front());
-                }
-		EXTERNAL:;
-            } // foreach type (stTop, stBottom, stBottomBridge)
-        } // for each layer
-    } // for each region
+                            // internal-solid are the union of the existing internal-solid surfaces
+                            // and new ones
+                            SurfaceCollection backup = std::move(neighbor_layerm->fill_surfaces);
+                            polygons_append(new_internal_solid, backup.polygons_by_type(stInternalSolid));
+                            ExPolygons internal_solid = union_ex(new_internal_solid, false);
+                            // assign new internal-solid surfaces to layer
+                            neighbor_layerm->fill_surfaces.set(internal_solid, stInternalSolid);
+                            // subtract intersections from layer surfaces to get resulting internal surfaces
+                            Polygons polygons_internal = to_polygons(std::move(internal_solid));
+                            ExPolygons internal = diff_ex(
+                                backup.polygons_by_type(stInternal),
+                                polygons_internal,
+                                true);
+                            // assign resulting internal surfaces to layer
+                            neighbor_layerm->fill_surfaces.append(internal, stInternal);
+                            polygons_append(polygons_internal, to_polygons(std::move(internal)));
+                            // assign top and bottom surfaces to layer
+                            SurfaceType surface_types_solid[] = { stTop, stBottom, stBottomBridge };
+                            backup.keep_types(surface_types_solid, 3);
+                            std::vector<SurfacesPtr> top_bottom_groups;
+                            backup.group(&top_bottom_groups);
+                            for (SurfacesPtr &group : top_bottom_groups)
+                                neighbor_layerm->fill_surfaces.append(
+                                    diff_ex(to_polygons(group), polygons_internal),
+                                    // Use an existing surface as a template, it carries the bridge angle etc.
+                                    *group.front());
+                        }
+				EXTERNAL:;
+                    } // foreach type (stTop, stBottom, stBottomBridge)
+                } // for each layer
+            } // for each region
+        });
+    m_print->throw_if_canceled();
 
 #ifdef SLIC3R_DEBUG_SLICE_PROCESSING
     for (size_t region_id = 0; region_id < this->region_volumes.size(); ++ region_id) {
@@ -2502,72 +2778,81 @@ void PrintObject::combine_infill()
             combine[m_layers.size() - 1] = num_layers;
         }
         
-        // loop through layers to which we have assigned layers to combine
-        for (size_t layer_idx = 0; layer_idx < m_layers.size(); ++ layer_idx) {
-            m_print->throw_if_canceled();
-            size_t num_layers = combine[layer_idx];
-			if (num_layers <= 1)
-                continue;
-            // Get all the LayerRegion objects to be combined.
-            std::vector<LayerRegion*> layerms;
-            layerms.reserve(num_layers);
-			for (size_t i = layer_idx + 1 - num_layers; i <= layer_idx; ++ i)
-                layerms.emplace_back(m_layers[i]->regions()[region_id]);
-            // We need to perform a multi-layer intersection, so let's split it in pairs.
-            // Initialize the intersection with the candidates of the lowest layer.
-            ExPolygons intersection = to_expolygons(layerms.front()->fill_surfaces.filter_by_type(stInternal));
-            // Start looping from the second layer and intersect the current intersection with it.
-            for (size_t i = 1; i < layerms.size(); ++ i)
-                intersection = intersection_ex(
-                    to_polygons(intersection),
-                    to_polygons(layerms[i]->fill_surfaces.filter_by_type(stInternal)),
-                    false);
-            double area_threshold = layerms.front()->infill_area_threshold();
-            if (! intersection.empty() && area_threshold > 0.)
-                intersection.erase(std::remove_if(intersection.begin(), intersection.end(), 
-                    [area_threshold](const ExPolygon &expoly) { return expoly.area() <= area_threshold; }), 
-                    intersection.end());
-            if (intersection.empty())
-                continue;
+        // The layers to which we have assigned layers to combine, the combined layer ranges do not overlap,
+        // thus they are processed in parallel.
+        std::vector<size_t> combined_layers;
+        for (size_t layer_idx = 0; layer_idx < m_layers.size(); ++ layer_idx)
+            if (combine[layer_idx] > 1)
+                combined_layers.emplace_back(layer_idx);
+        tbb::parallel_for(
+            tbb::blocked_range<size_t>(0, combined_layers.size()),
+            [this, region_id, region, &combine, &combined_layers](const tbb::blocked_range<size_t>& range) {
+                for (size_t idx_combined = range.begin(); idx_combined < range.end(); ++ idx_combined) {
+                    m_print->throw_if_canceled();
+                    size_t layer_idx  = combined_layers[idx_combined];
+                    size_t num_layers = combine[layer_idx];
+                    // Get all the LayerRegion objects to be combined.
+                    std::vector<LayerRegion*> layerms;
+                    layerms.reserve(num_layers);
+                    for (size_t i = layer_idx + 1 - num_layers; i <= layer_idx; ++ i)
+                        layerms.emplace_back(m_layers[i]->regions()[region_id]);
+                    // We need to perform a multi-layer intersection, so let's split it in pairs.
+                    // Initialize the intersection with the candidates of the lowest layer.
+                    ExPolygons intersection = layerms.front()->fill_surfaces.expolygons_by_type(stInternal);
+                    // Start looping from the second layer and intersect the current intersection with it.
+                    for (size_t i = 1; i < layerms.size() && ! intersection.empty(); ++ i)
+                        intersection = intersection_ex(
+                            to_polygons(intersection),
+                            layerms[i]->fill_surfaces.polygons_by_type(stInternal),
+                            false);
+                    double area_threshold = layerms.front()->infill_area_threshold();
+                    if (! intersection.empty() && area_threshold > 0.)
+                        intersection.erase(std::remove_if(intersection.begin(), intersection.end(), 
+                            [area_threshold](const ExPolygon &expoly) { return expoly.area() <= area_threshold; }), 
+                            intersection.end());
+                    if (intersection.empty())
+                        continue;
 //            Slic3r::debugf "  combining %d %s regions from layers %d-%d\n",
 //                scalar(@$intersection),
 //                ($type == stInternal ? 'internal' : 'internal-solid'),
 //                $layer_idx-($every-1), $layer_idx;
-            // intersection now contains the regions that can be combined across the full amount of layers,
-            // so let's remove those areas from all layers.
-            Polygons intersection_with_clearance;
-            intersection_with_clearance.reserve(intersection.size());
-            float clearance_offset = 
-                0.5f * layerms.back()->flow(frPerimeter).scaled_width() +
-             // Because fill areas for rectilinear and honeycomb are grown 
-             // later to overlap perimeters, we need to counteract that too.
-                ((region->config().fill_pattern == ipRectilinear   ||
-                  region->config().fill_pattern == ipGrid          ||
-                  region->config().fill_pattern == ipLine          ||
-                  region->config().fill_pattern == ipHoneycomb) ? 1.5f : 0.5f) * 
-                    layerms.back()->flow(frSolidInfill).scaled_width();
-            for (ExPolygon &expoly : intersection)
-                polygons_append(intersection_with_clearance, offset(expoly, clearance_offset));
-            for (LayerRegion *layerm : layerms) {
-                Polygons internal = to_polygons(layerm->fill_surfaces.filter_by_type(stInternal));
-                layerm->fill_surfaces.remove_type(stInternal);
-                layerm->fill_surfaces.append(diff_ex(internal, intersection_with_clearance, false), stInternal);
-                if (layerm == layerms.back()) {
-                    // Apply surfaces back with adjusted depth to the uppermost layer.
-                    Surface templ(stInternal, ExPolygon());
-                    templ.thickness = 0.;
-                    for (LayerRegion *layerm2 : layerms)
-                        templ.thickness += layerm2->layer()->height;
-                    templ.thickness_layers = (unsigned short)layerms.size();
-                    layerm->fill_surfaces.append(intersection, templ);
-                } else {
-                    // Save void surfaces.
-                    layerm->fill_surfaces.append(
-                        intersection_ex(internal, intersection_with_clearance, false),
-                        stInternalVoid);
+                    // intersection now contains the regions that can be combined across the full amount of layers,
+                    // so let's remove those areas from all layers.
+                    Polygons intersection_with_clearance;
+                    intersection_with_clearance.reserve(intersection.size());
+                    float clearance_offset = 
+                        0.5f * layerms.back()->flow(frPerimeter).scaled_width() +
+                     // Because fill areas for rectilinear and honeycomb are grown 
+                     // later to overlap perimeters, we need to counteract that too.
+                        ((region->config().fill_pattern == ipRectilinear   ||
+                          region->config().fill_pattern == ipGrid          ||
+                          region->config().fill_pattern == ipLine          ||
+                          region->config().fill_pattern == ipHoneycomb) ? 1.5f : 0.5f) * 
+                            layerms.back()->flow(frSolidInfill).scaled_width();
+                    for (ExPolygon &expoly : intersection)
+                        polygons_append(intersection_with_clearance, offset(expoly, clearance_offset));
+                    for (LayerRegion *layerm : layerms) {
+                        Polygons internal = layerm->fill_surfaces.polygons_by_type(stInternal);
+                        layerm->fill_surfaces.remove_type(stInternal);
+                        layerm->fill_surfaces.append(diff_ex(internal, intersection_with_clearance, false), stInternal);
+                        if (layerm == layerms.back()) {
+                            // Apply surfaces back with adjusted depth to the uppermost layer.
+                            Surface templ(stInternal, ExPolygon());
+                            templ.thickness = 0.;
+                            for (LayerRegion *layerm2 : layerms)
+                                templ.thickness += layerm2->layer()->height;
+                            templ.thickness_layers = (unsigned short)layerms.size();
+                            layerm->fill_surfaces.append(intersection, templ);
+                        } else {
+                            // Save void surfaces.
+                            layerm->fill_surfaces.append(
+                                intersection_ex(internal, intersection_with_clearance, false),
+                                stInternalVoid);
+                        }
+                    }
                 }
-            }
-        }
+            });
+        m_print->throw_if_canceled();
     }
 }
 
@@ -7,11 +7,11 @@ unsigned int PrintRegion::extruder(FlowRole role) const
 {
     size_t extruder = 0;
     if (role == frPerimeter || role == frExternalPerimeter)
-        extruder = m_config.perimeter_extruder;
+        extruder = m_config->perimeter_extruder;
     else if (role == frInfill)
-        extruder = m_config.infill_extruder;
+        extruder = m_config->infill_extruder;
     else if (role == frSolidInfill || role == frTopSolidInfill)
-        extruder = m_config.solid_infill_extruder;
+        extruder = m_config->solid_infill_extruder;
     else
         throw std::invalid_argument("Unknown role");
     return extruder;
@@ -30,15 +30,15 @@ Flow PrintRegion::flow(FlowRole role, double layer_height, bool bridge, bool fir
         if (first_layer && m_print->config().first_layer_extrusion_width.value > 0) {
             config_width = m_print->config().first_layer_extrusion_width;
         } else if (role == frExternalPerimeter) {
-            config_width = m_config.external_perimeter_extrusion_width;
+            config_width = m_config->external_perimeter_extrusion_width;
         } else if (role == frPerimeter) {
-            config_width = m_config.perimeter_extrusion_width;
+            config_width = m_config->perimeter_extrusion_width;
         } else if (role == frInfill) {
-            config_width = m_config.infill_extrusion_width;
+            config_width = m_config->infill_extrusion_width;
         } else if (role == frSolidInfill) {
-            config_width = m_config.solid_infill_extrusion_width;
+            config_width = m_config->solid_infill_extrusion_width;
         } else if (role == frTopSolidInfill) {
-            config_width = m_config.top_infill_extrusion_width;
+            config_width = m_config->top_infill_extrusion_width;
         } else {
             throw std::invalid_argument("Unknown role");
         }
@@ -50,19 +50,19 @@ Flow PrintRegion::flow(FlowRole role, double layer_height, bool bridge, bool fir
     // Get the configured nozzle_diameter for the extruder associated to the flow role requested.
     // Here this->extruder(role) - 1 may underflow to MAX_INT, but then the get_at() will follback to zero'th element, so everything is all right.
     double nozzle_diameter = m_print->config().nozzle_diameter.get_at(this->extruder(role) - 1);
-    return Flow::new_from_config_width(role, config_width, (float)nozzle_diameter, (float)layer_height, bridge ? (float)m_config.bridge_flow_ratio : 0.0f);
+    return Flow::new_from_config_width(role, config_width, (float)nozzle_diameter, (float)layer_height, bridge ? (float)m_config->bridge_flow_ratio : 0.0f);
 }
 
 coordf_t PrintRegion::nozzle_dmr_avg(const PrintConfig &print_config) const
 {
-    return (print_config.nozzle_diameter.get_at(m_config.perimeter_extruder.value    - 1) + 
-            print_config.nozzle_diameter.get_at(m_config.infill_extruder.value       - 1) + 
-            print_config.nozzle_diameter.get_at(m_config.solid_infill_extruder.value - 1)) / 3.;
+    return (print_config.nozzle_diameter.get_at(m_config->perimeter_extruder.value    - 1) + 
+            print_config.nozzle_diameter.get_at(m_config->infill_extruder.value       - 1) + 
+            print_config.nozzle_diameter.get_at(m_config->solid_infill_extruder.value - 1)) / 3.;
 }
 
 coordf_t PrintRegion::bridging_height_avg(const PrintConfig &print_config) const
 {
-    return this->nozzle_dmr_avg(print_config) * sqrt(m_config.bridge_flow_ratio.value);
+    return this->nozzle_dmr_avg(print_config) * sqrt(m_config->bridge_flow_ratio.value);
 }
 
 void PrintRegion::collect_object_printing_extruders(const PrintConfig &print_config, const PrintRegionConfig &region_config, std::vector<unsigned int> &object_extruders)
@@ -0,0 +1,347 @@
+#include "QuadricEdgeCollapse.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace Slic3r {
+
+namespace {
+
+// Symmetric 4x4 matrix of the quadric error, the upper triangle stored row by row.
+struct Quadric
+{
+    std::array<double, 10> m;
+
+    Quadric() { m.fill(0.); }
+    // Quadric of the plane a*x + b*y + c*z + d = 0.
+    Quadric(double a, double b, double c, double d) :
+        m({ a * a, a * b, a * c, a * d, b * b, b * c, b * d, c * c, c * d, d * d }) {}
+
+    Quadric& operator+=(const Quadric &rhs) { for (size_t i = 0; i < 10; ++ i) m[i] += rhs.m[i]; return *this; }
+    Quadric  operator+ (const Quadric &rhs) const { Quadric q(*this); q += rhs; return q; }
+
+    double det(int a11, int a12, int a13, int a21, int a22, int a23, int a31, int a32, int a33) const
+    {
+        return m[a11] * m[a22] * m[a33] + m[a13] * m[a21] * m[a32] + m[a12] * m[a23] * m[a31]
+             - m[a13] * m[a22] * m[a31] - m[a11] * m[a23] * m[a32] - m[a12] * m[a21] * m[a33];
+    }
+
+    double error(const Vec3d &p) const
+    {
+        const double x = p.x(), y = p.y(), z = p.z();
+        return m[0] * x * x + 2. * m[1] * x * y + 2. * m[2] * x * z + 2. * m[3] * x
+             + m[4] * y * y + 2. * m[5] * y * z + 2. * m[6] * y
+             + m[7] * z * z + 2. * m[8] * z + m[9];
+    }
+};
+
+struct Triangle
+{
+    int    v[3];
+    // Errors of collapsing the edges v[i], v[(i + 1) % 3], the last one is the minimum.
+    double err[4];
+    bool   deleted = false;
+    bool   dirty   = false;
+    Vec3d  n;
+};
+
+struct Vertex
+{
+    Vec3d   p;
+    // Range of the references to the triangles sharing this vertex.
+    int     tstart = 0;
+    int     tcount = 0;
+    Quadric q;
+    bool    border = false;
+};
+
+struct Ref
+{
+    int tid;
+    int tvertex;
+};
+
+class Decimator
+{
+public:
+    Decimator(const indexed_triangle_set &its, std::function<void()> throw_on_cancel) : m_throw_on_cancel(std::move(throw_on_cancel))
+    {
+        m_vertices.resize(its.vertices.size());
+        for (size_t i = 0; i < its.vertices.size(); ++ i)
+            m_vertices[i].p = its.vertices[i].cast<double>();
+        m_triangles.resize(its.indices.size());
+        for (size_t i = 0; i < its.indices.size(); ++ i)
+            for (int j = 0; j < 3; ++ j)
+                m_triangles[i].v[j] = its.indices[i](j);
+    }
+
+    void decimate(size_t target_count)
+    {
+        // Aggressiveness of the growth of the error threshold with the iterations.
+        static const double aggressiveness  = 7.;
+        static const int    max_iterations  = 100;
+        static const size_t cancel_interval = 65536;
+
+        size_t deleted_triangles = 0;
+        std::vector<bool> deleted0, deleted1;
+        const size_t triangle_count = m_triangles.size();
+
+        for (int iteration = 0; iteration < max_iterations; ++ iteration) {
+            if (triangle_count - deleted_triangles <= target_count)
+                break;
+
+            // Compact the triangles and rebuild the references once in a while.
+            if (iteration % 5 == 0)
+                this->update_mesh(iteration);
+
+            for (Triangle &t : m_triangles)
+                t.dirty = false;
+
+            // All the edges below the threshold are collapsed. The threshold grows with the iterations,
+            // so that the edges with the lowest errors go first without having to keep them sorted.
+            const double threshold = 1e-9 * std::pow(double(iteration + 3), aggressiveness);
+
+            for (size_t tid = 0; tid < m_triangles.size(); ++ tid) {
+                if (m_throw_on_cancel && tid % cancel_interval == 0)
+                    m_throw_on_cancel();
+
+                Triangle &t = m_triangles[tid];
+                if (t.err[3] > threshold || t.deleted || t.dirty)
+                    continue;
+
+                for (int j = 0; j < 3; ++ j) {
+                    if (t.err[j] >= threshold)
+                        continue;
+
+                    const int i0 = t.v[j];
+                    const int i1 = t.v[(j + 1) % 3];
+                    Vertex &v0 = m_vertices[i0];
+                    Vertex &v1 = m_vertices[i1];
+                    if (v0.border != v1.border)
+                        continue;
+
+                    Vec3d p;
+                    this->edge_error(i0, i1, p);
+
+                    deleted0.assign(v0.tcount, false);
+                    deleted1.assign(v1.tcount, false);
+                    if (this->flipped(p, i1, v0, deleted0) || this->flipped(p, i0, v1, deleted1))
+                        continue;
+
+                    // Collapse v1 into v0.
+                    v0.p  = p;
+                    v0.q += v1.q;
+                    const int tstart = int(m_refs.size());
+                    this->update_triangles(i0, v0, deleted0, deleted_triangles);
+                    this->update_triangles(i0, v1, deleted1, deleted_triangles);
+                    const int tcount = int(m_refs.size()) - tstart;
+                    if (tcount <= v0.tcount) {
+                        // Reuse the old range of the references.
+                        std::copy(m_refs.begin() + tstart, m_refs.end(), m_refs.begin() + v0.tstart);
+                    } else
+                        v0.tstart = tstart;
+                    v0.tcount = tcount;
+                    break;
+                }
+
+                if (triangle_count - deleted_triangles <= target_count)
+                    break;
+            }
+        }
+
+        this->compact_mesh();
+    }
+
+    void export_its(indexed_triangle_set &its) const
+    {
+        its.vertices.resize(m_vertices.size());
+        for (size_t i = 0; i < m_vertices.size(); ++ i)
+            its.vertices[i] = m_vertices[i].p.cast<float>();
+        its.indices.resize(m_triangles.size());
+        for (size_t i = 0; i < m_triangles.size(); ++ i)
+            its.indices[i] = stl_triangle_vertex_indices(m_triangles[i].v[0], m_triangles[i].v[1], m_triangles[i].v[2]);
+    }
+
+private:
+    std::vector<Vertex>     m_vertices;
+    std::vector<Triangle>   m_triangles;
+    std::vector<Ref>        m_refs;
+    std::function<void()>   m_throw_on_cancel;
+
+    // Error of collapsing the edge into its optimal point, returned in p.
+    double edge_error(int id_v1, int id_v2, Vec3d &p) const
+    {
+        const Vertex &v1 = m_vertices[id_v1];
+        const Vertex &v2 = m_vertices[id_v2];
+        const Quadric q = v1.q + v2.q;
+        const double det = q.det(0, 1, 2, 1, 4, 5, 2, 5, 7);
+        if (det != 0. && ! (v1.border && v2.border)) {
+            // The quadric is invertible, solve for its minimum.
+            p = Vec3d(- 1. / det * q.det(1, 2, 3, 4, 5, 6, 5, 7, 8),
+                        1. / det * q.det(0, 2, 3, 1, 5, 6, 2, 7, 8),
+                      - 1. / det * q.det(0, 1, 3, 1, 4, 6, 2, 5, 8));
+            return q.error(p);
+        }
+
+        // Otherwise pick the best of the end points and the middle of the edge.
+        const Vec3d  p3 = 0.5 * (v1.p + v2.p);
+        const double e1 = q.error(v1.p);
+        const double e2 = q.error(v2.p);
+        const double e3 = q.error(p3);
+        const double e  = std::min(e1, std::min(e2, e3));
+        p = (e == e1) ? v1.p : (e == e2) ? v2.p : p3;
+        return e;
+    }
+
+    void triangle_errors(Triangle &t)
+    {
+        Vec3d p;
+        for (int j = 0; j < 3; ++ j)
+            t.err[j] = this->edge_error(t.v[j], t.v[(j + 1) % 3], p);
+        t.err[3] = std::min(t.err[0], std::min(t.err[1], t.err[2]));
+    }
+
+    // Would moving the vertex v to p flip any of its triangles, which do not contain i_other?
+    // The triangles containing i_other will be removed by the collapse, they are marked in deleted.
+    bool flipped(const Vec3d &p, int i_other, const Vertex &v, std::vector<bool> &deleted) const
+    {
+        for (int k = 0; k < v.tcount; ++ k) {
+            const Ref      &r = m_refs[v.tstart + k];
+            const Triangle &t = m_triangles[r.tid];
+            if (t.deleted)
+                continue;
+
+            const int id1 = t.v[(r.tvertex + 1) % 3];
+            const int id2 = t.v[(r.tvertex + 2) % 3];
+            if (id1 == i_other || id2 == i_other) {
+                deleted[k] = true;
+                continue;
+            }
+
+            const Vec3d d1 = (m_vertices[id1].p - p).normalized();
+            const Vec3d d2 = (m_vertices[id2].p - p).normalized();
+            if (std::abs(d1.dot(d2)) > 0.999)
+                return true;
+            if (d1.cross(d2).normalized().dot(t.n) < 0.2)
+                return true;
+        }
+        return false;
+    }
+
+    // Redirect the triangles of v to i0, remove the degenerate ones.
+    void update_triangles(int i0, const Vertex &v, const std::vector<bool> &deleted, size_t &deleted_triangles)
+    {
+        for (int k = 0; k < v.tcount; ++ k) {
+            const Ref r = m_refs[v.tstart + k];
+            Triangle &t = m_triangles[r.tid];
+            if (t.deleted)
+                continue;
+            if (deleted[k]) {
+                t.deleted = true;
+                ++ deleted_triangles;
+                continue;
+            }
+            t.v[r.tvertex] = i0;
+            t.dirty = true;
+            this->triangle_errors(t);
+            m_refs.emplace_back(r);
+        }
+    }
+
+    void update_mesh(int iteration)
+    {
+        if (iteration > 0)
+            m_triangles.erase(std::remove_if(m_triangles.begin(), m_triangles.end(), [](const Triangle &t) { return t.deleted; }), m_triangles.end());
+
+        if (iteration == 0) {
+            // Initialize the quadrics by the planes of the triangles.
+            for (Triangle &t : m_triangles) {
+                const Vec3d &p0 = m_vertices[t.v[0]].p;
+                t.n = (m_vertices[t.v[1]].p - p0).cross(m_vertices[t.v[2]].p - p0).normalized();
+                const Quadric q(t.n.x(), t.n.y(), t.n.z(), - t.n.dot(p0));
+                for (int j = 0; j < 3; ++ j)
+                    m_vertices[t.v[j]].q += q;
+            }
+            for (Triangle &t : m_triangles)
+                this->triangle_errors(t);
+        }
+
+        // Rebuild the references of the vertices to their triangles.
+        for (Vertex &v : m_vertices)
+            v.tcount = 0;
+        for (const Triangle &t : m_triangles)
+            for (int j = 0; j < 3; ++ j)
+                ++ m_vertices[t.v[j]].tcount;
+        int tstart = 0;
+        for (Vertex &v : m_vertices) {
+            v.tstart = tstart;
+            tstart  += v.tcount;
+            v.tcount = 0;
+        }
+        m_refs.resize(m_triangles.size() * 3);
+        for (size_t i = 0; i < m_triangles.size(); ++ i)
+            for (int j = 0; j < 3; ++ j) {
+                Vertex &v = m_vertices[m_triangles[i].v[j]];
+                m_refs[v.tstart + v.tcount ++] = Ref{ int(i), j };
+            }
+
+        if (iteration == 0) {
+            // A vertex is on a border if it shares an edge with a single triangle only.
+            std::vector<int> vcount, vids;
+            for (Vertex &v : m_vertices) {
+                vcount.clear();
+                vids.clear();
+                for (int k = 0; k < v.tcount; ++ k) {
+                    const Triangle &t = m_triangles[m_refs[v.tstart + k].tid];
+                    for (int j = 0; j < 3; ++ j) {
+                        auto it = std::find(vids.begin(), vids.end(), t.v[j]);
+                        if (it == vids.end()) {
+                            vids.emplace_back(t.v[j]);
+                            vcount.emplace_back(1);
+                        } else
+                            ++ vcount[it - vids.begin()];
+                    }
+                }
+                for (size_t j = 0; j < vcount.size(); ++ j)
+                    if (vcount[j] == 1)
+                        m_vertices[vids[j]].border = true;
+            }
+        }
+    }
+
+    // Remove the deleted triangles and the unreferenced vertices.
+    void compact_mesh()
+    {
+        m_triangles.erase(std::remove_if(m_triangles.begin(), m_triangles.end(), [](const Triangle &t) { return t.deleted; }), m_triangles.end());
+        for (Vertex &v : m_vertices)
+            v.tcount = 0;
+        for (const Triangle &t : m_triangles)
+            for (int j = 0; j < 3; ++ j)
+                m_vertices[t.v[j]].tcount = 1;
+        int dst = 0;
+        for (Vertex &v : m_vertices)
+            if (v.tcount) {
+                v.tstart = dst;
+                m_vertices[dst ++].p = v.p;
+            }
+        for (Triangle &t : m_triangles)
+            for (int j = 0; j < 3; ++ j)
+                t.v[j] = m_vertices[t.v[j]].tstart;
+        m_vertices.resize(dst);
+    }
+};
+
+} // namespace
+
+void its_quadric_edge_collapse(indexed_triangle_set &its, size_t triangle_count, std::function<void()> throw_on_cancel)
+{
+    if (its.indices.size() <= triangle_count)
+        return;
+
+    Decimator decimator(its, std::move(throw_on_cancel));
+    decimator.decimate(triangle_count);
+    decimator.export_its(its);
+}
+
+} // namespace Slic3r
@@ -0,0 +1,19 @@
+#ifndef slic3r_QuadricEdgeCollapse_hpp_
+#define slic3r_QuadricEdgeCollapse_hpp_
+
+#include <functional>
+
+#include "TriangleMesh.hpp"
+
+namespace Slic3r {
+
+// Decimate the triangle set by collapsing its edges in the order of the quadric error metric
+// (Garland & Heckbert), until the number of triangles drops to triangle_count.
+// The vertices of open borders only collapse with other border vertices. The collapses flipping
+// a triangle are rejected, therefore the count may stay above triangle_count.
+// The cancel function is called regularly and may throw to stop the decimation.
+void its_quadric_edge_collapse(indexed_triangle_set &its, size_t triangle_count, std::function<void()> throw_on_cancel = nullptr);
+
+} // namespace Slic3r
+
+#endif /* slic3r_QuadricEdgeCollapse_hpp_ */
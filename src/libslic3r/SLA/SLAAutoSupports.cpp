@@ -18,6 +18,8 @@
 namespace Slic3r {
 namespace sla {
 
+std::vector<Vec2f> sample_expolygon_with_boundary(const ExPolygons &expolys, float samples_per_mm2, float samples_per_mm_boundary, std::mt19937 &rng);
+
 /*float SLAAutoSupports::approximate_geodesic_distance(const Vec3d& p1, const Vec3d& p2, Vec3d& n1, Vec3d& n2)
 {
     n1.normalize();
@@ -239,23 +241,52 @@ void SLAAutoSupports::process(const std::vector<ExPolygons>& slices, const std::
             }
         }
         // Now iterate over all polygons and append new points if needed.
-        for (Structure &s : layer_top->islands) {
+        // Pick the areas to cover first. Sampling them does not depend on the other islands, only placing
+        // the points does through point_grid, thus the raw samples of all islands are drawn in parallel.
+        struct Cover {
+            ExPolygons          new_island;
+            const ExPolygons   *areas         = nullptr;
+            bool                is_new_island = false;
+            std::mt19937        rng;
+            std::vector<Vec2f>  raw_samples;
+        };
+        std::vector<Cover> covers(layer_top->islands.size());
+        std::random_device rd;
+        for (size_t i = 0; i < layer_top->islands.size(); ++ i) {
+            Structure &s = layer_top->islands[i];
+            Cover     &c = covers[i];
             // Penalization resulting from large diff from the last layer:
 //            s.supports_force_inherited /= std::max(1.f, (layer_height / 0.3f) * e_area / s.area);
             s.supports_force_inherited /= std::max(1.f, 0.17f * (s.overhangs_area) / s.area);
 
             //float force_deficit = s.support_force_deficit(m_config.tear_pressure());
             if (s.islands_below.empty()) { // completely new island - needs support no doubt
-                uniformly_cover({ *s.polygon }, s, point_grid, true);
+                c.new_island    = { *s.polygon };
+                c.areas         = &c.new_island;
+                c.is_new_island = true;
             } else if (! s.dangling_areas.empty()) {
                 // Let's see if there's anything that overlaps enough to need supports:
                 // What we now have in polygons needs support, regardless of what the forces are, so we can add them.
                 //FIXME is it an island point or not? Vojtech thinks it is.
-                uniformly_cover(s.dangling_areas, s, point_grid);
+                c.areas = &s.dangling_areas;
             } else if (! s.overhangs_slopes.empty()) {
                 //FIXME add the support force deficit as a parameter, only cover until the defficiency is covered.
-                uniformly_cover(s.overhangs_slopes, s, point_grid);
+                c.areas = &s.overhangs_slopes;
             }
+            if (c.areas != nullptr)
+                c.rng.seed(rd());
+        }
+        const float poisson_radius = initial_poisson_radius();
+        const float samples_per_mm2 = 30.f / (float(M_PI) * poisson_radius * poisson_radius);
+        tbb::parallel_for(size_t(0), covers.size(), [this, layer_top, &covers, poisson_radius, samples_per_mm2](size_t i) {
+            Cover &c = covers[i];
+            if (c.areas != nullptr && layer_top->islands[i].support_force_deficit(m_config.tear_pressure()) >= 0)
+                c.raw_samples = sample_expolygon_with_boundary(*c.areas, samples_per_mm2, 5.f / poisson_radius, c.rng);
+        });
+        for (size_t i = 0; i < covers.size(); ++ i) {
+            Cover &c = covers[i];
+            if (c.areas != nullptr)
+                uniformly_cover(*c.areas, layer_top->islands[i], point_grid, c.raw_samples, c.rng, c.is_new_island);
         }
 
         m_throw_on_cancel();
@@ -449,7 +480,15 @@ static inline std::vector<Vec2f> poisson_disk_from_samples(const std::vector<Vec
     return out;
 }
 
-void SLAAutoSupports::uniformly_cover(const ExPolygons& islands, Structure& structure, PointGrid3D &grid3d, bool is_new_island, bool just_one)
+float SLAAutoSupports::initial_poisson_radius() const
+{
+    const float density_horizontal = m_config.tear_pressure() / m_config.support_force();
+    //FIXME why?
+    return std::max(m_config.minimal_distance, 1.f / (5.f * density_horizontal));
+//    return 1.f / (15.f * density_horizontal);
+}
+
+void SLAAutoSupports::uniformly_cover(const ExPolygons& islands, Structure& structure, PointGrid3D &grid3d, const std::vector<Vec2f> &raw_samples, std::mt19937 &rng, bool is_new_island, bool just_one)
 {
     //int num_of_points = std::max(1, (int)((island.area()*pow(SCALING_FACTOR, 2) * m_config.tear_pressure)/m_config.support_force));
 
@@ -460,19 +499,11 @@ void SLAAutoSupports::uniformly_cover(const ExPolygons& islands, Structure& stru
     // Number of newly added points.
     const size_t poisson_samples_target = size_t(ceil(support_force_deficit / m_config.support_force()));
 
-    const float density_horizontal = m_config.tear_pressure() / m_config.support_force();
-    //FIXME why?
-    float poisson_radius		= std::max(m_config.minimal_distance, 1.f / (5.f * density_horizontal));
-//    const float poisson_radius     = 1.f / (15.f * density_horizontal);
-    const float samples_per_mm2 = 30.f / (float(M_PI) * poisson_radius * poisson_radius);
+    float poisson_radius		= initial_poisson_radius();
     // Minimum distance between samples, in 3D space.
 //    float min_spacing			= poisson_radius / 3.f;
     float min_spacing			= poisson_radius;
 
-    //FIXME share the random generator. The random generator may be not so cheap to initialize, also we don't want the random generator to be restarted for each polygon.
-    std::random_device  rd;
-    std::mt19937        rng(rd());
-    std::vector<Vec2f>  raw_samples = sample_expolygon_with_boundary(islands, samples_per_mm2, 5.f / poisson_radius, rng);
     std::vector<Vec2f>  poisson_samples;
     for (size_t iter = 0; iter < 4; ++ iter) {
         poisson_samples = poisson_disk_from_samples(raw_samples, poisson_radius,
@@ -8,6 +8,8 @@
 
 #include <boost/container/small_vector.hpp>
 
+#include <random>
+
 // #define SLA_AUTOSUPPORTS_DEBUG
 
 namespace Slic3r {
@@ -188,7 +190,9 @@ private:
     SLAAutoSupports::Config m_config;
 
     void process(const std::vector<ExPolygons>& slices, const std::vector<float>& heights);
-    void uniformly_cover(const ExPolygons& islands, Structure& structure, PointGrid3D &grid3d, bool is_new_island = false, bool just_one = false);
+    float initial_poisson_radius() const;
+    // raw_samples are random points of islands sampled with the initial poisson radius using rng.
+    void uniformly_cover(const ExPolygons& islands, Structure& structure, PointGrid3D &grid3d, const std::vector<Vec2f> &raw_samples, std::mt19937 &rng, bool is_new_island = false, bool just_one = false);
     void project_onto_mesh(std::vector<sla::SupportPoint>& points) const;
 
 #ifdef SLA_AUTOSUPPORTS_DEBUG
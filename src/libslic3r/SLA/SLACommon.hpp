@@ -144,6 +144,13 @@ public:
     // Casting a ray on the mesh, returns the distance where the hit occures.
     hit_result query_ray_hit(const Vec3d &s, const Vec3d &dir) const;
 
+    // Casting a bundle of rays on the mesh. The results are the same as of
+    // query_ray_hit() for each ray, but the rays share a single traversal of
+    // the AABB tree, which is faster for coherent rays like the samples
+    // around a support head or a bridge.
+    std::vector<hit_result> query_ray_hits(const std::vector<Vec3d> &sources,
+                                           const std::vector<Vec3d> &dirs) const;
+
     class si_result {
         double m_value;
         int m_fidx;
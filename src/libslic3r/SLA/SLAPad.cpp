@@ -1,6 +1,7 @@
 #include "SLAPad.hpp"
 #include "SLABoilerPlate.hpp"
 #include "SLASpatIndex.hpp"
+#include "SLAConcurrency.hpp"
 #include "ConcaveHull.hpp"
 
 #include "boost/log/trivial.hpp"
@@ -541,56 +542,95 @@ bool add_cavity(Contour3D &pad, ExPolygon &top_poly, const PadConfig3D &cfg,
     return true;
 }
 
-Contour3D create_outer_pad_geometry(const ExPolygons & skeleton,
-                                    const PadConfig3D &cfg,
-                                    ThrowOnCancel      thr)
+Contour3D create_outer_pad_part(const ExPolygon &  pad_part,
+                                const PadConfig3D &cfg,
+                                ThrowOnCancel      thr)
 {
     Contour3D ret;
 
-    for (const ExPolygon &pad_part : skeleton) {
-        ExPolygon top_poly{pad_part};
-        ExPolygon bottom_poly =
-            offset_contour_only(pad_part, -scaled(cfg.bottom_offset()));
+    ExPolygon top_poly{pad_part};
+    ExPolygon bottom_poly =
+        offset_contour_only(pad_part, -scaled(cfg.bottom_offset()));
 
-        if (bottom_poly.empty()) continue;
+    if (bottom_poly.empty()) return ret;
 
-        double z_min = -cfg.height, z_max = 0;
-        ret.merge(walls(top_poly.contour, bottom_poly.contour, z_max, z_min,
-                        cfg.bottom_offset(), thr));
+    double z_min = -cfg.height, z_max = 0;
+    ret.merge(walls(top_poly.contour, bottom_poly.contour, z_max, z_min,
+                    cfg.bottom_offset(), thr));
 
-        if (cfg.wing_height > 0. && add_cavity(ret, top_poly, cfg, thr))
-            z_max = -cfg.wing_height;
+    if (cfg.wing_height > 0. && add_cavity(ret, top_poly, cfg, thr))
+        z_max = -cfg.wing_height;
 
-        for (auto &h : bottom_poly.holes)
-            ret.merge(straight_walls(h, z_max, z_min, thr));
+    for (auto &h : bottom_poly.holes)
+        ret.merge(straight_walls(h, z_max, z_min, thr));
 
-        ret.merge(triangulate_expolygon_3d(bottom_poly, z_min, NORMALS_DOWN));
-        ret.merge(triangulate_expolygon_3d(top_poly, NORMALS_UP));
-    }
+    ret.merge(triangulate_expolygon_3d(bottom_poly, z_min, NORMALS_DOWN));
+    ret.merge(triangulate_expolygon_3d(top_poly, NORMALS_UP));
 
     return ret;
 }
 
-Contour3D create_inner_pad_geometry(const ExPolygons & skeleton,
-                                    const PadConfig3D &cfg,
-                                    ThrowOnCancel      thr)
+Contour3D create_inner_pad_part(const ExPolygon &  pad_part,
+                                const PadConfig3D &cfg,
+                                ThrowOnCancel      thr)
 {
     Contour3D ret;
 
     double z_max = 0., z_min = -cfg.height;
-    for (const ExPolygon &pad_part : skeleton) {
-        ret.merge(straight_walls(pad_part.contour, z_max, z_min,thr));
+    ret.merge(straight_walls(pad_part.contour, z_max, z_min,thr));
 
-        for (auto &h : pad_part.holes)
-            ret.merge(straight_walls(h, z_max, z_min, thr));
+    for (auto &h : pad_part.holes)
+        ret.merge(straight_walls(h, z_max, z_min, thr));
 
-        ret.merge(triangulate_expolygon_3d(pad_part, z_min, NORMALS_DOWN));
-        ret.merge(triangulate_expolygon_3d(pad_part, z_max, NORMALS_UP));
+    ret.merge(triangulate_expolygon_3d(pad_part, z_min, NORMALS_DOWN));
+    ret.merge(triangulate_expolygon_3d(pad_part, z_max, NORMALS_UP));
+
+    return ret;
+}
+
+// The parts of the skeleton are independent of each other, their geometry is
+// generated in parallel and merged in the order of the skeleton.
+template<class Fn>
+Contour3D create_pad_parts(const ExPolygons & skeleton,
+                           const PadConfig3D &cfg,
+                           ThrowOnCancel      thr,
+                           Fn &&              create_part)
+{
+    std::vector<Contour3D> parts(skeleton.size());
+    ccr::enumerate(skeleton.begin(), skeleton.end(),
+                   [&parts, &cfg, &thr, &create_part](const ExPolygon &pad_part,
+                                                      size_t           idx) {
+                       parts[idx] = create_part(pad_part, cfg, thr);
+                   });
+
+    size_t npoints = 0, nindices = 0;
+    for (const Contour3D &part : parts) {
+        npoints  += part.points.size();
+        nindices += part.indices.size();
     }
 
+    Contour3D ret;
+    ret.points.reserve(npoints);
+    ret.indices.reserve(nindices);
+    for (const Contour3D &part : parts) ret.merge(part);
+
     return ret;
 }
 
+Contour3D create_outer_pad_geometry(const ExPolygons & skeleton,
+                                    const PadConfig3D &cfg,
+                                    ThrowOnCancel      thr)
+{
+    return create_pad_parts(skeleton, cfg, thr, create_outer_pad_part);
+}
+
+Contour3D create_inner_pad_geometry(const ExPolygons & skeleton,
+                                    const PadConfig3D &cfg,
+                                    ThrowOnCancel      thr)
+{
+    return create_pad_parts(skeleton, cfg, thr, create_inner_pad_part);
+}
+
 Contour3D create_pad_geometry(const PadSkeleton &skelet,
                               const PadConfig &  cfg,
                               ThrowOnCancel      thr)
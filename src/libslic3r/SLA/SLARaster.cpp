@@ -2,6 +2,9 @@
 #define SLARASTER_CPP
 
 #include <functional>
+#include <cstring>
+
+#include <tbb/parallel_for.h>
 
 #include "SLARaster.hpp"
 #include "libslic3r/ExPolygon.hpp"
@@ -18,7 +21,6 @@
 
 #include <agg/agg_scanline_p.h>
 #include <agg/agg_rasterizer_scanline_aa.h>
-#include <agg/agg_path_storage.h>
 
 // Experimental minz image write:
 #include <miniz.h>
@@ -31,6 +33,9 @@ inline const ClipperLib::Path& contour(const ClipperLib::Polygon& p) { return p.
 inline const Polygons& holes(const ExPolygon& p) { return p.holes; }
 inline const ClipperLib::Paths& holes(const ClipperLib::Polygon& p) { return p.Holes; }
 
+inline const Points& points(const Polygon& p) { return p.points; }
+inline const ClipperLib::Path& points(const ClipperLib::Path& p) { return p; }
+
 namespace sla {
 
 const Raster::TMirroring Raster::NoMirror = {false, false};
@@ -66,13 +71,29 @@ private:
     
     std::function<double(double)> m_gammafn;
     Trafo m_trafo;
-    
-    inline void flipy(agg::path_storage& path) const {
-        path.flip_y(0, double(m_resolution.height_px));
-    }
-    
-    inline void flipx(agg::path_storage& path) const {
-        path.flip_x(0, double(m_resolution.width_px));
+
+    // The rasterizer and the scanline container are reused by all the draw()
+    // calls to keep their allocated memory.
+    agg::rasterizer_scanline_aa<> m_ras;
+    agg::scanline_p8 m_scanlines;
+
+    // Rows of the buffer drawn into since the last clear(), so that clear()
+    // of a reused raster does not need to touch the whole buffer.
+    size_t m_dirty_begin = 0, m_dirty_end = 0;
+
+    inline void mark_dirty(double y1, double y2)
+    {
+        auto h = double(m_resolution.height_px);
+        y1 = std::max(0., std::floor(y1));
+        y2 = std::min(h, std::floor(y2) + 1.);
+        if (y1 >= y2) return;
+        if (m_dirty_begin >= m_dirty_end) {
+            m_dirty_begin = size_t(y1);
+            m_dirty_end   = size_t(y2);
+        } else {
+            m_dirty_begin = std::min(m_dirty_begin, size_t(y1));
+            m_dirty_end   = std::max(m_dirty_end, size_t(y2));
+        }
     }
 
 public:
@@ -95,24 +116,90 @@ public:
         
         if (trafo.gamma > 0) m_gammafn = agg::gamma_power(trafo.gamma);
         else m_gammafn = agg::gamma_threshold(0.5);
+
+        m_ras.gamma(m_gammafn);
         
+        m_dirty_end = m_resolution.height_px;
         clear();
     }
 
     template<class P> void draw(const P &poly) {
-        agg::rasterizer_scanline_aa<> ras;
-        agg::scanline_p8 scanlines;
+        m_ras.reset();
         
-        ras.gamma(m_gammafn);
+        add_contour(m_ras, contour(poly));
+        for(auto& h : holes(poly)) add_contour(m_ras, h);
         
-        ras.add_path(to_path(contour(poly)));
-        for(auto& h : holes(poly)) ras.add_path(to_path(h));
-        
-        agg::render_scanlines(ras, scanlines, m_renderer);
+        agg::render_scanlines(m_ras, m_scanlines, m_renderer);
+
+        // The cell bounds are valid after the cells were sorted by rendering.
+        if (m_ras.min_y() <= m_ras.max_y())
+            mark_dirty(m_ras.min_y(), m_ras.max_y());
+    }
+
+    // Draw the polygons one by one as draw(poly) does, but split the raster
+    // into horizontal bands rasterized in parallel. Each band has its own
+    // rasterizer clipped to the rows of the band, thus the bands write to
+    // disjoint parts of the buffer.
+    template<class P> void draw(const std::vector<P> &polys) {
+        // Number of raster rows of a band.
+        static constexpr size_t BandHeight = 64;
+        const size_t num_bands = (m_resolution.height_px + BandHeight - 1) / BandHeight;
+        if (num_bands < 2 || polys.size() < 2) {
+            for (const P &poly : polys) draw(poly);
+            return;
+        }
+
+        // Extents of the polygons in the raster coordinates.
+        std::vector<std::array<double, 4>> extents(polys.size());
+        double xmin = 0., xmax = double(m_resolution.width_px);
+        for (size_t i = 0; i < polys.size(); ++ i) {
+            std::array<double, 4> &ext = extents[i];
+            ext = { std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest(),
+                    std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest() };
+            double x, y;
+            for (const auto &pt : points(contour(polys[i]))) {
+                transform(pt, x, y);
+                ext[0] = std::min(ext[0], x);
+                ext[1] = std::max(ext[1], x);
+                ext[2] = std::min(ext[2], y);
+                ext[3] = std::max(ext[3], y);
+            }
+            xmin = std::min(xmin, ext[0]);
+            xmax = std::max(xmax, ext[1]);
+            mark_dirty(ext[2], ext[3]);
+        }
+
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, num_bands),
+            [this, &polys, &extents, xmin, xmax](const tbb::blocked_range<size_t> &range) {
+                agg::rasterizer_scanline_aa<> ras;
+                agg::scanline_p8 scanlines;
+                TRendererAA renderer(m_raw_renderer);
+                ras.gamma(m_gammafn);
+                renderer.color(ColorWhite);
+                for (size_t band = range.begin(); band < range.end(); ++ band) {
+                    auto y1 = double(band * BandHeight);
+                    auto y2 = double(std::min(m_resolution.height_px, (band + 1) * BandHeight));
+                    // Clip the rows only. The columns are not clipped, as the polygons fit in between xmin and xmax.
+                    ras.clip_box(xmin - 1., y1, xmax + 1., y2);
+                    for (size_t i = 0; i < polys.size(); ++ i)
+                        if (extents[i][3] > y1 && extents[i][2] < y2) {
+                            ras.reset();
+                            add_contour(ras, contour(polys[i]));
+                            for (auto &h : holes(polys[i])) add_contour(ras, h);
+                            agg::render_scanlines(ras, scanlines, renderer);
+                        }
+                }
+            });
     }
 
     inline void clear() {
-        m_raw_renderer.clear(ColorBlack);
+        // Single byte gray pixels, fill the buffer at once instead of blending the color pixel by pixel.
+        static_assert(TPixelRenderer::num_components == 1 && sizeof(TBuffer::value_type) == 1, "Single byte pixels expected");
+        if (m_dirty_begin < m_dirty_end) {
+            size_t row = m_resolution.width_px;
+            std::memset(m_buf.data() + m_dirty_begin * row, ColorBlack.v, (m_dirty_end - m_dirty_begin) * row);
+        }
+        m_dirty_begin = m_dirty_end = 0;
     }
 
     inline TBuffer& buffer()  { return m_buf; }
@@ -135,11 +222,6 @@ private:
         return p(1) * m_pxdim_scaled.h_mm;
     }
 
-    inline agg::path_storage to_path(const Polygon& poly)
-    {
-        return to_path(poly.points);
-    }
-
     inline double getPx(const ClipperLib::IntPoint& p) {
         return p.X * m_pxdim_scaled.w_mm;
     }
@@ -148,43 +230,44 @@ private:
         return p.Y * m_pxdim_scaled.h_mm;
     }
 
-    template<class PointVec> agg::path_storage _to_path(const PointVec& v)
+    // Transform a point of a contour into the raster coordinates.
+    template<class P> inline void transform(const P &p, double &x, double &y)
     {
-        agg::path_storage path;
-        
-        auto it = v.begin();
-        path.move_to(getPx(*it), getPy(*it));
-        while(++it != v.end()) path.line_to(getPx(*it), getPy(*it));
-        path.line_to(getPx(v.front()), getPy(v.front()));
-        
-        return path;
+        if (m_trafo.flipXY) {
+            x = getPy(p);
+            y = getPx(p);
+        } else {
+            x = getPx(p);
+            y = getPy(p);
+        }
+
+        x += m_trafo.origin_x * m_pxdim_scaled.w_mm;
+        y += m_trafo.origin_y * m_pxdim_scaled.h_mm;
+
+        if (m_trafo.mirror_x) x = double(m_resolution.width_px) - x;
+        if (m_trafo.mirror_y) y = double(m_resolution.height_px) - y;
     }
-   
-    template<class PointVec> agg::path_storage _to_path_flpxy(const PointVec& v)
+
+    // Feed a closed contour into the rasterizer directly, without building
+    // an intermediate agg::path_storage.
+    template<class Rasterizer, class PointVec> void add_contour(Rasterizer &ras, const PointVec &v)
     {
-        agg::path_storage path;
-        
+        if (v.empty()) return;
+
+        double x, y;
         auto it = v.begin();
-        path.move_to(getPy(*it), getPx(*it));
-        while(++it != v.end()) path.line_to(getPy(*it), getPx(*it));
-        path.line_to(getPy(v.front()), getPx(v.front()));
-        
-        return path;
-    }
-    
-    template<class PointVec> agg::path_storage to_path(const PointVec &v)
-    {
-        auto path = m_trafo.flipXY ? _to_path_flpxy(v) : _to_path(v);
-        
-        path.translate_all_paths(m_trafo.origin_x * m_pxdim_scaled.w_mm,
-                                 m_trafo.origin_y * m_pxdim_scaled.h_mm);
-        
-        if(m_trafo.mirror_x) flipx(path);
-        if(m_trafo.mirror_y) flipy(path);
-        
-        return path;
+        transform(*it, x, y);
+        ras.move_to_d(x, y);
+        while(++it != v.end()) {
+            transform(*it, x, y);
+            ras.line_to_d(x, y);
+        }
+        transform(v.front(), x, y);
+        ras.line_to_d(x, y);
     }
 
+    template<class Rasterizer> inline void add_contour(Rasterizer &ras, const Polygon &poly) { add_contour(ras, poly.points); }
+
 };
 
 const TPixel Raster::Impl::ColorWhite = TPixel(255);
@@ -248,6 +331,18 @@ void Raster::draw(const ClipperLib::Polygon &poly)
     m_impl->draw(poly);
 }
 
+void Raster::draw(const ExPolygons &polys)
+{
+    assert(m_impl);
+    m_impl->draw(polys);
+}
+
+void Raster::draw(const std::vector<ClipperLib::Polygon> &polys)
+{
+    assert(m_impl);
+    m_impl->draw(polys);
+}
+
 uint8_t Raster::read_pixel(size_t x, size_t y) const
 {
     assert (m_impl);
@@ -256,26 +351,101 @@ uint8_t Raster::read_pixel(size_t x, size_t y) const
     return px;
 }
 
+namespace {
+
+void png_put_u32(std::vector<std::uint8_t> &out, std::uint32_t v)
+{
+    out.emplace_back(std::uint8_t(v >> 24));
+    out.emplace_back(std::uint8_t(v >> 16));
+    out.emplace_back(std::uint8_t(v >> 8));
+    out.emplace_back(std::uint8_t(v));
+}
+
+// Start a PNG chunk with a yet unknown length, returns the offset of the chunk.
+size_t png_begin_chunk(std::vector<std::uint8_t> &out, const char *type)
+{
+    size_t offset = out.size();
+    png_put_u32(out, 0);
+    out.insert(out.end(), type, type + 4);
+    return offset;
+}
+
+// Fill in the length of the chunk and append its CRC.
+void png_end_chunk(std::vector<std::uint8_t> &out, size_t offset)
+{
+    auto len = std::uint32_t(out.size() - offset - 8);
+    for (int i = 0; i < 4; ++ i)
+        out[offset + i] = std::uint8_t(len >> (24 - 8 * i));
+    // The CRC covers the chunk type and the chunk data.
+    png_put_u32(out, std::uint32_t(mz_crc32(MZ_CRC32_INIT, out.data() + offset + 4, len + 4)));
+}
+
+// Output callback of the deflate compressor, appending to the output buffer.
+mz_bool png_put_buf(const void *buf, int len, void *user)
+{
+    auto &out = *static_cast<std::vector<std::uint8_t>*>(user);
+    auto  ptr = static_cast<const std::uint8_t*>(buf);
+    out.insert(out.end(), ptr, ptr + len);
+    return MZ_TRUE;
+}
+
+} // namespace
+
+// Write the 8 bit grayscale image into m_buffer directly, compressing it with
+// the deflate encoder of miniz configured by m_params.
 PNGImage & PNGImage::serialize(const Raster &raster)
 {
-    size_t s = 0;
     m_buffer.clear();
-    
-    void *rawdata = tdefl_write_image_to_png_file_in_memory(
-        get_internals(raster).buffer().data(),
-        int(raster.resolution().width_px),
-        int(raster.resolution().height_px), 1, &s);
-    
+
+    const auto &buf = get_internals(raster).buffer();
+    auto w = std::uint32_t(raster.resolution().width_px);
+    auto h = std::uint32_t(raster.resolution().height_px);
+    auto img = reinterpret_cast<const std::uint8_t*>(buf.data());
+
+    static const std::uint8_t signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    m_buffer.insert(m_buffer.end(), std::begin(signature), std::end(signature));
+
+    size_t chunk = png_begin_chunk(m_buffer, "IHDR");
+    png_put_u32(m_buffer, w);
+    png_put_u32(m_buffer, h);
+    // Bit depth 8, grayscale, deflate, adaptive filtering, no interlace.
+    for (std::uint8_t b : { 8, 0, 0, 0, 0 })
+        m_buffer.emplace_back(b);
+    png_end_chunk(m_buffer, chunk);
+
+    chunk = png_begin_chunk(m_buffer, "IDAT");
+    std::unique_ptr<tdefl_compressor> compressor(new tdefl_compressor);
+    mz_uint flags = tdefl_create_comp_flags_from_zip_params(
+        int(std::min(m_params.level, 10u)), MZ_DEFAULT_WINDOW_BITS,
+        m_params.rle ? MZ_RLE : MZ_DEFAULT_STRATEGY);
+    bool ok = tdefl_init(compressor.get(), png_put_buf, &m_buffer, int(flags)) == TDEFL_STATUS_OKAY;
+    // Filter type byte followed by the filtered row.
+    std::vector<std::uint8_t> row(size_t(w) + 1, 0);
+    for (std::uint32_t y = 0; ok && y < h; ++ y) {
+        const std::uint8_t *src = img + size_t(y) * w;
+        if (m_params.filter_up && y > 0) {
+            const std::uint8_t *above = src - w;
+            row[0] = 2;
+            for (std::uint32_t x = 0; x < w; ++ x)
+                row[x + 1] = std::uint8_t(src[x] - above[x]);
+        } else {
+            // The "Up" filter of the first row is the same as no filter.
+            row[0] = m_params.filter_up ? 2 : 0;
+            std::copy(src, src + w, row.begin() + 1);
+        }
+        ok = tdefl_compress_buffer(compressor.get(), row.data(), row.size(), TDEFL_NO_FLUSH) == TDEFL_STATUS_OKAY;
+    }
+    ok = ok && tdefl_compress_buffer(compressor.get(), nullptr, 0, TDEFL_FINISH) == TDEFL_STATUS_DONE;
+
     // On error, data() will return an empty vector. No other info can be
     // retrieved from miniz anyway...
-    if (rawdata == nullptr) return *this;
-    
-    auto ptr = static_cast<std::uint8_t*>(rawdata);
-    
-    m_buffer.reserve(s);
-    std::copy(ptr, ptr + s, std::back_inserter(m_buffer));
-    
-    MZ_FREE(rawdata);
+    if (! ok) {
+        m_buffer.clear();
+        return *this;
+    }
+    png_end_chunk(m_buffer, chunk);
+
+    png_end_chunk(m_buffer, png_begin_chunk(m_buffer, "IEND"));
     return *this;
 }
 
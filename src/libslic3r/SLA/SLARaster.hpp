@@ -130,6 +130,12 @@ public:
     void draw(const ExPolygon& poly);
     void draw(const ClipperLib::Polygon& poly);
 
+    /// Draw polygons with holes, the same as drawing them one by one.
+    /// The raster is split into horizontal bands, which are filled in
+    /// parallel, so that a single large layer is rasterized by all cores.
+    void draw(const ExPolygons& polys);
+    void draw(const std::vector<ClipperLib::Polygon>& polys);
+
     uint8_t read_pixel(size_t w, size_t h) const;
 
     inline bool empty() const { return ! bool(m_impl); }
@@ -138,8 +144,30 @@ public:
 
 class PNGImage: public Raster::RawData {
 public:
+    // Settings of the encoder. The defaults are tuned for the monochrome,
+    // mostly black layer images: The run length only search at level 1
+    // produces files about as small as the default deflate level 6 in less
+    // time. Level 1 without the run length search is several times faster,
+    // producing files about twice as big.
+    struct Params {
+        // Deflate compression level from 0 (store only) to 10 (slowest).
+        unsigned level = 1;
+        // Only search for runs of repeated bytes instead of the full
+        // dictionary search.
+        bool rle = true;
+        // Subtract the row above from each row (the PNG "Up" filter), which
+        // turns the rows equal to the previous row into zeros.
+        bool filter_up = false;
+    };
+
+    PNGImage() = default;
+    explicit PNGImage(const Params &params) : m_params(params) {}
+
     PNGImage& serialize(const Raster &raster) override;
     std::string get_file_extension() const override { return "png"; }
+
+private:
+    Params m_params;
 };
 
 class PPMImage: public Raster::RawData {
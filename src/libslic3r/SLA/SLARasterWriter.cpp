@@ -26,8 +26,78 @@ RasterWriter::RasterWriter(const Raster::Resolution &res,
                            const Raster::Trafo &     trafo,
                            double                    gamma)
     : m_res(res), m_pxdim(pixdim), m_trafo(trafo), m_gamma(gamma)
+    , m_raster_pool(new RasterPool)
 {}
 
+Raster RasterWriter::acquire_raster()
+{
+    Raster raster;
+    {
+        std::lock_guard<std::mutex> lck(m_raster_pool->mutex);
+        if (! m_raster_pool->rasters.empty()) {
+            raster = std::move(m_raster_pool->rasters.back());
+            m_raster_pool->rasters.pop_back();
+        }
+    }
+
+    // Only the rows drawn into by the previous layer are cleared.
+    if (raster.empty())
+        raster.reset(m_res, m_pxdim, m_trafo);
+    else
+        raster.clear();
+
+    return raster;
+}
+
+void RasterWriter::release_raster(Raster &&raster)
+{
+    std::lock_guard<std::mutex> lck(m_raster_pool->mutex);
+    m_raster_pool->rasters.emplace_back(std::move(raster));
+}
+
+void RasterWriter::release_rasters()
+{
+    std::lock_guard<std::mutex> lck(m_raster_pool->mutex);
+    m_raster_pool->rasters.clear();
+    m_raster_pool->rasters.shrink_to_fit();
+}
+
+size_t RasterWriter::memsize() const
+{
+    size_t n = m_layers_rst.capacity() * sizeof(Layer);
+    for (const Layer &layer : m_layers_rst) n += layer.rawbytes.size();
+
+    // The pooled rasters are 8 bit grayscale buffers of the full resolution.
+    std::lock_guard<std::mutex> lck(m_raster_pool->mutex);
+    n += m_raster_pool->rasters.size() * m_res.pixels();
+
+    return n;
+}
+
+namespace {
+
+std::string project_name(const Zipper &zipper, const std::string &prjname)
+{
+    return prjname.empty() ?
+               boost::filesystem::path(zipper.get_filename()).stem().string() :
+               prjname;
+}
+
+void add_layer_entry(Zipper &zipper, const std::string &project, unsigned lyr_id, const PNGImage &rawbytes)
+{
+    if(rawbytes.size() > 0) {
+        char lyrnum[6];
+        std::sprintf(lyrnum, "%.5d", lyr_id);
+        auto zfilename = project + lyrnum + ".png";
+
+        // Add binary entry to the zipper, PNG is compressed already.
+        zipper.add_entry(zfilename, rawbytes.data(), rawbytes.size(),
+                         Zipper::NO_COMPRESSION);
+    }
+}
+
+} // namespace
+
 void RasterWriter::save(const std::string &fpath, const std::string &prjname)
 {
     try {
@@ -44,27 +114,40 @@ void RasterWriter::save(const std::string &fpath, const std::string &prjname)
 void RasterWriter::save(Zipper &zipper, const std::string &prjname)
 {
     try {
-        std::string project =
-            prjname.empty() ?
-                boost::filesystem::path(zipper.get_filename()).stem().string() :
-                prjname;
+        std::string project = project_name(zipper, prjname);
 
         zipper.add_entry("config.ini");
 
         zipper << createIniContent(project);
 
         for(unsigned i = 0; i < m_layers_rst.size(); i++)
-        {
-            if(m_layers_rst[i].rawbytes.size() > 0) {
-                char lyrnum[6];
-                std::sprintf(lyrnum, "%.5d", i);
-                auto zfilename = project + lyrnum + ".png";
-
-                // Add binary entry to the zipper
-                zipper.add_entry(zfilename,
-                                 m_layers_rst[i].rawbytes.data(),
-                                 m_layers_rst[i].rawbytes.size());
-            }
+            add_layer_entry(zipper, project, i, m_layers_rst[i].rawbytes);
+    } catch(std::exception& e) {
+        BOOST_LOG_TRIVIAL(error) << e.what();
+        // Rethrow the exception
+        throw;
+    }
+}
+
+void RasterWriter::begin_stream(Zipper &zipper, const std::string &prjname)
+{
+    m_stream = std::make_unique<Stream>();
+    m_stream->zipper  = &zipper;
+    m_stream->project = project_name(zipper, prjname);
+    m_stream->finished.assign(m_layers_rst.size(), false);
+}
+
+void RasterWriter::stream_layer(unsigned lyr_id)
+{
+    std::lock_guard<std::mutex> lck(m_stream->mutex);
+    assert(lyr_id < m_stream->finished.size());
+    m_stream->finished[lyr_id] = true;
+    try {
+        for (; m_stream->next_layer < m_layers_rst.size() && m_stream->finished[m_stream->next_layer]; ++ m_stream->next_layer) {
+            Layer &layer = m_layers_rst[m_stream->next_layer];
+            add_layer_entry(*m_stream->zipper, m_stream->project, m_stream->next_layer, layer.rawbytes);
+            // The layer was written, release its data.
+            layer.rawbytes = PNGImage();
         }
     } catch(std::exception& e) {
         BOOST_LOG_TRIVIAL(error) << e.what();
@@ -73,6 +156,20 @@ void RasterWriter::save(Zipper &zipper, const std::string &prjname)
     }
 }
 
+void RasterWriter::end_stream()
+{
+    assert(m_stream && m_stream->next_layer == m_layers_rst.size());
+    try {
+        m_stream->zipper->add_entry("config.ini");
+        *m_stream->zipper << createIniContent(m_stream->project);
+    } catch(std::exception& e) {
+        BOOST_LOG_TRIVIAL(error) << e.what();
+        // Rethrow the exception
+        throw;
+    }
+    m_stream.reset();
+}
+
 namespace {
 
 std::string get_cfg_value(const DynamicPrintConfig &cfg, const std::string &key)
@@ -8,6 +8,8 @@
 #include <vector>
 #include <map>
 #include <array>
+#include <memory>
+#include <mutex>
 
 #include "libslic3r/PrintConfig.hpp"
 
@@ -24,6 +26,10 @@ namespace Slic3r { namespace sla {
 // each layer can be written and compressed independently (in parallel).
 // At the end when all layers where written, the save method can be used to 
 // write out the result into a zipped archive.
+// Alternatively in the streaming mode started by begin_stream(), the layers
+// are written into the archive in the order of layers as soon as all the layers
+// below were finished, and their compressed data is released. Then only
+// the layers finished out of order are held in memory.
 class RasterWriter
 {
 public:
@@ -64,9 +70,39 @@ private:
     double             m_gamma;
 
     std::map<std::string, std::string> m_config;
+
+    // State of the streaming mode, see begin_stream().
+    struct Stream {
+        Zipper           *zipper = nullptr;
+        std::string       project;
+        // Index of the next layer to be written into the zipper.
+        unsigned          next_layer = 0;
+        // Which layers were finished, but not written yet.
+        std::vector<bool> finished;
+        std::mutex        mutex;
+    };
+    std::unique_ptr<Stream> m_stream;
+
+    // Rasters of the finished layers kept for the next layers, so that
+    // the full resolution buffers are not allocated and page faulted for
+    // every layer again. The pool grows up to the number of the layers
+    // rasterized at the same time.
+    struct RasterPool {
+        std::vector<Raster> rasters;
+        std::mutex          mutex;
+    };
+    std::unique_ptr<RasterPool> m_raster_pool;
+
+    // Get a cleared raster from the pool or allocate a new one.
+    Raster acquire_raster();
+    void   release_raster(Raster &&raster);
     
     std::string createIniContent(const std::string& projectname) const;
 
+    // Mark the layer as finished and write all the continuous finished layers
+    // following the layers already written into the zipper.
+    void stream_layer(unsigned lyr_id);
+
 public:
     
     // SLARasterWriter is using Raster in custom mirroring mode
@@ -89,32 +125,58 @@ public:
         m_layers_rst[lyr].raster.draw(p);
     }
 
+    // Draw all the polygons of a layer, see Raster::draw(polys).
+    template<class Polys> void draw_polygons(const Polys& pp, unsigned lyr)
+    {
+        assert(lyr < m_layers_rst.size());
+        m_layers_rst[lyr].raster.draw(pp);
+    }
+
     inline void begin_layer(unsigned lyr) {
         if(m_layers_rst.size() <= lyr) m_layers_rst.resize(lyr+1);
-        m_layers_rst[lyr].raster.reset(m_res, m_pxdim, m_trafo);
+        m_layers_rst[lyr].raster = acquire_raster();
     }
 
     inline void begin_layer() {
         m_layers_rst.emplace_back();
-        m_layers_rst.front().raster.reset(m_res, m_pxdim, m_trafo);
+        m_layers_rst.back().raster = acquire_raster();
     }
 
     inline void finish_layer(unsigned lyr_id) {
         assert(lyr_id < m_layers_rst.size());
         m_layers_rst[lyr_id].rawbytes.serialize(m_layers_rst[lyr_id].raster);
-        m_layers_rst[lyr_id].raster.reset();
+        release_raster(std::move(m_layers_rst[lyr_id].raster));
+        if (m_stream) stream_layer(lyr_id);
     }
 
     inline void finish_layer() {
         if(!m_layers_rst.empty()) {
             m_layers_rst.back().rawbytes.serialize(m_layers_rst.back().raster);
-            m_layers_rst.back().raster.reset();
+            release_raster(std::move(m_layers_rst.back().raster));
+            if (m_stream) stream_layer(unsigned(m_layers_rst.size() - 1));
         }
     }
 
+    // Free the rasters kept for reuse, to be called once all the layers
+    // were finished.
+    void release_rasters();
+
+    // Memory held by the compressed layers and by the rasters kept for
+    // reuse, in bytes.
+    size_t memsize() const;
+
     void save(const std::string &fpath, const std::string &prjname = "");
     void save(Zipper &zipper, const std::string &prjname = "");
 
+    // Start the streaming mode: The finished layers will be written into
+    // the zipper in the order of layers. The number of layers has to be set
+    // with layers(cnt) before. finish_layer() may be called in parallel.
+    void begin_stream(Zipper &zipper, const std::string &prjname = "");
+    // Write the config.ini, all the layers must have been finished.
+    // The zipper is to be finalized by the caller.
+    void end_stream();
+    bool streaming() const { return bool(m_stream); }
+
     void set_statistics(const PrintStatistics &statistics);
 
     void set_config(const DynamicPrintConfig &cfg);
@@ -1,6 +1,9 @@
 #include <limits>
 #include <exception>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_reduce.h>
+
 #include <libnest2d/optimizers/nlopt/genetic.hpp>
 #include "SLABoilerPlate.hpp"
 #include "SLARotfinder.hpp"
@@ -10,6 +13,92 @@
 namespace Slic3r {
 namespace sla {
 
+namespace {
+
+// The unit normals of the mesh facets. The score of a rotation depends only on
+// the facet normals, so they are computed once instead of in every iteration
+// of the solver. Facets with exactly the same normal are merged and weighted
+// by their count: typical technical models have only a few distinct normals.
+struct NormalHistogram {
+    Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor> normals;
+    Eigen::VectorXd weights;
+};
+
+NormalHistogram normal_histogram(const ModelObject &modelobj)
+{
+    std::vector<Vec3d> normals;
+
+    // The facets of the volumes are transformed on the fly, the raw mesh of
+    // the object is not assembled.
+    modelobj.visit_raw_meshes([&normals](const TriangleMesh &mesh, const Transform3d &trafo) {
+        normals.reserve(normals.size() + mesh.stl.facet_start.size());
+
+        for (const stl_facet &facet : mesh.stl.facet_start) {
+            Vec3d p1 = trafo * facet.vertex[0].cast<double>();
+            Vec3d p2 = trafo * facet.vertex[1].cast<double>();
+            Vec3d p3 = trafo * facet.vertex[2].cast<double>();
+
+            Vec3d n = (p2 - p1).cross(p3 - p1);
+
+            // Degenerate facets do not contribute to the score
+            if (n.squaredNorm() > 0.) normals.emplace_back(n.normalized());
+        }
+    });
+
+    std::sort(normals.begin(), normals.end(), [](const Vec3d &a, const Vec3d &b) {
+        return std::lexicographical_compare(a.data(), a.data() + 3,
+                                            b.data(), b.data() + 3);
+    });
+
+    NormalHistogram ret;
+    ret.normals.resize(Eigen::Index(normals.size()), 3);
+    ret.weights.resize(Eigen::Index(normals.size()));
+
+    Eigen::Index cnt = 0;
+    for (size_t i = 0; i < normals.size(); ++i) {
+        if (cnt > 0 && normals[i] == normals[i - 1]) {
+            ret.weights(cnt - 1) += 1.;
+        } else {
+            ret.normals.row(cnt) = normals[i].transpose();
+            ret.weights(cnt++)   = 1.;
+        }
+    }
+
+    ret.normals.conservativeResize(cnt, 3);
+    ret.weights.conservativeResize(cnt);
+
+    return ret;
+}
+
+// For all the normals, sum up the dot products (a scalar indicating how much
+// are two vectors aligned) of the rotated normal with each axis. This will
+// result in a value that is greater if a normal is aligned with all axes. If
+// the normal is aligned than the triangle itself is orthogonal to the axes
+// and that is good for print quality. The dot products of a rotated normal
+// with the axes are the components of the rotated normal, the whole block of
+// normals is rotated by a single matrix product. The blocks are reduced in a
+// fixed order so that the score of a rotation is reproducible.
+double rotation_score(const NormalHistogram &h, const Matrix3d &rot)
+{
+    using Range = tbb::blocked_range<Eigen::Index>;
+
+    static const Eigen::Index BLOCK_SIZE = 4096;
+
+    return tbb::parallel_deterministic_reduce(
+        Range(0, h.normals.rows(), BLOCK_SIZE), 0.,
+        [&h, &rot](const Range &range, double score) {
+            auto nrm = h.normals.middleRows(range.begin(), range.size());
+            auto w   = h.weights.segment(range.begin(), range.size());
+
+            Eigen::Matrix<double, Eigen::Dynamic, 3> rotated = nrm * rot.transpose();
+
+            return score + rotated.cwiseAbs().rowwise().sum().dot(w);
+        },
+        std::plus<double>());
+}
+
+} // namespace
+
 std::array<double, 3> find_best_rotation(const ModelObject& modelobj,
                                          float accuracy,
                                          std::function<void(unsigned)> statuscb,
@@ -26,9 +115,8 @@ std::array<double, 3> find_best_rotation(const ModelObject& modelobj,
     // return value
     std::array<double, 3> rot;
 
-    // We will use only one instance of this converted mesh to examine different
-    // rotations
-    EigenMesh3D emesh(modelobj.raw_mesh());
+    // The score only depends on the facet normals, collect them once.
+    NormalHistogram histogram = normal_histogram(modelobj);
 
     // For current iteration number
     unsigned status = 0;
@@ -44,11 +132,9 @@ std::array<double, 3> find_best_rotation(const ModelObject& modelobj,
     // call the status callback in each iteration but the actual value may be
     // the same for subsequent iterations (status goes from 0 to 100 but
     // iterations can be many more)
-    auto objfunc = [&emesh, &status, &statuscb, &stopcond, max_tries]
+    auto objfunc = [&histogram, &status, &statuscb, &stopcond, max_tries]
             (double rx, double ry, double rz)
     {
-        EigenMesh3D& m = emesh;
-
         // prepare the rotation transformation
         Transform3d rt = Transform3d::Identity();
 
@@ -56,39 +142,13 @@ std::array<double, 3> find_best_rotation(const ModelObject& modelobj,
         rt.rotate(Eigen::AngleAxisd(ry, Vec3d::UnitY()));
         rt.rotate(Eigen::AngleAxisd(rx, Vec3d::UnitX()));
 
-        double score = 0;
-
-        // For all triangles we calculate the normal and sum up the dot product
-        // (a scalar indicating how much are two vectors aligned) with each axis
-        // this will result in a value that is greater if a normal is aligned
-        // with all axes. If the normal is aligned than the triangle itself is
-        // orthogonal to the axes and that is good for print quality.
+        // We should score against the alignment with the reference planes.
 
         // TODO: some applications optimize for minimum z-axis cross section
         // area. The current function is only an example of how to optimize.
 
         // Later we can add more criteria like the number of overhangs, etc...
-        for(int i = 0; i < m.F().rows(); i++) {
-            auto idx = m.F().row(i);
-
-            Vec3d p1 = m.V().row(idx(0));
-            Vec3d p2 = m.V().row(idx(1));
-            Vec3d p3 = m.V().row(idx(2));
-
-            Eigen::Vector3d U = p2 - p1;
-            Eigen::Vector3d V = p3 - p1;
-
-            // So this is the normal
-            auto n = U.cross(V).normalized();
-
-            // rotate the normal with the current rotation given by the solver
-            n = rt * n;
-
-            // We should score against the alignment with the reference planes
-            score += std::abs(n.dot(Vec3d::UnitX()));
-            score += std::abs(n.dot(Vec3d::UnitY()));
-            score += std::abs(n.dot(Vec3d::UnitZ()));
-        }
+        double score = rotation_score(histogram, rt.linear());
 
         // report status
         if(!stopcond()) statuscb( unsigned(++status * 100.0/max_tries) );
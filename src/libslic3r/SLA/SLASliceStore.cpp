@@ -0,0 +1,150 @@
+#include "SLASliceStore.hpp"
+#include "SLAConcurrency.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace Slic3r {
+namespace sla {
+
+static void write_varint(std::vector<uint8_t> &out, uint64_t value)
+{
+    while (value >= 0x80) {
+        out.emplace_back(uint8_t(value | 0x80));
+        value >>= 7;
+    }
+    out.emplace_back(uint8_t(value));
+}
+
+static uint64_t read_varint(const uint8_t *&ptr)
+{
+    uint64_t value = 0;
+    for (int shift = 0;; shift += 7) {
+        uint8_t byte = *ptr ++;
+        value |= uint64_t(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+            return value;
+    }
+}
+
+// Map the signed deltas to unsigned numbers, so that the small negative
+// deltas are encoded by a few bytes as well.
+static inline uint64_t zigzag_encode(int64_t value)
+{
+    return (uint64_t(value) << 1) ^ uint64_t(value >> 63);
+}
+
+static inline int64_t zigzag_decode(uint64_t value)
+{
+    return int64_t(value >> 1) ^ - int64_t(value & 1);
+}
+
+// The points are encoded as deltas to the previous point of the layer,
+// continuing from one polygon to the next.
+static void write_polygon(std::vector<uint8_t> &out, const Polygon &polygon, Point &last)
+{
+    write_varint(out, polygon.points.size());
+    for (const Point &pt : polygon.points) {
+        write_varint(out, zigzag_encode(int64_t(pt(0)) - int64_t(last(0))));
+        write_varint(out, zigzag_encode(int64_t(pt(1)) - int64_t(last(1))));
+        last = pt;
+    }
+}
+
+static void read_polygon(const uint8_t *&ptr, Polygon &polygon, Point &last)
+{
+    polygon.points.resize(size_t(read_varint(ptr)));
+    for (Point &pt : polygon.points) {
+        pt(0) = coord_t(int64_t(last(0)) + zigzag_decode(read_varint(ptr)));
+        pt(1) = coord_t(int64_t(last(1)) + zigzag_decode(read_varint(ptr)));
+        last = pt;
+    }
+}
+
+void SliceStore::assign(const std::vector<ExPolygons> &slices)
+{
+    this->clear();
+    m_layers.assign(slices.size(), Layer());
+    ccr::enumerate(slices.begin(), slices.end(),
+                   [this](const ExPolygons &expolygons, size_t idx) {
+        Layer &layer = m_layers[idx];
+        layer.expolygons_count = uint32_t(expolygons.size());
+        Point last(0, 0);
+        for (const ExPolygon &expoly : expolygons) {
+            write_varint(layer.data, expoly.holes.size());
+            write_polygon(layer.data, expoly.contour, last);
+            for (const Polygon &hole : expoly.holes)
+                write_polygon(layer.data, hole, last);
+        }
+        layer.data.shrink_to_fit();
+    });
+}
+
+void SliceStore::clear()
+{
+    m_layers.clear();
+    std::lock_guard<std::mutex> lock(m_decoded_mutex);
+    m_decoded.clear();
+}
+
+ExPolygons SliceStore::decode(size_t idx) const
+{
+    assert(idx < m_layers.size());
+    const Layer &layer = m_layers[idx];
+    ExPolygons   out(layer.expolygons_count);
+    const uint8_t *ptr = layer.data.data();
+    Point last(0, 0);
+    for (ExPolygon &expoly : out) {
+        expoly.holes.resize(size_t(read_varint(ptr)));
+        read_polygon(ptr, expoly.contour, last);
+        for (Polygon &hole : expoly.holes)
+            read_polygon(ptr, hole, last);
+    }
+    assert(ptr == layer.data.data() + layer.data.size());
+    return out;
+}
+
+ExPolygons SliceStore::get(size_t idx) const
+{
+    {
+        std::lock_guard<std::mutex> lock(m_decoded_mutex);
+        auto it = std::find_if(m_decoded.begin(), m_decoded.end(),
+            [idx](const std::pair<size_t, ExPolygons> &l) { return l.first == idx; });
+        if (it != m_decoded.end()) {
+            std::rotate(it, it + 1, m_decoded.end());
+            return m_decoded.back().second;
+        }
+    }
+
+    // Decode outside of the lock, the layers are decoded concurrently by
+    // the rasterization.
+    ExPolygons out = this->decode(idx);
+    std::lock_guard<std::mutex> lock(m_decoded_mutex);
+    if (m_decoded.size() == MAX_DECODED_LAYERS)
+        m_decoded.erase(m_decoded.begin());
+    m_decoded.emplace_back(idx, out);
+    return out;
+}
+
+std::vector<ExPolygons> SliceStore::get_all() const
+{
+    std::vector<ExPolygons> out(m_layers.size());
+    ccr::enumerate(out.begin(), out.end(),
+                   [this](ExPolygons &expolygons, size_t idx) {
+        expolygons = this->decode(idx);
+    });
+    return out;
+}
+
+size_t SliceStore::memsize() const
+{
+    size_t n = sizeof(*this) + m_layers.capacity() * sizeof(Layer);
+    for (const Layer &layer : m_layers)
+        n += layer.data.capacity();
+    std::lock_guard<std::mutex> lock(m_decoded_mutex);
+    for (const std::pair<size_t, ExPolygons> &decoded : m_decoded)
+        n += Slic3r::memsize(decoded.second);
+    return n;
+}
+
+}} // namespace Slic3r::sla
@@ -0,0 +1,61 @@
+#ifndef SLASLICESTORE_HPP
+#define SLASLICESTORE_HPP
+
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <libslic3r/ExPolygon.hpp>
+
+namespace Slic3r {
+namespace sla {
+
+// Compact storage of the slices of an SLA object or of its supports, one
+// ExPolygons per layer. The points of a layer are delta encoded and stored as
+// zig-zag varints, which takes a fraction of the memory of ExPolygons for the
+// dense contours produced by slicing fine layers. A layer is decoded on each
+// access. The few layers decoded last are kept, as the preview asks for the
+// same layers around the slider again and again.
+class SliceStore {
+public:
+    SliceStore() = default;
+    SliceStore(const SliceStore &) = delete;
+    SliceStore &operator=(const SliceStore &) = delete;
+
+    // Encode the layers, the layers are encoded in parallel.
+    void assign(const std::vector<ExPolygons> &slices);
+    void clear();
+
+    size_t size() const { return m_layers.size(); }
+    bool   empty() const { return m_layers.empty(); }
+
+    // Number of ExPolygons of a layer, without decoding the layer.
+    size_t expolygons_count(size_t idx) const { return m_layers[idx].expolygons_count; }
+
+    // Decode a single layer.
+    ExPolygons get(size_t idx) const;
+    // Decode all the layers, for the algorithms running over the whole object.
+    std::vector<ExPolygons> get_all() const;
+
+    // Memory footprint of the encoded layers and of the decoded layers kept.
+    size_t memsize() const;
+
+private:
+    struct Layer {
+        uint32_t             expolygons_count = 0;
+        std::vector<uint8_t> data;
+    };
+    std::vector<Layer> m_layers;
+
+    ExPolygons decode(size_t idx) const;
+
+    // Decoded layers, the most recently used at the end.
+    static const size_t MAX_DECODED_LAYERS = 8;
+    mutable std::vector<std::pair<size_t, ExPolygons>> m_decoded;
+    mutable std::mutex                                 m_decoded_mutex;
+};
+
+}} // namespace Slic3r::sla
+
+#endif // SLASLICESTORE_HPP
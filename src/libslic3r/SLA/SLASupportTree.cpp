@@ -57,12 +57,7 @@ std::vector<ExPolygons> SupportTree::slice(
     using Slices = std::vector<ExPolygons>;
     auto slices = reserve_vector<Slices>(2);
 
-    if (!sup_mesh.empty()) {
-        slices.emplace_back();
-
-        TriangleMeshSlicer sup_slicer(&sup_mesh);
-        sup_slicer.slice(grid, cr, &slices.back(), ctl().cancelfn);
-    }
+    if (!sup_mesh.empty()) slices.emplace_back(slice_supports(grid, cr));
 
     if (!pad_mesh.empty()) {
         slices.emplace_back();
@@ -97,6 +92,17 @@ std::vector<ExPolygons> SupportTree::slice(
     return mrg;
 }
 
+std::vector<ExPolygons> SupportTree::slice_supports(
+    const std::vector<float> &grid, float cr) const
+{
+    std::vector<ExPolygons> slices;
+
+    TriangleMeshSlicer sup_slicer(&retrieve_mesh(MeshType::Support));
+    sup_slicer.slice(grid, cr, &slices, ctl().cancelfn);
+
+    return slices;
+}
+
 SupportTree::UPtr SupportTree::create(const SupportableMesh &sm,
                                       const JobController &  ctl)
 {
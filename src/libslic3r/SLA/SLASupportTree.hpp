@@ -1,8 +1,10 @@
 #ifndef SLASUPPORTTREE_HPP
 #define SLASUPPORTTREE_HPP
 
+#include <array>
 #include <vector>
 #include <memory>
+#include <unordered_map>
 #include <Eigen/Geometry>
 
 #include "SLACommon.hpp"
@@ -126,12 +128,48 @@ struct JobController
     CancelFn cancelfn = [](){};
 };
 
+// Outcome of filtering the individual support points by a build of the
+// support tree: the corrected head direction and whether the point gets a
+// head, a headless pillar or is dropped. The outcome depends only on the point
+// itself, on the mesh and on a few configuration values, so it is kept between
+// the builds and after editing a few points by hand only the edited points are
+// tested against the mesh again.
+struct SupportHeadCache
+{
+    enum class Result : uint8_t { Head, Headless, Dropped };
+
+    struct Entry {
+        Vec3d  normal = Vec3d::Zero();
+        Result result = Result::Dropped;
+    };
+
+    // Position and head front radius of a support point.
+    using Key = std::array<float, 4>;
+
+    struct KeyHash {
+        size_t operator()(const Key &key) const;
+    };
+
+    // Hash of the mesh and of the configuration values the entries were
+    // created for, the entries are dropped if it changes.
+    size_t                                     params_hash = 0;
+    std::unordered_map<Key, Entry, KeyHash>    entries;
+
+    static Key key(const SupportPoint &sp)
+    {
+        return {sp.pos(0), sp.pos(1), sp.pos(2), sp.head_front_radius};
+    }
+};
+
 struct SupportableMesh
 {
     EigenMesh3D   emesh;
     SupportPoints pts;
     SupportConfig cfg;
 
+    // Optional, shared by the consecutive builds of the support tree.
+    std::shared_ptr<SupportHeadCache> head_cache;
+
     explicit SupportableMesh(const TriangleMesh & trmsh,
                              const SupportPoints &sp,
                              const SupportConfig &c)
@@ -175,6 +213,12 @@ public:
     void retrieve_full_mesh(TriangleMesh &outmesh) const;
     
     const JobController &ctl() const { return m_ctl; }
+    
+protected:
+    /// Slices of the supports without the pad. Slices the support mesh by
+    /// default.
+    virtual std::vector<ExPolygons> slice_supports(const std::vector<float> &grid,
+                                                   float closing_radius) const;
 };
 
 }
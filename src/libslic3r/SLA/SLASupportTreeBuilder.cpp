@@ -254,6 +254,9 @@ Pillar &Pillar::add_base(double baseheight, double radius)
     
     if(radius < r ) radius = r;
     
+    base_height = baseheight;
+    base_r = radius;
+    
     double a = 2*PI/steps;
     double z = endpt(Z) + baseheight;
     
@@ -294,7 +297,7 @@ Pillar &Pillar::add_base(double baseheight, double radius)
 }
 
 Bridge::Bridge(const Vec3d &j1, const Vec3d &j2, double r_mm, size_t steps):
-    r(r_mm), startp(j1), endp(j2)
+    r(r_mm), steps(steps), startp(j1), endp(j2)
 {
     using Quaternion = Eigen::Quaternion<double>;
     Vec3d dir = (j2 - j1).normalized();
@@ -312,10 +315,11 @@ CompactBridge::CompactBridge(const Vec3d &sp,
                              double       r,
                              bool         endball,
                              size_t       steps)
+    : r(r), steps(steps), endball(endball)
 {
-    Vec3d startp = sp + r * n;
+    startp = sp + r * n;
     Vec3d dir = (ep - startp).normalized();
-    Vec3d endp = ep - r * dir;
+    endp = ep - r * dir;
     
     Bridge br(startp, endp, r, steps);
     mesh.merge(br.mesh);
@@ -334,32 +338,54 @@ CompactBridge::CompactBridge(const Vec3d &sp,
     mesh.merge(upperball);
 }
 
-Pad::Pad(const TriangleMesh &support_mesh,
-         const ExPolygons &  model_contours,
-         double              ground_level,
-         const PadConfig &   pcfg,
-         ThrowOnCancel       thr)
+Pad::Pad(const ExPolygons &support_blueprint,
+         const ExPolygons &model_contours,
+         double            ground_level,
+         const PadConfig & pcfg,
+         ThrowOnCancel     thr)
     : cfg(pcfg)
     , zlevel(ground_level + pcfg.full_height() - pcfg.required_elevation())
 {
     thr();
     
-    ExPolygons sup_contours;
+    create_pad(support_blueprint, model_contours, tmesh, pcfg, thr);
     
-    float zstart = float(zlevel);
+    tmesh.translate(0, 0, float(zlevel));
+    if (!tmesh.empty()) tmesh.require_shared_vertices();
+}
+
+std::vector<float> Pad::blueprint_heights(double           ground_level,
+                                          const PadConfig &pcfg)
+{
+    float zstart = float(ground_level + pcfg.full_height() -
+                         pcfg.required_elevation());
     float zend   = zstart + float(pcfg.full_height() + EPSILON);
     
-    pad_blueprint(support_mesh, sup_contours, grid(zstart, zend, 0.1f), thr);
-    create_pad(sup_contours, model_contours, tmesh, pcfg);
+    return grid(zstart, zend, 0.1f);
+}
+
+const ExPolygons &SupportTreeBuilder::support_pad_blueprint(
+    const std::vector<float> &heights) const
+{
+    // Rebuilding the merged mesh drops the cached blueprint.
+    const TriangleMesh &support_mesh = merged_mesh();
     
-    tmesh.translate(0, 0, float(zlevel));
-    if (!tmesh.empty()) tmesh.require_shared_vertices();
+    if (heights != m_pad_blueprint_heights) {
+        m_pad_blueprint.clear();
+        pad_blueprint(support_mesh, m_pad_blueprint, heights, ctl().cancelfn);
+        m_pad_blueprint_heights = heights;
+    }
+    
+    return m_pad_blueprint;
 }
 
 const TriangleMesh &SupportTreeBuilder::add_pad(const ExPolygons &modelbase,
                                                 const PadConfig & cfg)
 {
-    m_pad = Pad{merged_mesh(), modelbase, ground_level, cfg, ctl().cancelfn};
+    const ExPolygons &supp_bp =
+        support_pad_blueprint(Pad::blueprint_heights(ground_level, cfg));
+    
+    m_pad = Pad{supp_bp, modelbase, ground_level, cfg, ctl().cancelfn};
     return m_pad.tmesh;
 }
 
@@ -372,8 +398,11 @@ SupportTreeBuilder::SupportTreeBuilder(SupportTreeBuilder &&o)
     , m_compact_bridges{std::move(o.m_compact_bridges)}
     , m_pad{std::move(o.m_pad)}
     , m_meshcache{std::move(o.m_meshcache)}
+    , m_primitives{std::move(o.m_primitives)}
     , m_meshcache_valid{o.m_meshcache_valid}
     , m_model_height{o.m_model_height}
+    , m_pad_blueprint{std::move(o.m_pad_blueprint)}
+    , m_pad_blueprint_heights{std::move(o.m_pad_blueprint_heights)}
     , ground_level{o.ground_level}
 {}
 
@@ -386,8 +415,11 @@ SupportTreeBuilder::SupportTreeBuilder(const SupportTreeBuilder &o)
     , m_compact_bridges{o.m_compact_bridges}
     , m_pad{o.m_pad}
     , m_meshcache{o.m_meshcache}
+    , m_primitives{o.m_primitives}
     , m_meshcache_valid{o.m_meshcache_valid}
     , m_model_height{o.m_model_height}
+    , m_pad_blueprint{o.m_pad_blueprint}
+    , m_pad_blueprint_heights{o.m_pad_blueprint_heights}
     , ground_level{o.ground_level}
 {}
 
@@ -401,8 +433,11 @@ SupportTreeBuilder &SupportTreeBuilder::operator=(SupportTreeBuilder &&o)
     m_compact_bridges = std::move(o.m_compact_bridges);
     m_pad = std::move(o.m_pad);
     m_meshcache = std::move(o.m_meshcache);
+    m_primitives = std::move(o.m_primitives);
     m_meshcache_valid = o.m_meshcache_valid;
     m_model_height = o.m_model_height;
+    m_pad_blueprint = std::move(o.m_pad_blueprint);
+    m_pad_blueprint_heights = std::move(o.m_pad_blueprint_heights);
     ground_level = o.ground_level;
     return *this;
 }
@@ -417,8 +452,11 @@ SupportTreeBuilder &SupportTreeBuilder::operator=(const SupportTreeBuilder &o)
     m_compact_bridges = o.m_compact_bridges;
     m_pad = o.m_pad;
     m_meshcache = o.m_meshcache;
+    m_primitives = o.m_primitives;
     m_meshcache_valid = o.m_meshcache_valid;
     m_model_height = o.m_model_height;
+    m_pad_blueprint = o.m_pad_blueprint;
+    m_pad_blueprint_heights = o.m_pad_blueprint_heights;
     ground_level = o.ground_level;
     return *this;
 }
@@ -427,46 +465,110 @@ const TriangleMesh &SupportTreeBuilder::merged_mesh() const
 {
     if (m_meshcache_valid) return m_meshcache;
     
-    Contour3D merged;
+    m_pad_blueprint_heights.clear();
     
-    for (auto &head : m_heads) {
-        if (ctl().stopcondition()) break;
-        if (head.is_valid()) merged.merge(head.mesh);
-    }
+    // Visit the meshes of all the elements in the order of merging.
+    auto foreach_mesh = [this](auto fn) {
+        for (auto &head : m_heads) {
+            if (ctl().stopcondition()) return;
+            if (head.is_valid()) fn(head.mesh);
+        }
+        
+        for (auto &stick : m_pillars) {
+            if (ctl().stopcondition()) return;
+            fn(stick.mesh);
+            fn(stick.base);
+        }
+        
+        for (auto &j : m_junctions) {
+            if (ctl().stopcondition()) return;
+            fn(j.mesh);
+        }
+        
+        for (auto &cb : m_compact_bridges) {
+            if (ctl().stopcondition()) return;
+            fn(cb.mesh);
+        }
+        
+        for (auto &bs : m_bridges) {
+            if (ctl().stopcondition()) return;
+            fn(bs.mesh);
+        }
+        
+        for (auto &bs : m_crossbridges) {
+            if (ctl().stopcondition()) return;
+            fn(bs.mesh);
+        }
+    };
     
-    for (auto &stick : m_pillars) {
-        if (ctl().stopcondition()) break;
-        merged.merge(stick.mesh);
-        merged.merge(stick.base);
-    }
+    // The meshes of the elements are kept by the elements, count them first
+    // to fill the merged mesh without reallocations.
+    size_t npoints = 0, nindices = 0;
+    foreach_mesh([&npoints, &nindices](const Contour3D &m) {
+        npoints  += m.points.size();
+        nindices += m.indices.size();
+    });
     
-    for (auto &j : m_junctions) {
-        if (ctl().stopcondition()) break;
-        merged.merge(j.mesh);
-    }
+    Contour3D merged;
+    merged.points.reserve(npoints);
+    merged.indices.reserve(nindices);
+    foreach_mesh([&merged](const Contour3D &m) { merged.merge(m); });
     
-    for (auto &cb : m_compact_bridges) {
-        if (ctl().stopcondition()) break;
-        merged.merge(cb.mesh);
+    if (ctl().stopcondition()) {
+        // In case of failure we have to return an empty mesh
+        m_meshcache = TriangleMesh();
+        return m_meshcache;
     }
     
-    for (auto &bs : m_bridges) {
-        if (ctl().stopcondition()) break;
-        merged.merge(bs.mesh);
-    }
+    m_meshcache = mesh(std::move(merged));
+    
+    // The elements are released by merge_and_cleanup(), their analytic
+    // description is kept for slicing.
+    m_primitives.clear();
+    for (auto &head : m_heads)
+        if (head.is_valid())
+            m_primitives.emplace_back(SupportPrimitive::balls(
+                head.tr + (head.r_pin_mm - head.penetration_mm) * head.dir,
+                head.r_pin_mm, head.junction_point(), head.r_back_mm,
+                head.steps));
     
-    for (auto &bs : m_crossbridges) {
-        if (ctl().stopcondition()) break;
-        merged.merge(bs.mesh);
+    for (auto &stick : m_pillars) {
+        if (stick.height > EPSILON)
+            m_primitives.emplace_back(SupportPrimitive::discs(
+                stick.endpoint(), stick.r, stick.startpoint(), stick.r,
+                stick.steps));
+        if (stick.base_height > 0) {
+            Vec3d top = stick.endpoint(); top(Z) += stick.base_height;
+            m_primitives.emplace_back(SupportPrimitive::discs(
+                stick.endpoint(), stick.base_r, top, stick.r, stick.steps));
+        }
     }
     
-    if (ctl().stopcondition()) {
-        // In case of failure we have to return an empty mesh
-        m_meshcache = TriangleMesh();
-        return m_meshcache;
+    for (auto &j : m_junctions)
+        m_primitives.emplace_back(
+            SupportPrimitive::balls(j.pos, j.r, j.pos, j.r, j.steps));
+    
+    for (auto &cb : m_compact_bridges) {
+        m_primitives.emplace_back(SupportPrimitive::discs(
+            cb.startp, cb.r, cb.endp, cb.r, cb.steps));
+        
+        // The upper half ball on the start and the lower one on the end
+        SupportPrimitive ball = SupportPrimitive::balls(
+            cb.startp, cb.r, cb.startp, cb.r, cb.steps);
+        ball.zmin = cb.startp(Z);
+        m_primitives.emplace_back(ball);
+        if (cb.endball) {
+            ball = SupportPrimitive::balls(cb.endp, cb.r, cb.endp, cb.r,
+                                           cb.steps);
+            ball.zmax = cb.endp(Z);
+            m_primitives.emplace_back(ball);
+        }
     }
     
-    m_meshcache = mesh(merged);
+    for (auto *bridges : {&m_bridges, &m_crossbridges})
+        for (auto &bs : *bridges)
+            m_primitives.emplace_back(SupportPrimitive::discs(
+                bs.startp, bs.r, bs.endp, bs.r, bs.steps));
     
     // The mesh will be passed by const-pointer to TriangleMeshSlicer,
     // which will need this.
@@ -505,6 +607,15 @@ const TriangleMesh &SupportTreeBuilder::merge_and_cleanup()
     return ret;
 }
 
+std::vector<ExPolygons> SupportTreeBuilder::slice_supports(
+    const std::vector<float> &grid, float closing_radius) const
+{
+    // Makes sure the analytic description is up to date.
+    merged_mesh();
+    
+    return sla::slice(m_primitives, grid, closing_radius, ctl().cancelfn);
+}
+
 const TriangleMesh &SupportTreeBuilder::retrieve_mesh(MeshType meshtype) const
 {
     switch(meshtype) {
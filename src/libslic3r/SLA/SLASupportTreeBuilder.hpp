@@ -5,6 +5,7 @@
 #include "SLABoilerPlate.hpp"
 #include "SLASupportTree.hpp"
 #include "SLAPad.hpp"
+#include "SLASupportTreeSlicer.hpp"
 #include <libslic3r/MTUtils.hpp>
 
 namespace Slic3r {
@@ -175,6 +176,10 @@ struct Pillar {
     // How many pillars are cascaded with this one
     unsigned links = 0;
     
+    // The cone shaped base, if added
+    double base_height = 0;
+    double base_r = 0;
+    
     Pillar(const Vec3d& jp, const Vec3d& endp,
            double radius = 1, size_t st = 45);
     
@@ -201,6 +206,7 @@ struct Pillar {
 struct Bridge {
     Contour3D mesh;
     double r = 0.8;
+    size_t steps = 45;
     long id = ID_UNSET;
     Vec3d startp = Vec3d::Zero(), endp = Vec3d::Zero();
     
@@ -214,7 +220,12 @@ struct Bridge {
 // edges on the endpoints. Used for headless support points.
 struct CompactBridge {
     Contour3D mesh;
+    double r = 0.8;
+    size_t steps = 45;
+    bool endball = true;
     long id = ID_UNSET;
+    // The end points of the stick, the balls are centered in them
+    Vec3d startp = Vec3d::Zero(), endp = Vec3d::Zero();
     
     CompactBridge(const Vec3d& sp,
                   const Vec3d& ep,
@@ -232,11 +243,15 @@ struct Pad {
     
     Pad() = default;
     
-    Pad(const TriangleMesh &support_mesh,
-        const ExPolygons &  model_contours,
-        double              ground_level,
-        const PadConfig &   pcfg,
-        ThrowOnCancel       thr);
+    Pad(const ExPolygons &support_blueprint,
+        const ExPolygons &model_contours,
+        double            ground_level,
+        const PadConfig & pcfg,
+        ThrowOnCancel     thr);
+    
+    // The Z levels at which the support mesh is sampled for the blueprint
+    static std::vector<float> blueprint_heights(double           ground_level,
+                                                const PadConfig &pcfg);
     
     bool empty() const { return tmesh.facets_count() == 0; }
 };
@@ -269,10 +284,21 @@ class SupportTreeBuilder: public SupportTree {
     using Mutex = ccr::SpinningMutex;
     
     mutable TriangleMesh m_meshcache;
+    // Analytic description of the elements, it is valid together with the
+    // merged mesh and it is kept by merge_and_cleanup() to slice the supports.
+    mutable SupportPrimitives m_primitives;
     mutable Mutex m_mutex;
     mutable bool m_meshcache_valid = false;
     mutable double m_model_height = 0; // the full height of the model
     
+    // The blueprint of the supports for the pad along with the Z levels it
+    // was sampled at. It is invalidated together with the merged mesh, thus
+    // changing only the pad parameters will not slice the supports again.
+    mutable ExPolygons m_pad_blueprint;
+    mutable std::vector<float> m_pad_blueprint_heights;
+    
+    const ExPolygons &support_pad_blueprint(const std::vector<float> &heights) const;
+    
     template<class...Args>
     const Bridge& _add_bridge(std::vector<Bridge> &br, Args&&... args)
     {
@@ -489,6 +515,11 @@ public:
         MeshType meshtype = MeshType::Support) const override;
 
     bool build(const SupportableMesh &supportable_mesh);
+    
+protected:
+    // Slices the elements analytically instead of slicing the merged mesh.
+    std::vector<ExPolygons> slice_supports(const std::vector<float> &grid,
+                                           float closing_radius) const override;
 };
 
 }} // namespace Slic3r::sla
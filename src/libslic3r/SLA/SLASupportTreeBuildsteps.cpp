@@ -3,6 +3,7 @@
 #include <libnest2d/optimizers/nlopt/genetic.hpp>
 #include <libnest2d/optimizers/nlopt/subplex.hpp>
 #include <boost/log/trivial.hpp>
+#include <boost/functional/hash.hpp>
 
 namespace Slic3r {
 namespace sla {
@@ -12,6 +13,7 @@ SupportTreeBuildsteps::SupportTreeBuildsteps(SupportTreeBuilder &   builder,
     : m_cfg(sm.cfg)
     , m_mesh(sm.emesh)
     , m_support_pts(sm.pts)
+    , m_head_cache(sm.head_cache)
     , m_support_nmls(sm.pts.size(), 3)
     , m_builder(builder)
     , m_points(sm.pts.size(), 3)
@@ -213,62 +215,72 @@ EigenMesh3D::hit_result SupportTreeBuildsteps::pinhead_mesh_intersect(
     // Now a and b vectors are perpendicular to v and to each other.
     // Together they define the plane where we have to iterate with the
     // given angles in the 'phis' vector
-    ccr::enumerate(
-        phis.begin(), phis.end(),
-        [&hits, &m, sd, r_pin, r_back, s, a, b, c](double phi, size_t i) {
-           double sinphi = std::sin(phi);
-           double cosphi = std::cos(phi);
-        
-           // Let's have a safety coefficient for the radiuses.
-           double rpscos = (sd + r_pin) * cosphi;
-           double rpssin = (sd + r_pin) * sinphi;
-           double rpbcos = (sd + r_back) * cosphi;
-           double rpbsin = (sd + r_back) * sinphi;
-        
-           // Point on the circle on the pin sphere
-           Vec3d ps(s(X) + rpscos * a(X) + rpssin * b(X),
-                    s(Y) + rpscos * a(Y) + rpssin * b(Y),
-                    s(Z) + rpscos * a(Z) + rpssin * b(Z));
-        
-           // Point ps is not on mesh but can be inside or
-           // outside as well. This would cause many problems
-           // with ray-casting. To detect the position we will
-           // use the ray-casting result (which has an is_inside
-           // predicate).
-        
-           // This is the point on the circle on the back sphere
-           Vec3d p(c(X) + rpbcos * a(X) + rpbsin * b(X),
-                   c(Y) + rpbcos * a(Y) + rpbsin * b(Y),
-                   c(Z) + rpbcos * a(Z) + rpbsin * b(Z));
-        
-           Vec3d n = (p - ps).normalized();
-           auto  q = m.query_ray_hit(ps + sd * n, n);
-        
-           if (q.is_inside()) { // the hit is inside the model
-               if (q.distance() > r_pin + sd) {
-                   // If we are inside the model and the hit
-                   // distance is bigger than our pin circle
-                   // diameter, it probably indicates that the
-                   // support point was already inside the
-                   // model, or there is really no space
-                   // around the point. We will assign a zero
-                   // hit distance to these cases which will
-                   // enforce the function return value to be
-                   // an invalid ray with zero hit distance.
-                   // (see min_element at the end)
-                   hits[i] = HitResult(0.0);
-               } else {
-                   // re-cast the ray from the outside of the
-                   // object. The starting point has an offset
-                   // of 2*safety_distance because the
-                   // original ray has also had an offset
-                   auto q2 = m.query_ray_hit(
-                       ps + (q.distance() + 2 * sd) * n, n);
-                   hits[i] = q2;
-               }
-           } else
-               hits[i] = q;
-        });
+    std::array<Vec3d, SAMPLES> pins;
+    std::vector<Vec3d> sources(SAMPLES), dirs(SAMPLES);
+    for (size_t i = 0; i < SAMPLES; ++i) {
+        double sinphi = std::sin(phis[i]);
+        double cosphi = std::cos(phis[i]);
+
+        // Let's have a safety coefficient for the radiuses.
+        double rpscos = (sd + r_pin) * cosphi;
+        double rpssin = (sd + r_pin) * sinphi;
+        double rpbcos = (sd + r_back) * cosphi;
+        double rpbsin = (sd + r_back) * sinphi;
+
+        // Point on the circle on the pin sphere
+        Vec3d ps(s(X) + rpscos * a(X) + rpssin * b(X),
+                 s(Y) + rpscos * a(Y) + rpssin * b(Y),
+                 s(Z) + rpscos * a(Z) + rpssin * b(Z));
+
+        // Point ps is not on mesh but can be inside or
+        // outside as well. This would cause many problems
+        // with ray-casting. To detect the position we will
+        // use the ray-casting result (which has an is_inside
+        // predicate).
+
+        // This is the point on the circle on the back sphere
+        Vec3d p(c(X) + rpbcos * a(X) + rpbsin * b(X),
+                c(Y) + rpbcos * a(Y) + rpbsin * b(Y),
+                c(Z) + rpbcos * a(Z) + rpbsin * b(Z));
+
+        Vec3d n = (p - ps).normalized();
+        pins[i]    = ps;
+        sources[i] = ps + sd * n;
+        dirs[i]    = n;
+    }
+
+    // The rays are nearly parallel, cast them together.
+    std::vector<HitResult> q = m.query_ray_hits(sources, dirs);
+
+    for (size_t i = 0; i < SAMPLES; ++i) {
+        const Vec3d &n = dirs[i];
+        const Vec3d &ps = pins[i];
+
+        if (q[i].is_inside()) { // the hit is inside the model
+            if (q[i].distance() > r_pin + sd) {
+                // If we are inside the model and the hit
+                // distance is bigger than our pin circle
+                // diameter, it probably indicates that the
+                // support point was already inside the
+                // model, or there is really no space
+                // around the point. We will assign a zero
+                // hit distance to these cases which will
+                // enforce the function return value to be
+                // an invalid ray with zero hit distance.
+                // (see min_element at the end)
+                hits[i] = HitResult(0.0);
+            } else {
+                // re-cast the ray from the outside of the
+                // object. The starting point has an offset
+                // of 2*safety_distance because the
+                // original ray has also had an offset
+                auto q2 = m.query_ray_hit(
+                    ps + (q[i].distance() + 2 * sd) * n, n);
+                hits[i] = q2;
+            }
+        } else
+            hits[i] = q[i];
+    }
 
     auto mit = std::min_element(hits.begin(), hits.end());
     
@@ -310,35 +322,42 @@ EigenMesh3D::hit_result SupportTreeBuildsteps::bridge_mesh_intersect(
     // Hit results
     std::array<HitResult, SAMPLES> hits;
     
-    ccr::enumerate(
-        phis.begin(), phis.end(),
-        [&m, a, b, sd, dir, r, s, ins_check, &hits] (double phi, size_t i) {
-            double sinphi = std::sin(phi);
-            double cosphi = std::cos(phi);
-            
-            // Let's have a safety coefficient for the radiuses.
-            double rcos = (sd + r) * cosphi;
-            double rsin = (sd + r) * sinphi;
-            
-            // Point on the circle on the pin sphere
-            Vec3d p (s(X) + rcos * a(X) + rsin * b(X),
-                    s(Y) + rcos * a(Y) + rsin * b(Y),
-                    s(Z) + rcos * a(Z) + rsin * b(Z));
-            
-            auto hr = m.query_ray_hit(p + sd*dir, dir);
-            
-            if(ins_check && hr.is_inside()) {
-                if(hr.distance() > 2 * r + sd) hits[i] = HitResult(0.0);
-                else {
-                    // re-cast the ray from the outside of the object
-                    auto hr2 =
-                        m.query_ray_hit(p + (hr.distance() + 2*sd)*dir, dir);
-                    
-                    hits[i] = hr2;
-                }
-            } else hits[i] = hr;
-        });
-    
+    std::array<Vec3d, SAMPLES> points;
+    std::vector<Vec3d> sources(SAMPLES), dirs(SAMPLES, dir);
+    for (size_t i = 0; i < SAMPLES; ++i) {
+        double sinphi = std::sin(phis[i]);
+        double cosphi = std::cos(phis[i]);
+
+        // Let's have a safety coefficient for the radiuses.
+        double rcos = (sd + r) * cosphi;
+        double rsin = (sd + r) * sinphi;
+
+        // Point on the circle on the pin sphere
+        Vec3d p (s(X) + rcos * a(X) + rsin * b(X),
+                 s(Y) + rcos * a(Y) + rsin * b(Y),
+                 s(Z) + rcos * a(Z) + rsin * b(Z));
+
+        points[i]  = p;
+        sources[i] = p + sd*dir;
+    }
+
+    // The rays are parallel, cast them together.
+    std::vector<HitResult> hr = m.query_ray_hits(sources, dirs);
+
+    for (size_t i = 0; i < SAMPLES; ++i) {
+        if(ins_check && hr[i].is_inside()) {
+            if(hr[i].distance() > 2 * r + sd) hits[i] = HitResult(0.0);
+            else {
+                // re-cast the ray from the outside of the object
+                const Vec3d &p = points[i];
+                auto hr2 =
+                    m.query_ray_hit(p + (hr[i].distance() + 2*sd)*dir, dir);
+
+                hits[i] = hr2;
+            }
+        } else hits[i] = hr[i];
+    }
+
     auto mit = std::min_element(hits.begin(), hits.end());
     
     return *mit;
@@ -555,19 +574,24 @@ bool SupportTreeBuildsteps::search_pillar_and_connect(const Head &head)
     return nearest_id >= 0;
 }
 
-void SupportTreeBuildsteps::create_ground_pillar(const Vec3d &jp,
-                                                 const Vec3d &sourcedir,
-                                                 double       radius,
-                                                 long         head_id)
+SupportTreeBuildsteps::GroundPillar
+SupportTreeBuildsteps::plan_ground_pillar(const Vec3d &jp,
+                                          const Vec3d &sourcedir,
+                                          double       radius,
+                                          long         head_id)
 {
     // People were killed for this number (seriously)
     static const double SQR2 = std::sqrt(2.0);
     static const Vec3d  DOWN = {0.0, 0.0, -1.0};
     
+    GroundPillar gp;
+    gp.jp      = jp;
+    gp.radius  = radius;
+    gp.head_id = head_id;
+
     double gndlvl       = m_builder.ground_level;
     Vec3d  endp         = {jp(X), jp(Y), gndlvl};
     double sd           = m_cfg.pillar_base_safety_distance_mm;
-    long   pillar_id    = ID_UNSET;
     double min_dist     = sd + m_cfg.base_radius_mm + EPSILON;
     double dist         = 0;
     bool   can_add_base = true;
@@ -629,36 +653,57 @@ void SupportTreeBuildsteps::create_ground_pillar(const Vec3d &jp,
                 auto hit = bridge_mesh_intersect(endp, DOWN, radius);
                 if (!std::isinf(hit.distance())) abort_in_shame();
                 
-                pillar_id = m_builder.add_pillar(endp, pgnd, radius);
-                
-                if (can_add_base)
-                    m_builder.add_pillar_base(pillar_id, m_cfg.base_height_mm,
-                                              m_cfg.base_radius_mm);
+                gp.side_pillar = true;
+                gp.pgnd        = pgnd;
             }
             
-            m_builder.add_bridge(jp, endp, radius);
-            m_builder.add_junction(endp, radius);
-            
-            // Add a degenerated pillar and the bridge.
-            // The degenerate pillar will have zero length and it will
-            // prevent from queries of head_pillar() to have non-existing
-            // pillar when the head should have one.
-            if (head_id >= 0)
-                m_builder.add_pillar(head_id, jp, radius);
+            // The bridge to endp will be added with a degenerated pillar.
+            gp.bridged = true;
+        }
+    }
+
+    gp.endp         = endp;
+    gp.normal_mode  = normal_mode;
+    gp.can_add_base = can_add_base;
+
+    return gp;
+}
+
+void SupportTreeBuildsteps::add_ground_pillar(const GroundPillar &gp)
+{
+    long pillar_id = ID_UNSET;
+
+    if (gp.bridged) {
+        if (gp.side_pillar) {
+            pillar_id = m_builder.add_pillar(gp.endp, gp.pgnd, gp.radius);
+
+            if (gp.can_add_base)
+                m_builder.add_pillar_base(pillar_id, m_cfg.base_height_mm,
+                                          m_cfg.base_radius_mm);
         }
+
+        m_builder.add_bridge(gp.jp, gp.endp, gp.radius);
+        m_builder.add_junction(gp.endp, gp.radius);
+
+        // Add a degenerated pillar and the bridge.
+        // The degenerate pillar will have zero length and it will
+        // prevent from queries of head_pillar() to have non-existing
+        // pillar when the head should have one.
+        if (gp.head_id >= 0)
+            m_builder.add_pillar(gp.head_id, gp.jp, gp.radius);
     }
     
-    if (normal_mode) {
-        pillar_id = head_id >= 0 ? m_builder.add_pillar(head_id, endp, radius) :
-                                   m_builder.add_pillar(jp, endp, radius);
+    if (gp.normal_mode) {
+        pillar_id = gp.head_id >= 0 ? m_builder.add_pillar(gp.head_id, gp.endp, gp.radius) :
+                                      m_builder.add_pillar(gp.jp, gp.endp, gp.radius);
 
-        if (can_add_base)
+        if (gp.can_add_base)
             m_builder.add_pillar_base(pillar_id, m_cfg.base_height_mm,
                                       m_cfg.base_radius_mm);
     }
     
     if(pillar_id >= 0) // Save the pillar endpoint in the spatial index
-        m_pillar_index.guarded_insert(endp, unsigned(pillar_id));
+        m_pillar_index.guarded_insert(gp.endp, unsigned(pillar_id));
 }
 
 void SupportTreeBuildsteps::filter()
@@ -676,9 +721,58 @@ void SupportTreeBuildsteps::filter()
         filtered_indices.emplace_back(a.front());
     }
     
+    using HeadResult = SupportHeadCache::Result;
+    using HeadEntry  = SupportHeadCache::Entry;
+    
+    auto applyfn = [this](unsigned fidx, const HeadEntry &e) {
+        m_support_nmls.row(fidx) = e.normal;
+        switch (e.result) {
+        case HeadResult::Head:     m_iheads.emplace_back(fidx); break;
+        case HeadResult::Headless: m_iheadless.emplace_back(fidx); break;
+        case HeadResult::Dropped:  break;
+        }
+    };
+    
+    // The points not edited since the previous build will end up the same
+    // way, only the new points have to be tested against the mesh.
+    SupportHeadCache *cache = m_head_cache.get();
+    if (cache) {
+        size_t params_hash = 0;
+        boost::hash_combine(params_hash, m_mesh.V().rows());
+        boost::hash_combine(params_hash, m_mesh.F().rows());
+        boost::hash_combine(params_hash, m_builder.ground_level);
+        boost::hash_combine(params_hash, m_cfg.head_front_radius_mm);
+        boost::hash_combine(params_hash, m_cfg.head_back_radius_mm);
+        boost::hash_combine(params_hash, m_cfg.head_width_mm);
+        if (params_hash != cache->params_hash) {
+            cache->entries.clear();
+            cache->params_hash = params_hash;
+        }
+    }
+    
+    PtIndices to_filter;
+    std::vector<std::pair<unsigned, HeadEntry>> cached;
+    if (cache) {
+        to_filter.reserve(filtered_indices.size());
+        cached.reserve(filtered_indices.size());
+        for (unsigned fidx : filtered_indices) {
+            auto it = cache->entries.find(SupportHeadCache::key(m_support_pts[fidx]));
+            if (it == cache->entries.end())
+                to_filter.emplace_back(fidx);
+            else
+                cached.emplace_back(fidx, it->second);
+        }
+    } else
+        to_filter = filtered_indices;
+    
+    BOOST_LOG_TRIVIAL(debug) << "Support points filtered: " << to_filter.size()
+                             << ", reused: " << cached.size();
+    
     // calculate the normals to the triangles for filtered points
-    auto nmls = sla::normals(m_points, m_mesh, m_cfg.head_front_radius_mm,
-                             m_thr, filtered_indices);
+    PointSet nmls;
+    if (! to_filter.empty())
+        nmls = sla::normals(m_points, m_mesh, m_cfg.head_front_radius_mm,
+                            m_thr, to_filter);
     
     // Not all of the support points have to be a valid position for
     // support creation. The angle may be inappropriate or there may
@@ -690,16 +784,13 @@ void SupportTreeBuildsteps::filter()
     using libnest2d::opt::GeneticOptimizer;
     using libnest2d::opt::StopCriteria;
     
-    ccr::SpinningMutex mutex;
-    auto addfn = [&mutex](PtIndices &container, unsigned val) {
-        std::lock_guard<ccr::SpinningMutex> lk(mutex);
-        container.emplace_back(val);
-    };
+    std::vector<HeadEntry> results(to_filter.size());
     
-    auto filterfn = [this, &nmls, addfn](unsigned fidx, size_t i) {
+    auto filterfn = [this, &nmls, &results](unsigned fidx, size_t i) {
         m_thr();
         
         auto n = nmls.row(Eigen::Index(i));
+        HeadEntry &result = results[i];
         
         // for all normals we generate the spherical coordinates and
         // saturate the polar angle to 45 degrees from the bottom then
@@ -783,27 +874,52 @@ void SupportTreeBuildsteps::filter()
             }
             
             // save the verified and corrected normal
-            m_support_nmls.row(fidx) = nn;
+            result.normal = nn;
             
             if (t.distance() > w) {
                 // Check distance from ground, we might have zero elevation.
                 if (hp(Z) + w * nn(Z) < m_builder.ground_level) {
-                    addfn(m_iheadless, fidx);
+                    result.result = HeadResult::Headless;
                 } else {
                     // mark the point for needing a head.
-                    addfn(m_iheads, fidx);
+                    result.result = HeadResult::Head;
                 }
             } else if (polar >= 3 * PI / 4) {
                 // Headless supports do not tilt like the headed ones
                 // so the normal should point almost to the ground.
-                addfn(m_iheadless, fidx);
+                result.result = HeadResult::Headless;
             }
         }
     };
     
-    ccr::enumerate(filtered_indices.begin(), filtered_indices.end(), filterfn);
+    ccr::enumerate(to_filter.begin(), to_filter.end(), filterfn);
     
     m_thr();
+    
+    for (const std::pair<unsigned, HeadEntry> &c : cached)
+        applyfn(c.first, c.second);
+    for (size_t i = 0; i < to_filter.size(); ++ i)
+        applyfn(to_filter[i], results[i]);
+    
+    if (cache) {
+        // Keep the entries of the current points only, the removed points
+        // are not likely to come back.
+        decltype(cache->entries) entries;
+        entries.reserve(filtered_indices.size());
+        for (const std::pair<unsigned, HeadEntry> &c : cached)
+            entries.emplace(SupportHeadCache::key(m_support_pts[c.first]), c.second);
+        for (size_t i = 0; i < to_filter.size(); ++ i)
+            entries.emplace(SupportHeadCache::key(m_support_pts[to_filter[i]]), results[i]);
+        cache->entries = std::move(entries);
+    }
+}
+
+size_t SupportHeadCache::KeyHash::operator()(const Key &key) const
+{
+    size_t seed = 0;
+    for (float v : key)
+        boost::hash_combine(seed, v);
+    return seed;
 }
 
 void SupportTreeBuildsteps::add_pinheads()
@@ -877,7 +993,16 @@ void SupportTreeBuildsteps::routing_to_ground()
     ClusterEl cl_centroids;
     cl_centroids.reserve(m_pillar_clusters.size());
     
-    for (auto &cl : m_pillar_clusters) {
+    // The ground pillars of the cluster centroids only depend on the mesh,
+    // not on each other. They are planned in parallel and then added in
+    // the order of the clusters, thus the pillar IDs and the whole tree
+    // are the same as if routed sequentially.
+    std::vector<long> centroids(m_pillar_clusters.size(), ID_UNSET);
+    std::vector<GroundPillar> centroid_pillars(m_pillar_clusters.size());
+    
+    ccr::enumerate(m_pillar_clusters.begin(), m_pillar_clusters.end(),
+                   [this, &centroids, &centroid_pillars](const PtIndices &cl, size_t ci)
+    {
         m_thr();
         
         // place all the centroid head positions into the index. We
@@ -888,7 +1013,7 @@ void SupportTreeBuildsteps::routing_to_ground()
         // sidehead is allowed to connect to a nearby pillar to
         // increase structural stability.
         
-        if (cl.empty()) continue;
+        if (cl.empty()) return;
         
         // get the current cluster centroid
         auto &      thr    = m_thr;
@@ -903,12 +1028,18 @@ void SupportTreeBuildsteps::routing_to_ground()
         assert(lcid >= 0);
         unsigned hid = cl[size_t(lcid)]; // Head ID
         
-        cl_centroids.emplace_back(hid);
+        centroids[ci] = long(hid);
         
         Head &h = m_builder.head(hid);
         h.transform();
         
-        create_ground_pillar(h.junction_point(), h.dir, h.r_back_mm, h.id);
+        centroid_pillars[ci] = plan_ground_pillar(h.junction_point(), h.dir, h.r_back_mm, h.id);
+    });
+    
+    for (size_t ci = 0; ci < centroids.size(); ++ci) {
+        if (centroids[ci] < 0) continue;
+        cl_centroids.emplace_back(unsigned(centroids[ci]));
+        add_ground_pillar(centroid_pillars[ci]);
     }
     
     // now we will go through the clusters ones again and connect the
@@ -146,6 +146,7 @@ class SupportTreeBuildsteps {
     const SupportConfig& m_cfg;
     const EigenMesh3D& m_mesh;
     const std::vector<SupportPoint>& m_support_pts;
+    std::shared_ptr<SupportHeadCache> m_head_cache;
 
     using PtIndices = std::vector<unsigned>;
 
@@ -225,12 +226,36 @@ class SupportTreeBuildsteps {
 
     bool search_pillar_and_connect(const Head& head);
 
+    // The elements of a ground pillar as decided by plan_ground_pillar(),
+    // to be added to the builder by add_ground_pillar().
+    struct GroundPillar {
+        Vec3d jp, endp, pgnd;
+        double radius = 0;
+        long head_id = ID_UNSET;
+        bool bridged = false;       // bridge from jp to endp, see the zero elevation mode
+        bool side_pillar = false;   // pillar from endp to pgnd at the end of the bridge
+        bool normal_mode = true;    // pillar from jp directly down to endp
+        bool can_add_base = true;
+    };
+
+    // Find where the pillar can be placed. Only the mesh is queried, so
+    // the pillars of several heads can be planned in parallel.
+    GroundPillar plan_ground_pillar(const Vec3d &jp,
+                                    const Vec3d &sourcedir,
+                                    double       radius,
+                                    long         head_id = ID_UNSET);
+
+    void add_ground_pillar(const GroundPillar &gp);
+
     // This is a proxy function for pillar creation which will mind the gap
     // between the pad and the model bottom in zero elevation mode.
     void create_ground_pillar(const Vec3d &jp,
                               const Vec3d &sourcedir,
                               double       radius,
-                              long         head_id = ID_UNSET);
+                              long         head_id = ID_UNSET)
+    {
+        add_ground_pillar(plan_ground_pillar(jp, sourcedir, radius, head_id));
+    }
 public:
     SupportTreeBuildsteps(SupportTreeBuilder & builder, const SupportableMesh &sm);
 
@@ -21,6 +21,9 @@
 #include <igl/point_mesh_squared_distance.h>
 #include <igl/remove_duplicate_vertices.h>
 #include <igl/signed_distance.h>
+extern "C" {
+#include <igl/raytri.c>
+}
 #ifdef _MSC_VER
 #pragma warning(pop)
 #endif
@@ -226,6 +229,7 @@ EigenMesh3D::~EigenMesh3D() {}
 
 EigenMesh3D::EigenMesh3D(const EigenMesh3D &other):
     m_V(other.m_V), m_F(other.m_F), m_ground_level(other.m_ground_level),
+    m_gnd_offset(other.m_gnd_offset),
     m_aabb( new AABBImpl(*other.m_aabb) ) {}
 
 EigenMesh3D &EigenMesh3D::operator=(const EigenMesh3D &other)
@@ -233,15 +237,119 @@ EigenMesh3D &EigenMesh3D::operator=(const EigenMesh3D &other)
     m_V = other.m_V;
     m_F = other.m_F;
     m_ground_level = other.m_ground_level;
+    m_gnd_offset = other.m_gnd_offset;
     m_aabb.reset(new AABBImpl(*other.m_aabb)); return *this;
 }
 
+namespace {
+
+using AABBNode = igl::AABB<Eigen::MatrixXd, 3>;
+
+// Maximum number of rays traversing the tree together, one bit of the mask
+// of the active rays for each.
+static const size_t RAY_PACKET_SIZE = 64;
+
+// The same test as igl::ray_box_intersect() with t0 = 0 and t1 = max_t,
+// only the inverse of the ray direction is precomputed.
+inline bool ray_box_intersect(const Vec3d &s, const Vec3d &inv_dir,
+                              const Eigen::AlignedBox<double, 3> &box,
+                              double max_t)
+{
+    const Eigen::Vector3d &bmin = box.min(), &bmax = box.max();
+
+    double tmin  = ((inv_dir(X) < 0 ? bmax : bmin)(X) - s(X)) * inv_dir(X);
+    double tmax  = ((inv_dir(X) < 0 ? bmin : bmax)(X) - s(X)) * inv_dir(X);
+    double tymin = ((inv_dir(Y) < 0 ? bmax : bmin)(Y) - s(Y)) * inv_dir(Y);
+    double tymax = ((inv_dir(Y) < 0 ? bmin : bmax)(Y) - s(Y)) * inv_dir(Y);
+    if (tmin > tymax || tymin > tmax) return false;
+    if (tymin > tmin) tmin = tymin;
+    if (tymax < tmax) tmax = tymax;
+
+    double tzmin = ((inv_dir(Z) < 0 ? bmax : bmin)(Z) - s(Z)) * inv_dir(Z);
+    double tzmax = ((inv_dir(Z) < 0 ? bmin : bmax)(Z) - s(Z)) * inv_dir(Z);
+    if (tmin > tzmax || tzmin > tmax) return false;
+    if (tzmin > tmin) tmin = tzmin;
+    if (tzmax < tmax) tmax = tzmax;
+
+    return tmin < max_t && tmax > 0.;
+}
+
+// Cast up to RAY_PACKET_SIZE rays in a single depth first traversal of the
+// tree. Each ray visits the same nodes in the same order and ends up with
+// the same hit as if cast alone by AABB::intersect_ray(), the rays only
+// share the visits of the nodes. Contrary to AABB::intersect_ray(), no
+// temporary is allocated at the leaves.
+void intersect_ray_packet(const AABBNode &       root,
+                          const Eigen::MatrixXd &V,
+                          const Eigen::MatrixXi &F,
+                          const Vec3d *          sources,
+                          const Vec3d *          dirs,
+                          size_t                 n,
+                          igl::Hit *             hits)
+{
+    assert(n <= RAY_PACKET_SIZE);
+
+    std::array<Vec3d, RAY_PACKET_SIZE> inv_dirs;
+    for (size_t i = 0; i < n; ++ i) {
+        inv_dirs[i] = dirs[i].cwiseInverse();
+        hits[i].id  = -1;
+        hits[i].gid = -1;
+        hits[i].u = hits[i].v = 0.f;
+        hits[i].t   = std::numeric_limits<float>::infinity();
+    }
+
+    if (F.rows() == 0) return;
+
+    // AABB::init() splits the elements into halves, the depth of the tree
+    // is logarithmic and the traversal stack holds at most one node per level.
+    std::array<std::pair<const AABBNode*, uint64_t>, 128> stack;
+    size_t stack_size = 0;
+    stack[stack_size ++] = { &root, n == RAY_PACKET_SIZE ? ~uint64_t(0) : (uint64_t(1) << n) - 1 };
+
+    while (stack_size > 0) {
+        const AABBNode *node = stack[-- stack_size].first;
+        uint64_t        mask = stack[stack_size].second;
+
+        uint64_t active = 0;
+        for (size_t i = 0; i < n; ++ i)
+            if (((mask >> i) & 1) &&
+                ray_box_intersect(sources[i], inv_dirs[i], node->m_box, double(hits[i].t)))
+                active |= uint64_t(1) << i;
+
+        if (active == 0) continue;
+
+        if (node->is_leaf()) {
+            double vert[3][3];
+            for (int k = 0; k < 3; ++ k)
+                for (int c = 0; c < 3; ++ c)
+                    vert[k][c] = V(F(node->m_primitive, k), c);
+
+            for (size_t i = 0; i < n; ++ i) {
+                if (! ((active >> i) & 1)) continue;
+                double s[3] = { sources[i](X), sources[i](Y), sources[i](Z) };
+                double d[3] = { dirs[i](X), dirs[i](Y), dirs[i](Z) };
+                double t, u, v;
+                if (intersect_triangle1(s, d, vert[0], vert[1], vert[2], &t, &u, &v) &&
+                    t > 0 && float(t) < hits[i].t)
+                    hits[i] = { node->m_primitive, -1, float(u), float(v), float(t) };
+            }
+        } else {
+            // Visit the left child first as AABB::intersect_ray() does, to
+            // keep the same hit on equal distances.
+            assert(stack_size + 2 <= stack.size());
+            stack[stack_size ++] = { node->m_right, active };
+            stack[stack_size ++] = { node->m_left, active };
+        }
+    }
+}
+
+}
+
 EigenMesh3D::hit_result
 EigenMesh3D::query_ray_hit(const Vec3d &s, const Vec3d &dir) const
 {
     igl::Hit hit;
-    hit.t = std::numeric_limits<float>::infinity();
-    m_aabb->intersect_ray(m_V, m_F, s, dir, hit);
+    intersect_ray_packet(*m_aabb, m_V, m_F, &s, &dir, 1, &hit);
 
     hit_result ret(*this);
     ret.m_t = double(hit.t);
@@ -252,6 +360,31 @@ EigenMesh3D::query_ray_hit(const Vec3d &s, const Vec3d &dir) const
     return ret;
 }
 
+std::vector<EigenMesh3D::hit_result>
+EigenMesh3D::query_ray_hits(const std::vector<Vec3d> &sources,
+                            const std::vector<Vec3d> &dirs) const
+{
+    assert(sources.size() == dirs.size());
+
+    std::vector<hit_result> ret(sources.size(), hit_result(*this));
+    std::array<igl::Hit, RAY_PACKET_SIZE> hits;
+
+    for (size_t from = 0; from < sources.size(); from += RAY_PACKET_SIZE) {
+        size_t n = std::min(RAY_PACKET_SIZE, sources.size() - from);
+        intersect_ray_packet(*m_aabb, m_V, m_F, &sources[from], &dirs[from], n, hits.data());
+
+        for (size_t i = 0; i < n; ++ i) {
+            hit_result &r = ret[from + i];
+            r.m_t = double(hits[i].t);
+            r.m_dir = dirs[from + i];
+            r.m_source = sources[from + i];
+            if(!std::isinf(hits[i].t) && !std::isnan(hits[i].t)) r.m_face_id = hits[i].id;
+        }
+    }
+
+    return ret;
+}
+
 #ifdef SLIC3R_SLA_NEEDS_WINDTREE
 EigenMesh3D::si_result EigenMesh3D::signed_distance(const Vec3d &p) const {
     double sign = 0; double sqdst = 0; int i = 0;  Vec3d c;
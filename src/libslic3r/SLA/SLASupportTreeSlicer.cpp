@@ -0,0 +1,231 @@
+#include "SLASupportTreeSlicer.hpp"
+#include "SLAConcurrency.hpp"
+
+#include <libslic3r/ClipperUtils.hpp>
+#include <libslic3r/Geometry.hpp>
+#include <libslic3r/MTUtils.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace Slic3r {
+namespace sla {
+
+// The number of sections of the end shapes sampled along the axis of an
+// element. The convex hull of the sampled sections approximates the section
+// of the element.
+static const size_t AXIS_SAMPLES = 16;
+
+// Horizontal component of the unit axis, below which the element is taken
+// as vertical.
+static const double VERTICAL_TOLERANCE = 1e-6;
+
+namespace {
+
+// Restrict the parameter range [ta, tb] to where the linear function going
+// from f0 at t = 0 to f1 at t = 1 is not negative.
+bool clip_nonnegative(double f0, double f1, double &ta, double &tb)
+{
+    if (f0 < 0. && f1 < 0.) return false;
+    if (f0 < 0.)      ta = std::max(ta, f0 / (f0 - f1));
+    else if (f1 < 0.) tb = std::min(tb, f0 / (f0 - f1));
+    return ta <= tb;
+}
+
+// Restrict the parameter range [ta, tb] to where |d(t)| <= r(t), both
+// linearly interpolated between their values at t = 0 and t = 1.
+bool clip_distance(double d0, double d1, double r0, double r1,
+                   double &ta, double &tb)
+{
+    return clip_nonnegative(r0 - d0, r1 - d1, ta, tb) &&
+           clip_nonnegative(r0 + d0, r1 + d1, ta, tb);
+}
+
+// Counter-clockwise circle with the vertices placed the same way as the
+// vertices of the element meshes.
+void append_circle(Points &pts, const Vec2d &c, double r, size_t steps)
+{
+    double a = 2 * PI / double(steps);
+    for (size_t i = 0; i < steps; ++i) {
+        double phi = double(i) * a;
+        pts.emplace_back(scaled(c(X) + r * std::cos(phi)),
+                         scaled(c(Y) + r * std::sin(phi)));
+    }
+}
+
+Polygon circle(const Vec2d &c, double r, size_t steps)
+{
+    Polygon ret;
+    if (r > EPSILON) append_circle(ret.points, c, r, steps);
+    return ret;
+}
+
+Polygon slice_balls(const SupportPrimitive &p, double z)
+{
+    double ta = 0., tb = 1.;
+    if (!clip_distance(p.c1(Z) - z, p.c2(Z) - z, p.r1, p.r2, ta, tb))
+        return {};
+
+    Vec3d dc = p.c2 - p.c1;
+    double dr = p.r2 - p.r1;
+
+    // The squared radius of the section of the ball at t.
+    auto rho2 = [&p, &dc, dr, z](double t) {
+        double r = p.r1 + dr * t;
+        double d = p.c1(Z) + dc(Z) * t - z;
+        return r * r - d * d;
+    };
+
+    if (dc.head<2>().norm() < EPSILON) {
+        // The sections are concentric, take the largest one. The squared
+        // radius is quadratic in t.
+        double a = dr * dr - dc(Z) * dc(Z);
+        double b = p.r1 * dr - (p.c1(Z) - z) * dc(Z);
+        double r2 = std::max(rho2(ta), rho2(tb));
+        if (a < 0.) {
+            double t = -b / a;
+            if (t > ta && t < tb) r2 = std::max(r2, rho2(t));
+        }
+        return circle(p.c1.head<2>(), std::sqrt(std::max(r2, 0.)), p.steps);
+    }
+
+    Points pts;
+    pts.reserve((AXIS_SAMPLES + 1) * p.steps);
+    for (size_t k = 0; k <= AXIS_SAMPLES; ++k) {
+        double t = ta + (tb - ta) * double(k) / double(AXIS_SAMPLES);
+        double r = std::sqrt(std::max(rho2(t), 0.));
+        if (r > EPSILON)
+            append_circle(pts, (p.c1 + dc * t).head<2>(), r, p.steps);
+    }
+
+    return pts.size() < 3 ? Polygon() : Geometry::convex_hull(std::move(pts));
+}
+
+Polygon slice_discs(const SupportPrimitive &p, double z)
+{
+    Vec3d  axis = p.c2 - p.c1;
+    double len  = axis.norm();
+    if (len < EPSILON) return {};
+
+    Vec3d  a  = axis / len;
+    double nh = a.head<2>().norm();
+    double dr = p.r2 - p.r1;
+
+    if (nh < VERTICAL_TOLERANCE) {
+        // Horizontal discs, the section is one of them.
+        double t = (z - p.c1(Z)) / axis(Z);
+        if (t < 0. || t > 1.) return {};
+        return circle((p.c1 + axis * t).head<2>(), p.r1 + dr * t, p.steps);
+    }
+
+    // The disc at t intersects the plane if the distance of its center from
+    // the plane does not exceed the vertical extent of the disc.
+    double ta = 0., tb = 1.;
+    if (!clip_distance(p.c1(Z) - z, p.c2(Z) - z, p.r1 * nh, p.r2 * nh, ta, tb))
+        return {};
+
+    // e1 is horizontal, the disc at t is c(t) + u * e1 + v * e2, where
+    // u^2 + v^2 <= r(t)^2. The plane cuts it in a segment of constant v.
+    Vec3d e1 = Vec3d(a(Y), -a(X), 0.) / nh;
+    Vec3d e2 = a.cross(e1);
+
+    Points pts;
+    pts.reserve(2 * (AXIS_SAMPLES + 1));
+    for (size_t k = 0; k <= AXIS_SAMPLES; ++k) {
+        double t = ta + (tb - ta) * double(k) / double(AXIS_SAMPLES);
+        Vec3d  c = p.c1 + axis * t;
+        double r = p.r1 + dr * t;
+        double v = (z - c(Z)) / e2(Z);
+        double u = std::sqrt(std::max(r * r - v * v, 0.));
+        Vec3d  m = c + v * e2;
+        Vec3d  s1 = m - u * e1, s2 = m + u * e1;
+        pts.emplace_back(scaled(s1(X)), scaled(s1(Y)));
+        pts.emplace_back(scaled(s2(X)), scaled(s2(Y)));
+    }
+
+    return Geometry::convex_hull(std::move(pts));
+}
+
+// Vertical extent of the end shape of the element with the given radius.
+double end_extent(const SupportPrimitive &p, double r)
+{
+    if (p.type == SupportPrimitive::Balls) return r;
+
+    Vec3d axis = p.c2 - p.c1;
+    double len = axis.norm();
+    return len < EPSILON ? r : r * axis.head<2>().norm() / len;
+}
+
+} // namespace
+
+double SupportPrimitive::min_z() const
+{
+    double z = std::min(c1(Z) - end_extent(*this, r1),
+                        c2(Z) - end_extent(*this, r2));
+    return std::max(z, zmin);
+}
+
+double SupportPrimitive::max_z() const
+{
+    double z = std::max(c1(Z) + end_extent(*this, r1),
+                        c2(Z) + end_extent(*this, r2));
+    return std::min(z, zmax);
+}
+
+Polygon slice(const SupportPrimitive &primitive, double z)
+{
+    if (z < primitive.zmin || z > primitive.zmax) return {};
+
+    return primitive.type == SupportPrimitive::Balls ?
+               slice_balls(primitive, z) :
+               slice_discs(primitive, z);
+}
+
+std::vector<ExPolygons> slice(const SupportPrimitives &primitives,
+                              const std::vector<float> &grid,
+                              float closing_radius,
+                              ThrowOnCancel thr)
+{
+    // Distribute the elements into the layers they may intersect, the grid
+    // is sorted in ascending order.
+    std::vector<std::vector<unsigned>> layer_primitives(grid.size());
+    for (size_t i = 0; i < primitives.size(); ++i) {
+        const SupportPrimitive &p = primitives[i];
+        auto from = std::lower_bound(grid.begin(), grid.end(), p.min_z(),
+                                     [](float z, double v) { return z < v; });
+        auto to   = std::upper_bound(from, grid.end(), p.max_z(),
+                                     [](double v, float z) { return v < z; });
+        for (auto it = from; it != to; ++it)
+            layer_primitives[size_t(it - grid.begin())].emplace_back(unsigned(i));
+    }
+
+    std::vector<ExPolygons> slices(grid.size());
+    double safety_offset = scale_(closing_radius);
+
+    ccr::enumerate(grid.begin(), grid.end(),
+                   [&primitives, &layer_primitives, &slices, safety_offset, &thr]
+                   (float z, size_t layer_id)
+    {
+        thr();
+
+        const std::vector<unsigned> &ids = layer_primitives[layer_id];
+        Polygons sections;
+        sections.reserve(ids.size());
+        for (unsigned id : ids) {
+            Polygon section = slice(primitives[id], double(z));
+            if (!section.empty()) sections.emplace_back(std::move(section));
+        }
+
+        if (sections.empty()) return;
+
+        // Same as TriangleMeshSlicer::make_expolygons()
+        slices[layer_id] = safety_offset > 0 ?
+            offset2_ex(union_(sections, false), +safety_offset, -safety_offset) :
+            union_ex(sections, false);
+    });
+
+    return slices;
+}
+
+}
+}
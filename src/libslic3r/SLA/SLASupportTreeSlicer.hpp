@@ -0,0 +1,76 @@
+#ifndef SLASUPPORTTREESLICER_HPP
+#define SLASUPPORTTREESLICER_HPP
+
+#include <vector>
+#include <functional>
+#include <limits>
+
+#include <libslic3r/Point.hpp>
+#include <libslic3r/ExPolygon.hpp>
+
+namespace Slic3r {
+namespace sla {
+
+using ThrowOnCancel = std::function<void(void)>;
+
+// Analytic description of a support tree element, which allows to slice the
+// supports without slicing their triangle mesh. Each element is the convex
+// hull of two end shapes with linearly interpolated centers and radii. The
+// end shapes are either balls (heads, junctions) or flat discs perpendicular
+// to the axis connecting their centers (pillars, pillar bases, bridges).
+struct SupportPrimitive {
+    enum Type { Balls, Discs };
+
+    Type   type = Balls;
+    Vec3d  c1 = Vec3d::Zero(), c2 = Vec3d::Zero();
+    double r1 = 0., r2 = 0.;
+
+    // Number of edges of the circles the sections are composed of. The same
+    // number is used for the mesh of the element.
+    size_t steps = 45;
+
+    // The element may be cut by horizontal planes (the half balls of the
+    // compact bridges).
+    double zmin = -std::numeric_limits<double>::infinity();
+    double zmax = std::numeric_limits<double>::infinity();
+
+    static SupportPrimitive balls(const Vec3d &c1, double r1,
+                                  const Vec3d &c2, double r2, size_t steps)
+    {
+        SupportPrimitive p;
+        p.type = Balls;
+        p.c1 = c1; p.r1 = r1; p.c2 = c2; p.r2 = r2; p.steps = steps;
+        return p;
+    }
+
+    static SupportPrimitive discs(const Vec3d &c1, double r1,
+                                  const Vec3d &c2, double r2, size_t steps)
+    {
+        SupportPrimitive p = balls(c1, r1, c2, r2, steps);
+        p.type = Discs;
+        return p;
+    }
+
+    // The Z range of the element.
+    double min_z() const;
+    double max_z() const;
+};
+
+using SupportPrimitives = std::vector<SupportPrimitive>;
+
+// The convex section of a single element at the given height, empty if the
+// plane does not intersect the element.
+Polygon slice(const SupportPrimitive &primitive, double z);
+
+// Slice the elements at the given Z levels and unite the sections of each
+// layer, in parallel over the layers. The closing radius has the same meaning
+// as for TriangleMeshSlicer.
+std::vector<ExPolygons> slice(const SupportPrimitives &primitives,
+                              const std::vector<float> &grid,
+                              float closing_radius,
+                              ThrowOnCancel thr = [] {});
+
+}
+}
+
+#endif // SLASUPPORTTREESLICER_HPP
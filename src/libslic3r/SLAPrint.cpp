@@ -2,15 +2,19 @@
 #include "SLA/SLASupportTree.hpp"
 #include "SLA/SLAPad.hpp"
 #include "SLA/SLAAutoSupports.hpp"
+#include "SLA/SLAConcurrency.hpp"
 #include "ClipperUtils.hpp"
 #include "Geometry.hpp"
 #include "MTUtils.hpp"
+#include "Trace.hpp"
 
 #include <unordered_set>
 #include <numeric>
 
 #include <tbb/parallel_for.h>
+#include <tbb/task_scheduler_init.h>
 #include <boost/filesystem/path.hpp>
+#include <boost/functional/hash.hpp>
 #include <boost/log/trivial.hpp>
 
 // For geometry algorithms with native Clipper types (no copies and conversions)
@@ -36,15 +40,43 @@ class SLAPrintObject::SupportData : public sla::SupportableMesh
 {
 public:
     sla::SupportTree::UPtr         support_tree_ptr;   // the supports
-    std::vector<ExPolygons>        support_slices;     // sliced supports
+    sla::SliceStore                support_slices;     // sliced supports
     
-    inline SupportData(const TriangleMesh &t): sla::SupportableMesh{t, {}, {}} {}
+    inline SupportData(const TriangleMesh &t): sla::SupportableMesh{t, {}, {}}
+    {
+        // Reuse the filtered support points when only some of the points are
+        // edited and the supports are rebuilt.
+        head_cache = std::make_shared<sla::SupportHeadCache>();
+    }
     
     sla::SupportTree::UPtr &create_support_tree(const sla::JobController &ctl)
     {
         support_tree_ptr = sla::SupportTree::create(*this, ctl);
         return support_tree_ptr;
     }
+    
+    // The bottom silhouette of the model used for the pad. It depends only
+    // on the mesh and the sampled height range, so it is kept while the
+    // other pad parameters are changed.
+    const ExPolygons &model_pad_blueprint(const TriangleMesh &mesh,
+                                          float               height,
+                                          float               layer_height,
+                                          sla::ThrowOnCancel  thr)
+    {
+        if (height != m_model_pad_bp_height ||
+            layer_height != m_model_pad_bp_layer_height) {
+            m_model_pad_bp.clear();
+            sla::pad_blueprint(mesh, m_model_pad_bp, height, layer_height, thr);
+            m_model_pad_bp_height       = height;
+            m_model_pad_bp_layer_height = layer_height;
+        }
+        
+        return m_model_pad_bp;
+    }
+    
+private:
+    ExPolygons m_model_pad_bp;
+    float      m_model_pad_bp_height = -1.f, m_model_pad_bp_layer_height = -1.f;
 };
 
 namespace {
@@ -655,6 +687,46 @@ bool validate_pad(const TriangleMesh &pad, const sla::PadConfig &pcfg)
     return !pad.empty() || (pcfg.embed_object.enabled && !pcfg.embed_object.everywhere);
 }
 
+// Content hash of all the inputs of the support point generator
+size_t support_points_input_hash(const TriangleMesh &                mesh,
+                                 const std::vector<ExPolygons> &     slices,
+                                 const std::vector<float> &          heights,
+                                 const sla::SLAAutoSupports::Config &cfg)
+{
+    size_t seed = 0;
+
+    auto hash_points = [&seed](const Points &pts) {
+        boost::hash_combine(seed, pts.size());
+        for (const Point &p : pts) {
+            boost::hash_combine(seed, p.x());
+            boost::hash_combine(seed, p.y());
+        }
+    };
+
+    boost::hash_combine(seed, mesh.stl.facet_start.size());
+    for (const stl_facet &facet : mesh.stl.facet_start)
+        for (const stl_vertex &v : facet.vertex)
+            boost::hash_range(seed, v.data(), v.data() + 3);
+
+    boost::hash_combine(seed, slices.size());
+    for (const ExPolygons &slice : slices) {
+        boost::hash_combine(seed, slice.size());
+        for (const ExPolygon &expoly : slice) {
+            hash_points(expoly.contour.points);
+            boost::hash_combine(seed, expoly.holes.size());
+            for (const Polygon &hole : expoly.holes) hash_points(hole.points);
+        }
+    }
+
+    boost::hash_range(seed, heights.begin(), heights.end());
+
+    boost::hash_combine(seed, cfg.density_relative);
+    boost::hash_combine(seed, cfg.minimal_distance);
+    boost::hash_combine(seed, cfg.head_diameter);
+
+    return seed;
+}
+
 }
 
 std::string SLAPrint::validate() const
@@ -712,6 +784,27 @@ std::string SLAPrint::validate() const
     return "";
 }
 
+PrintMemoryStats SLAPrint::memory_stats() const
+{
+    PrintMemoryStats stats;
+    for (const SLAPrintObject *po : m_objects)
+        stats.add(po->memory_stats());
+
+    size_t merged = m_printer_input.capacity() * sizeof(PrintLayer);
+    for (const PrintLayer &layer : m_printer_input) {
+        merged += layer.slices().capacity() * sizeof(std::reference_wrapper<const SliceRecord>) +
+                  layer.transformed_slices().capacity() * sizeof(ClipperLib::Polygon);
+        for (const ClipperLib::Polygon &poly : layer.transformed_slices()) {
+            merged += poly.Contour.capacity() * sizeof(ClipperLib::IntPoint) + poly.Holes.capacity() * sizeof(ClipperLib::Path);
+            for (const ClipperLib::Path &hole : poly.Holes)
+                merged += hole.capacity() * sizeof(ClipperLib::IntPoint);
+        }
+    }
+    stats.add("merge_slices", merged);
+    stats.add("rasterize", m_printer ? m_printer->memsize() : 0);
+    return stats;
+}
+
 bool SLAPrint::invalidate_step(SLAPrintStep step)
 {
     bool invalidated = Inherited::invalidate_step(step);
@@ -802,25 +895,27 @@ void SLAPrint::process()
         TriangleMeshSlicer slicer(&mesh);
 
         po.m_model_slices.clear();
+        std::vector<ExPolygons> model_slices;
         slicer.slice(po.m_model_height_levels,
                      float(po.config().slice_closing_radius.value),
-                     &po.m_model_slices,
+                     &model_slices,
                      [this](){ throw_if_canceled(); });
 
         auto mit = slindex_it;
         double doffs = m_printer_config.absolute_correction.getFloat();
         coord_t clpr_offs = scaled(doffs);
         for(size_t id = 0;
-            id < po.m_model_slices.size() && mit != po.m_slice_index.end();
+            id < model_slices.size() && mit != po.m_slice_index.end();
             id++)
         {
             // We apply the printer correction offset here.
             if(clpr_offs != 0)
-                po.m_model_slices[id] =
-                        offset_ex(po.m_model_slices[id], float(clpr_offs));
+                model_slices[id] =
+                        offset_ex(model_slices[id], float(clpr_offs));
 
             mit->set_model_slice_idx(po, id); ++mit;
         }
+        po.m_model_slices.assign(model_slices);
 
         if(po.m_config.supports_enable.getBool() ||
            po.m_config.pad_enable.getBool())
@@ -881,19 +976,44 @@ void SLAPrint::process()
 
             };
 
-            // Construction of this object does the calculation.
-            this->throw_if_canceled();
-            SLAAutoSupports auto_supports(po.m_supportdata->emesh,
-                                          po.get_model_slices(),
-                                          heights,
-                                          config,
-                                          [this]() { throw_if_canceled(); },
-                                          statuscb);
-
-            // Now let's extract the result.
-            const std::vector<sla::SupportPoint>& points = auto_supports.output();
-            this->throw_if_canceled();
-            po.m_supportdata->pts = points;
+            // The support point generator runs over all the slices.
+            std::vector<ExPolygons> model_slices = po.get_model_slices().get_all();
+            size_t input_hash =
+                support_points_input_hash(po.transformed_mesh(),
+                                          model_slices, heights,
+                                          config);
+
+            auto &cache = po.m_support_points_cache;
+            auto  cached = std::find_if(cache.begin(), cache.end(),
+                [input_hash](const SLAPrintObject::CachedSupportPoints &c) {
+                    return c.input_hash == input_hash;
+                });
+
+            if (cached != cache.end()) {
+                po.m_supportdata->pts = cached->points;
+
+                // Keep the most recently used points at the end.
+                std::rotate(cached, cached + 1, cache.end());
+            } else {
+                // Construction of this object does the calculation.
+                this->throw_if_canceled();
+                SLAAutoSupports auto_supports(po.m_supportdata->emesh,
+                                              model_slices,
+                                              heights,
+                                              config,
+                                              [this]() { throw_if_canceled(); },
+                                              statuscb);
+
+                // Now let's extract the result.
+                const std::vector<sla::SupportPoint>& points = auto_supports.output();
+                this->throw_if_canceled();
+                po.m_supportdata->pts = points;
+
+                static const size_t MAX_CACHED_SUPPORT_POINTS = 4;
+                if (cache.size() >= MAX_CACHED_SUPPORT_POINTS)
+                    cache.erase(cache.begin());
+                cache.push_back({input_hash, points});
+            }
 
             BOOST_LOG_TRIVIAL(debug) << "Automatic support points: "
                                      << po.m_supportdata->pts.size();
@@ -996,9 +1116,9 @@ void SLAPrint::process()
                 // we sometimes call it "builtin pad" is enabled so we will
                 // get a sample from the bottom of the mesh and use it for pad
                 // creation.
-                sla::pad_blueprint(trmesh, bp, float(pad_h),
-                               float(po.m_config.layer_height.getFloat()),
-                               thrfn);
+                bp = po.m_supportdata->model_pad_blueprint(
+                    trmesh, float(pad_h),
+                    float(po.m_config.layer_height.getFloat()), thrfn);
             }
 
             po.m_supportdata->support_tree_ptr->add_pad(bp, pcfg);
@@ -1039,22 +1159,23 @@ void SLAPrint::process()
                 heights.emplace_back(rec.slice_level());
             }
 
-            sd->support_slices = sd->support_tree_ptr->slice(
+            std::vector<ExPolygons> support_slices = sd->support_tree_ptr->slice(
                         heights, float(po.config().slice_closing_radius.value));
-        }
 
-        double doffs = m_printer_config.absolute_correction.getFloat();
-        coord_t clpr_offs = scaled(doffs);
-        for(size_t i = 0;
-            i < sd->support_slices.size() && i < po.m_slice_index.size();
-            ++i)
-        {
-            // We apply the printer correction offset here.
-            if(clpr_offs != 0)
-                sd->support_slices[i] =
-                    offset_ex(sd->support_slices[i], float(clpr_offs));
+            double doffs = m_printer_config.absolute_correction.getFloat();
+            coord_t clpr_offs = scaled(doffs);
+            for(size_t i = 0;
+                i < support_slices.size() && i < po.m_slice_index.size();
+                ++i)
+            {
+                // We apply the printer correction offset here.
+                if(clpr_offs != 0)
+                    support_slices[i] =
+                        offset_ex(support_slices[i], float(clpr_offs));
 
-            po.m_slice_index[i].set_support_slice_idx(po, i);
+                po.m_slice_index[i].set_support_slice_idx(po, i);
+            }
+            sd->support_slices.assign(support_slices);
         }
 
         // Using RELOAD_SLA_PREVIEW to tell the Plater to pass the update
@@ -1166,91 +1287,105 @@ void SLAPrint::process()
                    const std::vector<SLAPrintObject::Instance>& instances,
                    bool is_lefthanded)
         {
+            // The instances differ only in their rotation and shift. Each
+            // polygon is converted once and rotated once for every distinct
+            // rotation, the instances with the same rotation only get their
+            // copies shifted.
+            std::vector<float>  rotations;
+            std::vector<size_t> rotation_idx(instances.size());
+            for (size_t i = 0; i < instances.size(); ++i) {
+                auto it = std::find(rotations.begin(), rotations.end(),
+                                    instances[i].rotation);
+                rotation_idx[i] = size_t(it - rotations.begin());
+                if (it == rotations.end())
+                    rotations.emplace_back(instances[i].rotation);
+            }
+
             ClipperPolygons polygons;
             polygons.reserve(input_polygons.size() * instances.size());
 
+            ClipperPolygons rotated(rotations.size());
+
             for (const ExPolygon& polygon : input_polygons) {
                 if(polygon.contour.empty()) continue;
 
-                for (size_t i = 0; i < instances.size(); ++i)
-                {
-                    ClipperPolygon poly;
+                ClipperPolygon poly;
+
+                // We need to reverse if is_lefthanded is true but
+                bool needreverse = is_lefthanded;
+
+                // should be a move
+                poly.Contour.reserve(polygon.contour.size() + 1);
 
-                    // We need to reverse if is_lefthanded is true but
-                    bool needreverse = is_lefthanded;
+                auto& cntr = polygon.contour.points;
+                if(needreverse)
+                    for(auto it = cntr.rbegin(); it != cntr.rend(); ++it)
+                        poly.Contour.emplace_back(it->x(), it->y());
+                else
+                    for(auto& p : cntr)
+                        poly.Contour.emplace_back(p.x(), p.y());
 
-                    // should be a move
-                    poly.Contour.reserve(polygon.contour.size() + 1);
+                for(auto& h : polygon.holes) {
+                    poly.Holes.emplace_back();
+                    auto& hole = poly.Holes.back();
+                    hole.reserve(h.points.size() + 1);
 
-                    auto& cntr = polygon.contour.points;
                     if(needreverse)
-                        for(auto it = cntr.rbegin(); it != cntr.rend(); ++it)
-                            poly.Contour.emplace_back(it->x(), it->y());
+                        for(auto it = h.points.rbegin(); it != h.points.rend(); ++it)
+                            hole.emplace_back(it->x(), it->y());
                     else
-                        for(auto& p : cntr)
-                            poly.Contour.emplace_back(p.x(), p.y());
-
-                    for(auto& h : polygon.holes) {
-                        poly.Holes.emplace_back();
-                        auto& hole = poly.Holes.back();
-                        hole.reserve(h.points.size() + 1);
-
-                        if(needreverse)
-                            for(auto it = h.points.rbegin(); it != h.points.rend(); ++it)
-                                hole.emplace_back(it->x(), it->y());
-                        else
-                            for(auto& p : h.points)
-                                hole.emplace_back(p.x(), p.y());
-                    }
+                        for(auto& p : h.points)
+                            hole.emplace_back(p.x(), p.y());
+                }
 
-                    if(is_lefthanded) {
-                        for(auto& p : poly.Contour) p.X = -p.X;
-                        for(auto& h : poly.Holes) for(auto& p : h) p.X = -p.X;
-                    }
+                if(is_lefthanded) {
+                    for(auto& p : poly.Contour) p.X = -p.X;
+                    for(auto& h : poly.Holes) for(auto& p : h) p.X = -p.X;
+                }
+
+                for (size_t r = 0; r < rotations.size(); ++r) {
+                    rotated[r] = poly;
+                    if (rotations[r] != 0.f)
+                        sl::rotate(rotated[r], double(rotations[r]));
+                }
 
-                    sl::rotate(poly, double(instances[i].rotation));
-                    sl::translate(poly, ClipperPoint{instances[i].shift(X),
-                                                     instances[i].shift(Y)});
+                for (size_t i = 0; i < instances.size(); ++i)
+                {
+                    ClipperPolygon inst_poly = rotated[rotation_idx[i]];
+                    sl::translate(inst_poly, ClipperPoint{instances[i].shift(X),
+                                                          instances[i].shift(Y)});
 
-                    polygons.emplace_back(std::move(poly));
+                    polygons.emplace_back(std::move(inst_poly));
                 }
             }
             return polygons;
         };
 
-        double supports_volume(0.0);
-        double models_volume(0.0);
-
-        double estim_time(0.0);
-
-        size_t slow_layers = 0;
-        size_t fast_layers = 0;
-
-        const double delta_fade_time = (init_exp_time - exp_time) / (fade_layers_cnt + 1);
-        double fade_layer_time = init_exp_time;
+        // Areas of the united slices of a layer, filled in parallel and
+        // reduced in the layer order afterwards.
+        struct LayerStats {
+            double model_area   = 0.;
+            double support_area = 0.;
+            double height       = 0.;
+            bool   empty        = true;
+        };
 
-        SpinMutex mutex;
-        using Lock = std::lock_guard<SpinMutex>;
+        std::vector<LayerStats> layer_stats(m_printer_input.size());
 
         // Going to parallel:
-        auto printlayerfn = [this,
-                // functions and read only vars
-                get_all_polygons, polyunion, polydiff, areafn,
-                area_fill, display_area, exp_time, init_exp_time, fast_tilt, slow_tilt, delta_fade_time,
-
-                // write vars
-                &mutex, &models_volume, &supports_volume, &estim_time, &slow_layers,
-                &fast_layers, &fade_layer_time](size_t sliced_layer_cnt)
+        auto printlayerfn = [get_all_polygons, polyunion, polydiff, areafn, &layer_stats]
+                (PrintLayer& layer, size_t sliced_layer_cnt)
         {
-            PrintLayer& layer = m_printer_input[sliced_layer_cnt];
-
             // vector of slice record references
             auto& slicerecord_references = layer.slices();
 
             if(slicerecord_references.empty()) return;
 
+            LayerStats &stats = layer_stats[sliced_layer_cnt];
+            stats.empty = false;
+
             // Layer height should match for all object slices for a given level.
-            const auto l_height = double(slicerecord_references.front().get().layer_height());
+            stats.height = double(slicerecord_references.front().get().layer_height());
 
             // Calculation of the consumed material
 
@@ -1261,8 +1396,8 @@ void SLAPrint::process()
                                        layer.slices().end(),
                                        size_t(0),
                                        [](size_t a, const SliceRecord &sr) {
-                                           return a + sr.get_slice(soModel)
-                                                        .size();
+                                           return a + sr.get_slice_size(soModel) *
+                                                      sr.print_obj()->instances().size();
                                        });
 
             model_polygons.reserve(c);
@@ -1271,7 +1406,8 @@ void SLAPrint::process()
                                 layer.slices().end(),
                                 size_t(0),
                                 [](size_t a, const SliceRecord &sr) {
-                                    return a + sr.get_slice(soModel).size();
+                                    return a + sr.get_slice_size(soSupport) *
+                                               sr.print_obj()->instances().size();
                                 });
 
             supports_polygons.reserve(c);
@@ -1279,7 +1415,7 @@ void SLAPrint::process()
             for(const SliceRecord& record : layer.slices()) {
                 const SLAPrintObject *po = record.print_obj();
 
-                const ExPolygons &modelslices = record.get_slice(soModel);
+                ExPolygons modelslices = record.get_slice(soModel);
 
                 bool is_lefth = record.print_obj()->is_left_handed();
                 if (!modelslices.empty()) {
@@ -1287,7 +1423,7 @@ void SLAPrint::process()
                     for(ClipperPolygon& p_tmp : v) model_polygons.emplace_back(std::move(p_tmp));
                 }
 
-                const ExPolygons &supportslices = record.get_slice(soSupport);
+                ExPolygons supportslices = record.get_slice(soSupport);
 
                 if (!supportslices.empty()) {
                     ClipperPolygons v = get_all_polygons(supportslices, po->instances(), is_lefth);
@@ -1296,13 +1432,8 @@ void SLAPrint::process()
             }
 
             model_polygons = polyunion(model_polygons);
-            double layer_model_area = 0;
             for (const ClipperPolygon& polygon : model_polygons)
-                layer_model_area += areafn(polygon);
-
-            if (layer_model_area < 0 || layer_model_area > 0) {
-                Lock lck(mutex); models_volume += layer_model_area * l_height;
-            }
+                stats.model_area += areafn(polygon);
 
             if(!supports_polygons.empty()) {
                 if(model_polygons.empty()) supports_polygons = polyunion(supports_polygons);
@@ -1310,53 +1441,71 @@ void SLAPrint::process()
                 // allegedly, union of subject is done withing the diff according to the pftPositive polyFillType
             }
 
-            double layer_support_area = 0;
             for (const ClipperPolygon& polygon : supports_polygons)
-                layer_support_area += areafn(polygon);
-
-            if (layer_support_area < 0 || layer_support_area > 0) {
-                Lock lck(mutex); supports_volume += layer_support_area * l_height;
-            }
+                stats.support_area += areafn(polygon);
 
-            // Here we can save the expensively calculated polygons for printing
+            // Here we can save the expensively calculated polygons for printing.
+            // The model and the support parts are already united and disjoint,
+            // another union is only needed to merge the touching boundaries.
             ClipperPolygons trslices;
             trslices.reserve(model_polygons.size() + supports_polygons.size());
             for(ClipperPolygon& poly : model_polygons) trslices.emplace_back(std::move(poly));
             for(ClipperPolygon& poly : supports_polygons) trslices.emplace_back(std::move(poly));
 
-            layer.transformed_slices(polyunion(trslices));
+            if (model_polygons.empty() || supports_polygons.empty())
+                layer.transformed_slices(std::move(trslices));
+            else
+                layer.transformed_slices(polyunion(trslices));
+        };
 
-            // Calculation of the slow and fast layers to the future controlling those values on FW
+        // sequential version for debugging:
+        // sla::ccr_seq::enumerate(m_printer_input.begin(), m_printer_input.end(), printlayerfn);
+        sla::ccr::enumerate(m_printer_input.begin(), m_printer_input.end(), printlayerfn);
 
-            const bool is_fast_layer = (layer_model_area + layer_support_area) <= display_area*area_fill;
-            const double tilt_time = is_fast_layer ? fast_tilt : slow_tilt;
+        double supports_volume(0.0);
+        double models_volume(0.0);
 
-            { Lock lck(mutex);
-                if (is_fast_layer)
-                    fast_layers++;
-                else
-                    slow_layers++;
+        double estim_time(0.0);
+
+        size_t slow_layers = 0;
+        size_t fast_layers = 0;
+
+        const double delta_fade_time = (init_exp_time - exp_time) / (fade_layers_cnt + 1);
+        double fade_layer_time = init_exp_time;
 
+        // The exposure time of the faded layers depends on the layers below,
+        // so the reduction goes in the order of the layers.
+        for (size_t sliced_layer_cnt = 0; sliced_layer_cnt < layer_stats.size(); ++sliced_layer_cnt) {
+            const LayerStats &stats = layer_stats[sliced_layer_cnt];
+            if (stats.empty) continue;
 
-                // Calculation of the printing time
+            models_volume   += stats.model_area * stats.height;
+            supports_volume += stats.support_area * stats.height;
 
-                if (sliced_layer_cnt < 3)
-                    estim_time += init_exp_time;
-                else if (fade_layer_time > exp_time)
-                {
-                    fade_layer_time -= delta_fade_time;
-                    estim_time += fade_layer_time;
-                }
-                else
-                    estim_time += exp_time;
+            // Calculation of the slow and fast layers to the future controlling those values on FW
+
+            const bool is_fast_layer = (stats.model_area + stats.support_area) <= display_area*area_fill;
+            const double tilt_time = is_fast_layer ? fast_tilt : slow_tilt;
+
+            if (is_fast_layer)
+                fast_layers++;
+            else
+                slow_layers++;
 
-                estim_time += tilt_time;
+            // Calculation of the printing time
+
+            if (sliced_layer_cnt < 3)
+                estim_time += init_exp_time;
+            else if (fade_layer_time > exp_time)
+            {
+                fade_layer_time -= delta_fade_time;
+                estim_time += fade_layer_time;
             }
-        };
+            else
+                estim_time += exp_time;
 
-        // sequential version for debugging:
-        // for(size_t i = 0; i < m_printer_input.size(); ++i) printlayerfn(i);
-        tbb::parallel_for<size_t, decltype(printlayerfn)>(0, m_printer_input.size(), printlayerfn);
+            estim_time += tilt_time;
+        }
 
         auto SCALING2 = SCALING_FACTOR * SCALING_FACTOR;
         m_print_statistics.support_used_material = supports_volume * SCALING2;
@@ -1390,6 +1539,11 @@ void SLAPrint::process()
         auto lvlcnt = unsigned(m_printer_input.size());
         printer.layers(lvlcnt);
 
+        // Streaming export: write the layers into the output file as soon as they are rasterized.
+        Zipper *zipper = m_raster_output_cb ? m_raster_output_cb() : nullptr;
+        if (zipper != nullptr)
+            printer.begin_stream(*zipper);
+
         // coefficient to map the rasterization state (0-99) to the allocated
         // portion (slot) of the process state
         double sd = (100 - max_objstatus) / 100.0;
@@ -1417,8 +1571,9 @@ void SLAPrint::process()
             // Switch to the appropriate layer in the printer
             printer.begin_layer(level_id);
 
-            for(const ClipperLib::Polygon& poly : printlayer.transformed_slices())
-                printer.draw_polygon(poly, level_id);
+            // The raster is split into bands filled in parallel, which keeps
+            // the cores busy when there are fewer layers than cores.
+            printer.draw_polygons(printlayer.transformed_slices(), level_id);
 
             // Finish the layer for later saving it.
             printer.finish_layer(level_id);
@@ -1442,8 +1597,20 @@ void SLAPrint::process()
         // Sequential version (for testing)
         // for(unsigned l = 0; l < lvlcnt; ++l) lvlfn(l);
 
-        // Print all the layers in parallel
-        tbb::parallel_for<unsigned, decltype(lvlfn)>(0, lvlcnt, lvlfn);
+        if (zipper == nullptr) {
+            // Print all the layers in parallel
+            tbb::parallel_for<unsigned, decltype(lvlfn)>(0, lvlcnt, lvlfn);
+        } else {
+            // Print the layers in parallel by windows of consecutive layers, so that
+            // the number of the layers finished out of order, which the printer has to
+            // hold in memory until all the layers below are written, stays bounded.
+            const unsigned window = 4 * unsigned(std::max(1, tbb::task_scheduler_init::default_num_threads()));
+            for (unsigned lvl_begin = 0; lvl_begin < lvlcnt && ! canceled(); lvl_begin += window)
+                tbb::parallel_for<unsigned, decltype(lvlfn)>(lvl_begin, std::min(lvlcnt, lvl_begin + window), lvlfn);
+        }
+
+        // The rasters were kept by the printer for reuse between the layers.
+        printer.release_rasters();
 
         // Set statistics values to the printer
         sla::RasterWriter::PrintStatistics stats;
@@ -1458,6 +1625,9 @@ void SLAPrint::process()
         stats.estimated_print_time_s = m_print_statistics.estimated_print_time;
         
         m_printer->set_statistics(stats);
+
+        if (zipper != nullptr && ! canceled())
+            printer.end_stream();
     };
 
     using slaposFn = std::function<void(SLAPrintObject&)>;
@@ -1468,14 +1638,10 @@ void SLAPrint::process()
         slice_model, support_points, support_tree, generate_pad, slice_supports
     };
 
-    // We want to first process all objects...
-    std::vector<SLAPrintObjectStep> level1_obj_steps = {
-        slaposObjectSlice, slaposSupportPoints, slaposSupportTree, slaposPad
-    };
-
-    // and then slice all supports to allow preview to be displayed ASAP
-    std::vector<SLAPrintObjectStep> level2_obj_steps = {
-        slaposSliceSupports
+    // The objects do not depend on each other, thus each object runs through
+    // all its steps independently of the others. The print steps wait for all the objects.
+    std::vector<SLAPrintObjectStep> obj_steps = {
+        slaposObjectSlice, slaposSupportPoints, slaposSupportTree, slaposPad, slaposSliceSupports
     };
 
     slapsFn print_program[] = { merge_slices_and_eval_stats, rasterize };
@@ -1495,39 +1661,60 @@ void SLAPrint::process()
 
     std::array<double, slaposCount + slapsCount> step_times {};
 
-    auto apply_steps_on_objects =
-        [this, &st, ostepd, &pobj_program, &step_times, &bench]
-        (const std::vector<SLAPrintObjectStep> &steps)
-    {
-        unsigned incr = 0;
-        for (SLAPrintObject *po : m_objects) {
-            for (SLAPrintObjectStep step : steps) {
+    // Names of the steps in the trace.
+    static const char *obj_step_trace_names[slaposCount] = {
+        "SLAPrintObject::slice", "SLAPrintObject::support_points", "SLAPrintObject::support_tree", "SLAPrintObject::pad", "SLAPrintObject::slice_supports"
+    };
+    static const char *print_step_trace_names[slapsCount] = {
+        "SLAPrint::merge_slices_and_eval", "SLAPrint::rasterize"
+    };
 
-                // Cancellation checking. Each step will check for
-                // cancellation on its own and return earlier gracefully.
-                // Just after it returns execution gets to this point and
-                // throws the canceled signal.
-                throw_if_canceled();
+    // Guards st and step_times, which are shared by the objects processed in parallel.
+    std::mutex progress_mutex;
 
-                st += incr * ostepd;
+    auto apply_steps_on_object =
+        [this, &st, ostepd, &pobj_program, &step_times, &progress_mutex]
+        (SLAPrintObject &po, const std::vector<SLAPrintObjectStep> &steps)
+    {
+        decltype(bench) step_bench;
+        for (SLAPrintObjectStep step : steps) {
+
+            // Cancellation checking. Each step will check for
+            // cancellation on its own and return earlier gracefully.
+            // Just after it returns execution gets to this point and
+            // throws the canceled signal.
+            throw_if_canceled();
 
-                if (po->m_stepmask[step] && po->set_started(step)) {
+            if (po.m_stepmask[step] && po.set_started(step)) {
+                {
+                    std::lock_guard<std::mutex> lock(progress_mutex);
                     m_report_status(*this, st, OBJ_STEP_LABELS(step));
-                    bench.start();
-                    pobj_program[step](*po);
-                    bench.stop();
-                    step_times[step] += bench.getElapsedSec();
-                    throw_if_canceled();
-                    po->set_done(step);
                 }
-
-                incr = OBJ_STEP_LEVELS[step];
+                step_bench.start();
+                {
+                    SLIC3R_TRACE_ZONE(obj_step_trace_names[step], "sla");
+                    pobj_program[step](po);
+                }
+                step_bench.stop();
+                {
+                    std::lock_guard<std::mutex> lock(progress_mutex);
+                    step_times[step] += step_bench.getElapsedSec();
+                }
+                throw_if_canceled();
+                po.set_done(step);
+                log_memory_stats("of " + po.model_object()->name + " after " + obj_step_trace_names[step],
+                                 [&po]() { return po.memory_stats(); });
             }
+
+            std::lock_guard<std::mutex> lock(progress_mutex);
+            st += OBJ_STEP_LEVELS[step] * ostepd;
         }
     };
 
-    apply_steps_on_objects(level1_obj_steps);
-    apply_steps_on_objects(level2_obj_steps);
+    // An exception thrown by any of the objects (cancellation included) is rethrown here.
+    tbb::parallel_for(size_t(0), m_objects.size(), [this, &apply_steps_on_object, &obj_steps](size_t idx) {
+        apply_steps_on_object(*m_objects[idx], obj_steps);
+    });
 
     // this would disable the rasterization step
     // std::fill(m_stepmask.begin(), m_stepmask.end(), false);
@@ -1540,11 +1727,16 @@ void SLAPrint::process()
         if (m_stepmask[currentstep] && set_started(currentstep)) {
             m_report_status(*this, st, PRINT_STEP_LABELS(currentstep));
             bench.start();
-            print_program[currentstep]();
+            {
+                SLIC3R_TRACE_ZONE(print_step_trace_names[currentstep], "sla");
+                print_program[currentstep]();
+            }
             bench.stop();
             step_times[slaposCount + currentstep] += bench.getElapsedSec();
             throw_if_canceled();
             set_done(currentstep);
+            log_memory_stats(std::string("after ") + print_step_trace_names[currentstep],
+                             [this]() { return this->memory_stats(); });
         }
 
         st += PRINT_STEP_LEVELS[currentstep] * pstd;
@@ -1846,7 +2038,7 @@ Vec3d SLAPrint::relative_correction() const
 }
 
 namespace { // dummy empty static containers for return values in some methods
-const std::vector<ExPolygons> EMPTY_SLICES;
+const sla::SliceStore EMPTY_SLICES;
 const TriangleMesh EMPTY_MESH;
 const ExPolygons EMPTY_SLICE;
 const std::vector<sla::SupportPoint> EMPTY_SUPPORT_POINTS;
@@ -1859,26 +2051,72 @@ const std::vector<sla::SupportPoint>& SLAPrintObject::get_support_points() const
     return m_supportdata? m_supportdata->pts : EMPTY_SUPPORT_POINTS;
 }
 
-const std::vector<ExPolygons> &SLAPrintObject::get_support_slices() const
+const sla::SliceStore &SLAPrintObject::get_support_slices() const
 {
     // assert(is_step_done(slaposSliceSupports));
     if (!m_supportdata) return EMPTY_SLICES;
     return m_supportdata->support_slices;
 }
 
-const ExPolygons &SliceRecord::get_slice(SliceOrigin o) const
+PrintMemoryStats SLAPrintObject::memory_stats() const
+{
+    PrintMemoryStats stats;
+    stats.add("slice", m_model_slices.memsize() +
+                       m_slice_index.capacity() * sizeof(SliceRecord) +
+                       m_model_height_levels.capacity() * sizeof(float) +
+                       (is_step_done(slaposObjectSlice) ? transformed_mesh().memsize() : 0));
+
+    size_t points = 0;
+    for (const CachedSupportPoints &cached : m_support_points_cache)
+        points += sizeof(cached) + cached.points.capacity() * sizeof(sla::SupportPoint);
+    size_t tree = 0, pad = 0, support_slices = 0;
+    if (m_supportdata) {
+        // The indexed mesh of the object with its AABB tree is not counted,
+        // only its vertices and indices.
+        const sla::EigenMesh3D &emesh = m_supportdata->emesh;
+        points += sizeof(*m_supportdata) + m_supportdata->pts.capacity() * sizeof(sla::SupportPoint) +
+                  size_t(emesh.V().size()) * sizeof(double) + size_t(emesh.F().size()) * sizeof(int);
+        // The meshes were merged once the support tree was generated, the
+        // retrieval does not merge them again.
+        if (m_supportdata->support_tree_ptr) {
+            if (is_step_done(slaposSupportTree))
+                tree = m_supportdata->support_tree_ptr->retrieve_mesh(sla::MeshType::Support).memsize();
+            if (is_step_done(slaposPad))
+                pad = m_supportdata->support_tree_ptr->retrieve_mesh(sla::MeshType::Pad).memsize();
+        }
+        support_slices = m_supportdata->support_slices.memsize();
+    }
+    stats.add("support_points", points);
+    stats.add("support_tree", tree);
+    stats.add("pad", pad);
+    stats.add("slice_supports", support_slices);
+    return stats;
+}
+
+ExPolygons SliceRecord::get_slice(SliceOrigin o) const
 {
     size_t idx = o == soModel ? m_model_slices_idx :
                                 m_support_slices_idx;
 
     if(m_po == nullptr) return EMPTY_SLICE;
 
-    const std::vector<ExPolygons>& v = o == soModel? m_po->get_model_slices() :
-                                                     m_po->get_support_slices();
+    const sla::SliceStore& v = o == soModel? m_po->get_model_slices() :
+                                             m_po->get_support_slices();
+
+    return idx >= v.size() ? EMPTY_SLICE : v.get(idx);
+}
+
+size_t SliceRecord::get_slice_size(SliceOrigin o) const
+{
+    size_t idx = o == soModel ? m_model_slices_idx :
+                                m_support_slices_idx;
+
+    if(m_po == nullptr) return 0;
 
-    if(idx >= v.size()) return EMPTY_SLICE;
+    const sla::SliceStore& v = o == soModel? m_po->get_model_slices() :
+                                             m_po->get_support_slices();
 
-    return idx >= v.size() ? EMPTY_SLICE : v[idx];
+    return idx >= v.size() ? 0 : v.expolygons_count(idx);
 }
 
 bool SLAPrintObject::has_mesh(SLAPrintObjectStep step) const
@@ -2001,7 +2239,10 @@ void SLAPrint::StatusReporter::operator()(SLAPrint &         p,
                                           unsigned           flags,
                                           const std::string &logmsg)
 {
-    m_st = st;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // The negative values only pass the flags, they are not a progress.
+    if (st >= 0)
+        m_st = st;
     BOOST_LOG_TRIVIAL(info)
         << st << "% " << msg << (logmsg.empty() ? "" : ": ") << logmsg
         << log_memory_info();
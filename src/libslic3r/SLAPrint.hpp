@@ -5,6 +5,7 @@
 #include "PrintBase.hpp"
 //#include "PrintExport.hpp"
 #include "SLA/SLARasterWriter.hpp"
+#include "SLA/SLASliceStore.hpp"
 #include "Point.hpp"
 #include "MTUtils.hpp"
 #include "Zipper.hpp"
@@ -95,6 +96,10 @@ public:
     // This method returns the support points of this SLAPrintObject.
     const std::vector<sla::SupportPoint>& get_support_points() const;
 
+    // Memory footprint of the slices, of the support points, of the support
+    // and pad meshes and of the support slices, aggregated by step.
+    PrintMemoryStats memory_stats() const;
+
     // The public Slice record structure. It corresponds to one printable layer.
     class SliceRecord {
     public:
@@ -139,7 +144,11 @@ public:
             m_po = &po; m_support_slices_idx = id;
         }
 
-        const ExPolygons& get_slice(SliceOrigin o) const;
+        // The slices are decoded from the compact storage of the object,
+        // therefore they are returned by value.
+        ExPolygons get_slice(SliceOrigin o) const;
+        // Number of ExPolygons of the slice, without decoding it.
+        size_t get_slice_size(SliceOrigin o) const;
     };
 
 private:
@@ -197,8 +206,8 @@ private:
         return it;
     }
 
-    const std::vector<ExPolygons>& get_model_slices() const { return m_model_slices; }
-    const std::vector<ExPolygons>& get_support_slices() const;
+    const sla::SliceStore& get_model_slices() const { return m_model_slices; }
+    const sla::SliceStore& get_support_slices() const;
 
 public:
 
@@ -277,7 +286,7 @@ private:
     std::vector<Instance> 					m_instances;
 
     // Individual 2d slice polygons from lower z to higher z levels
-    std::vector<ExPolygons>                 m_model_slices;
+    sla::SliceStore                         m_model_slices;
 
     // Exact (float) height levels mapped to the slices. Each record contains
     // the index to the model and the support slice vectors.
@@ -290,6 +299,16 @@ private:
 
     class SupportData;
     std::unique_ptr<SupportData> m_supportdata;
+
+    // Automatically generated support points memoized by the hash of their
+    // inputs (the mesh, its slices and the generator configuration). Going
+    // back to a previous state (e.g. by undo) will restore the points
+    // instead of running the generator again.
+    struct CachedSupportPoints {
+        size_t                          input_hash;
+        std::vector<sla::SupportPoint>  points;
+    };
+    std::vector<CachedSupportPoints>        m_support_points_cache;
 };
 
 using PrintObjects = std::vector<SLAPrintObject*>;
@@ -371,6 +390,12 @@ public:
         if(m_printer) m_printer->save(zipper, projectname);
     }
 
+    // Streaming export of the raster. The callback is called at the start of slapsRasterize, when the print statistics
+    // are already known. If it returns a zipper, the layers are written into the zipper as soon as they are rasterized
+    // and they are not kept in memory, thus export_raster() will not write any layer afterwards.
+    // The zipper is to be finalized by the caller after process() returns.
+    void set_raster_output_callback(std::function<Zipper*()> cb) { m_raster_output_cb = std::move(cb); }
+
     const PrintObjects& objects() const { return m_objects; }
 
     const SLAPrintConfig&       print_config() const { return m_print_config; }
@@ -386,6 +411,9 @@ public:
     const SLAPrintStatistics&   print_statistics() const { return m_print_statistics; }
 
     std::string validate() const override;
+    // Memory footprint of the print objects, of the print layers and of the
+    // rasterized layers kept in memory, aggregated by step.
+    PrintMemoryStats memory_stats() const override;
 
     // An aggregation of SliceRecord-s from all the print objects for each
     // occupied layer. Slice record levels dont have to match exactly.
@@ -448,13 +476,16 @@ private:
 
     // The printer itself
     std::unique_ptr<sla::RasterWriter>   m_printer;
+    std::function<Zipper*()>             m_raster_output_cb;
 
     // Estimated print time, material consumed.
     SLAPrintStatistics                      m_print_statistics;
     
+    // The per object steps report their progress concurrently.
     class StatusReporter
     {
-        double m_st = 0;
+        double             m_st = 0;
+        mutable std::mutex m_mutex;
         
     public:
         void operator()(SLAPrint &         p,
@@ -463,7 +494,7 @@ private:
                         unsigned           flags = SlicingStatus::DEFAULT,
                         const std::string &logmsg = "");
         
-        double status() const { return m_st; }
+        double status() const { std::lock_guard<std::mutex> lock(m_mutex); return m_st; }
     } m_report_status;
     
     sla::RasterWriter &init_printer();
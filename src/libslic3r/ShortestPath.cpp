@@ -7,50 +7,46 @@
 #include "clipper.hpp"
 #include "ShortestPath.hpp"
 #include "KDTreeIndirect.hpp"
+#include "KDTreeFlat.hpp"
 #include "MutablePriorityQueue.hpp"
 #include "Print.hpp"
 
 #include <cmath>
 #include <cassert>
+#include <chrono>
+
+#include <tbb/parallel_for.h>
 
 namespace Slic3r {
 
 // Naive implementation of the Traveling Salesman Problem, it works by always taking the next closest neighbor.
 // This implementation will always produce valid result even if some segments cannot reverse.
-template<typename EndPointType, typename KDTreeType, typename CouldReverseFunc>
-std::vector<std::pair<size_t, bool>> chain_segments_closest_point(std::vector<EndPointType> &end_points, KDTreeType &kdtree, CouldReverseFunc &could_reverse_func, EndPointType &first_point)
+template<typename EndPointType, typename CouldReverseFunc>
+std::vector<std::pair<size_t, bool>> chain_segments_closest_point(std::vector<EndPointType> &end_points, CouldReverseFunc &could_reverse_func, EndPointType &first_point)
 {
 	assert((end_points.size() & 1) == 0);
 	size_t num_segments = end_points.size() / 2;
 	assert(num_segments >= 2);
-	for (EndPointType &ep : end_points)
-		ep.chain_id = 0;
+	// End points of the segments already chained are removed from the search.
+	KDTreeFlat<2, double> kdtree([&end_points](size_t idx, size_t dimension) { return end_points[idx].pos[dimension]; }, end_points.size());
 	std::vector<std::pair<size_t, bool>> out;
 	out.reserve(num_segments);
 	size_t first_point_idx = &first_point - end_points.data();
 	out.emplace_back(first_point_idx / 2, (first_point_idx & 1) != 0);
-	first_point.chain_id = 1;
+	kdtree.remove(first_point_idx);
 	size_t this_idx = first_point_idx ^ 1;
 	for (int iter = (int)num_segments - 2; iter >= 0; -- iter) {
-		EndPointType &this_point = end_points[this_idx];
-    	this_point.chain_id = 1;
-    	// Find the closest point to this end_point, which lies on a different extrusion path (filtered by the lambda).
-    	// Ignore the starting point as the starting point is considered to be occupied, no end point coud connect to it.
-		size_t next_idx = find_closest_point(kdtree, this_point.pos,
-			[this_idx, &end_points, &could_reverse_func](size_t idx) {
-				return (idx ^ this_idx) > 1 && end_points[idx].chain_id == 0 && ((idx ^ 1) == 0 || could_reverse_func(idx >> 1));
-		});
+		kdtree.remove(this_idx);
+    	// Find the closest point to this end_point, which lies on a different extrusion path.
+    	// A segment may only be entered through its last point if it could be reversed.
+		size_t next_idx = kdtree.closest_point(end_points[this_idx].pos,
+			[&could_reverse_func](size_t idx) { return (idx & 1) == 0 || could_reverse_func(idx >> 1); });
 		assert(next_idx < end_points.size());
-		EndPointType &end_point = end_points[next_idx];
-		end_point.chain_id = 1;
+		kdtree.remove(next_idx);
 		out.emplace_back(next_idx / 2, (next_idx & 1) != 0);
 		this_idx = next_idx ^ 1;
 	}
-#ifndef NDEBUG
-	assert(end_points[this_idx].chain_id == 0);
-	for (EndPointType &ep : end_points)
-		assert(&ep == &end_points[this_idx] || ep.chain_id == 1);
-#endif /* NDEBUG */
+	assert(kdtree.size() == 1);
 	return out;
 }
 
@@ -380,7 +376,7 @@ std::vector<std::pair<size_t, bool>> chain_segments_greedy_constrained_reversals
 			}
 			if (failed)
 				// As a last resort, try a dumb algorithm, which is not sensitive to edge reversal constraints.
-				out = chain_segments_closest_point<EndPoint, decltype(kdtree), CouldReverseFunc>(end_points, kdtree, could_reverse_func, (initial_point != nullptr) ? *initial_point : end_points.front());
+				out = chain_segments_closest_point<EndPoint, CouldReverseFunc>(end_points, could_reverse_func, (initial_point != nullptr) ? *initial_point : end_points.front());
 		} else {
 			assert(! failed);
 		}
@@ -959,7 +955,7 @@ std::vector<std::pair<size_t, bool>> chain_segments_greedy_constrained_reversals
 			}
 			if (failed)
 				// As a last resort, try a dumb algorithm, which is not sensitive to edge reversal constraints.
-				out = chain_segments_closest_point<EndPoint, decltype(kdtree), CouldReverseFunc>(end_points, kdtree, could_reverse_func, (initial_point != nullptr) ? *initial_point : end_points.front());
+				out = chain_segments_closest_point<EndPoint, CouldReverseFunc>(end_points, could_reverse_func, (initial_point != nullptr) ? *initial_point : end_points.front());
 		} else {
 			assert(! failed);
 		}
@@ -995,11 +991,125 @@ std::vector<std::pair<size_t, bool>> chain_segments_greedy2(SegmentEndPointFunc
 	return chain_segments_greedy_constrained_reversals2_<PointType, SegmentEndPointFunc, false, decltype(could_reverse_func)>(end_point_func, could_reverse_func, num_segments, start_near);
 }
 
-std::vector<std::pair<size_t, bool>> chain_extrusion_entities(std::vector<ExtrusionEntity*> &entities, const Point *start_near)
+// Above this number of segments, the segments are chained by chain_segments_partitioned().
+static constexpr const size_t chain_partitioned_min_segments = 8192;
+// Number of segments per grid cell targeted by chain_segments_partitioned().
+static constexpr const size_t chain_partitioned_cell_segments = 2048;
+
+// Chaining of large sets of segments: The segments are bucketed into a regular grid by their centers, the segments of each cell
+// are chained by chain_cell_func() in parallel, and the chains of the cells are stitched together in a serpentine order of the cells,
+// reversing a chain of a cell if it brings its first point closer to the end of the previous chain and all of its segments may be reversed.
+// Only the links between the cells are approximate, the greedy chaining of a cell sees just a small KD tree and heap.
+template<typename PointType, typename SegmentEndPointFunc, typename CouldReverseFunc, typename ChainCellFunc>
+std::vector<std::pair<size_t, bool>> chain_segments_partitioned(SegmentEndPointFunc end_point_func, CouldReverseFunc could_reverse_func, size_t num_segments, const PointType *start_near, ChainCellFunc chain_cell_func)
+{
+	auto segment_center = [&end_point_func](size_t idx) -> Vec2d { return 0.5 * (end_point_func(idx, true).template cast<double>() + end_point_func(idx, false).template cast<double>()); };
+
+	Vec2d bbox_min(std::numeric_limits<double>::max(), std::numeric_limits<double>::max());
+	Vec2d bbox_max = - bbox_min;
+	for (size_t i = 0; i < num_segments; ++ i) {
+		Vec2d c = segment_center(i);
+		bbox_min = bbox_min.cwiseMin(c);
+		bbox_max = bbox_max.cwiseMax(c);
+	}
+	Vec2d  bbox_size	 = (bbox_max - bbox_min).cwiseMax(Vec2d(1., 1.));
+	size_t num_cells_min = (num_segments + chain_partitioned_cell_segments - 1) / chain_partitioned_cell_segments;
+	size_t cols 		 = std::clamp<size_t>(size_t(std::lround(std::sqrt(double(num_cells_min) * bbox_size.x() / bbox_size.y()))), 1, num_cells_min);
+	size_t rows 		 = (num_cells_min + cols - 1) / cols;
+	size_t num_cells     = rows * cols;
+
+	// Counting sort of the segments by cells. The cells are numbered row by row, alternating the direction of the rows,
+	// thus the order of the cells is the stitching order.
+	std::vector<uint32_t> segment_cell(num_segments);
+	std::vector<size_t>   cell_begin(num_cells + 1, 0);
+	for (size_t i = 0; i < num_segments; ++ i) {
+		Vec2d  c   = segment_center(i) - bbox_min;
+		size_t row = std::min(rows - 1, size_t(c.y() * double(rows) / bbox_size.y()));
+		size_t col = std::min(cols - 1, size_t(c.x() * double(cols) / bbox_size.x()));
+		size_t cell = row * cols + ((row & 1) ? cols - 1 - col : col);
+		segment_cell[i] = uint32_t(cell);
+		++ cell_begin[cell + 1];
+	}
+	for (size_t i = 1; i <= num_cells; ++ i)
+		cell_begin[i] += cell_begin[i - 1];
+	std::vector<size_t> cell_segments(num_segments);
+	{
+		std::vector<size_t> cell_end(cell_begin.begin(), cell_begin.end() - 1);
+		for (size_t i = 0; i < num_segments; ++ i)
+			cell_segments[cell_end[segment_cell[i]] ++] = i;
+	}
+
+	// Chain the cells in parallel, each cell writes its chain into its own range of the output.
+	std::vector<std::pair<size_t, bool>> out(num_segments);
+	std::vector<char>                    cell_reversible(num_cells, true);
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, num_cells), 
+		[&end_point_func, &could_reverse_func, &chain_cell_func, &cell_begin, &cell_segments, &cell_reversible, &out](const tbb::blocked_range<size_t> &range) {
+		for (size_t cell = range.begin(); cell < range.end(); ++ cell) {
+			const size_t *segments     = cell_segments.data() + cell_begin[cell];
+			size_t        cell_num_segments = cell_begin[cell + 1] - cell_begin[cell];
+			if (cell_num_segments == 0)
+				continue;
+			auto cell_end_point     = [&end_point_func, segments](size_t idx, bool first_point) -> const PointType& { return end_point_func(segments[idx], first_point); };
+			auto cell_could_reverse = [&could_reverse_func, segments](size_t idx) -> bool { return could_reverse_func(segments[idx]); };
+			std::vector<std::pair<size_t, bool>> chain = chain_cell_func(cell_end_point, cell_could_reverse, cell_num_segments);
+			assert(chain.size() == cell_num_segments);
+			std::pair<size_t, bool> *dst = out.data() + cell_begin[cell];
+			for (const std::pair<size_t, bool> &segment : chain) {
+				*dst ++ = std::make_pair(segments[segment.first], segment.second);
+				if (! could_reverse_func(segments[segment.first]))
+					cell_reversible[cell] = false;
+			}
+		}
+	});
+
+	// Stitch the chains of the cells.
+	auto chain_first_point = [&end_point_func](const std::pair<size_t, bool> &segment) -> Vec2d { return end_point_func(segment.first, ! segment.second).template cast<double>(); };
+	auto chain_last_point  = [&end_point_func](const std::pair<size_t, bool> &segment) -> Vec2d { return end_point_func(segment.first,   segment.second).template cast<double>(); };
+	bool  has_last_point = start_near != nullptr;
+	Vec2d last_point     = Vec2d::Zero();
+	if (has_last_point)
+		last_point = start_near->template cast<double>();
+	for (size_t cell = 0; cell < num_cells; ++ cell) {
+		auto begin = out.begin() + cell_begin[cell];
+		auto end   = out.begin() + cell_begin[cell + 1];
+		if (begin == end)
+			continue;
+		if (has_last_point && cell_reversible[cell] && 
+			(chain_last_point(*(end - 1)) - last_point).squaredNorm() < (chain_first_point(*begin) - last_point).squaredNorm()) {
+			std::reverse(begin, end);
+			for (auto it = begin; it != end; ++ it)
+				it->second = ! it->second;
+		}
+		last_point     = chain_last_point(*(end - 1));
+		has_last_point = true;
+	}
+
+#ifndef NDEBUG
+	{
+		std::vector<char> visited(num_segments, false);
+		for (const std::pair<size_t, bool> &segment : out) {
+			assert(! visited[segment.first]);
+			assert(could_reverse_func(segment.first) || ! segment.second);
+			visited[segment.first] = true;
+		}
+	}
+#endif /* NDEBUG */
+	return out;
+}
+
+std::vector<std::pair<size_t, bool>> chain_extrusion_entities(const std::vector<ExtrusionEntity*> &entities, const Point *start_near)
 {
 	auto segment_end_point = [&entities](size_t idx, bool first_point) -> const Point& { return first_point ? entities[idx]->first_point() : entities[idx]->last_point(); };
 	auto could_reverse = [&entities](size_t idx) { const ExtrusionEntity *ee = entities[idx]; return ee->is_loop() || ee->can_reverse(); };
-	std::vector<std::pair<size_t, bool>> out = chain_segments_greedy_constrained_reversals<Point, decltype(segment_end_point), decltype(could_reverse)>(segment_end_point, could_reverse, entities.size(), start_near);
+	std::vector<std::pair<size_t, bool>> out;
+	if (entities.size() >= chain_partitioned_min_segments) {
+		auto chain_cell = [](auto &end_point_func, auto &could_reverse_func, size_t num_segments) {
+			return chain_segments_greedy_constrained_reversals<Point, std::decay_t<decltype(end_point_func)>, std::decay_t<decltype(could_reverse_func)>>(
+				end_point_func, could_reverse_func, num_segments, static_cast<const Point*>(nullptr));
+		};
+		out = chain_segments_partitioned<Point>(segment_end_point, could_reverse, entities.size(), start_near, chain_cell);
+	} else
+		out = chain_segments_greedy_constrained_reversals<Point, decltype(segment_end_point), decltype(could_reverse)>(segment_end_point, could_reverse, entities.size(), start_near);
 	for (std::pair<size_t, bool> &segment : out) {
 		ExtrusionEntity *ee = entities[segment.first];
 		if (ee->is_loop())
@@ -1524,11 +1634,17 @@ static inline void do_crossover(const std::vector<FlipEdge> &edges_in, std::vect
 	assert(edges_in.size() == edges_out.size());
 }
 
-static inline void reorder_by_two_exchanges_with_segment_flipping(std::vector<FlipEdge> &edges)
+// Each iteration of the two exchanges is quadratic in the number of edges, therefore the refinement is stopped once it runs out of time_budget
+// (in seconds), keeping the improvements applied so far.
+static inline void reorder_by_two_exchanges_with_segment_flipping(std::vector<FlipEdge> &edges, double time_budget = std::numeric_limits<double>::max())
 {
 	if (edges.size() < 2)
 		return;
 
+	using clock = std::chrono::steady_clock;
+	const clock::time_point deadline = time_budget < 3600. ? 
+		clock::now() + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(time_budget)) : clock::time_point::max();
+
 	std::vector<ConnectionCost> 			connections(edges.size());
 	std::vector<FlipEdge> 					edges_tmp(edges);
 	std::vector<std::pair<double, size_t>>	connection_lengths(edges.size() - 1, std::pair<double, size_t>(0., 0));
@@ -1551,6 +1667,8 @@ static inline void reorder_by_two_exchanges_with_segment_flipping(std::vector<Fl
 		size_t crossover2_pos_final = std::numeric_limits<size_t>::max();
 		size_t crossover_flip_final = 0;
 		for (const std::pair<double, size_t> &first_crossover_candidate : connection_lengths) {
+			if (clock::now() > deadline)
+				break;
 			double longest_connection_length = first_crossover_candidate.first;
 			size_t longest_connection_idx    = first_crossover_candidate.second;
 			connection_tried[longest_connection_idx] = true;
@@ -1592,7 +1710,7 @@ static inline void reorder_by_two_exchanges_with_segment_flipping(std::vector<Fl
 			do_crossover(edges, edges_tmp, std::make_pair(size_t(0), crossover1_pos_final), std::make_pair(crossover1_pos_final, crossover2_pos_final), std::make_pair(crossover2_pos_final, edges.size()), crossover_flip_final);
 			edges.swap(edges_tmp);
 		} else {
-			// No valid pair of cross over positions was found improving the total cost. Giving up.
+			// No valid pair of cross over positions was found improving the total cost or the time budget was spent. Giving up.
 			break;
 		}
 	}
@@ -1848,6 +1966,9 @@ static inline void reorder_by_three_exchanges_with_segment_flipping2(std::vector
 	}
 }
 
+// Time in seconds spent at most by improve_ordering_by_two_exchanges_with_segment_flipping() on a single set of polylines.
+static constexpr const double two_exchanges_time_budget = 0.25;
+
 // Flip the sequences of polylines to lower the total length of connecting lines.
 static inline void improve_ordering_by_two_exchanges_with_segment_flipping(Polylines &polylines, bool fixed_start)
 {
@@ -1872,7 +1993,7 @@ static inline void improve_ordering_by_two_exchanges_with_segment_flipping(Polyl
     std::transform(polylines.begin(), polylines.end(), std::back_inserter(edges), 
     	[&polylines](const Polyline &pl){ return FlipEdge(pl.first_point().cast<double>(), pl.last_point().cast<double>(), &pl - polylines.data()); });
 #if 1
-	reorder_by_two_exchanges_with_segment_flipping(edges);
+	reorder_by_two_exchanges_with_segment_flipping(edges, two_exchanges_time_budget);
 #else
 	// reorder_by_three_exchanges_with_segment_flipping(edges);
 	reorder_by_three_exchanges_with_segment_flipping2(edges);
@@ -1911,7 +2032,15 @@ Polylines chain_polylines(Polylines &&polylines, const Point *start_near)
 	Polylines out;
 	if (! polylines.empty()) {
 		auto segment_end_point = [&polylines](size_t idx, bool first_point) -> const Point& { return first_point ? polylines[idx].first_point() : polylines[idx].last_point(); };
-		std::vector<std::pair<size_t, bool>> ordered = chain_segments_greedy2<Point, decltype(segment_end_point)>(segment_end_point, polylines.size(), start_near);
+		std::vector<std::pair<size_t, bool>> ordered;
+		if (polylines.size() >= chain_partitioned_min_segments) {
+			auto could_reverse = [](size_t /* idx */) -> bool { return true; };
+			auto chain_cell = [](auto &end_point_func, auto & /* could_reverse_func */, size_t num_segments) {
+				return chain_segments_greedy2<Point, std::decay_t<decltype(end_point_func)>>(end_point_func, num_segments, static_cast<const Point*>(nullptr));
+			};
+			ordered = chain_segments_partitioned<Point>(segment_end_point, could_reverse, polylines.size(), start_near, chain_cell);
+		} else
+			ordered = chain_segments_greedy2<Point, decltype(segment_end_point)>(segment_end_point, polylines.size(), start_near);
 		out.reserve(polylines.size()); 
 		for (auto &segment_and_reversal : ordered) {
 			out.emplace_back(std::move(polylines[segment_and_reversal.first]));
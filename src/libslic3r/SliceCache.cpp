@@ -0,0 +1,284 @@
+#include "SliceCache.hpp"
+#include "TriangleMesh.hpp"
+#include "Utils.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+
+#include <boost/filesystem.hpp>
+#include <boost/log/trivial.hpp>
+#include <boost/nowide/fstream.hpp>
+
+namespace Slic3r {
+
+// Bump the version to invalidate the cached slices, if the slicing or the file format changes.
+static const uint32_t SLICE_CACHE_VERSION = 1;
+static const char     SLICE_CACHE_MAGIC[4] = { 'P', 'S', 'S', 'L' };
+
+struct SliceCacheHeader
+{
+    char     magic[4];
+    uint32_t version;
+    uint32_t coord_size;
+    uint32_t num_layers;
+};
+
+static std::atomic<size_t> s_max_size(0);
+// Serializes the trimming of the cache directory by the objects sliced in parallel.
+static std::mutex          s_trim_mutex;
+
+// 64bit FNV-1a hash, stable between the runs and the builds of the application.
+static void hash_bytes(uint64_t &hash, const void *data, size_t size)
+{
+    const unsigned char *bytes = reinterpret_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++ i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+}
+
+// Same as above, but mixing in 32bit words, hashing the meshes of millions of triangles byte by byte would be slow.
+static void hash_words(uint64_t &hash, const uint32_t *data, size_t count)
+{
+    for (size_t i = 0; i < count; ++ i) {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+}
+
+static boost::filesystem::path slice_cache_dir()
+{
+    return boost::filesystem::path(data_dir()) / "cache" / "slices";
+}
+
+void SliceCache::enable(size_t max_size)
+{
+    s_max_size = max_size;
+}
+
+bool SliceCache::enabled()
+{
+    return s_max_size > 0 && ! data_dir().empty();
+}
+
+std::string SliceCache::key(const TriangleMesh &mesh, const Transform3d &trafo, float closing_radius)
+{
+    if (! enabled())
+        return std::string();
+
+    uint64_t hash       = 14695981039346656037ull;
+    uint32_t num_facets = uint32_t(mesh.stl.facet_start.size());
+    hash_bytes(hash, &SLICE_CACHE_VERSION, sizeof(SLICE_CACHE_VERSION));
+    hash_bytes(hash, &num_facets, sizeof(num_facets));
+    static_assert(sizeof(stl_vertex) == 3 * sizeof(uint32_t), "stl_vertex is expected to be made of three floats");
+    for (const stl_facet &facet : mesh.stl.facet_start)
+        hash_words(hash, reinterpret_cast<const uint32_t*>(facet.vertex[0].data()), 3 * 3);
+    hash_bytes(hash, trafo.matrix().data(), 16 * sizeof(double));
+    hash_bytes(hash, &closing_radius, sizeof(closing_radius));
+
+    char buf[17];
+    sprintf(buf, "%016llx", (unsigned long long)hash);
+    return std::string(buf);
+}
+
+template<typename T> static void write_value(std::vector<char> &out, const T &value)
+{
+    const char *data = reinterpret_cast<const char*>(&value);
+    out.insert(out.end(), data, data + sizeof(T));
+}
+
+static void write_polygon(std::vector<char> &out, const Polygon &polygon)
+{
+    write_value(out, uint32_t(polygon.points.size()));
+    for (const Point &pt : polygon.points) {
+        write_value(out, pt(0));
+        write_value(out, pt(1));
+    }
+}
+
+// Reader of the file loaded into memory, which refuses to read past its end.
+class SliceCacheReader
+{
+public:
+    SliceCacheReader(const std::vector<char> &data) : m_data(data) {}
+
+    template<typename T> bool read(T &value) {
+        if (m_pos + sizeof(T) > m_data.size())
+            return false;
+        ::memcpy(&value, m_data.data() + m_pos, sizeof(T));
+        m_pos += sizeof(T);
+        return true;
+    }
+
+    bool read_polygon(Polygon &polygon) {
+        uint32_t num_points;
+        if (! this->read(num_points) || size_t(num_points) * 2 * sizeof(coord_t) > m_data.size() - m_pos)
+            return false;
+        polygon.points.assign(num_points, Point());
+        for (Point &pt : polygon.points)
+            if (! this->read(pt(0)) || ! this->read(pt(1)))
+                return false;
+        return true;
+    }
+
+    bool at_end() const { return m_pos == m_data.size(); }
+
+private:
+    const std::vector<char> &m_data;
+    size_t                   m_pos = 0;
+};
+
+bool SliceCache::load(const std::string &key, std::vector<std::pair<float, ExPolygons>> &layers)
+{
+    if (key.empty())
+        return false;
+
+    boost::filesystem::path path = slice_cache_dir() / (key + ".slices");
+    std::vector<char> data;
+    {
+        boost::nowide::ifstream file(path.string(), std::ios::binary | std::ios::ate);
+        if (! file.good())
+            return false;
+        data.resize(size_t(file.tellg()));
+        file.seekg(0);
+        if (! file.read(data.data(), std::streamsize(data.size())))
+            return false;
+    }
+
+    SliceCacheReader reader(data);
+    SliceCacheHeader header;
+    if (! reader.read(header) ||
+        ::memcmp(header.magic, SLICE_CACHE_MAGIC, sizeof(header.magic)) != 0 || header.version != SLICE_CACHE_VERSION ||
+        header.coord_size != sizeof(coord_t))
+        return false;
+
+    std::vector<std::pair<float, ExPolygons>> out;
+    out.reserve(std::min<size_t>(header.num_layers, data.size() / (sizeof(float) + sizeof(uint32_t))));
+    for (uint32_t i = 0; i < header.num_layers; ++ i) {
+        float    z;
+        uint32_t num_expolygons;
+        if (! reader.read(z) || ! reader.read(num_expolygons))
+            return false;
+        out.emplace_back(z, ExPolygons());
+        ExPolygons &expolygons = out.back().second;
+        for (uint32_t j = 0; j < num_expolygons; ++ j) {
+            uint32_t num_holes;
+            if (! reader.read(num_holes))
+                return false;
+            expolygons.emplace_back();
+            ExPolygon &expoly = expolygons.back();
+            if (! reader.read_polygon(expoly.contour))
+                return false;
+            for (uint32_t k = 0; k < num_holes; ++ k) {
+                expoly.holes.emplace_back();
+                if (! reader.read_polygon(expoly.holes.back()))
+                    return false;
+            }
+        }
+    }
+    if (! reader.at_end())
+        // Truncated or corrupted file.
+        return false;
+
+    // Mark the file as recently used, so that it is removed last when trimming the cache.
+    boost::system::error_code ec;
+    boost::filesystem::last_write_time(path, std::time(nullptr), ec);
+
+    layers = std::move(out);
+    return true;
+}
+
+// Remove the least recently used files until the total size of the cache fits the limit.
+static void trim_cache(const boost::filesystem::path &dir, size_t max_size)
+{
+    std::lock_guard<std::mutex> lock(s_trim_mutex);
+    struct CacheFile {
+        boost::filesystem::path path;
+        std::time_t             mtime;
+        uintmax_t               size;
+    };
+    std::vector<CacheFile> files;
+    uintmax_t              total_size = 0;
+    boost::system::error_code ec;
+    for (boost::filesystem::directory_iterator it(dir, ec), end; ! ec && it != end; it.increment(ec)) {
+        const boost::filesystem::path &path = it->path();
+        if (path.extension() != ".slices")
+            continue;
+        boost::system::error_code ec2;
+        CacheFile file { path, boost::filesystem::last_write_time(path, ec2), boost::filesystem::file_size(path, ec2) };
+        if (! ec2) {
+            total_size += file.size;
+            files.emplace_back(std::move(file));
+        }
+    }
+    if (total_size <= max_size)
+        return;
+    std::sort(files.begin(), files.end(), [](const CacheFile &l, const CacheFile &r) { return l.mtime < r.mtime; });
+    for (const CacheFile &file : files) {
+        if (total_size <= max_size)
+            break;
+        if (boost::filesystem::remove(file.path, ec))
+            total_size -= file.size;
+    }
+}
+
+void SliceCache::save(const std::string &key, const std::vector<std::pair<float, ExPolygons>> &layers)
+{
+    size_t max_size = s_max_size;
+    if (key.empty() || max_size == 0)
+        return;
+
+    std::vector<char> data;
+    SliceCacheHeader header;
+    ::memcpy(header.magic, SLICE_CACHE_MAGIC, sizeof(header.magic));
+    header.version    = SLICE_CACHE_VERSION;
+    header.coord_size = uint32_t(sizeof(coord_t));
+    header.num_layers = uint32_t(layers.size());
+    write_value(data, header);
+    for (const std::pair<float, ExPolygons> &layer : layers) {
+        write_value(data, layer.first);
+        write_value(data, uint32_t(layer.second.size()));
+        for (const ExPolygon &expoly : layer.second) {
+            write_value(data, uint32_t(expoly.holes.size()));
+            write_polygon(data, expoly.contour);
+            for (const Polygon &hole : expoly.holes)
+                write_polygon(data, hole);
+        }
+    }
+    if (data.size() > max_size)
+        // Storing the slices would evict the whole cache.
+        return;
+
+    boost::filesystem::path dir  = slice_cache_dir();
+    boost::filesystem::path path = dir / (key + ".slices");
+    boost::filesystem::path path_tmp;
+    try {
+        if (! boost::filesystem::exists(dir))
+            boost::filesystem::create_directories(dir);
+        // Write into a temporary file first, so that another instance of the application never reads partially written slices.
+        path_tmp = dir / boost::filesystem::unique_path(key + ".slices.%%%%%%%%");
+        {
+            boost::nowide::ofstream file(path_tmp.string(), std::ios::binary);
+            file.write(data.data(), std::streamsize(data.size()));
+            if (! file.good())
+                throw std::runtime_error("Failed writing " + path_tmp.string());
+        }
+        boost::filesystem::rename(path_tmp, path);
+    } catch (const std::exception &ex) {
+        BOOST_LOG_TRIVIAL(debug) << "SliceCache: Failed storing the slices " << key << ": " << ex.what();
+        if (! path_tmp.empty()) {
+            boost::system::error_code ec;
+            boost::filesystem::remove(path_tmp, ec);
+        }
+        return;
+    }
+
+    trim_cache(dir, max_size);
+}
+
+} // namespace Slic3r
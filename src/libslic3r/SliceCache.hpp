@@ -0,0 +1,40 @@
+#ifndef slic3r_SliceCache_hpp_
+#define slic3r_SliceCache_hpp_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ExPolygon.hpp"
+#include "Point.hpp"
+
+namespace Slic3r {
+
+class TriangleMesh;
+
+// On-disk cache of the slices of the model volumes, stored in data_dir()/cache/slices, so that reopening a project
+// with large meshes does not slice them again. The slices of a volume are keyed by the content of its mesh,
+// by its transformation and by the closing radius, so the key does not depend on the file the mesh was loaded from.
+// Only the mesh slices are cached, the perimeters, infill and supports are generated from them each time.
+// The cache is disabled by default, it is enabled by the application from the preferences.
+class SliceCache
+{
+public:
+    // Enable the cache with the given limit of the total size of the cache files in bytes, zero disables the cache.
+    // When the limit is exceeded, the least recently used files are removed.
+    static void enable(size_t max_size);
+    static bool enabled();
+
+    // Key of the slices of a mesh transformed by the given transformation (including the XY shift of the object).
+    // Returns an empty key if the cache is disabled or if the data directory is not set.
+    static std::string key(const TriangleMesh &mesh, const Transform3d &trafo, float closing_radius);
+
+    // Load the slices sorted by their Z, returns false on a cache miss.
+    static bool load(const std::string &key, std::vector<std::pair<float, ExPolygons>> &layers);
+    // Store the slices sorted by their Z, failures are logged and ignored.
+    static void save(const std::string &key, const std::vector<std::pair<float, ExPolygons>> &layers);
+};
+
+} // namespace Slic3r
+
+#endif // slic3r_SliceCache_hpp_
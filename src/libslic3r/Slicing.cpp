@@ -232,6 +232,11 @@ std::vector<double> layer_height_profile_adaptive(const SlicingParameters& slici
     as.prepare(object);
 
     // 2) Generate layers using the algorithm of @platsch 
+    return layer_height_profile_adaptive(slicing_params, as, quality_factor);
+}
+
+std::vector<double> layer_height_profile_adaptive(const SlicingParameters& slicing_params, const SlicingAdaptive& as, float quality_factor)
+{
     std::vector<double> layer_height_profile;
     layer_height_profile.push_back(0.0);
     layer_height_profile.push_back(slicing_params.first_object_layer_height);
@@ -240,7 +245,7 @@ std::vector<double> layer_height_profile_adaptive(const SlicingParameters& slici
         layer_height_profile.push_back(slicing_params.first_object_layer_height);
     }
     double print_z = slicing_params.first_object_layer_height;
-    // last facet visited by the as.next_layer_height() function, where the facets are sorted by their increasing Z span.
+    // first facet above the last print_z found by the as.next_layer_height() function, where the facets are sorted by their increasing Z span.
     size_t current_facet = 0;
     // loop until we have at least one layer and the max slice_z reaches the object height
     while (print_z + EPSILON < slicing_params.object_print_z_height()) {
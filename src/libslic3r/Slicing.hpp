@@ -19,6 +19,7 @@ namespace Slic3r
 class PrintConfig;
 class PrintObjectConfig;
 class ModelObject;
+class SlicingAdaptive;
 
 // Parameters to guide object slicing and support generation.
 // The slicing parameters account for a raft and whether the 1st object layer is printed with a normal or a bridging flow
@@ -140,6 +141,11 @@ extern std::vector<coordf_t> layer_height_profile_from_ranges(
 extern std::vector<double> layer_height_profile_adaptive(
     const SlicingParameters& slicing_params,
     const ModelObject& object, float quality_factor);
+// Generate the profile from a SlicingAdaptive prepared for the object with the same slicing parameters,
+// to be reused for varying quality factors.
+extern std::vector<double> layer_height_profile_adaptive(
+    const SlicingParameters& slicing_params,
+    const SlicingAdaptive& slicing_adaptive, float quality_factor);
 
 struct HeightProfileSmoothingParams
 {
@@ -3,8 +3,14 @@
 #include "TriangleMesh.hpp"
 #include "SlicingAdaptive.hpp"
 
+#include <cfloat>
+#include <limits>
+
 #include <boost/log/trivial.hpp>
 
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_sort.h>
+
 // Based on the work of Florens Waserfall (@platch on github)
 // and his paper
 // Florens Wasserfall, Norman Hendrich, Jianwei Zhang:
@@ -73,35 +79,100 @@ static inline float layer_height_from_slope(const SlicingAdaptive::FaceZ &face,
 //    return float(max_surface_deviation * face.n_sin);
 }
 
+// Tangent of the angle of the face normal towards the Z axis, FLT_MAX for a vertical normal (horizontal face).
+static inline float face_slope(const SlicingAdaptive::FaceZ &face)
+{
+	return (face.n_cos > 1e-5) ? face.n_sin / face.n_cos : FLT_MAX;
+}
+
+// layer_height_from_slope() expressed as a function of face_slope(). As the layer height does not decrease with the slope,
+// the minimum layer height over a set of faces is the layer height of the face with the minimum slope.
+// Keep in sync with layer_height_from_slope().
+static inline float layer_height_from_min_slope(float slope, float max_surface_deviation)
+{
+    return std::min(max_surface_deviation / 0.184f, (slope < FLT_MAX) ? float(1.44 * max_surface_deviation * sqrt(slope)) : FLT_MAX);
+}
+
 void SlicingAdaptive::clear()
 {
 	m_faces.clear();
+	m_z_slots.clear();
+	m_slope_tree_leaves = 0;
+	m_slope_tree.clear();
 }
 
 void SlicingAdaptive::prepare(const ModelObject &object)
 {
     this->clear();
 
-    TriangleMesh		 mesh			= object.raw_mesh();
     const ModelInstance &first_instance = *object.instances.front();
-    mesh.transform(first_instance.get_matrix(), first_instance.is_left_handed());
 
-    // 1) Collect faces from mesh.
-    m_faces.reserve(mesh.stl.stats.number_of_facets);
-    for (const stl_facet &face : mesh.stl.facet_start) {
-    	Vec3f n = face.normal.normalized();
-		m_faces.emplace_back(FaceZ({ face_z_span(face), std::abs(n.z()), std::sqrt(n.x() * n.x() + n.y() * n.y()) }));
-    }
+    // 1) Collect faces from the volume meshes transformed by the first instance, without copying the meshes.
+    size_t num_faces = 0;
+    object.visit_raw_meshes([&num_faces](const TriangleMesh &mesh, const Transform3d &) { num_faces += mesh.stl.facet_start.size(); });
+    m_faces.assign(num_faces, FaceZ());
+    size_t offset = 0;
+    object.visit_raw_meshes([this, &first_instance, &offset](const TriangleMesh &mesh, const Transform3d &volume_matrix) {
+        Transform3d trafo 		  = first_instance.get_matrix() * volume_matrix;
+        Matrix3d    normal_matrix = trafo.linear().inverse().transpose();
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, mesh.stl.facet_start.size()),
+            [this, &mesh, &trafo, &normal_matrix, offset](const tbb::blocked_range<size_t> &range) {
+            for (size_t i = range.begin(); i < range.end(); ++ i) {
+                const stl_facet &face = mesh.stl.facet_start[i];
+                stl_facet f;
+                for (size_t j = 0; j < 3; ++ j)
+                    f.vertex[j] = (trafo * face.vertex[j].cast<double>()).cast<float>();
+                Vec3f n = (normal_matrix * face.normal.cast<double>()).cast<float>().normalized();
+                m_faces[offset + i] = FaceZ({ face_z_span(f), std::abs(n.z()), std::sqrt(n.x() * n.x() + n.y() * n.y()) });
+            }
+        });
+        offset += mesh.stl.facet_start.size();
+    });
 
 	// 2) Sort faces lexicographically by their Z span.
-	std::sort(m_faces.begin(), m_faces.end(), [](const FaceZ &f1, const FaceZ &f2) { return f1.z_span < f2.z_span; });
+	tbb::parallel_sort(m_faces.begin(), m_faces.end(), [](const FaceZ &f1, const FaceZ &f2) { return f1.z_span < f2.z_span; });
+
+	// 3) Index the slopes of the faces by Z. next_layer_height() considers a face at print_z,
+	// if zspan.first < print_z && print_z <= zspan.second - EPSILON.
+	m_z_slots.reserve(2 * m_faces.size());
+	for (const FaceZ &face : m_faces)
+		if (double(face.z_span.first) < double(face.z_span.second) - EPSILON) {
+			m_z_slots.emplace_back(face.z_span.first);
+			m_z_slots.emplace_back(double(face.z_span.second) - EPSILON);
+		}
+	tbb::parallel_sort(m_z_slots.begin(), m_z_slots.end());
+	m_z_slots.erase(std::unique(m_z_slots.begin(), m_z_slots.end()), m_z_slots.end());
+	m_z_slots.shrink_to_fit();
+
+	// The slot of a print_z is the number of the end points below print_z.
+	m_slope_tree_leaves = 1;
+	while (m_slope_tree_leaves < m_z_slots.size() + 1)
+		m_slope_tree_leaves <<= 1;
+	m_slope_tree.assign(2 * m_slope_tree_leaves, std::numeric_limits<float>::infinity());
+	for (const FaceZ &face : m_faces)
+		if (double(face.z_span.first) < double(face.z_span.second) - EPSILON) {
+			// The face covers the slots (idx_first, idx_last].
+			size_t idx_first = std::lower_bound(m_z_slots.begin(), m_z_slots.end(), double(face.z_span.first)) - m_z_slots.begin();
+			size_t idx_last  = std::lower_bound(m_z_slots.begin() + idx_first, m_z_slots.end(), double(face.z_span.second) - EPSILON) - m_z_slots.begin();
+			float  slope     = face_slope(face);
+			for (size_t l = idx_first + 1 + m_slope_tree_leaves, r = idx_last + 1 + m_slope_tree_leaves; l < r; l >>= 1, r >>= 1) {
+				if (l & 1) {
+					m_slope_tree[l] = std::min(m_slope_tree[l], slope);
+					++ l;
+				}
+				if (r & 1) {
+					-- r;
+					m_slope_tree[r] = std::min(m_slope_tree[r], slope);
+				}
+			}
+		}
 }
 
 // current_facet is in/out parameter, rememebers the index of the last face of m_faces visited, 
 // where this function will start from.
 // print_z - the top print surface of the previous layer.
 // returns height of the next layer.
-float SlicingAdaptive::next_layer_height(const float print_z, float quality_factor, size_t &current_facet)
+float SlicingAdaptive::next_layer_height(const float print_z, float quality_factor, size_t &current_facet) const
 {
 	float  height = (float)m_slicing_params.max_layer_height;
 
@@ -124,31 +195,23 @@ float SlicingAdaptive::next_layer_height(const float print_z, float quality_fact
 	    	lerp(delta_max, delta_mid, 2. * (1. - quality_factor));
 	}
 	
-	// find all facets intersecting the slice-layer
-	size_t ordered_id = current_facet;
-	{
-		bool first_hit = false;
-		for (; ordered_id < m_faces.size(); ++ ordered_id) {
-	        const std::pair<float, float> &zspan = m_faces[ordered_id].z_span;
-	        // facet's minimum is higher than slice_z -> end loop
-			if (zspan.first >= print_z)
-				break;
-			// facet's maximum is higher than slice_z -> store the first event for next cusp_height call to begin at this point
-			if (zspan.second > print_z) {
-				// first event?
-				if (! first_hit) {
-					first_hit = true;
-					current_facet = ordered_id;
-	            }
-				// skip touching facets which could otherwise cause small cusp values
-				if (zspan.second < print_z + EPSILON)
-					continue;
-				// compute cusp-height for this facet and store minimum of all heights
-				height = std::min(height, layer_height_from_slope(m_faces[ordered_id], max_surface_deviation));
-	        }
-		}
+	// find all facets intersecting the slice-layer and take the minimum of their cusp heights
+	if (! m_slope_tree.empty()) {
+		float min_slope = std::numeric_limits<float>::infinity();
+		size_t slot = std::lower_bound(m_z_slots.begin(), m_z_slots.end(), double(print_z)) - m_z_slots.begin();
+		for (size_t i = slot + m_slope_tree_leaves; i > 0; i >>= 1)
+			min_slope = std::min(min_slope, m_slope_tree[i]);
+		if (min_slope < std::numeric_limits<float>::infinity())
+			height = std::min(height, layer_height_from_min_slope(min_slope, max_surface_deviation));
 	}
 
+	// first facet starting at or above print_z
+	auto   z_span_first_lower = [](const FaceZ &face, float z) { return face.z_span.first < z; };
+	size_t ordered_id = (current_facet <= m_faces.size() && (current_facet == 0 || m_faces[current_facet - 1].z_span.first < print_z)) ?
+		std::lower_bound(m_faces.begin() + current_facet, m_faces.end(), print_z, z_span_first_lower) - m_faces.begin() :
+		std::lower_bound(m_faces.begin(), m_faces.end(), print_z, z_span_first_lower) - m_faces.begin();
+	current_facet = ordered_id;
+
 	// lower height limit due to printer capabilities
 	height = std::max(height, float(m_slicing_params.min_layer_height));
 
@@ -197,9 +260,10 @@ float SlicingAdaptive::next_layer_height(const float print_z, float quality_fact
 
 // Returns the distance to the next horizontal facet in Z-dir 
 // to consider horizontal object features in slice thickness
-float SlicingAdaptive::horizontal_facet_distance(float z)
+float SlicingAdaptive::horizontal_facet_distance(float z) const
 {
-	for (size_t i = 0; i < m_faces.size(); ++ i) {
+	size_t i_begin = std::upper_bound(m_faces.begin(), m_faces.end(), z, [](float z, const FaceZ &face) { return z < face.z_span.first; }) - m_faces.begin();
+	for (size_t i = i_begin; i < m_faces.size(); ++ i) {
         std::pair<float, float> zspan = m_faces[i].z_span;
         // facet's minimum is higher than max forward distance -> end loop
 		if (zspan.first > z + m_slicing_params.max_layer_height)
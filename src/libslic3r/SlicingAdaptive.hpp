@@ -16,12 +16,16 @@ class SlicingAdaptive
 public:
     void  clear();
     void  set_slicing_parameters(SlicingParameters params) { m_slicing_params = params; }
+    // Collect the facets of the object and index them by Z. The index does not depend on the quality,
+    // thus a prepared SlicingAdaptive may be reused to generate the profiles for varying quality factors.
     void  prepare(const ModelObject &object);
+    bool  empty() const { return m_faces.empty(); }
     // Return next layer height starting from the last print_z, using a quality measure
     // (quality in range from 0 to 1, 0 - highest quality at low layer heights, 1 - lowest print quality at high layer heights).
     // The layer height curve shall be centered roughly around the default profile's layer height for quality 0.5.
-	float next_layer_height(const float print_z, float quality, size_t &current_facet);
-    float horizontal_facet_distance(float z);
+    // current_facet is a hint to speed up the queries if the layers are generated bottom up.
+	float next_layer_height(const float print_z, float quality, size_t &current_facet) const;
+    float horizontal_facet_distance(float z) const;
 
 	struct FaceZ {
 		std::pair<float, float> z_span;
@@ -34,7 +38,16 @@ public:
 protected:
 	SlicingParameters 		m_slicing_params;
 
+	// Faces sorted lexicographically by their Z span.
 	std::vector<FaceZ>		m_faces;
+
+	// Index answering the minimum slope of the faces crossing a given Z in O(log n):
+	// Sorted unique end points of the Z spans of the faces, splitting the Z axis into m_z_slots.size() + 1 slots.
+	std::vector<double>		m_z_slots;
+	// Bottom up segment tree over the Z slots, storing the minimum slope (tangent of the angle of the face normal
+	// towards the Z axis) of the faces covering the whole interval of a node. The slopes do not depend on the quality.
+	size_t 					m_slope_tree_leaves { 0 };
+	std::vector<float>		m_slope_tree;
 };
 
 }; // namespace Slic3r
@@ -6,14 +6,15 @@
 #include "Fill/FillBase.hpp"
 #include "EdgeGrid.hpp"
 #include "Geometry.hpp"
+#include "Trace.hpp"
 
 #include <cmath>
 #include <memory>
+#include <optional>
 #include <boost/log/trivial.hpp>
 
 #include <tbb/parallel_for.h>
 #include <tbb/atomic.h>
-#include <tbb/spin_mutex.h>
 #include <tbb/task_group.h>
 
 // #define SLIC3R_DEBUG
@@ -179,27 +180,14 @@ PrintObjectSupportMaterial::PrintObjectSupportMaterial(const PrintObject *object
     }
 }
 
-// Using the std::deque as an allocator.
+// Using the tbb::concurrent_vector as an allocator. Thread safe, the layers already allocated are never moved.
 inline PrintObjectSupportMaterial::MyLayer& layer_allocate(
-    std::deque<PrintObjectSupportMaterial::MyLayer> &layer_storage, 
-    PrintObjectSupportMaterial::SupporLayerType      layer_type)
+    PrintObjectSupportMaterial::MyLayerStorage  &layer_storage, 
+    PrintObjectSupportMaterial::SupporLayerType  layer_type)
 { 
-    layer_storage.push_back(PrintObjectSupportMaterial::MyLayer());
-    layer_storage.back().layer_type = layer_type;
-    return layer_storage.back();
-}
-
-inline PrintObjectSupportMaterial::MyLayer& layer_allocate(
-    std::deque<PrintObjectSupportMaterial::MyLayer> &layer_storage,
-    tbb::spin_mutex                                 &layer_storage_mutex,
-    PrintObjectSupportMaterial::SupporLayerType      layer_type)
-{ 
-    layer_storage_mutex.lock();
-    layer_storage.push_back(PrintObjectSupportMaterial::MyLayer());
-    PrintObjectSupportMaterial::MyLayer *layer_new = &layer_storage.back();
-    layer_storage_mutex.unlock();
-    layer_new->layer_type = layer_type;
-    return *layer_new;
+    PrintObjectSupportMaterial::MyLayer &layer_new = *layer_storage.grow_by(1);
+    layer_new.layer_type = layer_type;
+    return layer_new;
 }
 
 inline void layers_append(PrintObjectSupportMaterial::MyLayersPtr &dst, const PrintObjectSupportMaterial::MyLayersPtr &src)
@@ -218,16 +206,20 @@ struct MyLayersPtrCompare
 void PrintObjectSupportMaterial::generate(PrintObject &object)
 {
     BOOST_LOG_TRIVIAL(info) << "Support generator - Start";
+    SLIC3R_TRACE_ZONE("Support::generate", "support");
+    // Zone of the current phase of the support generator.
+    std::optional<tracing::Zone> phase;
 
     coordf_t max_object_layer_height = 0.;
     for (size_t i = 0; i < object.layer_count(); ++ i)
         max_object_layer_height = std::max(max_object_layer_height, object.layers()[i]->height);
 
-    // Layer instances will be allocated by std::deque and they will be kept until the end of this function call.
+    // Layer instances will be allocated by a tbb::concurrent_vector and they will be kept until the end of this function call.
     // The layers will be referenced by various LayersPtr (of type std::vector<Layer*>)
     MyLayerStorage layer_storage;
 
     BOOST_LOG_TRIVIAL(info) << "Support generator - Creating top contacts";
+    phase.emplace("Support::top_contacts", "support");
 
     // Determine the top contact surfaces of the support, defined as:
     // contact = overhangs - clearance + margin
@@ -236,6 +228,9 @@ void PrintObjectSupportMaterial::generate(PrintObject &object)
     // that it will be effective, regardless of how it's built below.
     // If raft is to be generated, the 1st top_contact layer will contain the 1st object layer silhouette without holes.
     MyLayersPtr top_contacts = this->top_contact_layers(object, layer_storage);
+    // Release the offsets of the object slices cached by top_contact_layers().
+    for (const Layer *layer : object.layers())
+        layer->clear_lslices_offsets();
     if (top_contacts.empty())
         // Nothing is supported, no supports are generated.
         return;
@@ -250,6 +245,7 @@ void PrintObjectSupportMaterial::generate(PrintObject &object)
 #endif /* SLIC3R_DEBUG */
 
     BOOST_LOG_TRIVIAL(info) << "Support generator - Creating bottom contacts";
+    phase.emplace("Support::bottom_contacts", "support");
 
     // Determine the bottom contact surfaces of the supports over the top surfaces of the object.
     // Depending on whether the support is soluble or not, the contact layer thickness is decided.
@@ -268,6 +264,7 @@ void PrintObjectSupportMaterial::generate(PrintObject &object)
 #endif /* SLIC3R_DEBUG */
 
     BOOST_LOG_TRIVIAL(info) << "Support generator - Creating intermediate layers - indices";
+    phase.emplace("Support::intermediate_layers", "support");
 
     // Allocate empty layers between the top / bottom support contact layers
     // as placeholders for the base and intermediate support layers.
@@ -290,6 +287,7 @@ void PrintObjectSupportMaterial::generate(PrintObject &object)
 #endif
 
     BOOST_LOG_TRIVIAL(info) << "Support generator - Creating base layers";
+    phase.emplace("Support::base_layers", "support");
 
     // Fill in intermediate layers between the top / bottom support contact layers, trimm them by the object.
     this->generate_base_layers(object, bottom_contacts, top_contacts, intermediate_layers, layer_support_areas);
@@ -302,6 +300,7 @@ void PrintObjectSupportMaterial::generate(PrintObject &object)
 #endif /* SLIC3R_DEBUG */
 
     BOOST_LOG_TRIVIAL(info) << "Support generator - Trimming top contacts by bottom contacts";
+    phase.emplace("Support::trim_top_contacts", "support");
 
     // Because the top and bottom contacts are thick slabs, they may overlap causing over extrusion 
     // and unwanted strong bonds to the object.
@@ -311,12 +310,14 @@ void PrintObjectSupportMaterial::generate(PrintObject &object)
 
 
     BOOST_LOG_TRIVIAL(info) << "Support generator - Creating interfaces";
+    phase.emplace("Support::interfaces", "support");
 
     // Propagate top / bottom contact layers to generate interface layers.
     MyLayersPtr interface_layers = this->generate_interface_layers(
         bottom_contacts, top_contacts, intermediate_layers, layer_storage);
 
     BOOST_LOG_TRIVIAL(info) << "Support generator - Creating raft";
+    phase.emplace("Support::raft", "support");
 
     // If raft is to be generated, the 1st top_contact layer will contain the 1st object layer silhouette with holes filled.
     // There is also a 1st intermediate layer containing bases of support columns.
@@ -339,6 +340,7 @@ void PrintObjectSupportMaterial::generate(PrintObject &object)
 */
 
     BOOST_LOG_TRIVIAL(info) << "Support generator - Creating layers";
+    phase.emplace("Support::layers", "support");
 
 // For debugging purposes, one may want to show only some of the support extrusions.
 //    raft_layers.clear();
@@ -386,6 +388,7 @@ void PrintObjectSupportMaterial::generate(PrintObject &object)
     }
 
     BOOST_LOG_TRIVIAL(info) << "Support generator - Generating tool paths";
+    phase.emplace("Support::toolpaths", "support");
 
     // Generate the actual toolpaths and save them into each layer.
     this->generate_toolpaths(object, raft_layers, bottom_contacts, top_contacts, intermediate_layers, interface_layers);
@@ -417,6 +420,7 @@ void PrintObjectSupportMaterial::generate(PrintObject &object)
     }
 #endif /* SLIC3R_DEBUG */
 
+    phase.reset();
     BOOST_LOG_TRIVIAL(info) << "Support generator - End";
 }
 
@@ -1012,9 +1016,8 @@ PrintObjectSupportMaterial::MyLayersPtr PrintObjectSupportMaterial::top_contact_
     // For each overhang layer, two supporting layers may be generated: One for the overhangs extruded with a bridging flow, 
     // and the other for the overhangs extruded with a normal flow.
     contact_out.assign(num_layers * 2, nullptr);
-    tbb::spin_mutex layer_storage_mutex;
     tbb::parallel_for(tbb::blocked_range<size_t>(this->has_raft() ? 0 : 1, num_layers),
-        [this, &object, &buildplate_covered, &enforcers, &blockers, support_auto, threshold_rad, &layer_storage, &layer_storage_mutex, &contact_out]
+        [this, &object, &buildplate_covered, &enforcers, &blockers, support_auto, threshold_rad, &layer_storage, &contact_out]
         (const tbb::blocked_range<size_t>& range) {
             for (size_t layer_id = range.begin(); layer_id < range.end(); ++ layer_id) 
             {
@@ -1067,11 +1070,11 @@ PrintObjectSupportMaterial::MyLayersPtr PrintObjectSupportMaterial::top_contact_
                         } else {
                             if (support_auto) {
                                 // Get the regions needing a suport, collapse very tiny spots.
-                                //FIXME cache the lower layer offset if this layer has multiple regions.
+                                // The lower layer offset is cached by the lower layer, it is the same for the regions sharing the extrusion width.
     #if 1
                                 diff_polygons = offset2(
                                     diff(layerm_polygons,
-                                         offset2(lower_layer_polygons, - 0.5f * fw, lower_layer_offset + 0.5f * fw, SUPPORT_SURFACES_OFFSET_PARAMETERS)), 
+                                         lower_layer.lslices_offset2(- 0.5f * fw, lower_layer_offset + 0.5f * fw, SUPPORT_SURFACES_OFFSET_PARAMETERS)), 
                                     //FIXME This offset2 is targeted to reduce very thin regions to support, but it may lead to
                                     // no support at all for not so steep overhangs.
                                     - 0.1f * fw, 0.1f * fw);
@@ -1165,7 +1168,7 @@ PrintObjectSupportMaterial::MyLayersPtr PrintObjectSupportMaterial::top_contact_
                                 slices_margin_cached_offset = slices_margin_offset;
                                 slices_margin_cached = (slices_margin_offset == 0.f) ? 
                                     lower_layer_polygons :
-                                    offset2(to_polygons(lower_layer.lslices), - no_interface_offset * 0.5f, slices_margin_offset + no_interface_offset * 0.5f, SUPPORT_SURFACES_OFFSET_PARAMETERS);
+                                    lower_layer.lslices_offset2(- no_interface_offset * 0.5f, slices_margin_offset + no_interface_offset * 0.5f, SUPPORT_SURFACES_OFFSET_PARAMETERS);
                                 if (! buildplate_covered.empty()) {
                                     // Trim the inflated contact surfaces by the top surfaces as well.
                                     polygons_append(slices_margin_cached, buildplate_covered[layer_id]);
@@ -1190,7 +1193,7 @@ PrintObjectSupportMaterial::MyLayersPtr PrintObjectSupportMaterial::top_contact_
                 
                 // Now apply the contact areas to the layer where they need to be made.
                 if (! contact_polygons.empty()) {
-                    MyLayer     &new_layer = layer_allocate(layer_storage, layer_storage_mutex, sltTopContact);
+                    MyLayer     &new_layer = layer_allocate(layer_storage, sltTopContact);
                     new_layer.idx_object_layer_above = layer_id;
                     MyLayer     *bridging_layer = nullptr;
                     if (layer_id == 0) {
@@ -1242,7 +1245,7 @@ PrintObjectSupportMaterial::MyLayersPtr PrintObjectSupportMaterial::top_contact_
                                 }
                                 if (bridging_print_z < new_layer.print_z - EPSILON) {
                                     // Allocate the new layer.
-                                    bridging_layer = &layer_allocate(layer_storage, layer_storage_mutex, sltTopContact);
+                                    bridging_layer = &layer_allocate(layer_storage, sltTopContact);
                                     bridging_layer->idx_object_layer_above = layer_id;
                                     bridging_layer->print_z = bridging_print_z;
                                     if (bridging_print_z == m_slicing_params.first_print_layer_height) {
@@ -1277,7 +1280,7 @@ PrintObjectSupportMaterial::MyLayersPtr PrintObjectSupportMaterial::top_contact_
                     } else  {
                         // Reduce the amount of dense interfaces: Do not generate dense interfaces below overhangs with 60% overhang of the extrusions.
                         Polygons dense_interface_polygons = diff(overhang_polygons, 
-                            offset2(lower_layer_polygons, - no_interface_offset * 0.5f, no_interface_offset * (0.6f + 0.5f), SUPPORT_SURFACES_OFFSET_PARAMETERS));
+                            object.layers()[layer_id-1]->lslices_offset2(- no_interface_offset * 0.5f, no_interface_offset * (0.6f + 0.5f), SUPPORT_SURFACES_OFFSET_PARAMETERS));
                         if (! dense_interface_polygons.empty()) {
                             dense_interface_polygons =
                                 // Achtung! The dense_interface_polygons need to be trimmed by slices_margin_cached, otherwise
@@ -2117,7 +2120,7 @@ void PrintObjectSupportMaterial::trim_support_layers_by_object(
                                 break;
                             some_region_overlaps = true;
                             polygons_append(polygons_trimming, 
-                                offset(to_expolygons(region->fill_surfaces.filter_by_type(stBottomBridge)), 
+                                offset(region->fill_surfaces.expolygons_by_type(stBottomBridge), 
                                        gap_xy_scaled, SUPPORT_SURFACES_OFFSET_PARAMETERS));
                             if (region->region()->config().overhangs.value)
                                 SupportMaterialInternal::collect_bridging_perimeter_areas(region->perimeters, gap_xy_scaled, polygons_trimming);
@@ -2240,9 +2243,8 @@ PrintObjectSupportMaterial::MyLayersPtr PrintObjectSupportMaterial::generate_int
         // For all intermediate layers, collect top contact surfaces, which are not further than support_material_interface_layers.
         BOOST_LOG_TRIVIAL(debug) << "PrintObjectSupportMaterial::generate_interface_layers() in parallel - start";
         interface_layers.assign(intermediate_layers.size(), nullptr);
-        tbb::spin_mutex layer_storage_mutex;
         tbb::parallel_for(tbb::blocked_range<size_t>(0, intermediate_layers.size()),
-            [this, &bottom_contacts, &top_contacts, &intermediate_layers, &layer_storage, &layer_storage_mutex, &interface_layers](const tbb::blocked_range<size_t>& range) {
+            [this, &bottom_contacts, &top_contacts, &intermediate_layers, &layer_storage, &interface_layers](const tbb::blocked_range<size_t>& range) {
                 // Index of the first top contact layer intersecting the current intermediate layer.
                 size_t idx_top_contact_first = size_t(-1);
                 // Index of the first bottom contact layer intersecting the current intermediate layer.
@@ -2278,7 +2280,7 @@ PrintObjectSupportMaterial::MyLayersPtr PrintObjectSupportMaterial::generate_int
                         continue;
 
                     // Insert a new layer into top_interface_layers.
-                    MyLayer &layer_new = layer_allocate(layer_storage, layer_storage_mutex,
+                    MyLayer &layer_new = layer_allocate(layer_storage,
                         polygons_top_contact_projected.empty() ? sltBottomInterface : sltTopInterface);
                     layer_new.print_z    = intermediate_layer.print_z;
                     layer_new.bottom_z   = intermediate_layer.bottom_z;
@@ -2770,16 +2772,42 @@ void modulate_extrusion_by_overlapping_layers(
 
     // Fragment the path segments by overlapping layers. The overlapping layers are sorted by an increasing print_z.
     // Trim by the highest overlapping layer first.
+    // Only the islands of the overlapping layers close to the paths are trimmed with, and only the paths close to the trimming
+    // regions are clipped, the other paths are passed through. The overlapping layers often span the whole object,
+    // while the paths of this_layer cover a few small interface spots.
+    const coord_t trimming_offset = coord_t(scale_(0.5*extrusion_width));
+    BoundingBox   bbox_paths      = get_extents(path_fragments.back().polylines);
+    bbox_paths.offset(trimming_offset + SCALED_EPSILON);
+    // Buffers reused by the overlapping layers.
+    Polygons      polygons_overlapping;
+    Polylines     polylines_to_clip;
+    Polylines     polylines_outside;
     for (int i_overlapping_layer = int(n_overlapping_layers) - 1; i_overlapping_layer >= 0; -- i_overlapping_layer) {
         const PrintObjectSupportMaterial::MyLayer &overlapping_layer = *overlapping_layers[i_overlapping_layer];
         ExtrusionPathFragment &frag = path_fragments[i_overlapping_layer];
-        Polygons polygons_trimming = offset(union_ex(overlapping_layer.polygons), float(scale_(0.5*extrusion_width)));
-        frag.polylines = intersection_pl(path_fragments.back().polylines, polygons_trimming, false);
-        path_fragments.back().polylines = diff_pl(path_fragments.back().polylines, polygons_trimming, false);
         // Adjust the extrusion parameters for a reduced layer height and a non-bridging flow (nozzle_dmr = -1, does not matter).
         assert(this_layer.print_z > overlapping_layer.print_z);
         frag.height = float(this_layer.print_z - overlapping_layer.print_z);
         frag.mm3_per_mm = Flow(frag.width, frag.height, -1.f, false).mm3_per_mm();
+        polygons_overlapping.clear();
+        for (const Polygon &polygon : overlapping_layer.polygons)
+            if (get_extents(polygon).overlap(bbox_paths))
+                polygons_overlapping.emplace_back(polygon);
+        if (polygons_overlapping.empty())
+            continue;
+        Polygons    polygons_trimming = offset(union_ex(polygons_overlapping), float(trimming_offset));
+        BoundingBox bbox_trimming     = get_extents(polygons_trimming);
+        polylines_to_clip.clear();
+        polylines_outside.clear();
+        for (Polyline &polyline : path_fragments.back().polylines)
+            (get_extents(polyline).overlap(bbox_trimming) ? polylines_to_clip : polylines_outside).emplace_back(std::move(polyline));
+        if (polylines_to_clip.empty()) {
+            path_fragments.back().polylines.swap(polylines_outside);
+            continue;
+        }
+        frag.polylines = intersection_pl(polylines_to_clip, polygons_trimming, false);
+        path_fragments.back().polylines = diff_pl(polylines_to_clip, polygons_trimming, false);
+        append(path_fragments.back().polylines, std::move(polylines_outside));
 #ifdef SLIC3R_DEBUG
         svg.draw(frag.polylines, dbg_index_to_color(i_overlapping_layer), scale_(0.1));
 #endif /* SLIC3R_DEBUG */
@@ -5,6 +5,8 @@
 #include "PrintConfig.hpp"
 #include "Slicing.hpp"
 
+#include <tbb/concurrent_vector.h>
+
 namespace Slic3r {
 
 class PrintObject;
@@ -139,10 +141,10 @@ public:
     	Polygons *overhang_polygons;
 	};
 
-	// Layers are allocated and owned by a deque. Once a layer is allocated, it is maintained
-	// up to the end of a generate() method. The layer storage may be replaced by an allocator class in the future, 
-	// which would allocate layers by multiple chunks.
-	typedef std::deque<MyLayer> 				MyLayerStorage;
+	// Layers are allocated and owned by a concurrent vector, which allocates the layers by chunks and never moves them,
+	// so that the layers may be allocated from multiple threads without locking. Once a layer is allocated, it is maintained
+	// up to the end of a generate() method.
+	typedef tbb::concurrent_vector<MyLayer> 	MyLayerStorage;
 	typedef std::vector<MyLayer*> 				MyLayersPtr;
 
 public:
@@ -3,6 +3,7 @@
 
 #include "libslic3r.h"
 #include "ExPolygon.hpp"
+#include "ExPolygonSet.hpp"
 
 namespace Slic3r {
 
@@ -165,6 +166,23 @@ inline ExPolygons to_expolygons(const SurfacesPtr &src)
     return expolygons;
 }
 
+inline ExPolygonSet to_expolygon_set(const Surfaces &src)
+{
+    ExPolygonSet expolygons;
+    size_t num_polygons = 0;
+    size_t num_points   = 0;
+    for (const Surface &surface : src) {
+        num_polygons += 1 + surface.expolygon.holes.size();
+        num_points   += surface.expolygon.contour.points.size();
+        for (const Polygon &hole : surface.expolygon.holes)
+            num_points += hole.points.size();
+    }
+    expolygons.reserve(src.size(), num_polygons, num_points);
+    for (const Surface &surface : src)
+        expolygons.append(surface.expolygon);
+    return expolygons;
+}
+
 // Count a nuber of polygons stored inside the vector of expolygons.
 // Useful for allocating space for polygons when converting expolygons to polygons.
 inline size_t number_polygons(const Surfaces &surfaces)
@@ -235,6 +253,23 @@ inline void surfaces_append(Surfaces &dst, const ExPolygons &src, const Surface
     for (const ExPolygon &expoly : src)
         dst.emplace_back(Surface(surfaceTempl, expoly));
 }
+inline void surfaces_append(Surfaces &dst, const ExPolygonSet &src, SurfaceType surfaceType) 
+{ 
+    dst.reserve(dst.size() + src.size());
+    for (ExPolygonSet::ExPolygonView expoly : src) {
+        // Surface(SurfaceType, const ExPolygon&&) would copy the expolygon.
+        dst.emplace_back(Surface(surfaceType, ExPolygon()));
+        dst.back().expolygon = expoly.to_expolygon();
+    }
+}
+inline void surfaces_append(Surfaces &dst, const ExPolygonSet &src, const Surface &surfaceTempl) 
+{ 
+    dst.reserve(dst.size() + src.size());
+    for (ExPolygonSet::ExPolygonView expoly : src) {
+        dst.emplace_back(Surface(surfaceTempl, ExPolygon()));
+        dst.back().expolygon = expoly.to_expolygon();
+    }
+}
 inline void surfaces_append(Surfaces &dst, const Surfaces &src) 
 { 
     dst.insert(dst.end(), src.begin(), src.end());
@@ -3,6 +3,7 @@
 #include "SVG.hpp"
 
 #include <map>
+#include <tuple>
 
 namespace Slic3r {
 
@@ -36,21 +37,21 @@ SurfaceCollection::simplify(double tolerance)
 void
 SurfaceCollection::group(std::vector<SurfacesPtr> *retval)
 {
-    for (Surfaces::iterator it = this->surfaces.begin(); it != this->surfaces.end(); ++it) {
-        // find a group with the same properties
-        SurfacesPtr* group = NULL;
-        for (std::vector<SurfacesPtr>::iterator git = retval->begin(); git != retval->end(); ++git)
-            if (! git->empty() && surfaces_could_merge(*git->front(), *it)) {
-                group = &*git;
-                break;
-            }
-        // if no group with these properties exists, add one
-        if (group == NULL) {
-            retval->resize(retval->size() + 1);
-            group = &retval->back();
+    // The groups of the surfaces indexed by the properties compared by surfaces_could_merge(), in the order of their first surfaces.
+    typedef std::tuple<SurfaceType, double, unsigned short, double> GroupKey;
+    std::map<GroupKey, size_t> group_idx;
+    for (const SurfacesPtr &group : *retval)
+        if (! group.empty()) {
+            const Surface &s = *group.front();
+            group_idx.emplace(GroupKey(s.surface_type, s.thickness, s.thickness_layers, s.bridge_angle), &group - retval->data());
         }
+    for (Surface &surface : this->surfaces) {
+        auto it = group_idx.emplace(GroupKey(surface.surface_type, surface.thickness, surface.thickness_layers, surface.bridge_angle), retval->size()).first;
+        // if no group with these properties exists, add one
+        if (it->second == retval->size())
+            retval->emplace_back();
         // append surface to group
-        group->push_back(&*it);
+        (*retval)[it->second].push_back(&surface);
     }
 }
 
@@ -82,12 +83,50 @@ SurfaceCollection::filter_by_types(const SurfaceType *types, int ntypes)
 void
 SurfaceCollection::filter_by_type(SurfaceType type, Polygons* polygons)
 {
-    for (Surfaces::iterator surface = this->surfaces.begin(); surface != this->surfaces.end(); ++surface) {
-        if (surface->surface_type == type) {
-            Polygons pp = surface->expolygon;
-            polygons->insert(polygons->end(), pp.begin(), pp.end());
-        }
-    }
+    size_t num = polygons->size();
+    for (const Surface &surface : this->surfaces)
+        if (surface.surface_type == type)
+            num += surface.expolygon.holes.size() + 1;
+    polygons->reserve(num);
+    for (const Surface &surface : this->surfaces)
+        if (surface.surface_type == type)
+            polygons_append(*polygons, surface.expolygon);
+}
+
+static inline bool surface_type_in(SurfaceType type, const SurfaceType *types, int ntypes)
+{
+    for (int i = 0; i < ntypes; ++ i)
+        if (type == types[i])
+            return true;
+    return false;
+}
+
+Polygons SurfaceCollection::polygons_by_types(const SurfaceType *types, int ntypes) const
+{
+    size_t num = 0;
+    for (const Surface &surface : this->surfaces)
+        if (surface_type_in(surface.surface_type, types, ntypes))
+            num += surface.expolygon.holes.size() + 1;
+    Polygons out;
+    out.reserve(num);
+    for (const Surface &surface : this->surfaces)
+        if (surface_type_in(surface.surface_type, types, ntypes))
+            polygons_append(out, surface.expolygon);
+    return out;
+}
+
+ExPolygons SurfaceCollection::expolygons_by_types(const SurfaceType *types, int ntypes) const
+{
+    size_t num = 0;
+    for (const Surface &surface : this->surfaces)
+        if (surface_type_in(surface.surface_type, types, ntypes))
+            ++ num;
+    ExPolygons out;
+    out.reserve(num);
+    for (const Surface &surface : this->surfaces)
+        if (surface_type_in(surface.surface_type, types, ntypes))
+            out.emplace_back(surface.expolygon);
+    return out;
 }
 
 void
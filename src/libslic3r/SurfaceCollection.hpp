@@ -34,10 +34,22 @@ public:
     void remove_type(const SurfaceType type);
     void remove_types(const SurfaceType *types, int ntypes);
     void filter_by_type(SurfaceType type, Polygons* polygons);
+    // Polygons and expolygons of the surfaces of the given types, collected at once without the SurfacesPtr of filter_by_type().
+    Polygons   polygons_by_type(SurfaceType type) const { return this->polygons_by_types(&type, 1); }
+    Polygons   polygons_by_types(const SurfaceType *types, int ntypes) const;
+    ExPolygons expolygons_by_type(SurfaceType type) const { return this->expolygons_by_types(&type, 1); }
+    ExPolygons expolygons_by_types(const SurfaceType *types, int ntypes) const;
 
     void clear() { surfaces.clear(); }
     bool empty() const { return surfaces.empty(); }
 	size_t size() const { return surfaces.size(); }
+    // Heap memory allocated by the surfaces in bytes, including the unused capacity.
+    size_t memsize() const {
+        size_t n = this->surfaces.capacity() * sizeof(Surface);
+        for (const Surface &surface : this->surfaces)
+            n += surface.expolygon.memsize();
+        return n;
+    }
     bool has(SurfaceType type) const { 
         for (const Surface &surface : this->surfaces) 
             if (surface.surface_type == type) return true;
@@ -52,6 +64,8 @@ public:
     void set(ExPolygons &&src, SurfaceType surfaceType) { clear(); this->append(std::move(src), surfaceType); }
     void set(ExPolygons &&src, const Surface &surfaceTempl) { clear(); this->append(std::move(src), surfaceTempl); }
     void set(Surfaces &&src) { clear(); this->append(std::move(src)); }
+    void set(const ExPolygonSet &src, SurfaceType surfaceType) { clear(); this->append(src, surfaceType); }
+    void set(const ExPolygonSet &src, const Surface &surfaceTempl) { clear(); this->append(src, surfaceTempl); }
 
     void append(const SurfaceCollection &coll) { this->append(coll.surfaces); }
     void append(SurfaceCollection &&coll) { this->append(std::move(coll.surfaces)); }
@@ -61,6 +75,8 @@ public:
     void append(ExPolygons &&src, SurfaceType surfaceType) { surfaces_append(this->surfaces, std::move(src), surfaceType); }
     void append(ExPolygons &&src, const Surface &surfaceTempl) { surfaces_append(this->surfaces, std::move(src), surfaceTempl); }
     void append(Surfaces &&src) { surfaces_append(this->surfaces, std::move(src)); }
+    void append(const ExPolygonSet &src, SurfaceType surfaceType) { surfaces_append(this->surfaces, src, surfaceType); }
+    void append(const ExPolygonSet &src, const Surface &surfaceTempl) { surfaces_append(this->surfaces, src, surfaceTempl); }
 
     // For debugging purposes:
     void export_to_svg(const char *path, bool show_labels);
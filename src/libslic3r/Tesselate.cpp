@@ -1,11 +1,373 @@
 #include "Tesselate.hpp"
 
+#include "BoundingBox.hpp"
 #include "ExPolygon.hpp"
 
 #include <glu-libtess.h>
 
+#include <tbb/parallel_for.h>
+
 namespace Slic3r {
 
+// Ear clipping triangulation of an ExPolygon with its holes bridged into the contour, following the algorithm of the mapbox earcut library.
+// Points of large polygons are indexed along a z-order curve to speed up the test of a candidate ear.
+// An instance keeps its nodes between calls, so that triangulating a sequence of expolygons does not allocate.
+// Only polygons without self intersections and with the holes inside the contour are triangulated,
+// triangulate() returns false for polygons the ear clipping could not handle, which are left to glu-libtess.
+class EarClipper {
+public:
+    // Append counter-clockwise triangles to out, three points per triangle.
+    bool triangulate(const ExPolygon &expoly, Points &out)
+    {
+        m_nodes.clear();
+        if (expoly.contour.points.size() < 3)
+            return true;
+        size_t num_points = expoly.contour.points.size();
+        for (const Polygon &hole : expoly.holes)
+            num_points += hole.points.size();
+        // Each bridge duplicates two nodes. The nodes must not be reallocated, they are linked by pointers.
+        m_nodes.reserve(num_points + 2 * expoly.holes.size());
+
+        Node *outer = this->linked_list(expoly.contour.points, true);
+        if (outer == nullptr || outer->next == outer->prev)
+            return true;
+        if (! expoly.holes.empty() && (outer = this->eliminate_holes(expoly, outer)) == nullptr)
+            return false;
+
+        m_inv_size = 0.;
+        if (num_points > 80) {
+            BoundingBox bbox(expoly.contour.points);
+            m_min_x    = bbox.min.x();
+            m_min_y    = bbox.min.y();
+            m_inv_size = std::max(bbox.max.x() - bbox.min.x(), bbox.max.y() - bbox.min.y());
+            m_inv_size = (m_inv_size != 0.) ? 32767. / m_inv_size : 0.;
+        }
+        size_t num_triangles_old = out.size();
+        if (! this->earcut_linked(outer, out, 0)) {
+            out.resize(num_triangles_old);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    struct Node {
+        Node(coord_t x, coord_t y) : x(x), y(y) {}
+        int64_t   x;
+        int64_t   y;
+        // Z-order curve value.
+        uint32_t  z      = 0;
+        Node     *prev   = nullptr;
+        Node     *next   = nullptr;
+        Node     *prev_z = nullptr;
+        Node     *next_z = nullptr;
+    };
+
+    // Negative for a counter-clockwise (convex) turn.
+    static int64_t area(const Node *p, const Node *q, const Node *r) { return (q->y - p->y) * (r->x - q->x) - (q->x - p->x) * (r->y - q->y); }
+    static bool    equals(const Node *p, const Node *q) { return p->x == q->x && p->y == q->y; }
+    template<typename T>
+    static bool    point_in_triangle(T ax, T ay, T bx, T by, T cx, T cy, T px, T py) 
+    {
+        return (cx - px) * (ay - py) >= (ax - px) * (cy - py) &&
+               (ax - px) * (by - py) >= (bx - px) * (ay - py) &&
+               (bx - px) * (cy - py) >= (cx - px) * (by - py);
+    }
+    // Is the diagonal (a, b) inside the polygon in the neighborhood of a?
+    static bool    locally_inside(const Node *a, const Node *b)
+    {
+        return area(a->prev, a, a->next) < 0 ?
+            area(a, b, a->next) >= 0 && area(a, a->prev, b) >= 0 :
+            area(a, b, a->prev) < 0 || area(a, a->next, b) < 0;
+    }
+    static bool    sector_contains_sector(const Node *m, const Node *p) { return area(m->prev, m, p->prev) < 0 && area(p->next, m, m->next) < 0; }
+
+    Node* insert_node(const Point &pt, Node *last)
+    {
+        m_nodes.emplace_back(pt.x(), pt.y());
+        Node *p = &m_nodes.back();
+        if (last == nullptr) {
+            p->prev = p;
+            p->next = p;
+        } else {
+            p->next = last->next;
+            p->prev = last;
+            last->next->prev = p;
+            last->next = p;
+        }
+        return p;
+    }
+
+    static void remove_node(Node *p)
+    {
+        p->next->prev = p->prev;
+        p->prev->next = p->next;
+        if (p->prev_z)
+            p->prev_z->next_z = p->next_z;
+        if (p->next_z)
+            p->next_z->prev_z = p->prev_z;
+    }
+
+    // Circular doubly linked list of the points, counter-clockwise for ccw, clockwise otherwise.
+    Node* linked_list(const Points &points, bool ccw)
+    {
+        double a = 0.;
+        for (size_t i = 0, j = points.size() - 1; i < points.size(); j = i ++)
+            a += double(points[j].x() - points[i].x()) * double(points[i].y() + points[j].y());
+        Node *last = nullptr;
+        if (ccw == (a > 0.))
+            for (const Point &pt : points)
+                last = this->insert_node(pt, last);
+        else
+            for (auto it = points.rbegin(); it != points.rend(); ++ it)
+                last = this->insert_node(*it, last);
+        if (last != nullptr && equals(last, last->next)) {
+            remove_node(last);
+            last = last->next;
+        }
+        return last;
+    }
+
+    // Remove duplicate and collinear points.
+    static Node* filter_points(Node *start, Node *end = nullptr)
+    {
+        if (end == nullptr)
+            end = start;
+        Node *p = start;
+        bool again;
+        do {
+            again = false;
+            if (equals(p, p->next) || area(p->prev, p, p->next) == 0) {
+                remove_node(p);
+                p = end = p->prev;
+                if (p == p->next)
+                    break;
+                again = true;
+            } else
+                p = p->next;
+        } while (again || p != end);
+        return end;
+    }
+
+    // Link the holes into the contour. Returns nullptr if a hole could not be bridged.
+    Node* eliminate_holes(const ExPolygon &expoly, Node *outer)
+    {
+        m_queue.clear();
+        for (const Polygon &hole : expoly.holes) {
+            if (hole.points.size() < 3)
+                continue;
+            Node *list = this->linked_list(hole.points, false);
+            if (list == nullptr || list == list->next)
+                continue;
+            // Leftmost point of the hole.
+            Node *leftmost = list;
+            for (Node *p = list->next; p != list; p = p->next)
+                if (p->x < leftmost->x || (p->x == leftmost->x && p->y < leftmost->y))
+                    leftmost = p;
+            m_queue.emplace_back(leftmost);
+        }
+        std::sort(m_queue.begin(), m_queue.end(), [](const Node *l, const Node *r) { return l->x < r->x; });
+        for (Node *hole : m_queue) {
+            Node *bridge = find_hole_bridge(hole, outer);
+            if (bridge == nullptr)
+                return nullptr;
+            Node *bridge_reverse = this->split_polygon(bridge, hole);
+            filter_points(bridge_reverse, bridge_reverse->next);
+            outer = filter_points(bridge, bridge->next);
+        }
+        return outer;
+    }
+
+    // David Eberly's algorithm for finding a bridge between the hole and the outer polygon.
+    static Node* find_hole_bridge(Node *hole, Node *outer)
+    {
+        Node   *p  = outer;
+        int64_t hx = hole->x;
+        int64_t hy = hole->y;
+        double  qx = - std::numeric_limits<double>::max();
+        Node   *m  = nullptr;
+        // Find a segment intersected by a ray from the hole's leftmost point to the left.
+        // The segment's endpoint with lesser x will be the potential connection point.
+        do {
+            if (hy <= p->y && hy >= p->next->y && p->next->y != p->y) {
+                double x = double(p->x) + double(hy - p->y) * double(p->next->x - p->x) / double(p->next->y - p->y);
+                if (x <= double(hx) && x > qx) {
+                    qx = x;
+                    m  = p->x < p->next->x ? p : p->next;
+                    if (x == double(hx))
+                        // Hole touches the outer segment, pick the leftmost endpoint.
+                        return m;
+                }
+            }
+            p = p->next;
+        } while (p != outer);
+        if (m == nullptr)
+            return nullptr;
+
+        // Look for points inside the triangle of the hole point, the segment intersection and the endpoint.
+        // If there are no points found, we have a valid connection, otherwise choose the point of the minimum angle with the ray as the connection point.
+        const Node *stop    = m;
+        int64_t     mx      = m->x;
+        int64_t     my      = m->y;
+        double      tan_min = std::numeric_limits<double>::max();
+        p = m;
+        do {
+            if (hx >= p->x && p->x >= mx && hx != p->x &&
+                point_in_triangle<double>(hy < my ? double(hx) : qx, double(hy), double(mx), double(my), hy < my ? qx : double(hx), double(hy), double(p->x), double(p->y))) {
+                double tan = std::abs(double(hy - p->y)) / double(hx - p->x);
+                if (locally_inside(p, hole) && (tan < tan_min || (tan == tan_min && (p->x > m->x || (p->x == m->x && sector_contains_sector(m, p)))))) {
+                    m       = p;
+                    tan_min = tan;
+                }
+            }
+            p = p->next;
+        } while (p != stop);
+        return m;
+    }
+
+    // Link two polygon vertices with a bridge. If the vertices belong to the same ring, it splits the polygon into two,
+    // if one belongs to the outer ring and another to a hole, it merges it into a single ring.
+    Node* split_polygon(Node *a, Node *b)
+    {
+        m_nodes.emplace_back(coord_t(a->x), coord_t(a->y));
+        Node *a2 = &m_nodes.back();
+        m_nodes.emplace_back(coord_t(b->x), coord_t(b->y));
+        Node *b2 = &m_nodes.back();
+        Node *an = a->next;
+        Node *bp = b->prev;
+        a->next  = b;
+        b->prev  = a;
+        a2->next = an;
+        an->prev = a2;
+        b2->next = a2;
+        a2->prev = b2;
+        bp->next = b2;
+        b2->prev = bp;
+        return b2;
+    }
+
+    uint32_t z_order(int64_t px, int64_t py) const
+    {
+        // Points of holes sticking out of the contour are clamped to the bounding box of the contour.
+        uint32_t x = uint32_t(std::clamp(double(px - m_min_x) * m_inv_size, 0., 32767.));
+        uint32_t y = uint32_t(std::clamp(double(py - m_min_y) * m_inv_size, 0., 32767.));
+        x = (x | (x << 8)) & 0x00FF00FF;
+        x = (x | (x << 4)) & 0x0F0F0F0F;
+        x = (x | (x << 2)) & 0x33333333;
+        x = (x | (x << 1)) & 0x55555555;
+        y = (y | (y << 8)) & 0x00FF00FF;
+        y = (y | (y << 4)) & 0x0F0F0F0F;
+        y = (y | (y << 2)) & 0x33333333;
+        y = (y | (y << 1)) & 0x55555555;
+        return x | (y << 1);
+    }
+
+    // Link the nodes in the order of the z-order curve.
+    void index_curve(Node *start)
+    {
+        m_queue.clear();
+        Node *p = start;
+        do {
+            p->z = this->z_order(p->x, p->y);
+            m_queue.emplace_back(p);
+            p = p->next;
+        } while (p != start);
+        std::sort(m_queue.begin(), m_queue.end(), [](const Node *l, const Node *r) { return l->z < r->z; });
+        for (size_t i = 0; i < m_queue.size(); ++ i) {
+            m_queue[i]->prev_z = (i == 0) ? nullptr : m_queue[i - 1];
+            m_queue[i]->next_z = (i + 1 == m_queue.size()) ? nullptr : m_queue[i + 1];
+        }
+    }
+
+    // Could the point p prevent the ear (a, b, c) from being cut?
+    static bool blocks_ear(const Node *a, const Node *b, const Node *c, const Node *p, int64_t x0, int64_t y0, int64_t x1, int64_t y1)
+    {
+        return p->x >= x0 && p->x <= x1 && p->y >= y0 && p->y <= y1 && p != a && p != c &&
+            point_in_triangle<int64_t>(a->x, a->y, b->x, b->y, c->x, c->y, p->x, p->y) && area(p->prev, p, p->next) >= 0;
+    }
+
+    static bool is_ear(const Node *ear)
+    {
+        const Node *a = ear->prev;
+        const Node *b = ear;
+        const Node *c = ear->next;
+        if (area(a, b, c) >= 0)
+            // Reflex, can't be an ear.
+            return false;
+        int64_t x0 = std::min(a->x, std::min(b->x, c->x));
+        int64_t y0 = std::min(a->y, std::min(b->y, c->y));
+        int64_t x1 = std::max(a->x, std::max(b->x, c->x));
+        int64_t y1 = std::max(a->y, std::max(b->y, c->y));
+        for (const Node *p = c->next; p != a; p = p->next)
+            if (blocks_ear(a, b, c, p, x0, y0, x1, y1))
+                return false;
+        return true;
+    }
+
+    bool is_ear_hashed(const Node *ear) const
+    {
+        const Node *a = ear->prev;
+        const Node *b = ear;
+        const Node *c = ear->next;
+        if (area(a, b, c) >= 0)
+            return false;
+        int64_t  x0   = std::min(a->x, std::min(b->x, c->x));
+        int64_t  y0   = std::min(a->y, std::min(b->y, c->y));
+        int64_t  x1   = std::max(a->x, std::max(b->x, c->x));
+        int64_t  y1   = std::max(a->y, std::max(b->y, c->y));
+        uint32_t min_z = this->z_order(x0, y0);
+        uint32_t max_z = this->z_order(x1, y1);
+        const Node *p = ear->prev_z;
+        const Node *n = ear->next_z;
+        // Look for points inside the triangle in both directions.
+        for (; p != nullptr && p->z >= min_z && n != nullptr && n->z <= max_z; p = p->prev_z, n = n->next_z)
+            if (blocks_ear(a, b, c, p, x0, y0, x1, y1) || blocks_ear(a, b, c, n, x0, y0, x1, y1))
+                return false;
+        // Look for the remaining points in decreasing z-order.
+        for (; p != nullptr && p->z >= min_z; p = p->prev_z)
+            if (blocks_ear(a, b, c, p, x0, y0, x1, y1))
+                return false;
+        // Look for the remaining points in increasing z-order.
+        for (; n != nullptr && n->z <= max_z; n = n->next_z)
+            if (blocks_ear(a, b, c, n, x0, y0, x1, y1))
+                return false;
+        return true;
+    }
+
+    bool earcut_linked(Node *ear, Points &out, int pass)
+    {
+        if (pass == 0 && m_inv_size != 0.)
+            this->index_curve(ear);
+        Node *stop = ear;
+        while (ear->prev != ear->next) {
+            Node *prev = ear->prev;
+            Node *next = ear->next;
+            if (m_inv_size != 0. ? this->is_ear_hashed(ear) : is_ear(ear)) {
+                out.emplace_back(coord_t(prev->x), coord_t(prev->y));
+                out.emplace_back(coord_t(ear->x),  coord_t(ear->y));
+                out.emplace_back(coord_t(next->x), coord_t(next->y));
+                remove_node(ear);
+                // Skipping the next vertex leads to less sliver triangles.
+                ear  = next->next;
+                stop = next->next;
+                continue;
+            }
+            ear = next;
+            if (ear == stop)
+                // No ear found in a full loop. Try again without the duplicate and collinear points,
+                // then give up, the polygon is most likely self intersecting.
+                return pass == 0 && this->earcut_linked(filter_points(ear), out, 1);
+        }
+        return true;
+    }
+
+    std::vector<Node>   m_nodes;
+    std::vector<Node*>  m_queue;
+    int64_t             m_min_x    = 0;
+    int64_t             m_min_y    = 0;
+    double              m_inv_size = 0.;
+};
+
 class GluTessWrapper {
 public:
     GluTessWrapper() : m_tesselator(gluNewTess()) {
@@ -189,22 +551,65 @@ private:
     bool            m_flipped;
 };
 
+// Append the triangles of an expolygon to out, triangulated by ear clipping if possible, otherwise by glu-libtess.
+static void triangulate_expolygon_3d(const ExPolygon &poly, coordf_t z, bool flip, std::vector<Vec3d> &out)
+{
+    // Reused by the consecutive calls of a thread.
+    static thread_local EarClipper ear_clipper;
+    static thread_local Points     triangles;
+    triangles.clear();
+    if (ear_clipper.triangulate(poly, triangles)) {
+        out.reserve(out.size() + triangles.size());
+        for (size_t i = 0; i < triangles.size(); i += 3) {
+            const Point &a = triangles[i];
+            const Point &b = flip ? triangles[i + 2] : triangles[i + 1];
+            const Point &c = flip ? triangles[i + 1] : triangles[i + 2];
+            out.emplace_back(unscale<double>(a.x()), unscale<double>(a.y()), z);
+            out.emplace_back(unscale<double>(b.x()), unscale<double>(b.y()), z);
+            out.emplace_back(unscale<double>(c.x()), unscale<double>(c.y()), z);
+        }
+    } else {
+        GluTessWrapper tess;
+        std::vector<Vec3d> glu_triangles = tess.tesselate3d(poly, z, flip);
+        out.insert(out.end(), glu_triangles.begin(), glu_triangles.end());
+    }
+}
+
 std::vector<Vec3d> triangulate_expolygon_3d(const ExPolygon &poly, coordf_t z, bool flip)
 {
-    GluTessWrapper tess;
-    return tess.tesselate3d(poly, z, flip);
+    std::vector<Vec3d> out;
+    triangulate_expolygon_3d(poly, z, flip, out);
+    return out;
 }
 
 std::vector<Vec3d> triangulate_expolygons_3d(const ExPolygons &polys, coordf_t z, bool flip)
 {
-	GluTessWrapper tess;
-    return tess.tesselate3d(polys, z, flip);
+    std::vector<Vec3d> out;
+    // Below this number of expolygons, the expolygons are triangulated sequentially.
+    static constexpr const size_t parallel_min_expolygons = 8;
+    if (polys.size() < parallel_min_expolygons) {
+        for (const ExPolygon &poly : polys)
+            triangulate_expolygon_3d(poly, z, flip, out);
+    } else {
+        std::vector<std::vector<Vec3d>> triangles(polys.size());
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, polys.size()),
+            [&polys, &triangles, z, flip](const tbb::blocked_range<size_t> &range) {
+            for (size_t i = range.begin(); i < range.end(); ++ i)
+                triangulate_expolygon_3d(polys[i], z, flip, triangles[i]);
+        });
+        size_t num_points = 0;
+        for (const std::vector<Vec3d> &t : triangles)
+            num_points += t.size();
+        out.reserve(num_points);
+        for (const std::vector<Vec3d> &t : triangles)
+            out.insert(out.end(), t.begin(), t.end());
+    }
+    return out;
 }
 
 std::vector<Vec2d> triangulate_expolygon_2d(const ExPolygon &poly, bool flip)
 {
-    GluTessWrapper tess;
-    std::vector<Vec3d> triangles = tess.tesselate3d(poly, 0, flip);
+    std::vector<Vec3d> triangles = triangulate_expolygon_3d(poly, 0, flip);
     std::vector<Vec2d> out;
     out.reserve(triangles.size());
     for (const Vec3d &pt : triangles)
@@ -214,8 +619,7 @@ std::vector<Vec2d> triangulate_expolygon_2d(const ExPolygon &poly, bool flip)
 
 std::vector<Vec2d> triangulate_expolygons_2d(const ExPolygons &polys, bool flip)
 {
-    GluTessWrapper tess;
-    std::vector<Vec3d> triangles = tess.tesselate3d(polys, 0, flip);
+    std::vector<Vec3d> triangles = triangulate_expolygons_3d(polys, 0, flip);
     std::vector<Vec2d> out;
     out.reserve(triangles.size());
     for (const Vec3d &pt : triangles)
@@ -225,8 +629,7 @@ std::vector<Vec2d> triangulate_expolygons_2d(const ExPolygons &polys, bool flip)
 
 std::vector<Vec2f> triangulate_expolygon_2f(const ExPolygon &poly, bool flip)
 {
-    GluTessWrapper tess;
-    std::vector<Vec3d> triangles = tess.tesselate3d(poly, 0, flip);
+    std::vector<Vec3d> triangles = triangulate_expolygon_3d(poly, 0, flip);
     std::vector<Vec2f> out;
     out.reserve(triangles.size());
     for (const Vec3d &pt : triangles)
@@ -236,8 +639,7 @@ std::vector<Vec2f> triangulate_expolygon_2f(const ExPolygon &poly, bool flip)
 
 std::vector<Vec2f> triangulate_expolygons_2f(const ExPolygons &polys, bool flip)
 {
-    GluTessWrapper tess;
-    std::vector<Vec3d> triangles = tess.tesselate3d(polys, 0, flip);
+    std::vector<Vec3d> triangles = triangulate_expolygons_3d(polys, 0, flip);
     std::vector<Vec2f> out;
     out.reserve(triangles.size());
     for (const Vec3d &pt : triangles)
@@ -0,0 +1,203 @@
+#include "Trace.hpp"
+#include "Utils.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#ifdef WIN32
+	#include <windows.h>
+	#include <psapi.h>
+#else
+	#include <time.h>
+	#include <sys/resource.h>
+#endif
+
+#include <boost/log/trivial.hpp>
+#include <boost/nowide/fstream.hpp>
+
+namespace Slic3r {
+namespace tracing {
+
+namespace detail {
+    std::atomic<bool> s_enabled { false };
+}
+
+struct Event
+{
+    const char *name;
+    const char *category;
+    int64_t     id;
+    uint32_t    thread_id;
+    // Start and duration of the zone in microseconds.
+    int64_t     wall_start;
+    int64_t     wall_duration;
+    // CPU time consumed by the thread inside the zone in microseconds.
+    int64_t     cpu_duration;
+    // Peak resident memory of the process at the end of the zone in bytes.
+    size_t      peak_memory;
+};
+
+static std::mutex           s_mutex;
+static std::string          s_path;
+static std::vector<Event>   s_events;
+static std::chrono::steady_clock::time_point s_time_start;
+static std::atomic<uint32_t> s_last_thread_id { 0 };
+
+static int64_t wall_time_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - s_time_start).count();
+}
+
+// CPU time consumed by the calling thread in microseconds.
+static int64_t thread_cpu_time_us()
+{
+#ifdef WIN32
+    FILETIME creation_time, exit_time, kernel_time, user_time;
+    if (! GetThreadTimes(GetCurrentThread(), &creation_time, &exit_time, &kernel_time, &user_time))
+        return 0;
+    // FILETIME counts in 100ns intervals.
+    auto to_us = [](const FILETIME &t) { return int64_t((uint64_t(t.dwHighDateTime) << 32) | t.dwLowDateTime) / 10; };
+    return to_us(kernel_time) + to_us(user_time);
+#else
+    timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+        return 0;
+    return int64_t(ts.tv_sec) * 1000000 + int64_t(ts.tv_nsec) / 1000;
+#endif
+}
+
+// Peak resident memory of the process in bytes.
+static size_t peak_memory_usage()
+{
+#ifdef WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    return GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)) ? size_t(pmc.PeakWorkingSetSize) : 0;
+#else
+    rusage memory_info;
+    if (getrusage(RUSAGE_SELF, &memory_info) != 0)
+        return 0;
+    size_t peak = size_t(memory_info.ru_maxrss);
+    #ifndef __APPLE__
+        // getrusage returns the value in kB on linux
+        peak *= 1024;
+    #endif
+    return peak;
+#endif
+}
+
+static uint32_t current_thread_id()
+{
+    static thread_local uint32_t id = ++ s_last_thread_id;
+    return id;
+}
+
+static void write_json_string(boost::nowide::ofstream &out, const char *str)
+{
+    out << '"';
+    for (const char *c = str; *c != 0; ++ c) {
+        if (*c == '"' || *c == '\\')
+            out << '\\';
+        out << *c;
+    }
+    out << '"';
+}
+
+void start(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_path       = path;
+    s_events.clear();
+    s_time_start = std::chrono::steady_clock::now();
+    detail::s_enabled = true;
+    if (! path.empty())
+        BOOST_LOG_TRIVIAL(info) << "Recording the trace into " << path;
+}
+
+std::vector<ZoneSummary> stop()
+{
+    std::vector<Event> events;
+    std::string        path;
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        if (! detail::s_enabled)
+            return {};
+        detail::s_enabled = false;
+        events.swap(s_events);
+        path.swap(s_path);
+    }
+
+    if (! path.empty()) {
+        // Chrome trace event format, complete events ("ph":"X").
+        boost::nowide::ofstream out(path);
+        if (! out)
+            throw std::runtime_error(std::string("Cannot open the trace file for writing: ") + path);
+        const unsigned pid = get_current_pid();
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        for (size_t i = 0; i < events.size(); ++ i) {
+            const Event &ev = events[i];
+            out << "{\"name\":";
+            write_json_string(out, ev.name);
+            out << ",\"cat\":";
+            write_json_string(out, ev.category);
+            out << ",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << ev.thread_id << ",\"ts\":" << ev.wall_start << ",\"dur\":" << ev.wall_duration
+                << ",\"args\":{\"cpu_us\":" << ev.cpu_duration << ",\"peak_rss\":" << ev.peak_memory;
+            if (ev.id >= 0)
+                out << ",\"id\":" << ev.id;
+            out << "}}" << ((i + 1 < events.size()) ? ",\n" : "\n");
+        }
+        out << "]}\n";
+        out.close();
+        if (! out)
+            throw std::runtime_error(std::string("Failed to write the trace file: ") + path);
+        BOOST_LOG_TRIVIAL(info) << "Trace written into " << path << ", " << events.size() << " zones";
+    }
+
+    // Summary of the zones per name.
+    std::map<std::string, ZoneSummary> summary_map;
+    for (const Event &ev : events) {
+        ZoneSummary &s = summary_map[ev.name];
+        ++ s.count;
+        s.wall_ms += double(ev.wall_duration) * 0.001;
+        s.cpu_ms  += double(ev.cpu_duration) * 0.001;
+        s.peak_memory = std::max(s.peak_memory, ev.peak_memory);
+    }
+    std::vector<ZoneSummary> summary;
+    summary.reserve(summary_map.size());
+    for (std::pair<const std::string, ZoneSummary> &kvp : summary_map) {
+        kvp.second.name = kvp.first;
+        BOOST_LOG_TRIVIAL(info) << "Trace " << kvp.first << ": count " << kvp.second.count << ", wall " << kvp.second.wall_ms << "ms, CPU "
+            << kvp.second.cpu_ms << "ms, peak memory " << format_memsize_MB(kvp.second.peak_memory);
+        summary.emplace_back(std::move(kvp.second));
+    }
+    return summary;
+}
+
+void Zone::begin()
+{
+    m_wall_start = wall_time_us();
+    m_cpu_start  = thread_cpu_time_us();
+}
+
+void Zone::end()
+{
+    Event ev;
+    ev.name          = m_name;
+    ev.category      = m_category;
+    ev.id            = m_id;
+    ev.thread_id     = current_thread_id();
+    ev.wall_start    = m_wall_start;
+    ev.wall_duration = wall_time_us() - m_wall_start;
+    ev.cpu_duration  = thread_cpu_time_us() - m_cpu_start;
+    ev.peak_memory   = peak_memory_usage();
+    std::lock_guard<std::mutex> lock(s_mutex);
+    // The trace may have been stopped while this zone was open.
+    if (detail::s_enabled)
+        s_events.emplace_back(ev);
+}
+
+} // namespace tracing
+} // namespace Slic3r
@@ -0,0 +1,73 @@
+#ifndef slic3r_Trace_hpp_
+#define slic3r_Trace_hpp_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Slic3r {
+
+// Low overhead tracing of the slicing steps.
+// The trace is recorded between tracing::start() and tracing::stop() into the memory, and it is written
+// as a Chrome trace JSON (readable by chrome://tracing or https://ui.perfetto.dev) when stopped.
+// When the trace is not being recorded, a tracing::Zone costs a single relaxed atomic load.
+namespace tracing {
+
+namespace detail {
+    extern std::atomic<bool> s_enabled;
+}
+
+// Zones of the same name accumulated over the trace.
+struct ZoneSummary
+{
+    std::string name;
+    size_t      count       = 0;
+    // The wall times of the zones running in parallel add up.
+    double      wall_ms     = 0.;
+    double      cpu_ms      = 0.;
+    size_t      peak_memory = 0;
+};
+
+// Start recording the trace, which will be written into the file at path once stop() is called.
+// If the path is empty, the trace is only summarized by stop().
+void start(const std::string &path);
+// Stop recording, write the trace and log the accumulated wall time, CPU time and peak memory per zone name.
+// Returns the summary sorted by the zone names.
+// Throws std::runtime_error if the trace could not be written.
+std::vector<ZoneSummary> stop();
+inline bool enabled() { return detail::s_enabled.load(std::memory_order_relaxed); }
+
+// Scoped zone of the trace. The name and the category have to be string literals or otherwise outlive the trace.
+// If id is not negative, it is stored with the zone, for example the index of a layer.
+class Zone
+{
+public:
+    explicit Zone(const char *name, const char *category = "slicing", int64_t id = -1) :
+        m_name(enabled() ? name : nullptr), m_category(category), m_id(id)
+        { if (m_name != nullptr) this->begin(); }
+    ~Zone() { if (m_name != nullptr) this->end(); }
+
+    Zone(const Zone&) = delete;
+    Zone& operator=(const Zone&) = delete;
+
+private:
+    void begin();
+    void end();
+
+    const char *m_name;
+    const char *m_category;
+    int64_t     m_id;
+    int64_t     m_wall_start = 0;
+    int64_t     m_cpu_start  = 0;
+};
+
+} // namespace tracing
+} // namespace Slic3r
+
+#define SLIC3R_TRACE_CONCAT_IMPL(A, B) A##B
+#define SLIC3R_TRACE_CONCAT(A, B) SLIC3R_TRACE_CONCAT_IMPL(A, B)
+// Trace the rest of the enclosing scope.
+#define SLIC3R_TRACE_ZONE(...) ::Slic3r::tracing::Zone SLIC3R_TRACE_CONCAT(slic3r_trace_zone_, __LINE__)(__VA_ARGS__)
+
+#endif /* slic3r_Trace_hpp_ */
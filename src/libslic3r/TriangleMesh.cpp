@@ -13,11 +13,13 @@
 #include <map>
 #include <utility>
 #include <algorithm>
+#include <atomic>
 #include <math.h>
 #include <type_traits>
 
 #include <boost/log/trivial.hpp>
 
+#include <tbb/enumerable_thread_specific.h>
 #include <tbb/parallel_for.h>
 
 #include <Eigen/Core>
@@ -424,37 +426,110 @@ std::deque<uint32_t> TriangleMesh::find_unvisited_neighbors(std::vector<unsigned
     return facets;
 }
 
+// Lock free union-find over the facets, the root of a set is its smallest facet index.
+static uint32_t facet_set_find(std::vector<std::atomic<uint32_t>> &parent, uint32_t idx)
+{
+    for (;;) {
+        uint32_t p = parent[idx].load(std::memory_order_relaxed);
+        if (p == idx)
+            return idx;
+        uint32_t gp = parent[p].load(std::memory_order_relaxed);
+        // Path halving, another thread may have already shortened the path.
+        if (p != gp)
+            parent[idx].compare_exchange_weak(p, gp, std::memory_order_relaxed);
+        idx = gp;
+    }
+}
+
+static void facet_set_unite(std::vector<std::atomic<uint32_t>> &parent, uint32_t a, uint32_t b)
+{
+    for (;;) {
+        a = facet_set_find(parent, a);
+        b = facet_set_find(parent, b);
+        if (a == b)
+            return;
+        if (a < b)
+            std::swap(a, b);
+        // Link the larger root below the smaller one, retry if the larger root got linked meanwhile.
+        uint32_t expected = a;
+        if (parent[a].compare_exchange_strong(expected, b, std::memory_order_relaxed))
+            return;
+    }
+}
+
 /**
  * Splits a mesh into multiple meshes when possible.
  * 
+ * The connected components are labelled in parallel with a union-find over the facet
+ * neighbors, then the facets are scattered into meshes preallocated to the size of
+ * their components. The parts are ordered by their first facet.
+ * 
  * @return A TriangleMeshPtrs with the newly created meshes.
  */
 TriangleMeshPtrs TriangleMesh::split() const
 {
-    // Loop while we have remaining facets.
-    std::vector<unsigned char> facet_visited;
-    TriangleMeshPtrs meshes;
-    for (;;) {
-        std::deque<uint32_t> facets = find_unvisited_neighbors(facet_visited);
-        if (facets.empty())
-            break;
+    // Make sure we're not operating on a broken mesh.
+    if (!this->repaired)
+        throw std::runtime_error("split() requires repair()");
+
+    const uint32_t num_facets = this->stl.stats.number_of_facets;
+    std::vector<std::atomic<uint32_t>> parent(num_facets);
+    for (uint32_t i = 0; i < num_facets; ++ i)
+        parent[i].store(i, std::memory_order_relaxed);
+
+    tbb::parallel_for(tbb::blocked_range<uint32_t>(0, num_facets), [this, &parent](const tbb::blocked_range<uint32_t> &range) {
+        for (uint32_t facet_idx = range.begin(); facet_idx < range.end(); ++ facet_idx)
+            for (int neighbor_idx : this->stl.neighbors_start[facet_idx].neighbor)
+                if (neighbor_idx > int(facet_idx))
+                    facet_set_unite(parent, facet_idx, uint32_t(neighbor_idx));
+    });
+
+    std::vector<uint32_t> component(num_facets);
+    tbb::parallel_for(tbb::blocked_range<uint32_t>(0, num_facets), [&parent, &component](const tbb::blocked_range<uint32_t> &range) {
+        for (uint32_t facet_idx = range.begin(); facet_idx < range.end(); ++ facet_idx)
+            component[facet_idx] = facet_set_find(parent, facet_idx);
+    });
+
+    // Number the components by their roots. A root precedes all the other facets of its component.
+    std::vector<uint32_t> component_size;
+    for (uint32_t facet_idx = 0; facet_idx < num_facets; ++ facet_idx) {
+        uint32_t root = component[facet_idx];
+        if (root == facet_idx) {
+            component[facet_idx] = uint32_t(component_size.size());
+            component_size.emplace_back(0);
+        } else
+            component[facet_idx] = component[root];
+        ++ component_size[component[facet_idx]];
+    }
 
-        // Create a new mesh for the part that was just split off.
+    // Create the meshes for all the parts at once.
+    TriangleMeshPtrs meshes;
+    meshes.reserve(component_size.size());
+    for (uint32_t size : component_size) {
         TriangleMesh* mesh = new TriangleMesh;
         meshes.emplace_back(mesh);
         mesh->stl.stats.type = inmemory;
-        mesh->stl.stats.number_of_facets = (uint32_t)facets.size();
+        mesh->stl.stats.number_of_facets = size;
         mesh->stl.stats.original_num_facets = mesh->stl.stats.number_of_facets;
         stl_allocate(&mesh->stl);
+    }
 
-        // Assign the facets to the new mesh.
-        bool first = true;
-        for (auto facet = facets.begin(); facet != facets.end(); ++ facet) {
-            mesh->stl.facet_start[facet - facets.begin()] = this->stl.facet_start[*facet];
-            stl_facet_stats(&mesh->stl, this->stl.facet_start[*facet], first);
-        }
+    // Assign the facets to the new meshes.
+    std::vector<uint32_t> cursor(component_size.size(), 0);
+    for (uint32_t facet_idx = 0; facet_idx < num_facets; ++ facet_idx) {
+        uint32_t c = component[facet_idx];
+        meshes[c]->stl.facet_start[cursor[c] ++] = this->stl.facet_start[facet_idx];
     }
 
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, meshes.size()), [&meshes](const tbb::blocked_range<size_t> &range) {
+        for (size_t i = range.begin(); i < range.end(); ++ i) {
+            stl_file &stl = meshes[i]->stl;
+            bool first = true;
+            for (const stl_facet &facet : stl.facet_start)
+                stl_facet_stats(&stl, facet, first);
+        }
+    });
+
     return meshes;
 }
 
@@ -626,17 +701,25 @@ size_t TriangleMesh::memsize() const
 // Release optional data from the mesh if the object is on the Undo / Redo stack only. Returns the amount of memory released.
 size_t TriangleMesh::release_optional()
 {
-	size_t memsize_released = sizeof(stl_neighbors) * this->stl.neighbors_start.size() + this->its.memsize();
-	// The indexed triangle set may be recalculated using the stl_generate_shared_vertices() function.
-	this->its.clear();
+	size_t memsize_released = sizeof(stl_neighbors) * this->stl.neighbors_start.capacity();
 	// The neighbors structure may be recalculated using the stl_check_facets_exact() function.
 	this->stl.neighbors_start.clear();
+	this->stl.neighbors_start.shrink_to_fit();
+	if (! this->its.vertices.empty()) {
+		// Keep the indexed triangle set, which is roughly three times more compact than the facets.
+		// The facets may be recalculated using the stl_generate_facets() function.
+		memsize_released += sizeof(stl_facet) * this->stl.facet_start.capacity();
+		this->stl.facet_start.clear();
+		this->stl.facet_start.shrink_to_fit();
+	}
 	return memsize_released;
 }
 
 // Restore optional data possibly released by release_optional().
 void TriangleMesh::restore_optional()
 {
+	if (this->stl.facet_start.empty() && ! this->its.indices.empty())
+		stl_generate_facets(&this->stl, this->its);
 	if (! this->stl.facet_start.empty()) {
 		// Save the old stats before calling stl_check_faces_exact, as it may modify the statistics.
 		stl_stats stats = this->stl.stats;
@@ -658,10 +741,34 @@ void TriangleMeshSlicer::init(const TriangleMesh *_mesh, throw_on_cancel_callbac
         throw std::invalid_argument("TriangleMeshSlicer was passed a mesh without shared vertices.");
 
     throw_on_cancel();
-    facets_edges.assign(_mesh->stl.stats.number_of_facets * 3, -1);
-	v_scaled_shared.assign(_mesh->its.vertices.size(), stl_vertex());
-	for (size_t i = 0; i < v_scaled_shared.size(); ++ i)
-        this->v_scaled_shared[i] = _mesh->its.vertices[i] / float(SCALING_FACTOR);
+    m_use_trafo = false;
+    this->transform_vertices();
+    this->build_facets_edges(throw_on_cancel);
+}
+
+void TriangleMeshSlicer::init(const TriangleMesh *_mesh, const Transform3d &trafo, FacetsEdgesPtr facets_edges, throw_on_cancel_callback_type throw_on_cancel)
+{
+    mesh = _mesh;
+    if (! mesh->has_shared_vertices())
+        throw std::invalid_argument("TriangleMeshSlicer was passed a mesh without shared vertices.");
+    if (trafo.matrix().block(0, 0, 3, 3).determinant() < 0.)
+        throw std::invalid_argument("TriangleMeshSlicer was passed a left handed transformation.");
+    assert(! m_use_quaternion);
+    assert(! facets_edges || facets_edges->size() == _mesh->stl.stats.number_of_facets * 3);
+
+    throw_on_cancel();
+    m_trafo     = trafo;
+    m_use_trafo = true;
+    this->transform_vertices();
+    if (facets_edges)
+        m_facets_edges = std::move(facets_edges);
+    else
+        this->build_facets_edges(throw_on_cancel);
+}
+
+void TriangleMeshSlicer::build_facets_edges(throw_on_cancel_callback_type throw_on_cancel)
+{
+    std::vector<int> facets_edges(this->mesh->stl.stats.number_of_facets * 3, -1);
 
     // Create a mapping from triangle edge into face.
     struct EdgeToFace {
@@ -725,10 +832,10 @@ void TriangleMeshSlicer::init(const TriangleMesh *_mesh, throw_on_cancel_callbac
                 }
         }
         // Assign an edge index to the 1st face.
-        this->facets_edges[edge_i.face * 3 + std::abs(edge_i.face_edge) - 1] = num_edges;
+        facets_edges[edge_i.face * 3 + std::abs(edge_i.face_edge) - 1] = num_edges;
         if (found) {
             EdgeToFace &edge_j = edges_map[j];
-            this->facets_edges[edge_j.face * 3 + std::abs(edge_j.face_edge) - 1] = num_edges;
+            facets_edges[edge_j.face * 3 + std::abs(edge_j.face_edge) - 1] = num_edges;
             // Mark the edge as connected.
             edge_j.face = -1;
         }
@@ -736,14 +843,72 @@ void TriangleMeshSlicer::init(const TriangleMesh *_mesh, throw_on_cancel_callbac
         if ((i & 0x0ffff) == 0)
             throw_on_cancel();
     }
+    m_facets_edges = std::make_shared<const std::vector<int>>(std::move(facets_edges));
 }
 
 
 
 void TriangleMeshSlicer::set_up_direction(const Vec3f& up)
 {
+    assert(! m_use_trafo);
     m_quaternion.setFromTwoVectors(up, Vec3f::UnitZ());
     m_use_quaternion = true;
+    if (mesh != nullptr)
+        // Rotate the vertices once, not for every facet edge and every slicing plane.
+        this->transform_vertices();
+}
+
+void TriangleMeshSlicer::transform_vertices()
+{
+    v_scaled_shared.assign(mesh->its.vertices.size(), stl_vertex());
+    if (m_use_trafo)
+        for (size_t i = 0; i < v_scaled_shared.size(); ++ i)
+            this->v_scaled_shared[i] = (m_trafo * mesh->its.vertices[i].cast<double>()).cast<float>() / float(SCALING_FACTOR);
+    else if (m_use_quaternion)
+        for (size_t i = 0; i < v_scaled_shared.size(); ++ i)
+            this->v_scaled_shared[i] = m_quaternion * stl_vertex(mesh->its.vertices[i] / float(SCALING_FACTOR));
+    else
+        for (size_t i = 0; i < v_scaled_shared.size(); ++ i)
+            this->v_scaled_shared[i] = mesh->its.vertices[i] / float(SCALING_FACTOR);
+
+    // The Z extents are calculated from the unscaled facets exactly as slice_facet() expects them.
+    const size_t num_facets = mesh->stl.stats.number_of_facets;
+    m_facets_min_z.assign(num_facets, 0.f);
+    m_facets_max_z.assign(num_facets, 0.f);
+    if (m_use_trafo) {
+        for (size_t facet_idx = 0; facet_idx < num_facets; ++ facet_idx) {
+            const stl_facet facet = this->transformed_facet(facet_idx);
+            m_facets_min_z[facet_idx] = fminf(facet.vertex[0].z(), fminf(facet.vertex[1].z(), facet.vertex[2].z()));
+            m_facets_max_z[facet_idx] = fmaxf(facet.vertex[0].z(), fmaxf(facet.vertex[1].z(), facet.vertex[2].z()));
+        }
+        return;
+    }
+    for (size_t facet_idx = 0; facet_idx < num_facets; ++ facet_idx) {
+        const stl_facet &facet = mesh->stl.facet_start[facet_idx];
+        float z0, z1, z2;
+        if (m_use_quaternion) {
+            z0 = (m_quaternion * facet.vertex[0]).z();
+            z1 = (m_quaternion * facet.vertex[1]).z();
+            z2 = (m_quaternion * facet.vertex[2]).z();
+        } else {
+            z0 = facet.vertex[0].z();
+            z1 = facet.vertex[1].z();
+            z2 = facet.vertex[2].z();
+        }
+        m_facets_min_z[facet_idx] = fminf(z0, fminf(z1, z2));
+        m_facets_max_z[facet_idx] = fmaxf(z0, fmaxf(z1, z2));
+    }
+}
+
+stl_facet TriangleMeshSlicer::transformed_facet(size_t facet_idx) const
+{
+    // The unscaled vertices are derived from v_scaled_shared, so that the facet Z extents match the vertices exactly.
+    const stl_triangle_vertex_indices &indices = this->mesh->its.indices[facet_idx];
+    stl_facet facet;
+    for (int i = 0; i < 3; ++ i)
+        facet.vertex[i] = this->v_scaled_shared[indices[i]] * float(SCALING_FACTOR);
+    facet.normal = (facet.vertex[1] - facet.vertex[0]).cross(facet.vertex[2] - facet.vertex[0]);
+    return facet;
 }
 
 
@@ -780,21 +945,78 @@ void TriangleMeshSlicer::slice(const std::vector<float> &z, std::vector<Polygons
     */
     
     BOOST_LOG_TRIVIAL(debug) << "TriangleMeshSlicer::_slice_do";
+    // Order the facets by the first layer they intersect (counting sort over the layers), so that the consecutive facets
+    // processed by a thread produce their intersection lines for a narrow band of layers. Processing the facets
+    // in the order of the input mesh touches unrelated layers and thrashes the caches for large meshes.
+    // Facets above the last layer are dropped.
+    std::vector<int> facets_sorted;
+    {
+        const int num_facets = this->mesh->stl.stats.number_of_facets;
+        std::vector<unsigned int> facet_min_layer(num_facets);
+        tbb::parallel_for(
+            tbb::blocked_range<int>(0, num_facets),
+            [&facet_min_layer, &z, this](const tbb::blocked_range<int>& range) {
+                for (int facet_idx = range.begin(); facet_idx < range.end(); ++ facet_idx)
+                    facet_min_layer[facet_idx] = (unsigned int)(std::lower_bound(z.begin(), z.end(), m_facets_min_z[facet_idx]) - z.begin());
+            }
+        );
+        throw_on_cancel();
+        std::vector<int> layer_facets_begin(z.size() + 1, 0);
+        for (unsigned int min_layer : facet_min_layer)
+            if (min_layer < z.size())
+                ++ layer_facets_begin[min_layer + 1];
+        for (size_t i = 1; i < layer_facets_begin.size(); ++ i)
+            layer_facets_begin[i] += layer_facets_begin[i - 1];
+        facets_sorted.assign(layer_facets_begin.back(), 0);
+        for (int facet_idx = 0; facet_idx < num_facets; ++ facet_idx)
+            if (facet_min_layer[facet_idx] < z.size())
+                facets_sorted[layer_facets_begin[facet_min_layer[facet_idx]] ++] = facet_idx;
+    }
+
     std::vector<IntersectionLines> lines(z.size());
     {
-        boost::mutex lines_mutex;
+        // Each thread collects the intersection lines into its own set of layers, so that the slicing threads
+        // do not contend for a shared lock. The per thread layers are concatenated afterwards.
+        tbb::enumerable_thread_specific<std::vector<IntersectionLines>> lines_per_thread(
+            [&z]() { return std::vector<IntersectionLines>(z.size()); });
         tbb::parallel_for(
-            tbb::blocked_range<int>(0,this->mesh->stl.stats.number_of_facets),
-            [&lines, &lines_mutex, &z, throw_on_cancel, this](const tbb::blocked_range<int>& range) {
-                for (int facet_idx = range.begin(); facet_idx < range.end(); ++ facet_idx) {
-                    if ((facet_idx & 0x0ffff) == 0)
+            tbb::blocked_range<size_t>(0, facets_sorted.size()),
+            [&lines_per_thread, &facets_sorted, &z, throw_on_cancel, this](const tbb::blocked_range<size_t>& range) {
+                std::vector<IntersectionLines> &lines_local = lines_per_thread.local();
+                for (size_t i = range.begin(); i < range.end(); ++ i) {
+                    if ((i & 0x0ffff) == 0)
                         throw_on_cancel();
-                    this->_slice_do(facet_idx, &lines, &lines_mutex, z);
+                    this->_slice_do(facets_sorted[i], &lines_local, z);
                 }
             }
         );
+        throw_on_cancel();
+
+        std::vector<std::vector<IntersectionLines>*> lines_threads;
+        for (std::vector<IntersectionLines> &lines_local : lines_per_thread)
+            lines_threads.emplace_back(&lines_local);
+        if (lines_threads.size() == 1)
+            lines = std::move(*lines_threads.front());
+        else
+            tbb::parallel_for(
+                tbb::blocked_range<size_t>(0, z.size()),
+                [&lines, &lines_threads](const tbb::blocked_range<size_t>& range) {
+                    for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
+                        IntersectionLines &dst = lines[layer_idx];
+                        size_t num_lines = 0;
+                        for (const std::vector<IntersectionLines> *lines_local : lines_threads)
+                            num_lines += (*lines_local)[layer_idx].size();
+                        dst.reserve(num_lines);
+                        for (std::vector<IntersectionLines> *lines_local : lines_threads) {
+                            IntersectionLines &src = (*lines_local)[layer_idx];
+                            dst.insert(dst.end(), src.begin(), src.end());
+                            // Release the memory early.
+                            IntersectionLines().swap(src);
+                        }
+                    }
+                }
+            );
     }
-    throw_on_cancel();
 
     // v_scaled_shared could be freed here
     
@@ -847,14 +1069,23 @@ void TriangleMeshSlicer::slice(const std::vector<float> &z, std::vector<Polygons
 #endif
 }
 
-void TriangleMeshSlicer::_slice_do(size_t facet_idx, std::vector<IntersectionLines>* lines, boost::mutex* lines_mutex, 
-    const std::vector<float> &z) const
+void TriangleMeshSlicer::_slice_do(size_t facet_idx, std::vector<IntersectionLines>* lines, const std::vector<float> &z) const
 {
-    const stl_facet &facet = m_use_quaternion ? (this->mesh->stl.facet_start.data() + facet_idx)->rotated(m_quaternion) : *(this->mesh->stl.facet_start.data() + facet_idx);
-    
     // find facet extents
-    const float min_z = fminf(facet.vertex[0](2), fminf(facet.vertex[1](2), facet.vertex[2](2)));
-    const float max_z = fmaxf(facet.vertex[0](2), fmaxf(facet.vertex[1](2), facet.vertex[2](2)));
+    const float min_z = m_facets_min_z[facet_idx];
+    const float max_z = m_facets_max_z[facet_idx];
+
+    // find layer extents
+    std::vector<float>::const_iterator min_layer, max_layer;
+    min_layer = std::lower_bound(z.begin(), z.end(), min_z); // first layer whose slice_z is >= min_z
+    max_layer = std::upper_bound(min_layer, z.end(), max_z); // first layer whose slice_z is > max_z
+    if (min_layer == max_layer)
+        // The facet does not intersect any slicing plane, don't touch the facet data at all.
+        return;
+
+    // The rotated facet is only needed for the normal and for identification of its lowest vertex, the vertex positions are taken from v_scaled_shared.
+    const stl_facet &facet = m_use_trafo ? this->transformed_facet(facet_idx) :
+        m_use_quaternion ? (this->mesh->stl.facet_start.data() + facet_idx)->rotated(m_quaternion) : *(this->mesh->stl.facet_start.data() + facet_idx);
     
     #ifdef SLIC3R_TRIANGLEMESH_DEBUG
     printf("\n==> FACET %d (%f,%f,%f - %f,%f,%f - %f,%f,%f):\n", facet_idx,
@@ -864,10 +1095,6 @@ void TriangleMeshSlicer::_slice_do(size_t facet_idx, std::vector<IntersectionLin
     printf("z: min = %.2f, max = %.2f\n", min_z, max_z);
     #endif /* SLIC3R_TRIANGLEMESH_DEBUG */
     
-    // find layer extents
-    std::vector<float>::const_iterator min_layer, max_layer;
-    min_layer = std::lower_bound(z.begin(), z.end(), min_z); // first layer whose slice_z is >= min_z
-    max_layer = std::upper_bound(min_layer, z.end(), max_z); // first layer whose slice_z is > max_z
     #ifdef SLIC3R_TRIANGLEMESH_DEBUG
     printf("layers: min = %d, max = %d\n", (int)(min_layer - z.begin()), (int)(max_layer - z.begin()));
     #endif /* SLIC3R_TRIANGLEMESH_DEBUG */
@@ -876,7 +1103,6 @@ void TriangleMeshSlicer::_slice_do(size_t facet_idx, std::vector<IntersectionLin
         std::vector<float>::size_type layer_idx = it - z.begin();
         IntersectionLine il;
         if (this->slice_facet(*it / SCALING_FACTOR, facet, facet_idx, min_z, max_z, &il) == TriangleMeshSlicer::Slicing) {
-            boost::lock_guard<boost::mutex> l(*lines_mutex);
             if (il.edge_type == feHorizontal) {
                 // Ignore horizontal triangles. Any valid horizontal triangle must have a vertical triangle connected, otherwise the part has zero volume.
             } else
@@ -922,35 +1148,21 @@ TriangleMeshSlicer::FacetSliceType TriangleMeshSlicer::slice_facet(
     const stl_triangle_vertex_indices &vertices = this->mesh->its.indices[facet_idx];
     int i = (facet.vertex[1].z() == min_z) ? 1 : ((facet.vertex[2].z() == min_z) ? 2 : 0);
 
-    // These are used only if the cut plane is tilted:
-    stl_vertex rotated_a;
-    stl_vertex rotated_b;
-
     for (int j = i; j - i < 3; ++j) {  // loop through facet edges
-        int        edge_id  = this->facets_edges[facet_idx * 3 + (j % 3)];
+        int        edge_id  = (*m_facets_edges)[facet_idx * 3 + (j % 3)];
         int        a_id     = vertices[j % 3];
         int        b_id     = vertices[(j+1) % 3];
 
-        const stl_vertex *a;
-        const stl_vertex *b;
-        if (m_use_quaternion) {
-            rotated_a = m_quaternion * this->v_scaled_shared[a_id];
-            rotated_b = m_quaternion * this->v_scaled_shared[b_id];
-            a = &rotated_a;
-            b = &rotated_b;
-        }
-        else {
-            a = &this->v_scaled_shared[a_id];
-            b = &this->v_scaled_shared[b_id];
-        }
+        // The vertices are already rotated if the cut plane is tilted.
+        const stl_vertex *a = &this->v_scaled_shared[a_id];
+        const stl_vertex *b = &this->v_scaled_shared[b_id];
         
         // Is edge or face aligned with the cutting plane?
         if (a->z() == slice_z && b->z() == slice_z) {
             // Edge is horizontal and belongs to the current layer.
-            // The following rotation of the three vertices may not be efficient, but this branch happens rarely.
-            const stl_vertex &v0 = m_use_quaternion ? stl_vertex(m_quaternion * this->v_scaled_shared[vertices[0]]) : this->v_scaled_shared[vertices[0]];
-            const stl_vertex &v1 = m_use_quaternion ? stl_vertex(m_quaternion * this->v_scaled_shared[vertices[1]]) : this->v_scaled_shared[vertices[1]];
-            const stl_vertex &v2 = m_use_quaternion ? stl_vertex(m_quaternion * this->v_scaled_shared[vertices[2]]) : this->v_scaled_shared[vertices[2]];
+            const stl_vertex &v0 = this->v_scaled_shared[vertices[0]];
+            const stl_vertex &v1 = this->v_scaled_shared[vertices[1]];
+            const stl_vertex &v2 = this->v_scaled_shared[vertices[2]];
             const stl_normal &normal = facet.normal;
             // We may ignore this edge for slicing purposes, but we may still use it for object cutting.
             FacetSliceType    result = Slicing;
@@ -1067,9 +1279,7 @@ TriangleMeshSlicer::FacetSliceType TriangleMeshSlicer::slice_facet(
             if (i == line_out->a_id || i == line_out->b_id)
                 i = vertices[2];
             assert(i != line_out->a_id && i != line_out->b_id);
-            line_out->edge_type = ((m_use_quaternion ?
-                                    (m_quaternion * this->v_scaled_shared[i]).z()
-                                    : this->v_scaled_shared[i].z()) < slice_z) ? feTop : feBottom;
+            line_out->edge_type = (this->v_scaled_shared[i].z() < slice_z) ? feTop : feBottom;
         }
 #endif
         return Slicing;
@@ -1741,133 +1951,181 @@ void TriangleMeshSlicer::make_expolygons(std::vector<IntersectionLine> &lines, c
 
 void TriangleMeshSlicer::cut(float z, TriangleMesh* upper, TriangleMesh* lower) const
 {
-    IntersectionLines upper_lines, lower_lines;
-    
+    assert(! m_use_trafo);
+    // The facets are classified in chunks in parallel. Each chunk keeps its new facets and intersection lines
+    // in the order of the input facets. The outputs are then placed by a prefix sum over the chunk sizes,
+    // therefore the result is the same as if the facets were processed serially.
+    struct CutChunk {
+        std::vector<stl_facet>  upper_facets;
+        std::vector<stl_facet>  lower_facets;
+        IntersectionLines       upper_lines;
+        IntersectionLines       lower_lines;
+    };
+    static const uint32_t chunk_size = 16384;
+
     BOOST_LOG_TRIVIAL(trace) << "TriangleMeshSlicer::cut - slicing object";
+    const uint32_t num_facets = this->mesh->stl.stats.number_of_facets;
+    std::vector<CutChunk> chunks((num_facets + chunk_size - 1) / chunk_size);
     float scaled_z = scale_(z);
-    for (uint32_t facet_idx = 0; facet_idx < this->mesh->stl.stats.number_of_facets; ++ facet_idx) {
-        const stl_facet* facet = &this->mesh->stl.facet_start[facet_idx];
-        
-        // find facet extents
-        float min_z = std::min(facet->vertex[0](2), std::min(facet->vertex[1](2), facet->vertex[2](2)));
-        float max_z = std::max(facet->vertex[0](2), std::max(facet->vertex[1](2), facet->vertex[2](2)));
-        
-        // intersect facet with cutting plane
-        IntersectionLine line;
-        if (this->slice_facet(scaled_z, *facet, facet_idx, min_z, max_z, &line) != TriangleMeshSlicer::NoSlice) {
-            // Save intersection lines for generating correct triangulations.
-            if (line.edge_type == feTop) {
-                lower_lines.emplace_back(line);
-            } else if (line.edge_type == feBottom) {
-                upper_lines.emplace_back(line);
-            } else if (line.edge_type != feHorizontal) {
-                lower_lines.emplace_back(line);
-                upper_lines.emplace_back(line);
-            }
-        }
-        
-        if (min_z > z || (min_z == z && max_z > z)) {
-            // facet is above the cut plane and does not belong to it
-            if (upper != nullptr)
-				stl_add_facet(&upper->stl, facet);
-        } else if (max_z < z || (max_z == z && min_z < z)) {
-            // facet is below the cut plane and does not belong to it
-            if (lower != nullptr)
-				stl_add_facet(&lower->stl, facet);
-        } else if (min_z < z && max_z > z) {
-            // Facet is cut by the slicing plane.
-
-            // look for the vertex on whose side of the slicing plane there are no other vertices
-            int isolated_vertex;
-            if ( (facet->vertex[0](2) > z) == (facet->vertex[1](2) > z) ) {
-                isolated_vertex = 2;
-            } else if ( (facet->vertex[1](2) > z) == (facet->vertex[2](2) > z) ) {
-                isolated_vertex = 0;
-            } else {
-                isolated_vertex = 1;
-            }
-            
-            // get vertices starting from the isolated one
-            const stl_vertex &v0 = facet->vertex[isolated_vertex];
-            const stl_vertex &v1 = facet->vertex[(isolated_vertex+1) % 3];
-            const stl_vertex &v2 = facet->vertex[(isolated_vertex+2) % 3];
-            
-            // intersect v0-v1 and v2-v0 with cutting plane and make new vertices
-            stl_vertex v0v1, v2v0;
-            v0v1(0) = v1(0) + (v0(0) - v1(0)) * (z - v1(2)) / (v0(2) - v1(2));
-            v0v1(1) = v1(1) + (v0(1) - v1(1)) * (z - v1(2)) / (v0(2) - v1(2));
-            v0v1(2) = z;
-            v2v0(0) = v2(0) + (v0(0) - v2(0)) * (z - v2(2)) / (v0(2) - v2(2));
-            v2v0(1) = v2(1) + (v0(1) - v2(1)) * (z - v2(2)) / (v0(2) - v2(2));
-            v2v0(2) = z;
-            
-            // build the triangular facet
-            stl_facet triangle;
-            triangle.normal = facet->normal;
-            triangle.vertex[0] = v0;
-            triangle.vertex[1] = v0v1;
-            triangle.vertex[2] = v2v0;
-            
-            // build the facets forming a quadrilateral on the other side
-            stl_facet quadrilateral[2];
-            quadrilateral[0].normal = facet->normal;
-            quadrilateral[0].vertex[0] = v1;
-            quadrilateral[0].vertex[1] = v2;
-            quadrilateral[0].vertex[2] = v0v1;
-            quadrilateral[1].normal = facet->normal;
-            quadrilateral[1].vertex[0] = v2;
-            quadrilateral[1].vertex[1] = v2v0;
-            quadrilateral[1].vertex[2] = v0v1;
-            
-            if (v0(2) > z) {
-                if (upper != nullptr) 
-					stl_add_facet(&upper->stl, &triangle);
-                if (lower != nullptr) {
-                    stl_add_facet(&lower->stl, &quadrilateral[0]);
-                    stl_add_facet(&lower->stl, &quadrilateral[1]);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, chunks.size()), [this, z, scaled_z, num_facets, upper, lower, &chunks](const tbb::blocked_range<size_t> &range) {
+        for (size_t chunk_idx = range.begin(); chunk_idx < range.end(); ++ chunk_idx) {
+            CutChunk &chunk = chunks[chunk_idx];
+            uint32_t  facet_end = std::min(num_facets, uint32_t(chunk_idx + 1) * chunk_size);
+            for (uint32_t facet_idx = uint32_t(chunk_idx) * chunk_size; facet_idx < facet_end; ++ facet_idx) {
+                const stl_facet* facet = &this->mesh->stl.facet_start[facet_idx];
+
+                // find facet extents
+                float min_z = std::min(facet->vertex[0](2), std::min(facet->vertex[1](2), facet->vertex[2](2)));
+                float max_z = std::max(facet->vertex[0](2), std::max(facet->vertex[1](2), facet->vertex[2](2)));
+
+                // intersect facet with cutting plane
+                IntersectionLine line;
+                if (this->slice_facet(scaled_z, *facet, facet_idx, min_z, max_z, &line) != TriangleMeshSlicer::NoSlice) {
+                    // Save intersection lines for generating correct triangulations.
+                    if (line.edge_type == feTop) {
+                        if (lower != nullptr)
+                            chunk.lower_lines.emplace_back(line);
+                    } else if (line.edge_type == feBottom) {
+                        if (upper != nullptr)
+                            chunk.upper_lines.emplace_back(line);
+                    } else if (line.edge_type != feHorizontal) {
+                        if (lower != nullptr)
+                            chunk.lower_lines.emplace_back(line);
+                        if (upper != nullptr)
+                            chunk.upper_lines.emplace_back(line);
+                    }
                 }
-            } else {
-                if (upper != nullptr) {
-                    stl_add_facet(&upper->stl, &quadrilateral[0]);
-                    stl_add_facet(&upper->stl, &quadrilateral[1]);
+
+                if (min_z > z || (min_z == z && max_z > z)) {
+                    // facet is above the cut plane and does not belong to it
+                    if (upper != nullptr)
+                        chunk.upper_facets.emplace_back(*facet);
+                } else if (max_z < z || (max_z == z && min_z < z)) {
+                    // facet is below the cut plane and does not belong to it
+                    if (lower != nullptr)
+                        chunk.lower_facets.emplace_back(*facet);
+                } else if (min_z < z && max_z > z) {
+                    // Facet is cut by the slicing plane.
+
+                    // look for the vertex on whose side of the slicing plane there are no other vertices
+                    int isolated_vertex;
+                    if ( (facet->vertex[0](2) > z) == (facet->vertex[1](2) > z) ) {
+                        isolated_vertex = 2;
+                    } else if ( (facet->vertex[1](2) > z) == (facet->vertex[2](2) > z) ) {
+                        isolated_vertex = 0;
+                    } else {
+                        isolated_vertex = 1;
+                    }
+
+                    // get vertices starting from the isolated one
+                    const stl_vertex &v0 = facet->vertex[isolated_vertex];
+                    const stl_vertex &v1 = facet->vertex[(isolated_vertex+1) % 3];
+                    const stl_vertex &v2 = facet->vertex[(isolated_vertex+2) % 3];
+
+                    // intersect v0-v1 and v2-v0 with cutting plane and make new vertices
+                    stl_vertex v0v1, v2v0;
+                    v0v1(0) = v1(0) + (v0(0) - v1(0)) * (z - v1(2)) / (v0(2) - v1(2));
+                    v0v1(1) = v1(1) + (v0(1) - v1(1)) * (z - v1(2)) / (v0(2) - v1(2));
+                    v0v1(2) = z;
+                    v2v0(0) = v2(0) + (v0(0) - v2(0)) * (z - v2(2)) / (v0(2) - v2(2));
+                    v2v0(1) = v2(1) + (v0(1) - v2(1)) * (z - v2(2)) / (v0(2) - v2(2));
+                    v2v0(2) = z;
+
+                    // build the triangular facet
+                    stl_facet triangle;
+                    triangle.normal = facet->normal;
+                    triangle.vertex[0] = v0;
+                    triangle.vertex[1] = v0v1;
+                    triangle.vertex[2] = v2v0;
+
+                    // build the facets forming a quadrilateral on the other side
+                    stl_facet quadrilateral[2];
+                    quadrilateral[0].normal = facet->normal;
+                    quadrilateral[0].vertex[0] = v1;
+                    quadrilateral[0].vertex[1] = v2;
+                    quadrilateral[0].vertex[2] = v0v1;
+                    quadrilateral[1].normal = facet->normal;
+                    quadrilateral[1].vertex[0] = v2;
+                    quadrilateral[1].vertex[1] = v2v0;
+                    quadrilateral[1].vertex[2] = v0v1;
+
+                    std::vector<stl_facet> *triangle_side      = (v0(2) > z) ? &chunk.upper_facets : &chunk.lower_facets;
+                    std::vector<stl_facet> *quadrilateral_side = (v0(2) > z) ? &chunk.lower_facets : &chunk.upper_facets;
+                    if ((v0(2) > z ? upper : lower) != nullptr)
+                        triangle_side->emplace_back(triangle);
+                    if ((v0(2) > z ? lower : upper) != nullptr) {
+                        quadrilateral_side->emplace_back(quadrilateral[0]);
+                        quadrilateral_side->emplace_back(quadrilateral[1]);
+                    }
                 }
-                if (lower != nullptr) 
-					stl_add_facet(&lower->stl, &triangle);
             }
         }
-    }
-    
-    if (upper != nullptr) {
-        BOOST_LOG_TRIVIAL(trace) << "TriangleMeshSlicer::cut - triangulating upper part";
+    });
+
+    // Append the facets of one side followed by the triangulated cap.
+    auto assemble = [this, z, &chunks](TriangleMesh *mesh, std::vector<stl_facet> CutChunk::*facets, IntersectionLines CutChunk::*lines, bool upper_side) {
+        IntersectionLines section_lines;
+        size_t num_lines = 0;
+        for (const CutChunk &chunk : chunks)
+            num_lines += (chunk.*lines).size();
+        section_lines.reserve(num_lines);
+        for (CutChunk &chunk : chunks) {
+            section_lines.insert(section_lines.end(), (chunk.*lines).begin(), (chunk.*lines).end());
+            (chunk.*lines).clear();
+        }
+
         ExPolygons section;
-        this->make_expolygons_simple(upper_lines, &section);
-        Pointf3s triangles = triangulate_expolygons_3d(section, z, true);
-        stl_facet facet;
-        facet.normal = stl_normal(0, 0, -1.f);
-        for (size_t i = 0; i < triangles.size(); ) {
+        this->make_expolygons_simple(section_lines, &section);
+        Pointf3s triangles = triangulate_expolygons_3d(section, z, upper_side);
+
+        // Offsets of the chunks in the output.
+        std::vector<size_t> offsets(chunks.size() + 1, 0);
+        for (size_t i = 0; i < chunks.size(); ++ i)
+            offsets[i + 1] = offsets[i] + (chunks[i].*facets).size();
+
+        stl_file     &stl         = mesh->stl;
+        const size_t  first_facet = stl.stats.number_of_facets;
+        const size_t  num_added   = offsets.back() + triangles.size() / 3;
+        stl.stats.number_of_facets += uint32_t(num_added);
+        stl.stats.facets_added     += int(num_added);
+        stl_reallocate(&stl);
+
+        // Same as stl_add_facet(), the normals are not set here.
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, chunks.size()), [&chunks, &offsets, &stl, first_facet, facets](const tbb::blocked_range<size_t> &range) {
+            for (size_t i = range.begin(); i < range.end(); ++ i) {
+                std::vector<stl_facet> &src = chunks[i].*facets;
+                stl_facet *dst = stl.facet_start.data() + first_facet + offsets[i];
+                for (const stl_facet &facet : src) {
+                    *dst = facet;
+                    (dst ++)->normal = stl_normal::Zero();
+                }
+                src = std::vector<stl_facet>();
+            }
+        });
+
+        stl_facet *dst = stl.facet_start.data() + first_facet + offsets.back();
+        for (size_t i = 0; i < triangles.size(); ++ dst) {
             for (size_t j = 0; j < 3; ++ j)
-                facet.vertex[j] = triangles[i ++].cast<float>();
-            stl_add_facet(&upper->stl, &facet);
+                dst->vertex[j] = triangles[i ++].cast<float>();
+            dst->normal = stl_normal::Zero();
         }
+    };
+
+    if (upper != nullptr) {
+        BOOST_LOG_TRIVIAL(trace) << "TriangleMeshSlicer::cut - triangulating upper part";
+        assemble(upper, &CutChunk::upper_facets, &CutChunk::upper_lines, true);
     }
-    
+
     if (lower != nullptr) {
         BOOST_LOG_TRIVIAL(trace) << "TriangleMeshSlicer::cut - triangulating lower part";
-        ExPolygons section;
-        this->make_expolygons_simple(lower_lines, &section);
-        Pointf3s triangles = triangulate_expolygons_3d(section, z, false);
-        stl_facet facet;
-        facet.normal = stl_normal(0, 0, -1.f);
-        for (size_t i = 0; i < triangles.size(); ) {
-            for (size_t j = 0; j < 3; ++ j)
-                facet.vertex[j] = triangles[i ++].cast<float>();
-            stl_add_facet(&lower->stl, &facet);
-        }
+        assemble(lower, &CutChunk::lower_facets, &CutChunk::lower_lines, false);
     }
-    
+
     BOOST_LOG_TRIVIAL(trace) << "TriangleMeshSlicer::cut - updating object sizes";
-    stl_get_size(&upper->stl);
-    stl_get_size(&lower->stl);
+    if (upper != nullptr)
+        stl_get_size(&upper->stl);
+    if (lower != nullptr)
+        stl_get_size(&lower->stl);
 }
 
 // Generate the vertex list for a cube solid of arbitrary size in X/Y/Z.
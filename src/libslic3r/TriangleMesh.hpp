@@ -165,9 +165,16 @@ class TriangleMeshSlicer
 {
 public:
     typedef std::function<void()> throw_on_cancel_callback_type;
+    // Map from a facet to an edge index. It only depends on the facet indices, thus it may be shared by the slicers of the same mesh.
+    typedef std::shared_ptr<const std::vector<int>> FacetsEdgesPtr;
     TriangleMeshSlicer() : mesh(nullptr) {}
 	TriangleMeshSlicer(const TriangleMesh* mesh) { this->init(mesh, [](){}); }
     void init(const TriangleMesh *mesh, throw_on_cancel_callback_type throw_on_cancel);
+    // Slice the mesh transformed by trafo. The vertices are transformed on the fly, the mesh is not copied.
+    // The trafo must not be left handed, as it would flip the orientation of the facets.
+    // If facets_edges is set, it has to be the facets_edges() of a slicer of the same mesh, otherwise it is calculated.
+    void init(const TriangleMesh *mesh, const Transform3d &trafo, FacetsEdgesPtr facets_edges, throw_on_cancel_callback_type throw_on_cancel);
+    const FacetsEdgesPtr& facets_edges() const { return m_facets_edges; }
     void slice(const std::vector<float> &z, std::vector<Polygons>* layers, throw_on_cancel_callback_type throw_on_cancel) const;
     void slice(const std::vector<float> &z, const float closing_radius, std::vector<ExPolygons>* layers, throw_on_cancel_callback_type throw_on_cancel) const;
     enum FacetSliceType {
@@ -177,21 +184,38 @@ public:
     };
     FacetSliceType slice_facet(float slice_z, const stl_facet &facet, const int facet_idx,
         const float min_z, const float max_z, IntersectionLine *line_out) const;
+    // cut() is not supported by a slicer initialized with a trafo.
     void cut(float z, TriangleMesh* upper, TriangleMesh* lower) const;
     void set_up_direction(const Vec3f& up);
     
 private:
     const TriangleMesh      *mesh;
     // Map from a facet to an edge index.
-    std::vector<int>         facets_edges;
-    // Scaled copy of this->mesh->stl.v_shared
+    FacetsEdgesPtr           m_facets_edges;
+    // Scaled copy of this->mesh->stl.v_shared, rotated by m_quaternion if m_use_quaternion is set,
+    // transformed by m_trafo if m_use_trafo is set.
     std::vector<stl_vertex>  v_scaled_shared;
+    // Unscaled Z extents of the facets, possibly rotated by m_quaternion, stored once for all the slicing calls,
+    // so that the facets not intersecting any slicing plane are skipped without touching the facet data.
+    std::vector<float>       m_facets_min_z;
+    std::vector<float>       m_facets_max_z;
     // Quaternion that will be used to rotate every facet before the slicing
     Eigen::Quaternion<float, Eigen::DontAlign> m_quaternion;
     // Whether or not the above quaterion should be used
     bool                     m_use_quaternion = false;
+    // Transformation of the mesh, see init(mesh, trafo, ...). Not to be combined with m_quaternion.
+    Transform3d              m_trafo;
+    bool                     m_use_trafo = false;
 
-    void _slice_do(size_t facet_idx, std::vector<IntersectionLines>* lines, boost::mutex* lines_mutex, const std::vector<float> &z) const;
+    // Fill in v_scaled_shared, m_facets_min_z and m_facets_max_z, applying m_quaternion if m_use_quaternion is set
+    // or m_trafo if m_use_trafo is set.
+    void transform_vertices();
+    // Fill in m_facets_edges from the facet indices of the mesh.
+    void build_facets_edges(throw_on_cancel_callback_type throw_on_cancel);
+    // Facet transformed by m_trafo, its vertices are taken from v_scaled_shared, its normal is not normalized.
+    stl_facet transformed_facet(size_t facet_idx) const;
+
+    void _slice_do(size_t facet_idx, std::vector<IntersectionLines>* lines, const std::vector<float> &z) const;
     void make_loops(std::vector<IntersectionLine> &lines, Polygons* loops) const;
     void make_expolygons(const Polygons &loops, const float closing_radius, ExPolygons* slices) const;
     void make_expolygons_simple(std::vector<IntersectionLine> &lines, ExPolygons* slices) const;
@@ -237,16 +261,33 @@ namespace cereal {
 	template<class Archive> void load(Archive &archive, Slic3r::TriangleMesh &mesh) {
         stl_file &stl = mesh.stl;
         stl.stats.type = inmemory;
-		archive(stl.stats.number_of_facets, stl.stats.original_num_facets);
+        uint32_t num_vertices;
+		archive(stl.stats.number_of_facets, stl.stats.original_num_facets, num_vertices);
         stl_allocate(&stl);
-		archive.loadBinary((char*)stl.facet_start.data(), stl.facet_start.size() * 50);
+        if (num_vertices == 0)
+			archive.loadBinary((char*)stl.facet_start.data(), stl.facet_start.size() * 50);
+        else {
+            indexed_triangle_set its;
+            its.vertices.assign(num_vertices, stl_vertex());
+            its.indices.assign(stl.stats.number_of_facets, stl_triangle_vertex_indices());
+            archive.loadBinary((char*)its.vertices.data(), its.vertices.size() * sizeof(stl_vertex));
+            archive.loadBinary((char*)its.indices.data(), its.indices.size() * sizeof(stl_triangle_vertex_indices));
+            stl_generate_facets(&stl, its);
+        }
         stl_get_size(&stl);
         mesh.repair();
 	}
 	template<class Archive> void save(Archive &archive, const Slic3r::TriangleMesh &mesh) {
 		const stl_file& stl = mesh.stl;
-		archive(stl.stats.number_of_facets, stl.stats.original_num_facets);
-		archive.saveBinary((char*)stl.facet_start.data(), stl.facet_start.size() * 50);
+		const indexed_triangle_set &its = mesh.its;
+		// Prefer the indexed triangle set, which is roughly three times more compact than the facets.
+		archive(stl.stats.number_of_facets, stl.stats.original_num_facets, uint32_t(its.vertices.size()));
+		if (its.vertices.empty())
+			archive.saveBinary((char*)stl.facet_start.data(), stl.facet_start.size() * 50);
+		else {
+			archive.saveBinary((char*)its.vertices.data(), its.vertices.size() * sizeof(stl_vertex));
+			archive.saveBinary((char*)its.indices.data(), its.indices.size() * sizeof(stl_triangle_vertex_indices));
+		}
 	}
 }
 
@@ -23,6 +23,14 @@ extern std::string format_memsize_MB(size_t n);
 // Latter is used to get the memory info from SysInfoDialog.
 extern std::string log_memory_info(bool ignore_loglevel = false);
 extern void disable_multi_threading();
+// Limit the number of threads the parallel algorithms of a slicing job run on, zero runs them on all the hardware threads.
+// The limit applies to the jobs started by run_in_thread_arena() afterwards.
+extern void set_num_threads(unsigned int num_threads);
+// Number of threads a job started by run_in_thread_arena() runs on.
+extern unsigned int num_threads();
+// Run a slicing job (processing the Print, exporting G-code, arranging) in its own TBB task arena limited to num_threads(),
+// so that multiple jobs running at the same time do not oversubscribe the CPU. Exceptions thrown by the job are propagated.
+extern void run_in_thread_arena(const std::function<void()> &job);
 // Returns the size of physical memory (RAM) in bytes.
 extern size_t total_physical_memory();
 
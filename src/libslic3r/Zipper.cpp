@@ -1,8 +1,15 @@
 #include <exception>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <algorithm>
 
 #include "Zipper.hpp"
 #include "miniz_extension.hpp"
 #include <boost/log/trivial.hpp>
+#include <tbb/task_group.h>
 #include "I18N.hpp"
 
 //! macro used to mark string used at localization,
@@ -17,11 +24,166 @@
 
 namespace Slic3r {
 
+namespace {
+
+mz_uint to_mz_level(Zipper::e_compression level)
+{
+    switch (level) {
+    case Zipper::NO_COMPRESSION: return MZ_NO_COMPRESSION;
+    case Zipper::FAST_COMPRESSION: return MZ_BEST_SPEED;
+    case Zipper::TIGHT_COMPRESSION: return MZ_BEST_COMPRESSION;
+    }
+
+    return MZ_NO_COMPRESSION;
+}
+
+} // namespace
+
 class Zipper::Impl {
 public:
     mz_zip_archive arch;
     std::string m_zipname;
 
+    // An entry waiting to be written into the archive in parallel mode.
+    // The data are deflated by a worker thread, raw deflate stream as
+    // stored in the zip file.
+    struct Pending {
+        std::string name;
+        std::string data;
+        mz_uint     level    = MZ_NO_COMPRESSION;
+        void       *comp     = nullptr;
+        size_t      comp_len = 0;
+        mz_uint32   crc      = 0;
+        bool        done     = false;
+
+        // Set by whoever deflates the entry, the worker or the writer.
+        std::atomic<bool> claimed { false };
+
+        ~Pending() { mz_free(comp); }
+
+        bool claim() { return !claimed.exchange(true); }
+
+        void deflate()
+        {
+            int flags = int(tdefl_create_comp_flags_from_zip_params(
+                int(level), -MZ_DEFAULT_WINDOW_BITS, MZ_DEFAULT_STRATEGY));
+            comp = tdefl_compress_mem_to_heap(data.data(), data.size(),
+                                              &comp_len, flags);
+            crc  = mz_uint32(mz_crc32(MZ_CRC32_INIT,
+                                      reinterpret_cast<const mz_uint8 *>(data.data()),
+                                      data.size()));
+        }
+    };
+
+    bool m_parallel = false;
+
+    // Number of entries deflated in advance before the caller has to wait
+    // for the oldest one to be written, limits the memory held.
+    size_t m_max_pending = 2 * std::max(1u, std::thread::hardware_concurrency());
+
+    std::deque<std::unique_ptr<Pending>> m_pending;
+    std::mutex                           m_mutex;
+    std::condition_variable              m_cond;
+    tbb::task_group                      m_tasks;
+
+    ~Impl()
+    {
+        // The workers refer to the pending entries.
+        m_tasks.wait();
+    }
+
+    void write(const std::string &name, const void *data, size_t l, mz_uint level)
+    {
+        if(!mz_zip_writer_add_mem(&arch, name.c_str(), data, l, level))
+            blow_up();
+    }
+
+    void write(const Pending &p)
+    {
+        if (p.comp == nullptr || p.comp_len >= p.data.size()) {
+            // Deflating did not help (or failed), store the data.
+            write(p.name, p.data.data(), p.data.size(), MZ_NO_COMPRESSION);
+            return;
+        }
+
+        if(!mz_zip_writer_add_mem_ex_v2(&arch, p.name.c_str(), p.comp, p.comp_len,
+                                        nullptr, 0, p.level | MZ_ZIP_FLAG_COMPRESSED_DATA,
+                                        p.data.size(), p.crc, nullptr,
+                                        nullptr, 0, nullptr, 0))
+            blow_up();
+    }
+
+    // Write the deflated entries from the front of the queue. Waits for the
+    // workers if all the entries have to be written or if too many of them
+    // are pending.
+    void flush(bool all)
+    {
+        while (!m_pending.empty()) {
+            {
+                Pending &front = *m_pending.front();
+                std::unique_lock<std::mutex> lck(m_mutex);
+                if (!front.done) {
+                    if (!all && m_pending.size() <= m_max_pending) break;
+
+                    // The worker may not have been started at all, e.g. if
+                    // the scheduler has no other threads. Deflate it here.
+                    if (front.claim()) {
+                        lck.unlock();
+                        front.deflate();
+                        lck.lock();
+                        front.done = true;
+                    } else
+                        m_cond.wait(lck, [&front] { return front.done; });
+                }
+            }
+
+            std::unique_ptr<Pending> p = std::move(m_pending.front());
+            m_pending.pop_front();
+            write(*p);
+        }
+    }
+
+    void add(const std::string &name, const void *data, size_t l, mz_uint level)
+    {
+        if (!m_parallel || (level == MZ_NO_COMPRESSION && m_pending.empty())) {
+            flush(true);
+            write(name, data, l, level);
+            return;
+        }
+
+        add(name, std::string(static_cast<const char *>(data), l), level);
+    }
+
+    void add(const std::string &name, std::string &&data, mz_uint level)
+    {
+        if (!m_parallel) {
+            write(name, data.data(), data.size(), level);
+            return;
+        }
+
+        auto p   = std::make_unique<Pending>();
+        p->name  = name;
+        p->data  = std::move(data);
+        p->level = level;
+
+        Pending *pp = p.get();
+        if (level == MZ_NO_COMPRESSION)
+            pp->done = pp->claim();
+
+        m_pending.emplace_back(std::move(p));
+
+        if (!pp->done)
+            m_tasks.run([this, pp] {
+                if (!pp->claim()) return;
+                pp->deflate();
+                std::lock_guard<std::mutex> lck(m_mutex);
+                pp->done = true;
+                m_cond.notify_all();
+            });
+
+        flush(false);
+    }
+
     static std::string get_errorstr(mz_zip_error mz_err)
     {
         switch (mz_err)
@@ -114,12 +276,13 @@ public:
     }
 };
 
-Zipper::Zipper(const std::string &zipfname, e_compression compression)
+Zipper::Zipper(const std::string &zipfname, e_compression compression, bool parallel)
 {
     m_impl.reset(new Impl());
 
     m_compression = compression;
     m_impl->m_zipname = zipfname;
+    m_impl->m_parallel = parallel;
 
     memset(&m_impl->arch, 0, sizeof(m_impl->arch));
 
@@ -132,7 +295,7 @@ Zipper::~Zipper()
 {
     if(m_impl->is_alive()) {
         // Flush the current entry if not finished yet.
-        try { finish_entry(); } catch(...) {
+        try { finish_entry(); m_impl->flush(true); } catch(...) {
             BOOST_LOG_TRIVIAL(error) << m_impl->formatted_errorstr();
         }
 
@@ -168,19 +331,17 @@ void Zipper::add_entry(const std::string &name)
 }
 
 void Zipper::add_entry(const std::string &name, const uint8_t *data, size_t l)
+{
+    add_entry(name, data, l, m_compression);
+}
+
+void Zipper::add_entry(const std::string &name, const uint8_t *data, size_t l,
+                       e_compression level)
 {
     if(!m_impl->is_alive()) return;
 
     finish_entry();
-    mz_uint cmpr = MZ_NO_COMPRESSION;
-    switch (m_compression) {
-    case NO_COMPRESSION: cmpr = MZ_NO_COMPRESSION; break;
-    case FAST_COMPRESSION: cmpr = MZ_BEST_SPEED; break;
-    case TIGHT_COMPRESSION: cmpr = MZ_BEST_COMPRESSION; break;
-    }
-
-    if(!mz_zip_writer_add_mem(&m_impl->arch, name.c_str(), data, l, cmpr))
-        m_impl->blow_up();
+    m_impl->add(name, data, l, to_mz_level(level));
 
     m_entry.clear();
     m_data.clear();
@@ -190,20 +351,8 @@ void Zipper::finish_entry()
 {
     if(!m_impl->is_alive()) return;
 
-    if(!m_data.empty() && !m_entry.empty()) {
-        mz_uint compression = MZ_NO_COMPRESSION;
-
-        switch (m_compression) {
-        case NO_COMPRESSION: compression = MZ_NO_COMPRESSION; break;
-        case FAST_COMPRESSION: compression = MZ_BEST_SPEED; break;
-        case TIGHT_COMPRESSION: compression = MZ_BEST_COMPRESSION; break;
-        }
-
-        if(!mz_zip_writer_add_mem(&m_impl->arch, m_entry.c_str(),
-                                  m_data.c_str(),
-                                  m_data.size(),
-                                  compression)) m_impl->blow_up();
-    }
+    if(!m_data.empty() && !m_entry.empty())
+        m_impl->add(m_entry, std::move(m_data), to_mz_level(m_compression));
 
     m_data.clear();
     m_entry.clear();
@@ -213,8 +362,11 @@ void Zipper::finalize()
 {
     finish_entry();
 
-    if(m_impl->is_alive()) if(!mz_zip_writer_finalize_archive(&m_impl->arch))
-        m_impl->blow_up();
+    if(m_impl->is_alive()) {
+        m_impl->flush(true);
+        if(!mz_zip_writer_finalize_archive(&m_impl->arch))
+            m_impl->blow_up();
+    }
 }
 
 const std::string &Zipper::get_filename() const
@@ -27,8 +27,12 @@ private:
 public:
 
     // Will blow up in a runtime exception if the file cannot be created.
+    // With parallel compression the entries are deflated in worker threads
+    // and written into the archive in the order they were added. Errors of
+    // the writes are then reported by the next add_entry() or finalize().
     explicit Zipper(const std::string& zipfname,
-                    e_compression level = NO_COMPRESSION);
+                    e_compression level = NO_COMPRESSION,
+                    bool parallel = false);
     ~Zipper();
 
     // No copies allwed, this is a file resource...
@@ -51,6 +55,11 @@ public:
     /// This method throws exactly like finish_entry() does.
     void add_entry(const std::string& name, const std::uint8_t* data, size_t l);
 
+    /// Same as above with a compression level overriding the one of the
+    /// archive, e.g. to store already compressed data (PNG images) as is.
+    void add_entry(const std::string& name, const std::uint8_t* data, size_t l,
+                   e_compression level);
+
     // Writing data to the archive works like with standard streams. The target
     // within the zip file is the entry created with the add_entry method.
 
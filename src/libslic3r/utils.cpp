@@ -1,6 +1,8 @@
 #include "Utils.hpp"
 #include "I18N.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <locale>
 #include <ctime>
 #include <cstdarg>
@@ -22,6 +24,12 @@
     #ifdef __APPLE__
         #include <mach/mach.h>
     #endif
+    #ifdef __linux__
+        #include <errno.h>
+        #include <fcntl.h>
+        #include <sys/stat.h>
+        #include <sys/sendfile.h>
+    #endif
 #endif
 
 #include <boost/log/core.hpp>
@@ -37,6 +45,7 @@
 #include <boost/nowide/convert.hpp>
 #include <boost/nowide/cstdio.hpp>
 
+#include <tbb/task_arena.h>
 #include <tbb/task_scheduler_init.h>
 
 #if defined(__linux) || defined(__GNUC__ )
@@ -117,6 +126,32 @@ void disable_multi_threading()
         tbb_init = new tbb::task_scheduler_init(1);
 }
 
+static std::atomic<unsigned int> g_num_threads(0);
+
+void set_num_threads(unsigned int num_threads)
+{
+    g_num_threads = num_threads;
+}
+
+unsigned int num_threads()
+{
+    unsigned int n = g_num_threads;
+    return n == 0 ? (unsigned int)std::max(1, tbb::task_scheduler_init::default_num_threads()) : n;
+}
+
+void run_in_thread_arena(const std::function<void()> &job)
+{
+    unsigned int n = g_num_threads;
+    if (n == 0) {
+        // No limit, run in the implicit arena of this thread.
+        job();
+    } else {
+        // Nested parallel algorithms and the parallel algorithms of libnest2d run in this arena as well.
+        tbb::task_arena arena(static_cast<int>(n));
+        arena.execute(job);
+    }
+}
+
 static std::string g_var_dir;
 
 void set_var_dir(const std::string &dir)
@@ -417,6 +452,46 @@ std::error_code rename_file(const std::string &from, const std::string &to)
 #endif
 }
 
+#ifdef __linux__
+// Copy the file content inside the kernel with sendfile(), so that the data is not bounced through user space buffers.
+// Returns false if the copy could not be made this way (for example the file systems do not support sendfile()),
+// the caller is expected to fall back to a regular copy then.
+static bool copy_file_sendfile(const std::string &from, const std::string &to)
+{
+	int fd_in = ::open(from.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd_in < 0)
+		return false;
+	struct stat st;
+	if (::fstat(fd_in, &st) != 0) {
+		::close(fd_in);
+		return false;
+	}
+	int fd_out = ::open(to.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd_out < 0) {
+		::close(fd_in);
+		return false;
+	}
+	bool  ok        = true;
+	off_t remaining = st.st_size;
+	while (remaining > 0) {
+		// sendfile() transfers at most 0x7ffff000 bytes per call.
+		ssize_t sent = ::sendfile(fd_out, fd_in, nullptr, size_t(std::min<off_t>(remaining, 0x7ffff000)));
+		if (sent < 0 && errno == EINTR)
+			continue;
+		if (sent <= 0) {
+			ok = false;
+			break;
+		}
+		remaining -= sent;
+	}
+	::close(fd_in);
+	// Errors of delayed writes may only be reported by close().
+	if (::close(fd_out) != 0)
+		ok = false;
+	return ok;
+}
+#endif /* __linux__ */
+
 int copy_file_inner(const std::string& from, const std::string& to)
 {
 	const boost::filesystem::path source(from);
@@ -431,9 +506,15 @@ int copy_file_inner(const std::string& from, const std::string& to)
 	// or when the target file doesn't exist.
 	boost::system::error_code ec;
 	boost::filesystem::permissions(target, perms, ec);
-	boost::filesystem::copy_file(source, target, boost::filesystem::copy_option::overwrite_if_exists, ec);
-	if (ec) {
-		return -1;
+#ifdef __linux__
+	// boost::filesystem::copy_file() copies through a small user space buffer on Linux, which is slow for large G-codes.
+	if (! copy_file_sendfile(from, to))
+#endif /* __linux__ */
+	{
+		boost::filesystem::copy_file(source, target, boost::filesystem::copy_option::overwrite_if_exists, ec);
+		if (ec) {
+			return -1;
+		}
 	}
 	boost::filesystem::permissions(target, perms, ec);
 	return 0;
@@ -472,9 +472,6 @@ void Bed3D::render_texture(bool bottom, GLCanvas3D& canvas) const
         // the temporary texture is not needed anymore, reset it
         if (m_temp_texture.get_id() != 0)
             m_temp_texture.reset();
-
-        canvas.request_extra_frame();
-
     }
 
     if (m_triangles.get_vertices_count() > 0)
@@ -107,6 +107,9 @@ public:
     bool contains(const Point& point) const;
     Point point_projection(const Point& point) const;
 
+    // Are there levels of the texture compressed in the background, which have not been sent to the GPU yet?
+    bool texture_update_pending() const { return m_texture.unsent_compressed_data_available(); }
+
 #if ENABLE_6DOF_CAMERA
     void render(GLCanvas3D& canvas, bool bottom, float scale_factor, bool show_axes) const;
 #else
@@ -12,12 +12,15 @@
 #include "libslic3r/GCode/Analyzer.hpp"
 #include "slic3r/GUI/PresetBundle.hpp"
 #include "libslic3r/Format/STL.hpp"
+#include "libslic3r/QuadricEdgeCollapse.hpp"
 #include "libslic3r/Utils.hpp"
+#include "slic3r/Utils/Thread.hpp"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <utility>
+#include <algorithm>
 #include <assert.h>
 
 #include <boost/log/trivial.hpp>
@@ -77,6 +80,104 @@ void GLIndexedVertexArray::load_mesh_full_shading(const TriangleMesh &mesh)
     }
 }
 
+void GLIndexedVertexArray::load_its_flat_shading(const indexed_triangle_set &its)
+{
+    assert(triangle_indices.empty() && vertices_and_normals_interleaved_size == 0);
+
+    this->vertices_and_normals_interleaved.reserve(this->vertices_and_normals_interleaved.size() + 3 * 3 * 2 * its.indices.size());
+    this->triangle_indices.reserve(this->triangle_indices.size() + 3 * its.indices.size());
+
+    int vertices_count = 0;
+    for (const stl_triangle_vertex_indices &idx : its.indices) {
+        const stl_vertex &v0 = its.vertices[idx(0)];
+        const stl_vertex &v1 = its.vertices[idx(1)];
+        const stl_vertex &v2 = its.vertices[idx(2)];
+        stl_normal n = (v1 - v0).cross(v2 - v0);
+        float len = n.norm();
+        if (len > 0.f)
+            n /= len;
+        this->push_geometry(v0(0), v0(1), v0(2), n(0), n(1), n(2));
+        this->push_geometry(v1(0), v1(1), v1(2), n(0), n(1), n(2));
+        this->push_geometry(v2(0), v2(1), v2(2), n(0), n(1), n(2));
+        this->push_triangle(vertices_count, vertices_count + 1, vertices_count + 2);
+        vertices_count += 3;
+    }
+}
+
+// Layout of a vertex in the VBO: the normal quantized to signed bytes, padded to 4 bytes, followed by the position.
+// 16 bytes per vertex instead of 24 bytes of the CPU side interleaved array.
+struct GLCompactVertex
+{
+    GLbyte  normal[4];
+    GLfloat position[3];
+};
+static_assert(sizeof(GLCompactVertex) == 16, "GLCompactVertex is expected to be packed");
+
+static inline GLbyte quantize_normal(float n)
+{
+    return GLbyte(std::round(std::max(-1.f, std::min(1.f, n)) * 127.f));
+}
+
+template<typename IndexType>
+static void narrow_indices(const std::vector<int> &indices, std::vector<unsigned char> &data)
+{
+    data.assign(indices.size() * sizeof(IndexType), 0);
+    IndexType *dst = reinterpret_cast<IndexType*>(data.data());
+    for (int idx : indices)
+        *dst ++ = IndexType(idx);
+}
+
+static void upload_buffer(GLenum target, std::vector<unsigned char> &data, unsigned int &vbo_id)
+{
+    glsafe(::glGenBuffers(1, &vbo_id));
+    glsafe(::glBindBuffer(target, vbo_id));
+    glsafe(::glBufferData(target, data.size(), data.data(), GL_STATIC_DRAW));
+    glsafe(::glBindBuffer(target, 0));
+    // Release the memory.
+    std::vector<unsigned char>().swap(data);
+}
+
+void GLIndexedVertexArray::prepare_geometry()
+{
+    assert(this->vertices_and_normals_interleaved_VBO_id == 0);
+    if (m_prepared)
+        return;
+    m_prepared = true;
+
+    // Indices of volumes with up to 64k vertices are stored as 16 bit integers.
+    m_short_indices = this->vertices_and_normals_interleaved.size() / 6 <= size_t(std::numeric_limits<GLushort>::max()) + 1;
+
+    if (! this->vertices_and_normals_interleaved.empty()) {
+        m_prepared_vertices.assign(this->vertices_and_normals_interleaved.size() / 6 * sizeof(GLCompactVertex), 0);
+        GLCompactVertex *dst = reinterpret_cast<GLCompactVertex*>(m_prepared_vertices.data());
+        const float     *src = this->vertices_and_normals_interleaved.data();
+        for (const float *end = src + this->vertices_and_normals_interleaved.size(); src != end; src += 6, ++ dst) {
+            dst->normal[0]   = quantize_normal(src[0]);
+            dst->normal[1]   = quantize_normal(src[1]);
+            dst->normal[2]   = quantize_normal(src[2]);
+            dst->normal[3]   = 0;
+            dst->position[0] = src[3];
+            dst->position[1] = src[4];
+            dst->position[2] = src[5];
+        }
+        std::vector<float>().swap(this->vertices_and_normals_interleaved);
+    }
+    if (! this->triangle_indices.empty()) {
+        if (m_short_indices)
+            narrow_indices<GLushort>(this->triangle_indices, m_prepared_triangle_indices);
+        else
+            narrow_indices<GLuint>(this->triangle_indices, m_prepared_triangle_indices);
+        std::vector<int>().swap(this->triangle_indices);
+    }
+    if (! this->quad_indices.empty()) {
+        if (m_short_indices)
+            narrow_indices<GLushort>(this->quad_indices, m_prepared_quad_indices);
+        else
+            narrow_indices<GLuint>(this->quad_indices, m_prepared_quad_indices);
+        std::vector<int>().swap(this->quad_indices);
+    }
+}
+
 void GLIndexedVertexArray::finalize_geometry(bool opengl_initialized)
 {
     assert(this->vertices_and_normals_interleaved_VBO_id == 0);
@@ -84,36 +185,116 @@ void GLIndexedVertexArray::finalize_geometry(bool opengl_initialized)
     assert(this->quad_indices_VBO_id == 0);
 
 	if (! opengl_initialized) {
+        assert(! m_prepared);
 		// Shrink the data vectors to conserve memory in case the data cannot be transfered to the OpenGL driver yet.
 		this->shrink_to_fit();
 		return;
 	}
 
-    if (! this->vertices_and_normals_interleaved.empty()) {
-        glsafe(::glGenBuffers(1, &this->vertices_and_normals_interleaved_VBO_id));
-        glsafe(::glBindBuffer(GL_ARRAY_BUFFER, this->vertices_and_normals_interleaved_VBO_id));
-        glsafe(::glBufferData(GL_ARRAY_BUFFER, this->vertices_and_normals_interleaved.size() * 4, this->vertices_and_normals_interleaved.data(), GL_STATIC_DRAW));
-        glsafe(::glBindBuffer(GL_ARRAY_BUFFER, 0));
-        this->vertices_and_normals_interleaved.clear();
-    }
-    if (! this->triangle_indices.empty()) {
-        glsafe(::glGenBuffers(1, &this->triangle_indices_VBO_id));
-        glsafe(::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->triangle_indices_VBO_id));
-        glsafe(::glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->triangle_indices.size() * 4, this->triangle_indices.data(), GL_STATIC_DRAW));
-        glsafe(::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
-        this->triangle_indices.clear();
+    // Only the upload is left to be done if prepare_geometry() was called by a worker thread.
+    this->prepare_geometry();
+    if (! m_prepared_vertices.empty())
+        upload_buffer(GL_ARRAY_BUFFER, m_prepared_vertices, this->vertices_and_normals_interleaved_VBO_id);
+    if (! m_prepared_triangle_indices.empty())
+        upload_buffer(GL_ELEMENT_ARRAY_BUFFER, m_prepared_triangle_indices, this->triangle_indices_VBO_id);
+    if (! m_prepared_quad_indices.empty())
+        upload_buffer(GL_ELEMENT_ARRAY_BUFFER, m_prepared_quad_indices, this->quad_indices_VBO_id);
+    m_prepared = false;
+}
+
+unsigned int GLIndexedVertexArray::index_type() const
+{
+    return m_short_indices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+size_t GLIndexedVertexArray::gpu_memory_used() const
+{
+	size_t memsize = 0;
+	if (this->vertices_and_normals_interleaved_VBO_id != 0)
+		memsize += this->vertices_and_normals_interleaved_size / 6 * sizeof(GLCompactVertex);
+	if (this->triangle_indices_VBO_id != 0)
+		memsize += this->triangle_indices_size * this->index_size();
+	if (this->quad_indices_VBO_id != 0)
+		memsize += this->quad_indices_size * this->index_size();
+	return memsize;
+}
+
+std::vector<float> GLIndexedVertexArray::download_vertices_and_normals() const
+{
+    assert(this->vertices_and_normals_interleaved_VBO_id != 0);
+
+    std::vector<GLCompactVertex> vertices(this->vertices_and_normals_interleaved_size / 6);
+    glsafe(::glBindBuffer(GL_ARRAY_BUFFER, this->vertices_and_normals_interleaved_VBO_id));
+    glsafe(::glGetBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(GLCompactVertex), vertices.data()));
+    glsafe(::glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+    std::vector<float> out;
+    out.reserve(vertices.size() * 6);
+    for (const GLCompactVertex &v : vertices) {
+        Vec3f n = Vec3f(float(v.normal[0]), float(v.normal[1]), float(v.normal[2])).normalized();
+        out.insert(out.end(), { n(0), n(1), n(2), v.position[0], v.position[1], v.position[2] });
     }
-    if (! this->quad_indices.empty()) {
-        glsafe(::glGenBuffers(1, &this->quad_indices_VBO_id));
-        glsafe(::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->quad_indices_VBO_id));
-        glsafe(::glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->quad_indices.size() * 4, this->quad_indices.data(), GL_STATIC_DRAW));
-        glsafe(::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
-        this->quad_indices.clear();
+    return out;
+}
+
+std::vector<int> GLIndexedVertexArray::download_indices(unsigned int vbo_id, size_t first, size_t count) const
+{
+    assert(vbo_id != 0);
+
+    std::vector<int> out;
+    glsafe(::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo_id));
+    if (m_short_indices) {
+        std::vector<GLushort> data(count);
+        glsafe(::glGetBufferSubData(GL_ELEMENT_ARRAY_BUFFER, first * sizeof(GLushort), count * sizeof(GLushort), data.data()));
+        out.assign(data.begin(), data.end());
+    } else {
+        out.assign(count, 0);
+        glsafe(::glGetBufferSubData(GL_ELEMENT_ARRAY_BUFFER, first * sizeof(GLuint), count * sizeof(GLuint), out.data()));
     }
+    glsafe(::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+    return out;
+}
+
+void GLIndexedVertexArray::share_geometry(GLIndexedVertexArray &rhs)
+{
+    assert(! this->has_VBOs());
+    assert(rhs.has_VBOs());
+
+    // The first sharing hands the ownership of the VBOs over to the shared object.
+    if (! rhs.m_shared_vbos)
+        rhs.m_shared_vbos = std::make_shared<SharedVBOs>(rhs.vertices_and_normals_interleaved_VBO_id, rhs.triangle_indices_VBO_id, rhs.quad_indices_VBO_id);
+
+    this->clear();
+    m_shared_vbos = rhs.m_shared_vbos;
+    this->vertices_and_normals_interleaved_VBO_id = rhs.vertices_and_normals_interleaved_VBO_id;
+    this->triangle_indices_VBO_id                 = rhs.triangle_indices_VBO_id;
+    this->quad_indices_VBO_id                     = rhs.quad_indices_VBO_id;
+    this->vertices_and_normals_interleaved_size   = rhs.vertices_and_normals_interleaved_size;
+    this->triangle_indices_size                   = rhs.triangle_indices_size;
+    this->quad_indices_size                       = rhs.quad_indices_size;
+    this->m_bounding_box                          = rhs.m_bounding_box;
+    this->m_short_indices                         = rhs.m_short_indices;
+}
+
+GLIndexedVertexArray::SharedVBOs::~SharedVBOs()
+{
+    if (this->vertices_and_normals_interleaved_VBO_id)
+        glsafe(::glDeleteBuffers(1, &this->vertices_and_normals_interleaved_VBO_id));
+    if (this->triangle_indices_VBO_id)
+        glsafe(::glDeleteBuffers(1, &this->triangle_indices_VBO_id));
+    if (this->quad_indices_VBO_id)
+        glsafe(::glDeleteBuffers(1, &this->quad_indices_VBO_id));
 }
 
 void GLIndexedVertexArray::release_geometry()
 {
+    if (m_shared_vbos) {
+        // The shared VBOs are deleted by their last user.
+        m_shared_vbos.reset();
+        this->vertices_and_normals_interleaved_VBO_id = 0;
+        this->triangle_indices_VBO_id = 0;
+        this->quad_indices_VBO_id = 0;
+    }
     if (this->vertices_and_normals_interleaved_VBO_id) {
         glsafe(::glDeleteBuffers(1, &this->vertices_and_normals_interleaved_VBO_id));
         this->vertices_and_normals_interleaved_VBO_id = 0;
@@ -135,8 +316,8 @@ void GLIndexedVertexArray::render() const
     assert(this->triangle_indices_VBO_id != 0 || this->quad_indices_VBO_id != 0);
 
     glsafe(::glBindBuffer(GL_ARRAY_BUFFER, this->vertices_and_normals_interleaved_VBO_id));
-    glsafe(::glVertexPointer(3, GL_FLOAT, 6 * sizeof(float), (const void*)(3 * sizeof(float))));
-    glsafe(::glNormalPointer(GL_FLOAT, 6 * sizeof(float), nullptr));
+    glsafe(::glVertexPointer(3, GL_FLOAT, sizeof(GLCompactVertex), (const void*)offsetof(GLCompactVertex, position)));
+    glsafe(::glNormalPointer(GL_BYTE, sizeof(GLCompactVertex), (const void*)offsetof(GLCompactVertex, normal)));
 
     glsafe(::glEnableClientState(GL_VERTEX_ARRAY));
     glsafe(::glEnableClientState(GL_NORMAL_ARRAY));
@@ -144,12 +325,12 @@ void GLIndexedVertexArray::render() const
     // Render using the Vertex Buffer Objects.
     if (this->triangle_indices_size > 0) {
         glsafe(::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->triangle_indices_VBO_id));
-        glsafe(::glDrawElements(GL_TRIANGLES, GLsizei(this->triangle_indices_size), GL_UNSIGNED_INT, nullptr));
+        glsafe(::glDrawElements(GL_TRIANGLES, GLsizei(this->triangle_indices_size), this->index_type(), nullptr));
         glsafe(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
     }
     if (this->quad_indices_size > 0) {
         glsafe(::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->quad_indices_VBO_id));
-        glsafe(::glDrawElements(GL_QUADS, GLsizei(this->quad_indices_size), GL_UNSIGNED_INT, nullptr));
+        glsafe(::glDrawElements(GL_QUADS, GLsizei(this->quad_indices_size), this->index_type(), nullptr));
         glsafe(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
     }
 
@@ -168,20 +349,20 @@ void GLIndexedVertexArray::render(
 
     // Render using the Vertex Buffer Objects.
     glsafe(::glBindBuffer(GL_ARRAY_BUFFER, this->vertices_and_normals_interleaved_VBO_id));
-    glsafe(::glVertexPointer(3, GL_FLOAT, 6 * sizeof(float), (const void*)(3 * sizeof(float))));
-    glsafe(::glNormalPointer(GL_FLOAT, 6 * sizeof(float), nullptr));
+    glsafe(::glVertexPointer(3, GL_FLOAT, sizeof(GLCompactVertex), (const void*)offsetof(GLCompactVertex, position)));
+    glsafe(::glNormalPointer(GL_BYTE, sizeof(GLCompactVertex), (const void*)offsetof(GLCompactVertex, normal)));
 
     glsafe(::glEnableClientState(GL_VERTEX_ARRAY));
     glsafe(::glEnableClientState(GL_NORMAL_ARRAY));
 
     if (this->triangle_indices_size > 0) {
         glsafe(::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->triangle_indices_VBO_id));
-        glsafe(::glDrawElements(GL_TRIANGLES, GLsizei(std::min(this->triangle_indices_size, tverts_range.second - tverts_range.first)), GL_UNSIGNED_INT, (const void*)(tverts_range.first * 4)));
+        glsafe(::glDrawElements(GL_TRIANGLES, GLsizei(std::min(this->triangle_indices_size, tverts_range.second - tverts_range.first)), this->index_type(), (const void*)(tverts_range.first * this->index_size())));
         glsafe(::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
     }
     if (this->quad_indices_size > 0) {
         glsafe(::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->quad_indices_VBO_id));
-        glsafe(::glDrawElements(GL_QUADS, GLsizei(std::min(this->quad_indices_size, qverts_range.second - qverts_range.first)), GL_UNSIGNED_INT, (const void*)(qverts_range.first * 4)));
+        glsafe(::glDrawElements(GL_QUADS, GLsizei(std::min(this->quad_indices_size, qverts_range.second - qverts_range.first)), this->index_type(), (const void*)(qverts_range.first * this->index_size())));
         glsafe(::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
     }
 
@@ -191,6 +372,77 @@ void GLIndexedVertexArray::render(
     glsafe(::glBindBuffer(GL_ARRAY_BUFFER, 0));
 }
 
+// Each level of detail holds a quarter of the triangles of the previous one.
+static const size_t GLVOLUME_LOD_RATIO         = 4;
+// Coarser levels of detail are not worth the memory.
+static const size_t GLVOLUME_LOD_MIN_TRIANGLES = 50000;
+// A level of detail is good enough for display if it has a triangle per this many pixels of the screen area of the volume.
+static const double GLVOLUME_LOD_PIXELS_PER_TRIANGLE = 2.;
+
+GLVolumeLODs::GLVolumeLODs(std::shared_ptr<const TriangleMesh> mesh) : m_mesh(std::move(mesh))
+{
+    for (size_t triangles = m_mesh->facets_count() / GLVOLUME_LOD_RATIO; triangles >= GLVOLUME_LOD_MIN_TRIANGLES; triangles /= GLVOLUME_LOD_RATIO) {
+        m_levels.emplace_back();
+        m_levels.back().triangles = triangles;
+    }
+    if (! m_levels.empty())
+        m_thread = create_thread([this]{ this->thread_proc(); });
+}
+
+GLVolumeLODs::~GLVolumeLODs()
+{
+    m_cancel = true;
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+void GLVolumeLODs::thread_proc()
+{
+    auto throw_on_cancel = [this]() { if (m_cancel) throw CanceledException(); };
+    try {
+        indexed_triangle_set its;
+        if (m_mesh->its.indices.empty()) {
+            TriangleMesh mesh(*m_mesh);
+            mesh.require_shared_vertices();
+            its = std::move(mesh.its);
+        } else
+            its = m_mesh->its;
+        // Release the source mesh as soon as possible if the ModelVolume has been deleted in the meantime.
+        m_mesh.reset();
+        // Each level is decimated from the previous one.
+        for (Level &level : m_levels) {
+            throw_on_cancel();
+            its_quadric_edge_collapse(its, level.triangles, throw_on_cancel);
+            // Only the upload to the OpenGL driver is left to the UI thread.
+            GLIndexedVertexArray array;
+            array.load_its_flat_shading(its);
+            array.prepare_geometry();
+            std::lock_guard<std::mutex> lock(m_mutex);
+            level.triangles = its.indices.size();
+            level.array     = std::move(array);
+            level.ready     = ! its.indices.empty();
+        }
+    } catch (const CanceledException &) {
+    } catch (const std::exception &ex) {
+        BOOST_LOG_TRIVIAL(error) << "Decimation of a mesh for display failed: " << ex.what();
+    }
+}
+
+const GLIndexedVertexArray* GLVolumeLODs::select(double screen_size)
+{
+    double triangles_needed = screen_size * screen_size / GLVOLUME_LOD_PIXELS_PER_TRIANGLE;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto it = m_levels.rbegin(); it != m_levels.rend(); ++ it) {
+        Level &level = *it;
+        if (! level.ready || double(level.triangles) < triangles_needed)
+            continue;
+        if (! level.array.has_VBOs())
+            level.array.finalize_geometry(true);
+        return &level.array;
+    }
+    return nullptr;
+}
+
 const float GLVolume::SELECTED_COLOR[4] = { 0.0f, 1.0f, 0.0f, 1.0f };
 const float GLVolume::HOVER_SELECT_COLOR[4] = { 0.4f, 0.9f, 0.1f, 1.0f };
 const float GLVolume::HOVER_DESELECT_COLOR[4] = { 1.0f, 0.75f, 0.75f, 1.0f };
@@ -210,6 +462,7 @@ GLVolume::GLVolume(float r, float g, float b, float a)
     : m_transformed_bounding_box_dirty(true)
     , m_sla_shift_z(0.0)
     , m_transformed_convex_hull_bounding_box_dirty(true)
+    , m_range_max_z(std::numeric_limits<double>::max())
     // geometry_id == 0 -> invalid
     , geometry_id(std::pair<size_t, size_t>(0, 0))
     , extruder_id(0)
@@ -334,8 +587,10 @@ const BoundingBoxf3& GLVolume::transformed_bounding_box() const
 
 const BoundingBoxf3& GLVolume::transformed_convex_hull_bounding_box() const
 {
-	if (m_transformed_convex_hull_bounding_box_dirty)
+	if (m_transformed_convex_hull_bounding_box_dirty) {
 		m_transformed_convex_hull_bounding_box = this->transformed_convex_hull_bounding_box(world_matrix());
+		m_transformed_convex_hull_bounding_box_dirty = false;
+	}
     return m_transformed_convex_hull_bounding_box;
 }
 
@@ -347,12 +602,24 @@ BoundingBoxf3 GLVolume::transformed_convex_hull_bounding_box(const Transform3d &
 }
 
 
+BoundingBoxf3 GLVolume::transformed_render_bounding_box() const
+{
+    const BoundingBoxf3 &box = bounding_box();
+    if (! box.defined || m_range_max_z >= box.max(2))
+        return this->transformed_bounding_box();
+    // The layers above the range are not rendered.
+    BoundingBoxf3 clipped = box;
+    clipped.max(2) = std::max(clipped.min(2), m_range_max_z);
+    return clipped.transformed(world_matrix());
+}
+
 void GLVolume::set_range(double min_z, double max_z)
 {
     this->qverts_range.first = 0;
     this->qverts_range.second = this->indexed_vertex_array.quad_indices_size;
     this->tverts_range.first = 0;
     this->tverts_range.second = this->indexed_vertex_array.triangle_indices_size;
+    m_range_max_z = std::numeric_limits<double>::max();
     if (! this->print_zs.empty()) {
         // The Z layer range is specified.
         // First test whether the Z span of this object is not out of (min_z, max_z) completely.
@@ -360,9 +627,9 @@ void GLVolume::set_range(double min_z, double max_z)
             this->qverts_range.second = 0;
             this->tverts_range.second = 0;
         } else {
-            // Then find the lowest layer to be displayed.
-            size_t i = 0;
-            for (; i < this->print_zs.size() && this->print_zs[i] < min_z; ++ i);
+            // Then find the lowest layer to be displayed. The print_zs are sorted, look them up by bisection
+            // as this is called for every toolpath volume whenever the layer slider moves.
+            size_t i = std::lower_bound(this->print_zs.begin(), this->print_zs.end(), min_z) - this->print_zs.begin();
             if (i == this->print_zs.size()) {
                 // This shall not happen.
                 this->qverts_range.second = 0;
@@ -372,35 +639,43 @@ void GLVolume::set_range(double min_z, double max_z)
                 this->qverts_range.first = this->offsets[i * 2];
                 this->tverts_range.first = this->offsets[i * 2 + 1];
                 // Some layers are above $min_z. Which?
-                for (; i < this->print_zs.size() && this->print_zs[i] <= max_z; ++ i);
+                i = std::upper_bound(this->print_zs.begin() + i, this->print_zs.end(), max_z) - this->print_zs.begin();
                 if (i < this->print_zs.size()) {
                     this->qverts_range.second = this->offsets[i * 2];
                     this->tverts_range.second = this->offsets[i * 2 + 1];
+                    m_range_max_z = this->print_zs[i - 1];
                 }
             }
         }
     }
 }
 
-void GLVolume::render() const
+void GLVolume::render(const GLIndexedVertexArray *lod) const
 {
     if (!is_active)
         return;
 
+    // Toolpath volumes with no layer inside the current layer range have nothing to draw.
+    if (! this->print_zs.empty() && this->tverts_range.second <= this->tverts_range.first && this->qverts_range.second <= this->qverts_range.first)
+        return;
+
     if (this->is_left_handed())
         glFrontFace(GL_CW);
     glsafe(::glCullFace(GL_BACK));
     glsafe(::glPushMatrix());
     glsafe(::glMultMatrixd(world_matrix().data()));
 
-    this->indexed_vertex_array.render(this->tverts_range, this->qverts_range);
+    if (lod != nullptr)
+        lod->render();
+    else
+        this->indexed_vertex_array.render(this->tverts_range, this->qverts_range);
 
     glsafe(::glPopMatrix());
     if (this->is_left_handed())
         glFrontFace(GL_CCW);
 }
 
-void GLVolume::render(int color_id, int detection_id, int worldmatrix_id) const
+void GLVolume::render(int color_id, int detection_id, int worldmatrix_id, const GLIndexedVertexArray *lod) const
 {
     if (color_id >= 0)
         glsafe(::glUniform4fv(color_id, 1, (const GLfloat*)render_color));
@@ -413,7 +688,7 @@ void GLVolume::render(int color_id, int detection_id, int worldmatrix_id) const
     if (worldmatrix_id != -1)
         glsafe(::glUniformMatrix4fv(worldmatrix_id, 1, GL_FALSE, (const GLfloat*)world_matrix().cast<float>().data()));
 
-    render();
+    render(lod);
 }
 
 bool GLVolume::is_sla_support() const { return this->composite_id.volume_id == -int(slaposSupportTree); }
@@ -439,7 +714,8 @@ int GLVolumeCollection::load_object_volume(
     int                  volume_idx,
     int                  instance_idx,
     const std::string   &color_by,
-    bool 				 opengl_initialized)
+    bool 				 opengl_initialized,
+    GLVolume            *geometry_source)
 {
     const ModelVolume   *model_volume = model_object->volumes[volume_idx];
     const int            extruder_id  = model_volume->extruder_id();
@@ -461,8 +737,24 @@ int GLVolumeCollection::load_object_volume(
     this->volumes.emplace_back(new GLVolume(color));
     GLVolume& v = *this->volumes.back();
     v.set_color_from_model_volume(model_volume);
-    v.indexed_vertex_array.load_mesh(mesh);
-    v.indexed_vertex_array.finalize_geometry(opengl_initialized);
+    // The instances of a ModelVolume differ by their transformation only, share the geometry
+    // of an instance already loaded into the graphics card.
+    std::shared_ptr<const TriangleMesh> mesh_ptr = model_volume->get_mesh_shared_ptr();
+    auto is_loaded = [&mesh_ptr](const GLVolume *volume)
+        { return volume->is_loaded_from(mesh_ptr) && volume->indexed_vertex_array.has_VBOs(); };
+    auto it_loaded = std::find_if(this->volumes.begin(), this->volumes.end() - 1, is_loaded);
+    GLVolume *loaded = (it_loaded != this->volumes.end() - 1) ? *it_loaded :
+                       (geometry_source != nullptr && is_loaded(geometry_source)) ? geometry_source : nullptr;
+    if (loaded != nullptr) {
+        v.indexed_vertex_array.share_geometry(loaded->indexed_vertex_array);
+        v.lods = loaded->lods;
+    } else {
+        v.indexed_vertex_array.load_mesh(mesh);
+        v.indexed_vertex_array.finalize_geometry(opengl_initialized);
+        if (mesh.facets_count() >= GLVolumeLODs::MIN_TRIANGLES)
+            v.lods = std::make_shared<GLVolumeLODs>(mesh_ptr);
+    }
+    v.set_source_mesh(mesh_ptr);
     v.composite_id = GLVolume::CompositeID(obj_idx, volume_idx, instance_idx);
     if (model_volume->is_model_part())
     {
@@ -639,6 +931,43 @@ GLVolumeWithIdAndZList volumes_to_render(const GLVolumePtrs& volumes, GLVolumeCo
     return list;
 }
 
+// Is the bounding box completely outside of the view frustum? The box is outside if all its corners are
+// on the outer side of one of the clipping planes.
+static bool is_outside_frustum(const BoundingBoxf3 &bbox, const Eigen::Matrix4d &view_projection_matrix)
+{
+    if (! bbox.defined)
+        return false;
+    // Bit mask of the clipping planes, for which all the corners tested so far are outside.
+    unsigned int outside = 0x3f;
+    for (size_t i = 0; i < 8 && outside != 0; ++ i) {
+        Vec3d corner((i & 1) ? bbox.max(0) : bbox.min(0), (i & 2) ? bbox.max(1) : bbox.min(1), (i & 4) ? bbox.max(2) : bbox.min(2));
+        Eigen::Vector4d clip = view_projection_matrix * Eigen::Vector4d(corner(0), corner(1), corner(2), 1.);
+        unsigned int mask = 0;
+        for (int axis = 0; axis < 3; ++ axis) {
+            if (clip(axis) < - clip(3))
+                mask |= 1 << (2 * axis);
+            if (clip(axis) > clip(3))
+                mask |= 2 << (2 * axis);
+        }
+        outside &= mask;
+    }
+    return outside != 0;
+}
+
+// Size of the screen rectangle covered by the bounding box in pixels, infinite if the box reaches behind the camera.
+static double screen_size(const BoundingBoxf3 &bbox, const Eigen::Matrix4d &view_projection_matrix, const GLint viewport[4])
+{
+    BoundingBoxf rect;
+    for (size_t i = 0; i < 8; ++ i) {
+        Vec3d corner((i & 1) ? bbox.max(0) : bbox.min(0), (i & 2) ? bbox.max(1) : bbox.min(1), (i & 4) ? bbox.max(2) : bbox.min(2));
+        Eigen::Vector4d clip = view_projection_matrix * Eigen::Vector4d(corner(0), corner(1), corner(2), 1.);
+        if (clip(3) <= 0.)
+            return std::numeric_limits<double>::max();
+        rect.merge(Vec2d(0.5 * viewport[2] * clip(0) / clip(3), 0.5 * viewport[3] * clip(1) / clip(3)));
+    }
+    return rect.size().maxCoeff();
+}
+
 void GLVolumeCollection::render(GLVolumeCollection::ERenderType type, bool disable_cullface, const Transform3d& view_matrix, std::function<bool(const GLVolume&)> filter_func) const
 {
     glsafe(::glEnable(GL_BLEND));
@@ -674,10 +1003,56 @@ void GLVolumeCollection::render(GLVolumeCollection::ERenderType type, bool disab
     if (clipping_plane_id != -1)
         glsafe(::glUniform4fv(clipping_plane_id, 1, (const GLfloat*)clipping_plane));
 
+    // Projection to the clip space for culling and for the selection of the levels of detail.
+    Eigen::Matrix4d projection_matrix;
+    glsafe(::glGetDoublev(GL_PROJECTION_MATRIX, projection_matrix.data()));
+    GLint viewport[4];
+    glsafe(::glGetIntegerv(GL_VIEWPORT, viewport));
+    const Eigen::Matrix4d view_projection_matrix = projection_matrix * view_matrix.matrix();
+
+    // Cull the volumes and resolve their colors and levels of detail first.
     GLVolumeWithIdAndZList to_render = volumes_to_render(this->volumes, type, view_matrix, filter_func);
+    std::vector<std::pair<GLVolume*, const GLIndexedVertexArray*>> draws;
+    draws.reserve(to_render.size());
     for (GLVolumeWithIdAndZ& volume : to_render) {
+        if (is_outside_frustum(volume.first->transformed_render_bounding_box(), view_projection_matrix))
+            continue;
         volume.first->set_render_color();
-        volume.first->render(color_id, print_box_detection_id, print_box_worldmatrix_id);
+        const GLIndexedVertexArray *lod = nullptr;
+        if (volume.first->lods)
+            lod = volume.first->lods->select(screen_size(volume.first->transformed_bounding_box(), view_projection_matrix, viewport));
+        draws.emplace_back(volume.first, lod);
+    }
+    if (type == Opaque)
+        // The order of the opaque volumes does not change the image, the depth test resolves the overlaps.
+        // Keep the selected volumes first, group the rest by color to save on the uniform updates below.
+        std::stable_sort(draws.begin(), draws.end(),
+            [](const std::pair<GLVolume*, const GLIndexedVertexArray*> &d1, const std::pair<GLVolume*, const GLIndexedVertexArray*> &d2) {
+                if (d1.first->selected != d2.first->selected)
+                    return d1.first->selected;
+                return memcmp(d1.first->render_color, d2.first->render_color, sizeof(d1.first->render_color)) < 0;
+            });
+
+    // Upload the uniforms shared by consecutive volumes just once.
+    const float *last_color     = nullptr;
+    int          last_detection = -1;
+    for (const std::pair<GLVolume*, const GLIndexedVertexArray*> &draw : draws) {
+        const GLVolume &volume = *draw.first;
+        if (last_color == nullptr || ! std::equal(last_color, last_color + 4, volume.render_color)) {
+            if (color_id >= 0)
+                glsafe(::glUniform4fv(color_id, 1, (const GLfloat*)volume.render_color));
+            else
+                glsafe(::glColor4fv(volume.render_color));
+            last_color = volume.render_color;
+        }
+        int detection = volume.shader_outside_printer_detection_enabled ? 1 : 0;
+        if (print_box_detection_id != -1 && detection != last_detection) {
+            glsafe(::glUniform1i(print_box_detection_id, detection));
+            last_detection = detection;
+        }
+        if (print_box_worldmatrix_id != -1)
+            glsafe(::glUniformMatrix4fv(print_box_worldmatrix_id, 1, GL_FALSE, (const GLfloat*)volume.world_matrix().cast<float>().data()));
+        volume.render(draw.second);
     }
 
     glsafe(::glBindBuffer(GL_ARRAY_BUFFER, 0));
@@ -968,11 +1343,7 @@ void GLVolumeCollection::export_toolpaths_to_obj(const char* filename) const
         else if ((volume->indexed_vertex_array.vertices_and_normals_interleaved_VBO_id != 0) && (volume->indexed_vertex_array.vertices_and_normals_interleaved_size != 0))
         {
             // data are in GPU memory
-            src_vertices_and_normals_interleaved = std::vector<float>(volume->indexed_vertex_array.vertices_and_normals_interleaved_size, 0.0f);
-
-            glsafe(::glBindBuffer(GL_ARRAY_BUFFER, volume->indexed_vertex_array.vertices_and_normals_interleaved_VBO_id));
-            glsafe(::glGetBufferSubData(GL_ARRAY_BUFFER, 0, src_vertices_and_normals_interleaved.size() * sizeof(float), src_vertices_and_normals_interleaved.data()));
-            glsafe(::glBindBuffer(GL_ARRAY_BUFFER, 0));
+            src_vertices_and_normals_interleaved = volume->indexed_vertex_array.download_vertices_and_normals();
         }
         else
             continue;
@@ -993,13 +1364,7 @@ void GLVolumeCollection::export_toolpaths_to_obj(const char* filename) const
             // data are in GPU memory
             size_t size = std::min(volume->indexed_vertex_array.triangle_indices_size, volume->tverts_range.second - volume->tverts_range.first);
             if (size != 0)
-            {
-                src_triangle_indices = std::vector<int>(size, 0);
-
-                glsafe(::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, volume->indexed_vertex_array.triangle_indices_VBO_id));
-                glsafe(::glGetBufferSubData(GL_ELEMENT_ARRAY_BUFFER, volume->tverts_range.first * sizeof(int), size * sizeof(int), src_triangle_indices.data()));
-                glsafe(::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
-            }
+                src_triangle_indices = volume->indexed_vertex_array.download_triangle_indices(volume->tverts_range.first, size);
         }
 
         if (!volume->indexed_vertex_array.quad_indices.empty())
@@ -1018,13 +1383,7 @@ void GLVolumeCollection::export_toolpaths_to_obj(const char* filename) const
             // data are in GPU memory
             size_t size = std::min(volume->indexed_vertex_array.quad_indices_size, volume->qverts_range.second - volume->qverts_range.first);
             if (size != 0)
-            {
-                src_quad_indices = std::vector<int>(size, 0);
-
-                glsafe(::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, volume->indexed_vertex_array.quad_indices_VBO_id));
-                glsafe(::glGetBufferSubData(GL_ELEMENT_ARRAY_BUFFER, volume->qverts_range.first * sizeof(int), size * sizeof(int), src_quad_indices.data()));
-                glsafe(::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
-            }
+                src_quad_indices = volume->indexed_vertex_array.download_quad_indices(volume->qverts_range.first, size);
         }
 
         if (src_triangle_indices.empty() && src_quad_indices.empty())
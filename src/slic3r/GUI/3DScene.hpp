@@ -9,8 +9,12 @@
 #include "libslic3r/Model.hpp"
 #include "slic3r/GUI/GLCanvas3DManager.hpp"
 
+#include <atomic>
 #include <functional>
 #include <memory>
+#include <mutex>
+
+#include <boost/thread.hpp>
 
 #ifndef NDEBUG
 #define HAS_GLSAFE
@@ -64,7 +68,7 @@ public:
         vertices_and_normals_interleaved_VBO_id(0),
         triangle_indices_VBO_id(0),
         quad_indices_VBO_id(0)
-        { assert(! rhs.has_VBOs()); }
+        { assert(! rhs.has_VBOs() && ! rhs.m_prepared); }
     GLIndexedVertexArray(GLIndexedVertexArray &&rhs) :
         vertices_and_normals_interleaved(std::move(rhs.vertices_and_normals_interleaved)),
         triangle_indices(std::move(rhs.triangle_indices)),
@@ -72,7 +76,7 @@ public:
         vertices_and_normals_interleaved_VBO_id(0),
         triangle_indices_VBO_id(0),
         quad_indices_VBO_id(0)
-        { assert(! rhs.has_VBOs()); }
+        { assert(! rhs.has_VBOs() && ! rhs.m_prepared); }
 
     ~GLIndexedVertexArray() { release_geometry(); }
 
@@ -84,6 +88,7 @@ public:
         assert(rhs.vertices_and_normals_interleaved_VBO_id == 0);
         assert(rhs.triangle_indices_VBO_id == 0);
         assert(rhs.quad_indices_VBO_id == 0);
+        assert(! m_prepared && ! rhs.m_prepared);
         this->vertices_and_normals_interleaved 		 = rhs.vertices_and_normals_interleaved;
         this->triangle_indices                 		 = rhs.triangle_indices;
         this->quad_indices                     		 = rhs.quad_indices;
@@ -109,6 +114,12 @@ public:
         this->vertices_and_normals_interleaved_size  = rhs.vertices_and_normals_interleaved_size;
         this->triangle_indices_size                  = rhs.triangle_indices_size;
         this->quad_indices_size                      = rhs.quad_indices_size;
+        this->m_short_indices                        = rhs.m_short_indices;
+        this->m_prepared                             = rhs.m_prepared;
+        this->m_prepared_vertices                    = std::move(rhs.m_prepared_vertices);
+        this->m_prepared_triangle_indices            = std::move(rhs.m_prepared_triangle_indices);
+        this->m_prepared_quad_indices                = std::move(rhs.m_prepared_quad_indices);
+        rhs.m_prepared                               = false;
         return *this;
     }
 
@@ -131,6 +142,8 @@ public:
 
     void load_mesh_full_shading(const TriangleMesh &mesh);
     void load_mesh(const TriangleMesh& mesh) { this->load_mesh_full_shading(mesh); }
+    // Flat shaded triangles of an indexed triangle set, the normals are calculated from the vertices.
+    void load_its_flat_shading(const indexed_triangle_set &its);
 
     inline bool has_VBOs() const { return vertices_and_normals_interleaved_VBO_id != 0; }
 
@@ -197,12 +210,23 @@ public:
     // upload the geometry and indices to OpenGL VBO objects
     // and shrink the allocated data, possibly relasing it if it has been loaded into the VBOs.
     void finalize_geometry(bool opengl_initialized);
+    // Convert the geometry to the layout of the VBOs without touching OpenGL, thus it may be called by a worker thread.
+    // The std::vectors are released, a following finalize_geometry(true) on the UI thread only uploads the converted data.
+    void prepare_geometry();
+    // Reference the VBOs of another array instead of loading the same geometry again,
+    // for example for the instances of a single ModelVolume. The VBOs are released with their last user.
+    void share_geometry(GLIndexedVertexArray &rhs);
     // Release the geometry data, release OpenGL VBOs.
     void release_geometry();
 
     void render() const;
     void render(const std::pair<size_t, size_t>& tverts_range, const std::pair<size_t, size_t>& qverts_range) const;
 
+    // Read the geometry back from the VBOs, in the layout of the CPU side arrays.
+    std::vector<float> download_vertices_and_normals() const;
+    std::vector<int>   download_triangle_indices(size_t first, size_t count) const { return this->download_indices(this->triangle_indices_VBO_id, first, count); }
+    std::vector<int>   download_quad_indices(size_t first, size_t count) const { return this->download_indices(this->quad_indices_VBO_id, first, count); }
+
     // Is there any geometry data stored?
     bool empty() const { return vertices_and_normals_interleaved_size == 0; }
 
@@ -210,6 +234,10 @@ public:
         this->vertices_and_normals_interleaved.clear();
         this->triangle_indices.clear();
         this->quad_indices.clear();
+        m_prepared_vertices.clear();
+        m_prepared_triangle_indices.clear();
+        m_prepared_quad_indices.clear();
+        m_prepared = false;
         this->m_bounding_box.reset();
         vertices_and_normals_interleaved_size = 0;
         triangle_indices_size = 0;
@@ -226,23 +254,82 @@ public:
     const BoundingBoxf3& bounding_box() const { return m_bounding_box; }
 
     // Return an estimate of the memory consumed by this class.
-    size_t cpu_memory_used() const { return sizeof(*this) + vertices_and_normals_interleaved.capacity() * sizeof(float) + triangle_indices.capacity() * sizeof(int) + quad_indices.capacity() * sizeof(int); }
+    size_t cpu_memory_used() const { return sizeof(*this) + vertices_and_normals_interleaved.capacity() * sizeof(float) + triangle_indices.capacity() * sizeof(int) + quad_indices.capacity() * sizeof(int) +
+        m_prepared_vertices.capacity() + m_prepared_triangle_indices.capacity() + m_prepared_quad_indices.capacity(); }
     // Return an estimate of the memory held by GPU vertex buffers.
-    size_t gpu_memory_used() const
-    {
-    	size_t memsize = 0;
-    	if (this->vertices_and_normals_interleaved_VBO_id != 0)
-    		memsize += this->vertices_and_normals_interleaved_size * 4;
-    	if (this->triangle_indices_VBO_id != 0)
-    		memsize += this->triangle_indices_size * 4;
-    	if (this->quad_indices_VBO_id != 0)
-    		memsize += this->quad_indices_size * 4;
-    	return memsize;
-    }
+    size_t gpu_memory_used() const;
     size_t total_memory_used() const { return this->cpu_memory_used() + this->gpu_memory_used(); }
 
 private:
     BoundingBoxf3 m_bounding_box;
+    // The VBOs hold the normals quantized to bytes and, if there are at most 64k vertices, 16 bit indices.
+    bool          m_short_indices{ false };
+    // Set by prepare_geometry(), the data below waits for the upload by finalize_geometry().
+    bool          m_prepared{ false };
+    std::vector<unsigned char> m_prepared_vertices;
+    std::vector<unsigned char> m_prepared_triangle_indices;
+    std::vector<unsigned char> m_prepared_quad_indices;
+
+    unsigned int index_type() const;
+    size_t       index_size() const { return m_short_indices ? 2 : 4; }
+    std::vector<int> download_indices(unsigned int vbo_id, size_t first, size_t count) const;
+
+    // VBOs shared by multiple arrays, see share_geometry().
+    struct SharedVBOs {
+        SharedVBOs(unsigned int vertices_and_normals_interleaved_VBO_id, unsigned int triangle_indices_VBO_id, unsigned int quad_indices_VBO_id) :
+            vertices_and_normals_interleaved_VBO_id(vertices_and_normals_interleaved_VBO_id),
+            triangle_indices_VBO_id(triangle_indices_VBO_id),
+            quad_indices_VBO_id(quad_indices_VBO_id)
+            {}
+        SharedVBOs(const SharedVBOs &) = delete;
+        SharedVBOs& operator=(const SharedVBOs &) = delete;
+        ~SharedVBOs();
+
+        unsigned int vertices_and_normals_interleaved_VBO_id;
+        unsigned int triangle_indices_VBO_id;
+        unsigned int quad_indices_VBO_id;
+    };
+    std::shared_ptr<SharedVBOs> m_shared_vbos;
+};
+
+// Decimated copies of a huge mesh for display, produced by a background thread.
+// The volumes of the instances of a ModelVolume share a single object, the source mesh
+// is kept in full resolution for slicing and picking.
+class GLVolumeLODs
+{
+public:
+    // Meshes with fewer triangles are always displayed in full resolution.
+    static const size_t MIN_TRIANGLES = 1000000;
+
+    explicit GLVolumeLODs(std::shared_ptr<const TriangleMesh> mesh);
+    ~GLVolumeLODs();
+
+    GLVolumeLODs(const GLVolumeLODs &) = delete;
+    GLVolumeLODs& operator=(const GLVolumeLODs &) = delete;
+
+    // Returns the coarsest level of detail finished so far with enough triangles for a volume
+    // covering screen_size x screen_size pixels, nullptr if the full resolution mesh shall be rendered.
+    // The levels finished in the meantime are uploaded to the VBOs, therefore to be called
+    // from the thread owning the OpenGL context.
+    const GLIndexedVertexArray* select(double screen_size);
+
+private:
+    struct Level {
+        // Target number of triangles.
+        size_t                  triangles { 0 };
+        // Decimated mesh converted by the background thread, uploaded on the first use.
+        GLIndexedVertexArray    array;
+        bool                    ready { false };
+    };
+
+    void thread_proc();
+
+    std::shared_ptr<const TriangleMesh> m_mesh;
+    // From the finest to the coarsest, allocated by the constructor.
+    std::vector<Level>          m_levels;
+    std::mutex                  m_mutex;
+    std::atomic<bool>           m_cancel { false };
+    boost::thread               m_thread;
 };
 
 class GLVolume {
@@ -279,10 +366,15 @@ private:
     mutable bool          m_transformed_bounding_box_dirty;
     // Convex hull of the volume, if any.
     std::shared_ptr<const TriangleMesh> m_convex_hull;
+    // Mesh of the ModelVolume loaded into indexed_vertex_array, if any. The volumes of the other instances
+    // of the same ModelVolume share the VBOs of this volume.
+    std::weak_ptr<const TriangleMesh> m_source_mesh;
     // Bounding box of this volume, in unscaled coordinates.
     mutable BoundingBoxf3 m_transformed_convex_hull_bounding_box;
     // Whether or not is needed to recalculate the transformed convex hull bounding box.
     mutable bool          m_transformed_convex_hull_bounding_box_dirty;
+    // Top of the highest layer of the range set by set_range(), the extrusions above are not rendered.
+    double                m_range_max_z;
 
 public:
     // Color of the triangles / quads held by this volume.
@@ -343,6 +435,8 @@ public:
 
     // Interleaved triangles & normals with indexed triangles & quads.
     GLIndexedVertexArray        indexed_vertex_array;
+    // Display levels of detail of huge meshes, shared by the instances of a ModelVolume.
+    std::shared_ptr<GLVolumeLODs> lods;
     // Ranges of triangle and quad indices to be rendered.
     std::pair<size_t, size_t>   tverts_range;
     std::pair<size_t, size_t>   qverts_range;
@@ -418,11 +512,11 @@ public:
     void set_volume_mirror(Axis axis, double mirror) { m_volume_transformation.set_mirror(axis, mirror); set_bounding_boxes_as_dirty(); }
      
     double get_sla_shift_z() const { return m_sla_shift_z; }
-    void set_sla_shift_z(double z) { m_sla_shift_z = z; }
+    void set_sla_shift_z(double z) { m_sla_shift_z = z; set_bounding_boxes_as_dirty(); }
 
-    void set_convex_hull(std::shared_ptr<const TriangleMesh> convex_hull) { m_convex_hull = std::move(convex_hull); }
-    void set_convex_hull(const TriangleMesh &convex_hull) { m_convex_hull = std::make_shared<const TriangleMesh>(convex_hull); }
-    void set_convex_hull(TriangleMesh &&convex_hull) { m_convex_hull = std::make_shared<const TriangleMesh>(std::move(convex_hull)); }
+    void set_convex_hull(std::shared_ptr<const TriangleMesh> convex_hull) { m_convex_hull = std::move(convex_hull); m_transformed_convex_hull_bounding_box_dirty = true; }
+    void set_convex_hull(const TriangleMesh &convex_hull) { m_convex_hull = std::make_shared<const TriangleMesh>(convex_hull); m_transformed_convex_hull_bounding_box_dirty = true; }
+    void set_convex_hull(TriangleMesh &&convex_hull) { m_convex_hull = std::make_shared<const TriangleMesh>(std::move(convex_hull)); m_transformed_convex_hull_bounding_box_dirty = true; }
 
     int                 object_idx() const { return this->composite_id.object_id; }
     int                 volume_idx() const { return this->composite_id.volume_id; }
@@ -436,18 +530,26 @@ public:
     BoundingBoxf3        transformed_convex_hull_bounding_box(const Transform3d &trafo) const;
     // caching variant
     const BoundingBoxf3& transformed_convex_hull_bounding_box() const;
+    // Transformed bounding box of the layers rendered, for culling.
+    BoundingBoxf3        transformed_render_bounding_box() const;
     // convex hull
     const TriangleMesh*  convex_hull() const { return m_convex_hull.get(); }
 
+    void set_source_mesh(const std::shared_ptr<const TriangleMesh> &mesh) { m_source_mesh = mesh; }
+    // Is indexed_vertex_array loaded from the given mesh?
+    bool is_loaded_from(const std::shared_ptr<const TriangleMesh> &mesh) const
+        { return mesh && ! m_source_mesh.owner_before(mesh) && ! mesh.owner_before(m_source_mesh); }
+
     bool                empty() const { return this->indexed_vertex_array.empty(); }
 
     void                set_range(double low, double high);
 
-    void                render() const;
-    void                render(int color_id, int detection_id, int worldmatrix_id) const;
+    // Render the given level of detail instead of indexed_vertex_array, if not null.
+    void                render(const GLIndexedVertexArray *lod = nullptr) const;
+    void                render(int color_id, int detection_id, int worldmatrix_id, const GLIndexedVertexArray *lod = nullptr) const;
 
     void                finalize_geometry(bool opengl_initialized) { this->indexed_vertex_array.finalize_geometry(opengl_initialized); }
-    void                release_geometry() { this->indexed_vertex_array.release_geometry(); }
+    void                release_geometry() { this->indexed_vertex_array.release_geometry(); this->lods.reset(); }
 
     void                set_bounding_boxes_as_dirty() { m_transformed_bounding_box_dirty = true; m_transformed_convex_hull_bounding_box_dirty = true; }
 
@@ -502,13 +604,16 @@ public:
         const std::string 		&color_by,
         bool 					 opengl_initialized);
 
+    // The geometry is shared with a volume loaded from the same mesh, either one of the collection
+    // or the geometry_source (a volume being released for example), if any.
     int load_object_volume(
         const ModelObject *model_object,
         int                obj_idx,
         int                volume_idx,
         int                instance_idx,
         const std::string &color_by,
-        bool 			   opengl_initialized);
+        bool 			   opengl_initialized,
+        GLVolume          *geometry_source = nullptr);
 
     // Load SLA auxiliary GLVolumes (for support trees or pad).
     void load_object_auxiliary(
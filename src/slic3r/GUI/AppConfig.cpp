@@ -61,6 +61,9 @@ void AppConfig::set_defaults()
     if (get("preset_update").empty())
         set("preset_update", "1");
 
+    if (get("export_preview_snapshot").empty())
+        set("export_preview_snapshot", "0");
+
 #if ENABLE_CONFIGURABLE_PATHS_EXPORT_TO_3MF_AND_AMF
     if (get("export_sources_full_pathnames").empty())
         set("export_sources_full_pathnames", "0");
@@ -84,6 +87,15 @@ void AppConfig::set_defaults()
     if (get("custom_toolbar_size").empty())
         set("custom_toolbar_size", "100");
 
+    if (get("slice_cache").empty())
+        set("slice_cache", "0");
+
+    if (get("lean_slicing").empty())
+        set("lean_slicing", "0");
+
+    if (get("threads").empty())
+        set("threads", "0");
+
     if (get("use_perspective_camera").empty())
         set("use_perspective_camera", "1");
 
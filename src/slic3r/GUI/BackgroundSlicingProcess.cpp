@@ -104,6 +104,8 @@ void BackgroundSlicingProcess::process_fff()
 	    		throw std::runtime_error(_utf8(L("Copying of the temporary G-code to the output G-code failed. Maybe the SD card is write locked?")));
 	    	m_print->set_status(95, _utf8(L("Running post-processing scripts")));
 	    	run_post_process_scripts(export_path, m_fff_print->config());
+	    	if (GUI::wxGetApp().app_config->get("export_preview_snapshot") == "1" && m_gcode_preview_data != nullptr)
+	    		this->save_preview_snapshot(export_path);
 	    	m_print->set_status(100, (boost::format(_utf8(L("G-code file exported to %1%"))) % export_path).str());
 	    } else if (! m_upload_job.empty()) {
 			prepare_upload();
@@ -114,6 +116,16 @@ void BackgroundSlicingProcess::process_fff()
 	}
 }
 
+// Snapshot of the preview data next to the exported (and post-processed) G-code. A failure does not fail the export.
+void BackgroundSlicingProcess::save_preview_snapshot(const std::string &export_path) const
+{
+	try {
+		m_gcode_preview_data->save_snapshot(GCodePreviewData::snapshot_path(export_path), GCodePreviewData::gcode_file_hash(export_path));
+	} catch (const std::exception &ex) {
+		BOOST_LOG_TRIVIAL(error) << "Saving the G-code preview snapshot failed: " << ex.what();
+	}
+}
+
 #if ENABLE_THUMBNAIL_GENERATOR
 static void write_thumbnail(Zipper& zipper, const ThumbnailData& data)
 {
@@ -187,11 +199,14 @@ void BackgroundSlicingProcess::thread_proc()
 		std::string error;
 		try {
 			assert(m_print != nullptr);
-			switch(m_print->technology()) {
-				case ptFFF: this->process_fff(); break;
-                case ptSLA: this->process_sla(); break;
-				default: m_print->process(); break;
-			}
+			// Process and export in a task arena limited to the number of threads set in the preferences.
+			run_in_thread_arena([this]() {
+				switch(m_print->technology()) {
+					case ptFFF: this->process_fff(); break;
+	                case ptSLA: this->process_sla(); break;
+					default: m_print->process(); break;
+				}
+			});
 		} catch (CanceledException & /* ex */) {
 			// Canceled, this is all right.
 			assert(m_print->canceled());
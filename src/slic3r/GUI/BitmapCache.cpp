@@ -1,4 +1,5 @@
 #include "BitmapCache.hpp"
+#include "IconRasterCache.hpp"
 
 #include "libslic3r/Utils.hpp"
 #include <boost/filesystem.hpp>
@@ -268,12 +269,20 @@ wxBitmap* BitmapCache::load_svg(const std::string &bitmap_name, unsigned target_
             return it->second;
     }
 
-    NSVGimage *image = ::nsvgParseFromFile(Slic3r::var(folder + bitmap_name + ".svg").c_str(), "px", 96.0f);
+    target_height != 0 ? target_height *= scale : target_width *= scale;
+
+    // The raster is stored into the on-disk cache, the SVG is parsed and rasterized only for the first time at this size.
+    std::string                svg_file  = Slic3r::var(folder + bitmap_name + ".svg");
+    std::string                cache_key = IconRasterCache::key({ svg_file }, "bitmap-w" + std::to_string(target_width) + "-h" + std::to_string(target_height));
+    unsigned int               cached_width, cached_height;
+    std::vector<unsigned char> data;
+    if (IconRasterCache::load(cache_key, cached_width, cached_height, data))
+        return this->insert_raw_rgba(bitmap_key, cached_width, cached_height, data.data(), scale, grayscale);
+
+    NSVGimage *image = ::nsvgParseFromFile(svg_file.c_str(), "px", 96.0f);
     if (image == nullptr)
         return nullptr;
 
-    target_height != 0 ? target_height *= scale : target_width *= scale;
-
     float svg_scale = target_height != 0 ? 
                   (float)target_height / image->height  : target_width != 0 ?
                   (float)target_width / image->width    : 1;
@@ -292,10 +301,11 @@ wxBitmap* BitmapCache::load_svg(const std::string &bitmap_name, unsigned target_
         return nullptr;
     }
 
-    std::vector<unsigned char> data(n_pixels * 4, 0);
+    data.assign(n_pixels * 4, 0);
     ::nsvgRasterize(rast, image, 0, 0, svg_scale, data.data(), width, height, width * 4);
     ::nsvgDeleteRasterizer(rast);
     ::nsvgDelete(image);
+    IconRasterCache::save(cache_key, (unsigned int)width, (unsigned int)height, data);
 
     return this->insert_raw_rgba(bitmap_key, width, height, data.data(), scale, grayscale);
 }
@@ -15,6 +15,7 @@
 #include "libslic3r/Utils.hpp"
 #include "libslic3r/Technologies.hpp"
 #include "libslic3r/Tesselate.hpp"
+#include "libslic3r/SlicingAdaptive.hpp"
 #include "slic3r/GUI/3DScene.hpp"
 #include "slic3r/GUI/BackgroundSlicingProcess.hpp"
 #include "slic3r/GUI/GLShader.hpp"
@@ -131,6 +132,7 @@ GLCanvas3D::LayersEditing::LayersEditing()
     , m_model_object(nullptr)
     , m_object_max_z(0.f)
     , m_slicing_parameters(nullptr)
+    , m_slicing_adaptive(nullptr)
     , m_layer_height_profile_modified(false)
     , m_adaptive_quality(0.5f)
     , state(Unknown)
@@ -150,6 +152,7 @@ GLCanvas3D::LayersEditing::~LayersEditing()
         m_z_texture_id = 0;
     }
     delete m_slicing_parameters;
+    delete m_slicing_adaptive;
 }
 
 const float GLCanvas3D::LayersEditing::THICKNESS_BAR_WIDTH = 70.0f;
@@ -176,6 +179,8 @@ void GLCanvas3D::LayersEditing::set_config(const DynamicPrintConfig* config)
     m_config = config;
     delete m_slicing_parameters;
     m_slicing_parameters = nullptr;
+    delete m_slicing_adaptive;
+    m_slicing_adaptive = nullptr;
     m_layers_texture.valid = false;
 }
 
@@ -192,6 +197,8 @@ void GLCanvas3D::LayersEditing::select_object(const Model &model, int object_id)
         m_layer_height_profile_modified = false;
         delete m_slicing_parameters;
         m_slicing_parameters   = nullptr;
+        delete m_slicing_adaptive;
+        m_slicing_adaptive     = nullptr;
         m_layers_texture.valid = false;
         this->last_object_id   = object_id;
         m_model_object         = model_object_new;
@@ -445,10 +452,17 @@ void GLCanvas3D::LayersEditing::render_profile(const Rect& bar_rect) const
 
     // Curve
     glsafe(::glColor3f(0.0f, 0.0f, 1.0f));
-    ::glBegin(GL_LINE_STRIP);
-    for (unsigned int i = 0; i < m_layer_height_profile.size(); i += 2)
-        ::glVertex2f(bar_rect.get_left() + (float)m_layer_height_profile[i + 1] * scale_x, bar_rect.get_bottom() + (float)m_layer_height_profile[i] * scale_y);
-    glsafe(::glEnd());
+    // The profile may have thousands of points, draw it from a vertex array instead of the immediate mode.
+    std::vector<Vec2f> curve;
+    curve.reserve(m_layer_height_profile.size() / 2);
+    for (unsigned int i = 0; i + 1 < m_layer_height_profile.size(); i += 2)
+        curve.emplace_back(bar_rect.get_left() + (float)m_layer_height_profile[i + 1] * scale_x, bar_rect.get_bottom() + (float)m_layer_height_profile[i] * scale_y);
+    if (! curve.empty()) {
+        glsafe(::glEnableClientState(GL_VERTEX_ARRAY));
+        glsafe(::glVertexPointer(2, GL_FLOAT, 0, (const void*)curve.front().data()));
+        glsafe(::glDrawArrays(GL_LINE_STRIP, 0, (GLsizei)curve.size()));
+        glsafe(::glDisableClientState(GL_VERTEX_ARRAY));
+    }
 }
 
 void GLCanvas3D::LayersEditing::render_volumes(const GLCanvas3D& canvas, const GLVolumeCollection &volumes) const
@@ -467,12 +481,12 @@ void GLCanvas3D::LayersEditing::render_volumes(const GLCanvas3D& canvas, const G
         // The layer editing shader was already active.
         current_program_id = -1;
 
-    GLint z_to_texture_row_id               = ::glGetUniformLocation(shader_id, "z_to_texture_row");
-    GLint z_texture_row_to_normalized_id    = ::glGetUniformLocation(shader_id, "z_texture_row_to_normalized");
-    GLint z_cursor_id                       = ::glGetUniformLocation(shader_id, "z_cursor");
-    GLint z_cursor_band_width_id            = ::glGetUniformLocation(shader_id, "z_cursor_band_width");
-    GLint world_matrix_id                   = ::glGetUniformLocation(shader_id, "volume_world_matrix");
-    GLint object_max_z_id                   = ::glGetUniformLocation(shader_id, "object_max_z");
+    GLint z_to_texture_row_id               = m_shader.get_uniform_location("z_to_texture_row");
+    GLint z_texture_row_to_normalized_id    = m_shader.get_uniform_location("z_texture_row_to_normalized");
+    GLint z_cursor_id                       = m_shader.get_uniform_location("z_cursor");
+    GLint z_cursor_band_width_id            = m_shader.get_uniform_location("z_cursor_band_width");
+    GLint world_matrix_id                   = m_shader.get_uniform_location("volume_world_matrix");
+    GLint object_max_z_id                   = m_shader.get_uniform_location("object_max_z");
     glcheck();
 
     if (z_to_texture_row_id != -1 && z_texture_row_to_normalized_id != -1 && z_cursor_id != -1 && z_cursor_band_width_id != -1 && world_matrix_id != -1) 
@@ -484,17 +498,8 @@ void GLCanvas3D::LayersEditing::render_volumes(const GLCanvas3D& canvas, const G
         glsafe(::glUniform1f(z_texture_row_to_normalized_id, GLfloat(1.0f / m_layers_texture.height)));
         glsafe(::glUniform1f(z_cursor_id, GLfloat(m_object_max_z) * GLfloat(this->get_cursor_z_relative(canvas))));
         glsafe(::glUniform1f(z_cursor_band_width_id, GLfloat(this->band_width)));
-        // Initialize the layer height texture mapping.
-        GLsizei w = (GLsizei)m_layers_texture.width;
-        GLsizei h = (GLsizei)m_layers_texture.height;
-        GLsizei half_w = w / 2;
-        GLsizei half_h = h / 2;
-        glsafe(::glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+        // The layer height texture mapping was uploaded by generate_layer_height_texture().
         glsafe(::glBindTexture(GL_TEXTURE_2D, m_z_texture_id));
-        glsafe(::glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0));
-        glsafe(::glTexImage2D(GL_TEXTURE_2D, 1, GL_RGBA, half_w, half_h, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0));
-        glsafe(::glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, m_layers_texture.data.data()));
-        glsafe(::glTexSubImage2D(GL_TEXTURE_2D, 1, 0, 0, half_w, half_h, GL_RGBA, GL_UNSIGNED_BYTE, m_layers_texture.data.data() + m_layers_texture.width * m_layers_texture.height * 4));
         for (const GLVolume* glvolume : volumes.volumes) {
             // Render the object using the layer editing shader and texture.
             if (! glvolume->is_active || glvolume->composite_id.object_id != this->last_object_id || glvolume->is_modifier)
@@ -544,7 +549,8 @@ void GLCanvas3D::LayersEditing::reset_layer_height_profile(GLCanvas3D& canvas)
 void GLCanvas3D::LayersEditing::adaptive_layer_height_profile(GLCanvas3D& canvas, float quality_factor)
 {
     this->update_slicing_parameters();
-    m_layer_height_profile = layer_height_profile_adaptive(*m_slicing_parameters, *m_model_object, quality_factor);
+    this->update_slicing_adaptive();
+    m_layer_height_profile = layer_height_profile_adaptive(*m_slicing_parameters, *m_slicing_adaptive, quality_factor);
     const_cast<ModelObject*>(m_model_object)->layer_height_profile = m_layer_height_profile;
     m_layers_texture.valid = false;
     canvas.post_event(SimpleEvent(EVT_GLCANVAS_SCHEDULE_BACKGROUND_PROCESS));
@@ -587,6 +593,46 @@ void GLCanvas3D::LayersEditing::generate_layer_height_texture()
         Slic3r::generate_object_layers(*m_slicing_parameters, m_layer_height_profile), 
 		m_layers_texture.data.data(), m_layers_texture.height, m_layers_texture.width, level_of_detail_2nd_level);
 	m_layers_texture.valid = true;
+    this->upload_layer_height_texture();
+}
+
+// Upload the rows of both levels of detail of the layer height texture changed since the last upload.
+// A stroke of the layer height editing tool or an update of the profile changes just a part of the texture.
+void GLCanvas3D::LayersEditing::upload_layer_height_texture()
+{
+    GLsizei w = (GLsizei)m_layers_texture.width;
+    GLsizei h = (GLsizei)m_layers_texture.height;
+    GLsizei half_w = w / 2;
+    GLsizei half_h = h / 2;
+    glsafe(::glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+    glsafe(::glBindTexture(GL_TEXTURE_2D, m_z_texture_id));
+    if (! m_layers_texture.allocated || m_layers_texture.data_uploaded.size() != m_layers_texture.data.size()) {
+        glsafe(::glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0));
+        glsafe(::glTexImage2D(GL_TEXTURE_2D, 1, GL_RGBA, half_w, half_h, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0));
+        glsafe(::glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, m_layers_texture.data.data()));
+        glsafe(::glTexSubImage2D(GL_TEXTURE_2D, 1, 0, 0, half_w, half_h, GL_RGBA, GL_UNSIGNED_BYTE, m_layers_texture.data.data() + w * h * 4));
+        m_layers_texture.data_uploaded = m_layers_texture.data;
+        m_layers_texture.allocated = true;
+    } else {
+        auto upload_changed_rows = [this](GLint level, size_t offset, GLsizei width, GLsizei height) {
+            const char *data     = m_layers_texture.data.data() + offset;
+            char       *uploaded = m_layers_texture.data_uploaded.data() + offset;
+            size_t      row_size = size_t(width) * 4;
+            GLsizei     first    = 0;
+            GLsizei     last     = height;
+            while (first < last && ::memcmp(data + first * row_size, uploaded + first * row_size, row_size) == 0)
+                ++ first;
+            while (last > first && ::memcmp(data + (last - 1) * row_size, uploaded + (last - 1) * row_size, row_size) == 0)
+                -- last;
+            if (first < last) {
+                glsafe(::glTexSubImage2D(GL_TEXTURE_2D, level, 0, first, width, last - first, GL_RGBA, GL_UNSIGNED_BYTE, data + first * row_size));
+                ::memcpy(uploaded + first * row_size, data + first * row_size, (last - first) * row_size);
+            }
+        };
+        upload_changed_rows(0, 0, w, h);
+        upload_changed_rows(1, size_t(w) * h * 4, half_w, half_h);
+    }
+    glsafe(::glBindTexture(GL_TEXTURE_2D, 0));
 }
 
 void GLCanvas3D::LayersEditing::accept_changes(GLCanvas3D& canvas)
@@ -609,6 +655,23 @@ void GLCanvas3D::LayersEditing::update_slicing_parameters()
     }
 }
 
+void GLCanvas3D::LayersEditing::update_slicing_adaptive()
+{
+    // The facets are collected from the meshes transformed by the first instance, prepare them again if any of the meshes changed.
+    std::vector<std::pair<const TriangleMesh*, Matrix4d>> meshes;
+    const Transform3d instance_matrix = m_model_object->instances.front()->get_matrix();
+    m_model_object->visit_raw_meshes([&meshes, &instance_matrix](const TriangleMesh &mesh, const Transform3d &volume_matrix) {
+        meshes.emplace_back(&mesh, (instance_matrix * volume_matrix).matrix());
+    });
+    if (m_slicing_adaptive == nullptr || meshes != m_slicing_adaptive_meshes) {
+        if (m_slicing_adaptive == nullptr)
+            m_slicing_adaptive = new SlicingAdaptive();
+        m_slicing_adaptive->set_slicing_parameters(*m_slicing_parameters);
+        m_slicing_adaptive->prepare(*m_model_object);
+        m_slicing_adaptive_meshes = std::move(meshes);
+    }
+}
+
 float GLCanvas3D::LayersEditing::thickness_bar_width(const GLCanvas3D &canvas)
 {
     return
@@ -1312,6 +1375,9 @@ GLCanvas3D::GLCanvas3D(wxGLCanvas* canvas, Bed3D& bed, Camera& camera, GLToolbar
 GLCanvas3D::~GLCanvas3D()
 {
     reset_volumes();
+    if (m_initialized && _set_current())
+        for (SlaCap &cap : m_sla_caps)
+            cap.release_geometry();
 }
 
 void GLCanvas3D::post_event(wxEvent &&event)
@@ -1424,6 +1490,7 @@ void GLCanvas3D::reset_volumes()
         m_volumes.clear();
         m_dirty = true;
     }
+    m_gcode_preview_volume_index.reset();
 
     _set_warning_texture(WarningTexture::ObjectOutside, false);
 }
@@ -1830,6 +1897,29 @@ void GLCanvas3D::render_thumbnail(ThumbnailData& thumbnail_data, unsigned int w,
     default: { _render_thumbnail_legacy(thumbnail_data, w, h, printable_only, parts_only, show_bed, transparent_background); break; }
     }
 }
+
+void GLCanvas3D::render_thumbnails(ThumbnailsList& thumbnails, const Vec2ds& sizes, bool printable_only, bool parts_only, bool show_bed, bool transparent_background) const
+{
+    thumbnails.clear();
+    for (const Vec2d& size : sizes)
+    {
+        Point isize(size); // round to ints
+        thumbnails.push_back(ThumbnailData());
+        thumbnails.back().set((unsigned int)std::max<coord_t>(isize.x(), 0), (unsigned int)std::max<coord_t>(isize.y(), 0));
+        if (!thumbnails.back().is_valid())
+            thumbnails.pop_back();
+    }
+
+    if (GLCanvas3DManager::get_framebuffers_type() == GLCanvas3DManager::FB_Arb)
+        _render_thumbnails_framebuffer(thumbnails, printable_only, parts_only, show_bed, transparent_background);
+    else
+    {
+        for (ThumbnailData& thumbnail_data : thumbnails)
+        {
+            render_thumbnail(thumbnail_data, thumbnail_data.width, thumbnail_data.height, printable_only, parts_only, show_bed, transparent_background);
+        }
+    }
+}
 #endif // ENABLE_THUMBNAIL_GENERATOR
 
 void GLCanvas3D::select_all()
@@ -1979,6 +2069,9 @@ void GLCanvas3D::reload_scene(bool refresh_immediately, bool force_full_scene_re
     std::vector<size_t> instance_ids_selected;
     std::vector<size_t> map_glvolume_old_to_new(m_volumes.volumes.size(), size_t(-1));
     std::vector<GLVolumeState> deleted_volumes;
+    // Released GLVolumes, the VBOs of which may be taken over by the new GLVolumes loaded from the same mesh,
+    // for example if the ObjectID of a ModelVolume or of a ModelInstance changed, while the mesh did not.
+    std::vector<GLVolume*> recycled_volumes;
     std::vector<GLVolume*> glvolumes_new;
     glvolumes_new.reserve(m_volumes.volumes.size());
     auto model_volume_state_lower = [](const ModelVolumeState& m1, const ModelVolumeState& m2) { return m1.geometry_id < m2.geometry_id; };
@@ -2061,7 +2154,10 @@ void GLCanvas3D::reload_scene(bool refresh_immediately, bool force_full_scene_re
             if (!m_reload_delayed)
             {
                 deleted_volumes.emplace_back(volume, volume_id);
-                delete volume;
+                if (! force_full_scene_refresh && ! volume->is_wipe_tower && volume->volume_idx() >= 0 && volume->indexed_vertex_array.has_VBOs())
+                    recycled_volumes.emplace_back(volume);
+                else
+                    delete volume;
             }
         }
         else {
@@ -2111,7 +2207,11 @@ void GLCanvas3D::reload_scene(bool refresh_immediately, bool force_full_scene_re
                     if (it_old_volume != deleted_volumes.end() && it_old_volume->composite_id == it->composite_id)
                         // If a volume changed its ObjectID, but it reuses a GLVolume's CompositeID, maintain its selection.
                         map_glvolume_old_to_new[it_old_volume->volume_idx] = m_volumes.volumes.size();
-                    m_volumes.load_object_volume(&model_object, obj_idx, volume_idx, instance_idx, m_color_by, m_initialized);
+                    std::shared_ptr<const TriangleMesh> mesh_ptr = model_volume.get_mesh_shared_ptr();
+                    auto it_recycled = std::find_if(recycled_volumes.begin(), recycled_volumes.end(),
+                        [&mesh_ptr](const GLVolume *volume) { return volume->is_loaded_from(mesh_ptr); });
+                    m_volumes.load_object_volume(&model_object, obj_idx, volume_idx, instance_idx, m_color_by, m_initialized,
+                        (it_recycled == recycled_volumes.end()) ? nullptr : *it_recycled);
                     m_volumes.volumes.back()->geometry_id = key.geometry_id;
                     update_object_list = true;
                 } else {
@@ -2127,6 +2227,9 @@ void GLCanvas3D::reload_scene(bool refresh_immediately, bool force_full_scene_re
             }
         }
     }
+    // The VBOs taken over by the new GLVolumes are released with their last user.
+    for (GLVolume *volume : recycled_volumes)
+        delete volume;
     if (printer_technology == ptSLA) {
         size_t idx = 0;
         const SLAPrint *sla_print = this->sla_print();
@@ -2339,11 +2442,14 @@ void GLCanvas3D::load_gcode_preview(const GCodePreviewData& preview_data, const
         if (m_volumes.empty())
         {
             m_gcode_preview_volume_index.reset();
+            m_gcode_preview_volume_index.view_type = int(preview_data.extrusion.view_type);
             
             _load_gcode_extrusion_paths(preview_data, tool_colors);
             _load_gcode_travel_paths(preview_data, tool_colors);
 			load_gcode_retractions(preview_data.retraction,   GCodePreviewVolumeIndex::Retraction,   m_volumes, m_gcode_preview_volume_index, m_initialized);
 			load_gcode_retractions(preview_data.unretraction, GCodePreviewVolumeIndex::Unretraction, m_volumes, m_gcode_preview_volume_index, m_initialized);
+			// Retractions are not recolored, keep the volume values aligned with the volumes.
+			m_gcode_preview_volume_index.volume_values.resize(m_volumes.volumes.size(), 0.f);
             
             if (!m_volumes.empty())
             {
@@ -2373,18 +2479,25 @@ void GLCanvas3D::load_gcode_preview(const GCodePreviewData& preview_data, const
 	                			// Empty sequence of volumes for the current index item.
 	                			continue;
 	                	}
-	                	if (! m_volumes.volumes[idx_volume_src]->print_zs.empty())
+	                	if (! m_volumes.volumes[idx_volume_src]->print_zs.empty()) {
+	                		m_gcode_preview_volume_index.volume_values[idx_volume_dst] = m_gcode_preview_volume_index.volume_values[idx_volume_src];
                 			m_volumes.volumes[idx_volume_dst ++] = m_volumes.volumes[idx_volume_src];
+                		}
 	                	++ idx_volume_src;
 	                }
 	                m_volumes.volumes.erase(m_volumes.volumes.begin() + idx_volume_dst, m_volumes.volumes.end());
+	                m_gcode_preview_volume_index.volume_values.erase(m_gcode_preview_volume_index.volume_values.begin() + idx_volume_dst, m_gcode_preview_volume_index.volume_values.end());
 	                m_gcode_preview_volume_index.first_volumes.erase(m_gcode_preview_volume_index.first_volumes.begin() + idx_volume_index_dst, m_gcode_preview_volume_index.first_volumes.end());
 	            }
 
                 _load_fff_shells();
+                m_gcode_preview_volume_index.volume_values.resize(m_volumes.volumes.size(), 0.f);
             }
             _update_toolpath_volumes_outside_state();
         }
+        else
+            // The geometry is kept, only the colors may have changed (for example the feedrate range after travel moves were hidden).
+            _update_gcode_volumes_colors(preview_data, tool_colors);
         
         _update_gcode_volumes_visibility(preview_data);
         _show_warning_texture_if_needed(WarningTexture::ToolpathOutside);
@@ -2507,6 +2620,10 @@ void GLCanvas3D::on_idle(wxIdleEvent& evt)
     m_dirty |= m_view_toolbar.update_items_state();
     bool mouse3d_controller_applied = wxGetApp().plater()->get_mouse3d_controller().apply(m_camera);
     m_dirty |= mouse3d_controller_applied;
+    // The texture compressor wakes up the idle handler whenever a level is ready.
+    m_dirty |= m_bed.texture_update_pending();
+    // The flatten gizmo wakes up the idle handler when its planes have been calculated in the background.
+    m_dirty |= m_gizmos.flattening_planes_ready();
 
     if (!m_dirty)
         return;
@@ -3247,6 +3364,8 @@ void GLCanvas3D::on_mouse(wxMouseEvent& evt)
     }
     else if (evt.Moving())
     {
+        // Some platforms send motion events without the cursor moving, these do not change the hover state.
+        bool moved = m_mouse.position != pos.cast<double>();
         m_mouse.position = pos.cast<double>();
         std::string tooltip = "";
 
@@ -3272,7 +3391,7 @@ void GLCanvas3D::on_mouse(wxMouseEvent& evt)
             m_gizmos.reset_all_states();
 
         // Only refresh if picking is enabled, in that case the objects may get highlighted if the mouse cursor hovers over.
-        if (m_picking_enabled)
+        if (m_picking_enabled && moved)
             m_dirty = true;
     }
     else
@@ -3840,9 +3959,8 @@ void GLCanvas3D::_render_thumbnail_internal(ThumbnailData& thumbnail_data, bool
 
     m_shader.start_using();
 
-    GLint shader_id = m_shader.get_shader_program_id();
-    GLint color_id = ::glGetUniformLocation(shader_id, "uniform_color");
-    GLint print_box_detection_id = ::glGetUniformLocation(shader_id, "print_box.volume_detection");
+    GLint color_id = m_shader.get_uniform_location("uniform_color");
+    GLint print_box_detection_id = m_shader.get_uniform_location("print_box.volume_detection");
     glcheck();
 
     if (print_box_detection_id != -1)
@@ -3977,6 +4095,166 @@ void GLCanvas3D::_render_thumbnail_framebuffer(ThumbnailData& thumbnail_data, un
         glsafe(::glDisable(GL_MULTISAMPLE));
 }
 
+void GLCanvas3D::_render_thumbnails_framebuffer(ThumbnailsList& thumbnails, bool printable_only, bool parts_only, bool show_bed, bool transparent_background) const
+{
+    if (thumbnails.empty())
+        return;
+
+    // The framebuffer is allocated once for the largest thumbnail, each thumbnail is rendered into its lower left corner.
+    unsigned int w = 0;
+    unsigned int h = 0;
+    for (const ThumbnailData& thumbnail_data : thumbnails)
+    {
+        w = std::max(w, thumbnail_data.width);
+        h = std::max(h, thumbnail_data.height);
+    }
+
+    bool multisample = m_multisample_allowed;
+    if (multisample)
+        glsafe(::glEnable(GL_MULTISAMPLE));
+
+    GLint max_samples;
+    glsafe(::glGetIntegerv(GL_MAX_SAMPLES, &max_samples));
+    GLsizei num_samples = max_samples / 2;
+
+    GLuint render_fbo;
+    glsafe(::glGenFramebuffers(1, &render_fbo));
+    glsafe(::glBindFramebuffer(GL_FRAMEBUFFER, render_fbo));
+
+    GLuint render_tex = 0;
+    GLuint render_tex_buffer = 0;
+    if (multisample)
+    {
+        // use renderbuffer instead of texture to avoid the need to use glTexImage2DMultisample which is available only since OpenGL 3.2
+        glsafe(::glGenRenderbuffers(1, &render_tex_buffer));
+        glsafe(::glBindRenderbuffer(GL_RENDERBUFFER, render_tex_buffer));
+        glsafe(::glRenderbufferStorageMultisample(GL_RENDERBUFFER, num_samples, GL_RGBA8, w, h));
+        glsafe(::glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, render_tex_buffer));
+    }
+    else
+    {
+        glsafe(::glGenTextures(1, &render_tex));
+        glsafe(::glBindTexture(GL_TEXTURE_2D, render_tex));
+        glsafe(::glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+        glsafe(::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+        glsafe(::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+        glsafe(::glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, render_tex, 0));
+    }
+
+    GLuint render_depth;
+    glsafe(::glGenRenderbuffers(1, &render_depth));
+    glsafe(::glBindRenderbuffer(GL_RENDERBUFFER, render_depth));
+    if (multisample)
+        glsafe(::glRenderbufferStorageMultisample(GL_RENDERBUFFER, num_samples, GL_DEPTH_COMPONENT24, w, h));
+    else
+        glsafe(::glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, w, h));
+
+    glsafe(::glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, render_depth));
+
+    GLenum drawBufs[] = { GL_COLOR_ATTACHMENT0 };
+    glsafe(::glDrawBuffers(1, drawBufs));
+
+    if (::glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE)
+    {
+        GLuint resolve_fbo = 0;
+        GLuint resolve_tex = 0;
+        bool   resolve_complete = true;
+        if (multisample)
+        {
+            glsafe(::glGenFramebuffers(1, &resolve_fbo));
+            glsafe(::glBindFramebuffer(GL_FRAMEBUFFER, resolve_fbo));
+
+            glsafe(::glGenTextures(1, &resolve_tex));
+            glsafe(::glBindTexture(GL_TEXTURE_2D, resolve_tex));
+            glsafe(::glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+            glsafe(::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+            glsafe(::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+            glsafe(::glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, resolve_tex, 0));
+
+            glsafe(::glDrawBuffers(1, drawBufs));
+
+            resolve_complete = ::glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        }
+
+        // With pixel buffer objects, glReadPixels() returns without waiting for the GPU, which keeps rendering the next thumbnails.
+        bool use_pbos = GLEW_VERSION_2_1 || GLEW_ARB_pixel_buffer_object;
+        std::vector<GLuint> pbos(use_pbos ? thumbnails.size() : 0, 0);
+        if (use_pbos)
+            glsafe(::glGenBuffers((GLsizei)pbos.size(), pbos.data()));
+
+        for (size_t i = 0; i < thumbnails.size(); ++i)
+        {
+            ThumbnailData& thumbnail_data = thumbnails[i];
+            glsafe(::glBindFramebuffer(GL_FRAMEBUFFER, render_fbo));
+            _render_thumbnail_internal(thumbnail_data, printable_only, parts_only, show_bed, transparent_background);
+
+            if (multisample)
+            {
+                if (!resolve_complete)
+                    continue;
+                glsafe(::glBindFramebuffer(GL_READ_FRAMEBUFFER, render_fbo));
+                glsafe(::glBindFramebuffer(GL_DRAW_FRAMEBUFFER, resolve_fbo));
+                glsafe(::glBlitFramebuffer(0, 0, thumbnail_data.width, thumbnail_data.height, 0, 0, thumbnail_data.width, thumbnail_data.height, GL_COLOR_BUFFER_BIT, GL_LINEAR));
+                glsafe(::glBindFramebuffer(GL_READ_FRAMEBUFFER, resolve_fbo));
+            }
+
+            if (use_pbos)
+            {
+                glsafe(::glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[i]));
+                glsafe(::glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)thumbnail_data.pixels.size(), nullptr, GL_STREAM_READ));
+                glsafe(::glReadPixels(0, 0, thumbnail_data.width, thumbnail_data.height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+                glsafe(::glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+            }
+            else
+                glsafe(::glReadPixels(0, 0, thumbnail_data.width, thumbnail_data.height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)thumbnail_data.pixels.data()));
+        }
+
+        if (use_pbos)
+        {
+            // collect the pixels after all the thumbnails were rendered
+            for (size_t i = 0; i < thumbnails.size(); ++i)
+            {
+                if (multisample && !resolve_complete)
+                    break;
+                ThumbnailData& thumbnail_data = thumbnails[i];
+                glsafe(::glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[i]));
+                const void* mapped = ::glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+                glcheck();
+                if (mapped != nullptr)
+                {
+                    ::memcpy((void*)thumbnail_data.pixels.data(), mapped, thumbnail_data.pixels.size());
+                    glsafe(::glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+                }
+            }
+            glsafe(::glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+            glsafe(::glDeleteBuffers((GLsizei)pbos.size(), pbos.data()));
+        }
+
+#if ENABLE_THUMBNAIL_GENERATOR_DEBUG_OUTPUT
+        for (const ThumbnailData& thumbnail_data : thumbnails)
+        {
+            debug_output_thumbnail(thumbnail_data);
+        }
+#endif // ENABLE_THUMBNAIL_GENERATOR_DEBUG_OUTPUT
+
+        if (resolve_tex != 0)
+            glsafe(::glDeleteTextures(1, &resolve_tex));
+        if (resolve_fbo != 0)
+            glsafe(::glDeleteFramebuffers(1, &resolve_fbo));
+    }
+
+    glsafe(::glBindFramebuffer(GL_FRAMEBUFFER, 0));
+    glsafe(::glDeleteRenderbuffers(1, &render_depth));
+    if (render_tex_buffer != 0)
+        glsafe(::glDeleteRenderbuffers(1, &render_tex_buffer));
+    if (render_tex != 0)
+        glsafe(::glDeleteTextures(1, &render_tex));
+    glsafe(::glDeleteFramebuffers(1, &render_fbo));
+
+    if (multisample)
+        glsafe(::glDisable(GL_MULTISAMPLE));
+}
+
 void GLCanvas3D::_render_thumbnail_framebuffer_ext(ThumbnailData & thumbnail_data, unsigned int w, unsigned int h, bool printable_only, bool parts_only, bool show_bed, bool transparent_background) const
 {
     thumbnail_data.set(w, h);
@@ -4479,6 +4757,18 @@ void GLCanvas3D::_picking_pass() const
         glsafe(::glDisable(GL_BLEND));
         glsafe(::glEnable(GL_DEPTH_TEST));
 
+        const Size& cnv_size = get_canvas_size();
+        bool inside = (0 <= m_mouse.position(0)) && (m_mouse.position(0) < cnv_size.get_width()) && (0 <= m_mouse.position(1)) && (m_mouse.position(1) < cnv_size.get_height());
+        // Only the pixel below the mouse cursor is read back, restrict the clear and the rasterization to it.
+        bool scissor = inside;
+#if ENABLE_RENDER_PICKING_PASS
+        scissor &= ! m_show_picking_texture;
+#endif // ENABLE_RENDER_PICKING_PASS
+        if (scissor) {
+            glsafe(::glScissor(m_mouse.position(0), cnv_size.get_height() - m_mouse.position(1) - 1, 1, 1));
+            glsafe(::glEnable(GL_SCISSOR_TEST));
+        }
+
         glsafe(::glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
 
         m_camera_clipping_plane = m_gizmos.get_sla_clipping_plane();
@@ -4498,8 +4788,6 @@ void GLCanvas3D::_picking_pass() const
         int volume_id = -1;
 
         GLubyte color[4] = { 0, 0, 0, 0 };
-        const Size& cnv_size = get_canvas_size();
-        bool inside = (0 <= m_mouse.position(0)) && (m_mouse.position(0) < cnv_size.get_width()) && (0 <= m_mouse.position(1)) && (m_mouse.position(1) < cnv_size.get_height());
         if (inside)
         {
             glsafe(::glReadPixels(m_mouse.position(0), cnv_size.get_height() - m_mouse.position(1) - 1, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, (void*)color));
@@ -4507,6 +4795,8 @@ void GLCanvas3D::_picking_pass() const
             	// Only non-interpolated colors are valid, those have their lowest three bits zeroed.
             	volume_id = color[0] + (color[1] << 8) + (color[2] << 16);
         }
+        if (scissor)
+            glsafe(::glDisable(GL_SCISSOR_TEST));
         if ((0 <= volume_id) && (volume_id < (int)m_volumes.volumes.size()))
         {
             m_hover_volume_idxs.push_back(volume_id);
@@ -4534,6 +4824,23 @@ void GLCanvas3D::_rectangular_selection_picking_pass() const
         glsafe(::glDisable(GL_BLEND));
         glsafe(::glEnable(GL_DEPTH_TEST));
 
+        int width = std::max((int)m_rectangle_selection.get_width(), 1);
+        int height = std::max((int)m_rectangle_selection.get_height(), 1);
+        int px_count = width * height;
+
+        int left = (int)m_rectangle_selection.get_left();
+        int top = get_canvas_size().get_height() - (int)m_rectangle_selection.get_top();
+
+        // Only the selection rectangle is read back, restrict the clear and the rasterization to it.
+        bool scissor = (left >= 0) && (top >= 0);
+#if ENABLE_RENDER_PICKING_PASS
+        scissor &= ! m_show_picking_texture;
+#endif // ENABLE_RENDER_PICKING_PASS
+        if (scissor) {
+            glsafe(::glScissor(left, top, width, height));
+            glsafe(::glEnable(GL_SCISSOR_TEST));
+        }
+
         glsafe(::glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
 
         _render_volumes_for_picking();
@@ -4541,12 +4848,6 @@ void GLCanvas3D::_rectangular_selection_picking_pass() const
         if (m_multisample_allowed)
             glsafe(::glEnable(GL_MULTISAMPLE));
 
-        int width = std::max((int)m_rectangle_selection.get_width(), 1);
-        int height = std::max((int)m_rectangle_selection.get_height(), 1);
-        int px_count = width * height;
-
-        int left = (int)m_rectangle_selection.get_left();
-        int top = get_canvas_size().get_height() - (int)m_rectangle_selection.get_top();
         if ((left >= 0) && (top >= 0))
         {
 #define USE_PARALLEL 1
@@ -4565,15 +4866,22 @@ void GLCanvas3D::_rectangular_selection_picking_pass() const
             tbb::spin_mutex mutex;
             tbb::parallel_for(tbb::blocked_range<size_t>(0, frame.size(), (size_t)width),
                 [this, &frame, &idxs, &mutex](const tbb::blocked_range<size_t>& range) {
+                // Collect the ids of a range locally, the mutex is only taken once per range to merge them.
+                // Neighboring pixels mostly belong to the same volume, skip the repeated ids.
+                std::vector<int> range_idxs;
+                int last_id = -1;
                 for (size_t i = range.begin(); i < range.end(); ++i)
                 	if (frame[i].valid()) {
                     	int volume_id = frame[i].id();
-                    	if ((0 <= volume_id) && (volume_id < (int)m_volumes.volumes.size())) {
-                        	mutex.lock();
-                        	idxs.insert(volume_id);
-                        	mutex.unlock();
+                    	if (volume_id != last_id && (0 <= volume_id) && (volume_id < (int)m_volumes.volumes.size())) {
+                    		range_idxs.emplace_back(volume_id);
+                    		last_id = volume_id;
                     	}
                 	}
+                if (! range_idxs.empty()) {
+                	tbb::spin_mutex::scoped_lock lock(mutex);
+                	idxs.insert(range_idxs.begin(), range_idxs.end());
+                }
             });
 #else
             std::vector<GLubyte> frame(4 * px_count);
@@ -4588,6 +4896,8 @@ void GLCanvas3D::_rectangular_selection_picking_pass() const
             }
 #endif // USE_PARALLEL
         }
+        if (scissor)
+            glsafe(::glDisable(GL_SCISSOR_TEST));
     }
 
     m_hover_volume_idxs.assign(idxs.begin(), idxs.end());
@@ -4914,110 +5224,89 @@ void GLCanvas3D::_render_sla_slices() const
         // nothing to render, return
         return;
 
+    // Release the caps of the objects, which do not exist anymore.
+    for (SlaCap &cap : m_sla_caps)
+        cap.triangles.erase(cap.triangles.lower_bound((unsigned int)print_objects.size()), cap.triangles.end());
+
     double clip_min_z = -m_clipping_planes[0].get_data()[3];
     double clip_max_z = m_clipping_planes[1].get_data()[3];
+    // Offset to avoid OpenGL Z fighting between the object's horizontal surfaces and the triangluated surfaces of the cuts.
+    double plane_shift_z = 0.002;
     for (unsigned int i = 0; i < (unsigned int)print_objects.size(); ++i)
     {
         const SLAPrintObject* obj = print_objects[i];
 
-        if (!obj->is_step_done(slaposSliceSupports))
+        if (!obj->is_step_done(slaposSliceSupports) || obj->get_slice_index().empty())
             continue;
 
-        SlaCap::ObjectIdToTrianglesMap::iterator it_caps_bottom = m_sla_caps[0].triangles.find(i);
-        SlaCap::ObjectIdToTrianglesMap::iterator it_caps_top    = m_sla_caps[1].triangles.find(i);
-        {
-			if (it_caps_bottom == m_sla_caps[0].triangles.end())
-				it_caps_bottom = m_sla_caps[0].triangles.emplace(i, SlaCap::Triangles()).first;
-            if (! m_sla_caps[0].matches(clip_min_z)) {
-				m_sla_caps[0].z = clip_min_z;
-                it_caps_bottom->second.object.clear();
-                it_caps_bottom->second.supports.clear();
-            }
-            if (it_caps_top == m_sla_caps[1].triangles.end())
-				it_caps_top = m_sla_caps[1].triangles.emplace(i, SlaCap::Triangles()).first;
-            if (! m_sla_caps[1].matches(clip_max_z)) {
-				m_sla_caps[1].z = clip_max_z;
-                it_caps_top->second.object.clear();
-                it_caps_top->second.supports.clear();
-            }
-        }
-        Pointf3s &bottom_obj_triangles = it_caps_bottom->second.object;
-        Pointf3s &bottom_sup_triangles = it_caps_bottom->second.supports;
-        Pointf3s &top_obj_triangles    = it_caps_top->second.object;
-        Pointf3s &top_sup_triangles    = it_caps_top->second.supports;
+        double layer_height         = print->default_object_config().layer_height.value;
+        double initial_layer_height = print->material_config().initial_layer_height.value;
+        bool   left_handed          = obj->is_left_handed();
 
-        if ((bottom_obj_triangles.empty() || bottom_sup_triangles.empty() || top_obj_triangles.empty() || top_sup_triangles.empty()) &&
-            !obj->get_slice_index().empty())
-        {
-            double layer_height         = print->default_object_config().layer_height.value;
-            double initial_layer_height = print->material_config().initial_layer_height.value;
-            bool   left_handed          = obj->is_left_handed();
-
-            coord_t key_zero = obj->get_slice_index().front().print_level();
-            // Slice at the center of the slab starting at clip_min_z will be rendered for the lower plane.
-            coord_t key_low  = coord_t((clip_min_z - initial_layer_height + layer_height) / SCALING_FACTOR) + key_zero;
-            // Slice at the center of the slab ending at clip_max_z will be rendered for the upper plane.
-            coord_t key_high = coord_t((clip_max_z - initial_layer_height) / SCALING_FACTOR) + key_zero;
-
-            const SliceRecord& slice_low  = obj->closest_slice_to_print_level(key_low, coord_t(SCALED_EPSILON));
-            const SliceRecord& slice_high = obj->closest_slice_to_print_level(key_high, coord_t(SCALED_EPSILON));
-
-            // Offset to avoid OpenGL Z fighting between the object's horizontal surfaces and the triangluated surfaces of the cuts.
-            double plane_shift_z = 0.002;
-
-            if (slice_low.is_valid()) {
-                const ExPolygons& obj_bottom = slice_low.get_slice(soModel);
-                const ExPolygons& sup_bottom = slice_low.get_slice(soSupport);
-                // calculate model bottom cap
-                if (bottom_obj_triangles.empty() && !obj_bottom.empty())
-                    bottom_obj_triangles = triangulate_expolygons_3d(obj_bottom, clip_min_z - plane_shift_z, ! left_handed);
-                // calculate support bottom cap
-                if (bottom_sup_triangles.empty() && !sup_bottom.empty())
-                    bottom_sup_triangles = triangulate_expolygons_3d(sup_bottom, clip_min_z - plane_shift_z, ! left_handed);
-            }
+        coord_t key_zero = obj->get_slice_index().front().print_level();
+        // Slice at the center of the slab starting at clip_min_z will be rendered for the lower plane.
+        coord_t key_low  = coord_t((clip_min_z - initial_layer_height + layer_height) / SCALING_FACTOR) + key_zero;
+        // Slice at the center of the slab ending at clip_max_z will be rendered for the upper plane.
+        coord_t key_high = coord_t((clip_max_z - initial_layer_height) / SCALING_FACTOR) + key_zero;
 
-            if (slice_high.is_valid()) {
-                const ExPolygons& obj_top = slice_high.get_slice(soModel);
-                const ExPolygons& sup_top = slice_high.get_slice(soSupport);
-                // calculate model top cap
-                if (top_obj_triangles.empty() && !obj_top.empty())
-                    top_obj_triangles = triangulate_expolygons_3d(obj_top, clip_max_z + plane_shift_z, left_handed);
-                // calculate support top cap
-                if (top_sup_triangles.empty() && !sup_top.empty())
-                    top_sup_triangles = triangulate_expolygons_3d(sup_top, clip_max_z + plane_shift_z, left_handed);
+        const SliceRecord& slice_low  = obj->closest_slice_to_print_level(key_low, coord_t(SCALED_EPSILON));
+        const SliceRecord& slice_high = obj->closest_slice_to_print_level(key_high, coord_t(SCALED_EPSILON));
+
+        // Triangulate the caps only if the clipping plane moved to another slice, the cached caps are just shifted in Z otherwise.
+        auto update_caps = [](SlaCap::Triangles &caps, const SliceRecord &slice, bool flip) {
+            coord_t print_level = slice.is_valid() ? slice.print_level() : std::numeric_limits<coord_t>::min();
+            if (caps.matches(print_level))
+                return;
+            caps.print_level = print_level;
+            for (SliceOrigin origin : { soModel, soSupport }) {
+                GLIndexedVertexArray &array = (origin == soModel) ? caps.object : caps.supports;
+                array.release_geometry();
+                if (! slice.is_valid())
+                    continue;
+                ExPolygons expolys = slice.get_slice(origin);
+                if (expolys.empty())
+                    continue;
+                Pointf3s triangles = triangulate_expolygons_3d(expolys, 0., flip);
+                Vec3d    normal(0., 0., flip ? -1. : 1.);
+                array.reserve(triangles.size());
+                for (size_t j = 0; j < triangles.size(); j += 3) {
+                    array.push_geometry(triangles[j],     normal);
+                    array.push_geometry(triangles[j + 1], normal);
+                    array.push_geometry(triangles[j + 2], normal);
+                    array.push_triangle(int(j), int(j + 1), int(j + 2));
+                }
+                array.finalize_geometry(true);
             }
-        }
+        };
+        SlaCap::Triangles &caps_bottom = m_sla_caps[0].triangles[i];
+        SlaCap::Triangles &caps_top    = m_sla_caps[1].triangles[i];
+        update_caps(caps_bottom, slice_low,  ! left_handed);
+        update_caps(caps_top,    slice_high, left_handed);
 
-        if (!bottom_obj_triangles.empty() || !top_obj_triangles.empty() || !bottom_sup_triangles.empty() || !top_sup_triangles.empty())
+        auto render_cap = [](const GLIndexedVertexArray &array, double z) {
+            if (array.empty())
+                return;
+            glsafe(::glPushMatrix());
+            glsafe(::glTranslated(0., 0., z));
+            array.render();
+            glsafe(::glPopMatrix());
+        };
+        if (! caps_bottom.object.empty() || ! caps_top.object.empty() || ! caps_bottom.supports.empty() || ! caps_top.supports.empty())
         {
 			for (const SLAPrintObject::Instance& inst : obj->instances())
             {
                 glsafe(::glPushMatrix());
                 glsafe(::glTranslated(unscale<double>(inst.shift.x()), unscale<double>(inst.shift.y()), 0));
                 glsafe(::glRotatef(Geometry::rad2deg(inst.rotation), 0.0, 0.0, 1.0));
-				if (obj->is_left_handed())
+				if (left_handed)
                     // The polygons are mirrored by X.
                     glsafe(::glScalef(-1.0, 1.0, 1.0));
-                glsafe(::glEnableClientState(GL_VERTEX_ARRAY));
                 glsafe(::glColor3f(1.0f, 0.37f, 0.0f));
-				if (!bottom_obj_triangles.empty()) {
-                    glsafe(::glVertexPointer(3, GL_DOUBLE, 0, (GLdouble*)bottom_obj_triangles.front().data()));
-                    glsafe(::glDrawArrays(GL_TRIANGLES, 0, bottom_obj_triangles.size()));
-				}
-				if (! top_obj_triangles.empty()) {
-                    glsafe(::glVertexPointer(3, GL_DOUBLE, 0, (GLdouble*)top_obj_triangles.front().data()));
-                    glsafe(::glDrawArrays(GL_TRIANGLES, 0, top_obj_triangles.size()));
-				}
+                render_cap(caps_bottom.object, clip_min_z - plane_shift_z);
+                render_cap(caps_top.object,    clip_max_z + plane_shift_z);
                 glsafe(::glColor3f(1.0f, 0.0f, 0.37f));
-				if (! bottom_sup_triangles.empty()) {
-                    glsafe(::glVertexPointer(3, GL_DOUBLE, 0, (GLdouble*)bottom_sup_triangles.front().data()));
-                    glsafe(::glDrawArrays(GL_TRIANGLES, 0, bottom_sup_triangles.size()));
-				}
-				if (! top_sup_triangles.empty()) {
-                    glsafe(::glVertexPointer(3, GL_DOUBLE, 0, (GLdouble*)top_sup_triangles.front().data()));
-                    glsafe(::glDrawArrays(GL_TRIANGLES, 0, top_sup_triangles.size()));
-				}
-                glsafe(::glDisableClientState(GL_VERTEX_ARRAY));
+                render_cap(caps_bottom.supports, clip_min_z - plane_shift_z);
+                render_cap(caps_top.supports,    clip_max_z + plane_shift_z);
                 glsafe(::glPopMatrix());
             }
         }
@@ -5423,9 +5712,11 @@ void GLCanvas3D::_load_print_object_toolpaths(const PrintObject& print_object, c
         return volume;
     };
     const size_t    volumes_cnt_initial = m_volumes.volumes.size();
+    // The conversion to the VBO layout is done by the workers, only the upload is left to the UI thread.
+    const bool prepare_geometry = m_initialized;
     tbb::parallel_for(
         tbb::blocked_range<size_t>(0, ctxt.layers.size(), grain_size),
-        [&ctxt, &new_volume, is_selected_separate_extruder, this](const tbb::blocked_range<size_t>& range) {
+        [&ctxt, &new_volume, is_selected_separate_extruder, prepare_geometry, this](const tbb::blocked_range<size_t>& range) {
         GLVolumePtrs 		vols;
         std::vector<size_t>	color_print_layer_to_glvolume;
         auto                volume = [&ctxt, &vols, &color_print_layer_to_glvolume, &range](size_t layer_idx, int extruder, int feature) -> GLVolume& {            
@@ -5519,13 +5810,18 @@ void GLCanvas3D::_load_print_object_toolpaths(const PrintObject& print_object, c
 	            if (vol.indexed_vertex_array.vertices_and_normals_interleaved.size() > MAX_VERTEX_BUFFER_SIZE) {
 	                vols[i] = new_volume(vol.color);
 	                reserve_new_volume_finalize_old_volume(*vols[i], vol, false);
+	                if (prepare_geometry)
+	                    vol.indexed_vertex_array.prepare_geometry();
 	            }
 	        }
         }
         for (GLVolume *vol : vols)
         	// Ideally one would call vol->indexed_vertex_array.finalize() here to move the buffers to the OpenGL driver,
-        	// but this code runs in parallel and the OpenGL driver is not thread safe.
-            vol->indexed_vertex_array.shrink_to_fit();
+        	// but this code runs in parallel and the OpenGL driver is not thread safe. Convert the data at least.
+            if (prepare_geometry)
+                vol->indexed_vertex_array.prepare_geometry();
+            else
+                vol->indexed_vertex_array.shrink_to_fit();
     });
 
     BOOST_LOG_TRIVIAL(debug) << "Loading print object toolpaths in parallel - finalizing results" << m_volumes.log_memory_info() << log_memory_info();
@@ -5607,9 +5903,10 @@ void GLCanvas3D::_load_wipe_tower_toolpaths(const std::vector<std::string>& str_
     };
     const size_t   volumes_cnt_initial = m_volumes.volumes.size();
     std::vector<GLVolumeCollection> volumes_per_thread(n_items);
+    const bool prepare_geometry = m_initialized;
     tbb::parallel_for(
         tbb::blocked_range<size_t>(0, n_items, grain_size),
-        [&ctxt, &new_volume](const tbb::blocked_range<size_t>& range) {
+        [&ctxt, &new_volume, prepare_geometry](const tbb::blocked_range<size_t>& range) {
         // Bounding box of this slab of a wipe tower.
         GLVolumePtrs vols;
         if (ctxt.color_by_tool()) {
@@ -5680,10 +5977,15 @@ void GLCanvas3D::_load_wipe_tower_toolpaths(const std::vector<std::string>& str_
             if (vol.indexed_vertex_array.vertices_and_normals_interleaved.size() > MAX_VERTEX_BUFFER_SIZE) {
                 vols[i] = new_volume(vol.color);
                 reserve_new_volume_finalize_old_volume(*vols[i], vol, false);
+                if (prepare_geometry)
+                    vol.indexed_vertex_array.prepare_geometry();
             }
         }
         for (GLVolume *vol : vols)
-            vol->indexed_vertex_array.shrink_to_fit();
+            if (prepare_geometry)
+                vol->indexed_vertex_array.prepare_geometry();
+            else
+                vol->indexed_vertex_array.shrink_to_fit();
     });
 
     BOOST_LOG_TRIVIAL(debug) << "Loading wipe tower toolpaths in parallel - finalizing results" << m_volumes.log_memory_info() << log_memory_info();
@@ -5706,6 +6008,61 @@ static inline int hex_digit_to_int(const char c)
         (c >= 'a' && c <= 'f') ? int(c - 'a') + 10 : -1;
 }
 
+// Color of a G-code extrusion path, which was grouped by the view type specific value.
+static Color gcode_extrusion_path_color(const GCodePreviewData& data, const std::vector<float>& tool_colors, float value)
+{
+    switch (data.extrusion.view_type)
+    {
+    case GCodePreviewData::Extrusion::FeatureType:
+        return data.get_extrusion_role_color((ExtrusionRole)(int)value);
+    case GCodePreviewData::Extrusion::Height:
+        return data.get_height_color(value);
+    case GCodePreviewData::Extrusion::Width:
+        return data.get_width_color(value);
+    case GCodePreviewData::Extrusion::Feedrate:
+        return data.get_feedrate_color(value);
+    case GCodePreviewData::Extrusion::FanSpeed:
+        return data.get_fan_speed_color(value);
+    case GCodePreviewData::Extrusion::VolumetricRate:
+        return data.get_volumetric_rate_color(value);
+    case GCodePreviewData::Extrusion::Tool:
+    {
+        Color color;
+        ::memcpy((void*)color.rgba.data(), (const void*)(tool_colors.data() + (unsigned int)value * 4), 4 * sizeof(float));
+        return color;
+    }
+    case GCodePreviewData::Extrusion::ColorPrint:
+    {
+        int color_cnt = (int)tool_colors.size() / 4;
+        int val = value > color_cnt ? color_cnt - 1 : value;
+
+        Color color;
+        ::memcpy((void*)color.rgba.data(), (const void*)(tool_colors.data() + val * 4), 4 * sizeof(float));
+
+        return color;
+    }
+    default:
+        return Color{};
+    }
+
+    return Color{};
+}
+
+// Color of a G-code travel path, which was grouped by the view type specific value.
+static Color gcode_travel_path_color(const GCodePreviewData& data, const std::vector<float>& tool_colors, float value)
+{
+    switch (data.extrusion.view_type)
+    {
+    case GCodePreviewData::Extrusion::Feedrate:
+        return data.get_feedrate_color(value);
+    case GCodePreviewData::Extrusion::Tool:
+        assert(((unsigned int)value + 1) * 4 <= tool_colors.size());
+        return Color(tool_colors.data() + (unsigned int)value * 4);
+    default:
+        return data.travel.type_colors[(unsigned int)value];
+    }
+}
+
 void GLCanvas3D::_load_gcode_extrusion_paths(const GCodePreviewData& preview_data, const std::vector<float>& tool_colors)
 {
     BOOST_LOG_TRIVIAL(debug) << "Loading G-code extrusion paths - start" << m_volumes.log_memory_info() << log_memory_info();
@@ -5740,45 +6097,6 @@ void GLCanvas3D::_load_gcode_extrusion_paths(const GCodePreviewData& preview_dat
 
             return 0.0f;
         }
-
-        static Color path_color(const GCodePreviewData& data, const std::vector<float>& tool_colors, float value)
-        {
-            switch (data.extrusion.view_type)
-            {
-            case GCodePreviewData::Extrusion::FeatureType:
-                return data.get_extrusion_role_color((ExtrusionRole)(int)value);
-            case GCodePreviewData::Extrusion::Height:
-                return data.get_height_color(value);
-            case GCodePreviewData::Extrusion::Width:
-                return data.get_width_color(value);
-            case GCodePreviewData::Extrusion::Feedrate:
-                return data.get_feedrate_color(value);
-            case GCodePreviewData::Extrusion::FanSpeed:
-                return data.get_fan_speed_color(value);
-            case GCodePreviewData::Extrusion::VolumetricRate:
-                return data.get_volumetric_rate_color(value);
-            case GCodePreviewData::Extrusion::Tool:
-            {
-                Color color;
-                ::memcpy((void*)color.rgba.data(), (const void*)(tool_colors.data() + (unsigned int)value * 4), 4 * sizeof(float));
-                return color;
-            }
-            case GCodePreviewData::Extrusion::ColorPrint:
-            {
-                int color_cnt = (int)tool_colors.size() / 4;
-                int val = value > color_cnt ? color_cnt - 1 : value;
-
-                Color color;
-                ::memcpy((void*)color.rgba.data(), (const void*)(tool_colors.data() + val * 4), 4 * sizeof(float));
-
-                return color;
-            }
-            default:
-                return Color{};
-            }
-
-            return Color{};
-        }
     };
 
     size_t initial_volumes_count = m_volumes.volumes.size();
@@ -5819,8 +6137,10 @@ void GLCanvas3D::_load_gcode_extrusion_paths(const GCodePreviewData& preview_dat
 				roles_filters.emplace_back();
 		    	if (! values.empty()) {
 		        	m_gcode_preview_volume_index.first_volumes.emplace_back(GCodePreviewVolumeIndex::Extrusion, role, (unsigned int)m_volumes.volumes.size());
-					for (const float value : values)
-						roles_filters.back().emplace_back(value, m_volumes.new_toolpath_volume(Helper::path_color(preview_data, tool_colors, value).rgba.data(), vertex_buffer_prealloc_size));
+					for (const float value : values) {
+						roles_filters.back().emplace_back(value, m_volumes.new_toolpath_volume(gcode_extrusion_path_color(preview_data, tool_colors, value).rgba.data(), vertex_buffer_prealloc_size));
+						m_gcode_preview_volume_index.volume_values.emplace_back(value);
+					}
 				}
 			}
 		}
@@ -5856,6 +6176,7 @@ void GLCanvas3D::_load_gcode_extrusion_paths(const GCodePreviewData& preview_dat
 			        		m_gcode_preview_volume_index.first_volumes.emplace_back(GCodePreviewVolumeIndex::Extrusion, role, (unsigned int)m_volumes.volumes.size());
 						GLVolume& vol = *filter.second;
 						filter.second = m_volumes.new_toolpath_volume(vol.color);
+						m_gcode_preview_volume_index.volume_values.emplace_back(filter.first);
 						reserve_new_volume_finalize_old_volume(*filter.second, vol, m_initialized, vertex_buffer_prealloc_size);
 					}
 		    }
@@ -5877,6 +6198,7 @@ void GLCanvas3D::_load_gcode_extrusion_paths(const GCodePreviewData& preview_dat
             delete *it;
         m_volumes.volumes.erase(begin, end);
         m_gcode_preview_volume_index.first_volumes.erase(m_gcode_preview_volume_index.first_volumes.begin() + initial_volume_index_count, m_gcode_preview_volume_index.first_volumes.end());
+        m_gcode_preview_volume_index.volume_values.resize(initial_volumes_count);
 	    BOOST_LOG_TRIVIAL(debug) << "Loading G-code extrusion paths - failed on low memory" << m_volumes.log_memory_info() << log_memory_info();
         //FIXME rethrow bad_alloc?
 	}
@@ -5889,7 +6211,7 @@ inline void travel_paths_internal(
 	// accessors
 	FUNC_VALUE func_value, FUNC_COLOR func_color,
 	// output
-	GLVolumeCollection &volumes, bool gl_initialized)
+	GLVolumeCollection &volumes, std::vector<float> &volume_values, bool gl_initialized)
 
 {
 	// colors travels by type
@@ -5902,8 +6224,10 @@ inline void travel_paths_internal(
 		sort_remove_duplicates(values);
 		by_type.reserve(values.size());
 		// creates a new volume for each feedrate
-		for (TYPE type : values)
+		for (TYPE type : values) {
 			by_type.emplace_back(type, volumes.new_nontoolpath_volume(func_color(type).rgba.data(), VERTEX_BUFFER_RESERVE_SIZE));
+			volume_values.emplace_back(float(type));
+		}
 	}
 
 	// populates volumes
@@ -5924,6 +6248,7 @@ inline void travel_paths_internal(
 		// Ensure that no volume grows over the limits. If the volume is too large, allocate a new one.
 		if (vol.indexed_vertex_array.vertices_and_normals_interleaved.size() > MAX_VERTEX_BUFFER_SIZE) {
 			it->second = volumes.new_nontoolpath_volume(vol.color);
+			volume_values.emplace_back(float(it->first));
 			reserve_new_volume_finalize_old_volume(*it->second, vol, gl_initialized);
 		}
 	}
@@ -5945,25 +6270,23 @@ void GLCanvas3D::_load_gcode_travel_paths(const GCodePreviewData& preview_data,
     	m_gcode_preview_volume_index.first_volumes.emplace_back(GCodePreviewVolumeIndex::Travel, 0, (unsigned int)initial_volumes_count);
     	volume_index_allocated = true;
 
+	    auto func_color = [&preview_data, &tool_colors](const float value) { return gcode_travel_path_color(preview_data, tool_colors, value); };
 	    switch (preview_data.extrusion.view_type)
 	    {
 	    case GCodePreviewData::Extrusion::Feedrate:
 			travel_paths_internal<float>(preview_data,
 				[](const GCodePreviewData::Travel::Polyline &polyline) { return polyline.feedrate; }, 
-				[&preview_data](const float feedrate) -> const Color { return preview_data.get_feedrate_color(feedrate); },
-				m_volumes, m_initialized);
+				func_color, m_volumes, m_gcode_preview_volume_index.volume_values, m_initialized);
 	        break;
 	    case GCodePreviewData::Extrusion::Tool:
 	    	travel_paths_internal<unsigned int>(preview_data,
 				[](const GCodePreviewData::Travel::Polyline &polyline) { return polyline.extruder_id; }, 
-				[&tool_colors](const unsigned int extruder_id) -> const Color { assert((extruder_id + 1) * 4 <= tool_colors.size()); return Color(tool_colors.data() + extruder_id * 4); },
-				m_volumes, m_initialized);
+				func_color, m_volumes, m_gcode_preview_volume_index.volume_values, m_initialized);
 	        break;
 	    default:
 	    	travel_paths_internal<unsigned int>(preview_data,
 				[](const GCodePreviewData::Travel::Polyline &polyline) { return polyline.type; }, 
-				[&preview_data](const unsigned int type) -> const Color& { return preview_data.travel.type_colors[type]; },
-				m_volumes, m_initialized);
+				func_color, m_volumes, m_gcode_preview_volume_index.volume_values, m_initialized);
 	        break;
 	    }
 	} catch (const std::bad_alloc & /* ex */) {
@@ -5973,6 +6296,7 @@ void GLCanvas3D::_load_gcode_travel_paths(const GCodePreviewData& preview_data,
         for (GLVolumePtrs::iterator it = begin; it < end; ++it)
             delete *it;
         m_volumes.volumes.erase(begin, end);
+        m_gcode_preview_volume_index.volume_values.resize(initial_volumes_count);
         if (volume_index_allocated)
         	m_gcode_preview_volume_index.first_volumes.pop_back();
         //FIXME report the memory issue?
@@ -5990,10 +6314,12 @@ void GLCanvas3D::_load_fff_shells()
         return;
 
     // adds objects' volumes 
+    // Walk over the ModelObjects instead of the PrintObjects, as the identical ModelObjects are printed by a single PrintObject.
     int object_id = 0;
-    for (const PrintObject* obj : print->objects())
+    for (const ModelObject* model_obj : print->model().objects)
     {
-        const ModelObject* model_obj = obj->model_object();
+        if (std::none_of(model_obj->instances.begin(), model_obj->instances.end(), [](const ModelInstance* mi) { return mi->is_printable(); }))
+            continue;
 
         std::vector<int> instance_ids(model_obj->instances.size());
         for (int i = 0; i < (int)model_obj->instances.size(); ++i)
@@ -6136,6 +6462,31 @@ void GLCanvas3D::_update_gcode_volumes_visibility(const GCodePreviewData& previe
     }
 }
 
+void GLCanvas3D::_update_gcode_volumes_colors(const GCodePreviewData& preview_data, const std::vector<float>& tool_colors)
+{
+    // The toolpaths are grouped by a value specific to the view type, thus they may only be recolored for the same view type.
+    if (m_gcode_preview_volume_index.view_type != int(preview_data.extrusion.view_type) ||
+        m_gcode_preview_volume_index.volume_values.size() != m_volumes.volumes.size())
+        return;
+
+    size_t size = m_gcode_preview_volume_index.first_volumes.size();
+    for (size_t i = 0; i < size; ++ i)
+    {
+        const GCodePreviewVolumeIndex::FirstVolume &first_volume = m_gcode_preview_volume_index.first_volumes[i];
+        if (first_volume.type != GCodePreviewVolumeIndex::Extrusion && first_volume.type != GCodePreviewVolumeIndex::Travel)
+            continue;
+        size_t end = (i + 1 < size) ? m_gcode_preview_volume_index.first_volumes[i + 1].id : m_volumes.volumes.size();
+        for (size_t idx = first_volume.id; idx < end; ++ idx) {
+            float value = m_gcode_preview_volume_index.volume_values[idx];
+            Color color = (first_volume.type == GCodePreviewVolumeIndex::Extrusion) ?
+                gcode_extrusion_path_color(preview_data, tool_colors, value) :
+                gcode_travel_path_color(preview_data, tool_colors, value);
+            // The render color is refreshed from the color when rendering.
+            ::memcpy((void*)m_volumes.volumes[idx]->color, (const void*)color.rgba.data(), 4 * sizeof(float));
+        }
+    }
+}
+
 void GLCanvas3D::_update_toolpath_volumes_outside_state()
 {
     // tolerance to avoid false detection at bed edges
@@ -6310,20 +6661,28 @@ void GLCanvas3D::_update_selection_from_hover()
     if ((state == GLSelectionRectangle::Select) && !ctrl_pressed)
         m_selection.clear();
 
-    for (int i : m_hover_volume_idxs)
+    if ((state == GLSelectionRectangle::Select) && !hover_modifiers_only)
     {
-        if (state == GLSelectionRectangle::Select)
+        // Selection::add() depends on the type of the selection, it is updated after each volume.
+        for (int i : m_hover_volume_idxs)
+        {
+            m_selection.add(i, false);
+        }
+    }
+    else
+    {
+        // Update the type of the selection once for all the hovered volumes.
+        Selection::Batch batch(m_selection);
+        for (int i : m_hover_volume_idxs)
         {
-            if (hover_modifiers_only)
+            if (state == GLSelectionRectangle::Select)
             {
                 const GLVolume& v = *m_volumes.volumes[i];
                 m_selection.add_volume(v.object_idx(), v.volume_idx(), v.instance_idx(), false);
             }
             else
-                m_selection.add(i, false);
+                m_selection.remove(i);
         }
-        else
-            m_selection.remove(i);
     }
 
     if (m_selection.is_empty())
@@ -3,6 +3,7 @@
 
 #include <stddef.h>
 #include <memory>
+#include <limits>
 
 #include "3DScene.hpp"
 #include "GLToolbar.hpp"
@@ -40,6 +41,7 @@ class GCodePreviewData;
 struct ThumbnailData;
 #endif // ENABLE_THUMBNAIL_GENERATOR
 struct SlicingParameters;
+class SlicingAdaptive;
 enum LayerHeightEditActionType : unsigned int;
 
 namespace GUI {
@@ -139,8 +141,13 @@ public:
         };
 
         std::vector<FirstVolume> first_volumes;
+        // For each volume of the GLVolumeCollection, the value of the path attribute the toolpaths were grouped by
+        // (extrusion role, layer height, feedrate, extruder ID...). Allows to recolor the toolpaths without regenerating their geometry.
+        std::vector<float>       volume_values;
+        // GCodePreviewData::Extrusion::EViewType the toolpaths were grouped for, -1 if no toolpaths were loaded.
+        int                      view_type { -1 };
 
-        void reset() { first_volumes.clear(); }
+        void reset() { first_volumes.clear(); volume_values.clear(); view_type = -1; }
     };
 
 private:
@@ -169,6 +176,10 @@ private:
         float                       m_object_max_z;
         // Owned by LayersEditing.
         SlicingParameters          *m_slicing_parameters;
+        // Owned by LayersEditing. Facets of m_model_object indexed by Z, reused while the adaptive quality is being changed.
+        SlicingAdaptive            *m_slicing_adaptive;
+        // Meshes and their transformations m_slicing_adaptive was prepared for.
+        std::vector<std::pair<const TriangleMesh*, Matrix4d>> m_slicing_adaptive_meshes;
         std::vector<double>         m_layer_height_profile;
         bool                        m_layer_height_profile_modified;
 
@@ -178,10 +189,12 @@ private:
         class LayersTexture
         {
         public:
-            LayersTexture() : width(0), height(0), levels(0), cells(0), valid(false) {}
+            LayersTexture() : width(0), height(0), levels(0), cells(0), valid(false), allocated(false) {}
 
             // Texture data
             std::vector<char>   data;
+            // Texture data last uploaded to the GPU, only the rows changed since then are uploaded.
+            std::vector<char>   data_uploaded;
             // Width of the texture, top level.
             size_t              width;
             // Height of the texture, top level.
@@ -192,6 +205,8 @@ private:
             size_t              cells;
             // Does it need to be refreshed?
             bool                valid;
+            // Was the storage of the texture allocated at the GPU?
+            bool                allocated;
         };
         LayersTexture   m_layers_texture;
 
@@ -236,9 +251,11 @@ private:
     private:
         bool is_initialized() const;
         void generate_layer_height_texture();
+        void upload_layer_height_texture();
         void render_active_object_annotations(const GLCanvas3D& canvas, const Rect& bar_rect) const;
         void render_profile(const Rect& bar_rect) const;
         void update_slicing_parameters();
+        void update_slicing_adaptive();
 
         static float thickness_bar_width(const GLCanvas3D &canvas);
     };
@@ -284,18 +301,24 @@ private:
 
     struct SlaCap
     {
+        // Caps of a single object triangulated at z = 0 and uploaded into VBOs, shifted to the clipping plane when rendering.
+        // They are valid as long as the clipping plane cuts the slice of the same print level.
         struct Triangles
         {
-            Pointf3s object;
-            Pointf3s supports;
+            coord_t              print_level { std::numeric_limits<coord_t>::max() };
+            GLIndexedVertexArray object;
+            GLIndexedVertexArray supports;
+
+            bool matches(coord_t print_level) const { return this->print_level == print_level; }
+            void invalidate() { print_level = std::numeric_limits<coord_t>::max(); }
         };
         typedef std::map<unsigned int, Triangles> ObjectIdToTrianglesMap;
-        double z;
         ObjectIdToTrianglesMap triangles;
 
-        SlaCap() { reset(); }
-        void reset() { z = DBL_MAX; triangles.clear(); }
-        bool matches(double z) const { return this->z == z; }
+        // The VBOs are released the next time the caps are rendered, when the OpenGL context is active.
+        void reset() { for (auto &kvp : triangles) kvp.second.invalidate(); }
+        // Release the VBOs, an OpenGL context has to be active.
+        void release_geometry() { triangles.clear(); }
     };
 
     class WarningTexture : public GUI::GLTexture
@@ -493,7 +516,7 @@ public:
             m_sla_caps[id].reset();
         }
     }
-    void reset_clipping_planes_cache() { m_sla_caps[0].triangles.clear(); m_sla_caps[1].triangles.clear(); }
+    void reset_clipping_planes_cache() { m_sla_caps[0].reset(); m_sla_caps[1].reset(); }
     void set_use_clipping_planes(bool use) { m_use_clipping_planes = use; }
 
     void set_color_by(const std::string& value);
@@ -538,6 +561,8 @@ public:
     // printable_only == false -> render also non printable volumes as grayed
     // parts_only == false -> render also sla support and pad
     void render_thumbnail(ThumbnailData& thumbnail_data, unsigned int w, unsigned int h, bool printable_only, bool parts_only, bool show_bed, bool transparent_background) const;
+    // render a thumbnail for each of the sizes, the invalid thumbnails are not added to the list
+    void render_thumbnails(ThumbnailsList& thumbnails, const Vec2ds& sizes, bool printable_only, bool parts_only, bool show_bed, bool transparent_background) const;
 #endif // ENABLE_THUMBNAIL_GENERATOR
 
     void select_all();
@@ -693,6 +718,8 @@ private:
     void _render_thumbnail_internal(ThumbnailData& thumbnail_data, bool printable_only, bool parts_only, bool show_bed, bool transparent_background) const;
     // render thumbnail using an off-screen framebuffer
     void _render_thumbnail_framebuffer(ThumbnailData& thumbnail_data, unsigned int w, unsigned int h, bool printable_only, bool parts_only, bool show_bed, bool transparent_background) const;
+    // render all the thumbnails into a single off-screen framebuffer sized for the largest one, reading back the pixels after all of them were rendered
+    void _render_thumbnails_framebuffer(ThumbnailsList& thumbnails, bool printable_only, bool parts_only, bool show_bed, bool transparent_background) const;
     // render thumbnail using an off-screen framebuffer when GLEW_EXT_framebuffer_object is supported
     void _render_thumbnail_framebuffer_ext(ThumbnailData& thumbnail_data, unsigned int w, unsigned int h, bool printable_only, bool parts_only, bool show_bed, bool transparent_background) const;
     // render thumbnail using the default framebuffer
@@ -734,6 +761,8 @@ private:
 	void _load_sla_shells();
     // sets gcode geometry visibility according to user selection
     void _update_gcode_volumes_visibility(const GCodePreviewData& preview_data);
+    // recolors gcode extrusion and travel paths, if they were grouped for the current view type
+    void _update_gcode_volumes_colors(const GCodePreviewData& preview_data, const std::vector<float>& tool_colors);
     void _update_toolpath_volumes_outside_state();
     void _update_sla_shells_outside_state();
     void _show_warning_texture_if_needed(WarningTexture::Warning warning);
@@ -175,6 +175,8 @@ void GLShader::release()
         glsafe(::glDeleteProgram(this->shader_program_id));
         this->shader_program_id = 0;
     }
+    m_attrib_locations.clear();
+    m_uniform_locations.clear();
 
     if (this->vertex_program_id) {
         glsafe(::glDeleteShader(this->vertex_program_id));
@@ -199,13 +201,24 @@ void GLShader::disable() const
 // Return shader vertex attribute ID
 int GLShader::get_attrib_location(const char *name) const
 {
-    return this->shader_program_id ? glGetAttribLocation(this->shader_program_id, name) : -1;
+    if (this->shader_program_id == 0)
+        return -1;
+    auto it = m_attrib_locations.find(name);
+    if (it == m_attrib_locations.end())
+        it = m_attrib_locations.emplace(name, glGetAttribLocation(this->shader_program_id, name)).first;
+    return it->second;
 }
 
-// Return shader uniform variable ID
+// Return shader uniform variable ID.
+// The locations are fixed once the program is linked, thus they are queried from the driver just once.
 int GLShader::get_uniform_location(const char *name) const
 {
-    return this->shader_program_id ? glGetUniformLocation(this->shader_program_id, name) : -1;
+    if (this->shader_program_id == 0)
+        return -1;
+    auto it = m_uniform_locations.find(name);
+    if (it == m_uniform_locations.end())
+        it = m_uniform_locations.emplace(name, glGetUniformLocation(this->shader_program_id, name)).first;
+    return it->second;
 }
 
 bool GLShader::set_uniform(const char *name, float value) const
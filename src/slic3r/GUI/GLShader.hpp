@@ -4,6 +4,9 @@
 #include "libslic3r/libslic3r.h"
 #include "libslic3r/Point.hpp"
 
+#include <map>
+#include <string>
+
 namespace Slic3r {
 
 class GLShader
@@ -35,6 +38,12 @@ public:
     unsigned int    vertex_program_id;
     unsigned int    shader_program_id;
     std::string     last_error;
+
+private:
+    // Locations of the attributes and uniforms queried so far, valid until the program is released.
+    // The transparent comparator looks the names up without constructing a std::string.
+    mutable std::map<std::string, int, std::less<>> m_attrib_locations;
+    mutable std::map<std::string, int, std::less<>> m_uniform_locations;
 };
 
 class Shader
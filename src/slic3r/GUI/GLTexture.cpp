@@ -2,9 +2,11 @@
 #include "GLTexture.hpp"
 
 #include "3DScene.hpp"
+#include "IconRasterCache.hpp"
 
 #include <GL/glew.h>
 
+#include <wx/app.h>
 #include <wx/image.h>
 
 #include <boost/filesystem.hpp>
@@ -12,7 +14,6 @@
 
 #include <vector>
 #include <algorithm>
-#include <thread>
 
 #define STB_DXT_IMPLEMENTATION
 #include "stb_dxt/stb_dxt.h"
@@ -27,29 +28,26 @@ namespace GUI {
 
 void GLTexture::Compressor::reset()
 {
-	if (m_thread.joinable()) {
-        m_abort_compressing = true;
-		m_thread.join();
+	if (m_job) {
+		m_job->cancel();
+		m_job->wait();
+		m_job.reset();
 	    m_levels.clear();
 	    m_num_levels_compressed = 0;
-	    m_abort_compressing = false;
 	}
 	assert(m_levels.empty());
-	assert(m_abort_compressing == false);
 	assert(m_num_levels_compressed == 0);
 }
 
 void GLTexture::Compressor::start_compressing()
 {
-	// The worker thread should be stopped already.
-	assert(! m_thread.joinable());
+	// The compression job should be finished already.
+	assert(! m_job);
 	assert(! m_levels.empty());
-	assert(m_abort_compressing == false);
 	assert(m_num_levels_compressed == 0);
-	if (! m_levels.empty()) {
-		std::thread thrd(&GLTexture::Compressor::compress, this);
-    	m_thread = std::move(thrd);
-    }
+	if (! m_levels.empty())
+		// Low priority: The texture is usable uncompressed in the meantime, the jobs blocking the UI go first.
+		m_job = TextureJobQueue::instance().push([this](const TextureJobQueue::Job &job) { this->compress(job); }, TextureJobQueue::Low);
 }
 
 bool GLTexture::Compressor::unsent_compressed_data_available() const
@@ -90,20 +88,19 @@ void GLTexture::Compressor::send_compressed_data_to_gpu()
     glsafe(::glBindTexture(GL_TEXTURE_2D, 0));
 
     if (num_compressed == (int)m_levels.size())
-        // Finalize the worker thread, close it.
+        // Finalize the compression job.
     	this->reset();
 }
 
-void GLTexture::Compressor::compress()
+void GLTexture::Compressor::compress(const TextureJobQueue::Job &job)
 {
     // reference: https://github.com/Cyan4973/RygsDXTc
 
     assert(m_num_levels_compressed == 0);
-    assert(m_abort_compressing == false);
 
     for (Level& level : m_levels)
     {
-        if (m_abort_compressing)
+        if (job.canceled())
             break;
 
         // stb_dxt library, despite claiming that the needed size of the destination buffer is equal to (source buffer size)/4,
@@ -116,6 +113,8 @@ void GLTexture::Compressor::compress()
         // we are done with the source data, we can discard it
         level.src_data.clear();
         ++ m_num_levels_compressed;
+        // Let the idle handler of the canvas send the level to the GPU, instead of rendering frames until the compression finishes.
+        wxWakeUpIdle();
     }
 }
 
@@ -195,133 +194,164 @@ bool GLTexture::load_from_svg_files_as_sprites_array(const std::vector<std::stri
         return false;
     }
 
-    std::vector<unsigned char> data(n_pixels * 4, 0);
-    std::vector<unsigned char> sprite_data(sprite_bytes, 0);
-    std::vector<unsigned char> sprite_white_only_data(sprite_bytes, 0);
-    std::vector<unsigned char> sprite_gray_only_data(sprite_bytes, 0);
-    std::vector<unsigned char> output_data(sprite_bytes, 0);
+    std::vector<unsigned char> data;
 
-    NSVGrasterizer* rast = nsvgCreateRasterizer();
-    if (rast == nullptr)
+    // The atlas is rasterized only if it is not found in the on-disk cache for this sprite size and set of states.
+#if ENABLE_MODIFIED_TOOLBAR_TEXTURES
+    std::string cache_params = "sprites-ex-" + std::to_string(sprite_size_px);
+#else
+    std::string cache_params = "sprites-" + std::to_string(sprite_size_px);
+#endif // ENABLE_MODIFIED_TOOLBAR_TEXTURES
+    for (const std::pair<int, bool>& state : states)
     {
-        reset();
-        return false;
+        cache_params += "-" + std::to_string(state.first) + (state.second ? "b" : "");
     }
-
-    int sprite_id = -1;
-    for (const std::string& filename : filenames)
+    std::string  cache_key = IconRasterCache::key(filenames, cache_params);
+    unsigned int cached_width = 0;
+    unsigned int cached_height = 0;
+    if (!IconRasterCache::load(cache_key, cached_width, cached_height, data) || (cached_width != (unsigned int)m_width) || (cached_height != (unsigned int)m_height))
     {
-        ++sprite_id;
+        data.assign(n_pixels * 4, 0);
 
-        if (!boost::filesystem::exists(filename))
-            continue;
+        // The sprites are rasterized in parallel on the shared texture workers, each sprite into its own rows of data.
+        std::atomic<bool> rasterizer_failed(false);
+        TextureJobQueue::instance().run(filenames.size(), [&](size_t sprite_idx)
+        {
+            int sprite_id = (int)sprite_idx;
+            const std::string& filename = filenames[sprite_idx];
 
-        if (!boost::algorithm::iends_with(filename, ".svg"))
-            continue;
+            if (!boost::filesystem::exists(filename))
+                return;
 
-        NSVGimage* image = nsvgParseFromFile(filename.c_str(), "px", 96.0f);
-        if (image == nullptr)
-            continue;
+            if (!boost::algorithm::iends_with(filename, ".svg"))
+                return;
 
-        float scale = (float)sprite_size_px / std::max(image->width, image->height);
+            NSVGrasterizer* rast = nsvgCreateRasterizer();
+            if (rast == nullptr)
+            {
+                rasterizer_failed = true;
+                return;
+            }
 
-#if ENABLE_MODIFIED_TOOLBAR_TEXTURES
-        // offset by 1 to leave the first pixel empty (both in x and y)
-        nsvgRasterize(rast, image, 1, 1, scale, sprite_data.data(), sprite_size_px, sprite_size_px, sprite_stride);
-#else
-        nsvgRasterize(rast, image, 0, 0, scale, sprite_data.data(), sprite_size_px, sprite_size_px, sprite_stride);
-#endif // ENABLE_MODIFIED_TOOLBAR_TEXTURES
+            NSVGimage* image = nsvgParseFromFile(filename.c_str(), "px", 96.0f);
+            if (image == nullptr)
+            {
+                nsvgDeleteRasterizer(rast);
+                return;
+            }
 
-        // makes white only copy of the sprite
-        ::memcpy((void*)sprite_white_only_data.data(), (const void*)sprite_data.data(), sprite_bytes);
-        for (int i = 0; i < sprite_n_pixels; ++i)
-        {
-            int offset = i * 4;
-            if (sprite_white_only_data.data()[offset] != 0)
-                ::memset((void*)&sprite_white_only_data.data()[offset], 255, 3);
-        }
+            std::vector<unsigned char> sprite_data(sprite_bytes, 0);
+            std::vector<unsigned char> sprite_white_only_data(sprite_bytes, 0);
+            std::vector<unsigned char> sprite_gray_only_data(sprite_bytes, 0);
+            std::vector<unsigned char> output_data(sprite_bytes, 0);
 
-        // makes gray only copy of the sprite
-        ::memcpy((void*)sprite_gray_only_data.data(), (const void*)sprite_data.data(), sprite_bytes);
-        for (int i = 0; i < sprite_n_pixels; ++i)
-        {
-            int offset = i * 4;
-            if (sprite_gray_only_data.data()[offset] != 0)
-                ::memset((void*)&sprite_gray_only_data.data()[offset], 128, 3);
-        }
+            float scale = (float)sprite_size_px / std::max(image->width, image->height);
 
 #if ENABLE_MODIFIED_TOOLBAR_TEXTURES
-        int sprite_offset_px = sprite_id * (int)sprite_size_px_ex * m_width;
+            // offset by 1 to leave the first pixel empty (both in x and y)
+            nsvgRasterize(rast, image, 1, 1, scale, sprite_data.data(), sprite_size_px, sprite_size_px, sprite_stride);
 #else
-        int sprite_offset_px = sprite_id * sprite_size_px * m_width;
+            nsvgRasterize(rast, image, 0, 0, scale, sprite_data.data(), sprite_size_px, sprite_size_px, sprite_stride);
 #endif // ENABLE_MODIFIED_TOOLBAR_TEXTURES
-        int state_id = -1;
-        for (const std::pair<int, bool>& state : states)
-        {
-            ++state_id;
 
-            // select the sprite variant
-            std::vector<unsigned char>* src = nullptr;
-            switch (state.first)
+            // makes white only copy of the sprite
+            ::memcpy((void*)sprite_white_only_data.data(), (const void*)sprite_data.data(), sprite_bytes);
+            for (int i = 0; i < sprite_n_pixels; ++i)
             {
-            case 1: { src = &sprite_white_only_data; break; }
-            case 2: { src = &sprite_gray_only_data; break; }
-            default: { src = &sprite_data; break; }
+                int offset = i * 4;
+                if (sprite_white_only_data.data()[offset] != 0)
+                    ::memset((void*)&sprite_white_only_data.data()[offset], 255, 3);
             }
 
-            ::memcpy((void*)output_data.data(), (const void*)src->data(), sprite_bytes);
-            // applies background, if needed
-            if (state.second)
+            // makes gray only copy of the sprite
+            ::memcpy((void*)sprite_gray_only_data.data(), (const void*)sprite_data.data(), sprite_bytes);
+            for (int i = 0; i < sprite_n_pixels; ++i)
             {
+                int offset = i * 4;
+                if (sprite_gray_only_data.data()[offset] != 0)
+                    ::memset((void*)&sprite_gray_only_data.data()[offset], 128, 3);
+            }
+
 #if ENABLE_MODIFIED_TOOLBAR_TEXTURES
-                float inv_255 = 1.0f / 255.0f;
-                // offset by 1 to leave the first pixel empty (both in x and y)
-                for (unsigned int r = 1; r <= sprite_size_px; ++r)
+            int sprite_offset_px = sprite_id * (int)sprite_size_px_ex * m_width;
+#else
+            int sprite_offset_px = sprite_id * sprite_size_px * m_width;
+#endif // ENABLE_MODIFIED_TOOLBAR_TEXTURES
+            int state_id = -1;
+            for (const std::pair<int, bool>& state : states)
+            {
+                ++state_id;
+
+                // select the sprite variant
+                std::vector<unsigned char>* src = nullptr;
+                switch (state.first)
                 {
-                    unsigned int offset_r = r * sprite_size_px_ex;
-                    for (unsigned int c = 1; c <= sprite_size_px; ++c)
+                case 1: { src = &sprite_white_only_data; break; }
+                case 2: { src = &sprite_gray_only_data; break; }
+                default: { src = &sprite_data; break; }
+                }
+
+                ::memcpy((void*)output_data.data(), (const void*)src->data(), sprite_bytes);
+                // applies background, if needed
+                if (state.second)
+                {
+#if ENABLE_MODIFIED_TOOLBAR_TEXTURES
+                    float inv_255 = 1.0f / 255.0f;
+                    // offset by 1 to leave the first pixel empty (both in x and y)
+                    for (unsigned int r = 1; r <= sprite_size_px; ++r)
                     {
-                        unsigned int offset = (offset_r + c) * 4;
-                        float alpha = (float)output_data.data()[offset + 3] * inv_255;
+                        unsigned int offset_r = r * sprite_size_px_ex;
+                        for (unsigned int c = 1; c <= sprite_size_px; ++c)
+                        {
+                            unsigned int offset = (offset_r + c) * 4;
+                            float alpha = (float)output_data.data()[offset + 3] * inv_255;
+                            output_data.data()[offset + 0] = (unsigned char)(output_data.data()[offset + 0] * alpha);
+                            output_data.data()[offset + 1] = (unsigned char)(output_data.data()[offset + 1] * alpha);
+                            output_data.data()[offset + 2] = (unsigned char)(output_data.data()[offset + 2] * alpha);
+                            output_data.data()[offset + 3] = (unsigned char)(128 * (1.0f - alpha) + output_data.data()[offset + 3] * alpha);
+                        }
+                    }
+#else
+                    for (int i = 0; i < sprite_n_pixels; ++i)
+                    {
+                        int offset = i * 4;
+                        float alpha = (float)output_data.data()[offset + 3] / 255.0f;
                         output_data.data()[offset + 0] = (unsigned char)(output_data.data()[offset + 0] * alpha);
                         output_data.data()[offset + 1] = (unsigned char)(output_data.data()[offset + 1] * alpha);
                         output_data.data()[offset + 2] = (unsigned char)(output_data.data()[offset + 2] * alpha);
                         output_data.data()[offset + 3] = (unsigned char)(128 * (1.0f - alpha) + output_data.data()[offset + 3] * alpha);
                     }
+#endif // ENABLE_MODIFIED_TOOLBAR_TEXTURES
+                }
+
+#if ENABLE_MODIFIED_TOOLBAR_TEXTURES
+                int state_offset_px = sprite_offset_px + state_id * sprite_size_px_ex;
+                for (int j = 0; j < (int)sprite_size_px_ex; ++j)
+                {
+                    ::memcpy((void*)&data.data()[(state_offset_px + j * m_width) * 4], (const void*)&output_data.data()[j * sprite_stride], sprite_stride);
                 }
 #else
-                for (int i = 0; i < sprite_n_pixels; ++i)
+                int state_offset_px = sprite_offset_px + state_id * sprite_size_px;
+                for (int j = 0; j < (int)sprite_size_px; ++j)
                 {
-                    int offset = i * 4;
-                    float alpha = (float)output_data.data()[offset + 3] / 255.0f;
-                    output_data.data()[offset + 0] = (unsigned char)(output_data.data()[offset + 0] * alpha);
-                    output_data.data()[offset + 1] = (unsigned char)(output_data.data()[offset + 1] * alpha);
-                    output_data.data()[offset + 2] = (unsigned char)(output_data.data()[offset + 2] * alpha);
-                    output_data.data()[offset + 3] = (unsigned char)(128 * (1.0f - alpha) + output_data.data()[offset + 3] * alpha);
+                    ::memcpy((void*)&data.data()[(state_offset_px + j * m_width) * 4], (const void*)&output_data.data()[j * sprite_stride], sprite_stride);
                 }
 #endif // ENABLE_MODIFIED_TOOLBAR_TEXTURES
             }
 
-#if ENABLE_MODIFIED_TOOLBAR_TEXTURES
-            int state_offset_px = sprite_offset_px + state_id * sprite_size_px_ex;
-            for (int j = 0; j < (int)sprite_size_px_ex; ++j)
-            {
-                ::memcpy((void*)&data.data()[(state_offset_px + j * m_width) * 4], (const void*)&output_data.data()[j * sprite_stride], sprite_stride);
-            }
-#else
-            int state_offset_px = sprite_offset_px + state_id * sprite_size_px;
-            for (int j = 0; j < (int)sprite_size_px; ++j)
-            {
-                ::memcpy((void*)&data.data()[(state_offset_px + j * m_width) * 4], (const void*)&output_data.data()[j * sprite_stride], sprite_stride);
-            }
-#endif // ENABLE_MODIFIED_TOOLBAR_TEXTURES
+            nsvgDelete(image);
+            nsvgDeleteRasterizer(rast);
+        });
+
+        if (rasterizer_failed)
+        {
+            reset();
+            return false;
         }
 
-        nsvgDelete(image);
+        IconRasterCache::save(cache_key, (unsigned int)m_width, (unsigned int)m_height, data);
     }
 
-    nsvgDeleteRasterizer(rast);
-
     // sends data to gpu
     glsafe(::glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
     glsafe(::glGenTextures(1, &m_id));
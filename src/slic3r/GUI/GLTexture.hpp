@@ -4,7 +4,8 @@
 #include <atomic>
 #include <string>
 #include <vector>
-#include <thread>
+
+#include "TextureJobQueue.hpp"
 
 class wxImage;
 
@@ -28,16 +29,14 @@ namespace GUI {
 
             GLTexture& m_texture;
             std::vector<Level> m_levels;
-            std::thread m_thread;
-            // Does the caller want the background thread to stop?
-            // This atomic also works as a memory barrier for synchronizing the cancel event with the worker thread.
-            std::atomic<bool> m_abort_compressing;
-            // How many levels were compressed since the start of the background processing thread?
+            // Compression job running on the shared TextureJobQueue. Canceling the job asks it to stop.
+            TextureJobQueue::JobPtr m_job;
+            // How many levels were compressed since the start of the background processing job?
             // This atomic also works as a memory barrier for synchronizing results of the worker thread with the calling thread.
             std::atomic<unsigned int> m_num_levels_compressed;
 
         public:
-            explicit Compressor(GLTexture& texture) : m_texture(texture), m_abort_compressing(false), m_num_levels_compressed(0) {}
+            explicit Compressor(GLTexture& texture) : m_texture(texture), m_num_levels_compressed(0) {}
             ~Compressor() { reset(); }
 
             void reset();
@@ -51,7 +50,7 @@ namespace GUI {
             bool all_compressed_data_sent_to_gpu() const { return m_levels.empty(); }
 
         private:
-            void compress();
+            void compress(const TextureJobQueue::Job &job);
         };
 
     public:
@@ -7,6 +7,7 @@
 #include <iterator>
 #include <exception>
 #include <cstdlib>
+#include <thread>
 #include <boost/lexical_cast.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/log/trivial.hpp>
@@ -29,6 +30,7 @@
 #include "libslic3r/Utils.hpp"
 #include "libslic3r/Model.hpp"
 #include "libslic3r/I18N.hpp"
+#include "libslic3r/SliceCache.hpp"
 
 #include "GUI.hpp"
 #include "GUI_Utils.hpp"
@@ -69,7 +71,7 @@ wxString file_wildcards(FileType file_type, const std::string &custom_extension)
         /* FT_AMF */     "AMF files (*.amf)|*.zip.amf;*.amf;*.AMF;*.xml;*.XML",
         /* FT_3MF */     "3MF files (*.3mf)|*.3mf;*.3MF;",
         /* FT_PRUSA */   "Prusa Control files (*.prusa)|*.prusa;*.PRUSA",
-        /* FT_GCODE */   "G-code files (*.gcode, *.gco, *.g, *.ngc)|*.gcode;*.GCODE;*.gco;*.GCO;*.g;*.G;*.ngc;*.NGC",
+        /* FT_GCODE */   "G-code files (*.gcode, *.gco, *.g, *.ngc, *.bgcode)|*.gcode;*.GCODE;*.gco;*.GCO;*.g;*.G;*.ngc;*.NGC;*.bgcode;*.BGCODE",
         /* FT_MODEL */   "Known files (*.stl, *.obj, *.amf, *.xml, *.3mf, *.prusa)|*.stl;*.STL;*.obj;*.OBJ;*.amf;*.AMF;*.xml;*.XML;*.3mf;*.3MF;*.prusa;*.PRUSA",
         /* FT_PROJECT */ "Project files (*.3mf, *.amf)|*.3mf;*.3MF;*.amf;*.AMF",
 
@@ -114,6 +116,12 @@ static void register_dpi_event()
 #endif
 }
 
+// The on-disk cache of the slices and the thread limit are owned by libslic3r, they are set from the preferences.
+static void update_slicing_settings(const AppConfig &app_config)
+{
+    SliceCache::enable(app_config.get("slice_cache") == "1" ? size_t(1) << 30 : 0);
+    set_num_threads((unsigned int)std::max(0, atoi(app_config.get("threads").c_str())));
+}
 
 static void generic_exception_handle()
 {
@@ -221,17 +229,43 @@ bool GUI_App::on_init_inner()
 
     app_config->set("version", SLIC3R_VERSION);
     app_config->save();
+    update_slicing_settings(*app_config);
+
+    // Suppress the '- default -' presets.
+    preset_bundle->set_default_suppressed(app_config->get("no_defaults") == "1");
+
+    // Parse the profiles and install the PresetUpdater indices on worker threads, while the UI thread
+    // initializes the fonts and the translations. The workers only read the AppConfig,
+    // therefore the AppConfig shall not be modified until they are joined.
+    std::string preset_errors;
+    std::thread preset_loader([this, &preset_errors]() {
+        try {
+            preset_errors = preset_bundle->load_preset_files();
+        } catch (const std::exception &ex) {
+            preset_errors = ex.what();
+        }
+    });
+    std::string updater_error;
+    std::thread updater_loader([this, &updater_error]() {
+        try {
+            preset_updater = new PresetUpdater();
+        } catch (const std::exception &ex) {
+            updater_error = ex.what();
+        }
+    });
+    // Join the workers even if the initialization below throws.
+    auto join_loaders = [&preset_loader, &updater_loader]() {
+        if (updater_loader.joinable())
+            updater_loader.join();
+        if (preset_loader.joinable())
+            preset_loader.join();
+    };
+    ScopeGuard loaders_guard(join_loaders);
 
 #ifdef __WXMSW__
     associate_3mf_files();
 #endif // __WXMSW__
 
-    preset_updater = new PresetUpdater();
-    Bind(EVT_SLIC3R_VERSION_ONLINE, [this](const wxCommandEvent &evt) {
-        app_config->set("version_online", into_u8(evt.GetString()));
-        app_config->save();
-    });
-
     // initialize label colors and fonts
     init_label_colours();
     init_fonts();
@@ -239,13 +273,18 @@ bool GUI_App::on_init_inner()
     // If load_language() fails, the application closes.
     load_language(wxString(), true);
 
-    // Suppress the '- default -' presets.
-    preset_bundle->set_default_suppressed(app_config->get("no_defaults") == "1");
-    try {
-        preset_bundle->load_presets(*app_config);
-    } catch (const std::exception &ex) {
-        show_error(nullptr, from_u8(ex.what()));
-    }
+    join_loaders();
+    if (! updater_error.empty())
+        throw std::runtime_error(updater_error);
+    Bind(EVT_SLIC3R_VERSION_ONLINE, [this](const wxCommandEvent &evt) {
+        app_config->set("version_online", into_u8(evt.GetString()));
+        app_config->save();
+    });
+
+    if (preset_errors.empty())
+        preset_bundle->load_preset_selections(*app_config);
+    else
+        show_error(nullptr, from_u8(preset_errors));
 
     register_dpi_event();
 
@@ -540,6 +579,7 @@ void fatal_error(wxWindow* parent)
 // Update the UI based on the current preferences.
 void GUI_App::update_ui_from_settings()
 {
+    update_slicing_settings(*app_config);
     mainframe->update_ui_from_settings();
 }
 
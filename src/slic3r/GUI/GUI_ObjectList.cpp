@@ -54,6 +54,10 @@ static std::vector<std::pair<std::string, std::string>> ADD_VOLUME_MENU_ITEMS =
     {L("Add support blocker"),   "support_blocker"}      // ~ModelVolumeType::SUPPORT_BLOCKER
 };
 
+// Objects with more instances are added with the instances collapsed, so that the control
+// does not create the rows of all of them.
+static const size_t MAX_INSTANCES_EXPANDED = 100;
+
 static PrinterTechnology printer_technology()
 {
     return wxGetApp().preset_bundle->printers.get_selected_preset().printer_technology();
@@ -2584,7 +2588,9 @@ void ObjectList::add_object_to_list(size_t obj_idx, bool call_selection_changed)
 
         const wxDataViewItem object_item = m_objects_model->GetItemById(obj_idx);
         m_objects_model->AddInstanceChild(object_item, print_idicator);
-        Expand(m_objects_model->GetInstanceRootItem(object_item));
+        // The rows of a collapsed node are only created by the control once the user expands it.
+        if (model_object->instances.size() <= MAX_INSTANCES_EXPANDED)
+            Expand(m_objects_model->GetInstanceRootItem(object_item));
     }
     else
         m_objects_model->SetPrintableState(model_object->instances[0]->printable ? piPrintable : piUnprintable, obj_idx);
@@ -3984,6 +3990,8 @@ void ObjectList::update_after_undo_redo()
     m_objects_model->DeleteAll();
     m_prevent_list_events = false;
 
+    // Don't repaint the control for each of the items added.
+    this->Freeze();
     size_t obj_idx = 0;
     std::vector<size_t> obj_idxs;
     obj_idxs.reserve(m_objects->size());
@@ -3992,6 +4000,7 @@ void ObjectList::update_after_undo_redo()
         obj_idxs.push_back(obj_idx);
         ++obj_idx;
     }
+    this->Thaw();
 
     update_selections();
 
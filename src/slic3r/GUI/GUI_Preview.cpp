@@ -534,8 +534,8 @@ void Preview::on_checkbox_travel(wxCommandEvent& evt)
 {
     m_gcode_preview_data->travel.is_visible = m_checkbox_travel->IsChecked();
     m_gcode_preview_data->ranges.feedrate.set_mode(GCodePreviewData::FeedrateKind::TRAVEL, m_gcode_preview_data->travel.is_visible);
-    // Rather than refresh, reload print so that speed color ranges get recomputed (affected by travel visibility)
-    reload_print();
+    // The speed color ranges are affected by the travel visibility, the loaded toolpaths are recolored by the refresh.
+    refresh_print();
 }
 
 void Preview::on_checkbox_retractions(wxCommandEvent& evt)
@@ -2,9 +2,13 @@
 #include "GLGizmoFlatten.hpp"
 #include "slic3r/GUI/GLCanvas3D.hpp"
 #include "slic3r/GUI/GUI_App.hpp"
+#include "slic3r/Utils/Thread.hpp"
 
+#include <algorithm>
 #include <numeric>
 
+#include <boost/log/trivial.hpp>
+
 #include <GL/glew.h>
 
 namespace Slic3r {
@@ -18,6 +22,14 @@ GLGizmoFlatten::GLGizmoFlatten(GLCanvas3D& parent, const std::string& icon_filen
 {
 }
 
+GLGizmoFlatten::~GLGizmoFlatten()
+{
+    if (m_planes_job)
+        m_planes_job->canceled = true;
+    if (m_planes_thread.joinable())
+        m_planes_thread.join();
+}
+
 bool GLGizmoFlatten::on_init()
 {
     m_shortcut_key = WXK_CONTROL_F;
@@ -52,7 +64,7 @@ bool GLGizmoFlatten::on_is_activable() const
 
 void GLGizmoFlatten::on_start_dragging()
 {
-    if (m_hover_id != -1)
+    if (m_hover_id != -1 && m_hover_id < (int)m_planes.size())
     {
         assert(m_planes_valid);
         m_normal = m_planes[m_hover_id].normal;
@@ -140,20 +152,18 @@ void GLGizmoFlatten::set_flattening_data(const ModelObject* model_object)
     m_model_object_id = model_object ? model_object->id() : 0;
 }
 
-void GLGizmoFlatten::update_planes()
+GLGizmoFlatten::PlanesData GLGizmoFlatten::calculate_planes(const PlanesJob &job)
 {
     TriangleMesh ch;
-    for (const ModelVolume* vol : m_model_object->volumes)
+    for (size_t i = 0; i < job.convex_hulls.size(); ++ i)
     {
-        if (vol->type() != ModelVolumeType::MODEL_PART)
-            continue;
-        TriangleMesh vol_ch = vol->get_convex_hull();
-        vol_ch.transform(vol->get_matrix());
+        TriangleMesh vol_ch = *job.convex_hulls[i];
+        vol_ch.transform(job.convex_hulls_matrices[i]);
         ch.merge(vol_ch);
     }
     ch = ch.convex_hull_3d();
-    m_planes.clear();
-    const Transform3d& inst_matrix = m_model_object->instances.front()->get_matrix(true);
+    PlanesData planes;
+    const Transform3d& inst_matrix = job.instance_matrix;
 
     // Following constants are used for discarding too small polygons.
     const float minimal_area = 5.f; // in square mm (world coordinates)
@@ -167,6 +177,8 @@ void GLGizmoFlatten::update_planes()
     int               facet_queue_cnt = 0;
     const stl_normal* normal_ptr = nullptr;
     while (1) {
+        if (job.canceled)
+            return PlanesData();
         // Find next unvisited triangle:
         int facet_idx = 0;
         for (; facet_idx < num_of_facets; ++ facet_idx)
@@ -174,7 +186,7 @@ void GLGizmoFlatten::update_planes()
                 facet_queue[facet_queue_cnt ++] = facet_idx;
                 facet_visited[facet_idx] = true;
                 normal_ptr = &ch.stl.facet_start[facet_idx].normal;
-                m_planes.emplace_back();
+                planes.emplace_back();
                 break;
             }
         if (facet_idx == num_of_facets)
@@ -186,7 +198,7 @@ void GLGizmoFlatten::update_planes()
             if (std::abs(this_normal(0) - (*normal_ptr)(0)) < 0.001 && std::abs(this_normal(1) - (*normal_ptr)(1)) < 0.001 && std::abs(this_normal(2) - (*normal_ptr)(2)) < 0.001) {
                 stl_vertex* first_vertex = ch.stl.facet_start[facet_idx].vertex;
                 for (int j=0; j<3; ++j)
-                    m_planes.back().vertices.emplace_back((double)first_vertex[j](0), (double)first_vertex[j](1), (double)first_vertex[j](2));
+                    planes.back().vertices.emplace_back((double)first_vertex[j](0), (double)first_vertex[j](1), (double)first_vertex[j](2));
 
                 facet_visited[facet_idx] = true;
                 for (int j = 0; j < 3; ++ j) {
@@ -196,18 +208,18 @@ void GLGizmoFlatten::update_planes()
                 }
             }
         }
-        m_planes.back().normal = normal_ptr->cast<double>();
+        planes.back().normal = normal_ptr->cast<double>();
 
         // Now we'll transform all the points into world coordinates, so that the areas, angles and distances
         // make real sense.
-        m_planes.back().vertices = transform(m_planes.back().vertices, inst_matrix);
+        planes.back().vertices = transform(planes.back().vertices, inst_matrix);
 
         // if this is a just a very small triangle, remove it to speed up further calculations (it would be rejected later anyway):
-        if (m_planes.back().vertices.size() == 3 &&
-            ((m_planes.back().vertices[0] - m_planes.back().vertices[1]).norm() < minimal_side
-            || (m_planes.back().vertices[0] - m_planes.back().vertices[2]).norm() < minimal_side
-            || (m_planes.back().vertices[1] - m_planes.back().vertices[2]).norm() < minimal_side))
-            m_planes.pop_back();
+        if (planes.back().vertices.size() == 3 &&
+            ((planes.back().vertices[0] - planes.back().vertices[1]).norm() < minimal_side
+            || (planes.back().vertices[0] - planes.back().vertices[2]).norm() < minimal_side
+            || (planes.back().vertices[1] - planes.back().vertices[2]).norm() < minimal_side))
+            planes.pop_back();
     }
 
     // Let's prepare transformation of the normal vector from mesh to instance coordinates.
@@ -216,9 +228,11 @@ void GLGizmoFlatten::update_planes()
     t.set_scaling_factor(Vec3d(1./scaling(0), 1./scaling(1), 1./scaling(2)));
 
     // Now we'll go through all the polygons, transform the points into xy plane to process them:
-    for (unsigned int polygon_id=0; polygon_id < m_planes.size(); ++polygon_id) {
-        Pointf3s& polygon = m_planes[polygon_id].vertices;
-        const Vec3d& normal = m_planes[polygon_id].normal;
+    for (unsigned int polygon_id=0; polygon_id < planes.size(); ++polygon_id) {
+        if (job.canceled)
+            return PlanesData();
+        Pointf3s& polygon = planes[polygon_id].vertices;
+        const Vec3d& normal = planes[polygon_id].normal;
 
         // transform the normal according to the instance matrix:
         Vec3d normal_transformed = t.get_matrix() * normal;
@@ -240,7 +254,7 @@ void GLGizmoFlatten::update_planes()
         polygon = transform(polygon, tr.inverse());
 
         // Calculate area of the polygons and discard ones that are too small
-        float& area = m_planes[polygon_id].area;
+        float& area = planes[polygon_id].area;
         area = 0.f;
         for (unsigned int i = 0; i < polygon.size(); i++) // Shoelace formula
             area += polygon[i](0)*polygon[i + 1 < polygon.size() ? i + 1 : 0](1) - polygon[i + 1 < polygon.size() ? i + 1 : 0](0)*polygon[i](1);
@@ -266,7 +280,7 @@ void GLGizmoFlatten::update_planes()
         }
 
         if (discard) {
-            m_planes.erase(m_planes.begin() + (polygon_id--));
+            planes.erase(planes.begin() + (polygon_id--));
             continue;
         }
 
@@ -325,42 +339,114 @@ void GLGizmoFlatten::update_planes()
     }
 
     // We'll sort the planes by area and only keep the 254 largest ones (because of the picking pass limitations):
-    std::sort(m_planes.rbegin(), m_planes.rend(), [](const PlaneData& a, const PlaneData& b) { return a.area < b.area; });
-    m_planes.resize(std::min((int)m_planes.size(), 254));
-
-    // Planes are finished - let's save what we calculated it from:
-    m_volumes_matrices.clear();
-    m_volumes_types.clear();
-    for (const ModelVolume* vol : m_model_object->volumes) {
-        m_volumes_matrices.push_back(vol->get_matrix());
-        m_volumes_types.push_back(vol->type());
-    }
-    m_first_instance_scale = m_model_object->instances.front()->get_scaling_factor();
-    m_first_instance_mirror = m_model_object->instances.front()->get_mirror();
+    std::sort(planes.rbegin(), planes.rend(), [](const PlaneData& a, const PlaneData& b) { return a.area < b.area; });
+    planes.resize(std::min((int)planes.size(), 254));
 
-    m_planes_valid = true;
+    return planes;
 }
 
+// Number of objects, for which the calculated planes are kept.
+static const size_t PLANES_CACHE_SIZE = 4;
+
+void GLGizmoFlatten::update_planes()
+{
+    // Pick up the planes finished in the background.
+    if (m_planes_job && m_planes_job->finished) {
+        m_planes_thread.join();
+        if (! m_planes_job->canceled) {
+            if (m_planes_cache.size() == PLANES_CACHE_SIZE)
+                m_planes_cache.erase(m_planes_cache.begin());
+            m_planes_cache.emplace_back(std::move(m_planes_job->input), std::move(m_planes_job->planes));
+        }
+        m_planes_job.reset();
+    }
+
+    auto it_cached = std::find_if(m_planes_cache.begin(), m_planes_cache.end(),
+        [this](const std::pair<PlanesInput, PlanesData> &cached) { return cached.first.matches(*m_model_object); });
+    if (it_cached != m_planes_cache.end()) {
+        // Move to the back as the most recently used.
+        std::rotate(it_cached, it_cached + 1, m_planes_cache.end());
+        m_planes_input = m_planes_cache.back().first;
+        m_planes       = m_planes_cache.back().second;
+        m_planes_valid = true;
+        return;
+    }
+
+    // The planes of the previous state of the object are not valid anymore, nothing is shown until the new ones are calculated.
+    m_planes.clear();
+    m_planes_valid = false;
+
+    if (m_planes_job) {
+        // A job for an outdated state of the object is canceled, the new one is started after it finishes.
+        if (! m_planes_job->input.matches(*m_model_object))
+            m_planes_job->canceled = true;
+        return;
+    }
+
+    // The job receives copies of the transformations and references to the immutable convex hulls,
+    // so that the model may be modified while the planes are being calculated.
+    m_planes_job.reset(new PlanesJob());
+    PlanesJob &job = *m_planes_job;
+    job.input = PlanesInput(*m_model_object);
+    for (const ModelVolume* vol : m_model_object->volumes)
+    {
+        if (vol->type() != ModelVolumeType::MODEL_PART)
+            continue;
+        job.convex_hulls.emplace_back(vol->get_convex_hull_shared_ptr());
+        job.convex_hulls_matrices.emplace_back(vol->get_matrix());
+    }
+    job.instance_matrix = m_model_object->instances.front()->get_matrix(true);
+    m_planes_thread = create_thread([&job]() {
+        try {
+            job.planes = calculate_planes(job);
+        } catch (const std::exception &ex) {
+            BOOST_LOG_TRIVIAL(error) << "Calculation of the flattening planes failed: " << ex.what();
+            job.planes.clear();
+        }
+        job.finished = true;
+        // Let the idle handler of the canvas render the planes.
+        wxWakeUpIdle();
+    });
+}
 
 bool GLGizmoFlatten::is_plane_update_necessary() const
 {
     if (m_state != On || !m_model_object || m_model_object->instances.empty())
         return false;
 
-    if (! m_planes_valid || m_model_object->volumes.size() != m_volumes_matrices.size())
-        return true;
+    return ! m_planes_valid || planes_ready() || ! m_planes_input.matches(*m_model_object);
+}
+
+GLGizmoFlatten::PlanesInput::PlanesInput(const ModelObject &model_object) :
+    model_object_id(model_object.id()),
+    first_instance_scale(model_object.instances.front()->get_scaling_factor()),
+    first_instance_mirror(model_object.instances.front()->get_mirror())
+{
+    for (const ModelVolume* vol : model_object.volumes) {
+        volumes_convex_hulls.emplace_back(vol->get_convex_hull_shared_ptr());
+        volumes_matrices.push_back(vol->get_matrix());
+        volumes_types.push_back(vol->type());
+    }
+}
+
+bool GLGizmoFlatten::PlanesInput::matches(const ModelObject &model_object) const
+{
+    if (model_object.id() != model_object_id || model_object.volumes.size() != volumes_matrices.size())
+        return false;
 
     // We want to recalculate when the scale changes - some planes could (dis)appear.
-    if (! m_model_object->instances.front()->get_scaling_factor().isApprox(m_first_instance_scale)
-     || ! m_model_object->instances.front()->get_mirror().isApprox(m_first_instance_mirror))
-        return true;
+    if (! model_object.instances.front()->get_scaling_factor().isApprox(first_instance_scale)
+     || ! model_object.instances.front()->get_mirror().isApprox(first_instance_mirror))
+        return false;
 
-    for (unsigned int i=0; i < m_model_object->volumes.size(); ++i)
-        if (! m_model_object->volumes[i]->get_matrix().isApprox(m_volumes_matrices[i])
-         || m_model_object->volumes[i]->type() != m_volumes_types[i])
-            return true;
+    for (unsigned int i=0; i < model_object.volumes.size(); ++i)
+        if (! model_object.volumes[i]->get_matrix().isApprox(volumes_matrices[i])
+         || model_object.volumes[i]->type() != volumes_types[i]
+         // The convex hull is replaced together with the mesh. An expired reference never matches.
+         || volumes_convex_hulls[i].lock() != model_object.volumes[i]->get_convex_hull_shared_ptr())
+            return false;
 
-    return false;
+    return true;
 }
 
 Vec3d GLGizmoFlatten::get_flattening_normal() const
@@ -3,6 +3,11 @@
 
 #include "GLGizmoBase.hpp"
 
+#include <atomic>
+#include <memory>
+
+#include <boost/thread.hpp>
+
 
 namespace Slic3r {
 namespace GUI {
@@ -20,15 +25,42 @@ private:
         Vec3d normal;
         float area;
     };
+    typedef std::vector<PlaneData> PlanesData;
 
     // This holds information to decide whether recalculation is necessary:
-    std::vector<Transform3d> m_volumes_matrices;
-    std::vector<ModelVolumeType> m_volumes_types;
-    Vec3d m_first_instance_scale;
-    Vec3d m_first_instance_mirror;
+    struct PlanesInput {
+        PlanesInput() = default;
+        explicit PlanesInput(const ModelObject &model_object);
+        // Were the planes calculated for the current state of the object?
+        bool matches(const ModelObject &model_object) const;
+
+        ObjectID                                        model_object_id = 0;
+        // Weak references to the convex hulls of the volumes to detect a change of the meshes.
+        std::vector<std::weak_ptr<const TriangleMesh>>  volumes_convex_hulls;
+        std::vector<Transform3d>                        volumes_matrices;
+        std::vector<ModelVolumeType>                    volumes_types;
+        Vec3d                                           first_instance_scale;
+        Vec3d                                           first_instance_mirror;
+    };
+
+    // Calculation of the planes running in a background thread.
+    struct PlanesJob {
+        PlanesInput                                      input;
+        std::vector<std::shared_ptr<const TriangleMesh>> convex_hulls;
+        std::vector<Transform3d>                         convex_hulls_matrices;
+        Transform3d                                      instance_matrix;
+        PlanesData                                       planes;
+        std::atomic<bool>                                canceled { false };
+        std::atomic<bool>                                finished { false };
+    };
 
-    std::vector<PlaneData> m_planes;
+    PlanesInput m_planes_input;
+    PlanesData m_planes;
     bool m_planes_valid = false;
+    // Planes of the most recently used objects, the most recent at the back.
+    std::vector<std::pair<PlanesInput, PlanesData>> m_planes_cache;
+    std::unique_ptr<PlanesJob> m_planes_job;
+    boost::thread m_planes_thread;
     mutable Vec3d m_starting_center;
     const ModelObject* m_model_object = nullptr;
     ObjectID m_model_object_id = 0;
@@ -36,12 +68,16 @@ private:
 
     void update_planes();
     bool is_plane_update_necessary() const;
+    static PlanesData calculate_planes(const PlanesJob &job);
 
 public:
     GLGizmoFlatten(GLCanvas3D& parent, const std::string& icon_filename, unsigned int sprite_id);
+    ~GLGizmoFlatten();
 
     void set_flattening_data(const ModelObject* model_object);
     Vec3d get_flattening_normal() const;
+    // The planes calculated in the background are waiting to be picked up by the next frame.
+    bool planes_ready() const { return m_planes_job && m_planes_job->finished; }
 
 protected:
     virtual bool on_init() override;
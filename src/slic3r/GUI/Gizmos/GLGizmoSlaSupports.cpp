@@ -79,7 +79,6 @@ void GLGizmoSlaSupports::set_sla_support_data(ModelObject* model_object, const S
     {
         // Cache the bb - it's needed for dealing with the clipping plane quite often
         // It could be done inside update_mesh but one has to account for scaling of the instance.
-        //FIXME calling ModelObject::instance_bounding_box() is expensive!
         m_active_instance_bb_radius = m_model_object->instance_bounding_box(m_active_instance).radius();
 
         if (is_mesh_update_necessary()) {
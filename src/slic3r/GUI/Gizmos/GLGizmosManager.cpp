@@ -339,6 +339,15 @@ void GLGizmosManager::set_flattening_data(const ModelObject* model_object)
     dynamic_cast<GLGizmoFlatten*>(m_gizmos[Flatten].get())->set_flattening_data(model_object);
 }
 
+bool GLGizmosManager::flattening_planes_ready() const
+{
+    // The planes are picked up when the gizmo is opened again.
+    if (!m_enabled || m_gizmos.empty() || m_current != Flatten)
+        return false;
+
+    return dynamic_cast<GLGizmoFlatten*>(m_gizmos[Flatten].get())->planes_ready();
+}
+
 void GLGizmosManager::set_sla_support_data(ModelObject* model_object)
 {
     if (!m_enabled || m_gizmos.empty())
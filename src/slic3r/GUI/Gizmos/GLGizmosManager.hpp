@@ -189,6 +189,8 @@ public:
     Vec3d get_flattening_normal() const;
 
     void set_flattening_data(const ModelObject* model_object);
+    // The planes of the flatten gizmo were calculated in the background and they are waiting to be rendered.
+    bool flattening_planes_ready() const;
 
     void set_sla_support_data(ModelObject* model_object);
     bool gizmo_event(SLAGizmoEventType action, const Vec2d& mouse_position = Vec2d::Zero(), bool shift_down = false, bool alt_down = false, bool control_down = false);
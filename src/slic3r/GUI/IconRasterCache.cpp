@@ -0,0 +1,141 @@
+#include "IconRasterCache.hpp"
+
+#include "libslic3r/Utils.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include <boost/filesystem.hpp>
+#include <boost/log/trivial.hpp>
+#include <boost/nowide/fstream.hpp>
+
+namespace Slic3r {
+namespace GUI {
+
+// Bump the version to invalidate the cached rasters, if the rasterization or the file format changes.
+static const uint32_t ICON_RASTER_CACHE_VERSION = 1;
+static const char     ICON_RASTER_CACHE_MAGIC[4] = { 'P', 'S', 'I', 'R' };
+
+struct IconRasterHeader
+{
+    char     magic[4];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+};
+
+// 64bit FNV-1a hash, stable between the runs and the builds of the application.
+static void hash_bytes(uint64_t &hash, const void *data, size_t size)
+{
+    const unsigned char *bytes = reinterpret_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++ i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+}
+
+static void hash_string(uint64_t &hash, const std::string &str)
+{
+    hash_bytes(hash, str.data(), str.size());
+    // Separator, so that the concatenations of different strings hash differently.
+    hash_bytes(hash, "", 1);
+}
+
+static boost::filesystem::path icon_raster_cache_dir()
+{
+    return boost::filesystem::path(data_dir()) / "cache" / "icons";
+}
+
+std::string IconRasterCache::key(const std::vector<std::string> &svg_files, const std::string &params)
+{
+    if (data_dir().empty() || svg_files.empty())
+        return std::string();
+
+    uint64_t hash = 14695981039346656037ull;
+    hash_bytes(hash, &ICON_RASTER_CACHE_VERSION, sizeof(ICON_RASTER_CACHE_VERSION));
+    hash_string(hash, params);
+    try {
+        for (const std::string &file : svg_files) {
+            boost::filesystem::path path(file);
+            if (! boost::filesystem::is_regular_file(path))
+                return std::string();
+            hash_string(hash, file);
+            uint64_t size  = uint64_t(boost::filesystem::file_size(path));
+            int64_t  mtime = int64_t(boost::filesystem::last_write_time(path));
+            hash_bytes(hash, &size, sizeof(size));
+            hash_bytes(hash, &mtime, sizeof(mtime));
+        }
+    } catch (const std::exception &) {
+        return std::string();
+    }
+
+    char buf[17];
+    sprintf(buf, "%016llx", (unsigned long long)hash);
+    return std::string(buf);
+}
+
+bool IconRasterCache::load(const std::string &key, unsigned int &width, unsigned int &height, std::vector<unsigned char> &rgba)
+{
+    if (key.empty())
+        return false;
+
+    boost::nowide::ifstream file((icon_raster_cache_dir() / (key + ".rgba")).string(), std::ios::binary);
+    if (! file.good())
+        return false;
+
+    IconRasterHeader header;
+    if (! file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        ::memcmp(header.magic, ICON_RASTER_CACHE_MAGIC, sizeof(header.magic)) != 0 || header.version != ICON_RASTER_CACHE_VERSION ||
+        header.width == 0 || header.height == 0 || header.width > 16384 || header.height > 16384)
+        return false;
+
+    rgba.resize(size_t(header.width) * size_t(header.height) * 4);
+    if (! file.read(reinterpret_cast<char*>(rgba.data()), std::streamsize(rgba.size()))) {
+        // Truncated file.
+        rgba.clear();
+        return false;
+    }
+
+    width  = header.width;
+    height = header.height;
+    return true;
+}
+
+void IconRasterCache::save(const std::string &key, unsigned int width, unsigned int height, const unsigned char *rgba)
+{
+    if (key.empty() || width == 0 || height == 0)
+        return;
+
+    boost::filesystem::path dir  = icon_raster_cache_dir();
+    boost::filesystem::path path = dir / (key + ".rgba");
+    boost::filesystem::path path_tmp;
+    try {
+        if (! boost::filesystem::exists(dir))
+            boost::filesystem::create_directories(dir);
+        // Write into a temporary file first, so that another instance of the application never reads a partially written raster.
+        path_tmp = dir / boost::filesystem::unique_path(key + ".rgba.%%%%%%%%");
+        {
+            boost::nowide::ofstream file(path_tmp.string(), std::ios::binary);
+            IconRasterHeader header;
+            ::memcpy(header.magic, ICON_RASTER_CACHE_MAGIC, sizeof(header.magic));
+            header.version = ICON_RASTER_CACHE_VERSION;
+            header.width   = width;
+            header.height  = height;
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(rgba), std::streamsize(size_t(width) * size_t(height) * 4));
+            if (! file.good())
+                throw std::runtime_error("Failed writing " + path_tmp.string());
+        }
+        boost::filesystem::rename(path_tmp, path);
+    } catch (const std::exception &ex) {
+        BOOST_LOG_TRIVIAL(debug) << "IconRasterCache: Failed storing the icon raster " << key << ": " << ex.what();
+        if (! path_tmp.empty()) {
+            boost::system::error_code ec;
+            boost::filesystem::remove(path_tmp, ec);
+        }
+    }
+}
+
+} // namespace GUI
+} // namespace Slic3r
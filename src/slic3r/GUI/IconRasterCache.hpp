@@ -0,0 +1,32 @@
+#ifndef slic3r_IconRasterCache_hpp_
+#define slic3r_IconRasterCache_hpp_
+
+#include <string>
+#include <vector>
+
+namespace Slic3r {
+namespace GUI {
+
+// On-disk cache of the RGBA rasters of the icons rasterized from SVG files by nanosvg, stored in data_dir()/cache/icons,
+// so that the icons and the icon atlases are rasterized only once for a given scale and not at each start of the application.
+// A raster is stored in a single file, which is read in one go.
+class IconRasterCache
+{
+public:
+    // Key of a raster rasterized from the SVG files with the given parameters (the size in pixels, the color variants, ...).
+    // The paths, sizes and modification times of the SVG files are hashed, so that a modified icon is rasterized again.
+    // Returns an empty key if any of the files does not exist or if the data directory is not set, which disables the cache.
+    static std::string key(const std::vector<std::string> &svg_files, const std::string &params);
+
+    // Load a raster, returns false on a cache miss.
+    static bool load(const std::string &key, unsigned int &width, unsigned int &height, std::vector<unsigned char> &rgba);
+    // Store a raster, failures are logged and ignored.
+    static void save(const std::string &key, unsigned int width, unsigned int height, const unsigned char *rgba);
+    static void save(const std::string &key, unsigned int width, unsigned int height, const std::vector<unsigned char> &rgba)
+        { save(key, width, height, rgba.data()); }
+};
+
+} // namespace GUI
+} // namespace Slic3r
+
+#endif // slic3r_IconRasterCache_hpp_
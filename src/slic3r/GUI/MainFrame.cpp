@@ -920,7 +920,7 @@ void MainFrame::load_config_file()
         return;
     wxFileDialog dlg(this, _(L("Select configuration to load:")),
         !m_last_config.IsEmpty() ? get_dir_name(m_last_config) : wxGetApp().app_config->get_last_dir(),
-        "config.ini", "INI files (*.ini, *.gcode)|*.ini;*.INI;*.gcode;*.g", wxFD_OPEN | wxFD_FILE_MUST_EXIST);
+        "config.ini", "INI files (*.ini, *.gcode)|*.ini;*.INI;*.gcode;*.g;*.bgcode", wxFD_OPEN | wxFD_FILE_MUST_EXIST);
 	wxString file;
     if (dlg.ShowModal() == wxID_OK)
         file = dlg.GetPath();
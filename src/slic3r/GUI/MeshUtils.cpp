@@ -11,6 +11,8 @@
 
 #include <GL/glew.h>
 
+#include <tbb/parallel_for.h>
+
 
 namespace Slic3r {
 namespace GUI {
@@ -170,10 +172,20 @@ bool MeshRaycaster::unproject_on_mesh(const Vec2d& mouse_pos, const Transform3d&
     pt1 = inv * pt1;
     pt2 = inv * pt2;
 
-    if (! m_AABB_wrapper->m_AABB.intersect_ray(
-        AABBWrapper::MapMatrixXfUnaligned(m_mesh->its.vertices.front().data(), m_mesh->its.vertices.size(), 3),
-        AABBWrapper::MapMatrixXiUnaligned(m_mesh->its.indices.front().data(), m_mesh->its.indices.size(), 3),
-        pt1.cast<float>(), (pt2-pt1).cast<float>(), hits))
+    const AABBWrapper::MapMatrixXfUnaligned V(m_mesh->its.vertices.front().data(), m_mesh->its.vertices.size(), 3);
+    const AABBWrapper::MapMatrixXiUnaligned F(m_mesh->its.indices.front().data(), m_mesh->its.indices.size(), 3);
+
+    if (clipping_plane == nullptr) {
+        // Without a clipping plane only the nearest hit is of interest, the tree traversal prunes the farther boxes.
+        igl::Hit hit;
+        if (! m_AABB_wrapper->m_AABB.intersect_ray(V, F, pt1.cast<float>(), (pt2-pt1).cast<float>(), hit))
+            return false; // no intersection found
+        position = m_AABB_wrapper->get_hit_pos(hit);
+        normal = m_AABB_wrapper->get_hit_normal(hit);
+        return true;
+    }
+
+    if (! m_AABB_wrapper->m_AABB.intersect_ray(V, F, pt1.cast<float>(), (pt2-pt1).cast<float>(), hits))
         return false; // no intersection found
 
     std::sort(hits.begin(), hits.end(), [](const igl::Hit& a, const igl::Hit& b) { return a.t < b.t; });
@@ -203,53 +215,64 @@ bool MeshRaycaster::unproject_on_mesh(const Vec2d& mouse_pos, const Transform3d&
 std::vector<unsigned> MeshRaycaster::get_unobscured_idxs(const Geometry::Transformation& trafo, const Camera& camera, const std::vector<Vec3f>& points,
                                                        const ClippingPlane* clipping_plane) const
 {
-    std::vector<unsigned> out;
-
     const Transform3d& instance_matrix_no_translation_no_scaling = trafo.get_matrix(true,false,true);
     Vec3f direction_to_camera = -camera.get_dir_forward().cast<float>();
     Vec3f direction_to_camera_mesh = (instance_matrix_no_translation_no_scaling.inverse().cast<float>() * direction_to_camera).normalized().eval();
     Vec3f scaling = trafo.get_scaling_factor().cast<float>();
     direction_to_camera_mesh = Vec3f(direction_to_camera_mesh(0)*scaling(0), direction_to_camera_mesh(1)*scaling(1), direction_to_camera_mesh(2)*scaling(2));
     const Transform3f inverse_trafo = trafo.get_matrix().inverse().cast<float>();
-
-    for (size_t i=0; i<points.size(); ++i) {
-        const Vec3f& pt = points[i];
-        if (clipping_plane && clipping_plane->is_point_clipped(pt.cast<double>()))
-            continue;
-
-        bool is_obscured = false;
-        // Cast a ray in the direction of the camera and look for intersection with the mesh:
+    const AABBWrapper::MapMatrixXfUnaligned V(m_mesh->its.vertices.front().data(), m_mesh->its.vertices.size(), 3);
+    const AABBWrapper::MapMatrixXiUnaligned F(m_mesh->its.indices.front().data(), m_mesh->its.indices.size(), 3);
+    if (clipping_plane && ! clipping_plane->is_active())
+        clipping_plane = nullptr;
+
+    // The points are tested independently of each other, the AABB tree is only read.
+    std::vector<char> visible(points.size(), 0);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, points.size()),
+        [this, &points, &trafo, &inverse_trafo, &direction_to_camera_mesh, &V, &F, clipping_plane, &visible](const tbb::blocked_range<size_t>& range) {
         std::vector<igl::Hit> hits;
-        // Offset the start of the ray by EPSILON to account for numerical inaccuracies.
-        if (m_AABB_wrapper->m_AABB.intersect_ray(
-                AABBWrapper::MapMatrixXfUnaligned(m_mesh->its.vertices.front().data(), m_mesh->its.vertices.size(), 3),
-                AABBWrapper::MapMatrixXiUnaligned(m_mesh->its.indices.front().data(), m_mesh->its.indices.size(), 3),
-                inverse_trafo * pt + direction_to_camera_mesh * EPSILON, direction_to_camera_mesh, hits)) {
-
-            std::sort(hits.begin(), hits.end(), [](const igl::Hit& h1, const igl::Hit& h2) { return h1.t < h2.t; });
-
-            // If the closest hit facet normal points in the same direction as the ray,
-            // we are looking through the mesh and should therefore discard the point:
-            if (m_AABB_wrapper->get_hit_normal(hits.front()).dot(direction_to_camera_mesh) > 0.f)
-                is_obscured = true;
-
-            // Eradicate all hits that the caller wants to ignore
-            for (unsigned j=0; j<hits.size(); ++j) {
-                const igl::Hit& hit = hits[j];
-                if (clipping_plane && clipping_plane->is_point_clipped(trafo.get_matrix() * m_AABB_wrapper->get_hit_pos(hit).cast<double>())) {
-                    hits.erase(hits.begin()+j);
-                    --j;
+        for (size_t i = range.begin(); i < range.end(); ++ i) {
+            const Vec3f& pt = points[i];
+            if (clipping_plane && clipping_plane->is_point_clipped(pt.cast<double>()))
+                continue;
+
+            // Offset the start of the ray by EPSILON to account for numerical inaccuracies.
+            Vec3f origin = inverse_trafo * pt + direction_to_camera_mesh * EPSILON;
+            bool is_obscured = false;
+            if (! clipping_plane) {
+                // Any hit obscures the point, the nearest one is enough to find out.
+                igl::Hit hit;
+                is_obscured = m_AABB_wrapper->m_AABB.intersect_ray(V, F, origin, direction_to_camera_mesh, hit);
+            } else {
+                // Cast a ray in the direction of the camera and look for intersection with the mesh:
+                hits.clear();
+                if (m_AABB_wrapper->m_AABB.intersect_ray(V, F, origin, direction_to_camera_mesh, hits)) {
+                    std::sort(hits.begin(), hits.end(), [](const igl::Hit& h1, const igl::Hit& h2) { return h1.t < h2.t; });
+
+                    // If the closest hit facet normal points in the same direction as the ray,
+                    // we are looking through the mesh and should therefore discard the point:
+                    if (m_AABB_wrapper->get_hit_normal(hits.front()).dot(direction_to_camera_mesh) > 0.f)
+                        is_obscured = true;
+
+                    // Eradicate all hits that the caller wants to ignore
+                    hits.erase(std::remove_if(hits.begin(), hits.end(), [this, &trafo, clipping_plane](const igl::Hit& hit)
+                        { return clipping_plane->is_point_clipped(trafo.get_matrix() * m_AABB_wrapper->get_hit_pos(hit).cast<double>()); }),
+                        hits.end());
+
+                    // FIXME: the intersection could in theory be behind the camera, but as of now we only have camera direction.
+                    // Also, the threshold is in mesh coordinates, not in actual dimensions.
+                    if (! hits.empty())
+                        is_obscured = true;
                 }
             }
-
-            // FIXME: the intersection could in theory be behind the camera, but as of now we only have camera direction.
-            // Also, the threshold is in mesh coordinates, not in actual dimensions.
-            if (! hits.empty())
-                is_obscured = true;
+            visible[i] = ! is_obscured;
         }
-        if (! is_obscured)
-            out.push_back(i);
-    }
+    });
+
+    std::vector<unsigned> out;
+    for (size_t i = 0; i < points.size(); ++ i)
+        if (visible[i])
+            out.push_back(unsigned(i));
     return out;
 }
 
@@ -744,11 +744,9 @@ void Mouse3DController::collect_input()
 #endif // ENABLE_3DCONNEXION_DEVICES_DEBUG_OUTPUT
 
     if (updated)
-    {
-        wxGetApp().plater()->set_current_canvas_as_dirty();
-        // ask for an idle event to update 3D scene
+        // Ask for an idle event to update 3D scene. The canvas is not touched from this thread,
+        // its idle handler applies the queued input and renders a single frame for all of it.
         wxWakeUpIdle();
-    }
 }
 
 bool Mouse3DController::handle_packet(const DataPacket& packet)
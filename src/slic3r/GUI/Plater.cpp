@@ -7,6 +7,8 @@
 #include <string>
 #include <regex>
 #include <future>
+#include <atomic>
+#include <chrono>
 #include <boost/algorithm/string.hpp>
 #include <boost/optional.hpp>
 #include <boost/filesystem/path.hpp>
@@ -26,6 +28,7 @@
 #include <wx/colordlg.h>
 #include <wx/numdlg.h>
 #include <wx/debug.h>
+#include <tbb/parallel_for.h>
 
 #include "libslic3r/libslic3r.h"
 #include "libslic3r/Format/STL.hpp"
@@ -2054,6 +2057,8 @@ Plater::priv::priv(Plater *q, MainFrame *main_frame)
 {
     this->q->SetFont(Slic3r::GUI::wxGetApp().normal_font());
 
+    // The G-code is exported repeatedly from the same Print, regenerate just the layers, which changed.
+    fff_print.enable_gcode_layer_cache(true);
     background_process.set_fff_print(&fff_print);
     background_process.set_sla_print(&sla_print);
     background_process.set_gcode_preview_data(&gcode_preview_data);
@@ -2269,6 +2274,13 @@ void Plater::priv::update_ui_from_settings()
 
     view3D->get_canvas3d()->update_ui_from_settings();
     preview->get_canvas3d()->update_ui_from_settings();
+
+    // Stop the background processing before switching the lean mode, it is read by Print::process().
+    bool lean_mode = this->get_config("lean_slicing") == "1";
+    if (fff_print.lean_mode() != lean_mode) {
+        background_process.stop();
+        fff_print.set_lean_mode(lean_mode);
+    }
 }
 
 ProgressStatusBar* Plater::priv::statusbar()
@@ -2311,17 +2323,61 @@ std::vector<size_t> Plater::priv::load_files(const std::vector<fs::path>& input_
     }
 
     const auto loading = _(L("Loading")) + dots;
-    wxProgressDialog dlg(loading, loading);
+    wxProgressDialog dlg(loading, loading, 100, nullptr, wxPD_AUTO_HIDE | wxPD_APP_MODAL | wxPD_CAN_ABORT);
     dlg.Pulse();
 
     auto *new_model = (!load_model || one_by_one) ? nullptr : new Slic3r::Model();
     std::vector<size_t> obj_idxs;
 
+    // Meshes (STL, OBJ, AMF) are read and repaired in parallel on the worker threads, while the progress dialog
+    // is kept responsive. The project archives are loaded by the loop below, as they may change the presets.
+    std::vector<char>        preloaded(input_files.size(), false);
+    std::vector<Model>       preloaded_models(input_files.size());
+    std::vector<std::string> preloaded_errors(input_files.size());
+    {
+        std::vector<size_t> to_preload;
+        for (size_t i = 0; i < input_files.size(); ++ i)
+            if (! std::regex_match(input_files[i].string(), pattern_3mf) && ! std::regex_match(input_files[i].string(), pattern_zip_amf))
+                to_preload.emplace_back(i);
+        if (load_model && to_preload.size() > 1) {
+            std::atomic<size_t> num_loaded(0);
+            std::atomic<bool>   canceled(false);
+            std::future<void>   result = std::async(std::launch::async, [&]() {
+                tbb::parallel_for(tbb::blocked_range<size_t>(0, to_preload.size(), 1),
+                    [&](const tbb::blocked_range<size_t> &range) {
+                    for (size_t j = range.begin(); j < range.end() && ! canceled; ++ j) {
+                        size_t idx = to_preload[j];
+                        try {
+                            Model model = Slic3r::Model::read_from_file(input_files[idx].string(), nullptr, false, load_config);
+                            for (auto obj : model.objects)
+                                if (obj->name.empty())
+                                    obj->name = fs::path(obj->input_file).filename().string();
+                            preloaded_models[idx] = std::move(model);
+                        } catch (const std::exception &e) {
+                            preloaded_errors[idx] = e.what();
+                        }
+                        preloaded[idx] = true;
+                        ++ num_loaded;
+                    }
+                });
+            });
+            while (result.wait_for(std::chrono::milliseconds(100)) != std::future_status::ready)
+                if (! canceled && ! dlg.Update(int(100 * num_loaded / to_preload.size()),
+                        wxString::Format(_(L("Loaded %d of %d input files")), int(num_loaded), int(to_preload.size())) + "\n"))
+                    // Let the files being read finish, the rest is skipped.
+                    canceled = true;
+            result.get();
+            if (canceled)
+                return obj_idxs;
+        }
+    }
+
     for (size_t i = 0; i < input_files.size(); i++) {
         const auto &path = input_files[i];
         const auto filename = path.filename();
         const auto dlg_info = wxString::Format(_(L("Processing input file %s")), from_path(filename)) + "\n";
-        dlg.Update(100 * i / input_files.size(), dlg_info);
+        if (! dlg.Update(100 * i / input_files.size(), dlg_info))
+            break;
 
         const bool type_3mf = std::regex_match(path.string(), pattern_3mf);
         const bool type_zip_amf = !type_3mf && std::regex_match(path.string(), pattern_zip_amf);
@@ -2376,6 +2432,11 @@ std::vector<size_t> Plater::priv::load_files(const std::vector<fs::path>& input_
                     wxGetApp().app_config->update_config_dir(path.parent_path().string());
                 }
             }
+            else if (preloaded[i]) {
+                if (! preloaded_errors[i].empty())
+                    throw std::runtime_error(preloaded_errors[i]);
+                model = std::move(preloaded_models[i]);
+            }
             else {
                 model = Slic3r::Model::read_from_file(path.string(), nullptr, false, load_config);
                 for (auto obj : model.objects)
@@ -2474,9 +2535,12 @@ std::vector<size_t> Plater::priv::load_files(const std::vector<fs::path>& input_
 
         Selection& selection = view3D->get_canvas3d()->get_selection();
         selection.clear();
-        for (size_t idx : obj_idxs)
         {
-            selection.add_object((unsigned int)idx, false);
+            Selection::Batch batch(selection);
+            for (size_t idx : obj_idxs)
+            {
+                selection.add_object((unsigned int)idx, false);
+            }
         }
 
         if (view3D->get_canvas3d()->get_gizmos_manager().is_running())
@@ -2569,8 +2633,9 @@ std::vector<size_t> Plater::priv::load_model_objects(const ModelObjectPtrs &mode
             _(L("Object too large?")));
     }
 
+    // Process the change of selection only once, after the last object is added.
     for (const size_t idx : obj_idxs) {
-        wxGetApp().obj_list()->add_object_to_list(idx);
+        wxGetApp().obj_list()->add_object_to_list(idx, idx == obj_idxs.back());
     }
 
     update();
@@ -3779,15 +3844,7 @@ void Plater::priv::generate_thumbnail(ThumbnailData& data, unsigned int w, unsig
 
 void Plater::priv::generate_thumbnails(ThumbnailsList& thumbnails, const Vec2ds& sizes, bool printable_only, bool parts_only, bool show_bed, bool transparent_background)
 {
-    thumbnails.clear();
-    for (const Vec2d& size : sizes)
-    {
-        thumbnails.push_back(ThumbnailData());
-        Point isize(size); // round to ints
-        generate_thumbnail(thumbnails.back(), isize.x(), isize.y(), printable_only, parts_only, show_bed, transparent_background);
-        if (!thumbnails.back().is_valid())
-            thumbnails.pop_back();
-    }
+    view3D->get_canvas3d()->render_thumbnails(thumbnails, sizes, printable_only, parts_only, show_bed, transparent_background);
 }
 #endif // ENABLE_THUMBNAIL_GENERATOR
 
@@ -4678,6 +4735,7 @@ void Plater::cut(size_t obj_idx, size_t instance_idx, coordf_t z, bool keep_uppe
 
     Selection& selection = p->get_selection();
     size_t last_id = p->model.objects.size() - 1;
+    Selection::Batch batch(selection);
     for (size_t i = 0; i < new_objects.size(); ++i)
     {
         selection.add_object((unsigned int)(last_id - i), i == 0);
@@ -4779,6 +4837,13 @@ void Plater::export_stl(bool extended, bool selection_only)
             mesh.translate(-model_object->origin_translation.cast<float>());
         }
     }
+    else if (! extended || p->printer_technology != ptSLA)
+    {
+        // Stream the transformed meshes of the model into the file without merging them first.
+        Slic3r::store_stl(path_u8.c_str(), &p->model, true);
+        p->statusbar()->set_status_text(wxString::Format(_(L("STL file exported to %s")), path));
+        return;
+    }
     else
     {
         mesh = p->model.mesh();
@@ -22,7 +22,10 @@ void PreferencesDialog::build()
 	m_optgroup_general = std::make_shared<ConfigOptionsGroup>(this, _(L("General")));
 	m_optgroup_general->label_width = 40;
 	m_optgroup_general->m_on_change = [this](t_config_option_key opt_key, boost::any value) {
-		m_values[opt_key] = boost::any_cast<bool>(value) ? "1" : "0";
+		if (opt_key == "threads")
+			m_values[opt_key] = std::to_string(std::max(0, boost::any_cast<int>(value)));
+		else
+			m_values[opt_key] = boost::any_cast<bool>(value) ? "1" : "0";
 	};
 
 	// TODO
@@ -60,6 +63,43 @@ void PreferencesDialog::build()
 	option = Option (def,"background_processing");
 	m_optgroup_general->append_single_option_line(option);
 
+	def.label = L("Save the preview next to the exported G-code");
+	def.type = coBool;
+	def.tooltip = L("If enabled, a snapshot of the G-code preview is saved into a .preview file next to the exported G-code, "
+					  "so that the preview of the G-code may be shown again without slicing. "
+					  "The snapshot is only used as long as the G-code is not modified.");
+	def.set_default_value(new ConfigOptionBool(app_config->get("export_preview_snapshot") == "1"));
+	option = Option (def, "export_preview_snapshot");
+	m_optgroup_general->append_single_option_line(option);
+
+	def.label = L("Cache the slices on disk");
+	def.type = coBool;
+	def.tooltip = L("If enabled, the slices of the objects are stored in the cache folder of the configuration directory, "
+					  "so that reopening a project with large objects does not slice them again. "
+					  "The cache is limited to 1 GB, the least recently used slices are removed first.");
+	def.set_default_value(new ConfigOptionBool(app_config->get("slice_cache") == "1"));
+	option = Option (def, "slice_cache");
+	m_optgroup_general->append_single_option_line(option);
+
+	def.label = L("Release the intermediate slicing data");
+	def.type = coBool;
+	def.tooltip = L("If enabled, the data of the layers not needed for the G-code export are released once the infill "
+					  "and the support material are generated, reducing the memory used by large prints. "
+					  "Changing the infill or the support material settings then generates the perimeters again.");
+	def.set_default_value(new ConfigOptionBool(app_config->get("lean_slicing") == "1"));
+	option = Option (def, "lean_slicing");
+	m_optgroup_general->append_single_option_line(option);
+
+	def.label = L("Maximum number of threads");
+	def.type = coInt;
+	def.tooltip = L("Limit the number of threads used for slicing, exporting and arranging, "
+					  "so that the other applications stay responsive while slicing. 0 uses all the available threads.");
+	def.min = 0;
+	def.set_default_value(new ConfigOptionInt(atoi(app_config->get("threads").c_str())));
+	option = Option (def, "threads");
+	option.opt.width = 6;
+	m_optgroup_general->append_single_option_line(option);
+
 	// Please keep in sync with ConfigWizard
 	def.label = L("Check for application updates");
 	def.type = coBool;
@@ -313,7 +313,20 @@ std::string Preset::label() const
     return this->name + (this->is_dirty ? g_suffix_modified : "");
 }
 
-bool is_compatible_with_print(const PresetWithVendorProfile &preset, const PresetWithVendorProfile &active_print)
+const bool* CompatibleConditionCache::find(const std::string &condition) const
+{
+    auto it = m_results.find(std::make_pair(m_config_hash, condition));
+    return (it == m_results.end()) ? nullptr : &it->second;
+}
+
+void CompatibleConditionCache::insert(const std::string &condition, bool result)
+{
+    if (m_results.size() >= max_size)
+        m_results.clear();
+    m_results.emplace(std::make_pair(m_config_hash, condition), result);
+}
+
+bool is_compatible_with_print(const PresetWithVendorProfile &preset, const PresetWithVendorProfile &active_print, CompatibleConditionCache *cache)
 {
 	if (preset.vendor != nullptr && preset.vendor != active_print.vendor)
 		// The current profile has a vendor assigned and it is different from the active print's vendor.
@@ -322,20 +335,26 @@ bool is_compatible_with_print(const PresetWithVendorProfile &preset, const Prese
     auto *compatible_prints     = dynamic_cast<const ConfigOptionStrings*>(preset.preset.config.option("compatible_prints"));
     bool  has_compatible_prints = compatible_prints != nullptr && ! compatible_prints->values.empty();
     if (! has_compatible_prints && ! condition.empty()) {
+        if (const bool *result = (cache == nullptr) ? nullptr : cache->find(condition))
+            return *result;
+        bool result;
         try {
-            return PlaceholderParser::evaluate_boolean_expression(condition, active_print.preset.config);
+            result = PlaceholderParser::evaluate_boolean_expression(condition, active_print.preset.config);
         } catch (const std::runtime_error &err) {
             //FIXME in case of an error, return "compatible with everything".
             printf("Preset::is_compatible_with_print - parsing error of compatible_prints_condition %s:\n%s\n", active_print.preset.name.c_str(), err.what());
-            return true;
+            result = true;
         }
+        if (cache != nullptr)
+            cache->insert(condition, result);
+        return result;
     }
     return preset.preset.is_default || active_print.preset.name.empty() || ! has_compatible_prints ||
         std::find(compatible_prints->values.begin(), compatible_prints->values.end(), active_print.preset.name) !=
             compatible_prints->values.end();
 }
 
-bool is_compatible_with_printer(const PresetWithVendorProfile &preset, const PresetWithVendorProfile &active_printer, const DynamicPrintConfig *extra_config)
+bool is_compatible_with_printer(const PresetWithVendorProfile &preset, const PresetWithVendorProfile &active_printer, const DynamicPrintConfig *extra_config, CompatibleConditionCache *cache)
 {
 	if (preset.vendor != nullptr && preset.vendor != active_printer.vendor)
 		// The current profile has a vendor assigned and it is different from the active print's vendor.
@@ -344,13 +363,19 @@ bool is_compatible_with_printer(const PresetWithVendorProfile &preset, const Pre
     auto *compatible_printers     = dynamic_cast<const ConfigOptionStrings*>(preset.preset.config.option("compatible_printers"));
     bool  has_compatible_printers = compatible_printers != nullptr && ! compatible_printers->values.empty();
     if (! has_compatible_printers && ! condition.empty()) {
+        if (const bool *result = (cache == nullptr) ? nullptr : cache->find(condition))
+            return *result;
+        bool result;
         try {
-            return PlaceholderParser::evaluate_boolean_expression(condition, active_printer.preset.config, extra_config);
+            result = PlaceholderParser::evaluate_boolean_expression(condition, active_printer.preset.config, extra_config);
         } catch (const std::runtime_error &err) {
             //FIXME in case of an error, return "compatible with everything".
             printf("Preset::is_compatible_with_printer - parsing error of compatible_printers_condition %s:\n%s\n", active_printer.preset.name.c_str(), err.what());
-            return true;
+            result = true;
         }
+        if (cache != nullptr)
+            cache->insert(condition, result);
+        return result;
     }
     return preset.preset.is_default || active_printer.preset.name.empty() || ! has_compatible_printers ||
         std::find(compatible_printers->values.begin(), compatible_printers->values.end(), active_printer.preset.name) !=
@@ -404,7 +429,7 @@ const std::vector<std::string>& Preset::print_options()
         "support_material_synchronize_layers", "support_material_angle", "support_material_interface_layers",
         "support_material_interface_spacing", "support_material_interface_contact_loops", "support_material_contact_distance",
         "support_material_buildplate_only", "dont_support_bridges", "notes", "complete_objects", "extruder_clearance_radius",
-        "extruder_clearance_height", "gcode_comments", "gcode_label_objects", "output_filename_format", "post_process", "perimeter_extruder",
+        "extruder_clearance_height", "gcode_comments", "gcode_label_objects", "arc_fitting", "arc_fitting_tolerance", "binary_gcode", "output_filename_format", "post_process", "perimeter_extruder",
         "infill_extruder", "solid_infill_extruder", "support_material_extruder", "support_material_interface_extruder",
         "ooze_prevention", "standby_temperature_delta", "interface_shells", "extrusion_width", "first_layer_extrusion_width",
         "perimeter_extrusion_width", "external_perimeter_extrusion_width", "infill_extrusion_width", "solid_infill_extrusion_width",
@@ -1000,14 +1025,23 @@ size_t PresetCollection::update_compatible_internal(const PresetWithVendorProfil
     const ConfigOption *opt = active_printer.preset.config.option("nozzle_diameter");
     if (opt)
         config.set_key_value("num_extruders", new ConfigOptionInt((int)static_cast<const ConfigOptionFloats*>(opt)->values.size()));
+    // The conditions are evaluated against the same printer and print configs for all the presets.
+    // Many presets share their conditions, and the results are reused when switching back and forth.
+    {
+        size_t printer_hash = active_printer.preset.config.hash();
+        boost::hash_combine(printer_hash, config.hash());
+        m_compatible_printers_cache.set_config_hash(printer_hash);
+        if (active_print != nullptr)
+            m_compatible_prints_cache.set_config_hash(active_print->preset.config.hash());
+    }
     for (size_t idx_preset = m_num_default_presets; idx_preset < m_presets.size(); ++ idx_preset) {
         bool    selected        = idx_preset == m_idx_selected;
         Preset &preset_selected = m_presets[idx_preset];
         Preset &preset_edited   = selected ? m_edited_preset : preset_selected;
         const PresetWithVendorProfile this_preset_with_vendor_profile = this->get_preset_with_vendor_profile(preset_edited);
-        preset_edited.is_compatible = is_compatible_with_printer(this_preset_with_vendor_profile, active_printer, &config);
+        preset_edited.is_compatible = is_compatible_with_printer(this_preset_with_vendor_profile, active_printer, &config, &m_compatible_printers_cache);
 	    if (active_print != nullptr)
-	        preset_edited.is_compatible &= is_compatible_with_print(this_preset_with_vendor_profile, *active_print);
+	        preset_edited.is_compatible &= is_compatible_with_print(this_preset_with_vendor_profile, *active_print, &m_compatible_prints_cache);
         if (! preset_edited.is_compatible && selected && unselect_if_incompatible)
             m_idx_selected = -1;
         if (selected)
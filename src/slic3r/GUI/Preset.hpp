@@ -247,8 +247,26 @@ protected:
     static std::string  remove_suffix_modified(const std::string &name);
 };
 
-bool is_compatible_with_print  (const PresetWithVendorProfile &preset, const PresetWithVendorProfile &active_print);
-bool is_compatible_with_printer(const PresetWithVendorProfile &preset, const PresetWithVendorProfile &active_printer, const DynamicPrintConfig *extra_config);
+// Memoized results of the compatible_printers_condition / compatible_prints_condition evaluations,
+// keyed by the condition and by a hash of the config the condition was evaluated against.
+class CompatibleConditionCache
+{
+public:
+    // To be called before evaluating the conditions against another config.
+    void        set_config_hash(size_t config_hash) { m_config_hash = config_hash; }
+    // Returns nullptr if the condition was not evaluated against the current config yet.
+    const bool* find(const std::string &condition) const;
+    void        insert(const std::string &condition, bool result);
+
+private:
+    // Limit of the number of memoized results, the cache is cleared once the limit is reached.
+    static constexpr size_t                         max_size = 65536;
+    size_t                                          m_config_hash = 0;
+    std::map<std::pair<size_t, std::string>, bool>  m_results;
+};
+
+bool is_compatible_with_print  (const PresetWithVendorProfile &preset, const PresetWithVendorProfile &active_print, CompatibleConditionCache *cache = nullptr);
+bool is_compatible_with_printer(const PresetWithVendorProfile &preset, const PresetWithVendorProfile &active_printer, const DynamicPrintConfig *extra_config, CompatibleConditionCache *cache = nullptr);
 bool is_compatible_with_printer(const PresetWithVendorProfile &preset, const PresetWithVendorProfile &active_printer);
 
 // Collections of presets of the same type (one of the Print, Filament or Printer type).
@@ -528,6 +546,9 @@ private:
     Preset                  m_edited_preset;
     // Selected preset.
     int                     m_idx_selected;
+    // Memoized evaluations of the compatible_printers_condition / compatible_prints_condition of the presets.
+    CompatibleConditionCache m_compatible_printers_cache;
+    CompatibleConditionCache m_compatible_prints_cache;
     // Is the "- default -" preset suppressed?
     bool                    m_default_suppressed  = true;
     size_t                  m_num_default_presets = 0;
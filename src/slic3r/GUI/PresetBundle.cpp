@@ -200,6 +200,15 @@ void PresetBundle::setup_directories()
 }
 
 void PresetBundle::load_presets(AppConfig &config, const std::string &preferred_model_id)
+{
+    std::string errors_cummulative = this->load_preset_files();
+    if (! errors_cummulative.empty())
+        throw std::runtime_error(errors_cummulative);
+
+    this->load_selections(config, preferred_model_id);
+}
+
+std::string PresetBundle::load_preset_files()
 {
     // First load the vendor specific system presets.
     std::string errors_cummulative = this->load_system_presets();
@@ -239,10 +248,7 @@ void PresetBundle::load_presets(AppConfig &config, const std::string &preferred_
     }
     this->update_multi_material_filament_presets();
     this->update_compatible(false);
-    if (! errors_cummulative.empty())
-        throw std::runtime_error(errors_cummulative);
-
-    this->load_selections(config, preferred_model_id);
+    return errors_cummulative;
 }
 
 // Load system presets into this PresetBundle.
@@ -688,7 +694,7 @@ DynamicPrintConfig PresetBundle::full_sla_config() const
 // If the file is loaded successfully, its print / filament / printer profiles will be activated.
 void PresetBundle::load_config_file(const std::string &path)
 {
-	if (boost::iends_with(path, ".gcode") || boost::iends_with(path, ".g")) {
+	if (boost::iends_with(path, ".gcode") || boost::iends_with(path, ".g") || boost::iends_with(path, ".bgcode")) {
 		DynamicPrintConfig config;
 		config.apply(FullPrintConfig::defaults());
         config.load_from_gcode_file(path);
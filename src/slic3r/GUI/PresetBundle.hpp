@@ -34,6 +34,12 @@ public:
     // Load selections (current print, current filaments, current printer) from config.ini
     // This is done just once on application start up.
     void            load_presets(AppConfig &config, const std::string &preferred_model_id = "");
+    // The two steps of load_presets(), for the application start up to parse the ini files on a worker thread.
+    // load_preset_files() touches neither the AppConfig nor the GUI. It returns the accumulated errors,
+    // load_preset_selections() shall only be called if there are none.
+    std::string     load_preset_files();
+    void            load_preset_selections(AppConfig &config, const std::string &preferred_model_id = "")
+                        { this->load_selections(config, preferred_model_id); }
 
     // Export selections (current print, current filaments, current printer) into config.ini
     void            export_selections(AppConfig &config);
@@ -13,6 +13,8 @@
 
 #include <boost/algorithm/string/predicate.hpp>
 
+#include <tbb/parallel_reduce.h>
+
 static const float UNIFORM_SCALE_COLOR[3] = { 1.0f, 0.38f, 0.0f };
 
 namespace Slic3r {
@@ -1495,6 +1497,12 @@ void Selection::update_valid()
 
 void Selection::update_type()
 {
+    if (m_batch_depth > 0) {
+        m_batch_update_pending = true;
+        return;
+    }
+    m_batch_update_pending = false;
+
     m_cache.content.clear();
     m_type = Mixed;
 
@@ -1774,15 +1782,35 @@ void Selection::do_remove_object(unsigned int object_idx)
     }
 }
 
+// Merges the bounding boxes of the selected volumes returned by bbox_fn, in parallel for large selections.
+template<typename BBoxFn>
+static BoundingBoxf3 merge_volume_bounding_boxes(const Selection::IndicesList &list, BBoxFn bbox_fn)
+{
+    static const size_t PARALLEL_MIN_VOLUMES = 64;
+    BoundingBoxf3 bbox;
+    if (list.size() < PARALLEL_MIN_VOLUMES) {
+        for (unsigned int i : list)
+            bbox.merge(bbox_fn(i));
+    } else {
+        std::vector<unsigned int> idxs(list.begin(), list.end());
+        bbox = tbb::parallel_reduce(tbb::blocked_range<size_t>(0, idxs.size(), PARALLEL_MIN_VOLUMES / 4), BoundingBoxf3(),
+            [&idxs, &bbox_fn](const tbb::blocked_range<size_t> &range, BoundingBoxf3 bbox) {
+                for (size_t i = range.begin(); i < range.end(); ++ i)
+                    bbox.merge(bbox_fn(idxs[i]));
+                return bbox;
+            },
+            [](BoundingBoxf3 bbox1, const BoundingBoxf3 &bbox2) { bbox1.merge(bbox2); return bbox1; });
+    }
+    return bbox;
+}
+
 void Selection::calc_bounding_box() const
 {
     m_bounding_box = BoundingBoxf3();
     if (m_valid)
     {
-        for (unsigned int i : m_list)
-        {
-            m_bounding_box.merge((*m_volumes)[i]->transformed_convex_hull_bounding_box());
-        }
+        // Each volume caches its own transformed convex hull bounding box, thus the volumes may be processed in parallel.
+        m_bounding_box = merge_volume_bounding_boxes(m_list, [this](unsigned int i) { return (*m_volumes)[i]->transformed_convex_hull_bounding_box(); });
     }
 	m_bounding_box_dirty = false;
 }
@@ -1791,14 +1819,14 @@ void Selection::calc_unscaled_instance_bounding_box() const
 {
 	m_unscaled_instance_bounding_box = BoundingBoxf3();
 	if (m_valid) {
-		for (unsigned int i : m_list) {
+		m_unscaled_instance_bounding_box = merge_volume_bounding_boxes(m_list, [this](unsigned int i) {
 			const GLVolume &volume = *(*m_volumes)[i];
             if (volume.is_modifier)
-                continue;
+                return BoundingBoxf3();
 			Transform3d trafo = volume.get_instance_transformation().get_matrix(false, false, true, false) * volume.get_volume_transformation().get_matrix();
 			trafo.translation()(2) += volume.get_sla_shift_z();
-			m_unscaled_instance_bounding_box.merge(volume.transformed_convex_hull_bounding_box(trafo));
-		}
+			return volume.transformed_convex_hull_bounding_box(trafo);
+		});
 	}
 	m_unscaled_instance_bounding_box_dirty = false;
 }
@@ -1807,14 +1835,14 @@ void Selection::calc_scaled_instance_bounding_box() const
 {
     m_scaled_instance_bounding_box = BoundingBoxf3();
     if (m_valid) {
-        for (unsigned int i : m_list) {
+        m_scaled_instance_bounding_box = merge_volume_bounding_boxes(m_list, [this](unsigned int i) {
             const GLVolume &volume = *(*m_volumes)[i];
             if (volume.is_modifier)
-                continue;
+                return BoundingBoxf3();
             Transform3d trafo = volume.get_instance_transformation().get_matrix(false, false, false, false) * volume.get_volume_transformation().get_matrix();
             trafo.translation()(2) += volume.get_sla_shift_z();
-            m_scaled_instance_bounding_box.merge(volume.transformed_convex_hull_bounding_box(trafo));
-        }
+            return volume.transformed_convex_hull_bounding_box(trafo);
+        });
     }
     m_scaled_instance_bounding_box_dirty = false;
 }
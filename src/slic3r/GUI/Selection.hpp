@@ -196,6 +196,9 @@ private:
     mutable bool m_unscaled_instance_bounding_box_dirty;
     mutable BoundingBoxf3 m_scaled_instance_bounding_box;
     mutable bool m_scaled_instance_bounding_box_dirty;
+    // Number of the living Batch objects, update_type() is deferred while non zero.
+    unsigned int m_batch_depth { 0 };
+    bool m_batch_update_pending { false };
 
 #if ENABLE_RENDER_SELECTION_CENTER
     GLUquadricObj* m_quadric;
@@ -223,6 +226,22 @@ public:
     EMode get_mode() const { return m_mode; }
     void set_mode(EMode mode) { m_mode = mode; }
 
+    // Defers the update of the selection type and of the cached content of the selection until the outermost Batch
+    // goes out of scope, so that a sequence of add / remove calls over a large scene updates them once.
+    // The calls made inside a batch should not depend on the selection type, as add() does.
+    class Batch
+    {
+    public:
+        Batch(Selection &selection) : m_selection(selection) { ++ m_selection.m_batch_depth; }
+        ~Batch()
+        {
+            if (-- m_selection.m_batch_depth == 0 && m_selection.m_batch_update_pending)
+                m_selection.update_type();
+        }
+    private:
+        Selection &m_selection;
+    };
+
     void add(unsigned int volume_idx, bool as_single_selection = true, bool check_for_already_contained = false);
     void remove(unsigned int volume_idx);
 
@@ -723,8 +723,12 @@ void Tab::load_config(const DynamicPrintConfig& config)
 void Tab::reload_config()
 {
 //	Freeze();
+    // Only the page being shown is updated right away, the hidden pages are updated once they get selected.
     for (auto page : m_pages)
-        page->reload_config();
+        if (page->IsShown())
+            page->reload_config();
+        else
+            page->reload_postponed = true;
 // 	Thaw();
 }
 
@@ -1222,6 +1226,9 @@ void TabPrint::build()
         optgroup = page->new_optgroup(_(L("Output file")));
         optgroup->append_single_option_line("gcode_comments");
         optgroup->append_single_option_line("gcode_label_objects");
+        optgroup->append_single_option_line("arc_fitting");
+        optgroup->append_single_option_line("arc_fitting_tolerance");
+        optgroup->append_single_option_line("binary_gcode");
         option = optgroup->get_option("output_filename_format");
         option.opt.full_width = true;
         optgroup->append_single_option_line(option);
@@ -2966,6 +2973,8 @@ void Tab::OnTreeSelChange(wxTreeEvent& event)
     #endif
 
     update_undo_buttons();
+    if (page->reload_postponed)
+        page->reload_config();
     page->Show();
 //	if (! page->layout_valid) {
         page->layout_valid = true;
@@ -3265,6 +3274,7 @@ void Page::reload_config()
 {
     for (auto group : m_optgroups)
         group->reload_config();
+    reload_postponed = false;
 }
 
 void Page::update_visibility(ConfigOptionMode mode)
@@ -67,6 +67,8 @@ public:
 
     // Delayed layout after resizing the main window.
     bool 				layout_valid = false;
+    // Delayed reload of the config values into the fields of a hidden page.
+    bool 				reload_postponed = false;
     const std::vector<ScalableBitmap>&   m_mode_bitmap_cache;
 
 public:
@@ -0,0 +1,128 @@
+#include "TextureJobQueue.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace Slic3r {
+namespace GUI {
+
+void TextureJobQueue::Job::cancel()
+{
+    m_canceled = true;
+    std::lock_guard<std::mutex> lock(m_queue.m_mutex);
+    if (m_state == Queued) {
+        // The job will be skipped by the workers.
+        m_state = Finished;
+        m_queue.m_finished_cv.notify_all();
+    }
+}
+
+void TextureJobQueue::Job::wait()
+{
+    std::unique_lock<std::mutex> lock(m_queue.m_mutex);
+    m_queue.m_finished_cv.wait(lock, [this]() { return m_state == Finished; });
+}
+
+bool TextureJobQueue::Job::finished() const
+{
+    std::lock_guard<std::mutex> lock(m_queue.m_mutex);
+    return m_state == Finished;
+}
+
+TextureJobQueue& TextureJobQueue::instance()
+{
+    static TextureJobQueue queue;
+    return queue;
+}
+
+TextureJobQueue::TextureJobQueue()
+{
+    // Leave one core to the UI thread, a few workers are enough for a handful of textures.
+    unsigned int num_threads = std::thread::hardware_concurrency();
+    unsigned int num_workers = std::max(1u, std::min(4u, (num_threads > 1) ? num_threads - 1 : 1u));
+    m_workers.reserve(num_workers);
+    for (unsigned int i = 0; i < num_workers; ++ i)
+        m_workers.emplace_back(&TextureJobQueue::worker, this);
+}
+
+TextureJobQueue::~TextureJobQueue()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+        for (JobPtr &job : m_queue) {
+            job->m_canceled = true;
+            job->m_state    = Job::Finished;
+        }
+        m_queue.clear();
+    }
+    m_queued_cv.notify_all();
+    m_finished_cv.notify_all();
+    for (std::thread &thread : m_workers)
+        thread.join();
+}
+
+// Ordering of the heap of the queued jobs: The job with the highest priority, which was pushed first, is on the top.
+bool TextureJobQueue::job_less(const JobPtr &lhs, const JobPtr &rhs)
+{
+    return lhs->m_priority < rhs->m_priority || (lhs->m_priority == rhs->m_priority && lhs->m_sequence > rhs->m_sequence);
+}
+
+TextureJobQueue::JobPtr TextureJobQueue::push(std::function<void(const Job&)> function, EPriority priority)
+{
+    JobPtr job;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        job = JobPtr(new Job(*this, std::move(function), priority, m_sequence ++));
+        if (m_stop)
+            // Shutting down, the job will never run.
+            job->m_state = Job::Finished;
+        else {
+            m_queue.emplace_back(job);
+            std::push_heap(m_queue.begin(), m_queue.end(), job_less);
+        }
+    }
+    m_queued_cv.notify_one();
+    return job;
+}
+
+void TextureJobQueue::run(size_t num_tasks, std::function<void(size_t)> task, EPriority priority)
+{
+    std::vector<JobPtr> jobs;
+    jobs.reserve(num_tasks);
+    for (size_t i = 0; i < num_tasks; ++ i)
+        jobs.emplace_back(this->push([&task, i](const Job&) { task(i); }, priority));
+    for (JobPtr &job : jobs)
+        job->wait();
+}
+
+void TextureJobQueue::worker()
+{
+    for (;;) {
+        JobPtr job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_queued_cv.wait(lock, [this]() { return m_stop || ! m_queue.empty(); });
+            if (m_stop)
+                return;
+            std::pop_heap(m_queue.begin(), m_queue.end(), job_less);
+            job = std::move(m_queue.back());
+            m_queue.pop_back();
+            if (job->m_state == Job::Finished)
+                // Canceled before being started.
+                continue;
+            job->m_state = Job::Running;
+        }
+        job->m_function(*job);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            job->m_state = Job::Finished;
+            // Release the captured data before the job handle is released by the caller.
+            job->m_function = nullptr;
+        }
+        m_finished_cv.notify_all();
+    }
+}
+
+} // namespace GUI
+} // namespace Slic3r
@@ -0,0 +1,100 @@
+#ifndef slic3r_TextureJobQueue_hpp_
+#define slic3r_TextureJobQueue_hpp_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Slic3r {
+namespace GUI {
+
+// Worker threads shared by the textures for the CPU side of their loading (rasterization of SVG files, compression of the mip levels),
+// so that a texture being loaded does not spawn a thread of its own.
+// The jobs are processed by priority, the jobs of the same priority in the order they were pushed.
+// Only the CPU side runs on the workers, the data is sent to the GPU by the main thread, which owns the OpenGL context.
+class TextureJobQueue
+{
+public:
+    enum EPriority : unsigned char
+    {
+        // Background work, which does not block the UI, for example the compression of the bed textures.
+        Low,
+        Normal,
+        // Work the UI thread is waiting for, for example the rasterization of the toolbar icons.
+        High
+    };
+
+    class Job
+    {
+    public:
+        // Set by cancel(), long running jobs should poll it and return early.
+        bool canceled() const { return m_canceled; }
+        // Cancel the job: A job not yet started will not be started, a running job is asked to stop by canceled().
+        void cancel();
+        // Wait until the job finished or until it was removed from the queue by cancel().
+        void wait();
+        bool finished() const;
+
+    private:
+        enum EState : unsigned char
+        {
+            Queued,
+            Running,
+            Finished
+        };
+
+        Job(TextureJobQueue &queue, std::function<void(const Job&)> function, EPriority priority, uint64_t sequence) :
+            m_queue(queue), m_function(std::move(function)), m_priority(priority), m_sequence(sequence) {}
+
+        TextureJobQueue                  &m_queue;
+        std::function<void(const Job&)>   m_function;
+        EPriority                         m_priority;
+        uint64_t                          m_sequence;
+        std::atomic<bool>                 m_canceled { false };
+        // Guarded by m_queue.m_mutex.
+        EState                            m_state { Queued };
+
+        friend class TextureJobQueue;
+    };
+    using JobPtr = std::shared_ptr<Job>;
+
+    // The shared queue, its worker threads are started on the first use.
+    static TextureJobQueue& instance();
+
+    ~TextureJobQueue();
+
+    // Queue a job, the function receives the job to poll job.canceled().
+    JobPtr push(std::function<void(const Job&)> function, EPriority priority = Normal);
+    // Run task(0) ... task(num_tasks - 1) on the workers and wait for all of them to finish.
+    // This call must not be made from a job.
+    void   run(size_t num_tasks, std::function<void(size_t)> task, EPriority priority = High);
+
+private:
+    TextureJobQueue();
+    TextureJobQueue(const TextureJobQueue&) = delete;
+    TextureJobQueue& operator=(const TextureJobQueue&) = delete;
+
+    void worker();
+    static bool job_less(const JobPtr &lhs, const JobPtr &rhs);
+
+    std::vector<std::thread>  m_workers;
+    std::mutex                m_mutex;
+    // Notified when a job is queued or when the workers are asked to stop.
+    std::condition_variable   m_queued_cv;
+    // Notified when a job finished or when it was canceled before being started.
+    std::condition_variable   m_finished_cv;
+    // Heap of the jobs waiting for a worker, see job_less().
+    std::vector<JobPtr>       m_queue;
+    uint64_t                  m_sequence { 0 };
+    bool                      m_stop { false };
+};
+
+} // namespace GUI
+} // namespace Slic3r
+
+#endif // slic3r_TextureJobQueue_hpp_
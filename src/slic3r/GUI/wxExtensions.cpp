@@ -940,6 +940,7 @@ wxDataViewItem ObjectDataViewModel::AddInstanceChild(const wxDataViewItem& paren
 
     // Add instance nodes
     ObjectDataViewModelNode *instance_node = nullptr;    
+    wxDataViewItemArray instance_items;
     size_t counter = 0;
     while (counter < print_indicator.size()) {
         instance_node = new ObjectDataViewModelNode(inst_root_node, itInstance);
@@ -947,11 +948,11 @@ wxDataViewItem ObjectDataViewModel::AddInstanceChild(const wxDataViewItem& paren
         instance_node->set_printable_icon(print_indicator[counter] ? piPrintable : piUnprintable);
 
         inst_root_node->Append(instance_node);
-        // notify control
-        const wxDataViewItem instance_item((void*)instance_node);
-        ItemAdded(inst_root_item, instance_item);
+        instance_items.Add(wxDataViewItem((void*)instance_node));
         ++counter;
     }
+    // notify control, a single notification for all the instances
+    ItemsAdded(inst_root_item, instance_items);
 
     // update object_node printable property
     UpdateObjectPrintable(parent_item);
@@ -993,13 +994,15 @@ void ObjectDataViewModel::UpdateInstancesPrintable(wxDataViewItem parent_item)
     ObjectDataViewModelNode* inst_root_node = (ObjectDataViewModelNode*)inst_root_item.GetID();
     const size_t child_cnt = inst_root_node->GetChildren().Count();
 
+    wxDataViewItemArray instance_items;
     for (size_t i=0; i < child_cnt; i++)
     {
         ObjectDataViewModelNode* inst_node = inst_root_node->GetNthChild(i);
         // and set printable state for object_node to piUndef
         inst_node->set_printable_icon(obj_pi);
-        ItemChanged(wxDataViewItem((void*)inst_node));
+        instance_items.Add(wxDataViewItem((void*)inst_node));
     }
+    ItemsChanged(instance_items);
 }
 
 bool ObjectDataViewModel::IsPrintable(const wxDataViewItem& item) const
@@ -1250,8 +1253,10 @@ wxDataViewItem ObjectDataViewModel::DeleteLastInstance(const wxDataViewItem &par
         if (i==0) last_inst_printable = last_instance_node->IsPrintable();
         inst_root_node->GetChildren().Remove(last_instance_node);
         delete last_instance_node;
-        ItemDeleted(inst_root_item, wxDataViewItem(last_instance_node));
+        items.Add(wxDataViewItem(last_instance_node));
     }
+    // notify control, a single notification for all the instances
+    ItemsDeleted(inst_root_item, items);
 
     if (delete_inst_root_item) {
         ret_item = parent_item;
@@ -3,6 +3,7 @@
 #include <cstdlib>
 #include <functional>
 #include <thread>
+#include <mutex>
 #include <deque>
 #include <sstream>
 #include <exception>
@@ -30,6 +31,48 @@ class CurlGlobalInit
 	~CurlGlobalInit() { ::curl_global_cleanup(); }
 };
 
+// DNS cache, TLS sessions and (with curl 7.57 and newer) the connection cache shared by all the requests,
+// so that consecutive requests to the same print host don't need to resolve, connect and handshake again.
+class CurlShare
+{
+public:
+	static ::CURLSH* get()
+	{
+		static CurlShare instance;
+		return instance.share;
+	}
+
+private:
+	::CURLSH *share;
+	std::mutex mutexes[CURL_LOCK_DATA_LAST];
+
+	CurlShare() : share(::curl_share_init())
+	{
+		if (share == nullptr) { return; }
+
+		::curl_share_setopt(share, CURLSHOPT_LOCKFUNC, lock_cb);
+		::curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, unlock_cb);
+		::curl_share_setopt(share, CURLSHOPT_USERDATA, static_cast<void*>(this));
+		::curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+		::curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+#if LIBCURL_VERSION_NUM >= 0x073900
+		::curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+	}
+
+	~CurlShare() { if (share != nullptr) { ::curl_share_cleanup(share); } }
+
+	static void lock_cb(::CURL *, curl_lock_data data, curl_lock_access, void *userp)
+	{
+		static_cast<CurlShare*>(userp)->mutexes[data].lock();
+	}
+
+	static void unlock_cb(::CURL *, curl_lock_data data, void *userp)
+	{
+		static_cast<CurlShare*>(userp)->mutexes[data].unlock();
+	}
+};
+
 struct Http::priv
 {
 	enum {
@@ -46,7 +89,9 @@ struct Http::priv
 	// Used for storing file streams added as multipart form parts
 	// Using a deque here because unlike vector it doesn't ivalidate pointers on insertion
 	std::deque<fs::ifstream> form_files;
-	std::string postfields;
+	// File stream of the request body set by set_post_body(), read by curl in chunks
+	std::unique_ptr<fs::ifstream> post_body;
+	size_t post_body_size;
 	std::string error_buffer;    // Used for CURLOPT_ERRORBUFFER
 	size_t limit;
 	bool cancel;
@@ -79,6 +124,7 @@ Http::priv::priv(const std::string &url)
 	, form(nullptr)
 	, form_end(nullptr)
 	, headerlist(nullptr)
+	, post_body_size(0)
 	, error_buffer(CURL_ERROR_SIZE + 1, '\0')
 	, limit(0)
 	, cancel(false)
@@ -91,6 +137,10 @@ Http::priv::priv(const std::string &url)
 	::curl_easy_setopt(curl, CURLOPT_URL, url.c_str());   // curl makes a copy internally
 	::curl_easy_setopt(curl, CURLOPT_USERAGENT, SLIC3R_APP_NAME "/" SLIC3R_VERSION);
 	::curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, &error_buffer.front());
+
+	if (::CURLSH *share = CurlShare::get()) {
+		::curl_easy_setopt(curl, CURLOPT_SHARE, share);
+	}
 }
 
 Http::priv::~priv()
@@ -207,9 +257,12 @@ void Http::priv::form_add_file(const char *name, const fs::path &path, const cha
 
 void Http::priv::set_post_body(const fs::path &path)
 {
-	std::ifstream file(path.string());
-	std::string file_content { std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
-	postfields = file_content;
+	// The body is streamed from the file by form_file_read_cb() instead of being loaded into memory,
+	// the uploaded G-codes may be hundreds of megabytes large.
+	post_body.reset(new fs::ifstream(path, std::ios::in | std::ios::binary));
+	post_body->seekg(0, std::ios::end);
+	post_body_size = post_body->tellg();
+	post_body->seekg(0);
 }
 
 std::string Http::priv::curl_error(CURLcode curlcode)
@@ -256,9 +309,9 @@ void Http::priv::http_perform()
 		::curl_easy_setopt(curl, CURLOPT_HTTPPOST, form);
 	}
 
-	if (!postfields.empty()) {
-		::curl_easy_setopt(curl, CURLOPT_POSTFIELDS, postfields.c_str());
-		::curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, postfields.size());
+	if (post_body) {
+		::curl_easy_setopt(curl, CURLOPT_READDATA, static_cast<void*>(post_body.get()));
+		::curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(post_body_size));
 	}
 
 	CURLcode res = ::curl_easy_perform(curl);
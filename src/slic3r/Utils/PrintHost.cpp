@@ -1,6 +1,10 @@
 #include "PrintHost.hpp"
 
 #include <vector>
+#include <map>
+#include <set>
+#include <mutex>
+#include <atomic>
 #include <thread>
 #include <exception>
 #include <boost/optional.hpp>
@@ -67,33 +71,50 @@ wxString PrintHost::format_error(const std::string &body, const std::string &err
 
 struct PrintHostJobQueue::priv
 {
-    // XXX: comment on how bg thread works
+    // The jobs are dispatched to a background thread per print host (as given by PrintHost::get_host()),
+    // so that uploads to different hosts run in parallel, while the jobs sent to a single host are processed
+    // one after another in the order they were enqueued. A job is identified by its index in the queue dialog,
+    // which is assigned when the job is enqueued.
+
+    struct QueuedJob
+    {
+        size_t id = 0;
+        PrintHostJob job;
+    };
+
+    struct HostWorker
+    {
+        Channel<QueuedJob> channel_jobs;
+        std::thread thread;
+    };
 
     PrintHostJobQueue *q;
 
-    Channel<PrintHostJob> channel_jobs;
-    Channel<size_t> channel_cancels;
-    size_t job_id = 0;
-    int prev_progress = -1;
-    fs::path source_to_remove;
+    // Workers keyed by the host, guarded by workers_mutex.
+    std::map<std::string, std::unique_ptr<HostWorker>> workers;
+    std::mutex workers_mutex;
+    size_t next_job_id = 0;
 
-    std::thread bg_thread;
-    bool bg_exit = false;
+    // Ids of the jobs the user requested to cancel, guarded by cancels_mutex.
+    std::set<size_t> cancels;
+    std::mutex cancels_mutex;
+
+    std::atomic<bool> bg_exit { false };
 
     PrintHostQueueDialog *queue_dialog;
 
     priv(PrintHostJobQueue *q) : q(q) {}
 
-    void emit_progress(int progress);
-    void emit_error(wxString error);
+    void emit_progress(size_t id, int progress);
+    void emit_error(size_t id, wxString error);
     void emit_cancel(size_t id);
-    void start_bg_thread();
-    void stop_bg_thread();
-    void bg_thread_main();
-    void progress_fn(Http::Progress progress, bool &cancel);
+    HostWorker& worker(const std::string &host);
+    void stop_bg_threads();
+    void bg_thread_main(HostWorker &worker);
+    bool take_cancel(size_t id);
+    void progress_fn(size_t id, int &prev_progress, Http::Progress progress, bool &cancel);
     void remove_source(const fs::path &path);
-    void remove_source();
-    void perform_job(PrintHostJob the_job);
+    void perform_job(size_t id, PrintHostJob the_job);
 };
 
 PrintHostJobQueue::PrintHostJobQueue(PrintHostQueueDialog *queue_dialog)
@@ -104,18 +125,18 @@ PrintHostJobQueue::PrintHostJobQueue(PrintHostQueueDialog *queue_dialog)
 
 PrintHostJobQueue::~PrintHostJobQueue()
 {
-    if (p) { p->stop_bg_thread(); }
+    if (p) { p->stop_bg_threads(); }
 }
 
-void PrintHostJobQueue::priv::emit_progress(int progress)
+void PrintHostJobQueue::priv::emit_progress(size_t id, int progress)
 {
-    auto evt = new PrintHostQueueDialog::Event(GUI::EVT_PRINTHOST_PROGRESS, queue_dialog->GetId(), job_id, progress);
+    auto evt = new PrintHostQueueDialog::Event(GUI::EVT_PRINTHOST_PROGRESS, queue_dialog->GetId(), id, progress);
     wxQueueEvent(queue_dialog, evt);
 }
 
-void PrintHostJobQueue::priv::emit_error(wxString error)
+void PrintHostJobQueue::priv::emit_error(size_t id, wxString error)
 {
-    auto evt = new PrintHostQueueDialog::Event(GUI::EVT_PRINTHOST_ERROR, queue_dialog->GetId(), job_id, std::move(error));
+    auto evt = new PrintHostQueueDialog::Event(GUI::EVT_PRINTHOST_ERROR, queue_dialog->GetId(), id, std::move(error));
     wxQueueEvent(queue_dialog, evt);
 }
 
@@ -125,70 +146,94 @@ void PrintHostJobQueue::priv::emit_cancel(size_t id)
     wxQueueEvent(queue_dialog, evt);
 }
 
-void PrintHostJobQueue::priv::start_bg_thread()
+// To be called with workers_mutex locked.
+PrintHostJobQueue::priv::HostWorker& PrintHostJobQueue::priv::worker(const std::string &host)
 {
-    if (bg_thread.joinable()) { return; }
+    auto it = workers.find(host);
+    if (it != workers.end()) { return *it->second; }
 
+    HostWorker &worker = *workers.emplace(host, std::unique_ptr<HostWorker>(new HostWorker())).first->second;
     std::shared_ptr<priv> p2 = q->p;
-    bg_thread = std::thread([p2]() {
-        p2->bg_thread_main();
+    worker.thread = std::thread([p2, &worker]() {
+        p2->bg_thread_main(worker);
     });
+    return worker;
 }
 
-void PrintHostJobQueue::priv::stop_bg_thread()
+void PrintHostJobQueue::priv::stop_bg_threads()
 {
-    if (bg_thread.joinable()) {
-        bg_exit = true;
-        channel_jobs.push(PrintHostJob()); // Push an empty job to wake up bg_thread in case it's sleeping
-        bg_thread.detach();                // Let the background thread go, it should exit on its own
+    bg_exit = true;
+    std::lock_guard<std::mutex> lock(workers_mutex);
+    for (auto &host_worker : workers) {
+        HostWorker &worker = *host_worker.second;
+        if (worker.thread.joinable()) {
+            worker.channel_jobs.push(QueuedJob()); // Push an empty job to wake up the thread in case it's sleeping
+            worker.thread.detach();                // Let the background thread go, it should exit on its own
+        }
     }
 }
 
-void PrintHostJobQueue::priv::bg_thread_main()
+void PrintHostJobQueue::priv::bg_thread_main(HostWorker &worker)
 {
     // bg thread entry point
 
+    size_t id = 0;
+    fs::path source_to_remove;
+
     try {
-        // Pick up jobs from the job channel:
+        // Pick up jobs of this host from its job channel:
         while (! bg_exit) {
-            auto job = channel_jobs.pop();   // Sleeps in a cond var if there are no jobs
-            if (job.empty()) {
+            auto queued = worker.channel_jobs.pop();   // Sleeps in a cond var if there are no jobs
+            if (queued.job.empty()) {
                 // This happens when the thread is being stopped
                 break;
             }
 
+            id = queued.id;
+            PrintHostJob &job = queued.job;
             source_to_remove = job.upload_data.source_path;
 
             BOOST_LOG_TRIVIAL(debug) << boost::format("PrintHostJobQueue/bg_thread: Received job: [%1%]: `%2%` -> `%3%`, cancelled: %4%")
-                % job_id
+                % id
                 % job.upload_data.upload_path
                 % job.printhost->get_host()
                 % job.cancelled;
 
+            if (take_cancel(id)) {
+                job.cancelled = true;
+                emit_cancel(id);
+            }
+
             if (! job.cancelled) {
-                perform_job(std::move(job));
+                perform_job(id, std::move(job));
             }
 
-            remove_source();
-            job_id++;
+            remove_source(source_to_remove);
+            source_to_remove.clear();
         }
     } catch (const std::exception &e) {
-        emit_error(e.what());
+        emit_error(id, e.what());
     }
 
     // Cleanup leftover files, if any
-    remove_source();
-    auto jobs = channel_jobs.lock_rw();
-    for (const PrintHostJob &job : *jobs) {
-        remove_source(job.upload_data.source_path);
+    remove_source(source_to_remove);
+    auto jobs = worker.channel_jobs.lock_rw();
+    for (const QueuedJob &queued : *jobs) {
+        remove_source(queued.job.upload_data.source_path);
     }
 }
 
-void PrintHostJobQueue::priv::progress_fn(Http::Progress progress, bool &cancel)
+bool PrintHostJobQueue::priv::take_cancel(size_t id)
+{
+    std::lock_guard<std::mutex> lock(cancels_mutex);
+    return cancels.erase(id) > 0;
+}
+
+void PrintHostJobQueue::priv::progress_fn(size_t id, int &prev_progress, Http::Progress progress, bool &cancel)
 {
     if (cancel) {
         // When cancel is true from the start, Http indicates request has been cancelled
-        emit_cancel(job_id);
+        emit_cancel(id);
         return;
     }
 
@@ -197,31 +242,14 @@ void PrintHostJobQueue::priv::progress_fn(Http::Progress progress, bool &cancel)
         return;
     }
 
-    if (channel_cancels.size_hint() > 0) {
-        // Lock both queues
-        auto cancels = channel_cancels.lock_rw();
-        auto jobs = channel_jobs.lock_rw();
-
-        for (size_t cancel_id : *cancels) {
-            if (cancel_id == job_id) {
-                cancel = true;
-            } else if (cancel_id > job_id) {
-                const size_t idx = cancel_id - job_id - 1;
-                if (idx < jobs->size()) {
-                    jobs->at(idx).cancelled = true;
-                    BOOST_LOG_TRIVIAL(debug) << boost::format("PrintHostJobQueue: Job id %1% cancelled") % cancel_id;
-                    emit_cancel(cancel_id);
-                }
-            }
-        }
-
-        cancels->clear();
+    if (take_cancel(id)) {
+        cancel = true;
     }
 
     if (! cancel) {
         int gui_progress = progress.ultotal > 0 ? 100*progress.ulnow / progress.ultotal : 0;
         if (gui_progress != prev_progress) {
-            emit_progress(gui_progress);
+            emit_progress(id, gui_progress);
             prev_progress = gui_progress;
         }
     }
@@ -238,38 +266,54 @@ void PrintHostJobQueue::priv::remove_source(const fs::path &path)
     }
 }
 
-void PrintHostJobQueue::priv::remove_source()
+void PrintHostJobQueue::priv::perform_job(size_t id, PrintHostJob the_job)
 {
-    remove_source(source_to_remove);
-    source_to_remove.clear();
-}
-
-void PrintHostJobQueue::priv::perform_job(PrintHostJob the_job)
-{
-    emit_progress(0);   // Indicate the upload is starting
+    emit_progress(id, 0);   // Indicate the upload is starting
 
+    int prev_progress = -1;
     bool success = the_job.printhost->upload(std::move(the_job.upload_data),
-        [this](Http::Progress progress, bool &cancel) { this->progress_fn(std::move(progress), cancel); },
-        [this](wxString error) {
-            emit_error(std::move(error));
+        [this, id, &prev_progress](Http::Progress progress, bool &cancel) { this->progress_fn(id, prev_progress, std::move(progress), cancel); },
+        [this, id](wxString error) {
+            emit_error(id, std::move(error));
         }
     );
 
     if (success) {
-        emit_progress(100);
+        emit_progress(id, 100);
     }
 }
 
 void PrintHostJobQueue::enqueue(PrintHostJob job)
 {
-    p->start_bg_thread();
+    std::lock_guard<std::mutex> lock(p->workers_mutex);
+    priv::HostWorker &worker = p->worker(job.printhost->get_host());
     p->queue_dialog->append_job(job);
-    p->channel_jobs.push(std::move(job));
+    priv::QueuedJob queued;
+    queued.id  = p->next_job_id ++;
+    queued.job = std::move(job);
+    worker.channel_jobs.push(std::move(queued));
 }
 
 void PrintHostJobQueue::cancel(size_t id)
 {
-    p->channel_cancels.push(id);
+    {
+        // A job still waiting in one of the queues is marked as cancelled right away.
+        std::lock_guard<std::mutex> lock(p->workers_mutex);
+        for (auto &host_worker : p->workers) {
+            auto jobs = host_worker.second->channel_jobs.lock_rw();
+            for (priv::QueuedJob &queued : *jobs)
+                if (queued.id == id && ! queued.job.cancelled) {
+                    queued.job.cancelled = true;
+                    BOOST_LOG_TRIVIAL(debug) << boost::format("PrintHostJobQueue: Job id %1% cancelled") % id;
+                    p->emit_cancel(id);
+                    return;
+                }
+        }
+    }
+
+    // Otherwise the job is being uploaded, let its progress callback cancel it.
+    std::lock_guard<std::mutex> lock(p->cancels_mutex);
+    p->cancels.insert(id);
 }
 
 
@@ -103,6 +103,9 @@ public:
 	virtual size_t release_optional() = 0;
 	// Restore optional data possibly released by release_optional.
 	virtual void   restore_optional() = 0;
+	// Serialize and compress an immutable object, which is referenced by the Undo / Redo stack only, and release its shared pointer.
+	// Return the amount of memory released.
+	virtual size_t compact(StackImpl & /* stack */) { return 0; }
 
 	// Estimated size in memory, to be used to drop least recently used snapshots.
 	virtual size_t memsize() const = 0;
@@ -267,6 +270,8 @@ public:
 			const_cast<T*>(m_shared_object.get())->restore_optional();
 	}
 
+	size_t compact(StackImpl &stack) override;
+
 	bool 						is_serialized() const { return m_shared_object.get() == nullptr; }
 	const std::string&			serialized_data() const { return m_serialized; }
 	std::shared_ptr<const T>& 	shared_ptr(StackImpl &stack);
@@ -294,6 +299,8 @@ private:
 	// If this object is optional, then it may be deleted from the Undo / Redo stack and recalculated from other data (for example mesh convex hull).
 	bool 						m_optional;
 	std::string 				m_serialized;
+	// Size of the serialized object before compression, zero if m_serialized is stored uncompressed.
+	size_t 						m_uncompressed_size = 0;
 };
 
 struct MutableHistoryInterval
@@ -723,12 +730,22 @@ namespace cereal
 #include <slic3r/GUI/Selection.hpp>
 #include <slic3r/GUI/Gizmos/GLGizmosManager.hpp>
 
+#include <miniz.h>
+
 namespace Slic3r {
 namespace UndoRedo {
 
 template<typename T> std::shared_ptr<const T>& 	ImmutableObjectHistory<T>::shared_ptr(StackImpl &stack)
 {
 	if (m_shared_object.get() == nullptr && ! this->m_serialized.empty()) {
+		if (m_uncompressed_size > 0) {
+			std::string data(m_uncompressed_size, '\0');
+			mz_ulong data_size = mz_ulong(m_uncompressed_size);
+			if (mz_uncompress((unsigned char*)&data[0], &data_size, (const unsigned char*)m_serialized.data(), mz_ulong(m_serialized.size())) != MZ_OK || data_size != m_uncompressed_size)
+				throw std::runtime_error("Undo / Redo stack: Failed to decompress an object snapshot");
+			m_serialized = std::move(data);
+			m_uncompressed_size = 0;
+		}
 		// Deserialize the object.
 		std::istringstream iss(m_serialized);
 		{
@@ -738,10 +755,45 @@ template<typename T> std::shared_ptr<const T>& 	ImmutableObjectHistory<T>::share
 			archive(*mesh.get());
 			m_shared_object = std::move(mesh);
 		}
+		// The object is captured by the shared pointer again.
+		m_serialized.clear();
+		m_serialized.shrink_to_fit();
 	}
 	return m_shared_object;
 }
 
+template<typename T> size_t ImmutableObjectHistory<T>::compact(StackImpl &stack)
+{
+	// Optional objects are rather released by release_optional(), objects shared with the scene cost nothing.
+	if (m_optional || this->is_serialized() || m_shared_object.use_count() != 1)
+		return 0;
+	size_t memsize_old = this->memsize();
+	std::ostringstream oss;
+	{
+		Slic3r::UndoRedo::OutputArchive archive(stack, oss);
+		archive(*m_shared_object.get());
+	}
+	std::string data = oss.str();
+	if (data.empty())
+		return 0;
+	std::string compressed(size_t(mz_compressBound(mz_ulong(data.size()))), '\0');
+	mz_ulong compressed_size = mz_ulong(compressed.size());
+	if (mz_compress2((unsigned char*)&compressed[0], &compressed_size, (const unsigned char*)data.data(), mz_ulong(data.size()), MZ_BEST_SPEED) == MZ_OK &&
+		compressed_size < data.size()) {
+		compressed.resize(compressed_size);
+		compressed.shrink_to_fit();
+		m_serialized = std::move(compressed);
+		m_uncompressed_size = data.size();
+	} else {
+		// Incompressible data, keep just the serialized object, which is still more compact than the object itself.
+		m_serialized = std::move(data);
+		m_uncompressed_size = 0;
+	}
+	m_shared_object.reset();
+	size_t memsize_new = this->memsize();
+	return (memsize_old > memsize_new) ? memsize_old - memsize_new : 0;
+}
+
 template<typename T> ObjectID StackImpl::save_mutable_object(const T &object)
 {
 	// First find or allocate a history stack for the ObjectID of this object instance.
@@ -791,7 +843,10 @@ template<typename T> std::shared_ptr<const T> StackImpl::load_immutable_object(c
 	auto *object_history = static_cast<ImmutableObjectHistory<T>*>(it_object_history->second.get());
 	assert(object_history->has_snapshot(m_active_snapshot_time));
 	object_history->restore_optional();
-	return object_history->shared_ptr(*this);
+	std::shared_ptr<const T> &ptr = object_history->shared_ptr(*this);
+	// The object may have just been deserialized into a new pointer. Map it to its history, so that the next snapshot extends it.
+	m_shared_ptr_to_object_id.emplace((const void*)ptr.get(), id);
+	return ptr;
 }
 
 template<typename T> void StackImpl::load_mutable_object(const Slic3r::ObjectID id, T &target)
@@ -977,6 +1032,19 @@ void StackImpl::release_least_recently_used()
 		else
 			current_memsize = 0;
 	}
+	// Then compact the immutable objects referenced by the Undo / Redo stack only (the meshes of deleted objects or volumes)
+	// before giving up the oldest snapshots.
+	for (auto it = m_objects.begin(); current_memsize > m_memory_limit && it != m_objects.end(); ++ it) {
+		const void *ptr = it->second->immutable_object_ptr();
+		size_t mem_released = it->second->compact(*this);
+		if (ptr != nullptr && it->second->immutable_object_ptr() == nullptr)
+			// The shared pointer was released, its address may be reused by a new object.
+			m_shared_ptr_to_object_id.erase(ptr);
+		if (current_memsize >= mem_released)
+			current_memsize -= mem_released;
+		else
+			current_memsize = 0;
+	}
 	while (current_memsize > m_memory_limit && m_snapshots.size() >= 3) {
 		// From which side to remove a snapshot?
 		assert(m_snapshots.front().timestamp < m_active_snapshot_time);
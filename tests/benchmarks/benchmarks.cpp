@@ -0,0 +1,272 @@
+// Benchmarks of the slicing stages over the meshes of the tests/data corpus.
+// The stages are timed by the tracing zones of libslic3r, the results are written as JSON:
+//
+//     benchmarks [--output results.json] [--repeat N] [--filter substring]
+//
+// The results of two versions may be compared stage by stage, the times are in milliseconds,
+// the memory is the peak resident memory of the process in bytes at the end of the stage.
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/Model.hpp>
+#include <libslic3r/Print.hpp>
+#include <libslic3r/SLAPrint.hpp>
+#include <libslic3r/Trace.hpp>
+#include <libslic3r/TriangleMesh.hpp>
+#include <libslic3r/Utils.hpp>
+#include <libslic3r/Format/OBJ.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/nowide/cstdio.hpp>
+#include <boost/nowide/fstream.hpp>
+
+using namespace Slic3r;
+
+namespace {
+
+struct BenchmarkConfig
+{
+    const char                                           *name;
+    PrinterTechnology                                     technology;
+    std::vector<std::pair<const char*, const char*>>      options;
+};
+
+// The standard set of configs, applied over the default FFF or SLA config.
+const std::vector<BenchmarkConfig> s_configs {
+    { "fff_default",  ptFFF, {} },
+    { "fff_fine",     ptFFF, { { "layer_height", "0.1" }, { "first_layer_height", "0.1" }, { "perimeters", "3" }, { "fill_density", "40%" } } },
+    { "fff_supports", ptFFF, { { "support_material", "1" }, { "raft_layers", "2" } } },
+    { "sla_default",  ptSLA, {} },
+};
+
+// The curated corpus, meshes of tests/data. The small meshes are printed in several instances.
+struct BenchmarkMesh
+{
+    const char *file;
+    size_t      instances;
+};
+const std::vector<BenchmarkMesh> s_meshes {
+    { "20mm_cube.obj",              4 },
+    { "pyramid.obj",                4 },
+    { "overhang.obj",               2 },
+    { "bridge.obj",                 2 },
+    { "ipadstand.obj",              1 },
+    { "cube_with_concave_hole.obj", 2 },
+    { "A.obj",                      1 },
+    { "extruder_idler.obj",         1 },
+    { "frog_legs.obj",              1 },
+};
+
+// Tracing zones of the slicing steps reported as stages, in the order of processing.
+const std::vector<std::pair<const char*, const char*>> s_stage_zones {
+    { "slice",             "PrintObject::slice" },
+    { "perimeters",        "PrintObject::make_perimeters" },
+    { "prepare_infill",    "PrintObject::prepare_infill" },
+    { "infill",            "PrintObject::infill" },
+    { "support",           "PrintObject::generate_support_material" },
+    { "skirt",             "Print::make_skirt" },
+    { "brim",              "Print::make_brim" },
+    { "wipe_tower",        "Print::make_wipe_tower" },
+    { "gcode_export",      "Print::export_gcode" },
+    { "sla_slice",         "SLAPrintObject::slice" },
+    { "sla_support_points","SLAPrintObject::support_points" },
+    { "sla_support_tree",  "SLAPrintObject::support_tree" },
+    { "sla_pad",           "SLAPrintObject::pad" },
+    { "sla_slice_supports","SLAPrintObject::slice_supports" },
+    { "sla_merge_slices",  "SLAPrint::merge_slices_and_eval" },
+    { "sla_rasterize",     "SLAPrint::rasterize" },
+};
+
+struct StageResult
+{
+    std::string name;
+    double      wall_ms     = 0.;
+    double      cpu_ms      = 0.;
+    size_t      peak_memory = 0;
+};
+
+struct CaseResult
+{
+    std::string              mesh;
+    std::string              config;
+    size_t                   run = 0;
+    std::vector<StageResult> stages;
+    double                   total_ms = 0.;
+};
+
+double elapsed_ms(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Time a stage outside of the tracing zones of libslic3r.
+void time_stage(CaseResult &result, const char *name, const std::function<void()> &fn)
+{
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    StageResult stage;
+    stage.name    = name;
+    stage.wall_ms = elapsed_ms(start);
+    result.stages.emplace_back(std::move(stage));
+}
+
+DynamicPrintConfig make_config(const BenchmarkConfig &bconfig)
+{
+    DynamicPrintConfig config;
+    if (bconfig.technology == ptFFF)
+        config = DynamicPrintConfig::full_print_config();
+    else {
+        config.apply(SLAFullPrintConfig::defaults());
+        config.set_key_value("printer_technology", new ConfigOptionEnum<PrinterTechnology>(ptSLA));
+    }
+    for (const std::pair<const char*, const char*> &opt : bconfig.options)
+        config.set_deserialize(opt.first, opt.second);
+    return config;
+}
+
+CaseResult run_case(const std::string &data_dir, const BenchmarkMesh &bmesh, const BenchmarkConfig &bconfig, size_t run)
+{
+    CaseResult result;
+    result.mesh   = bmesh.file;
+    result.config = bconfig.name;
+    result.run    = run;
+    auto start    = std::chrono::steady_clock::now();
+
+    TriangleMesh mesh;
+    const std::string path = (boost::filesystem::path(data_dir) / bmesh.file).string();
+    time_stage(result, "load", [&mesh, &path]() {
+        if (! load_obj(path.c_str(), &mesh))
+            throw std::runtime_error("Failed to load " + path);
+    });
+    time_stage(result, "repair", [&mesh]() { mesh.repair(); });
+
+    DynamicPrintConfig config = make_config(bconfig);
+    Model model;
+    ModelObject *object = model.add_object();
+    object->name = bmesh.file;
+    object->add_volume(std::move(mesh));
+    for (size_t i = 0; i < bmesh.instances; ++ i)
+        object->add_instance();
+
+    tracing::start(std::string());
+    try {
+        model.arrange_objects(PrintConfig::min_object_distance(&config));
+        model.center_instances_around_point(Vec2d(100, 100));
+        object->ensure_on_bed();
+        if (bconfig.technology == ptFFF) {
+            Print print;
+            print.auto_assign_extruders(object);
+            print.apply(model, config);
+            std::string err = print.validate();
+            if (! err.empty())
+                throw std::runtime_error(err);
+            print.set_status_silent();
+            print.process();
+            boost::filesystem::path temp = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+            print.export_gcode(temp.string(), nullptr);
+            boost::nowide::remove(temp.string().c_str());
+        } else {
+            SLAPrint print;
+            print.apply(model, config);
+            std::string err = print.validate();
+            if (! err.empty())
+                throw std::runtime_error(err);
+            print.set_status_silent();
+            print.process();
+        }
+    } catch (...) {
+        tracing::stop();
+        throw;
+    }
+    std::vector<tracing::ZoneSummary> zones = tracing::stop();
+
+    for (const std::pair<const char*, const char*> &stage_zone : s_stage_zones)
+        for (const tracing::ZoneSummary &zone : zones)
+            if (zone.name == stage_zone.second) {
+                StageResult stage;
+                stage.name        = stage_zone.first;
+                stage.wall_ms     = zone.wall_ms;
+                stage.cpu_ms      = zone.cpu_ms;
+                stage.peak_memory = zone.peak_memory;
+                result.stages.emplace_back(std::move(stage));
+                break;
+            }
+    result.total_ms = elapsed_ms(start);
+    return result;
+}
+
+void write_json(std::ostream &out, const std::vector<CaseResult> &results)
+{
+    out << "{\n  \"version\": \"" << SLIC3R_VERSION << "\",\n  \"cases\": [\n";
+    for (size_t i = 0; i < results.size(); ++ i) {
+        const CaseResult &r = results[i];
+        out << "    { \"mesh\": \"" << r.mesh << "\", \"config\": \"" << r.config << "\", \"run\": " << r.run << ", \"total_ms\": " << r.total_ms << ", \"stages\": {";
+        for (size_t j = 0; j < r.stages.size(); ++ j) {
+            const StageResult &s = r.stages[j];
+            out << (j == 0 ? "\n" : ",\n") << "        \"" << s.name << "\": { \"wall_ms\": " << s.wall_ms << ", \"cpu_ms\": " << s.cpu_ms << ", \"peak_memory\": " << s.peak_memory << " }";
+        }
+        out << " } }" << ((i + 1 < results.size()) ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string output;
+    std::string filter;
+    size_t      repeat = 1;
+    for (int i = 1; i < argc; ++ i) {
+        if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+            output = argv[++ i];
+        else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+            repeat = std::max(1, atoi(argv[++ i]));
+        else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+            filter = argv[++ i];
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--output results.json] [--repeat N] [--filter substring]" << std::endl;
+            return 1;
+        }
+    }
+
+    // Only report errors of the slicer.
+    set_logging_level(1);
+
+    std::vector<CaseResult> results;
+    for (const BenchmarkConfig &bconfig : s_configs)
+        for (const BenchmarkMesh &bmesh : s_meshes) {
+            std::string case_name = std::string(bmesh.file) + ":" + bconfig.name;
+            if (! filter.empty() && case_name.find(filter) == std::string::npos)
+                continue;
+            for (size_t run = 0; run < repeat; ++ run) {
+                try {
+                    results.emplace_back(run_case(TEST_DATA_DIR, bmesh, bconfig, run));
+                    std::cerr << case_name << " run " << run << ": " << results.back().total_ms << "ms" << std::endl;
+                } catch (const std::exception &ex) {
+                    std::cerr << case_name << " failed: " << ex.what() << std::endl;
+                    return 1;
+                }
+            }
+        }
+
+    if (output.empty())
+        write_json(std::cout, results);
+    else {
+        boost::nowide::ofstream out(output);
+        write_json(out, results);
+        if (! out) {
+            std::cerr << "Failed to write " << output << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
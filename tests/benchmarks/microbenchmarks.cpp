@@ -0,0 +1,334 @@
+// Throughput of the geometry kernels on layer data of real models.
+//
+//     microbenchmarks --capture layers.bin model.obj [layer_height]
+//         Slices the model and serializes the layers into layers.bin.
+//     microbenchmarks [--repeat N] [--output results.json] layers.bin ...
+//         Replays the kernels on the captured layers and writes the results as JSON.
+//
+// Without any layer file, the corpus of tests/data is captured into the temp directory first.
+// The layers are serialized once, thus the kernels of two versions are compared on the very same data.
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/ClipperUtils.hpp>
+#include <libslic3r/EdgeGrid.hpp>
+#include <libslic3r/ExPolygon.hpp>
+#include <libslic3r/ExtrusionEntity.hpp>
+#include <libslic3r/ShortestPath.hpp>
+#include <libslic3r/TriangleMesh.hpp>
+#include <libslic3r/Utils.hpp>
+#include <libslic3r/Format/OBJ.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/nowide/fstream.hpp>
+
+using namespace Slic3r;
+
+namespace {
+
+const char   s_magic[]   = "SLIC3R_LAYERS_1";
+// Meshes of tests/data captured when no layer file is given.
+const char  *s_corpus[]  = { "extruder_idler.obj", "frog_legs.obj", "A.obj", "ipadstand.obj" };
+
+struct CapturedLayers
+{
+    // The mesh the layers were sliced from, relative to the directory of the layers file or absolute.
+    std::string              mesh_path;
+    std::vector<float>       zs;
+    std::vector<ExPolygons>  layers;
+};
+
+template<typename T> void write_pod(std::ostream &out, const T &value) { out.write(reinterpret_cast<const char*>(&value), sizeof(T)); }
+template<typename T> T read_pod(std::istream &in)
+{
+    T value;
+    if (! in.read(reinterpret_cast<char*>(&value), sizeof(T)))
+        throw std::runtime_error("Unexpected end of the layers file");
+    return value;
+}
+
+void write_points(std::ostream &out, const Points &pts)
+{
+    write_pod<uint32_t>(out, uint32_t(pts.size()));
+    for (const Point &pt : pts) {
+        write_pod<int32_t>(out, int32_t(pt.x()));
+        write_pod<int32_t>(out, int32_t(pt.y()));
+    }
+}
+
+Points read_points(std::istream &in)
+{
+    Points pts(read_pod<uint32_t>(in));
+    for (Point &pt : pts) {
+        pt.x() = read_pod<int32_t>(in);
+        pt.y() = read_pod<int32_t>(in);
+    }
+    return pts;
+}
+
+void save_layers(const std::string &path, const CapturedLayers &captured)
+{
+    boost::nowide::ofstream out(path, std::ios::binary);
+    out.write(s_magic, sizeof(s_magic));
+    write_pod<uint32_t>(out, uint32_t(captured.mesh_path.size()));
+    out.write(captured.mesh_path.data(), captured.mesh_path.size());
+    write_pod<uint32_t>(out, uint32_t(captured.layers.size()));
+    for (size_t i = 0; i < captured.layers.size(); ++ i) {
+        write_pod<float>(out, captured.zs[i]);
+        write_pod<uint32_t>(out, uint32_t(captured.layers[i].size()));
+        for (const ExPolygon &expoly : captured.layers[i]) {
+            write_pod<uint32_t>(out, uint32_t(expoly.holes.size()));
+            write_points(out, expoly.contour.points);
+            for (const Polygon &hole : expoly.holes)
+                write_points(out, hole.points);
+        }
+    }
+    if (! out)
+        throw std::runtime_error("Failed to write " + path);
+}
+
+CapturedLayers load_layers(const std::string &path)
+{
+    boost::nowide::ifstream in(path, std::ios::binary);
+    char magic[sizeof(s_magic)];
+    if (! in.read(magic, sizeof(magic)) || memcmp(magic, s_magic, sizeof(s_magic)) != 0)
+        throw std::runtime_error("Not a layers file: " + path);
+    CapturedLayers captured;
+    captured.mesh_path.assign(read_pod<uint32_t>(in), ' ');
+    in.read(&captured.mesh_path.front(), captured.mesh_path.size());
+    size_t num_layers = read_pod<uint32_t>(in);
+    captured.zs.reserve(num_layers);
+    captured.layers.assign(num_layers, ExPolygons());
+    for (ExPolygons &layer : captured.layers) {
+        captured.zs.emplace_back(read_pod<float>(in));
+        layer.assign(read_pod<uint32_t>(in), ExPolygon());
+        for (ExPolygon &expoly : layer) {
+            expoly.holes.assign(read_pod<uint32_t>(in), Polygon());
+            expoly.contour.points = read_points(in);
+            for (Polygon &hole : expoly.holes)
+                hole.points = read_points(in);
+        }
+    }
+    return captured;
+}
+
+TriangleMesh load_mesh(const std::string &path)
+{
+    TriangleMesh mesh;
+    if (! load_obj(path.c_str(), &mesh))
+        throw std::runtime_error("Failed to load " + path);
+    mesh.repair();
+    return mesh;
+}
+
+std::vector<float> layer_zs(const TriangleMesh &mesh, float layer_height)
+{
+    BoundingBoxf3 bb = mesh.bounding_box();
+    std::vector<float> zs;
+    for (double z = bb.min.z() + 0.5 * layer_height; z < bb.max.z(); z += layer_height)
+        zs.emplace_back(float(z));
+    return zs;
+}
+
+CapturedLayers capture(const std::string &mesh_path, float layer_height)
+{
+    CapturedLayers captured;
+    captured.mesh_path = boost::filesystem::absolute(mesh_path).string();
+    TriangleMesh mesh = load_mesh(mesh_path);
+    captured.zs = layer_zs(mesh, layer_height);
+    TriangleMeshSlicer slicer(&mesh);
+    slicer.slice(captured.zs, 0.049f, &captured.layers, [](){});
+    return captured;
+}
+
+struct KernelResult
+{
+    std::string kernel;
+    size_t      iterations = 0;
+    double      total_ms   = 0.;
+    double      min_ms     = 0.;
+};
+
+KernelResult run_kernel(const char *name, size_t repeat, const std::function<void()> &fn)
+{
+    KernelResult result;
+    result.kernel = name;
+    result.min_ms = std::numeric_limits<double>::max();
+    for (size_t i = 0; i < repeat; ++ i) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        result.total_ms += ms;
+        result.min_ms    = std::min(result.min_ms, ms);
+        ++ result.iterations;
+    }
+    return result;
+}
+
+std::vector<KernelResult> replay(const CapturedLayers &captured, const std::string &layers_path, size_t repeat)
+{
+    std::vector<KernelResult> results;
+    // Sum of the outputs, so that the optimizer could not drop the calls.
+    size_t checksum = 0;
+
+    std::vector<Polygons> layer_polygons;
+    layer_polygons.reserve(captured.layers.size());
+    for (const ExPolygons &layer : captured.layers)
+        layer_polygons.emplace_back(to_polygons(layer));
+
+    const float delta = float(scale_(0.2));
+    results.emplace_back(run_kernel("offset", repeat, [&]() {
+        for (const Polygons &polygons : layer_polygons)
+            checksum += offset(polygons, - delta).size();
+    }));
+    results.emplace_back(run_kernel("offset2_ex", repeat, [&]() {
+        for (const ExPolygons &layer : captured.layers)
+            checksum += offset2_ex(layer, - delta, delta).size();
+    }));
+    results.emplace_back(run_kernel("union_ex", repeat, [&]() {
+        for (const Polygons &polygons : layer_polygons)
+            checksum += union_ex(polygons).size();
+    }));
+    results.emplace_back(run_kernel("EdgeGrid::Grid::create", repeat, [&]() {
+        for (const ExPolygons &layer : captured.layers) {
+            EdgeGrid::Grid grid;
+            grid.create(layer, coord_t(scale_(1.)));
+            checksum += grid.rows();
+        }
+    }));
+
+    // Perimeter like extrusions of the layer contours to be chained.
+    std::vector<ExtrusionPaths> layer_paths;
+    layer_paths.reserve(captured.layers.size());
+    for (const Polygons &polygons : layer_polygons) {
+        ExtrusionPaths paths;
+        for (const Polygon &polygon : polygons) {
+            paths.emplace_back(erPerimeter, 0.05, 0.45f, 0.2f);
+            paths.back().polyline = polygon.split_at_first_point();
+        }
+        layer_paths.emplace_back(std::move(paths));
+    }
+    results.emplace_back(run_kernel("chain_extrusion_entities", repeat, [&]() {
+        for (ExtrusionPaths &paths : layer_paths) {
+            std::vector<ExtrusionEntity*> entities;
+            entities.reserve(paths.size());
+            for (ExtrusionPath &path : paths)
+                entities.emplace_back(&path);
+            checksum += chain_extrusion_entities(entities).size();
+        }
+    }));
+    results.emplace_back(run_kernel("ExPolygon::medial_axis", repeat, [&]() {
+        for (const ExPolygons &layer : captured.layers)
+            for (const ExPolygon &expoly : layer) {
+                Polylines polylines;
+                expoly.medial_axis(scale_(1.), scale_(0.1), &polylines);
+                checksum += polylines.size();
+            }
+    }));
+
+    boost::filesystem::path mesh_path(captured.mesh_path);
+    if (mesh_path.is_relative())
+        mesh_path = boost::filesystem::path(layers_path).parent_path() / mesh_path;
+    if (boost::filesystem::exists(mesh_path)) {
+        TriangleMesh mesh = load_mesh(mesh_path.string());
+        TriangleMeshSlicer slicer(&mesh);
+        results.emplace_back(run_kernel("TriangleMeshSlicer::slice", repeat, [&]() {
+            std::vector<ExPolygons> layers;
+            slicer.slice(captured.zs, 0.049f, &layers, [](){});
+            checksum += layers.size();
+        }));
+    } else
+        std::cerr << "Mesh " << mesh_path.string() << " not found, TriangleMeshSlicer::slice is not measured" << std::endl;
+
+    std::cerr << layers_path << ": checksum " << checksum << std::endl;
+    return results;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::vector<std::string> layer_files;
+    std::string              output;
+    size_t                   repeat = 5;
+    for (int i = 1; i < argc; ++ i) {
+        if (strcmp(argv[i], "--capture") == 0 && i + 2 < argc) {
+            std::string out_path  = argv[++ i];
+            std::string mesh_path = argv[++ i];
+            float layer_height = (i + 1 < argc) ? float(atof(argv[i + 1])) : 0.f;
+            if (layer_height > 0.f)
+                ++ i;
+            else
+                layer_height = 0.2f;
+            try {
+                save_layers(out_path, capture(mesh_path, layer_height));
+            } catch (const std::exception &ex) {
+                std::cerr << ex.what() << std::endl;
+                return 1;
+            }
+            return 0;
+        } else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+            repeat = std::max(1, atoi(argv[++ i]));
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+            output = argv[++ i];
+        else if (argv[i][0] == '-') {
+            std::cerr << "Usage: " << argv[0] << " --capture layers.bin model.obj [layer_height]" << std::endl
+                      << "       " << argv[0] << " [--repeat N] [--output results.json] [layers.bin ...]" << std::endl;
+            return 1;
+        } else
+            layer_files.emplace_back(argv[i]);
+    }
+
+    set_logging_level(1);
+
+    try {
+        if (layer_files.empty()) {
+            // Capture the default corpus once, the following runs replay it.
+            boost::filesystem::path dir = boost::filesystem::temp_directory_path() / "slic3r_microbenchmarks";
+            boost::filesystem::create_directories(dir);
+            for (const char *mesh : s_corpus) {
+                boost::filesystem::path layers_path = dir / (std::string(mesh) + ".layers");
+                if (! boost::filesystem::exists(layers_path))
+                    save_layers(layers_path.string(), capture((boost::filesystem::path(TEST_DATA_DIR) / mesh).string(), 0.2f));
+                layer_files.emplace_back(layers_path.string());
+            }
+        }
+
+        std::string json = "{\n  \"version\": \"" SLIC3R_VERSION "\",\n  \"datasets\": [\n";
+        for (size_t i = 0; i < layer_files.size(); ++ i) {
+            CapturedLayers captured = load_layers(layer_files[i]);
+            std::vector<KernelResult> results = replay(captured, layer_files[i], repeat);
+            json += "    { \"layers\": \"" + boost::filesystem::path(layer_files[i]).filename().string() + "\", \"num_layers\": " + std::to_string(captured.layers.size()) + ", \"kernels\": {";
+            for (size_t j = 0; j < results.size(); ++ j) {
+                const KernelResult &r = results[j];
+                json += (j == 0 ? "\n" : ",\n");
+                json += "        \"" + r.kernel + "\": { \"iterations\": " + std::to_string(r.iterations) +
+                        ", \"mean_ms\": " + std::to_string(r.total_ms / double(r.iterations)) + ", \"min_ms\": " + std::to_string(r.min_ms) + " }";
+            }
+            json += std::string(" } }") + ((i + 1 < layer_files.size()) ? ",\n" : "\n");
+        }
+        json += "  ]\n}\n";
+
+        if (output.empty())
+            std::cout << json;
+        else {
+            boost::nowide::ofstream out(output);
+            out << json;
+            if (! out)
+                throw std::runtime_error("Failed to write " + output);
+        }
+    } catch (const std::exception &ex) {
+        std::cerr << ex.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
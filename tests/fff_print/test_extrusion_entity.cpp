@@ -83,3 +83,57 @@ SCENARIO("ExtrusionEntityCollection: Polygon flattening", "[ExtrusionEntity]") {
         }
     }
 }
+
+SCENARIO("ExtrusionEntityCollection: Chained path order", "[ExtrusionEntity]") {
+    srand(0xDEADBEEF); // consistent seed for test reproducibility.
+
+    GIVEN("A collection of random paths of two roles") {
+        Slic3r::ExtrusionPaths paths = random_paths(20);
+        for (size_t i = 0; i < paths.size(); i += 3)
+            paths[i] = ExtrusionPath(paths[i].polyline, ExtrusionPath(erSupportMaterialInterface, 1.0, 1.0, 1.0));
+        Slic3r::ExtrusionEntityCollection collection;
+        collection.append(paths);
+        std::vector<std::pair<Point, Point>> end_points;
+        for (const ExtrusionEntity *ee : collection.entities)
+            end_points.emplace_back(ee->first_point(), ee->last_point());
+        const Point start_near(-20, 30);
+
+        WHEN("The order of all the entities is calculated") {
+            std::vector<std::pair<size_t, bool>> order = collection.chained_path_order(start_near);
+            Slic3r::ExtrusionEntityCollection chained = collection.chained_path_from(start_near);
+            THEN("The order matches the chained copy of the collection") {
+                REQUIRE(order.size() == chained.entities.size());
+                for (size_t i = 0; i < order.size(); ++ i) {
+                    const ExtrusionEntity *ee = collection.entities[order[i].first];
+                    CHECK((order[i].second ? ee->last_point() : ee->first_point()) == chained.entities[i]->first_point());
+                    CHECK((order[i].second ? ee->first_point() : ee->last_point()) == chained.entities[i]->last_point());
+                }
+            }
+            AND_THEN("The entities of the collection are not modified") {
+                for (size_t i = 0; i < collection.entities.size(); ++ i) {
+                    CHECK(collection.entities[i]->first_point() == end_points[i].first);
+                    CHECK(collection.entities[i]->last_point() == end_points[i].second);
+                }
+            }
+        }
+        WHEN("The order of the entities of a single role is calculated") {
+            std::vector<std::pair<size_t, bool>> order = collection.chained_path_order(start_near, erSupportMaterialInterface);
+            THEN("Only the entities of that role are ordered") {
+                CHECK(order.size() == 7);
+                for (const std::pair<size_t, bool> &idx : order)
+                    CHECK(collection.entities[idx.first]->role() == erSupportMaterialInterface);
+            }
+        }
+        WHEN("The collection is marked as no-sort") {
+            collection.no_sort = true;
+            std::vector<std::pair<size_t, bool>> order = collection.chained_path_order(start_near);
+            THEN("The original order is kept and no entity is reversed") {
+                REQUIRE(order.size() == collection.entities.size());
+                for (size_t i = 0; i < order.size(); ++ i) {
+                    CHECK(order[i].first == i);
+                    CHECK(! order[i].second);
+                }
+            }
+        }
+    }
+}
@@ -190,6 +190,49 @@ TEST_CASE("Fill: Pattern Path Length", "[Fill]") {
     }
 }
 
+TEST_CASE("Fill: Concentric loops of a square with a hole", "[Fill]") {
+    std::unique_ptr<Slic3r::Fill> filler(Slic3r::Fill::new_from_type("concentric"));
+    filler->spacing = 1.;
+    FillParams fill_params;
+    fill_params.density = 0.2f;
+    fill_params.dont_adjust = true;
+    ExPolygon expolygon(
+        Points{ Point::new_scale(0, 0), Point::new_scale(100, 0), Point::new_scale(100, 100), Point::new_scale(0, 100) },
+        Points{ Point::new_scale(25, 25), Point::new_scale(25, 75), Point::new_scale(75, 75), Point::new_scale(75, 25) });
+    Slic3r::Surface surface(stTop, expolygon);
+    Slic3r::Polylines paths = filler->fill_surface(&surface, fill_params);
+    // three loops around the hole and three loops along the contour, 5mm apart
+    REQUIRE(paths.size() == 6);
+    REQUIRE(diff_pl(paths, offset(expolygon, float(SCALED_EPSILON * 10))).empty());
+    // the loops are ordered from the innermost, the loops around the hole are shorter than the loops along the contour
+    for (size_t i = 1; i < paths.size(); ++ i)
+        REQUIRE(paths[i - 1].length() < paths[i].length());
+}
+
+TEST_CASE("Fill: Plane path patterns of an island far from the center of the object", "[Fill]") {
+    // The curves are aligned to the bounding box of the whole object, only their parts over the island shall be extruded.
+    ExPolygon island(Points{ Point::new_scale(60, 60), Point::new_scale(70, 60), Point::new_scale(70, 70), Point::new_scale(60, 70) });
+    for (const char *pattern : { "hilbertcurve", "archimedeanchords", "octagramspiral" }) {
+        SECTION(pattern) {
+            std::unique_ptr<Slic3r::Fill> filler(Slic3r::Fill::new_from_type(pattern));
+            filler->bounding_box = BoundingBox(Point::new_scale(-100, -100), Point::new_scale(100, 100));
+            filler->spacing = 1.;
+            FillParams fill_params;
+            fill_params.density = 0.5f;
+            fill_params.dont_adjust = true;
+            Slic3r::Surface surface(stInternalSolid, island);
+            Slic3r::Polylines paths = filler->fill_surface(&surface, fill_params);
+            REQUIRE(! paths.empty());
+            // paths stay inside of the island
+            REQUIRE(diff_pl(paths, offset(island, float(SCALED_EPSILON * 10))).empty());
+            // the lines 2mm apart cover the island
+            double length = std::accumulate(paths.begin(), paths.end(), 0., [](double acc, const Polyline &pl) { return acc + unscale<double>(pl.length()); });
+            REQUIRE(length > 0.4 * 100. / 2.);
+            REQUIRE(length < 1.6 * 100. / 2.);
+        }
+    }
+}
+
 /*
 {
     my $collection = Slic3r::Polyline::Collection->new(
@@ -1,8 +1,19 @@
 #include <catch2/catch.hpp>
 
+#include <cstdlib>
+#include <limits>
 #include <memory>
 
+#include <boost/filesystem/operations.hpp>
+#include <boost/nowide/cstdio.hpp>
+
 #include "libslic3r/GCode.hpp"
+#include "libslic3r/GCodeReader.hpp"
+#include "libslic3r/GCode/Analyzer.hpp"
+#include "libslic3r/GCode/ArcFitter.hpp"
+#include "libslic3r/GCode/BinaryGCode.hpp"
+#include "libslic3r/GCode/InternalSlicesIndex.hpp"
+#include "libslic3r/GCode/PreviewData.hpp"
 
 using namespace Slic3r;
 
@@ -20,3 +31,390 @@ SCENARIO("Origin manipulation", "[GCode]") {
     	}
     }
 }
+
+SCENARIO("G-code output stream", "[GCode]") {
+	GIVEN("An in-memory output stream") {
+		GCodeOutputStream stream;
+		WHEN("plain and formatted G-code is written") {
+			stream.write("G28\n");
+			stream.write(std::string("G1 Z0.2\n"));
+			stream.write_format("G1 X%.3f Y%.3f E%.5f\n", 10.5, 20.25, 0.12345);
+			THEN("the G-code is accumulated in order") {
+				REQUIRE(stream.data() == "G28\nG1 Z0.2\nG1 X10.500 Y20.250 E0.12345\n");
+			}
+		}
+		WHEN("a formatted line longer than the initial formatting reserve is written") {
+			std::string comment(1000, 'x');
+			stream.write_format("; %s\n", comment.c_str());
+			THEN("it is not truncated") {
+				REQUIRE(stream.data() == "; " + comment + "\n");
+			}
+		}
+	}
+}
+
+SCENARIO("G-code reader", "[GCode]") {
+	static const char *values[] = { "0", "-0", "1", "+2.5", "-12.345", ".5", "7.", "123456789.12345", "0.000001",
+		"1234567890.1234567", "1e3", "-2.5E-2", "0x10", "inf", "1.5.3", "X" };
+	GIVEN("G1 lines with various axis values") {
+		std::string gcode;
+		for (const char *value : values)
+			gcode += std::string("G1 X") + value + " Y1\n";
+		WHEN("the G-code is parsed") {
+			std::vector<std::pair<bool, float>> parsed;
+			GCodeReader reader;
+			reader.parse_buffer(gcode, [&parsed](GCodeReader&, const GCodeReader::GCodeLine &line) {
+				parsed.emplace_back(line.has_x(), line.x());
+			});
+			THEN("the axis values match strtod()") {
+				REQUIRE(parsed.size() == sizeof(values) / sizeof(values[0]));
+				for (size_t i = 0; i < parsed.size(); ++ i) {
+					char *pend = nullptr;
+					double v = strtod(values[i], &pend);
+					bool valid = pend != values[i] && *pend == 0;
+					REQUIRE(parsed[i].first == valid);
+					if (valid)
+						REQUIRE(parsed[i].second == float(v));
+				}
+			}
+		}
+	}
+	GIVEN("A G-code file") {
+		std::string gcode = "G28\r\nG1 Z0.2 F7800\n\n; comment\nG1 X10 Y20 E1.5\nG1 X5";
+		boost::filesystem::path path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+		FILE *f = boost::nowide::fopen(path.string().c_str(), "wb");
+		REQUIRE(f != nullptr);
+		fwrite(gcode.data(), 1, gcode.size(), f);
+		fclose(f);
+		WHEN("the file is parsed") {
+			std::vector<std::string> lines_file, lines_buffer;
+			GCodeReader().parse_file(path.string(), [&lines_file](GCodeReader&, const GCodeReader::GCodeLine &line) { lines_file.emplace_back(line.raw()); });
+			GCodeReader().parse_buffer(gcode, [&lines_buffer](GCodeReader&, const GCodeReader::GCodeLine &line) { lines_buffer.emplace_back(line.raw()); });
+			boost::filesystem::remove(path);
+			THEN("the same lines are reported as when parsing the G-code from memory") {
+				REQUIRE(lines_file.size() == 6);
+				REQUIRE(lines_file == lines_buffer);
+			}
+		}
+	}
+}
+
+SCENARIO("Index of the internal slices for the retraction decision", "[GCode]") {
+	GIVEN("A square with a hole and a separate square") {
+		ExPolygon square_with_hole;
+		square_with_hole.contour = Polygon::new_scale({ { 0, 0 }, { 20, 0 }, { 20, 20 }, { 0, 20 } });
+		square_with_hole.holes.emplace_back(Polygon::new_scale({ { 5, 5 }, { 5, 15 }, { 15, 15 }, { 15, 5 } }));
+		ExPolygon square;
+		square.contour = Polygon::new_scale({ { 30, 0 }, { 40, 0 }, { 40, 10 }, { 30, 10 } });
+		ExPolygons slices { square_with_hole, square };
+		InternalSlicesIndex index(slices);
+		auto contains_exact = [&slices](const Polyline &travel) {
+			for (const ExPolygon &expoly : slices)
+				if (expoly.contains(travel))
+					return true;
+			return false;
+		};
+		std::vector<Polyline> travels {
+			// Inside the ring.
+			Polyline::new_scale({ { 1, 1 }, { 19, 1 }, { 19, 19 } }),
+			// Crossing the hole.
+			Polyline::new_scale({ { 1, 10 }, { 19, 10 } }),
+			// Inside the hole.
+			Polyline::new_scale({ { 6, 6 }, { 14, 14 } }),
+			// Along the boundary of the hole.
+			Polyline::new_scale({ { 5, 5 }, { 15, 5 } }),
+			// Touching the outer contour from inside.
+			Polyline::new_scale({ { 1, 1 }, { 0, 2 }, { 1, 3 } }),
+			// Between the two islands.
+			Polyline::new_scale({ { 19, 1 }, { 31, 1 } }),
+			// Inside the second island.
+			Polyline::new_scale({ { 31, 1 }, { 39, 9 } }),
+			// Outside of all islands.
+			Polyline::new_scale({ { 50, 50 }, { 60, 50 } }),
+		};
+		THEN("the index gives the same answers as the exact containment test") {
+			for (const Polyline &travel : travels)
+				REQUIRE(index.contains(travel) == contains_exact(travel));
+		}
+		THEN("the travels inside an island are contained") {
+			REQUIRE(index.contains(travels[0]));
+			REQUIRE(! index.contains(travels[1]));
+			REQUIRE(index.contains(travels[6]));
+			REQUIRE(! index.contains(travels[7]));
+		}
+	}
+}
+
+SCENARIO("Arc fitting", "[GCode]") {
+	GIVEN("A half circle of radius 10mm followed by a straight line") {
+		const double radius = 10.;
+		Points points;
+		for (size_t i = 0; i <= 36; ++ i) {
+			double angle = M_PI * double(i) / 36.;
+			points.emplace_back(Point::new_scale(radius * cos(angle), radius * sin(angle)));
+		}
+		for (size_t i = 1; i <= 5; ++ i)
+			points.emplace_back(Point::new_scale(- radius, - double(i)));
+		const double tolerance = scale_(0.01);
+		std::vector<ArcFitter::Segment> segments = ArcFitter::fit(points, tolerance);
+		THEN("the half circle is replaced by a single counter-clockwise arc, the line segments remain") {
+			REQUIRE(segments.size() == 6);
+			REQUIRE(segments.front().arc);
+			REQUIRE(segments.front().end == 36);
+			REQUIRE(segments.front().ccw);
+			REQUIRE((segments.front().center - Vec2d::Zero()).norm() < tolerance);
+			REQUIRE(std::abs(segments.front().length - scale_(M_PI * radius)) < scale_(0.01));
+			for (size_t i = 1; i < segments.size(); ++ i) {
+				REQUIRE(! segments[i].arc);
+				REQUIRE(segments[i].end == 36 + i);
+			}
+		}
+		THEN("the arc discretized back into line segments stays within the tolerance of the original points") {
+			const ArcFitter::Segment &arc = segments.front();
+			std::vector<Vec2d> discretized = ArcFitter::discretize(points.front().cast<double>(), points[arc.end].cast<double>(), arc.center, arc.ccw, scale_(1.), tolerance);
+			REQUIRE(discretized.size() >= 32);
+			REQUIRE(discretized.back() == points[arc.end].cast<double>());
+			for (const Point &pt : points)
+				if (pt.y() >= 0) {
+					double dist = std::numeric_limits<double>::max();
+					for (const Vec2d &pt2 : discretized)
+						dist = std::min(dist, (pt2 - pt.cast<double>()).norm());
+					REQUIRE(dist < scale_(1.));
+				}
+			REQUIRE(std::abs(ArcFitter::sweep(points.front().cast<double>(), points[arc.end].cast<double>(), arc.center, true) - M_PI) < 1e-3);
+			REQUIRE(std::abs(ArcFitter::sweep(points.front().cast<double>(), points[arc.end].cast<double>(), arc.center, false) - M_PI) < 1e-3);
+		}
+	}
+	GIVEN("A zig-zag") {
+		Points points;
+		for (size_t i = 0; i <= 10; ++ i)
+			points.emplace_back(Point::new_scale(double(i), (i & 1) ? 1. : 0.));
+		THEN("no arc is fitted") {
+			std::vector<ArcFitter::Segment> segments = ArcFitter::fit(points, scale_(0.01));
+			REQUIRE(segments.size() == 10);
+			for (const ArcFitter::Segment &segment : segments)
+				REQUIRE(! segment.arc);
+		}
+	}
+}
+
+SCENARIO("Binary G-code", "[GCode]") {
+	GIVEN("An ASCII G-code spanning multiple blocks, a thumbnail and a config") {
+		std::string gcode = "; generated by PrusaSlicer\n\n";
+		for (int i = 0; i < 20000; ++ i)
+			gcode += "G1 X" + std::to_string(i % 200) + " Y" + std::to_string(i / 200) + " E0.1\n";
+		BinaryGCode::Thumbnail thumbnail;
+		thumbnail.width  = 16;
+		thumbnail.height = 8;
+		thumbnail.png    = std::string("\x89PNG\r\n\x1a\n\0\xff", 10);
+		std::string config = "; layer_height = 0.2\n; nozzle_diameter = 0.4\n";
+		boost::filesystem::path path_ascii  = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+		boost::filesystem::path path_binary = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+		boost::filesystem::path path_back   = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+		FILE *f = boost::nowide::fopen(path_ascii.string().c_str(), "wb");
+		REQUIRE(f != nullptr);
+		fwrite(gcode.data(), 1, gcode.size(), f);
+		fclose(f);
+		WHEN("the G-code is converted to the binary G-code") {
+			BinaryGCode::convert_ascii_to_binary(path_ascii.string(), path_binary.string(), { thumbnail }, config);
+			THEN("the binary G-code is smaller and its metadata are readable") {
+				REQUIRE(BinaryGCode::is_binary_gcode(path_binary.string()));
+				REQUIRE(! BinaryGCode::is_binary_gcode(path_ascii.string()));
+				REQUIRE(boost::filesystem::file_size(path_binary) < gcode.size() / 2);
+				REQUIRE(BinaryGCode::read_config(path_binary.string()) == config);
+				FILE *f = boost::nowide::fopen(path_binary.string().c_str(), "rb");
+				BinaryGCode::Decoder   decoder(f);
+				BinaryGCode::BlockType type;
+				std::string            data;
+				REQUIRE(decoder.read_block(type, data));
+				REQUIRE(type == BinaryGCode::BlockType::Thumbnail);
+				BinaryGCode::Thumbnail decoded = BinaryGCode::Decoder::parse_thumbnail(data);
+				REQUIRE(decoded.width == thumbnail.width);
+				REQUIRE(decoded.height == thumbnail.height);
+				REQUIRE(decoded.png == thumbnail.png);
+				size_t num_gcode_blocks = 0;
+				while (decoder.read_block(type, data))
+					if (type == BinaryGCode::BlockType::GCode) {
+						// Blocks contain complete lines.
+						REQUIRE(data.back() == '\n');
+						++ num_gcode_blocks;
+					}
+				fclose(f);
+				REQUIRE(num_gcode_blocks > 1);
+			}
+			THEN("GCodeReader reports the same lines as for the ASCII G-code") {
+				std::vector<std::string> lines_ascii, lines_binary;
+				GCodeReader().parse_file(path_ascii.string(), [&lines_ascii](GCodeReader&, const GCodeReader::GCodeLine &line) { lines_ascii.emplace_back(line.raw()); });
+				GCodeReader().parse_file(path_binary.string(), [&lines_binary](GCodeReader&, const GCodeReader::GCodeLine &line) { lines_binary.emplace_back(line.raw()); });
+				REQUIRE(lines_ascii.size() == 20002);
+				REQUIRE(lines_binary == lines_ascii);
+			}
+			THEN("conversion back to ASCII restores the G-code with the thumbnail and the config") {
+				BinaryGCode::convert_binary_to_ascii(path_binary.string(), path_back.string());
+				std::string back(size_t(boost::filesystem::file_size(path_back)), 0);
+				FILE *f = boost::nowide::fopen(path_back.string().c_str(), "rb");
+				REQUIRE(fread(&back[0], 1, back.size(), f) == back.size());
+				fclose(f);
+				REQUIRE(back.find("; thumbnail begin 16x8 ") == gcode.find('\n') + 5);
+				REQUIRE(back.compare(back.size() - config.size(), config.size(), config) == 0);
+				REQUIRE(back.find(gcode.substr(100, 1000)) != std::string::npos);
+			}
+			THEN("a corrupted block is detected") {
+				f = boost::nowide::fopen(path_binary.string().c_str(), "r+b");
+				fseek(f, 100, SEEK_SET);
+				int c = fgetc(f);
+				fseek(f, 100, SEEK_SET);
+				fputc(c ^ 0x55, f);
+				fclose(f);
+				REQUIRE_THROWS_AS(GCodeReader().parse_file(path_binary.string(), [](GCodeReader&, const GCodeReader::GCodeLine&) {}), std::runtime_error);
+			}
+		}
+		boost::filesystem::remove(path_ascii);
+		boost::filesystem::remove(path_binary);
+		boost::filesystem::remove(path_back);
+	}
+}
+
+SCENARIO("G-code preview snapshot", "[GCode]") {
+	GIVEN("Preview data with extrusions, travels and retractions") {
+		GCodePreviewData data;
+		GCodePreviewData::Extrusion::Path path;
+		path.polyline       = Polyline(Points { Point(0, 0), Point(1000, 0), Point(1000, 1000) });
+		path.extrusion_role = erExternalPerimeter;
+		path.mm3_per_mm     = 0.05f;
+		path.width          = 0.45f;
+		path.height         = 0.2f;
+		path.feedrate       = 40.f;
+		path.extruder_id    = 1;
+		path.cp_color_id    = 2;
+		path.fan_speed      = 100.f;
+		data.extrusion.layers.emplace_back(0.2f, GCodePreviewData::Extrusion::Paths { path, path });
+		data.extrusion.layers.emplace_back(0.4f, GCodePreviewData::Extrusion::Paths { path });
+		Polyline3 travel;
+		travel.append(Vec3crd(0, 0, 200));
+		travel.append(Vec3crd(500, 500, 200));
+		data.travel.polylines.emplace_back(GCodePreviewData::Travel::Retract, GCodePreviewData::Travel::Polyline::Generic, 120.f, 0, travel);
+		data.retraction.positions.emplace_back(Vec3crd(1, 2, 3), 0.4f, 0.2f);
+		data.ranges.height.update_from(0.2f);
+		data.ranges.height.update_from(0.4f);
+		data.ranges.feedrate.update_from(40.f, GCodePreviewData::FeedrateKind::EXTRUSION);
+		data.ranges.feedrate.update_from(120.f, GCodePreviewData::FeedrateKind::TRAVEL);
+		data.extrusion.role_colors[erExternalPerimeter] = Color(0.1f, 0.2f, 0.3f, 1.f);
+		boost::filesystem::path path_snapshot = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+		data.save_snapshot(path_snapshot.string(), 1234);
+		WHEN("the snapshot is loaded with the same hash") {
+			GCodePreviewData loaded;
+			bool ok = loaded.load_snapshot(path_snapshot.string(), 1234);
+			THEN("the preview data are restored") {
+				REQUIRE(ok);
+				REQUIRE(loaded.extrusion.layers.size() == 2);
+				REQUIRE(loaded.extrusion.layers[0].z == 0.2f);
+				REQUIRE(loaded.extrusion.layers[0].paths.size() == 2);
+				const GCodePreviewData::Extrusion::Path &p = loaded.extrusion.layers[1].paths.front();
+				REQUIRE(p.polyline.points == path.polyline.points);
+				REQUIRE(p.extrusion_role == erExternalPerimeter);
+				REQUIRE(p.width == path.width);
+				REQUIRE(p.cp_color_id == 2);
+				REQUIRE(p.fan_speed == 100.f);
+				REQUIRE(loaded.travel.polylines.size() == 1);
+				REQUIRE(loaded.travel.polylines.front().type == GCodePreviewData::Travel::Retract);
+				REQUIRE(loaded.travel.polylines.front().polyline.points == data.travel.polylines.front().polyline.points);
+				REQUIRE(loaded.retraction.positions.size() == 1);
+				REQUIRE(loaded.retraction.positions.front().position == Vec3crd(1, 2, 3));
+				REQUIRE(loaded.unretraction.positions.empty());
+				REQUIRE(loaded.ranges.height.min() == 0.2f);
+				REQUIRE(loaded.ranges.height.max() == 0.4f);
+				REQUIRE(loaded.ranges.width.empty());
+				REQUIRE(loaded.ranges.feedrate.max(GCodePreviewData::FeedrateKind::TRAVEL) == 120.f);
+				REQUIRE(loaded.extrusion.role_colors[erExternalPerimeter].rgba == data.extrusion.role_colors[erExternalPerimeter].rgba);
+			}
+		}
+		WHEN("the snapshot is loaded with a different hash") {
+			GCodePreviewData loaded;
+			THEN("it is rejected and the preview data are left unchanged") {
+				REQUIRE(! loaded.load_snapshot(path_snapshot.string(), 4321));
+				REQUIRE(loaded.extrusion.layers.empty());
+			}
+		}
+		WHEN("the snapshot is corrupted") {
+			FILE *f = boost::nowide::fopen(path_snapshot.string().c_str(), "r+b");
+			fseek(f, 60, SEEK_SET);
+			int c = fgetc(f);
+			fseek(f, 60, SEEK_SET);
+			fputc(c ^ 0x55, f);
+			fclose(f);
+			THEN("it is rejected") {
+				GCodePreviewData loaded;
+				REQUIRE(! loaded.load_snapshot(path_snapshot.string(), 1234));
+				REQUIRE(loaded.extrusion.layers.empty());
+			}
+		}
+		boost::filesystem::remove(path_snapshot);
+	}
+}
+
+SCENARIO("Parallel analysis of the G-code", "[GCode]") {
+	GIVEN("A G-code of several megabytes with layer changes, relative extrusion, tool changes and retractions") {
+		std::string gcode = "G90\nM83\nG92 E0\nT0\n";
+		char buf[128];
+		for (int layer = 1; layer <= 300; ++ layer) {
+			sprintf(buf, ";LAYER_CHANGE\nG1 Z%.2f F7800\n", 0.2 * layer);
+			gcode += buf;
+			if (layer % 50 == 0)
+				gcode += (layer % 100 == 0) ? "T0\n" : "T1\n";
+			if (layer % 7 == 0) {
+				sprintf(buf, "M106 S%d\n", layer % 256);
+				gcode += buf;
+			}
+			sprintf(buf, ";%s%d\n;%s0.45\n;%s0.2\n", GCodeAnalyzer::Extrusion_Role_Tag.c_str(), int(layer % 2 ? erPerimeter : erSolidInfill),
+				GCodeAnalyzer::Width_Tag.c_str(), GCodeAnalyzer::Height_Tag.c_str());
+			gcode += buf;
+			for (int i = 0; i < 500; ++ i) {
+				sprintf(buf, "G1 X%.3f Y%.3f E%.5f%s\n", 10. + (i % 40), 10. + layer % 13 + i / 40, 0.03, (i % 100 == 0) ? " F1800" : "");
+				gcode += buf;
+				if (i % 97 == 0)
+					gcode += "G1 E-0.8 F2100\nG91\nG1 Z0.4\nG90\nG1 X5 Y5 F7800\nG1 E0.8 F2100\n";
+			}
+		}
+		// Large enough to be split into several chunks.
+		REQUIRE(gcode.size() > 4 * 1024 * 1024);
+		auto init_analyzer = [](GCodeAnalyzer &analyzer) {
+			analyzer.set_extruders_count(2);
+			analyzer.set_extruder_offsets(GCodeAnalyzer::ExtruderOffsetsMap { { 1, Vec2d(20., 0.) } });
+		};
+		GCodeAnalyzer serial;
+		init_analyzer(serial);
+		serial.process_gcode(gcode);
+		GCodePreviewData serial_data;
+		serial.calc_gcode_preview_data(serial_data, [](){});
+		WHEN("the G-code is analyzed in parallel chunks") {
+			GCodeAnalyzer parallel;
+			init_analyzer(parallel);
+			parallel.process_gcode_parallel(gcode);
+			GCodePreviewData parallel_data;
+			parallel.calc_gcode_preview_data(parallel_data, [](){});
+			THEN("the preview data are the same as if the G-code was analyzed at once") {
+				REQUIRE(parallel_data.extrusion.layers.size() == serial_data.extrusion.layers.size());
+				bool same_paths = true;
+				for (size_t i = 0; i < serial_data.extrusion.layers.size(); ++ i) {
+					const GCodePreviewData::Extrusion::Layer &l1 = serial_data.extrusion.layers[i];
+					const GCodePreviewData::Extrusion::Layer &l2 = parallel_data.extrusion.layers[i];
+					same_paths &= l1.z == l2.z && l1.paths.size() == l2.paths.size();
+					for (size_t j = 0; same_paths && j < l1.paths.size(); ++ j)
+						same_paths &= l1.paths[j].polyline.points == l2.paths[j].polyline.points && l1.paths[j].extruder_id == l2.paths[j].extruder_id &&
+							l1.paths[j].feedrate == l2.paths[j].feedrate && l1.paths[j].fan_speed == l2.paths[j].fan_speed && l1.paths[j].extrusion_role == l2.paths[j].extrusion_role;
+				}
+				REQUIRE(same_paths);
+				REQUIRE(parallel_data.travel.polylines.size() == serial_data.travel.polylines.size());
+				bool same_travels = true;
+				for (size_t i = 0; i < serial_data.travel.polylines.size(); ++ i)
+					same_travels &= parallel_data.travel.polylines[i].polyline.points == serial_data.travel.polylines[i].polyline.points;
+				REQUIRE(same_travels);
+				REQUIRE(parallel_data.retraction.positions.size() == serial_data.retraction.positions.size());
+				REQUIRE(parallel_data.unretraction.positions.size() == serial_data.unretraction.positions.size());
+				REQUIRE(parallel_data.ranges.fan_speed.max() == serial_data.ranges.fan_speed.max());
+				REQUIRE(parallel_data.ranges.feedrate.min(GCodePreviewData::FeedrateKind::EXTRUSION) == serial_data.ranges.feedrate.min(GCodePreviewData::FeedrateKind::EXTRUSION));
+			}
+		}
+	}
+}
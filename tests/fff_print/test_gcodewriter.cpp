@@ -1,6 +1,8 @@
 #include <catch2/catch.hpp>
 
+#include <iomanip>
 #include <memory>
+#include <sstream>
 
 #include "libslic3r/GCodeWriter.hpp"
 
@@ -94,3 +96,36 @@ SCENARIO("set_speed emits values with fixed-point output.", "[GCodeWriter]") {
         }
     }
 }
+
+SCENARIO("GCodeFormatter formats numbers the same way as std::ostringstream", "[GCodeWriter]") {
+    auto format_fixed = [](double value, int precision) {
+        char buf[32];
+        return std::string(buf, GCodeFormatter::format_fixed(buf, value, precision));
+    };
+    auto format_stream = [](double value, int precision) {
+        std::ostringstream ss;
+        ss << std::fixed << std::setprecision(precision) << value;
+        return ss.str();
+    };
+    GIVEN("Coordinates, extrusions and ties") {
+        std::vector<double> values { 0., -0., 1., -1., 0.0005, -0.0005, 0.125, 0.0625, 2.5e-6, -0.0001, 99.9995, 123.4565, 1e12 + 0.0005, 4500.12345678 };
+        for (int i = 0; i < 10000; ++ i)
+            values.emplace_back(double(i - 5000) * 0.0123456789);
+        THEN("Both formatters agree at the X/Y/Z/F and at the E precision") {
+            for (double v : values) {
+                REQUIRE(format_fixed(v, GCodeFormatter::XYZF_PRECISION) == format_stream(v, GCodeFormatter::XYZF_PRECISION));
+                REQUIRE(format_fixed(v, GCodeFormatter::E_PRECISION) == format_stream(v, GCodeFormatter::E_PRECISION));
+            }
+        }
+    }
+    GIVEN("A line with a comment longer than the stack buffer") {
+        GCodeFormatter w;
+        std::string comment(300, 'c');
+        w.emit_string("G1");
+        w.emit_xy(Vec2d(1., 2.));
+        w.emit_comment(true, comment);
+        THEN("The line is complete") {
+            REQUIRE(w.line() == "G1 X1.000 Y2.000 ; " + comment + "\n");
+        }
+    }
+}
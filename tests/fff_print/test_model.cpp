@@ -2,6 +2,7 @@
 
 #include "libslic3r/libslic3r.h"
 #include "libslic3r/Model.hpp"
+#include "libslic3r/Format/STL.hpp"
 
 #include <boost/nowide/cstdio.hpp>
 #include <boost/filesystem.hpp>
@@ -59,3 +60,59 @@ SCENARIO("Model construction", "[Model]") {
         }
     }
 }
+
+SCENARIO("Model object bounding boxes", "[Model]") {
+    GIVEN("A model object with a rotated and scaled instance of a cylinder") {
+        Slic3r::Model model;
+        Slic3r::ModelObject *model_object = model.add_object();
+        Slic3r::ModelVolume *volume = model_object->add_volume(Slic3r::make_cylinder(10., 20.));
+        Slic3r::ModelInstance *instance = model_object->add_instance();
+        instance->set_rotation(Vec3d(0.3, 0.5, 0.7));
+        instance->set_scaling_factor(Vec3d(1.5, 1., 0.5));
+        instance->set_offset(Vec3d(10., 20., 30.));
+        WHEN("The instance bounding box is calculated from the convex hull of the volume") {
+            BoundingBoxf3 bb = model_object->instance_bounding_box(0);
+            BoundingBoxf3 bb_mesh = volume->mesh().transformed_bounding_box(instance->get_matrix() * volume->get_matrix());
+            THEN("It matches the bounding box of the transformed mesh") {
+                REQUIRE((bb.min - bb_mesh.min).norm() < EPSILON);
+                REQUIRE((bb.max - bb_mesh.max).norm() < EPSILON);
+            }
+        }
+    }
+}
+
+SCENARIO("Model export to a binary STL", "[Model]") {
+    GIVEN("A model with two objects, one of them with two rotated and scaled instances") {
+        Slic3r::Model model;
+        Slic3r::ModelObject *cylinder = model.add_object();
+        Slic3r::ModelVolume *volume = cylinder->add_volume(Slic3r::make_cylinder(10., 20.));
+        volume->set_offset(Vec3d(1., 2., 3.));
+        cylinder->add_instance()->set_offset(Vec3d(50., 50., 0.));
+        Slic3r::ModelInstance *instance = cylinder->add_instance();
+        instance->set_rotation(Vec3d(0.3, 0.5, 0.7));
+        instance->set_scaling_factor(Vec3d(1.5, 1., 0.5));
+        instance->set_offset(Vec3d(10., 20., 30.));
+        model.add_object()->add_volume(Slic3r::make_cube(20., 20., 20.));
+        model.objects.back()->add_instance();
+        WHEN("The model is stored without merging its meshes and loaded back") {
+            boost::filesystem::path temp = boost::filesystem::unique_path("%%%%-%%%%-%%%%.stl");
+            REQUIRE(Slic3r::store_stl(temp.string().c_str(), &model, true));
+            TriangleMesh loaded;
+            REQUIRE(loaded.ReadSTLFile(temp.string().c_str()));
+            boost::nowide::remove(temp.string().c_str());
+            THEN("It matches the merged mesh of the model") {
+                TriangleMesh merged = model.mesh();
+                REQUIRE(loaded.stl.facet_start.size() == merged.stl.facet_start.size());
+                bool same = true;
+                for (size_t i = 0; i < merged.stl.facet_start.size(); ++ i) {
+                    const stl_facet &f1 = merged.stl.facet_start[i];
+                    const stl_facet &f2 = loaded.stl.facet_start[i];
+                    for (size_t j = 0; j < 3; ++ j)
+                        same &= (f1.vertex[j] - f2.vertex[j]).norm() < EPSILON;
+                    same &= (f1.normal - f2.normal).norm() < EPSILON;
+                }
+                REQUIRE(same);
+            }
+        }
+    }
+}
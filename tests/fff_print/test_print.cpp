@@ -125,3 +125,83 @@ SCENARIO("Print: Brim generation", "[Print]") {
         }
     }
 }
+
+SCENARIO("Print: Memory statistics", "[Print]") {
+    GIVEN("20mm cube with a brim") {
+        Slic3r::Print print;
+        Slic3r::Test::init_and_process_print({TestMesh::cube_20x20x20}, print, { { "brim_width", 3 } });
+        PrintMemoryStats stats = print.memory_stats();
+        auto step_bytes = [&stats](const std::string &name) {
+            auto it = std::find_if(stats.steps.begin(), stats.steps.end(), [&name](const std::pair<std::string, size_t> &s) { return s.first == name; });
+            return it == stats.steps.end() ? size_t(0) : it->second;
+        };
+        THEN("The slices, perimeters, infill and brim hold memory") {
+            REQUIRE(step_bytes("slice") > 0);
+            REQUIRE(step_bytes("perimeters") > 0);
+            REQUIRE(step_bytes("infill") > 0);
+            REQUIRE(step_bytes("brim") > 0);
+        }
+        THEN("The total is the sum of the steps") {
+            size_t sum = 0;
+            for (const std::pair<std::string, size_t> &step : stats.steps)
+                sum += step.second;
+            REQUIRE(stats.total() == sum);
+        }
+        THEN("The object stats are a part of the print stats") {
+            REQUIRE(print.objects().front()->memory_stats().total() < stats.total());
+        }
+    }
+}
+
+SCENARIO("Print: Identical objects share their PrintObject", "[Print]") {
+    GIVEN("Two identical 20mm cubes and a 20mm cube with a different config") {
+        Slic3r::Print print;
+        Slic3r::Model model;
+        Slic3r::Test::init_print({TestMesh::cube_20x20x20, TestMesh::cube_20x20x20}, print, model, { { "complete_objects", false } });
+        THEN("The cubes are printed as two copies of a single PrintObject") {
+            REQUIRE(print.objects().size() == 1);
+            REQUIRE(print.objects().front()->copies().size() == 2);
+        }
+        WHEN("The config of one of the cubes is changed") {
+            DynamicPrintConfig config = print.full_print_config();
+            model.objects.back()->config.set_deserialize("support_material", "1");
+            print.apply(model, config);
+            THEN("Each cube is printed by its own PrintObject") {
+                REQUIRE(print.objects().size() == 2);
+                REQUIRE(print.objects().front()->copies().size() == 1);
+                REQUIRE(print.objects().back()->config().support_material.value);
+            }
+        }
+    }
+}
+
+SCENARIO("Print: Applying a model with many instances", "[Print]") {
+    GIVEN("A 20mm cube with 50 instances") {
+        Slic3r::Print print;
+        Slic3r::Model model;
+        Slic3r::Test::init_print({TestMesh::cube_20x20x20}, print, model, { { "complete_objects", false } });
+        ModelObject *model_object = model.objects.front();
+        for (size_t i = 1; i < 50; ++ i)
+            model_object->add_instance()->set_offset(Vec3d(25. * double(i % 10), 25. * double(i / 10), 0.));
+        DynamicPrintConfig config = print.full_print_config();
+        print.apply(model, config);
+        REQUIRE(print.objects().size() == 1);
+        REQUIRE(print.objects().front()->copies().size() == 50);
+        WHEN("The same model is applied again") {
+            THEN("Nothing changes") {
+                REQUIRE(print.apply(model, config) == PrintBase::APPLY_STATUS_UNCHANGED);
+                REQUIRE(print.objects().front()->copies().size() == 50);
+            }
+        }
+        WHEN("A single instance is moved") {
+            model_object->instances[7]->set_offset(X, model_object->instances[7]->get_offset(X) + 1.);
+            PrintBase::ApplyStatus status = print.apply(model, config);
+            THEN("The copies of the same PrintObject are updated") {
+                REQUIRE(status != PrintBase::APPLY_STATUS_UNCHANGED);
+                REQUIRE(print.objects().size() == 1);
+                REQUIRE(print.objects().front()->copies().size() == 50);
+                REQUIRE(print.model().objects.front()->instances[7]->get_offset(X) == Approx(model_object->instances[7]->get_offset(X)));
+            }
+        }
+    }
+}
@@ -1,6 +1,7 @@
 #include <catch2/catch.hpp>
 
 #include "libslic3r/TriangleMesh.hpp"
+#include "libslic3r/QuadricEdgeCollapse.hpp"
 #include "libslic3r/Point.hpp"
 #include "libslic3r/Config.hpp"
 #include "libslic3r/Model.hpp"
@@ -324,6 +325,31 @@ SCENARIO( "TriangleMesh: split functionality.") {
             THEN( "Two meshes are in the output vector.") {
                 REQUIRE(meshes.size() == 2);
             }
+            THEN( "Each mesh gets the facets of one cube.") {
+                REQUIRE(meshes.at(0)->facets_count() == 12);
+                REQUIRE(meshes.at(1)->facets_count() == 12);
+                REQUIRE((meshes.at(0)->bounding_box() == cube2.bounding_box()));
+            }
+        }
+    }
+}
+
+SCENARIO( "TriangleMesh: quadric edge collapse decimation.") {
+    GIVEN( "A finely tessellated sphere with a radius of 10mm") {
+        TriangleMesh sphere = make_sphere(10., 0.05);
+        sphere.repair();
+        sphere.require_shared_vertices();
+        indexed_triangle_set its = sphere.its;
+        WHEN( "The sphere is decimated to a tenth of its triangles") {
+            its_quadric_edge_collapse(its, sphere.its.indices.size() / 10);
+            THEN( "The number of triangles is reduced to the target") {
+                REQUIRE(its.indices.size() <= sphere.its.indices.size() / 10);
+                REQUIRE(its.vertices.size() < sphere.its.vertices.size());
+            }
+            THEN( "The vertices stay on the sphere") {
+                for (const stl_vertex &v : its.vertices)
+                    REQUIRE(std::abs(v.cast<double>().norm() - 10.) < 0.1);
+            }
         }
     }
 }
@@ -381,6 +407,53 @@ SCENARIO( "TriangleMeshSlicer: Cut behavior.") {
         }
     }
 }
+SCENARIO( "TriangleMeshSlicer: Slicing with a transformation.") {
+    GIVEN( "A 20mm cube with one corner on the origin") {
+        const std::vector<Vec3d> vertices { Vec3d(20,20,0), Vec3d(20,0,0), Vec3d(0,0,0), Vec3d(0,20,0), Vec3d(20,20,20), Vec3d(0,20,20), Vec3d(0,0,20), Vec3d(20,0,20) };
+        const std::vector<Vec3crd> facets { Vec3crd(0,1,2), Vec3crd(0,2,3), Vec3crd(4,5,6), Vec3crd(4,6,7), Vec3crd(0,4,7), Vec3crd(0,7,1), Vec3crd(1,7,6), Vec3crd(1,6,2), Vec3crd(2,6,5), Vec3crd(2,5,3), Vec3crd(4,0,3), Vec3crd(4,3,5) };
+
+		TriangleMesh cube(vertices, facets);
+        cube.repair();
+        Transform3d trafo = Transform3d::Identity();
+        trafo.translate(Vec3d(5., -3., 2.));
+        trafo.scale(Vec3d(2., 1.5, 0.5));
+        const std::vector<float> z { 3.f, 5.f, 7.f, 13.f };
+        WHEN( "The cube is sliced with the transformation applied on the fly") {
+            TriangleMeshSlicer slicer;
+            slicer.init(&cube, trafo, nullptr, [](){});
+            std::vector<ExPolygons> layers;
+            slicer.slice(z, 0.f, &layers, [](){});
+            TriangleMesh cube_transformed(cube);
+            cube_transformed.transform(trafo, true);
+            TriangleMeshSlicer slicer_transformed(&cube_transformed);
+            std::vector<ExPolygons> layers_transformed;
+            slicer_transformed.slice(z, 0.f, &layers_transformed, [](){});
+            THEN( "The slices match the slices of the transformed copy of the cube") {
+                REQUIRE(layers.size() == z.size());
+                REQUIRE(layers[3].empty());
+                for (size_t i = 0; i < z.size(); ++ i) {
+                    REQUIRE(layers[i].size() == layers_transformed[i].size());
+                    for (size_t j = 0; j < layers[i].size(); ++ j)
+                        REQUIRE(layers[i][j].area() == Approx(layers_transformed[i][j].area()));
+                }
+            }
+            THEN( "The area of the slices is scaled by the transformation") {
+                REQUIRE(layers[0].size() == 1);
+                REQUIRE(layers[0].front().area() == Approx(40.0 * 30.0 / std::pow(SCALING_FACTOR, 2)));
+            }
+            THEN( "The topology is shared with another slicer of the same mesh") {
+                TriangleMeshSlicer slicer_shared;
+                slicer_shared.init(&cube, Transform3d::Identity(), slicer.facets_edges(), [](){});
+                REQUIRE(slicer_shared.facets_edges() == slicer.facets_edges());
+                std::vector<ExPolygons> layers_shared;
+                slicer_shared.slice(z, 0.f, &layers_shared, [](){});
+                REQUIRE(layers_shared[0].size() == 1);
+                REQUIRE(layers_shared[0].front().area() == Approx(20.0 * 20.0 / std::pow(SCALING_FACTOR, 2)));
+            }
+        }
+    }
+}
+
 #ifdef TEST_PERFORMANCE
 TEST_CASE("Regression test for issue #4486 - files take forever to slice") {
     TriangleMesh mesh;
@@ -606,6 +606,35 @@ TEST_CASE("PrusaPartsShouldFitIntoTwoBins", "[Nesting]") {
     }
 }
 
+TEST_CASE("IdenticalItemsShouldNotOverlap", "[Nesting]") {
+    auto bin = Box(250000000, 210000000);
+
+    // Many copies of the same part: the placer reuses the no-fit polygons
+    // of the identical shapes for these.
+    std::vector<Item> input(30, Item{PRINTER_PART_POLYGONS[0]});
+
+    size_t bins = libnest2d::nest(input, bin);
+    REQUIRE(bins > 0u);
+
+    using Pile = TMultiShape<ClipperLib::Polygon>;
+    std::vector<Pile> piles(bins);
+    std::vector<double> areas(bins, 0.);
+
+    for (auto &itm : input) {
+        REQUIRE(itm.binId() != BIN_ID_UNSET);
+        piles[size_t(itm.binId())].emplace_back(itm.transformedShape());
+        areas[size_t(itm.binId())] += itm.area();
+    }
+
+    // The merged pile has the summed up area only if no items overlap.
+    for (size_t b = 0; b < bins; ++b) {
+        double merged_area = 0.;
+        for (auto &sh : nfp::merge(piles[b])) merged_area += sl::area(sh);
+
+        REQUIRE(merged_area == Approx(areas[b]).epsilon(1e-6));
+    }
+}
+
 TEST_CASE("EmptyItemShouldBeUntouched", "[Nesting]") {
     auto bin = Box(250000000, 210000000); // dummy bin
 
@@ -210,6 +210,27 @@ SCENARIO("Various Clipper operations - t/clipper.t", "[ClipperUtils]") {
             }
         }
     }
+    GIVEN("square and clip squares far away") {
+        Slic3r::Polygon  square { { 10, 10 }, { 20, 10 }, { 20, 20 }, { 10, 20 } };
+        Slic3r::Polygon  square2 { { 15, 15 }, { 25, 15 }, { 25, 25 }, { 15, 25 } };
+        Slic3r::Polygons clip { square2 };
+        for (coord_t i = 1; i <= 10; ++ i)
+            clip.push_back({ { 1000 * i, 1000 }, { 1000 * i + 10, 1000 }, { 1000 * i + 10, 1010 }, { 1000 * i, 1010 } });
+        WHEN("diff, intersection and diff_pl") {
+            THEN("the squares outside of the subject do not change the result") {
+                REQUIRE(Slic3r::diff({ square }, clip) == Slic3r::diff({ square }, { square2 }));
+                REQUIRE(Slic3r::diff({ square }, clip, true) == Slic3r::diff({ square }, { square2 }, true));
+                REQUIRE(Slic3r::intersection({ square }, clip) == Slic3r::intersection({ square }, { square2 }));
+                REQUIRE(Slic3r::diff_ex({ square }, clip).size() == 1);
+                REQUIRE(Slic3r::diff_ex({ square }, clip).front().area() == Approx(75.));
+                Polylines pl1 = Slic3r::diff_pl({ square.split_at_first_point() }, clip);
+                Polylines pl2 = Slic3r::diff_pl({ square.split_at_first_point() }, { square2 });
+                REQUIRE(pl1.size() == pl2.size());
+                for (size_t i = 0; i < pl1.size(); ++ i)
+                    REQUIRE(pl1[i].points == pl2[i].points);
+            }
+        }
+    }
     GIVEN("yet another square") {
         Slic3r::Polygon  square { { 10, 10 }, { 20, 10 }, { 20, 20 }, { 10, 20 } };
         Slic3r::Polyline square_pl = square.split_at_first_point();
@@ -299,3 +320,47 @@ TEST_CASE("Traversing Clipper PolyTree", "[ClipperUtils]") {
         REQUIRE(count_polys(output) == reference.size());
     }
 }
+
+SCENARIO("ExPolygonSet flat storage", "[ClipperUtils]") {
+	Slic3r::Polygon   square{ { 200, 100 }, { 200, 200 }, { 100, 200 }, { 100, 100 } };
+	Slic3r::Polygon   hole_in_square{ { 160, 140 }, { 140, 140 }, { 140, 160 }, { 160, 160 } };
+	Slic3r::Polygon   square2{ { 400, 100 }, { 500, 100 }, { 500, 200 }, { 400, 200 } };
+	ExPolygons        expolygons { ExPolygon(square, hole_in_square), ExPolygon(square2) };
+	GIVEN("ExPolygonSet built from ExPolygons") {
+		ExPolygonSet set(expolygons);
+		THEN("counts match") {
+			REQUIRE(set.size() == 2);
+			REQUIRE(set.num_polygons() == 3);
+			REQUIRE(set[0].num_holes() == 1);
+			REQUIRE(set[1].num_holes() == 0);
+		}
+		THEN("areas match") {
+			REQUIRE(set[0].area() == Approx(expolygons[0].area()));
+			REQUIRE(set[1].area() == Approx(expolygons[1].area()));
+		}
+		THEN("round trip to ExPolygons is lossless") {
+			ExPolygons out = to_expolygons(set);
+			REQUIRE(out.size() == expolygons.size());
+			for (size_t i = 0; i < out.size(); ++ i) {
+				REQUIRE(out[i].contour.points == expolygons[i].contour.points);
+				REQUIRE(out[i].holes.size() == expolygons[i].holes.size());
+				for (size_t j = 0; j < out[i].holes.size(); ++ j)
+					REQUIRE(out[i].holes[j].points == expolygons[i].holes[j].points);
+			}
+		}
+		THEN("Clipper union matches the ExPolygons path") {
+			ClipperLib::Paths paths = Slic3rMultiPoints_to_ClipperPaths(set);
+			REQUIRE(paths == Slic3rMultiPoints_to_ClipperPaths(expolygons));
+			ExPolygons   reference = ClipperPaths_to_Slic3rExPolygons(paths);
+			ExPolygonSet result    = ClipperPaths_to_ExPolygonSet(paths);
+			REQUIRE(result.size() == reference.size());
+			double area_reference = 0.;
+			double area_result    = 0.;
+			for (const ExPolygon &expoly : reference)
+				area_reference += expoly.area();
+			for (ExPolygonSet::ExPolygonView expoly : result)
+				area_result += expoly.area();
+			REQUIRE(area_result == Approx(area_reference));
+		}
+	}
+}
@@ -201,3 +201,26 @@ SCENARIO("Config ini load/save interface", "[Config]") {
         }
     }
 }
+
+SCENARIO("Static config diff", "[Config]") {
+    GIVEN("Two default static configs") {
+        PrintObjectConfig config1, config2;
+        THEN("They are equal.") {
+            REQUIRE(config1.equals(config2));
+            REQUIRE(config1.diff(config2).empty());
+        }
+        WHEN("An option of one of them is changed") {
+            config2.layer_height.value = config1.layer_height.value + 0.1;
+            THEN("The diff contains just the changed option.") {
+                REQUIRE(! config1.equals(config2));
+                REQUIRE(config1.diff(config2) == t_config_option_keys{ "layer_height" });
+            }
+            THEN("Diff against a dynamic config with the same values gives the same result.") {
+                DynamicPrintConfig dynamic;
+                dynamic.apply(config2, true);
+                REQUIRE(config1.diff(dynamic) == t_config_option_keys{ "layer_height" });
+                REQUIRE(! config1.equals(dynamic));
+            }
+        }
+    }
+}
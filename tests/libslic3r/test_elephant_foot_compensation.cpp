@@ -461,6 +461,22 @@ SCENARIO("Elephant foot compensation", "[ElephantFoot]") {
         }
 	}
 
+	GIVEN("Two boxes of the same shape") {
+		ExPolygon expoly1( { {50000000, 50000000 }, { 0, 50000000 }, { 0, 0 }, { 50000000, 0 } } );
+		ExPolygon expoly2 = expoly1;
+		expoly2.translate(Point(70000000, 10000000));
+        WHEN("Compensated together") {
+			ExPolygons expolys_compensated = elephant_foot_compensation(ExPolygons{ expoly1, expoly2 }, Flow(0.419999987f, 0.2f, 0.4f, false), 0.21f);
+            THEN("the second box is compensated the same way as the first one") {
+				REQUIRE(expolys_compensated.size() == 2);
+				ExPolygon expoly_compensated = elephant_foot_compensation(expoly1, Flow(0.419999987f, 0.2f, 0.4f, false), 0.21f);
+				REQUIRE(expolys_compensated.front() == expoly_compensated);
+				expoly_compensated.translate(Point(70000000, 10000000));
+                REQUIRE(expolys_compensated.back() == expoly_compensated);
+            }
+        }
+	}
+
 	GIVEN("Thin ring (GH issue #2085)") {
 		ExPolygon expoly = thin_ring();
         WHEN("Compensated") {
@@ -6,8 +6,14 @@
 #include "libslic3r/Polyline.hpp"
 #include "libslic3r/Line.hpp"
 #include "libslic3r/Geometry.hpp"
+#include "libslic3r/Int128.hpp"
 #include "libslic3r/ClipperUtils.hpp"
 #include "libslic3r/ShortestPath.hpp"
+#include "libslic3r/KDTreeFlat.hpp"
+#include "libslic3r/EdgeGrid.hpp"
+#include "libslic3r/Tesselate.hpp"
+#include "libslic3r/MotionPlanner.hpp"
+#include "libslic3r/SurfaceCollection.hpp"
 
 using namespace Slic3r;
 
@@ -321,6 +327,30 @@ SCENARIO("Path chaining", "[Geometry]") {
 			}
 		}
 	}
+	GIVEN("A large grid of short segments") {
+		// Above the threshold of the partitioned chaining.
+		Polylines polylines;
+		for (coord_t j = 0; j < 100; ++ j)
+			for (coord_t i = 0; i < 100; ++ i)
+				polylines.push_back(Polyline(Point(scale_(2. * i), scale_(2. * j)), Point(scale_(2. * i + 1.), scale_(2. * j))));
+		Point start_near(0, 0);
+		Polylines chained = chain_polylines(polylines, &start_near);
+		THEN("All segments are chained") {
+			REQUIRE(chained.size() == polylines.size());
+			std::vector<Point> first_points;
+			for (const Polyline &pl : chained)
+				first_points.emplace_back(std::min(pl.first_point(), pl.last_point(), [](const Point &l, const Point &r){ return l.x() < r.x(); }));
+			std::sort(first_points.begin(), first_points.end(), [](const Point &l, const Point &r){ return l.y() < r.y() || (l.y() == r.y() && l.x() < r.x()); });
+			REQUIRE(std::unique(first_points.begin(), first_points.end()) == first_points.end());
+		}
+		THEN("Chained taking a short path") {
+			double connection_length = 0.;
+			for (size_t i = 1; i < chained.size(); ++i)
+				connection_length += (chained[i].first_point() - chained[i - 1].last_point()).cast<double>().norm();
+			// Connecting the neighbor segments takes 1mm per connection.
+			REQUIRE(connection_length < 2. * scale_(1.) * double(polylines.size()));
+		}
+	}
 }
 
 SCENARIO("Line distances", "[Geometry]"){
@@ -432,11 +462,36 @@ TEST_CASE("Triangle Simplification does not result in less than 3 points", "[Geo
     REQUIRE(triangle.simplify(250000).at(0).points.size() == 3);
 }
 
+TEST_CASE("Douglas-Peucker simplification in place", "[Geometry]"){
+    // A zig-zag along the X axis with a deviation below the tolerance and a single spike above the tolerance.
+    Points points;
+    for (coord_t x = 0; x <= 100; ++ x)
+        points.emplace_back(x * 1000, x == 50 ? 5000 : (x % 2) * 100);
+    Points simplified = MultiPoint::_douglas_peucker(points, 1000.);
+    MultiPoint::douglas_peucker(points, 1000.);
+    REQUIRE(points == simplified);
+    REQUIRE(points.size() == 5);
+    REQUIRE(points.front() == Point(0, 0));
+    REQUIRE(points[2] == Point(50000, 5000));
+    REQUIRE(points.back() == Point(100000, 0));
+}
+
 SCENARIO("Ported from xs/t/14_geometry.t", "[Geometry]"){
     GIVEN(("square")){
     	Slic3r::Points points { { 100, 100 }, {100, 200 }, { 200, 200 }, { 200, 100 }, { 150, 150 } };
 		Slic3r::Polygon hull = Slic3r::Geometry::convex_hull(points);
 		SECTION("convex hull returns the correct number of points") { REQUIRE(hull.points.size() == 4); }
+    }
+    GIVEN("a large number of points inside a square") {
+        Slic3r::Points points;
+        for (int i = 0; i < 200000; ++ i)
+            points.emplace_back(1 + (i * 7919) % 99998, 1 + (i * 104729) % 99998);
+        points.insert(points.begin() + 77777, { { 0, 0 }, { 100000, 0 }, { 100000, 100000 }, { 0, 100000 } });
+        Slic3r::Polygon hull = Slic3r::Geometry::convex_hull(points);
+        THEN("the convex hull calculated in chunks is the square") {
+            REQUIRE(hull.points.size() == 4);
+            REQUIRE(hull.area() == Approx(1e10));
+        }
     }
 	SECTION("arrange returns expected number of positions") {
 		Pointfs positions;
@@ -452,3 +507,255 @@ SCENARIO("Ported from xs/t/14_geometry.t", "[Geometry]"){
     	REQUIRE(! Slic3r::Geometry::directions_parallel(M_PI /2, PI, M_PI /180));
     }
 }
+
+SCENARIO("Ported from xs/t/18_motionplanner.t", "[Geometry]") {
+    ExPolygon expolygon;
+    expolygon.contour = Polygon::new_scale({ { 100, 100 }, { 200, 100 }, { 200, 200 }, { 100, 200 } });
+    expolygon.holes.emplace_back(Polygon::new_scale({ { 140, 140 }, { 140, 160 }, { 160, 160 }, { 160, 140 } }));
+    GIVEN("square with a hole, both points inside the square") {
+        MotionPlanner mp(ExPolygons{ expolygon });
+        Point from = Point::new_scale(120, 120);
+        Point to   = Point::new_scale(180, 180);
+        Polyline path = mp.shortest_path(from, to);
+        THEN("path goes around the hole") {
+            REQUIRE(path.is_valid());
+            REQUIRE(path.length() > Line(from, to).length());
+            REQUIRE(path.first_point() == from);
+            REQUIRE(path.last_point() == to);
+            REQUIRE(expolygon.contains(path));
+        }
+    }
+    GIVEN("square with a hole, both points outside the square") {
+        MotionPlanner mp(ExPolygons{ expolygon });
+        Point from = Point::new_scale(80, 100);
+        Point to   = Point::new_scale(220, 200);
+        Polyline path = mp.shortest_path(from, to);
+        THEN("path goes around the square") {
+            REQUIRE(path.is_valid());
+            REQUIRE(path.length() > Line(from, to).length());
+            REQUIRE(path.first_point() == from);
+            REQUIRE(path.last_point() == to);
+            REQUIRE(intersection_pl(Polylines{ path }, to_polygons(expolygon)).empty());
+        }
+    }
+    GIVEN("square with a hole, straight line outside the square") {
+        MotionPlanner mp(ExPolygons{ expolygon });
+        Point from = Point::new_scale(80, 100);
+        Point to   = Point::new_scale(80, 200);
+        Polyline path = mp.shortest_path(from, to);
+        THEN("path is a straight line") {
+            REQUIRE(path.points == Points({ from, to }));
+        }
+    }
+    GIVEN("two squares with holes") {
+        ExPolygon expolygon2 = expolygon;
+        expolygon2.translate(scale_(300), 0);
+        MotionPlanner mp(ExPolygons{ expolygon, expolygon2 });
+        Point from = Point::new_scale(120, 120);
+        Point to   = Point::new_scale(120 + 300, 120);
+        REQUIRE(expolygon.contains(from));
+        REQUIRE(expolygon2.contains(to));
+        Polyline path = mp.shortest_path(from, to);
+        THEN("path is valid") {
+            REQUIRE(path.is_valid());
+            REQUIRE(path.first_point() == from);
+            REQUIRE(path.last_point() == to);
+        }
+    }
+}
+
+SCENARIO("KDTreeFlat closest points", "[Geometry]") {
+	GIVEN("Pseudo random points") {
+		std::vector<Vec2d> points;
+		for (size_t i = 0; i < 1000; ++ i)
+			points.emplace_back(double((i * 7919) % 1009), double((i * 104729) % 1013));
+		KDTreeFlat<2, double> kdtree([&points](size_t idx, size_t dimension) { return points[idx][dimension]; }, points.size());
+		auto brute_force_closest = [&points](const Vec2d &pt, const std::vector<char> &removed) {
+			double dist_min = std::numeric_limits<double>::max();
+			for (size_t i = 0; i < points.size(); ++ i)
+				if (! removed[i])
+					dist_min = std::min(dist_min, (points[i] - pt).squaredNorm());
+			return dist_min;
+		};
+		std::vector<Vec2d> queries { { 0., 0. }, { 500., 500. }, { 1008., 3. }, { 250.5, 750.5 }, { -100., 2000. } };
+		std::vector<char>  removed(points.size(), false);
+		THEN("Closest point matches the brute force search") {
+			for (const Vec2d &q : queries)
+				REQUIRE((points[kdtree.closest_point(q)] - q).squaredNorm() == Approx(brute_force_closest(q, removed)));
+		}
+		THEN("Closest point skips the removed points") {
+			for (size_t i = 0; i < points.size(); i += 2) {
+				REQUIRE(kdtree.remove(i));
+				removed[i] = true;
+			}
+			REQUIRE(! kdtree.remove(0));
+			REQUIRE(kdtree.size() == points.size() / 2);
+			for (const Vec2d &q : queries) {
+				size_t idx = kdtree.closest_point(q);
+				REQUIRE(! removed[idx]);
+				REQUIRE((points[idx] - q).squaredNorm() == Approx(brute_force_closest(q, removed)));
+			}
+		}
+		THEN("Batched k closest points are sorted by distance") {
+			const size_t k = 5;
+			std::vector<size_t> closest;
+			kdtree.closest_points(queries, k, closest);
+			REQUIRE(closest.size() == queries.size() * k);
+			for (size_t i = 0; i < queries.size(); ++ i) {
+				REQUIRE((points[closest[i * k]] - queries[i]).squaredNorm() == Approx(brute_force_closest(queries[i], removed)));
+				for (size_t j = 1; j < k; ++ j)
+					REQUIRE((points[closest[i * k + j - 1]] - queries[i]).squaredNorm() <= (points[closest[i * k + j]] - queries[i]).squaredNorm());
+			}
+		}
+	}
+}
+
+SCENARIO("EdgeGrid distance queries", "[Geometry]") {
+	GIVEN("A square") {
+		Polygons polygons { Polygon { { 0, 0 }, { 1000000, 0 }, { 1000000, 1000000 }, { 0, 1000000 } } };
+		EdgeGrid::Grid grid;
+		grid.create(polygons, 100000);
+		THEN("Packed cell segments match the referenced contour segments") {
+			for (coord_t r = 0; r < coord_t(grid.rows()); ++ r)
+				for (coord_t c = 0; c < coord_t(grid.cols()); ++ c) {
+					auto cell_data = grid.cell_data_range(r, c);
+					auto segments  = grid.cell_segments_range(r, c);
+					REQUIRE(segments.second - segments.first == cell_data.second - cell_data.first);
+					for (auto it = cell_data.first; it != cell_data.second; ++ it, ++ segments.first) {
+						REQUIRE(segments.first->a == grid.segment(*it).first);
+						REQUIRE(segments.first->b == grid.segment(*it).second);
+					}
+				}
+		}
+		THEN("Closest point inside is at a negative distance") {
+			EdgeGrid::Grid::ClosestPointResult result = grid.closest_point(Point(500000, 100000), 200000);
+			REQUIRE(result.valid());
+			REQUIRE(result.distance == Approx(-100000.));
+		}
+		THEN("Signed distance outside is positive") {
+			coordf_t dist = 0.;
+			REQUIRE(grid.signed_distance_edges(Point(500000, -50000), 200000, dist));
+			REQUIRE(dist == Approx(50000.));
+			REQUIRE(grid.signed_distance_edges(Point(-30000, -40000), 200000, dist));
+			REQUIRE(dist == Approx(50000.));
+		}
+	}
+}
+
+SCENARIO("Triangulation of expolygons", "[Geometry]") {
+	GIVEN("A square with a square hole") {
+		ExPolygon square_with_hole(
+			Polygon { { 0., 0. }, { scale_(10.), 0. }, { scale_(10.), scale_(10.) }, { 0., scale_(10.) } },
+			Polygon { { scale_(3.), scale_(3.) }, { scale_(3.), scale_(7.) }, { scale_(7.), scale_(7.) }, { scale_(7.), scale_(3.) } });
+		auto triangles_area = [](const std::vector<Vec3d> &triangles) {
+			double area = 0.;
+			for (size_t i = 0; i < triangles.size(); i += 3)
+				area += 0.5 * (triangles[i + 1] - triangles[i]).cross(triangles[i + 2] - triangles[i]).z();
+			return area;
+		};
+		WHEN("triangulated with normals up") {
+			std::vector<Vec3d> triangles = triangulate_expolygon_3d(square_with_hole, 1., NORMALS_UP);
+			THEN("the triangles are counter-clockwise and cover the expolygon") {
+				REQUIRE(triangles.size() == 8 * 3);
+				REQUIRE(triangles_area(triangles) == Approx(100. - 16.));
+				for (const Vec3d &pt : triangles)
+					REQUIRE(pt.z() == 1.);
+			}
+		}
+		WHEN("triangulated with normals down") {
+			std::vector<Vec3d> triangles = triangulate_expolygon_3d(square_with_hole, 0., NORMALS_DOWN);
+			THEN("the triangles are clockwise") {
+				REQUIRE(triangles_area(triangles) == Approx(- 100. + 16.));
+			}
+		}
+		WHEN("many copies are triangulated at once") {
+			ExPolygons expolygons;
+			for (int i = 0; i < 20; ++ i) {
+				expolygons.emplace_back(square_with_hole);
+				expolygons.back().translate(scale_(20. * i), 0);
+			}
+			std::vector<Vec3d> triangles = triangulate_expolygons_3d(expolygons);
+			THEN("the triangles cover all the expolygons") {
+				REQUIRE(triangles.size() == 20 * 8 * 3);
+				REQUIRE(triangles_area(triangles) == Approx(20. * (100. - 16.)));
+			}
+		}
+	}
+}
+
+SCENARIO("Containment of polylines in expolygons", "[Geometry]") {
+	GIVEN("A square with a square hole") {
+		ExPolygon square_with_hole(
+			Polygon { { 0., 0. }, { scale_(10.), 0. }, { scale_(10.), scale_(10.) }, { 0., scale_(10.) } },
+			Polygon { { scale_(3.), scale_(3.) }, { scale_(3.), scale_(7.) }, { scale_(7.), scale_(7.) }, { scale_(7.), scale_(3.) } });
+		THEN("a polyline inside the square and outside the hole is contained") {
+			REQUIRE(square_with_hole.contains(Polyline(Point(scale_(1.), scale_(1.)), Point(scale_(9.), scale_(1.)))));
+			REQUIRE(square_with_hole.contains(Polylines { Polyline(Point(scale_(1.), scale_(1.)), Point(scale_(1.), scale_(9.))) }));
+		}
+		THEN("a polyline crossing the hole is not contained") {
+			REQUIRE(! square_with_hole.contains(Polyline(Point(scale_(1.), scale_(5.)), Point(scale_(9.), scale_(5.)))));
+		}
+		THEN("a polyline leaving the square is not contained") {
+			REQUIRE(! square_with_hole.contains(Polyline(Point(scale_(1.), scale_(1.)), Point(scale_(11.), scale_(1.)))));
+			REQUIRE(! square_with_hole.contains(Polylines { Polyline(Point(scale_(1.), scale_(1.)), Point(scale_(2.), scale_(1.))),
+				Polyline(Point(scale_(1.), scale_(1.)), Point(scale_(1.), - scale_(1.))) }));
+		}
+		THEN("a distant square does not overlap, a square in the hole neither") {
+			ExPolygon other(Polygon { { scale_(20.), 0. }, { scale_(30.), 0. }, { scale_(30.), scale_(10.) }, { scale_(20.), scale_(10.) } });
+			REQUIRE(! square_with_hole.overlaps(other));
+			ExPolygon inner(Polygon { { scale_(4.), scale_(4.) }, { scale_(6.), scale_(4.) }, { scale_(6.), scale_(6.) }, { scale_(4.), scale_(6.) } });
+			REQUIRE(! square_with_hole.overlaps(inner));
+			other.translate(- scale_(15.), 0.);
+			REQUIRE(square_with_hole.overlaps(other));
+		}
+	}
+}
+
+SCENARIO("Surface collection filters and groups", "[Geometry]") {
+	GIVEN("Squares of alternating surface types, every third bridge with another bridge angle") {
+		SurfaceCollection collection;
+		for (int i = 0; i < 9; ++ i) {
+			ExPolygon square(Polygon { { scale_(20. * i), 0. }, { scale_(20. * i + 10.), 0. }, { scale_(20. * i + 10.), scale_(10.) }, { scale_(20. * i), scale_(10.) } },
+				Polygon { { scale_(20. * i + 3.), scale_(3.) }, { scale_(20. * i + 3.), scale_(7.) }, { scale_(20. * i + 7.), scale_(7.) }, { scale_(20. * i + 7.), scale_(3.) } });
+			collection.surfaces.emplace_back(i % 2 ? stInternal : stBottomBridge, square);
+			if (i % 3 == 0)
+				collection.surfaces.back().bridge_angle = 0.5;
+		}
+		THEN("the polygons and expolygons by type are those of the filtered surfaces") {
+			SurfaceType types[] = { stInternal, stBottomBridge };
+			REQUIRE(collection.polygons_by_type(stInternal) == to_polygons(collection.filter_by_type(stInternal)));
+			REQUIRE(collection.expolygons_by_types(types, 2).size() == 9);
+			REQUIRE(collection.expolygons_by_type(stTop).empty());
+			Polygons polygons;
+			collection.filter_by_type(stBottomBridge, &polygons);
+			REQUIRE(polygons == collection.polygons_by_type(stBottomBridge));
+		}
+		THEN("the surfaces are grouped by their properties in the order of their first surfaces") {
+			std::vector<SurfacesPtr> groups;
+			collection.group(&groups);
+			REQUIRE(groups.size() == 4);
+			for (const SurfacesPtr &group : groups)
+				for (const Surface *surface : group)
+					REQUIRE(surfaces_could_merge(*surface, *group.front()));
+			REQUIRE(groups[0].front() == &collection.surfaces[0]);
+			REQUIRE(groups[1].front() == &collection.surfaces[1]);
+			REQUIRE(groups[2].front() == &collection.surfaces[2]);
+			REQUIRE(groups[3].front() == &collection.surfaces[3]);
+			REQUIRE(groups[0].size() + groups[1].size() + groups[2].size() + groups[3].size() == 9);
+		}
+	}
+}
+
+TEST_CASE("Filtered sign of a 2x2 determinant", "[Geometry]") {
+    auto exact = [](int64_t a11, int64_t a12, int64_t a21, int64_t a22) {
+        return Int128::sign_determinant_2x2(a11, a12, a21, a22);
+    };
+    const int64_t int32_limit = int64_t(1) << 31;
+    // Elements just below and above the range of the 64bit exact calculation, collinear and slightly rotated.
+    for (int64_t a : { int64_t(1), int64_t(12345), int32_limit - 1, int32_limit, int32_limit + 1, int64_t(1) << 47 })
+        for (int64_t d : { int64_t(0), int64_t(1), int64_t(-1) }) {
+            REQUIRE(Int128::sign_determinant_2x2_filtered(a, a - 1, a, a - 1 + d) == exact(a, a - 1, a, a - 1 + d));
+            REQUIRE(Int128::sign_determinant_2x2_filtered(-a + 1, a, -a + 1 + d, a) == exact(-a + 1, a, -a + 1 + d, a));
+        }
+    REQUIRE(Int128::sign_determinant_2x2_filtered(int32_limit - 1, -(int32_limit - 1), int32_limit - 1, int32_limit - 1) == 1);
+}
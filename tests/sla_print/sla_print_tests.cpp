@@ -16,6 +16,7 @@
 #include "libslic3r/SLA/SLASupportTreeBuildsteps.hpp"
 #include "libslic3r/SLA/SLAAutoSupports.hpp"
 #include "libslic3r/SLA/SLARaster.hpp"
+#include "libslic3r/SLA/SLASliceStore.hpp"
 #include "libslic3r/SLA/ConcaveHull.hpp"
 #include "libslic3r/MTUtils.hpp"
 
@@ -154,6 +155,7 @@ struct SupportByproducts
     std::string             obj_fname;
     std::vector<float>      slicegrid;
     std::vector<ExPolygons> model_slices;
+    std::vector<sla::SupportPoint> support_points;
     sla::SupportTreeBuilder supporttree;
     TriangleMesh            input_mesh;
 };
@@ -277,6 +279,7 @@ void test_supports(const std::string &       obj_filename,
 
     // Move out the support tree into the byproducts, we can examine it further
     // in various tests.
+    out.support_points = std::move(support_points);
     out.obj_fname   = std::move(obj_filename);
     out.supporttree = std::move(treebuilder);
     out.input_mesh  = std::move(mesh);
@@ -516,6 +519,104 @@ TEST_CASE("FloorSupportsDoNotPierceModel", "[SLASupportGeneration]") {
         test_support_model_collision(fname, supportcfg);
 }
 
+TEST_CASE("AnalyticSupportSlicesShouldMatchMeshSlices", "[SLASupportGeneration]") {
+
+    sla::SupportConfig supportcfg;
+
+    for (auto fname : SUPPORT_TEST_MODELS) {
+        SupportByproducts byproducts;
+        test_supports(fname, supportcfg, byproducts);
+
+        const TriangleMesh &mesh =
+            byproducts.supporttree.retrieve_mesh(sla::MeshType::Support);
+
+        std::vector<ExPolygons> mesh_slices;
+        TriangleMeshSlicer{&mesh}.slice(byproducts.slicegrid, CLOSING_RADIUS,
+                                        &mesh_slices, []{});
+
+        std::vector<ExPolygons> slices =
+            byproducts.supporttree.slice(byproducts.slicegrid, CLOSING_RADIUS);
+
+        REQUIRE(slices.size() == mesh_slices.size());
+
+        // The sections of the analytic elements differ from the mesh
+        // sections only by the tessellation of the element meshes.
+        double area = 0., mesh_area = 0., diff_area = 0.;
+        for (size_t n = 0; n < slices.size(); ++n) {
+            for (const ExPolygon &p : slices[n]) area += p.area();
+            for (const ExPolygon &p : mesh_slices[n]) mesh_area += p.area();
+            for (const ExPolygon &p : diff_ex(to_polygons(slices[n]), to_polygons(mesh_slices[n])))
+                diff_area += p.area();
+            for (const ExPolygon &p : diff_ex(to_polygons(mesh_slices[n]), to_polygons(slices[n])))
+                diff_area += p.area();
+        }
+
+        REQUIRE(mesh_area > 0.);
+        REQUIRE(std::abs(area - mesh_area) < 0.05 * mesh_area);
+        REQUIRE(diff_area < 0.1 * mesh_area);
+    }
+}
+
+TEST_CASE("EditedSupportPointsShouldReuseTheFilteredHeads", "[SLASupportGeneration]") {
+
+    sla::SupportConfig supportcfg;
+
+    for (auto fname : SUPPORT_TEST_MODELS) {
+        SupportByproducts byproducts;
+        test_supports(fname, supportcfg, byproducts);
+
+        sla::EigenMesh3D emesh{byproducts.input_mesh};
+        sla::SupportableMesh sm{emesh, byproducts.support_points, supportcfg};
+        sm.head_cache = std::make_shared<sla::SupportHeadCache>();
+
+        sla::SupportTreeBuilder first;
+        first.build(sm);
+        REQUIRE(first.heads().size() == byproducts.supporttree.heads().size());
+
+        REQUIRE(sm.head_cache->entries.size() <= sm.pts.size());
+
+        // Remove a point as if it was deleted in the support point editor.
+        if (! sm.pts.empty()) sm.pts.pop_back();
+
+        sla::SupportTreeBuilder cached;
+        cached.build(sm);
+
+        sm.head_cache.reset();
+        sla::SupportTreeBuilder reference;
+        reference.build(sm);
+
+        REQUIRE(cached.heads().size() == reference.heads().size());
+        REQUIRE(cached.retrieve_mesh().facets_count() ==
+                reference.retrieve_mesh().facets_count());
+    }
+}
+
+TEST_CASE("RayBundleHitsShouldMatchSingleRays", "[SLASupportGeneration]") {
+    TriangleMesh mesh = load_model("extruder_idler.obj");
+    REQUIRE_FALSE(mesh.empty());
+    sla::EigenMesh3D emesh{mesh};
+
+    // Rays from around the center of the model in all the directions, more
+    // than fit into a single packet.
+    Vec3d center = mesh.bounding_box().center();
+    std::vector<Vec3d> sources, dirs;
+    for (int i = 0; i < 10; ++ i)
+        for (int j = 0; j < 20; ++ j) {
+            double theta = PI * (i + 0.5) / 10., phi = 2. * PI * j / 20.;
+            sources.emplace_back(center + Vec3d(0.1 * j, 0., 0.1 * i));
+            dirs.emplace_back(std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta));
+        }
+
+    std::vector<sla::EigenMesh3D::hit_result> hits = emesh.query_ray_hits(sources, dirs);
+    REQUIRE(hits.size() == sources.size());
+
+    for (size_t i = 0; i < sources.size(); ++ i) {
+        sla::EigenMesh3D::hit_result hit = emesh.query_ray_hit(sources[i], dirs[i]);
+        REQUIRE(hits[i].face() == hit.face());
+        if (hit.face() >= 0) REQUIRE(hits[i].distance() == Approx(hit.distance()));
+    }
+}
+
 TEST_CASE("DefaultRasterShouldBeEmpty", "[SLARasterOutput]") {
     sla::Raster raster;
     REQUIRE(raster.empty());
@@ -689,3 +790,100 @@ TEST_CASE("RasterizedPolygonAreaShouldMatch", "[SLARasterOutput]") {
 
     REQUIRE(diff <= predict_error(poly, pixdim));
 }
+
+TEST_CASE("BandedRasterShouldMatchSequentialDraw", "[SLARasterOutput]") {
+    double disp_w = 120., disp_h = 68.;
+    sla::Raster::Resolution res{2560, 1440};
+    sla::Raster::PixelDim pixdim{disp_w / res.width_px, disp_h / res.height_px};
+    auto bb = BoundingBox({0, 0}, {scaled(disp_w), scaled(disp_h)});
+
+    ExPolygons polys;
+    for (double v : {60., 30., 10., 3.}) {
+        ExPolygon poly = square_with_hole(v);
+        poly.rotate(v / 10.);
+        poly.translate(bb.center().x() + scaled(v / 4.), bb.center().y());
+        polys.emplace_back(std::move(poly));
+    }
+
+    sla::Raster raster{res, pixdim}, banded{res, pixdim};
+    for (const ExPolygon &poly : polys) raster.draw(poly);
+    banded.draw(polys);
+
+    // The polygons are clipped to the bands, which may only change the
+    // antialiased pixels along the edges.
+    size_t num_diff = 0;
+    int max_diff = 0;
+    for (size_t x = 0; x < res.width_px; ++x)
+        for (size_t y = 0; y < res.height_px; ++y) {
+            int d = std::abs(int(raster.read_pixel(x, y)) - int(banded.read_pixel(x, y)));
+            max_diff = std::max(max_diff, d);
+            num_diff += d > 0;
+        }
+
+    REQUIRE(max_diff <= 2);
+
+    double perimeter = 0.;
+    for (const ExPolygon &poly : polys)
+        for (const Line &l : poly.lines()) perimeter += unscaled(l.length());
+
+    REQUIRE(num_diff <= size_t(perimeter / std::min(pixdim.w_mm, pixdim.h_mm)));
+    REQUIRE(raster_white_area(banded) == Approx(raster_white_area(raster)).epsilon(1e-3));
+}
+
+TEST_CASE("ClearedRasterShouldBeBlack", "[SLARasterOutput]") {
+    double disp_w = 120., disp_h = 68.;
+    sla::Raster::Resolution res{2560, 1440};
+    sla::Raster::PixelDim pixdim{disp_w / res.width_px, disp_h / res.height_px};
+    auto bb = BoundingBox({0, 0}, {scaled(disp_w), scaled(disp_h)});
+
+    sla::Raster raster{res, pixdim};
+    ExPolygon poly = square_with_hole(10.);
+    poly.translate(bb.center().x(), bb.center().y());
+
+    // Only the rows drawn into are cleared, both drawing paths have to
+    // record them.
+    raster.draw(poly);
+    raster.clear();
+    REQUIRE(raster_white_area(raster) == Approx(0.));
+
+    raster.draw(ExPolygons{poly, square_with_hole(60.)});
+    raster.clear();
+    REQUIRE(raster_white_area(raster) == Approx(0.));
+}
+
+TEST_CASE("SliceStoreShouldRestoreTheSlices", "[SLASliceStore]") {
+    ExPolygon far = square_with_hole(10.);
+    far.translate(-scaled(100.), scaled(50.));
+    std::vector<ExPolygons> slices = {
+        ExPolygons{square_with_hole(10.), far},
+        ExPolygons{},
+        ExPolygons{square_with_hole(60.)}
+    };
+
+    sla::SliceStore store;
+    store.assign(slices);
+    REQUIRE(store.size() == slices.size());
+    REQUIRE(store.memsize() < sizeof(store) + sizeof(slices) + memsize(slices[0]) + memsize(slices[2]));
+
+    for (size_t i = 0; i < slices.size(); ++ i) {
+        REQUIRE(store.expolygons_count(i) == slices[i].size());
+        // The second access is served by the decoded layers kept.
+        for (int pass = 0; pass < 2; ++ pass) {
+            ExPolygons decoded = store.get(i);
+            REQUIRE(decoded.size() == slices[i].size());
+            for (size_t j = 0; j < decoded.size(); ++ j) {
+                REQUIRE(decoded[j].contour.points == slices[i][j].contour.points);
+                REQUIRE(decoded[j].holes.size() == slices[i][j].holes.size());
+                for (size_t k = 0; k < decoded[j].holes.size(); ++ k)
+                    REQUIRE(decoded[j].holes[k].points == slices[i][j].holes[k].points);
+            }
+        }
+    }
+
+    std::vector<ExPolygons> all = store.get_all();
+    REQUIRE(all.size() == slices.size());
+    REQUIRE(all[0][1].contour.points == far.contour.points);
+
+    store.clear();
+    REQUIRE(store.empty());
+}